@@ -6,5 +6,7 @@
 #pragma once
 
 #include <anki/shader_compiler/ShaderProgramCompiler.h>
+#include <anki/shader_compiler/ShaderProgramSpirvCache.h>
+#include <anki/shader_compiler/ShaderProgramIncludeCache.h>
 
 /// @defgroup shader_compiler Shader compiler
@@ -291,6 +291,8 @@ void App::cleanup()
 
 	m_settingsDir.destroy(m_heapAlloc);
 	m_cacheDir.destroy(m_heapAlloc);
+
+	LoggerSingleton::get().disableAsync();
 }
 
 Error App::init(const ConfigSet& config, AllocAlignedCallback allocCb, void* allocCbUserData)
@@ -310,8 +312,14 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	ConfigSet config = config_;
 	m_displayStats = config.getNumberU32("core_displayStats");
 
-	initMemoryCallbacks(allocCb, allocCbUserData);
-	m_heapAlloc = HeapAllocator<U8>(m_allocCb, m_allocCbData);
+	if(config.getBool("core_asyncLogging"))
+	{
+		LoggerSingleton::get().enableAsync();
+	}
+
+	initMemoryCallbacks(allocCb, allocCbUserData, config);
+	m_heapAlloc = HeapAllocator<U8>(getAllocationCallback(MemoryTagType::CORE),
+									getAllocationCallbackUserData(MemoryTagType::CORE));
 
 	ANKI_CHECK(initDirs(config));
 
@@ -359,7 +367,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	//
 #if ANKI_ENABLE_TRACE
 	m_coreTracer = m_heapAlloc.newInstance<CoreTracer>();
-	ANKI_CHECK(m_coreTracer->init(m_heapAlloc, m_settingsDir));
+	ANKI_CHECK(m_coreTracer->init(m_heapAlloc, m_settingsDir, config.getNumberU32("core_traceStatisticsWindow"),
+								  config.getNumberU32("core_traceStatisticsCsvPeriod")));
 #endif
 
 	//
@@ -390,8 +399,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	// Graphics API
 	//
 	GrManagerInitInfo grInit;
-	grInit.m_allocCallback = m_allocCb;
-	grInit.m_allocCallbackUserData = m_allocCbData;
+	grInit.m_allocCallback = getAllocationCallback(MemoryTagType::GR);
+	grInit.m_allocCallbackUserData = getAllocationCallbackUserData(MemoryTagType::GR);
 	grInit.m_cacheDirectory = m_cacheDir.toCString();
 	grInit.m_config = &config;
 	grInit.m_window = m_window;
@@ -409,7 +418,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	//
 	m_physics = m_heapAlloc.newInstance<PhysicsWorld>();
 
-	ANKI_CHECK(m_physics->init(m_allocCb, m_allocCbData));
+	ANKI_CHECK(m_physics->init(getAllocationCallback(MemoryTagType::PHYSICS),
+							   getAllocationCallbackUserData(MemoryTagType::PHYSICS)));
 
 	//
 	// Resource FS
@@ -426,8 +436,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	rinit.m_resourceFs = m_resourceFs;
 	rinit.m_config = &config;
 	rinit.m_cacheDir = m_cacheDir.toCString();
-	rinit.m_allocCallback = m_allocCb;
-	rinit.m_allocCallbackData = m_allocCbData;
+	rinit.m_allocCallback = getAllocationCallback(MemoryTagType::RESOURCE);
+	rinit.m_allocCallbackData = getAllocationCallbackUserData(MemoryTagType::RESOURCE);
 	m_resources = m_heapAlloc.newInstance<ResourceManager>();
 
 	ANKI_CHECK(m_resources->init(rinit));
@@ -436,7 +446,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	// UI
 	//
 	m_ui = m_heapAlloc.newInstance<UiManager>();
-	ANKI_CHECK(m_ui->init(m_allocCb, m_allocCbData, m_resources, m_gr, m_stagingMem, m_input));
+	ANKI_CHECK(m_ui->init(getAllocationCallback(MemoryTagType::UI), getAllocationCallbackUserData(MemoryTagType::UI),
+						  m_resources, m_gr, m_stagingMem, m_input));
 
 	//
 	// Renderer
@@ -449,32 +460,39 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 
 	m_renderer = m_heapAlloc.newInstance<MainRenderer>();
 
-	ANKI_CHECK(m_renderer->init(m_threadHive, m_resources, m_gr, m_stagingMem, m_ui, m_allocCb, m_allocCbData, config,
-								&m_globalTimestamp));
+	ANKI_CHECK(m_renderer->init(m_threadHive, m_resources, m_gr, m_stagingMem, m_ui,
+								getAllocationCallback(MemoryTagType::RENDERER),
+								getAllocationCallbackUserData(MemoryTagType::RENDERER), config, &m_globalTimestamp));
 
 	//
 	// Script
 	//
 	m_script = m_heapAlloc.newInstance<ScriptManager>();
-	ANKI_CHECK(m_script->init(m_allocCb, m_allocCbData));
+	ANKI_CHECK(m_script->init(getAllocationCallback(MemoryTagType::SCRIPT),
+							  getAllocationCallbackUserData(MemoryTagType::SCRIPT)));
 
 	//
 	// Scene
 	//
 	m_scene = m_heapAlloc.newInstance<SceneGraph>();
 
-	ANKI_CHECK(m_scene->init(m_allocCb, m_allocCbData, m_threadHive, m_resources, m_input, m_script, &m_globalTimestamp,
-							 config));
+	ANKI_CHECK(m_scene->init(getAllocationCallback(MemoryTagType::SCENE),
+							 getAllocationCallbackUserData(MemoryTagType::SCENE), m_threadHive, m_resources, m_input,
+							 m_script, &m_globalTimestamp, config));
 
 	// Inform the script engine about some subsystems
 	m_script->setRenderer(m_renderer);
 	m_script->setSceneGraph(m_scene);
+#if ANKI_ENABLE_TRACE
+	m_script->setTracerStatistics(&m_coreTracer->getStatistics());
+#endif
 
 	//
 	// Misc
 	//
 	ANKI_CHECK(m_ui->newInstance<StatsUi>(m_statsUi));
-	ANKI_CHECK(m_ui->newInstance<DeveloperConsole>(m_console, m_allocCb, m_allocCbData, m_script));
+	ANKI_CHECK(m_ui->newInstance<DeveloperConsole>(m_console, getAllocationCallback(MemoryTagType::UI),
+												   getAllocationCallbackUserData(MemoryTagType::UI), m_script));
 
 	ANKI_CORE_LOGI("Application initialized");
 
@@ -587,6 +605,7 @@ Error App::mainLoop()
 
 			m_gr->swapBuffers();
 			m_stagingMem->endFrame();
+			m_resources->endFrame();
 
 			// Update the trace info with some async loader stats
 			U64 asyncTaskCount = m_resources->getAsyncLoader().getCompletedTaskCount();
@@ -596,6 +615,15 @@ Error App::mainLoop()
 			// Now resume the loader
 			m_resources->getAsyncLoader().resume();
 
+			// Check the budgets and update the trace counters of the memory
+			if(m_memoryTracking)
+			{
+				for(MemoryTag& tag : m_memoryTags)
+				{
+					tag.endFrame();
+				}
+			}
+
 			// Sleep
 			const Second endTime = HighRezTimer::getCurrentTime();
 			const Second frameTime = endTime - startTime;
@@ -684,7 +712,7 @@ void App::injectUiElements(DynamicArrayAuto<UiQueueElement>& newUiElementArr, Re
 	}
 }
 
-void App::initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserData)
+void App::initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserData, const ConfigSet& config)
 {
 	if(m_displayStats)
 	{
@@ -699,6 +727,42 @@ void App::initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserDat
 		m_allocCb = allocCb;
 		m_allocCbData = allocCbUserData;
 	}
+
+	m_memoryTracking = config.getBool("core_memoryTracking");
+	if(m_memoryTracking)
+	{
+		const Array<const char*, U32(MemoryTagType::COUNT)> names = {
+			{"CORE", "GR", "PHYSICS", "RESOURCE", "UI", "RENDERER", "SCRIPT", "SCENE"}};
+		const Array<const char*, U32(MemoryTagType::COUNT)> budgetOptions = {
+			{nullptr, "core_grMemoryBudget", "core_physicsMemoryBudget", "core_resourceMemoryBudget",
+			 "core_uiMemoryBudget", "core_rendererMemoryBudget", "core_scriptMemoryBudget",
+			 "core_sceneMemoryBudget"}};
+		const U32 samplingRate = config.getNumberU32("core_memoryCallstackSamplingRate");
+
+		for(U32 i = 0; i < U32(MemoryTagType::COUNT); ++i)
+		{
+			m_memoryTags[i].init(names[i], m_allocCb, m_allocCbData);
+			m_memoryTags[i].setCallstackSamplingRate(samplingRate);
+			if(budgetOptions[i])
+			{
+				m_memoryTags[i].setBudget(config.getNumberU64(budgetOptions[i]));
+			}
+		}
+	}
+}
+
+void App::logMemoryCallstacks(U32 maxCountPerSubsystem) const
+{
+	if(!m_memoryTracking)
+	{
+		ANKI_CORE_LOGW("Memory tracking is disabled. See core_memoryTracking");
+		return;
+	}
+
+	for(const MemoryTag& tag : m_memoryTags)
+	{
+		tag.logSampledCallstacks(maxCountPerSubsystem);
+	}
 }
 
 } // end namespace anki
@@ -9,6 +9,7 @@
 #include <anki/util/Allocator.h>
 #include <anki/util/String.h>
 #include <anki/util/Ptr.h>
+#include <anki/util/MemoryTag.h>
 #include <anki/ui/UiImmediateModeBuilder.h>
 #if ANKI_OS_ANDROID
 #	include <android_native_app_glue.h>
@@ -158,12 +159,32 @@ public:
 		return m_consoleEnabled;
 	}
 
+	/// Log the sampled callstacks of all subsystems. See core_memoryCallstackSamplingRate.
+	void logMemoryCallstacks(U32 maxCountPerSubsystem) const;
+
 private:
 	class StatsUi;
 
+	/// The subsystems that have their own memory tag.
+	enum class MemoryTagType : U8
+	{
+		CORE,
+		GR,
+		PHYSICS,
+		RESOURCE,
+		UI,
+		RENDERER,
+		SCRIPT,
+		SCENE,
+
+		COUNT
+	};
+
 	// Allocation
 	AllocAlignedCallback m_allocCb;
 	void* m_allocCbData;
+	Array<MemoryTag, U32(MemoryTagType::COUNT)> m_memoryTags; ///< Should outlive all allocators.
+	Bool m_memoryTracking = false;
 	HeapAllocator<U8> m_heapAlloc;
 
 	// Sybsystems
@@ -207,7 +228,19 @@ private:
 		static void* allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment);
 	} m_memStats;
 
-	void initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserData);
+	void initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserData, const ConfigSet& config);
+
+	/// The allocation callback of a subsystem.
+	AllocAlignedCallback getAllocationCallback(MemoryTagType tag) const
+	{
+		return (m_memoryTracking) ? MemoryTag::allocCallback : m_allocCb;
+	}
+
+	/// The user data of the allocation callback of a subsystem.
+	void* getAllocationCallbackUserData(MemoryTagType tag)
+	{
+		return (m_memoryTracking) ? &m_memoryTags[U32(tag)] : m_allocCbData;
+	}
 
 	ANKI_USE_RESULT Error initInternal(const ConfigSet& config, AllocAlignedCallback allocCb, void* allocCbUserData);
 
@@ -15,4 +15,20 @@ ANKI_CONFIG_OPTION(core_targetFps, 60u, 30u, MAX_U32, "Target FPS")
 ANKI_CONFIG_OPTION(core_mainThreadCount, max(2u, getCpuCoresCount() / 2u), 2u, 1024u)
 ANKI_CONFIG_OPTION(core_displayStats, 0, 0, 1)
 ANKI_CONFIG_OPTION(core_clearCaches, 0, 0, 1)
+ANKI_CONFIG_OPTION(core_traceStatisticsWindow, 600u, 1u, U32(MAX_U16),
+				   "Number of frames of the rolling trace statistics")
+ANKI_CONFIG_OPTION(core_traceStatisticsCsvPeriod, 0u, 0u, MAX_U32,
+				   "Dump the trace statistics to a CSV every that many frames. 0 disables it")
+ANKI_CONFIG_OPTION(core_asyncLogging, 0, 0, 1, "Pass the log messages to the handlers from a dedicated thread")
+
+ANKI_CONFIG_OPTION(core_memoryTracking, 0, 0, 1, "Track the memory of every subsystem")
+ANKI_CONFIG_OPTION(core_memoryCallstackSamplingRate, 0u, 0u, MAX_U32,
+				   "Capture the callstack of every Nth allocation of the subsystems. 0 disables it")
+ANKI_CONFIG_OPTION(core_grMemoryBudget, 0_MB, 0_MB, 64_GB, "CPU memory budget of the GR. 0 means no budget")
+ANKI_CONFIG_OPTION(core_physicsMemoryBudget, 0_MB, 0_MB, 64_GB)
+ANKI_CONFIG_OPTION(core_resourceMemoryBudget, 0_MB, 0_MB, 64_GB)
+ANKI_CONFIG_OPTION(core_uiMemoryBudget, 0_MB, 0_MB, 64_GB)
+ANKI_CONFIG_OPTION(core_rendererMemoryBudget, 0_MB, 0_MB, 64_GB)
+ANKI_CONFIG_OPTION(core_scriptMemoryBudget, 0_MB, 0_MB, 64_GB)
+ANKI_CONFIG_OPTION(core_sceneMemoryBudget, 0_MB, 0_MB, 64_GB)
 ANKI_CONFIG_OPTION(window_fullscreen, 0, 0, 1)
@@ -31,6 +31,28 @@ static void getSpreadsheetColumnName(U32 column, Array<char, 3>& arr)
 	arr[2] = '\0';
 }
 
+template<typename T>
+static void appendToBuffer(GenericMemoryPoolAllocator<U8>& alloc, DynamicArray<U8>& buff, const T& value)
+{
+	const U32 offset = buff.getSize();
+	buff.resize(alloc, offset + sizeof(T));
+	memcpy(&buff[offset], &value, sizeof(T));
+}
+
+template<typename T>
+static Error readFromBuffer(ConstWeakArray<U8> buff, U32& offset, T& value)
+{
+	if(offset + sizeof(T) > buff.getSize())
+	{
+		ANKI_CORE_LOGE("The trace file is truncated");
+		return Error::USER_DATA;
+	}
+
+	memcpy(&value, &buff[offset], sizeof(T));
+	offset += sizeof(T);
+	return Error::NONE;
+}
+
 class CoreTracer::ThreadWorkItem : public IntrusiveListEnabled<ThreadWorkItem>
 {
 public:
@@ -38,6 +60,7 @@ public:
 	DynamicArrayAuto<TracerCounter> m_counters;
 	ThreadId m_tid;
 	U64 m_frame;
+	Bool m_endOfFrame = false;
 
 	ThreadWorkItem(GenericMemoryPoolAllocator<U8>& alloc)
 		: m_events(alloc)
@@ -46,7 +69,7 @@ public:
 	}
 };
 
-class CoreTracer::PerFrameCounters : public IntrusiveListEnabled<PerFrameCounters>
+class CoreTraceConverter::PerFrameCounters : public IntrusiveListEnabled<PerFrameCounters>
 {
 public:
 	DynamicArrayAuto<TracerCounter> m_counters;
@@ -74,39 +97,24 @@ CoreTracer::~CoreTracer()
 	Error err = m_thread.join();
 	(void)err;
 
-	// Finalize trace file
-	if(m_traceJsonFile.isOpen())
-	{
-		err = m_traceJsonFile.writeText("{}\n]\n");
-	}
-
-	// Write counter file
-	err = writeCountersForReal();
-
 	// Cleanup
-	while(!m_frameCounters.isEmpty())
-	{
-		PerFrameCounters* frame = m_frameCounters.popBack();
-		m_alloc.deleteInstance(frame);
-	}
-
 	while(!m_workItems.isEmpty())
 	{
 		ThreadWorkItem* item = m_workItems.popBack();
 		m_alloc.deleteInstance(item);
 	}
 
-	for(String& s : m_counterNames)
-	{
-		s.destroy(m_alloc);
-	}
-	m_counterNames.destroy(m_alloc);
+	m_alloc.deleteInstance(m_statistics);
+	m_nameIndices.destroy(m_alloc);
+	m_writeBuffer.destroy(m_alloc);
+	m_traceFilename.destroy(m_alloc);
 
 	// Destroy the tracer
 	TracerSingleton::destroy();
 }
 
-Error CoreTracer::init(GenericMemoryPoolAllocator<U8> alloc, CString directory)
+Error CoreTracer::init(GenericMemoryPoolAllocator<U8> alloc, CString directory, U32 statisticsWindowFrameCount,
+					   U32 statisticsCsvPeriod)
 {
 	TracerSingleton::init(alloc);
 	const Bool enableTracer = getenv("ANKI_CORE_TRACER_ENABLED") && getenv("ANKI_CORE_TRACER_ENABLED")[0] == '1';
@@ -114,20 +122,28 @@ Error CoreTracer::init(GenericMemoryPoolAllocator<U8> alloc, CString directory)
 	ANKI_CORE_LOGI("Tracing is %s from the beginning", (enableTracer) ? "enabled" : "disabled");
 
 	m_alloc = alloc;
-	m_thread.start(this, [](ThreadCallbackInfo& info) -> Error {
-		return static_cast<CoreTracer*>(info.m_userData)->threadWorker();
-	});
 
 	std::time_t t = std::time(nullptr);
 	std::tm* tm = std::localtime(&t);
-	StringAuto fname(m_alloc);
-	fname.sprintf("%s/%d%02d%02d-%02d%02d_", directory.cstr(), tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
-				  tm->tm_hour, tm->tm_min);
+	m_traceFilename.sprintf(m_alloc, "%s/%d%02d%02d-%02d%02d_trace.ankitrace", directory.cstr(), tm->tm_year + 1900,
+							tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min);
+
+	ANKI_CHECK(m_traceFile.open(m_traceFilename, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+	ANKI_CHECK(m_traceFile.write(CORE_TRACE_MAGIC, strlen(CORE_TRACE_MAGIC)));
 
-	ANKI_CHECK(m_traceJsonFile.open(StringAuto(alloc).sprintf("%strace.json", fname.cstr()), FileOpenFlag::WRITE));
-	ANKI_CHECK(m_traceJsonFile.writeText("[\n"));
+	m_statistics = m_alloc.newInstance<TracerStatistics>(m_alloc, statisticsWindowFrameCount);
+	m_statisticsCsvPeriod = statisticsCsvPeriod;
+	if(m_statisticsCsvPeriod)
+	{
+		ANKI_CHECK(m_statisticsCsvFile.open(
+			StringAuto(alloc).sprintf("%s/%d%02d%02d-%02d%02d_trace_statistics.csv", directory.cstr(),
+									  tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min),
+			FileOpenFlag::WRITE));
+	}
 
-	ANKI_CHECK(m_countersCsvFile.open(StringAuto(alloc).sprintf("%scounters.csv", fname.cstr()), FileOpenFlag::WRITE));
+	m_thread.start(this, [](ThreadCallbackInfo& info) -> Error {
+		return static_cast<CoreTracer*>(info.m_userData)->threadWorker();
+	});
 
 	return Error::NONE;
 }
@@ -162,71 +178,349 @@ Error CoreTracer::threadWorker()
 		}
 
 		// Do some work using the frame and delete it
-		if(item)
+		if(item && item->m_endOfFrame)
 		{
-			err = writeEvents(*item);
+			m_statistics->endFrame();
 
-			if(!err)
+			const U64 frameCount = m_statistics->getFrameCount();
+			if(m_statisticsCsvPeriod && (frameCount % m_statisticsCsvPeriod) == 0)
 			{
-				gatherCounters(*item);
+				err = m_statistics->writeCsv(m_statisticsCsvFile, frameCount == m_statisticsCsvPeriod);
 			}
 
 			m_alloc.deleteInstance(item);
 		}
+		else if(item)
+		{
+			m_statistics->addEvents(item->m_events);
+			m_statistics->addCounters(item->m_counters);
+
+			writeWorkItem(*item);
+			m_alloc.deleteInstance(item);
+
+			if(m_writeBuffer.getSize())
+			{
+				err = m_traceFile.write(&m_writeBuffer[0], m_writeBuffer.getSize());
+				m_writeBuffer.resize(m_alloc, 0);
+			}
+		}
 	}
 
 	return err;
 }
 
-Error CoreTracer::writeEvents(ThreadWorkItem& item)
+U32 CoreTracer::getOrWriteName(CString name)
+{
+	const U64 hash = name.computeHash();
+	auto it = m_nameIndices.find(hash);
+	if(it != m_nameIndices.getEnd())
+	{
+		return *it;
+	}
+
+	// First time seeing that name, write it
+	const U32 idx = m_nameCount++;
+	m_nameIndices.emplace(m_alloc, hash, idx);
+
+	const U32 length = name.getLength();
+	appendToBuffer(m_alloc, m_writeBuffer, CoreTraceRecordType::NAME);
+	appendToBuffer(m_alloc, m_writeBuffer, length);
+	const U32 offset = m_writeBuffer.getSize();
+	m_writeBuffer.resize(m_alloc, offset + length);
+	memcpy(&m_writeBuffer[offset], name.cstr(), length);
+
+	return idx;
+}
+
+void CoreTracer::writeWorkItem(const ThreadWorkItem& item)
+{
+	// Write the names first because the record that follows should be contiguous
+	DynamicArrayAuto<U32> nameIndices(m_alloc);
+	nameIndices.create(item.m_events.getSize() + item.m_counters.getSize());
+	U32 count = 0;
+	for(const TracerEvent& event : item.m_events)
+	{
+		nameIndices[count++] = getOrWriteName(event.m_name);
+	}
+
+	for(const TracerCounter& counter : item.m_counters)
+	{
+		nameIndices[count++] = getOrWriteName(counter.m_name);
+	}
+
+	count = 0;
+	if(item.m_events.getSize())
+	{
+		appendToBuffer(m_alloc, m_writeBuffer, CoreTraceRecordType::EVENTS);
+		appendToBuffer(m_alloc, m_writeBuffer, item.m_frame);
+		appendToBuffer(m_alloc, m_writeBuffer, U64(item.m_tid));
+		appendToBuffer(m_alloc, m_writeBuffer, item.m_events.getSize());
+		for(const TracerEvent& event : item.m_events)
+		{
+			appendToBuffer(m_alloc, m_writeBuffer, nameIndices[count++]);
+			appendToBuffer(m_alloc, m_writeBuffer, U64(event.m_start * 1000000000.0));
+			appendToBuffer(m_alloc, m_writeBuffer, U64(event.m_duration * 1000000000.0));
+		}
+	}
+
+	if(item.m_counters.getSize())
+	{
+		appendToBuffer(m_alloc, m_writeBuffer, CoreTraceRecordType::COUNTERS);
+		appendToBuffer(m_alloc, m_writeBuffer, item.m_frame);
+		appendToBuffer(m_alloc, m_writeBuffer, U64(item.m_tid));
+		appendToBuffer(m_alloc, m_writeBuffer, item.m_counters.getSize());
+		for(const TracerCounter& counter : item.m_counters)
+		{
+			appendToBuffer(m_alloc, m_writeBuffer, nameIndices[count++]);
+			appendToBuffer(m_alloc, m_writeBuffer, counter.m_value);
+		}
+	}
+}
+
+void CoreTracer::flushFrame(U64 frame)
+{
+	struct Ctx
+	{
+		U64 m_frame;
+		CoreTracer* m_self;
+	};
+
+	Ctx ctx;
+	ctx.m_frame = frame;
+	ctx.m_self = this;
+
+	TracerSingleton::get().flush(
+		[](void* ud, ThreadId tid, ConstWeakArray<TracerEvent> events, ConstWeakArray<TracerCounter> counters) {
+			Ctx& ctx = *static_cast<Ctx*>(ud);
+			CoreTracer& self = *ctx.m_self;
+
+			ThreadWorkItem* item = self.m_alloc.newInstance<ThreadWorkItem>(self.m_alloc);
+			item->m_tid = tid;
+			item->m_frame = ctx.m_frame;
+
+			if(events.getSize() > 0)
+			{
+				item->m_events.create(events.getSize());
+				memcpy(&item->m_events[0], &events[0], events.getSizeInBytes());
+			}
+
+			if(counters.getSize() > 0)
+			{
+				item->m_counters.create(counters.getSize());
+				memcpy(&item->m_counters[0], &counters[0], counters.getSizeInBytes());
+			}
+
+			LockGuard<Mutex> lock(self.m_mtx);
+			self.m_workItems.pushBack(item);
+			self.m_cvar.notifyOne();
+		},
+		&ctx);
+
+	// Close the frame of the statistics
+	if(TracerSingleton::get().getEnabled())
+	{
+		ThreadWorkItem* item = m_alloc.newInstance<ThreadWorkItem>(m_alloc);
+		item->m_tid = 0;
+		item->m_frame = frame;
+		item->m_endOfFrame = true;
+
+		LockGuard<Mutex> lock(m_mtx);
+		m_workItems.pushBack(item);
+		m_cvar.notifyOne();
+	}
+}
+
+CoreTraceConverter::~CoreTraceConverter()
+{
+	while(!m_frameCounters.isEmpty())
+	{
+		PerFrameCounters* frame = m_frameCounters.popBack();
+		m_alloc.deleteInstance(frame);
+	}
+
+	for(String& s : m_counterNames)
+	{
+		s.destroy(m_alloc);
+	}
+	m_counterNames.destroy(m_alloc);
+
+	for(String& s : m_names)
+	{
+		s.destroy(m_alloc);
+	}
+	m_names.destroy(m_alloc);
+}
+
+Error CoreTraceConverter::convert(CString traceFilename, CString jsonFilename, CString csvFilename)
+{
+	// Read the whole file
+	DynamicArrayAuto<U8> buff(m_alloc);
+	{
+		File file;
+		ANKI_CHECK(file.open(traceFilename, FileOpenFlag::READ | FileOpenFlag::BINARY));
+		buff.create(U32(file.getSize()));
+		if(buff.getSize())
+		{
+			ANKI_CHECK(file.read(&buff[0], buff.getSize()));
+		}
+	}
+
+	const PtrSize magicLength = strlen(CORE_TRACE_MAGIC);
+	if(buff.getSize() < magicLength || memcmp(&buff[0], CORE_TRACE_MAGIC, magicLength) != 0)
+	{
+		ANKI_CORE_LOGE("Not a trace file: %s", traceFilename.cstr());
+		return Error::USER_DATA;
+	}
+
+	File jsonFile;
+	ANKI_CHECK(jsonFile.open(jsonFilename, FileOpenFlag::WRITE));
+	ANKI_CHECK(jsonFile.writeText("[\n"));
+
+	// Process the records
+	const ConstWeakArray<U8> data(buff);
+	U32 offset = U32(magicLength);
+	while(offset < data.getSize())
+	{
+		CoreTraceRecordType type;
+		ANKI_CHECK(readFromBuffer(data, offset, type));
+
+		if(type == CoreTraceRecordType::NAME)
+		{
+			U32 length;
+			ANKI_CHECK(readFromBuffer(data, offset, length));
+			if(offset + length > data.getSize())
+			{
+				ANKI_CORE_LOGE("The trace file is truncated");
+				return Error::USER_DATA;
+			}
+
+			m_names.emplaceBack(m_alloc);
+			m_names.getBack().create(m_alloc, reinterpret_cast<const char*>(&data[offset]),
+									 reinterpret_cast<const char*>(&data[offset]) + length);
+			offset += length;
+			continue;
+		}
+
+		if(type != CoreTraceRecordType::EVENTS && type != CoreTraceRecordType::COUNTERS)
+		{
+			ANKI_CORE_LOGE("Unknown record in the trace file");
+			return Error::USER_DATA;
+		}
+
+		U64 frame, tid;
+		U32 count;
+		ANKI_CHECK(readFromBuffer(data, offset, frame));
+		ANKI_CHECK(readFromBuffer(data, offset, tid));
+		ANKI_CHECK(readFromBuffer(data, offset, count));
+
+		if(type == CoreTraceRecordType::EVENTS)
+		{
+			DynamicArrayAuto<TracerEvent> events(m_alloc);
+			events.create(count);
+			for(TracerEvent& event : events)
+			{
+				U32 nameIdx;
+				U64 startNs, durationNs;
+				ANKI_CHECK(readFromBuffer(data, offset, nameIdx));
+				ANKI_CHECK(readFromBuffer(data, offset, startNs));
+				ANKI_CHECK(readFromBuffer(data, offset, durationNs));
+				if(nameIdx >= m_names.getSize())
+				{
+					ANKI_CORE_LOGE("Wrong name index in the trace file");
+					return Error::USER_DATA;
+				}
+
+				event.m_name = m_names[nameIdx].toCString();
+				event.m_start = Second(startNs) / 1000000000.0;
+				event.m_duration = Second(durationNs) / 1000000000.0;
+			}
+
+			ANKI_CHECK(writeEvents(jsonFile, tid, events));
+		}
+		else
+		{
+			DynamicArrayAuto<TracerCounter> counters(m_alloc);
+			counters.create(count);
+			for(TracerCounter& counter : counters)
+			{
+				U32 nameIdx;
+				ANKI_CHECK(readFromBuffer(data, offset, nameIdx));
+				ANKI_CHECK(readFromBuffer(data, offset, counter.m_value));
+				if(nameIdx >= m_names.getSize())
+				{
+					ANKI_CORE_LOGE("Wrong name index in the trace file");
+					return Error::USER_DATA;
+				}
+
+				counter.m_name = m_names[nameIdx].toCString();
+			}
+
+			gatherCounters(frame, counters);
+		}
+	}
+
+	// Finalize trace file
+	ANKI_CHECK(jsonFile.writeText("{}\n]\n"));
+
+	// Write counter file
+	File csvFile;
+	ANKI_CHECK(csvFile.open(csvFilename, FileOpenFlag::WRITE));
+	ANKI_CHECK(writeCounters(csvFile));
+
+	return Error::NONE;
+}
+
+Error CoreTraceConverter::writeEvents(File& jsonFile, ThreadId tid, DynamicArrayAuto<TracerEvent>& events)
 {
 	// First sort them to fix overlaping in chrome
-	std::sort(item.m_events.getBegin(), item.m_events.getEnd(), [](const TracerEvent& a, TracerEvent& b) {
+	std::sort(events.getBegin(), events.getEnd(), [](const TracerEvent& a, TracerEvent& b) {
 		return (a.m_start != b.m_start) ? a.m_start < b.m_start : a.m_duration > b.m_duration;
 	});
 
 	// Write events
-	for(const TracerEvent& event : item.m_events)
+	for(const TracerEvent& event : events)
 	{
 		const I64 startMicroSec = I64(event.m_start * 1000000.0);
 		const I64 durMicroSec = I64(event.m_duration * 1000000.0);
 
 		// Do a hack
-		const ThreadId tid = (event.m_name == "GPU_TIME") ? 1 : item.m_tid;
+		const ThreadId eventTid = (event.m_name == "GPU_TIME") ? 1 : tid;
 
-		ANKI_CHECK(m_traceJsonFile.writeText("{\"name\": \"%s\", \"cat\": \"PERF\", \"ph\": \"X\", "
-											 "\"pid\": 1, \"tid\": %llu, \"ts\": %lld, \"dur\": %lld},\n",
-											 event.m_name.cstr(), tid, startMicroSec, durMicroSec));
+		ANKI_CHECK(jsonFile.writeText("{\"name\": \"%s\", \"cat\": \"PERF\", \"ph\": \"X\", "
+									  "\"pid\": 1, \"tid\": %llu, \"ts\": %lld, \"dur\": %lld},\n",
+									  event.m_name.cstr(), eventTid, startMicroSec, durMicroSec));
 	}
 
-	// Store counters
-	// TODO
-
 	return Error::NONE;
 }
 
-void CoreTracer::gatherCounters(ThreadWorkItem& item)
+void CoreTraceConverter::gatherCounters(U64 frame, DynamicArrayAuto<TracerCounter>& counters)
 {
+	if(counters.getSize() == 0)
+	{
+		return;
+	}
+
 	// Sort
-	std::sort(item.m_counters.getBegin(), item.m_counters.getEnd(),
+	std::sort(counters.getBegin(), counters.getEnd(),
 			  [](const TracerCounter& a, const TracerCounter& b) { return a.m_name < b.m_name; });
 
 	// Merge same
 	DynamicArrayAuto<TracerCounter> mergedCounters(m_alloc);
-	for(U32 i = 0; i < item.m_counters.getSize(); ++i)
+	for(U32 i = 0; i < counters.getSize(); ++i)
 	{
-		if(mergedCounters.getSize() == 0 || mergedCounters.getBack().m_name != item.m_counters[i].m_name)
+		if(mergedCounters.getSize() == 0 || mergedCounters.getBack().m_name != counters[i].m_name)
 		{
 			// New
-			mergedCounters.emplaceBack(item.m_counters[i]);
+			mergedCounters.emplaceBack(counters[i]);
 		}
 		else
 		{
 			// Merge
-			mergedCounters.getBack().m_value += item.m_counters[i].m_value;
+			mergedCounters.getBack().m_value += counters[i].m_value;
 		}
 	}
-	ANKI_ASSERT(mergedCounters.getSize() > 0 && mergedCounters.getSize() <= item.m_counters.getSize());
+	ANKI_ASSERT(mergedCounters.getSize() > 0 && mergedCounters.getSize() <= counters.getSize());
 
 	// Add missing counter names
 	Bool addedCounterName = false;
@@ -257,23 +551,23 @@ void CoreTracer::gatherCounters(ThreadWorkItem& item)
 	}
 
 	// Get a per-frame structure
-	if(m_frameCounters.isEmpty() || m_frameCounters.getBack().m_frame != item.m_frame)
+	if(m_frameCounters.isEmpty() || m_frameCounters.getBack().m_frame != frame)
 	{
 		// Create new frame
 		PerFrameCounters* newPerFrame = m_alloc.newInstance<PerFrameCounters>(m_alloc);
 		newPerFrame->m_counters = std::move(mergedCounters);
-		newPerFrame->m_frame = item.m_frame;
+		newPerFrame->m_frame = frame;
 		m_frameCounters.pushBack(newPerFrame);
 	}
 	else
 	{
 		// Merge counters to existing frame
-		PerFrameCounters& frame = m_frameCounters.getBack();
-		ANKI_ASSERT(frame.m_frame == item.m_frame);
+		PerFrameCounters& perFrame = m_frameCounters.getBack();
+		ANKI_ASSERT(perFrame.m_frame == frame);
 		for(const TracerCounter& newCounter : mergedCounters)
 		{
 			Bool found = false;
-			for(TracerCounter& existingCounter : frame.m_counters)
+			for(TracerCounter& existingCounter : perFrame.m_counters)
 			{
 				if(newCounter.m_name == existingCounter.m_name)
 				{
@@ -285,71 +579,31 @@ void CoreTracer::gatherCounters(ThreadWorkItem& item)
 
 			if(!found)
 			{
-				frame.m_counters.emplaceBack(newCounter);
+				perFrame.m_counters.emplaceBack(newCounter);
 			}
 		}
 	}
 }
 
-void CoreTracer::flushFrame(U64 frame)
-{
-	struct Ctx
-	{
-		U64 m_frame;
-		CoreTracer* m_self;
-	};
-
-	Ctx ctx;
-	ctx.m_frame = frame;
-	ctx.m_self = this;
-
-	TracerSingleton::get().flush(
-		[](void* ud, ThreadId tid, ConstWeakArray<TracerEvent> events, ConstWeakArray<TracerCounter> counters) {
-			Ctx& ctx = *static_cast<Ctx*>(ud);
-			CoreTracer& self = *ctx.m_self;
-
-			ThreadWorkItem* item = self.m_alloc.newInstance<ThreadWorkItem>(self.m_alloc);
-			item->m_tid = tid;
-			item->m_frame = ctx.m_frame;
-
-			if(events.getSize() > 0)
-			{
-				item->m_events.create(events.getSize());
-				memcpy(&item->m_events[0], &events[0], events.getSizeInBytes());
-			}
-
-			if(counters.getSize() > 0)
-			{
-				item->m_counters.create(counters.getSize());
-				memcpy(&item->m_counters[0], &counters[0], counters.getSizeInBytes());
-			}
-
-			LockGuard<Mutex> lock(self.m_mtx);
-			self.m_workItems.pushBack(item);
-			self.m_cvar.notifyOne();
-		},
-		&ctx);
-}
-
-Error CoreTracer::writeCountersForReal()
+Error CoreTraceConverter::writeCounters(File& csvFile)
 {
-	if(!m_countersCsvFile.isOpen() || m_frameCounters.getSize() == 0)
+	if(m_frameCounters.getSize() == 0)
 	{
 		return Error::NONE;
 	}
 
 	// Write the header
-	ANKI_CHECK(m_countersCsvFile.writeText("Frame"));
+	ANKI_CHECK(csvFile.writeText("Frame"));
 	for(U32 i = 0; i < m_counterNames.getSize(); ++i)
 	{
-		ANKI_CHECK(m_countersCsvFile.writeText(",%s", m_counterNames[i].cstr()));
+		ANKI_CHECK(csvFile.writeText(",%s", m_counterNames[i].cstr()));
 	}
-	ANKI_CHECK(m_countersCsvFile.writeText("\n"));
+	ANKI_CHECK(csvFile.writeText("\n"));
 
 	// Write each frame
 	for(const PerFrameCounters& frame : m_frameCounters)
 	{
-		ANKI_CHECK(m_countersCsvFile.writeText("%llu", frame.m_frame));
+		ANKI_CHECK(csvFile.writeText("%llu", frame.m_frame));
 
 		for(U32 j = 0; j < m_counterNames.getSize(); ++j)
 		{
@@ -364,26 +618,26 @@ Error CoreTracer::writeCountersForReal()
 				}
 			}
 
-			ANKI_CHECK(m_countersCsvFile.writeText(",%llu", value));
+			ANKI_CHECK(csvFile.writeText(",%llu", value));
 		}
 
-		ANKI_CHECK(m_countersCsvFile.writeText("\n"));
+		ANKI_CHECK(csvFile.writeText("\n"));
 	}
 
 	// Write some statistics
 	Array<const char*, 2> funcs = {"SUM", "AVERAGE"};
 	for(const char* func : funcs)
 	{
-		ANKI_CHECK(m_countersCsvFile.writeText(func));
+		ANKI_CHECK(csvFile.writeText(func));
 		for(U32 i = 0; i < m_frameCounters.getSize(); ++i)
 		{
 			Array<char, 3> columnName;
 			getSpreadsheetColumnName(i + 1, columnName);
-			ANKI_CHECK(m_countersCsvFile.writeText(",=%s(%s2:%s%u)", func, &columnName[0], &columnName[0],
-												   m_frameCounters.getSize() + 1));
+			ANKI_CHECK(csvFile.writeText(",=%s(%s2:%s%u)", func, &columnName[0], &columnName[0],
+										 m_frameCounters.getSize() + 1));
 		}
 
-		ANKI_CHECK(m_countersCsvFile.writeText("\n"));
+		ANKI_CHECK(csvFile.writeText("\n"));
 	}
 
 	return Error::NONE;
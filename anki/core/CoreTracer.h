@@ -10,6 +10,8 @@
 #include <anki/util/Allocator.h>
 #include <anki/util/List.h>
 #include <anki/util/File.h>
+#include <anki/util/FlatHashMap.h>
+#include <anki/util/TracerStatistics.h>
 
 namespace anki
 {
@@ -17,7 +19,20 @@ namespace anki
 /// @addtogroup core
 /// @{
 
-/// A system that sits on top of the tracer and processes the counters and events.
+/// The magic at the beginning of the binary trace files.
+constexpr const char* CORE_TRACE_MAGIC = "ANKITRC1";
+
+/// The binary trace file is the CORE_TRACE_MAGIC followed by records. Each record starts with its type. The names are
+/// written once with a NAME record and the rest of the records refer to them using their index.
+enum class CoreTraceRecordType : U8
+{
+	NAME, ///< U32 length followed by the characters.
+	EVENTS, ///< U64 frame, U64 thread ID, U32 count and count times {U32 name, U64 start ns, U64 duration ns}.
+	COUNTERS ///< U64 frame, U64 thread ID, U32 count and count times {U32 name, U64 value}.
+};
+
+/// A system that sits on top of the tracer and streams the counters and events to a binary file. Use the
+/// CoreTraceConverter to get something readable out of it. It also keeps rolling statistics of the events and counters.
 class CoreTracer
 {
 public:
@@ -25,15 +40,30 @@ public:
 
 	~CoreTracer();
 
-	/// @param directory The directory to store the trace and counters.
-	ANKI_USE_RESULT Error init(GenericMemoryPoolAllocator<U8> alloc, CString directory);
+	/// @param directory The directory to store the trace.
+	/// @param statisticsWindowFrameCount See TracerStatistics.
+	/// @param statisticsCsvPeriod Dump the statistics to a CSV every that many frames. Zero disables it.
+	ANKI_USE_RESULT Error init(GenericMemoryPoolAllocator<U8> alloc, CString directory,
+							   U32 statisticsWindowFrameCount = 600, U32 statisticsCsvPeriod = 0);
 
 	/// It will flush everything.
 	void flushFrame(U64 frame);
 
+	/// Get the filename of the binary trace.
+	CString getTraceFilename() const
+	{
+		return m_traceFilename.toCString();
+	}
+
+	/// The statistics are updated by a thread so they might lag a frame or so.
+	const TracerStatistics& getStatistics() const
+	{
+		ANKI_ASSERT(m_statistics);
+		return *m_statistics;
+	}
+
 private:
 	class ThreadWorkItem;
-	class PerFrameCounters;
 
 	GenericMemoryPoolAllocator<U8> m_alloc;
 
@@ -41,19 +71,53 @@ private:
 	ConditionVariable m_cvar;
 	Mutex m_mtx;
 
-	DynamicArray<String> m_counterNames;
-	IntrusiveList<PerFrameCounters> m_frameCounters;
-
 	IntrusiveList<ThreadWorkItem> m_workItems; ///< Items for the thread to process.
-	File m_traceJsonFile;
-	File m_countersCsvFile;
+	File m_traceFile;
+	String m_traceFilename;
 	Bool m_quit = false;
 
+	/// @name Owned by the thread
+	/// @{
+	TracerStatistics* m_statistics = nullptr;
+	File m_statisticsCsvFile;
+	U32 m_statisticsCsvPeriod = 0;
+
+	FlatHashMap<U64, U32> m_nameIndices; ///< Hash of a name to its index in the file.
+	U32 m_nameCount = 0;
+	DynamicArray<U8> m_writeBuffer;
+	/// @}
+
 	Error threadWorker();
 
-	Error writeEvents(ThreadWorkItem& item);
-	void gatherCounters(ThreadWorkItem& item);
-	Error writeCountersForReal();
+	void writeWorkItem(const ThreadWorkItem& item);
+	U32 getOrWriteName(CString name);
+};
+
+/// Converts the binary trace of the CoreTracer to a Chrome trace JSON and a CSV with the counters of every frame.
+class CoreTraceConverter
+{
+public:
+	CoreTraceConverter(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~CoreTraceConverter();
+
+	ANKI_USE_RESULT Error convert(CString traceFilename, CString jsonFilename, CString csvFilename);
+
+private:
+	class PerFrameCounters;
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+
+	DynamicArray<String> m_names; ///< All the names of the file.
+	DynamicArray<String> m_counterNames;
+	IntrusiveList<PerFrameCounters> m_frameCounters;
+
+	Error writeEvents(File& jsonFile, ThreadId tid, DynamicArrayAuto<TracerEvent>& events);
+	void gatherCounters(U64 frame, DynamicArrayAuto<TracerCounter>& counters);
+	Error writeCounters(File& csvFile);
 };
 /// @}
 
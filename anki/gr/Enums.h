@@ -490,6 +490,18 @@ enum class ShaderTypeBit : U16
 };
 ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(ShaderTypeBit)
 
+/// The GPU queues work can be submitted to.
+enum class GpuQueueType : U8
+{
+	GENERAL, ///< Graphics, compute and transfer.
+	ASYNC_COMPUTE, ///< Compute work that can overlap with the work of the GENERAL queue.
+
+	COUNT,
+	FIRST = 0,
+	LAST = COUNT - 1,
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(GpuQueueType)
+
 enum class ShaderVariableDataType : U8
 {
 	NONE,
@@ -9,6 +9,8 @@
 #include <anki/gr/Sampler.h>
 #include <anki/gr/Framebuffer.h>
 #include <anki/gr/CommandBuffer.h>
+#include <anki/gr/utils/AliasingAllocator.h>
+#include <anki/gr/utils/QueueScheduler.h>
 #include <anki/util/Tracer.h>
 #include <anki/util/BitSet.h>
 #include <anki/util/File.h>
@@ -25,14 +27,47 @@ static inline U32 getTextureSurfOrVolCount(const TexturePtr& tex)
 	return tex->getMipmapCount() * tex->getLayerCount() * (textureTypeIsCube(tex->getTextureType()) ? 6 : 1);
 }
 
+static inline U32 getTextureSurfOrVolCount(const TextureInitInfo& init)
+{
+	return init.m_mipmapCount * init.m_layerCount * (textureTypeIsCube(init.m_type) ? 6 : 1);
+}
+
+/// Estimate the memory of a texture.
+static PtrSize computeTextureMemorySize(const TextureInitInfo& init)
+{
+	const U32 faceCount = textureTypeIsCube(init.m_type) ? 6 : 1;
+	PtrSize size = 0;
+	for(U32 mip = 0; mip < init.m_mipmapCount; ++mip)
+	{
+		const U32 width = max(init.m_width >> mip, 1u);
+		const U32 height = max(init.m_height >> mip, 1u);
+		if(init.m_type == TextureType::_3D)
+		{
+			size += computeVolumeSize(width, height, max(init.m_depth >> mip, 1u), init.m_format);
+		}
+		else
+		{
+			size += computeSurfaceSize(width, height, init.m_format) * init.m_layerCount * faceCount;
+		}
+	}
+
+	return size * init.m_samples;
+}
+
 /// Contains some extra things for render targets.
 class RenderGraph::RT
 {
 public:
 	DynamicArray<TextureUsageBit> m_surfOrVolUsages;
-	DynamicArray<U16> m_lastBatchThatTransitionedIt;
+	DynamicArray<U16> m_lastBatchThatTransitionedIt; ///< The batch that needed the last transition.
+	DynamicArray<U16> m_lastBarrierBatch; ///< The batch that holds the last transition. It might have been hoisted.
+	DynamicArray<U16> m_lastBatchThatUsedIt;
 	TexturePtr m_texture; ///< Hold a reference.
+	TextureType m_textureType;
+	U32 m_layerCount;
+	U32 m_aliasedRtIdx = MAX_U32; ///< A previous RT of the frame that shares the same texture.
 	Bool m_imported;
+	Bool m_aliasedUsagesInherited = false;
 };
 
 /// Same as RT but for buffers.
@@ -57,13 +92,13 @@ public:
 	U32 m_idx;
 	TextureUsageBit m_usageBefore;
 	TextureUsageBit m_usageAfter;
-	TextureSurfaceInfo m_surface;
+	TextureSubresourceInfo m_subresource; ///< A single surface or, after merging, a range of surfaces.
 
 	TextureBarrier(U32 rtIdx, TextureUsageBit usageBefore, TextureUsageBit usageAfter, const TextureSurfaceInfo& surf)
 		: m_idx(rtIdx)
 		, m_usageBefore(usageBefore)
 		, m_usageAfter(usageAfter)
-		, m_surface(surf)
+		, m_subresource(surf)
 	{
 	}
 };
@@ -142,7 +177,12 @@ public:
 	DynamicArray<TextureBarrier> m_textureBarriersBefore;
 	DynamicArray<BufferBarrier> m_bufferBarriersBefore;
 	DynamicArray<ASBarrier> m_asBarriersBefore;
-	CommandBuffer* m_cmdb; ///< Someone else holds the ref already so have a ptr here.
+	CommandBuffer* m_cmdb = nullptr; ///< Someone else holds the ref already so have a ptr here.
+
+	GpuQueueType m_queue = GpuQueueType::GENERAL;
+	/// The batches of other queues this batch waits for. See QueueSchedulerBatch::m_waitBatches.
+	Array<U32, U32(GpuQueueType::COUNT)> m_waitBatches = {MAX_U32, MAX_U32};
+	Bool m_signal = false; ///< Batches of other queues wait for this one.
 };
 
 /// The RenderGraph build context.
@@ -151,7 +191,6 @@ class RenderGraph::BakeContext
 public:
 	StackAllocator<U8> m_alloc;
 	DynamicArray<Pass> m_passes;
-	BitSet<MAX_RENDER_GRAPH_PASSES, U64> m_passIsInBatch{false};
 	DynamicArray<Batch> m_batches;
 	DynamicArray<RT> m_rts;
 	DynamicArray<Buffer> m_buffers;
@@ -159,6 +198,8 @@ public:
 
 	DynamicArray<CommandBufferPtr> m_graphicsCmdbs;
 
+	U32 m_unoptimizedBarrierCount = 0; ///< The barriers that would have been set without the barrier optimizations.
+
 	Bool m_gatherStatistics = false;
 
 	BakeContext(const StackAllocator<U8>& alloc)
@@ -167,6 +208,59 @@ public:
 	}
 };
 
+/// The result of a graph compilation that outlives the frame. It's used to skip the compilation when the
+/// RenderGraphDescription has the same structure as in a previous frame. Everything is packed in flat arrays.
+class RenderGraph::BakedGraph
+{
+public:
+	/// Offsets to the packed arrays.
+	class BatchRange
+	{
+	public:
+		U32 m_firstPass;
+		U32 m_passCount;
+		U32 m_firstTextureBarrier;
+		U32 m_textureBarrierCount;
+		U32 m_firstBufferBarrier;
+		U32 m_bufferBarrierCount;
+		U32 m_firstAsBarrier;
+		U32 m_asBarrierCount;
+		Array<U32, U32(GpuQueueType::COUNT)> m_waitBatches;
+		GpuQueueType m_queue;
+		Bool m_signal;
+	};
+
+	DynamicArray<U32> m_dependsOn; ///< The dependencies of all passes.
+	DynamicArray<U32> m_dependsOnOffsets; ///< Offset of a pass' dependencies in m_dependsOn. Size is passCount + 1.
+
+	DynamicArray<BatchRange> m_batches;
+	DynamicArray<U32> m_passIndices;
+	DynamicArray<TextureBarrier> m_textureBarriers;
+	DynamicArray<BufferBarrier> m_bufferBarriers;
+	DynamicArray<ASBarrier> m_asBarriers;
+
+	DynamicArray<TextureUsageBit> m_rtFinalUsages; ///< The usages of all surfaces of all RTs after the last batch.
+	DynamicArray<BufferUsageBit> m_bufferFinalUsages;
+	DynamicArray<AccelerationStructureUsageBit> m_asFinalUsages;
+
+	U32 m_unoptimizedBarrierCount = 0;
+	U64 m_lastUsedVersion = 0;
+
+	void destroy(GrAllocator<U8> alloc)
+	{
+		m_dependsOn.destroy(alloc);
+		m_dependsOnOffsets.destroy(alloc);
+		m_batches.destroy(alloc);
+		m_passIndices.destroy(alloc);
+		m_textureBarriers.destroy(alloc);
+		m_bufferBarriers.destroy(alloc);
+		m_asBarriers.destroy(alloc);
+		m_rtFinalUsages.destroy(alloc);
+		m_bufferFinalUsages.destroy(alloc);
+		m_asFinalUsages.destroy(alloc);
+	}
+};
+
 void FramebufferDescription::bake()
 {
 	ANKI_ASSERT(m_hash == 0 && "Already baked");
@@ -263,6 +357,14 @@ RenderGraph::~RenderGraph()
 	}
 
 	m_importedRenderTargets.destroy(getAllocator());
+
+	for(BakedGraph* baked : m_bakedGraphCache)
+	{
+		baked->destroy(getAllocator());
+		getAllocator().deleteInstance(baked);
+	}
+
+	m_bakedGraphCache.destroy(getAllocator());
 }
 
 RenderGraph* RenderGraph::newInstance(GrManager* manager)
@@ -622,34 +724,6 @@ Bool RenderGraph::passADependsOnB(const RenderPassDescriptionBase& a, const Rend
 	return false;
 }
 
-Bool RenderGraph::passHasUnmetDependencies(const BakeContext& ctx, U32 passIdx)
-{
-	Bool depends = false;
-
-	if(ctx.m_batches.getSize() > 0)
-	{
-		// Check if the deps of passIdx are all in a batch
-
-		for(const U32 depPassIdx : ctx.m_passes[passIdx].m_dependsOn)
-		{
-			if(ctx.m_passIsInBatch.get(depPassIdx) == false)
-			{
-				// Dependency pass is not in a batch
-				depends = true;
-				break;
-			}
-		}
-	}
-	else
-	{
-		// First batch, check if passIdx depends on any pass
-
-		depends = ctx.m_passes[passIdx].m_dependsOn.getSize() != 0;
-	}
-
-	return depends;
-}
-
 RenderGraph::BakeContext* RenderGraph::newContext(const RenderGraphDescription& descr, StackAllocator<U8>& alloc)
 {
 	// Allocate
@@ -662,30 +736,21 @@ RenderGraph::BakeContext* RenderGraph::newContext(const RenderGraphDescription&
 		RT& outRt = ctx->m_rts[rtIdx];
 		const RenderGraphDescription::RT& inRt = descr.m_renderTargets[rtIdx];
 
+		// The non-imported RTs will get a texture after the batches are known because their memory can be aliased
 		const Bool imported = inRt.m_importedTex.isCreated();
+		ANKI_ASSERT(!(imported && m_compileOnly) && "Can't import when only compiling");
 		if(imported)
 		{
 			// It's imported
 			outRt.m_texture = inRt.m_importedTex;
 		}
-		else
-		{
-			// Need to create new
-
-			// Create a new TextureInitInfo with the derived usage
-			TextureInitInfo initInf = inRt.m_initInfo;
-			initInf.m_usage = inRt.m_usageDerivedByDeps;
-			ANKI_ASSERT(initInf.m_usage != TextureUsageBit::NONE);
 
-			// Create the new hash
-			const U64 hash = appendHash(&initInf.m_usage, sizeof(initInf.m_usage), inRt.m_hash);
-
-			// Get or create the texture
-			outRt.m_texture = getOrCreateRenderTarget(initInf, hash);
-		}
+		outRt.m_textureType = (imported) ? outRt.m_texture->getTextureType() : inRt.m_initInfo.m_type;
+		outRt.m_layerCount = (imported) ? outRt.m_texture->getLayerCount() : inRt.m_initInfo.m_layerCount;
 
 		// Init the usage
-		const U32 surfOrVolumeCount = getTextureSurfOrVolCount(outRt.m_texture);
+		const U32 surfOrVolumeCount =
+			(imported) ? getTextureSurfOrVolCount(outRt.m_texture) : getTextureSurfOrVolCount(inRt.m_initInfo);
 		outRt.m_surfOrVolUsages.create(alloc, surfOrVolumeCount, TextureUsageBit::NONE);
 		if(imported && inRt.m_importedAndUndefinedUsage)
 		{
@@ -714,10 +779,13 @@ RenderGraph::BakeContext* RenderGraph::newContext(const RenderGraphDescription&
 		}
 
 		outRt.m_lastBatchThatTransitionedIt.create(alloc, surfOrVolumeCount, MAX_U16);
+		outRt.m_lastBarrierBatch.create(alloc, surfOrVolumeCount, MAX_U16);
+		outRt.m_lastBatchThatUsedIt.create(alloc, surfOrVolumeCount, MAX_U16);
 		outRt.m_imported = imported;
 	}
 
 	// Buffers
+	ANKI_ASSERT(!(descr.m_buffers.getSize() && m_compileOnly) && "Can't import when only compiling");
 	ctx->m_buffers.create(alloc, descr.m_buffers.getSize());
 	for(U32 buffIdx = 0; buffIdx < ctx->m_buffers.getSize(); ++buffIdx)
 	{
@@ -740,7 +808,8 @@ RenderGraph::BakeContext* RenderGraph::newContext(const RenderGraphDescription&
 	return ctx;
 }
 
-void RenderGraph::initRenderPassesAndSetDeps(const RenderGraphDescription& descr, StackAllocator<U8>& alloc)
+void RenderGraph::initRenderPassesAndSetDeps(const RenderGraphDescription& descr, StackAllocator<U8>& alloc,
+											 const BakedGraph* baked)
 {
 	BakeContext& ctx = *m_ctx;
 	const U32 passCount = descr.m_passes.getSize();
@@ -768,109 +837,204 @@ void RenderGraph::initRenderPassesAndSetDeps(const RenderGraphDescription& descr
 			memcpy(&inf, &inDep.m_texture, sizeof(inf));
 		}
 
-		// Create command buffers and framebuffer
-		if(inPass.m_type == RenderPassDescriptionBase::Type::GRAPHICS)
+		if(baked)
 		{
-			const GraphicsRenderPassDescription& graphicsPass =
-				static_cast<const GraphicsRenderPassDescription&>(inPass);
-
-			if(graphicsPass.hasFramebuffer())
-			{
-				Bool drawsToPresentable;
-				outPass.fb() = getOrCreateFramebuffer(graphicsPass.m_fbDescr, &graphicsPass.m_rtHandles[0],
-													  inPass.m_name.cstr(), drawsToPresentable);
-
-				outPass.m_fbRenderArea = graphicsPass.m_fbRenderArea;
-				outPass.m_drawsToPresentable = drawsToPresentable;
-			}
-			else
+			// Dependencies are known, copy them
+			const U32 first = baked->m_dependsOnOffsets[passIdx];
+			const U32 count = baked->m_dependsOnOffsets[passIdx + 1] - first;
+			if(count)
 			{
-				ANKI_ASSERT(inPass.m_secondLevelCmdbsCount == 0 && "Can't have second level cmdbs");
+				outPass.m_dependsOn.create(alloc, count);
+				memcpy(&outPass.m_dependsOn[0], &baked->m_dependsOn[first], sizeof(U32) * count);
 			}
 		}
 		else
 		{
-			ANKI_ASSERT(inPass.m_secondLevelCmdbsCount == 0 && "Can't have second level cmdbs");
-		}
-
-		// Set dependencies by checking all previous subpasses.
-		U32 prevPassIdx = passIdx;
-		while(prevPassIdx--)
-		{
-			const RenderPassDescriptionBase& prevPass = *descr.m_passes[prevPassIdx];
-			if(passADependsOnB(inPass, prevPass))
+			// Set dependencies by checking all previous subpasses.
+			U32 prevPassIdx = passIdx;
+			while(prevPassIdx--)
 			{
-				outPass.m_dependsOn.emplaceBack(alloc, prevPassIdx);
+				const RenderPassDescriptionBase& prevPass = *descr.m_passes[prevPassIdx];
+				if(passADependsOnB(inPass, prevPass))
+				{
+					outPass.m_dependsOn.emplaceBack(alloc, prevPassIdx);
+				}
 			}
 		}
 	}
 }
 
-void RenderGraph::initBatches()
+void RenderGraph::initBatches(const RenderGraphDescription& descr, const BakedGraph* baked)
 {
 	ANKI_ASSERT(m_ctx);
-
-	U passesAssignedToBatchCount = 0;
-	const U passCount = m_ctx->m_passes.getSize();
+	BakeContext& ctx = *m_ctx;
+	const U32 passCount = ctx.m_passes.getSize();
 	ANKI_ASSERT(passCount > 0);
-	Bool setTimestamp = m_ctx->m_gatherStatistics;
-	while(passesAssignedToBatchCount < passCount)
+
+	if(baked)
+	{
+		// The batches are known, copy them
+		ctx.m_batches.create(ctx.m_alloc, baked->m_batches.getSize());
+		for(U32 batchIdx = 0; batchIdx < ctx.m_batches.getSize(); ++batchIdx)
+		{
+			const BakedGraph::BatchRange& range = baked->m_batches[batchIdx];
+			Batch& batch = ctx.m_batches[batchIdx];
+
+			batch.m_passIndices.create(ctx.m_alloc, range.m_passCount);
+			memcpy(&batch.m_passIndices[0], &baked->m_passIndices[range.m_firstPass], sizeof(U32) * range.m_passCount);
+			batch.m_queue = range.m_queue;
+			batch.m_waitBatches = range.m_waitBatches;
+			batch.m_signal = range.m_signal;
+		}
+	}
+	else
 	{
-		m_ctx->m_batches.emplaceBack(m_ctx->m_alloc);
-		Batch& batch = m_ctx->m_batches.getBack();
+		// Group the passes into batches and assign the batches to queues
+		QueueScheduler scheduler(ctx.m_alloc);
+		for(U32 passIdx = 0; passIdx < passCount; ++passIdx)
+		{
+			scheduler.newPass(descr.m_passes[passIdx]->m_queue, ConstWeakArray<U32>(ctx.m_passes[passIdx].m_dependsOn));
+		}
 
-		Bool drawsToPresentable = false;
+		scheduler.schedule();
 
-		for(U32 i = 0; i < passCount; ++i)
+		ConstWeakArray<QueueSchedulerBatch> inBatches = scheduler.getBatches();
+		ctx.m_batches.create(ctx.m_alloc, inBatches.getSize());
+		for(U32 batchIdx = 0; batchIdx < ctx.m_batches.getSize(); ++batchIdx)
 		{
-			if(!m_ctx->m_passIsInBatch.get(i) && !passHasUnmetDependencies(*m_ctx, i))
-			{
-				// Add to the batch
-				++passesAssignedToBatchCount;
-				batch.m_passIndices.emplaceBack(m_ctx->m_alloc, i);
+			const QueueSchedulerBatch& inBatch = inBatches[batchIdx];
+			Batch& batch = ctx.m_batches[batchIdx];
+
+			batch.m_passIndices.create(ctx.m_alloc, inBatch.m_passCount);
+			memcpy(&batch.m_passIndices[0], &scheduler.getBatchPassIndices()[inBatch.m_firstPass],
+				   sizeof(U32) * inBatch.m_passCount);
+			batch.m_queue = inBatch.m_queue;
+			batch.m_waitBatches = inBatch.m_waitBatches;
+			batch.m_signal = inBatch.m_signal;
+		}
+	}
+
+	for(U32 batchIdx = 0; batchIdx < ctx.m_batches.getSize(); ++batchIdx)
+	{
+		for(U32 passIdx : ctx.m_batches[batchIdx].m_passIndices)
+		{
+			ctx.m_passes[passIdx].m_batchIdx = batchIdx;
+		}
+	}
+}
+
+void RenderGraph::initRenderTargets(const RenderGraphDescription& descr)
+{
+	ANKI_TRACE_SCOPED_EVENT(GR_RENDER_GRAPH_ALIASING);
+	BakeContext& ctx = *m_ctx;
+	const U32 rtCount = descr.m_renderTargets.getSize();
 
-				// Will batch draw to the swapchain?
-				drawsToPresentable = drawsToPresentable || m_ctx->m_passes[i].m_drawsToPresentable;
+	// Find the lifetime of the render targets in batches. Also the last use in every queue
+	DynamicArrayAuto<U32> firstUses(ctx.m_alloc, rtCount, MAX_U32);
+	Array<U32, U32(GpuQueueType::COUNT)> noQueueUses;
+	for(U32& lastUse : noQueueUses)
+	{
+		lastUse = MAX_U32;
+	}
+	DynamicArrayAuto<Array<U32, U32(GpuQueueType::COUNT)>> queueLastUses(ctx.m_alloc, rtCount, noQueueUses);
+	QueueBatchTimeline timeline(ctx.m_alloc);
+	for(U32 batchIdx = 0; batchIdx < ctx.m_batches.getSize(); ++batchIdx)
+	{
+		const Batch& batch = ctx.m_batches[batchIdx];
+		timeline.newBatch(batch.m_queue, batch.m_waitBatches);
+
+		for(U32 passIdx : batch.m_passIndices)
+		{
+			for(const RenderPassDependency& dep : descr.m_passes[passIdx]->m_rtDeps)
+			{
+				const U32 rtIdx = dep.m_texture.m_handle.m_idx;
+				firstUses[rtIdx] = min(firstUses[rtIdx], batchIdx);
+				queueLastUses[rtIdx][batch.m_queue] = batchIdx;
 			}
 		}
+	}
 
-		// Get or create cmdb for the batch.
-		// Create a new cmdb if the batch is writing to swapchain. This will help Vulkan to have a dependency of the
-		// swap chain image acquire to the 2nd command buffer instead of adding it to a single big cmdb.
-		if(m_ctx->m_graphicsCmdbs.isEmpty() || drawsToPresentable)
+	// The batches of other queues overlap so a smaller batch index doesn't mean that the batch is done. Extend the
+	// lifetimes up to the batch that runs after all the uses in all queues
+	DynamicArrayAuto<U32> lastUses(ctx.m_alloc, rtCount, 0);
+	for(U32 rtIdx = 0; rtIdx < rtCount; ++rtIdx)
+	{
+		if(firstUses[rtIdx] != MAX_U32)
 		{
-			CommandBufferInitInfo cmdbInit;
-			cmdbInit.m_flags = CommandBufferFlag::COMPUTE_WORK | CommandBufferFlag::GRAPHICS_WORK;
-			CommandBufferPtr cmdb = getManager().newCommandBuffer(cmdbInit);
+			lastUses[rtIdx] = timeline.findLastOverlappingBatch(queueLastUses[rtIdx]);
+		}
+	}
 
-			m_ctx->m_graphicsCmdbs.emplaceBack(m_ctx->m_alloc, cmdb);
+	auto computeInitInfo = [&](U32 rtIdx, TextureInitInfo& initInf, U64& hash) {
+		const RenderGraphDescription::RT& inRt = descr.m_renderTargets[rtIdx];
 
-			batch.m_cmdb = cmdb.get();
+		// Create a new TextureInitInfo with the derived usage
+		initInf = inRt.m_initInfo;
+		initInf.m_usage = inRt.m_usageDerivedByDeps;
+		ANKI_ASSERT(initInf.m_usage != TextureUsageBit::NONE);
 
-			// Maybe write a timestamp
-			if(ANKI_UNLIKELY(setTimestamp))
-			{
-				setTimestamp = false;
-				TimestampQueryPtr query = getManager().newTimestampQuery();
-				cmdb->resetTimestampQuery(query);
-				cmdb->writeTimestamp(query);
+		// Create the new hash
+		hash = appendHash(&initInf.m_usage, sizeof(initInf.m_usage), inRt.m_hash);
+	};
 
-				m_statistics.m_nextTimestamp = (m_statistics.m_nextTimestamp + 1) % MAX_TIMESTAMPS_BUFFERED;
-				m_statistics.m_timestamps[m_statistics.m_nextTimestamp * 2] = query;
-			}
+	// Pack the non-imported RTs. Those with the same hash and non-overlapping lifetimes will share a texture
+	AliasingAllocator aliasing(ctx.m_alloc);
+	DynamicArrayAuto<U32> rtResources(ctx.m_alloc, rtCount, MAX_U32);
+	DynamicArrayAuto<U32> order(ctx.m_alloc);
+	for(U32 rtIdx = 0; rtIdx < rtCount; ++rtIdx)
+	{
+		if(ctx.m_rts[rtIdx].m_imported)
+		{
+			continue;
 		}
-		else
+
+		TextureInitInfo initInf;
+		U64 hash;
+		computeInitInfo(rtIdx, initInf, hash);
+
+		if(firstUses[rtIdx] == MAX_U32)
 		{
-			batch.m_cmdb = m_ctx->m_graphicsCmdbs.getBack().get();
+			// Not used by any pass
+			firstUses[rtIdx] = lastUses[rtIdx] = 0;
 		}
 
-		// Mark batch's passes done
-		for(U32 passIdx : m_ctx->m_batches.getBack().m_passIndices)
+		rtResources[rtIdx] =
+			aliasing.newResource(computeTextureMemorySize(initInf), hash, firstUses[rtIdx], lastUses[rtIdx]);
+		order.emplaceBack(rtIdx);
+	}
+
+	aliasing.pack();
+
+	// Get or create one texture per slot. Walk the RTs in the order they start living to know which RT was the
+	// previous user of a texture
+	std::sort(order.getBegin(), order.getEnd(), [&](U32 a, U32 b) { return firstUses[a] < firstUses[b]; });
+
+	const U32 slotCount = aliasing.getSlots().getSize();
+	DynamicArrayAuto<TexturePtr> slotTextures(ctx.m_alloc, slotCount);
+	DynamicArrayAuto<U32> slotLastRts(ctx.m_alloc, slotCount, MAX_U32);
+	for(U32 rtIdx : order)
+	{
+		RT& rt = ctx.m_rts[rtIdx];
+		const U32 slotIdx = aliasing.getResourceSlot(rtResources[rtIdx]);
+
+		if(slotLastRts[slotIdx] != MAX_U32)
+		{
+			rt.m_aliasedRtIdx = slotLastRts[slotIdx];
+		}
+		else if(!m_compileOnly)
 		{
-			m_ctx->m_passIsInBatch.set(passIdx);
-			m_ctx->m_passes[passIdx].m_batchIdx = m_ctx->m_batches.getSize() - 1;
+			TextureInitInfo initInf;
+			U64 hash;
+			computeInitInfo(rtIdx, initInf, hash);
+			slotTextures[slotIdx] = getOrCreateRenderTarget(initInf, hash);
 		}
+
+		rt.m_texture = slotTextures[slotIdx];
+		slotLastRts[slotIdx] = rtIdx;
 	}
+
+	m_statistics.m_transientMemoryBeforeAliasing = aliasing.getUnpackedSize();
+	m_statistics.m_transientMemoryAfterAliasing = aliasing.getPackedSize();
 }
 
 void RenderGraph::initGraphicsPasses(const RenderGraphDescription& descr, StackAllocator<U8>& alloc)
@@ -892,6 +1056,13 @@ void RenderGraph::initGraphicsPasses(const RenderGraphDescription& descr, StackA
 
 			if(graphicsPass.hasFramebuffer())
 			{
+				Bool drawsToPresentable;
+				outPass.fb() = getOrCreateFramebuffer(graphicsPass.m_fbDescr, &graphicsPass.m_rtHandles[0],
+													  inPass.m_name.cstr(), drawsToPresentable);
+
+				outPass.m_fbRenderArea = graphicsPass.m_fbRenderArea;
+				outPass.m_drawsToPresentable = drawsToPresentable;
+
 				// Init the usage bits
 				TextureUsageBit usage;
 				for(U i = 0; i < graphicsPass.m_fbDescr.m_colorAttachmentCount; ++i)
@@ -937,8 +1108,57 @@ void RenderGraph::initGraphicsPasses(const RenderGraphDescription& descr, StackA
 	}
 }
 
+void RenderGraph::initBatchCommandBuffers()
+{
+	ANKI_ASSERT(m_ctx);
+
+	// The backend exposes a single queue so the batches of all queues are recorded in the order the QueueScheduler
+	// returned them. This order satisfies the cross-queue waits without any semaphores
+
+	Bool setTimestamp = m_ctx->m_gatherStatistics;
+	for(Batch& batch : m_ctx->m_batches)
+	{
+		// Will batch draw to the swapchain?
+		Bool drawsToPresentable = false;
+		for(U32 passIdx : batch.m_passIndices)
+		{
+			drawsToPresentable = drawsToPresentable || m_ctx->m_passes[passIdx].m_drawsToPresentable;
+		}
+
+		// Get or create cmdb for the batch.
+		// Create a new cmdb if the batch is writing to swapchain. This will help Vulkan to have a dependency of the
+		// swap chain image acquire to the 2nd command buffer instead of adding it to a single big cmdb.
+		if(m_ctx->m_graphicsCmdbs.isEmpty() || drawsToPresentable)
+		{
+			CommandBufferInitInfo cmdbInit;
+			cmdbInit.m_flags = CommandBufferFlag::COMPUTE_WORK | CommandBufferFlag::GRAPHICS_WORK;
+			CommandBufferPtr cmdb = getManager().newCommandBuffer(cmdbInit);
+
+			m_ctx->m_graphicsCmdbs.emplaceBack(m_ctx->m_alloc, cmdb);
+
+			batch.m_cmdb = cmdb.get();
+
+			// Maybe write a timestamp
+			if(ANKI_UNLIKELY(setTimestamp))
+			{
+				setTimestamp = false;
+				TimestampQueryPtr query = getManager().newTimestampQuery();
+				cmdb->resetTimestampQuery(query);
+				cmdb->writeTimestamp(query);
+
+				m_statistics.m_nextTimestamp = (m_statistics.m_nextTimestamp + 1) % MAX_TIMESTAMPS_BUFFERED;
+				m_statistics.m_timestamps[m_statistics.m_nextTimestamp * 2] = query;
+			}
+		}
+		else
+		{
+			batch.m_cmdb = m_ctx->m_graphicsCmdbs.getBack().get();
+		}
+	}
+}
+
 template<typename TFunc>
-void RenderGraph::iterateSurfsOrVolumes(const TexturePtr& tex, const TextureSubresourceInfo& subresource, TFunc func)
+void RenderGraph::iterateSurfsOrVolumes(const RT& rt, const TextureSubresourceInfo& subresource, TFunc func)
 {
 	for(U32 mip = subresource.m_firstMipmap; mip < subresource.m_firstMipmap + subresource.m_mipmapCount; ++mip)
 	{
@@ -948,8 +1168,8 @@ void RenderGraph::iterateSurfsOrVolumes(const TexturePtr& tex, const TextureSubr
 				++face)
 			{
 				// Compute surf or vol idx
-				const U32 faceCount = textureTypeIsCube(tex->getTextureType()) ? 6 : 1;
-				const U32 idx = (faceCount * tex->getLayerCount()) * mip + faceCount * layer + face;
+				const U32 faceCount = textureTypeIsCube(rt.m_textureType) ? 6 : 1;
+				const U32 idx = (faceCount * rt.m_layerCount) * mip + faceCount * layer + face;
 				const TextureSurfaceInfo surf(mip, 0, face, layer);
 
 				if(!func(idx, surf))
@@ -961,6 +1181,56 @@ void RenderGraph::iterateSurfsOrVolumes(const TexturePtr& tex, const TextureSubr
 	}
 }
 
+/// Check if two read usages of a texture use the same layout, so they only differ in the pipeline stages.
+static Bool textureReadUsagesCompatible(TextureUsageBit a, TextureUsageBit b)
+{
+	const TextureUsageBit imageReads = TextureUsageBit::ALL_IMAGE & TextureUsageBit::ALL_READ;
+	const TextureUsageBit ab = a | b;
+	return !!a && !!b && (!(ab & ~TextureUsageBit::ALL_SAMPLED) || !(ab & ~imageReads));
+}
+
+RenderGraph::TextureBarrier* RenderGraph::findTextureBarrier(U32 batchIdx, U32 rtIdx, const TextureSurfaceInfo& surf)
+{
+	const TextureSubresourceInfo subresource(surf);
+	for(TextureBarrier& b : m_ctx->m_batches[batchIdx].m_textureBarriersBefore)
+	{
+		if(b.m_idx == rtIdx && b.m_subresource == subresource)
+		{
+			return &b;
+		}
+	}
+
+	return nullptr;
+}
+
+U32 RenderGraph::findEarliestBarrierBatch(U32 batchIdx, U32 lastUseBatchIdx) const
+{
+	const BakeContext& ctx = *m_ctx;
+	const GpuQueueType queue = ctx.m_batches[batchIdx].m_queue;
+
+	// Can't move before the last use or to a batch of another queue since there is no wait in-between
+	if(lastUseBatchIdx != MAX_U16 && ctx.m_batches[lastUseBatchIdx].m_queue != queue)
+	{
+		return batchIdx;
+	}
+
+	// Move it to the earliest batch that already has barriers to reduce the number of the sync points. Don't move it to
+	// another command buffer because the swapchain acquire waits on the command buffer that draws to the swapchain
+	const U32 firstLegalBatchIdx = (lastUseBatchIdx == MAX_U16) ? 0 : lastUseBatchIdx + 1;
+	for(U32 i = firstLegalBatchIdx; i < batchIdx; ++i)
+	{
+		const Batch& b = ctx.m_batches[i];
+		if(b.m_queue == queue && b.m_cmdb == ctx.m_batches[batchIdx].m_cmdb
+		   && (b.m_textureBarriersBefore.getSize() || b.m_bufferBarriersBefore.getSize()
+			   || b.m_asBarriersBefore.getSize()))
+		{
+			return i;
+		}
+	}
+
+	return batchIdx;
+}
+
 void RenderGraph::setTextureBarrier(Batch& batch, const RenderPassDependency& dep)
 {
 	ANKI_ASSERT(dep.m_type == RenderPassDependency::Type::TEXTURE);
@@ -971,45 +1241,234 @@ void RenderGraph::setTextureBarrier(Batch& batch, const RenderPassDependency& de
 	const TextureUsageBit depUsage = dep.m_texture.m_usage;
 	RT& rt = ctx.m_rts[rtIdx];
 
+	if(rt.m_aliasedRtIdx != MAX_U32 && !rt.m_aliasedUsagesInherited)
+	{
+		// The texture was used by another RT earlier in the frame. Continue from the state that RT left it
+		const RT& prevRt = ctx.m_rts[rt.m_aliasedRtIdx];
+		ANKI_ASSERT(prevRt.m_surfOrVolUsages.getSize() == rt.m_surfOrVolUsages.getSize());
+		memcpy(rt.m_surfOrVolUsages.getBegin(), prevRt.m_surfOrVolUsages.getBegin(),
+			   rt.m_surfOrVolUsages.getSizeInBytes());
+		memcpy(rt.m_lastBarrierBatch.getBegin(), prevRt.m_lastBarrierBatch.getBegin(),
+			   rt.m_lastBarrierBatch.getSizeInBytes());
+		memcpy(rt.m_lastBatchThatUsedIt.getBegin(), prevRt.m_lastBatchThatUsedIt.getBegin(),
+			   rt.m_lastBatchThatUsedIt.getSizeInBytes());
+		rt.m_aliasedUsagesInherited = true;
+	}
+
 	iterateSurfsOrVolumes(
-		rt.m_texture, dep.m_texture.m_subresource, [&](U32 surfOrVolIdx, const TextureSurfaceInfo& surf) {
+		rt, dep.m_texture.m_subresource, [&](U32 surfOrVolIdx, const TextureSurfaceInfo& surf) {
 			TextureUsageBit& crntUsage = rt.m_surfOrVolUsages[surfOrVolIdx];
-			if(crntUsage != depUsage)
+			const U16 lastUseBatchIdx = rt.m_lastBatchThatUsedIt[surfOrVolIdx];
+			rt.m_lastBatchThatUsedIt[surfOrVolIdx] = U16(batchIdx);
+
+			if(crntUsage == depUsage)
+			{
+				return true;
+			}
+
+			// Check if we can merge barriers
+			if(rt.m_lastBatchThatTransitionedIt[surfOrVolIdx] == batchIdx)
+			{
+				// Will merge the barriers
+
+				crntUsage |= depUsage;
+
+				TextureBarrier* b = findTextureBarrier(rt.m_lastBarrierBatch[surfOrVolIdx], rtIdx, surf);
+				ANKI_ASSERT(b);
+				b->m_usageAfter |= depUsage;
+				return true;
+			}
+
+			++ctx.m_unoptimizedBarrierCount;
+
+			if(textureReadUsagesCompatible(crntUsage, depUsage))
 			{
-				// Check if we can merge barriers
-				if(rt.m_lastBatchThatTransitionedIt[surfOrVolIdx] == batchIdx)
+				// Read to read transition
+
+				if(!(depUsage & ~crntUsage))
 				{
-					// Will merge the barriers
+					// The last transition already covers this usage, skip it
+					return true;
+				}
 
+				// Try to extend the last transition to the stages of this usage. Nothing wrote to the surface since
+				TextureBarrier* b = nullptr;
+				const U16 lastBarrierBatchIdx = rt.m_lastBarrierBatch[surfOrVolIdx];
+				if(lastBarrierBatchIdx != MAX_U16 && ctx.m_batches[lastBarrierBatchIdx].m_queue == batch.m_queue)
+				{
+					b = findTextureBarrier(lastBarrierBatchIdx, rtIdx, surf);
+				}
+
+				if(b)
+				{
+					ANKI_ASSERT(b->m_usageAfter == crntUsage);
+					b->m_usageAfter |= depUsage;
 					crntUsage |= depUsage;
+					return true;
+				}
+			}
 
-					Bool found = false;
-					for(TextureBarrier& b : batch.m_textureBarriersBefore)
-					{
-						if(b.m_idx == rtIdx && b.m_surface == surf)
-						{
-							b.m_usageAfter |= depUsage;
-							found = true;
-							break;
-						}
-					}
+			// Create a new barrier for this surface. Mipmap generation transitions the surfaces internally so don't
+			// move those
+			const U32 barrierBatchIdx = (!!((crntUsage | depUsage) & TextureUsageBit::GENERATE_MIPMAPS))
+											? batchIdx
+											: findEarliestBarrierBatch(batchIdx, lastUseBatchIdx);
+
+			ctx.m_batches[barrierBatchIdx].m_textureBarriersBefore.emplaceBack(ctx.m_alloc, rtIdx, crntUsage,
+																				depUsage, surf);
+
+			crntUsage = depUsage;
+			rt.m_lastBatchThatTransitionedIt[surfOrVolIdx] = U16(batchIdx);
+			rt.m_lastBarrierBatch[surfOrVolIdx] = U16(barrierBatchIdx);
+
+			return true;
+		});
+}
+
+void RenderGraph::mergeTextureBarriers(Batch& batch)
+{
+	DynamicArray<TextureBarrier>& barriers = batch.m_textureBarriersBefore;
+	if(barriers.getSize() < 2)
+	{
+		return;
+	}
+
+	// Merge barriers of the same RT and the same usages that are adjacent in one dimension (mips, then faces, then
+	// layers) and identical in the other two
+	enum class Dim : U8
+	{
+		MIP,
+		FACE,
+		LAYER
+	};
+
+	auto getRange = [](const TextureSubresourceInfo& sub, Dim dim, U32& first, U32& count) {
+		switch(dim)
+		{
+		case Dim::MIP:
+			first = sub.m_firstMipmap;
+			count = sub.m_mipmapCount;
+			break;
+		case Dim::FACE:
+			first = sub.m_firstFace;
+			count = sub.m_faceCount;
+			break;
+		default:
+			first = sub.m_firstLayer;
+			count = sub.m_layerCount;
+		}
+	};
+
+	auto mergeDimension = [&](Dim dim) {
+		// Sort so that the barriers that can be merged are next to each other
+		std::sort(barriers.getBegin(), barriers.getEnd(), [&](const TextureBarrier& a, const TextureBarrier& b) {
+			if(a.m_idx != b.m_idx)
+			{
+				return a.m_idx < b.m_idx;
+			}
+
+			if(a.m_usageBefore != b.m_usageBefore)
+			{
+				return a.m_usageBefore < b.m_usageBefore;
+			}
+
+			if(a.m_usageAfter != b.m_usageAfter)
+			{
+				return a.m_usageAfter < b.m_usageAfter;
+			}
+
+			// Compare the other dimensions first and the merged one last
+			TextureSubresourceInfo suba = a.m_subresource;
+			TextureSubresourceInfo subb = b.m_subresource;
+			U32 firsta, counta, firstb, countb;
+			getRange(suba, dim, firsta, counta);
+			getRange(subb, dim, firstb, countb);
+			const Array<U32, 6> keya = {suba.m_firstMipmap, suba.m_mipmapCount, suba.m_firstLayer, suba.m_layerCount,
+										U32(suba.m_firstFace) << 8u | suba.m_faceCount, firsta};
+			const Array<U32, 6> keyb = {subb.m_firstMipmap, subb.m_mipmapCount, subb.m_firstLayer, subb.m_layerCount,
+										U32(subb.m_firstFace) << 8u | subb.m_faceCount, firstb};
+			for(U32 i = 0; i < keya.getSize(); ++i)
+			{
+				const U32 skip = (dim == Dim::MIP) ? 0 : ((dim == Dim::LAYER) ? 2 : 4);
+				if(i == skip || i == skip + 1)
+				{
+					// That's the merged dimension
+					continue;
+				}
 
-					(void)found;
-					ANKI_ASSERT(found);
+				if(keya[i] != keyb[i])
+				{
+					return keya[i] < keyb[i];
 				}
-				else
+			}
+
+			return firsta < firstb;
+		});
+
+		U32 outCount = 1;
+		for(U32 i = 1; i < barriers.getSize(); ++i)
+		{
+			TextureBarrier& prev = barriers[outCount - 1];
+			const TextureBarrier& crnt = barriers[i];
+
+			Bool canMerge = prev.m_idx == crnt.m_idx && prev.m_usageBefore == crnt.m_usageBefore
+							&& prev.m_usageAfter == crnt.m_usageAfter
+							&& !((prev.m_usageBefore | prev.m_usageAfter) & TextureUsageBit::GENERATE_MIPMAPS);
+
+			U32 prevFirst, prevCount, crntFirst, crntCount;
+			getRange(prev.m_subresource, dim, prevFirst, prevCount);
+			getRange(crnt.m_subresource, dim, crntFirst, crntCount);
+			canMerge = canMerge && prevFirst + prevCount == crntFirst;
+
+			// The other dimensions should be identical
+			if(canMerge)
+			{
+				TextureSubresourceInfo a = prev.m_subresource;
+				TextureSubresourceInfo b = crnt.m_subresource;
+				switch(dim)
 				{
-					// Create a new barrier for this surface
+				case Dim::MIP:
+					a.m_mipmapCount = b.m_mipmapCount;
+					a.m_firstMipmap = b.m_firstMipmap;
+					break;
+				case Dim::FACE:
+					a.m_faceCount = b.m_faceCount;
+					a.m_firstFace = b.m_firstFace;
+					break;
+				default:
+					a.m_layerCount = b.m_layerCount;
+					a.m_firstLayer = b.m_firstLayer;
+				}
 
-					batch.m_textureBarriersBefore.emplaceBack(ctx.m_alloc, rtIdx, crntUsage, depUsage, surf);
+				canMerge = a == b;
+			}
 
-					crntUsage = depUsage;
-					rt.m_lastBatchThatTransitionedIt[surfOrVolIdx] = U16(batchIdx);
+			if(canMerge)
+			{
+				switch(dim)
+				{
+				case Dim::MIP:
+					prev.m_subresource.m_mipmapCount += crntCount;
+					break;
+				case Dim::FACE:
+					prev.m_subresource.m_faceCount = U8(prev.m_subresource.m_faceCount + crntCount);
+					break;
+				default:
+					prev.m_subresource.m_layerCount += crntCount;
 				}
 			}
+			else
+			{
+				barriers[outCount++] = crnt;
+			}
+		}
 
-			return true;
-		});
+		barriers.resizeStorage(m_ctx->m_alloc, outCount);
+	};
+
+	mergeDimension(Dim::MIP);
+	mergeDimension(Dim::FACE);
+	mergeDimension(Dim::LAYER);
 }
 
 void RenderGraph::setBatchBarriers(const RenderGraphDescription& descr)
@@ -1048,6 +1507,17 @@ void RenderGraph::setBatchBarriers(const RenderGraphDescription& descr)
 
 				const Bool buffHasBarrier = buffHasBarrierMask.get(buffIdx);
 
+				if(!buffHasBarrier)
+				{
+					++ctx.m_unoptimizedBarrierCount;
+				}
+
+				if(!buffHasBarrier && !(crntUsage & ~BufferUsageBit::ALL_READ) && !(depUsage & ~crntUsage))
+				{
+					// Read to read and the previous barrier already covers this usage
+					continue;
+				}
+
 				if(!buffHasBarrier)
 				{
 					// Buff hasn't had a barrier in this batch, add a new barrier
@@ -1091,6 +1561,18 @@ void RenderGraph::setBatchBarriers(const RenderGraphDescription& descr)
 				}
 
 				const Bool asHasBarrierInThisBatch = asHasBarrierMask.get(asIdx);
+
+				if(!asHasBarrierInThisBatch)
+				{
+					++ctx.m_unoptimizedBarrierCount;
+				}
+
+				if(!asHasBarrierInThisBatch && !(crntUsage & ~AccelerationStructureUsageBit::ALL_READ)
+				   && !(depUsage & ~crntUsage))
+				{
+					// Read to read and the previous barrier already covers this usage
+					continue;
+				}
 				if(!asHasBarrierInThisBatch)
 				{
 					// AS doesn't have a barrier in this batch, create a new one
@@ -1122,37 +1604,7 @@ void RenderGraph::setBatchBarriers(const RenderGraphDescription& descr)
 		} // For all passes
 
 #if ANKI_DBG_RENDER_GRAPH
-		// Sort the barriers to ease the dumped graph
-		std::sort(batch.m_textureBarriersBefore.getBegin(), batch.m_textureBarriersBefore.getEnd(),
-				  [&](const TextureBarrier& a, const TextureBarrier& b) {
-					  const U aidx = a.m_idx;
-					  const U bidx = b.m_idx;
-
-					  if(aidx == bidx)
-					  {
-						  if(a.m_surface.m_level != b.m_surface.m_level)
-						  {
-							  return a.m_surface.m_level < b.m_surface.m_level;
-						  }
-						  else if(a.m_surface.m_face != b.m_surface.m_face)
-						  {
-							  return a.m_surface.m_face < b.m_surface.m_face;
-						  }
-						  else if(a.m_surface.m_layer != b.m_surface.m_layer)
-						  {
-							  return a.m_surface.m_layer < b.m_surface.m_layer;
-						  }
-						  else
-						  {
-							  return false;
-						  }
-					  }
-					  else
-					  {
-						  return aidx < bidx;
-					  }
-				  });
-
+		// Sort the barriers to ease the dumped graph. The texture barriers will be sorted when they are merged
 		std::sort(batch.m_bufferBarriersBefore.getBegin(), batch.m_bufferBarriersBefore.getEnd(),
 				  [&](const BufferBarrier& a, const BufferBarrier& b) { return a.m_idx < b.m_idx; });
 
@@ -1160,6 +1612,12 @@ void RenderGraph::setBatchBarriers(const RenderGraphDescription& descr)
 				  [&](const ASBarrier& a, const ASBarrier& b) { return a.m_idx < b.m_idx; });
 #endif
 	} // For all batches
+
+	// Now that no more barriers will be hoisted to previous batches merge the texture barriers to ranges
+	for(Batch& batch : ctx.m_batches)
+	{
+		mergeTextureBarriers(batch);
+	}
 }
 
 void RenderGraph::compileNewGraph(const RenderGraphDescription& descr, StackAllocator<U8>& alloc)
@@ -1170,17 +1628,66 @@ void RenderGraph::compileNewGraph(const RenderGraphDescription& descr, StackAllo
 	BakeContext& ctx = *newContext(descr, alloc);
 	m_ctx = &ctx;
 
+	// Try to find a compiled graph with the same structure. If found only the GR objects need patching
+	const BakedGraph* baked = nullptr;
+	U64 hash = 0;
+	if(m_bakedGraphCacheEnabled)
+	{
+		hash = computeDescriptionHash(descr);
+
+		auto it = m_bakedGraphCache.find(hash);
+		if(it != m_bakedGraphCache.getEnd())
+		{
+			(*it)->m_lastUsedVersion = m_version;
+			baked = *it;
+			ANKI_TRACE_INC_COUNTER(GR_RENDER_GRAPH_CACHE_HITS, 1);
+		}
+	}
+
 	// Init the passes and find the dependencies between passes
-	initRenderPassesAndSetDeps(descr, alloc);
+	initRenderPassesAndSetDeps(descr, alloc, baked);
 
-	// Walk the graph and create pass batches
-	initBatches();
+	// Walk the graph, create pass batches and assign them to queues
+	initBatches(descr, baked);
 
-	// Now that we know the batches every pass belongs init the graphics passes
-	initGraphicsPasses(descr, alloc);
+	// Now that the lifetimes of the render targets are known create their textures
+	initRenderTargets(descr);
+
+	if(!m_compileOnly)
+	{
+		// Now that we know the batches every pass belongs init the graphics passes
+		initGraphicsPasses(descr, alloc);
+
+		// Create the command buffers of the batches
+		initBatchCommandBuffers();
+	}
 
 	// Create barriers between batches
-	setBatchBarriers(descr);
+	if(baked)
+	{
+		restoreBatchBarriers(*baked);
+	}
+	else
+	{
+		setBatchBarriers(descr);
+
+		if(m_bakedGraphCacheEnabled)
+		{
+			storeBakedGraph(hash);
+		}
+	}
+
+	// Barrier statistics
+	m_statistics.m_textureBarrierCount = 0;
+	m_statistics.m_bufferBarrierCount = 0;
+	m_statistics.m_asBarrierCount = 0;
+	for(const Batch& batch : ctx.m_batches)
+	{
+		m_statistics.m_textureBarrierCount += batch.m_textureBarriersBefore.getSize();
+		m_statistics.m_bufferBarrierCount += batch.m_bufferBarriersBefore.getSize();
+		m_statistics.m_asBarrierCount += batch.m_asBarriersBefore.getSize();
+	}
+	m_statistics.m_unoptimizedBarrierCount = ctx.m_unoptimizedBarrierCount;
 
 #if ANKI_DBG_RENDER_GRAPH
 	if(dumpDependencyDotFile(descr, ctx, "./"))
@@ -1190,6 +1697,249 @@ void RenderGraph::compileNewGraph(const RenderGraphDescription& descr, StackAllo
 #endif
 }
 
+U64 RenderGraph::computeDescriptionHash(const RenderGraphDescription& descr) const
+{
+	ANKI_TRACE_SCOPED_EVENT(GR_RENDER_GRAPH_HASH);
+
+	const Array<U32, 3> counts = {descr.m_passes.getSize(), descr.m_renderTargets.getSize(),
+								  descr.m_buffers.getSize()};
+	U64 hash = computeHash(&counts[0], sizeof(counts));
+
+	// Render targets. Don't hash the textures themselves, only what affects their initial usage and the subresources
+	for(const RenderGraphDescription::RT& rt : descr.m_renderTargets)
+	{
+		if(rt.m_importedTex.isCreated())
+		{
+			// The PRESENT usage of the texture splits the command buffers so hash all the usages of the texture
+			const TexturePtr& tex = rt.m_importedTex;
+			const Array<U32, 6> info = {U32(tex->getTextureType()), tex->getMipmapCount(), tex->getLayerCount(),
+										U32(rt.m_importedLastKnownUsage), rt.m_importedAndUndefinedUsage,
+										U32(tex->getTextureUsage())};
+			hash = appendHash(&info[0], sizeof(info), hash);
+
+			if(rt.m_importedAndUndefinedUsage)
+			{
+				// The initial usage comes from the previous frame
+				const U64 uuid = tex->getUuid();
+				auto it = m_importedRenderTargets.find(computeHash(&uuid, sizeof(uuid)));
+				if(it != m_importedRenderTargets.getEnd())
+				{
+					hash = appendHash(it->m_surfOrVolLastUsages.getBegin(),
+									  it->m_surfOrVolLastUsages.getSizeInBytes(), hash);
+				}
+			}
+		}
+		else
+		{
+			const Array<U64, 2> info = {rt.m_hash, U64(rt.m_usageDerivedByDeps)};
+			hash = appendHash(&info[0], sizeof(info), hash);
+		}
+	}
+
+	// Buffers and AS
+	for(const RenderGraphDescription::Buffer& buff : descr.m_buffers)
+	{
+		hash = appendHash(&buff.m_usage, sizeof(buff.m_usage), hash);
+	}
+
+	for(const RenderGraphDescription::AS& as : descr.m_as)
+	{
+		hash = appendHash(&as.m_usage, sizeof(as.m_usage), hash);
+	}
+
+	// Passes
+	for(const RenderPassDescriptionBase* pass : descr.m_passes)
+	{
+		const Array<U32, 5> info = {U32(pass->m_type), pass->m_rtDeps.getSize(), pass->m_buffDeps.getSize(),
+									pass->m_asDeps.getSize(), U32(pass->m_queue)};
+		hash = appendHash(&info[0], sizeof(info), hash);
+
+		if(pass->m_type == RenderPassDescriptionBase::Type::GRAPHICS)
+		{
+			const GraphicsRenderPassDescription& graphicsPass =
+				static_cast<const GraphicsRenderPassDescription&>(*pass);
+			hash = appendHash(&graphicsPass.m_fbDescr.m_hash, sizeof(graphicsPass.m_fbDescr.m_hash), hash);
+			hash = appendHash(&graphicsPass.m_rtHandles[0], sizeof(graphicsPass.m_rtHandles), hash);
+		}
+
+		static_assert(sizeof(RenderPassDependency::TextureInfo)
+						  == sizeof(U32) * 2 + sizeof(TextureSubresourceInfo),
+					  "Shouldn't have padding");
+		for(const RenderPassDependency& dep : pass->m_rtDeps)
+		{
+			hash = appendHash(&dep.m_texture, sizeof(dep.m_texture), hash);
+		}
+
+		for(const RenderPassDependency& dep : pass->m_buffDeps)
+		{
+			const Array<U64, 2> info = {dep.m_buffer.m_handle.m_idx, U64(dep.m_buffer.m_usage)};
+			hash = appendHash(&info[0], sizeof(info), hash);
+		}
+
+		for(const RenderPassDependency& dep : pass->m_asDeps)
+		{
+			const Array<U32, 2> info = {dep.m_as.m_handle.m_idx, U32(dep.m_as.m_usage)};
+			hash = appendHash(&info[0], sizeof(info), hash);
+		}
+	}
+
+	return hash;
+}
+
+void RenderGraph::storeBakedGraph(U64 hash)
+{
+	ANKI_ASSERT(m_ctx);
+	const BakeContext& ctx = *m_ctx;
+	GrAllocator<U8> alloc = getAllocator();
+
+	BakedGraph* baked = alloc.newInstance<BakedGraph>();
+	baked->m_lastUsedVersion = m_version;
+	baked->m_unoptimizedBarrierCount = ctx.m_unoptimizedBarrierCount;
+
+	// Dependencies
+	U32 dependsOnCount = 0;
+	for(const Pass& pass : ctx.m_passes)
+	{
+		dependsOnCount += pass.m_dependsOn.getSize();
+	}
+
+	baked->m_dependsOnOffsets.create(alloc, ctx.m_passes.getSize() + 1);
+	baked->m_dependsOn.resizeStorage(alloc, dependsOnCount);
+	for(U32 passIdx = 0; passIdx < ctx.m_passes.getSize(); ++passIdx)
+	{
+		baked->m_dependsOnOffsets[passIdx] = baked->m_dependsOn.getSize();
+		for(U32 depPassIdx : ctx.m_passes[passIdx].m_dependsOn)
+		{
+			baked->m_dependsOn.emplaceBack(alloc, depPassIdx);
+		}
+	}
+	baked->m_dependsOnOffsets[ctx.m_passes.getSize()] = baked->m_dependsOn.getSize();
+
+	// Batches and barriers
+	baked->m_batches.create(alloc, ctx.m_batches.getSize());
+	baked->m_passIndices.resizeStorage(alloc, ctx.m_passes.getSize());
+	for(U32 batchIdx = 0; batchIdx < ctx.m_batches.getSize(); ++batchIdx)
+	{
+		const Batch& inBatch = ctx.m_batches[batchIdx];
+		BakedGraph::BatchRange& range = baked->m_batches[batchIdx];
+
+		range.m_firstPass = baked->m_passIndices.getSize();
+		range.m_passCount = inBatch.m_passIndices.getSize();
+		range.m_waitBatches = inBatch.m_waitBatches;
+		range.m_queue = inBatch.m_queue;
+		range.m_signal = inBatch.m_signal;
+		for(U32 passIdx : inBatch.m_passIndices)
+		{
+			baked->m_passIndices.emplaceBack(alloc, passIdx);
+		}
+
+		range.m_firstTextureBarrier = baked->m_textureBarriers.getSize();
+		range.m_textureBarrierCount = inBatch.m_textureBarriersBefore.getSize();
+		for(const TextureBarrier& barrier : inBatch.m_textureBarriersBefore)
+		{
+			baked->m_textureBarriers.emplaceBack(alloc, barrier);
+		}
+
+		range.m_firstBufferBarrier = baked->m_bufferBarriers.getSize();
+		range.m_bufferBarrierCount = inBatch.m_bufferBarriersBefore.getSize();
+		for(const BufferBarrier& barrier : inBatch.m_bufferBarriersBefore)
+		{
+			baked->m_bufferBarriers.emplaceBack(alloc, barrier);
+		}
+
+		range.m_firstAsBarrier = baked->m_asBarriers.getSize();
+		range.m_asBarrierCount = inBatch.m_asBarriersBefore.getSize();
+		for(const ASBarrier& barrier : inBatch.m_asBarriersBefore)
+		{
+			baked->m_asBarriers.emplaceBack(alloc, barrier);
+		}
+	}
+
+	// Final usages
+	for(const RT& rt : ctx.m_rts)
+	{
+		for(TextureUsageBit usage : rt.m_surfOrVolUsages)
+		{
+			baked->m_rtFinalUsages.emplaceBack(alloc, usage);
+		}
+	}
+
+	if(ctx.m_buffers.getSize())
+	{
+		baked->m_bufferFinalUsages.create(alloc, ctx.m_buffers.getSize());
+		for(U32 i = 0; i < ctx.m_buffers.getSize(); ++i)
+		{
+			baked->m_bufferFinalUsages[i] = ctx.m_buffers[i].m_usage;
+		}
+	}
+
+	if(ctx.m_as.getSize())
+	{
+		baked->m_asFinalUsages.create(alloc, ctx.m_as.getSize());
+		for(U32 i = 0; i < ctx.m_as.getSize(); ++i)
+		{
+			baked->m_asFinalUsages[i] = ctx.m_as[i].m_usage;
+		}
+	}
+
+	m_bakedGraphCache.emplace(alloc, hash, baked);
+}
+
+void RenderGraph::restoreBatchBarriers(const BakedGraph& baked)
+{
+	ANKI_ASSERT(m_ctx);
+	BakeContext& ctx = *m_ctx;
+	ANKI_ASSERT(ctx.m_batches.getSize() == baked.m_batches.getSize());
+
+	ctx.m_unoptimizedBarrierCount = baked.m_unoptimizedBarrierCount;
+
+	for(U32 batchIdx = 0; batchIdx < ctx.m_batches.getSize(); ++batchIdx)
+	{
+		Batch& outBatch = ctx.m_batches[batchIdx];
+		const BakedGraph::BatchRange& range = baked.m_batches[batchIdx];
+
+		outBatch.m_textureBarriersBefore.resizeStorage(ctx.m_alloc, range.m_textureBarrierCount);
+		for(U32 i = 0; i < range.m_textureBarrierCount; ++i)
+		{
+			outBatch.m_textureBarriersBefore.emplaceBack(ctx.m_alloc,
+														 baked.m_textureBarriers[range.m_firstTextureBarrier + i]);
+		}
+
+		outBatch.m_bufferBarriersBefore.resizeStorage(ctx.m_alloc, range.m_bufferBarrierCount);
+		for(U32 i = 0; i < range.m_bufferBarrierCount; ++i)
+		{
+			outBatch.m_bufferBarriersBefore.emplaceBack(ctx.m_alloc,
+														baked.m_bufferBarriers[range.m_firstBufferBarrier + i]);
+		}
+
+		outBatch.m_asBarriersBefore.resizeStorage(ctx.m_alloc, range.m_asBarrierCount);
+		for(U32 i = 0; i < range.m_asBarrierCount; ++i)
+		{
+			outBatch.m_asBarriersBefore.emplaceBack(ctx.m_alloc, baked.m_asBarriers[range.m_firstAsBarrier + i]);
+		}
+	}
+
+	// Set the usages the resources will have after the graph runs
+	U32 surfOrVolOffset = 0;
+	for(RT& rt : ctx.m_rts)
+	{
+		ANKI_ASSERT(surfOrVolOffset + rt.m_surfOrVolUsages.getSize() <= baked.m_rtFinalUsages.getSize());
+		memcpy(rt.m_surfOrVolUsages.getBegin(), &baked.m_rtFinalUsages[surfOrVolOffset],
+			   rt.m_surfOrVolUsages.getSizeInBytes());
+		surfOrVolOffset += rt.m_surfOrVolUsages.getSize();
+	}
+
+	for(U32 i = 0; i < ctx.m_buffers.getSize(); ++i)
+	{
+		ctx.m_buffers[i].m_usage = baked.m_bufferFinalUsages[i];
+	}
+
+	for(U32 i = 0; i < ctx.m_as.getSize(); ++i)
+	{
+		ctx.m_as[i].m_usage = baked.m_asFinalUsages[i];
+	}
+}
+
 TexturePtr RenderGraph::getTexture(RenderTargetHandle handle) const
 {
 	ANKI_ASSERT(m_ctx->m_rts[handle.m_idx].m_texture.isCreated());
@@ -1212,6 +1962,7 @@ void RenderGraph::runSecondLevel(U32 threadIdx)
 {
 	ANKI_TRACE_SCOPED_EVENT(GR_RENDER_GRAPH_2ND_LEVEL);
 	ANKI_ASSERT(m_ctx);
+	ANKI_ASSERT(!m_compileOnly && "The graph was only compiled");
 
 	RenderPassWorkContext ctx;
 	ctx.m_rgraph = this;
@@ -1247,6 +1998,7 @@ void RenderGraph::run() const
 {
 	ANKI_TRACE_SCOPED_EVENT(GR_RENDER_GRAPH_RUN);
 	ANKI_ASSERT(m_ctx);
+	ANKI_ASSERT(!m_compileOnly && "The graph was only compiled");
 
 	RenderPassWorkContext ctx;
 	ctx.m_rgraph = this;
@@ -1261,8 +2013,20 @@ void RenderGraph::run() const
 		// Set the barriers
 		for(const TextureBarrier& barrier : batch.m_textureBarriersBefore)
 		{
-			cmdb->setTextureSurfaceBarrier(m_ctx->m_rts[barrier.m_idx].m_texture, barrier.m_usageBefore,
-										   barrier.m_usageAfter, barrier.m_surface);
+			const TexturePtr& tex = m_ctx->m_rts[barrier.m_idx].m_texture;
+			const TextureSubresourceInfo& sub = barrier.m_subresource;
+			if(sub.m_mipmapCount == 1 && sub.m_layerCount == 1 && sub.m_faceCount == 1)
+			{
+				cmdb->setTextureSurfaceBarrier(tex, barrier.m_usageBefore, barrier.m_usageAfter,
+											   TextureSurfaceInfo(sub.m_firstMipmap, 0, sub.m_firstFace,
+																  sub.m_firstLayer));
+			}
+			else
+			{
+				TextureSubresourceInfo range = sub;
+				range.m_depthStencilAspect = tex->getDepthStencilAspect();
+				cmdb->setTextureBarrier(tex, barrier.m_usageBefore, barrier.m_usageAfter, range);
+			}
 		}
 		for(const BufferBarrier& barrier : batch.m_bufferBarriersBefore)
 		{
@@ -1389,10 +2153,43 @@ void RenderGraph::periodicCleanup()
 	{
 		ANKI_GR_LOGI("Cleaned %u render targets", rtsCleanedCount);
 	}
+
+	// Remove the compiled graphs that weren't used recently
+	U32 bakedGraphsCleanedCount = 0;
+	Bool erased;
+	do
+	{
+		erased = false;
+		for(auto it = m_bakedGraphCache.getBegin(); it != m_bakedGraphCache.getEnd(); ++it)
+		{
+			BakedGraph* baked = *it;
+			if(m_version - baked->m_lastUsedVersion >= PERIODIC_CLEANUP_EVERY)
+			{
+				baked->destroy(getAllocator());
+				getAllocator().deleteInstance(baked);
+				m_bakedGraphCache.erase(getAllocator(), it);
+				++bakedGraphsCleanedCount;
+				erased = true;
+				break;
+			}
+		}
+	} while(erased);
+
+	if(bakedGraphsCleanedCount > 0)
+	{
+		ANKI_GR_LOGI("Cleaned %u compiled graphs", bakedGraphsCleanedCount);
+	}
 }
 
 void RenderGraph::getStatistics(RenderGraphStatistics& statistics) const
 {
+	statistics.m_transientMemoryBeforeAliasing = m_statistics.m_transientMemoryBeforeAliasing;
+	statistics.m_transientMemoryAfterAliasing = m_statistics.m_transientMemoryAfterAliasing;
+	statistics.m_textureBarrierCount = m_statistics.m_textureBarrierCount;
+	statistics.m_bufferBarrierCount = m_statistics.m_bufferBarrierCount;
+	statistics.m_accelerationStructureBarrierCount = m_statistics.m_asBarrierCount;
+	statistics.m_unoptimizedBarrierCount = m_statistics.m_unoptimizedBarrierCount;
+
 	const U32 oldFrame = (m_statistics.m_nextTimestamp + 1) % MAX_TIMESTAMPS_BUFFERED;
 
 	if(m_statistics.m_timestamps[oldFrame * 2] && m_statistics.m_timestamps[oldFrame * 2 + 1])
@@ -1416,6 +2213,42 @@ void RenderGraph::getStatistics(RenderGraphStatistics& statistics) const
 	}
 }
 
+U32 RenderGraph::getBatchCount() const
+{
+	ANKI_ASSERT(m_ctx);
+	return m_ctx->m_batches.getSize();
+}
+
+GpuQueueType RenderGraph::getBatchQueue(U32 batchIdx) const
+{
+	ANKI_ASSERT(m_ctx);
+	return m_ctx->m_batches[batchIdx].m_queue;
+}
+
+ConstWeakArray<U32> RenderGraph::getBatchPassIndices(U32 batchIdx) const
+{
+	ANKI_ASSERT(m_ctx);
+	return ConstWeakArray<U32>(m_ctx->m_batches[batchIdx].m_passIndices);
+}
+
+void RenderGraph::getBatchTextureBarriers(U32 batchIdx, DynamicArrayAuto<RenderGraphTextureBarrierInfo>& barriers) const
+{
+	ANKI_ASSERT(m_ctx);
+	const Batch& batch = m_ctx->m_batches[batchIdx];
+
+	barriers.destroy();
+	barriers.create(batch.m_textureBarriersBefore.getSize());
+	for(U32 i = 0; i < batch.m_textureBarriersBefore.getSize(); ++i)
+	{
+		const TextureBarrier& in = batch.m_textureBarriersBefore[i];
+		RenderGraphTextureBarrierInfo& out = barriers[i];
+		out.m_renderTarget.m_idx = in.m_idx;
+		out.m_usageBefore = in.m_usageBefore;
+		out.m_usageAfter = in.m_usageAfter;
+		out.m_subresource = in.m_subresource;
+	}
+}
+
 #if ANKI_DBG_RENDER_GRAPH
 StringAuto RenderGraph::textureUsageToStr(StackAllocator<U8>& alloc, TextureUsageBit usage)
 {
@@ -1563,8 +2396,9 @@ Error RenderGraph::dumpDependencyDotFile(const RenderGraphDescription& descr, co
 			CString passName = descr.m_passes[passIdx]->m_name.toCString();
 
 			slist.pushBackSprintf(
-				"\t\"%s\"[color=%s,style=%s,shape=box];\n", passName.cstr(), COLORS[batchIdx % COLORS.getSize()],
-				(descr.m_passes[passIdx]->m_type == RenderPassDescriptionBase::Type::GRAPHICS) ? "bold" : "dashed");
+				"\t\"%s\"[color=%s,style=%s,shape=%s];\n", passName.cstr(), COLORS[batchIdx % COLORS.getSize()],
+				(descr.m_passes[passIdx]->m_type == RenderPassDescriptionBase::Type::GRAPHICS) ? "bold" : "dashed",
+				(ctx.m_batches[batchIdx].m_queue == GpuQueueType::ASYNC_COMPUTE) ? "ellipse" : "box");
 
 			for(U32 depIdx : ctx.m_passes[passIdx].m_dependsOn)
 			{
@@ -1605,9 +2439,11 @@ Error RenderGraph::dumpDependencyDotFile(const RenderGraphDescription& descr, co
 			const TextureBarrier& barrier = batch.m_textureBarriersBefore[barrierIdx];
 
 			StringAuto barrierLabel(ctx.m_alloc);
-			barrierLabel.sprintf("<b>%s</b> (mip,dp,f,l)=(%u,%u,%u,%u)<br/>%s <b>to</b> %s",
-								 &descr.m_renderTargets[barrier.m_idx].m_name[0], barrier.m_surface.m_level,
-								 barrier.m_surface.m_depth, barrier.m_surface.m_face, barrier.m_surface.m_layer,
+			barrierLabel.sprintf("<b>%s</b> (mip,f,l)=(%u:%u,%u:%u,%u:%u)<br/>%s <b>to</b> %s",
+								 &descr.m_renderTargets[barrier.m_idx].m_name[0], barrier.m_subresource.m_firstMipmap,
+								 barrier.m_subresource.m_mipmapCount, barrier.m_subresource.m_firstFace,
+								 barrier.m_subresource.m_faceCount, barrier.m_subresource.m_firstLayer,
+								 barrier.m_subresource.m_layerCount,
 								 textureUsageToStr(alloc, barrier.m_usageBefore).cstr(),
 								 textureUsageToStr(alloc, barrier.m_usageAfter).cstr());
 
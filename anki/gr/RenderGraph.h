@@ -15,6 +15,7 @@
 #include <anki/gr/CommandBuffer.h>
 #include <anki/gr/AccelerationStructure.h>
 #include <anki/util/HashMap.h>
+#include <anki/util/FlatHashMap.h>
 #include <anki/util/BitSet.h>
 #include <anki/util/WeakArray.h>
 
@@ -340,6 +341,7 @@ protected:
 	RenderPassWorkCallback m_callback = nullptr;
 	void* m_userData = nullptr;
 	U32 m_secondLevelCmdbsCount = 0;
+	GpuQueueType m_queue = GpuQueueType::GENERAL;
 
 	DynamicArray<RenderPassDependency> m_rtDeps;
 	DynamicArray<RenderPassDependency> m_buffDeps;
@@ -455,6 +457,15 @@ class ComputeRenderPassDescription : public RenderPassDescriptionBase
 	template<typename, typename>
 	friend class GenericPoolAllocator;
 
+public:
+	/// Hint the queue the pass prefers to run on. Passes on the ASYNC_COMPUTE queue can overlap with the work of the
+	/// GENERAL queue. The RenderGraph will add the sync points between the queues.
+	void setQueueHint(GpuQueueType queue)
+	{
+		ANKI_ASSERT(queue < GpuQueueType::COUNT);
+		m_queue = queue;
+	}
+
 private:
 	ComputeRenderPassDescription(RenderGraphDescription* descr)
 		: RenderPassDescriptionBase(Type::NO_GRAPHICS, descr)
@@ -561,6 +572,25 @@ class RenderGraphStatistics
 public:
 	Second m_gpuTime; ///< Time spent in the GPU.
 	Second m_cpuStartTime; ///< Time the work was submited from the CPU (almost)
+
+	PtrSize m_transientMemoryBeforeAliasing = 0; ///< Memory of the non-imported render targets without aliasing.
+	PtrSize m_transientMemoryAfterAliasing = 0; ///< Memory of the non-imported render targets.
+
+	U32 m_textureBarrierCount = 0; ///< Texture barriers of the frame. A barrier can cover a range of surfaces.
+	U32 m_bufferBarrierCount = 0;
+	U32 m_accelerationStructureBarrierCount = 0;
+	U32 m_unoptimizedBarrierCount = 0; ///< The barriers the frame would have without merging and without skipping.
+};
+
+/// A texture barrier of a compiled RenderGraph.
+/// @memberof RenderGraph
+class RenderGraphTextureBarrierInfo
+{
+public:
+	RenderTargetHandle m_renderTarget;
+	TextureUsageBit m_usageBefore = TextureUsageBit::NONE;
+	TextureUsageBit m_usageAfter = TextureUsageBit::NONE;
+	TextureSubresourceInfo m_subresource;
 };
 
 /// Accepts a descriptor of the frame's render passes and sets the dependencies between them.
@@ -585,6 +615,13 @@ public:
 	/// @name 1st step methods
 	/// @{
 	void compileNewGraph(const RenderGraphDescription& descr, StackAllocator<U8>& alloc);
+
+	/// Enable or disable the cache of compiled graphs. If a RenderGraphDescription has the same structure as one
+	/// compiled in a previous frame the dependencies, batches and barriers will be re-used. Enabled by default.
+	void setCompiledGraphCacheEnabled(Bool enable)
+	{
+		m_bakedGraphCacheEnabled = enable;
+	}
 	/// @}
 
 	/// @name 2nd step methods
@@ -620,6 +657,33 @@ public:
 	void getStatistics(RenderGraphStatistics& statistics) const;
 	/// @}
 
+	/// @name Inspect the compilation
+	/// @{
+
+	/// Only find the dependencies, the batches and the barriers in compileNewGraph(). Don't create textures,
+	/// framebuffers and command buffers. The compiled graph can't run and it can't have imported render targets or
+	/// buffers. It's used to test the compilation without a GPU.
+	ANKI_INTERNAL void setCompileOnly(Bool compileOnly)
+	{
+		ANKI_ASSERT(m_ctx == nullptr);
+		m_compileOnly = compileOnly;
+	}
+
+	/// @note Call it after compileNewGraph().
+	ANKI_INTERNAL U32 getBatchCount() const;
+
+	/// @note Call it after compileNewGraph().
+	ANKI_INTERNAL GpuQueueType getBatchQueue(U32 batchIdx) const;
+
+	/// @note Call it after compileNewGraph().
+	ANKI_INTERNAL ConstWeakArray<U32> getBatchPassIndices(U32 batchIdx) const;
+
+	/// Get the texture barriers that are set before a batch runs.
+	/// @note Call it after compileNewGraph().
+	ANKI_INTERNAL void getBatchTextureBarriers(U32 batchIdx,
+											   DynamicArrayAuto<RenderGraphTextureBarrierInfo>& barriers) const;
+	/// @}
+
 private:
 	static constexpr U PERIODIC_CLEANUP_EVERY = 60; ///< How many frames between cleanups.
 
@@ -633,6 +697,7 @@ private:
 	class TextureBarrier;
 	class BufferBarrier;
 	class ASBarrier;
+	class BakedGraph;
 
 	/// Render targets of the same type+size+format.
 	class RenderTargetCacheEntry
@@ -649,9 +714,12 @@ private:
 		DynamicArray<TextureUsageBit> m_surfOrVolLastUsages; ///< Last TextureUsageBit of the imported RT.
 	};
 
-	HashMap<U64, RenderTargetCacheEntry> m_renderTargetCache; ///< Non-imported render targets.
-	HashMap<U64, FramebufferPtr> m_fbCache; ///< Framebuffer cache.
+	FlatHashMap<U64, RenderTargetCacheEntry> m_renderTargetCache; ///< Non-imported render targets.
+	FlatHashMap<U64, FramebufferPtr> m_fbCache; ///< Framebuffer cache.
 	HashMap<U64, ImportedRenderTargetInfo> m_importedRenderTargets;
+	HashMap<U64, BakedGraph*> m_bakedGraphCache; ///< Compiled graphs. The key is the hash of the description.
+	Bool m_bakedGraphCacheEnabled = true;
+	Bool m_compileOnly = false;
 
 	BakeContext* m_ctx = nullptr;
 	U64 m_version = 0;
@@ -663,6 +731,14 @@ private:
 		Array<TimestampQueryPtr, MAX_TIMESTAMPS_BUFFERED * 2> m_timestamps;
 		Array<Second, MAX_TIMESTAMPS_BUFFERED> m_cpuStartTimes;
 		U8 m_nextTimestamp = 0;
+
+		PtrSize m_transientMemoryBeforeAliasing = 0;
+		PtrSize m_transientMemoryAfterAliasing = 0;
+
+		U32 m_textureBarrierCount = 0;
+		U32 m_bufferBarrierCount = 0;
+		U32 m_asBarrierCount = 0;
+		U32 m_unoptimizedBarrierCount = 0;
 	} m_statistics;
 
 	RenderGraph(GrManager* manager, CString name);
@@ -672,11 +748,27 @@ private:
 	static ANKI_USE_RESULT RenderGraph* newInstance(GrManager* manager);
 
 	BakeContext* newContext(const RenderGraphDescription& descr, StackAllocator<U8>& alloc);
-	void initRenderPassesAndSetDeps(const RenderGraphDescription& descr, StackAllocator<U8>& alloc);
-	void initBatches();
+	void initRenderPassesAndSetDeps(const RenderGraphDescription& descr, StackAllocator<U8>& alloc,
+									const BakedGraph* baked);
+	void initBatches(const RenderGraphDescription& descr, const BakedGraph* baked);
+	void initRenderTargets(const RenderGraphDescription& descr);
 	void initGraphicsPasses(const RenderGraphDescription& descr, StackAllocator<U8>& alloc);
+	void initBatchCommandBuffers();
 	void setBatchBarriers(const RenderGraphDescription& descr);
 
+	/// @name Compiled graph cache
+	/// @{
+
+	/// Hash everything in the description that affects the dependencies, the batches and the barriers.
+	U64 computeDescriptionHash(const RenderGraphDescription& descr) const;
+
+	/// Copy the results of the current compilation to the cache.
+	void storeBakedGraph(U64 hash);
+
+	/// Set the barriers and the final usages of the resources using a compiled graph.
+	void restoreBatchBarriers(const BakedGraph& baked);
+	/// @}
+
 	TexturePtr getOrCreateRenderTarget(const TextureInitInfo& initInf, U64 hash);
 	FramebufferPtr getOrCreateFramebuffer(const FramebufferDescription& fbDescr, const RenderTargetHandle* rtHandles,
 										  CString name, Bool& drawsToPresentableTex);
@@ -688,12 +780,18 @@ private:
 
 	static Bool overlappingTextureSubresource(const TextureSubresourceInfo& suba, const TextureSubresourceInfo& subb);
 
-	static Bool passHasUnmetDependencies(const BakeContext& ctx, U32 passIdx);
-
 	void setTextureBarrier(Batch& batch, const RenderPassDependency& consumer);
 
+	/// Merge the texture barriers of a batch that touch adjacent surfaces.
+	void mergeTextureBarriers(Batch& batch);
+
+	TextureBarrier* findTextureBarrier(U32 batchIdx, U32 rtIdx, const TextureSurfaceInfo& surf);
+
+	/// Find the earliest batch a barrier can be moved to.
+	U32 findEarliestBarrierBatch(U32 batchIdx, U32 lastUseBatchIdx) const;
+
 	template<typename TFunc>
-	static void iterateSurfsOrVolumes(const TexturePtr& tex, const TextureSubresourceInfo& subresource, TFunc func);
+	static void iterateSurfsOrVolumes(const RT& rt, const TextureSubresourceInfo& subresource, TFunc func);
 
 	void getCrntUsage(RenderTargetHandle handle, U32 batchIdx, const TextureSubresourceInfo& subresource,
 					  TextureUsageBit& usage) const;
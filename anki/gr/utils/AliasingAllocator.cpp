@@ -0,0 +1,99 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/gr/utils/AliasingAllocator.h>
+#include <algorithm>
+
+namespace anki
+{
+
+U32 AliasingAllocator::newResource(PtrSize size, U64 compatibilityKey, U32 firstUse, U32 lastUse)
+{
+	ANKI_ASSERT(size > 0);
+	ANKI_ASSERT(firstUse <= lastUse);
+
+	Resource& res = *m_resources.emplaceBack(m_alloc);
+	res.m_size = size;
+	res.m_compatibilityKey = compatibilityKey;
+	res.m_firstUse = firstUse;
+	res.m_lastUse = lastUse;
+	res.m_slot = MAX_U32;
+
+	m_unpackedSize += size;
+	return m_resources.getSize() - 1;
+}
+
+void AliasingAllocator::pack()
+{
+	m_slots.destroy(m_alloc);
+	m_packedSize = 0;
+
+	if(m_resources.getSize() == 0)
+	{
+		return;
+	}
+
+	// Visit the resources in the order they start living. Bigger first to have them occupy the slots
+	DynamicArray<U32> order;
+	order.create(m_alloc, m_resources.getSize());
+	for(U32 i = 0; i < order.getSize(); ++i)
+	{
+		order[i] = i;
+	}
+
+	std::sort(order.getBegin(), order.getEnd(), [&](U32 a, U32 b) {
+		const Resource& ra = m_resources[a];
+		const Resource& rb = m_resources[b];
+		if(ra.m_firstUse != rb.m_firstUse)
+		{
+			return ra.m_firstUse < rb.m_firstUse;
+		}
+		else if(ra.m_size != rb.m_size)
+		{
+			return ra.m_size > rb.m_size;
+		}
+		else
+		{
+			return a < b;
+		}
+	});
+
+	// Find or create a slot for every resource. Like a linear scan register allocator
+	for(U32 resIdx : order)
+	{
+		Resource& res = m_resources[resIdx];
+
+		// Find the smallest compatible slot that is free
+		U32 bestSlot = MAX_U32;
+		for(U32 slotIdx = 0; slotIdx < m_slots.getSize(); ++slotIdx)
+		{
+			const AliasingAllocatorSlot& slot = m_slots[slotIdx];
+			if(slot.m_compatibilityKey == res.m_compatibilityKey && slot.m_size >= res.m_size
+			   && slot.m_lastUse < res.m_firstUse
+			   && (bestSlot == MAX_U32 || slot.m_size < m_slots[bestSlot].m_size))
+			{
+				bestSlot = slotIdx;
+			}
+		}
+
+		if(bestSlot == MAX_U32)
+		{
+			// None found, create a new slot
+			AliasingAllocatorSlot& slot = *m_slots.emplaceBack(m_alloc);
+			slot.m_size = res.m_size;
+			slot.m_compatibilityKey = res.m_compatibilityKey;
+			bestSlot = m_slots.getSize() - 1;
+
+			m_packedSize += res.m_size;
+		}
+
+		m_slots[bestSlot].m_lastUse = res.m_lastUse;
+		res.m_slot = bestSlot;
+	}
+
+	order.destroy(m_alloc);
+}
+
+} // end namespace anki
@@ -0,0 +1,97 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/gr/Common.h>
+#include <anki/util/WeakArray.h>
+
+namespace anki
+{
+
+/// @addtogroup graphics
+/// @{
+
+/// A memory slot of the AliasingAllocator. Resources that are assigned the same slot share the same memory.
+class AliasingAllocatorSlot
+{
+public:
+	PtrSize m_size = 0;
+	U64 m_compatibilityKey = 0;
+	U32 m_lastUse = 0; ///< The last use of the last resource that was placed in the slot.
+};
+
+/// Packs resources that live for a range of "time" (eg RenderGraph batches) into memory slots. Resources whose lifetimes
+/// don't overlap and have the same compatibility key can share a slot. It only does the bookkeeping, it doesn't
+/// allocate any GPU memory.
+class AliasingAllocator : public NonCopyable
+{
+public:
+	AliasingAllocator(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~AliasingAllocator()
+	{
+		m_resources.destroy(m_alloc);
+		m_slots.destroy(m_alloc);
+	}
+
+	/// Add a new resource.
+	/// @param size The size of the resource.
+	/// @param compatibilityKey Only resources with the same key can share memory.
+	/// @param firstUse The first time the resource will be used.
+	/// @param lastUse The last time the resource will be used. Inclusive.
+	/// @return The index of the resource.
+	U32 newResource(PtrSize size, U64 compatibilityKey, U32 firstUse, U32 lastUse);
+
+	/// Assign a slot to all resources.
+	void pack();
+
+	/// Get the slot of a resource. Call it after pack().
+	U32 getResourceSlot(U32 resourceIdx) const
+	{
+		ANKI_ASSERT(m_resources[resourceIdx].m_slot != MAX_U32 && "Forgot to call pack()");
+		return m_resources[resourceIdx].m_slot;
+	}
+
+	ConstWeakArray<AliasingAllocatorSlot> getSlots() const
+	{
+		return ConstWeakArray<AliasingAllocatorSlot>(m_slots);
+	}
+
+	/// The memory that would be needed without aliasing.
+	PtrSize getUnpackedSize() const
+	{
+		return m_unpackedSize;
+	}
+
+	/// The memory that is needed after aliasing. Call it after pack().
+	PtrSize getPackedSize() const
+	{
+		return m_packedSize;
+	}
+
+private:
+	class Resource
+	{
+	public:
+		PtrSize m_size;
+		U64 m_compatibilityKey;
+		U32 m_firstUse;
+		U32 m_lastUse;
+		U32 m_slot;
+	};
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	DynamicArray<Resource> m_resources;
+	DynamicArray<AliasingAllocatorSlot> m_slots;
+	PtrSize m_unpackedSize = 0;
+	PtrSize m_packedSize = 0;
+};
+/// @}
+
+} // end namespace anki
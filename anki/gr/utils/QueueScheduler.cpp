@@ -0,0 +1,246 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/gr/utils/QueueScheduler.h>
+
+namespace anki
+{
+
+U32 QueueScheduler::newPass(GpuQueueType queue, ConstWeakArray<U32> dependsOn)
+{
+	ANKI_ASSERT(queue < GpuQueueType::COUNT);
+
+	Pass& pass = *m_passes.emplaceBack(m_alloc);
+	pass.m_firstDependency = m_dependencies.getSize();
+	pass.m_dependencyCount = dependsOn.getSize();
+	pass.m_batch = MAX_U32;
+	pass.m_queue = queue;
+
+	for(U32 depPassIdx : dependsOn)
+	{
+		ANKI_ASSERT(depPassIdx < m_passes.getSize() - 1 && "Dependencies should be added first");
+		m_dependencies.emplaceBack(m_alloc, depPassIdx);
+	}
+
+	return m_passes.getSize() - 1;
+}
+
+void QueueScheduler::schedule()
+{
+	m_batches.destroy(m_alloc);
+	m_batchPassIndices.destroy(m_alloc);
+	m_batchPassIndices.resizeStorage(m_alloc, m_passes.getSize());
+	m_syncPointCount = 0;
+
+	for(Pass& pass : m_passes)
+	{
+		pass.m_batch = MAX_U32;
+	}
+
+	// The latest batch of a queue (2nd index) that a queue (1st index) has waited for
+	Array2d<U32, U32(GpuQueueType::COUNT), U32(GpuQueueType::COUNT)> lastWaitedBatches;
+	for(GpuQueueType q = GpuQueueType::FIRST; q < GpuQueueType::COUNT; ++q)
+	{
+		for(GpuQueueType otherq = GpuQueueType::FIRST; otherq < GpuQueueType::COUNT; ++otherq)
+		{
+			lastWaitedBatches[q][otherq] = MAX_U32;
+		}
+	}
+
+	U32 assignedPassCount = 0;
+	U32 step = 0;
+	while(assignedPassCount < m_passes.getSize())
+	{
+		ANKI_ASSERT(step <= m_passes.getSize() && "Cyclic dependencies?");
+
+		for(GpuQueueType queue = GpuQueueType::FIRST; queue < GpuQueueType::COUNT; ++queue)
+		{
+			const U32 firstPass = m_batchPassIndices.getSize();
+			const U32 batchIdx = m_batches.getSize();
+
+			// Gather the passes of the queue that have all their dependencies in previous steps
+			for(U32 passIdx = 0; passIdx < m_passes.getSize(); ++passIdx)
+			{
+				const Pass& pass = m_passes[passIdx];
+				if(pass.m_batch != MAX_U32 || pass.m_queue != queue)
+				{
+					continue;
+				}
+
+				Bool ready = true;
+				for(U32 i = 0; i < pass.m_dependencyCount && ready; ++i)
+				{
+					const U32 depBatchIdx = m_passes[m_dependencies[pass.m_firstDependency + i]].m_batch;
+					ready = depBatchIdx != MAX_U32 && m_batches[depBatchIdx].m_step < step;
+				}
+
+				if(ready)
+				{
+					m_batchPassIndices.emplaceBack(m_alloc, passIdx);
+				}
+			}
+
+			const U32 passCount = m_batchPassIndices.getSize() - firstPass;
+			if(passCount == 0)
+			{
+				continue;
+			}
+
+			QueueSchedulerBatch& batch = *m_batches.emplaceBack(m_alloc);
+			batch.m_firstPass = firstPass;
+			batch.m_passCount = passCount;
+			batch.m_step = step;
+			batch.m_queue = queue;
+
+			// Find the latest batch of every other queue the batch depends on
+			Array<U32, U32(GpuQueueType::COUNT)> depBatches;
+			for(U32& depBatchIdx : depBatches)
+			{
+				depBatchIdx = MAX_U32;
+			}
+
+			for(U32 i = firstPass; i < firstPass + passCount; ++i)
+			{
+				Pass& pass = m_passes[m_batchPassIndices[i]];
+				pass.m_batch = batchIdx;
+
+				for(U32 j = 0; j < pass.m_dependencyCount; ++j)
+				{
+					const U32 depBatchIdx = m_passes[m_dependencies[pass.m_firstDependency + j]].m_batch;
+					const GpuQueueType depQueue = m_batches[depBatchIdx].m_queue;
+					if(depQueue != queue && (depBatches[depQueue] == MAX_U32 || depBatches[depQueue] < depBatchIdx))
+					{
+						depBatches[depQueue] = depBatchIdx;
+					}
+				}
+			}
+
+			// Wait only if a previous batch of this queue hasn't waited for the same or a later batch. The queue
+			// executes its batches in order so the older wait covers this batch as well
+			for(GpuQueueType otherQueue = GpuQueueType::FIRST; otherQueue < GpuQueueType::COUNT; ++otherQueue)
+			{
+				const U32 depBatchIdx = depBatches[otherQueue];
+				U32& lastWaitedBatchIdx = lastWaitedBatches[queue][otherQueue];
+				if(depBatchIdx == MAX_U32 || (lastWaitedBatchIdx != MAX_U32 && lastWaitedBatchIdx >= depBatchIdx))
+				{
+					continue;
+				}
+
+				batch.m_waitBatches[otherQueue] = depBatchIdx;
+				m_batches[depBatchIdx].m_signal = true;
+				lastWaitedBatchIdx = depBatchIdx;
+				++m_syncPointCount;
+			}
+
+			assignedPassCount += passCount;
+		}
+
+		++step;
+	}
+}
+
+void QueueBatchTimeline::newBatch(GpuQueueType queue, const Array<U32, U32(GpuQueueType::COUNT)>& waitBatches)
+{
+	ANKI_ASSERT(queue < GpuQueueType::COUNT);
+	const U32 batchIdx = m_batches.getSize();
+
+	Batch batch;
+	batch.m_queue = queue;
+	for(U32& doneBatchIdx : batch.m_doneBatches)
+	{
+		doneBatchIdx = MAX_U32;
+	}
+
+	auto inherit = [&](U32 prevBatchIdx) {
+		ANKI_ASSERT(prevBatchIdx < batchIdx);
+		const Batch& prevBatch = m_batches[prevBatchIdx];
+
+		U32& done = batch.m_doneBatches[prevBatch.m_queue];
+		done = (done == MAX_U32) ? prevBatchIdx : max(done, prevBatchIdx);
+
+		for(GpuQueueType q = GpuQueueType::FIRST; q < GpuQueueType::COUNT; ++q)
+		{
+			const U32 prevDone = prevBatch.m_doneBatches[q];
+			if(prevDone != MAX_U32)
+			{
+				batch.m_doneBatches[q] = (batch.m_doneBatches[q] == MAX_U32) ? prevDone
+																			 : max(batch.m_doneBatches[q], prevDone);
+			}
+		}
+	};
+
+	// The previous batch of the same queue
+	for(U32 i = batchIdx; i > 0; --i)
+	{
+		if(m_batches[i - 1].m_queue == queue)
+		{
+			inherit(i - 1);
+			break;
+		}
+	}
+
+	// The batches of the other queues it waits for
+	for(GpuQueueType q = GpuQueueType::FIRST; q < GpuQueueType::COUNT; ++q)
+	{
+		if(waitBatches[q] != MAX_U32)
+		{
+			ANKI_ASSERT(m_batches[waitBatches[q]].m_queue == q);
+			inherit(waitBatches[q]);
+		}
+	}
+
+	m_batches.emplaceBack(m_alloc, batch);
+}
+
+U32 QueueBatchTimeline::findLastOverlappingBatch(const Array<U32, U32(GpuQueueType::COUNT)>& lastBatches) const
+{
+	U32 out = 0;
+	for(GpuQueueType q = GpuQueueType::FIRST; q < GpuQueueType::COUNT; ++q)
+	{
+		if(lastBatches[q] != MAX_U32)
+		{
+			ANKI_ASSERT(m_batches[lastBatches[q]].m_queue == q);
+			out = max(out, lastBatches[q]);
+		}
+	}
+
+	// In every queue find the first batch that runs after all the given batches. The batches of that queue before it
+	// might overlap
+	for(GpuQueueType queue = GpuQueueType::FIRST; queue < GpuQueueType::COUNT; ++queue)
+	{
+		U32 lastQueueBatchIdx = MAX_U32;
+		Bool found = false;
+		for(U32 batchIdx = 0; batchIdx < m_batches.getSize() && !found; ++batchIdx)
+		{
+			if(m_batches[batchIdx].m_queue != queue)
+			{
+				continue;
+			}
+
+			lastQueueBatchIdx = batchIdx;
+
+			found = true;
+			for(GpuQueueType q = GpuQueueType::FIRST; q < GpuQueueType::COUNT && found; ++q)
+			{
+				found = lastBatches[q] == MAX_U32 || runsAfter(batchIdx, lastBatches[q]);
+			}
+
+			if(found && batchIdx > 0)
+			{
+				out = max(out, batchIdx - 1);
+			}
+		}
+
+		if(!found && lastQueueBatchIdx != MAX_U32)
+		{
+			// None of the batches of the queue is guaranteed to run after
+			out = max(out, lastQueueBatchIdx);
+		}
+	}
+
+	return out;
+}
+
+} // end namespace anki
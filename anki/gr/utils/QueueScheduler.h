@@ -0,0 +1,156 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/gr/Common.h>
+#include <anki/util/WeakArray.h>
+
+namespace anki
+{
+
+/// @addtogroup graphics
+/// @{
+
+// The per queue arrays of the batches are initialized with one value for each queue
+static_assert(U32(GpuQueueType::COUNT) == 2, "Update the initializers of the per queue arrays");
+
+/// A batch of passes that the QueueScheduler assigned to a queue.
+class QueueSchedulerBatch
+{
+public:
+	U32 m_firstPass = 0; ///< Offset to QueueScheduler::getBatchPassIndices().
+	U32 m_passCount = 0;
+	U32 m_step = 0; ///< Batches of different queues that have the same step can overlap.
+
+	/// For each queue the batch of that queue this batch should wait for before it starts. MAX_U32 if there is no
+	/// need to wait.
+	Array<U32, U32(GpuQueueType::COUNT)> m_waitBatches = {MAX_U32, MAX_U32};
+
+	GpuQueueType m_queue = GpuQueueType::GENERAL;
+	Bool m_signal = false; ///< Batches of other queues wait for this one.
+};
+
+/// Groups passes into batches and assigns the batches to GPU queues. Passes of the same batch don't depend on each
+/// other. The batches are returned in an order that can also be submitted to a single queue. When a batch depends on
+/// the work of another queue it waits for the latest batch of that queue it needs and only if a previous wait of its
+/// queue doesn't cover it already, keeping the cross-queue sync points to the minimum. It only does the bookkeeping,
+/// it doesn't submit anything.
+class QueueScheduler : public NonCopyable
+{
+public:
+	QueueScheduler(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~QueueScheduler()
+	{
+		m_passes.destroy(m_alloc);
+		m_dependencies.destroy(m_alloc);
+		m_batches.destroy(m_alloc);
+		m_batchPassIndices.destroy(m_alloc);
+	}
+
+	/// Add a new pass.
+	/// @param queue The queue the pass prefers to run on.
+	/// @param dependsOn The passes that should finish before this pass starts. They should have been added already.
+	/// @return The index of the pass.
+	U32 newPass(GpuQueueType queue, ConstWeakArray<U32> dependsOn);
+
+	/// Create the batches and the sync points.
+	void schedule();
+
+	ConstWeakArray<QueueSchedulerBatch> getBatches() const
+	{
+		return ConstWeakArray<QueueSchedulerBatch>(m_batches);
+	}
+
+	/// The passes of all batches. Use QueueSchedulerBatch::m_firstPass and QueueSchedulerBatch::m_passCount to index
+	/// it.
+	ConstWeakArray<U32> getBatchPassIndices() const
+	{
+		return ConstWeakArray<U32>(m_batchPassIndices);
+	}
+
+	/// Get the batch of a pass. Call it after schedule().
+	U32 getPassBatch(U32 passIdx) const
+	{
+		ANKI_ASSERT(m_passes[passIdx].m_batch != MAX_U32 && "Forgot to call schedule()");
+		return m_passes[passIdx].m_batch;
+	}
+
+	/// The number of cross-queue waits.
+	U32 getSyncPointCount() const
+	{
+		return m_syncPointCount;
+	}
+
+private:
+	class Pass
+	{
+	public:
+		U32 m_firstDependency;
+		U32 m_dependencyCount;
+		U32 m_batch;
+		GpuQueueType m_queue;
+	};
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	DynamicArray<Pass> m_passes;
+	DynamicArray<U32> m_dependencies;
+	DynamicArray<QueueSchedulerBatch> m_batches;
+	DynamicArray<U32> m_batchPassIndices;
+	U32 m_syncPointCount = 0;
+};
+
+/// Knows which batches are guaranteed to run after others. A batch runs after the previous batches of its queue, after
+/// the batches it waits for and, transitively, after everything those batches run after. The batch indices don't say
+/// that on their own when there are many queues since batches of different queues overlap.
+class QueueBatchTimeline : public NonCopyable
+{
+public:
+	QueueBatchTimeline(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~QueueBatchTimeline()
+	{
+		m_batches.destroy(m_alloc);
+	}
+
+	/// Add the next batch. The batches should be added in the order they were scheduled.
+	/// @param queue The queue of the batch.
+	/// @param waitBatches See QueueSchedulerBatch::m_waitBatches.
+	void newBatch(GpuQueueType queue, const Array<U32, U32(GpuQueueType::COUNT)>& waitBatches);
+
+	/// Check if a batch is guaranteed to start after another batch finished.
+	Bool runsAfter(U32 batchIdx, U32 otherBatchIdx) const
+	{
+		const U32 doneBatchIdx = m_batches[batchIdx].m_doneBatches[m_batches[otherBatchIdx].m_queue];
+		return doneBatchIdx != MAX_U32 && doneBatchIdx >= otherBatchIdx;
+	}
+
+	/// Find the last batch that might overlap with or run before some batches. All batches after the returned one run
+	/// after the given batches. Use it to get lifetimes in batch indices that can be compared across queues.
+	/// @param lastBatches For each queue the last of the batches. MAX_U32 if none.
+	U32 findLastOverlappingBatch(const Array<U32, U32(GpuQueueType::COUNT)>& lastBatches) const;
+
+private:
+	class Batch
+	{
+	public:
+		/// For each queue the latest batch of that queue that is done before this batch starts. MAX_U32 if none.
+		Array<U32, U32(GpuQueueType::COUNT)> m_doneBatches;
+		GpuQueueType m_queue;
+	};
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	DynamicArray<Batch> m_batches;
+};
+/// @}
+
+} // end namespace anki
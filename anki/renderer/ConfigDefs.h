@@ -25,6 +25,8 @@ ANKI_CONFIG_OPTION(r_shadowMappingTileCountPerRowOrColumn, 16, 1, 256)
 ANKI_CONFIG_OPTION(r_shadowMappingScratchTileCountX, 4 * (MAX_SHADOW_CASCADES + 2), 1u, 256u,
 				   "Number of tiles of the scratch buffer in X")
 ANKI_CONFIG_OPTION(r_shadowMappingScratchTileCountY, 4, 1, 256, "Number of tiles of the scratch buffer in Y")
+ANKI_CONFIG_OPTION(r_shadowMappingMaxTileRefreshesPerFrame, 32, 0, 1024,
+				   "Max number of point and spot light shadow tiles that are re-rendered per frame. 0 means no limit")
 
 ANKI_CONFIG_OPTION(r_probeReflectionResolution, 128, 4, 2048)
 ANKI_CONFIG_OPTION(r_probeReflectionIrradianceResolution, 16, 4, 2048)
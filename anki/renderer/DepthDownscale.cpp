@@ -115,6 +115,7 @@ void DepthDownscale::populateRenderGraph(RenderingContext& ctx)
 		const U mipsToFill = (i + 1 < m_mipCount) ? MIPS_WRITTEN_PER_PASS : 1;
 
 		ComputeRenderPassDescription& pass = rgraph.newComputeRenderPass(passNames[i / MIPS_WRITTEN_PER_PASS]);
+		pass.setQueueHint(GpuQueueType::ASYNC_COMPUTE);
 
 		if(i == 0)
 		{
@@ -381,6 +381,7 @@ void GlobalIllumination::populateRenderGraph(RenderingContext& rctx)
 	// Irradiance pass. First & 2nd bounce
 	{
 		ComputeRenderPassDescription& pass = rgraph.newComputeRenderPass("GI IR");
+		pass.setQueueHint(GpuQueueType::ASYNC_COMPUTE);
 
 		pass.setWork(
 			[](RenderPassWorkContext& rgraphCtx) {
@@ -37,6 +37,7 @@ Error MainRenderer::init(ThreadHive* hive, ResourceManager* resources, GrManager
 
 	m_alloc = HeapAllocator<U8>(allocCb, allocCbUserData);
 	m_frameAlloc = StackAllocator<U8>(allocCb, allocCbUserData, 1024 * 1024 * 10, 1.0f);
+	m_frameAlloc.getMemoryPool().setThreadArenaSize(64_KB);
 
 	// Init renderer and manipulate the width/height
 	m_width = config.getNumberU32("width");
@@ -84,6 +85,7 @@ Error MainRenderer::render(RenderQueue& rqueue, TexturePtr presentTex)
 
 	// First thing, reset the temp mem pool
 	m_frameAlloc.getMemoryPool().reset();
+	ANKI_TRACE_INC_COUNTER(R_FRAME_ALLOC_WASTED_BYTES, m_frameAlloc.getMemoryPool().getThreadArenaWastedBytes());
 
 	// Run renderer
 	RenderingContext ctx(m_frameAlloc);
@@ -14,6 +14,9 @@
 namespace anki
 {
 
+// Forward
+class ModelPatch;
+
 /// @addtogroup renderer
 /// @{
 
@@ -66,6 +69,9 @@ public:
 
 	U8 m_lod; ///< Don't set this. Visibility will.
 
+	/// Optional. The renderer asks for the LOD of its meshes and the mips of its textures. Visibility will set it.
+	const ModelPatch* m_modelPatch;
+
 	RenderableQueueElement()
 	{
 	}
@@ -9,6 +9,10 @@
 #include <anki/core/ConfigSet.h>
 #include <anki/util/HighRezTimer.h>
 #include <anki/collision/Aabb.h>
+#include <anki/resource/TextureStreamer.h>
+#include <anki/resource/MeshStreamer.h>
+#include <anki/resource/ModelResource.h>
+#include <anki/resource/TextureResource.h>
 #include <anki/shaders/include/ClusteredShadingTypes.h>
 
 #include <anki/renderer/ProbeReflections.h>
@@ -286,6 +290,8 @@ Error Renderer::populateRenderGraph(RenderingContext& ctx)
 
 	ctx.m_unprojParams = ctx.m_renderQueue->m_projectionMatrix.extractPerspectiveUnprojectionParams();
 
+	requestStreamedResources(*ctx.m_renderQueue);
+
 	// Check if resources got loaded
 	if(m_prevLoadRequestCount != m_resources->getLoadingRequestCount()
 	   || m_prevAsyncTasksCompleted != m_resources->getAsyncTaskCompletedCount())
@@ -553,6 +559,63 @@ TexturePtr Renderer::createAndClearRenderTarget(const TextureInitInfo& inf, cons
 	return tex;
 }
 
+void Renderer::requestStreamedResources(const RenderQueue& rqueue) const
+{
+	TextureStreamer* textureStreamer = m_resources->getTextureStreamer();
+	MeshStreamer* meshStreamer = m_resources->getMeshStreamer();
+	if(!textureStreamer && !meshStreamer)
+	{
+		return;
+	}
+
+	ANKI_TRACE_SCOPED_EVENT(R_REQUEST_STREAMED_RESOURCES);
+
+	// The pixels that a world unit covers at a distance of one world unit
+	const F32 pixelsPerWorldUnitAtUnitDistance = F32(m_height) / (2.0f * tan(rqueue.m_cameraFovY / 2.0f));
+
+	auto request = [&](ConstWeakArray<RenderableQueueElement> renderables) {
+		for(const RenderableQueueElement& el : renderables)
+		{
+			if(!el.m_modelPatch)
+			{
+				continue;
+			}
+
+			const ModelPatch& patch = *el.m_modelPatch;
+
+			if(meshStreamer)
+			{
+				meshStreamer->requestLod(patch, el.m_lod);
+			}
+
+			if(!textureStreamer)
+			{
+				continue;
+			}
+
+			const F32 distance = max(el.m_distanceFromCamera, rqueue.m_cameraNear);
+			const F32 pixelsPerWorldUnit = pixelsPerWorldUnitAtUnitDistance / distance;
+			const F32 uvDensity = patch.getMesh(el.m_lod)->getUvDensity();
+
+			for(const MaterialVariable& mvar : patch.getMaterial()->getVariables())
+			{
+				if(!mvar.isTexture() || !mvar.getValue<TextureResourcePtr>().isCreated())
+				{
+					continue;
+				}
+
+				const TextureResource& tex = *mvar.getValue<TextureResourcePtr>();
+				const U32 textureSize = max(tex.getWidth(), tex.getHeight());
+				const U32 mip = TextureStreamer::computeMip(textureSize, uvDensity, pixelsPerWorldUnit);
+				textureStreamer->requestMip(tex, mip);
+			}
+		}
+	};
+
+	request(rqueue.m_renderables);
+	request(rqueue.m_forwardShadingRenderables);
+}
+
 void Renderer::updateLightShadingUniforms(RenderingContext& ctx) const
 {
 	LightingUniforms* blk = static_cast<LightingUniforms*>(m_stagingMem->allocateFrame(
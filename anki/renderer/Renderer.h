@@ -469,6 +469,9 @@ private:
 	void initJitteredMats();
 
 	void updateLightShadingUniforms(RenderingContext& ctx) const;
+
+	/// Ask the MeshStreamer and the TextureStreamer for the LODs and the mips that the visible renderables need.
+	void requestStreamedResources(const RenderQueue& rqueue) const;
 };
 /// @}
 
@@ -41,6 +41,13 @@ public:
 	Bool m_blur;
 };
 
+/// A rough estimate of the portion of the screen that a sphere covers.
+static F32 computeScreenSpaceSize(const Vec4& cameraOrigin, const Vec4& sphereCenter, F32 sphereRadius)
+{
+	const F32 dist = (sphereCenter - cameraOrigin).getLength();
+	return (dist > sphereRadius) ? (sphereRadius / dist) : 1.0f;
+}
+
 ShadowMapping::~ShadowMapping()
 {
 }
@@ -111,6 +118,7 @@ Error ShadowMapping::initAtlas(const ConfigSet& cfg)
 	// Tiles
 	m_atlas.m_tileAlloc.init(getAllocator(), m_atlas.m_tileCountBothAxis, m_atlas.m_tileCountBothAxis, MAX_LOD_COUNT,
 							 true);
+	m_atlas.m_tileAlloc.setRefreshBudget(cfg.getNumberU32("r_shadowMappingMaxTileRefreshesPerFrame"));
 
 	// Programs and shaders
 	{
@@ -344,7 +352,7 @@ void ShadowMapping::chooseLod(const Vec4& cameraOrigin, const SpotLightQueueElem
 
 TileAllocatorResult ShadowMapping::allocateTilesAndScratchTiles(U64 lightUuid, U32 faceCount, const U64* faceTimestamps,
 																const U32* faceIndices, const U32* drawcallsCount,
-																const U32* lods, Viewport* atlasTileViewports,
+																U32* lods, Bool budgeted, Viewport* atlasTileViewports,
 																Viewport* scratchTileViewports,
 																TileAllocatorResult* subResults)
 {
@@ -356,30 +364,73 @@ TileAllocatorResult ShadowMapping::allocateTilesAndScratchTiles(U64 lightUuid, U
 	ANKI_ASSERT(lods);
 
 	TileAllocatorResult res = TileAllocatorResult::ALLOCATION_FAILED;
+	const Timestamp crntTimestamp = m_r->getGlobalTimestamp();
 
 	// Allocate atlas tiles first. They may be cached and that will affect how many scratch tiles we'll need
-	for(U i = 0; i < faceCount; ++i)
+	U32 i = 0;
+	while(i < faceCount)
 	{
-		res = m_atlas.m_tileAlloc.allocate(m_r->getGlobalTimestamp(), faceTimestamps[i], lightUuid, faceIndices[i],
-										   drawcallsCount[i], lods[i], atlasTileViewports[i]);
+		if(budgeted)
+		{
+			// All faces should have the same tile size. The 1st face may get a smaller tile and the rest follow
+			U32 tileLod;
+			res = m_atlas.m_tileAlloc.allocate(crntTimestamp, faceTimestamps[i], lightUuid, faceIndices[i],
+											   drawcallsCount[i], lods[i], (i == 0) ? 0 : lods[i],
+											   atlasTileViewports[i], tileLod);
+
+			if(res == TileAllocatorResult::ALLOCATION_FAILED && i > 0 && lods[i] > 0)
+			{
+				// Some face didn't fit, try again with smaller tiles for all faces. Free the tiles of the faces that
+				// fit so they don't take space or refresh budget from the retry
+				const U32 newLod = lods[i] - 1;
+				for(U32 j = 0; j < faceCount; ++j)
+				{
+					if(j < i)
+					{
+						m_atlas.m_tileAlloc.release(lightUuid, faceIndices[j]);
+					}
+
+					lods[j] = newLod;
+				}
+
+				i = 0;
+				continue;
+			}
+			else if(res != TileAllocatorResult::ALLOCATION_FAILED && i == 0)
+			{
+				for(U32 j = 0; j < faceCount; ++j)
+				{
+					lods[j] = tileLod;
+				}
+			}
+		}
+		else
+		{
+			res = m_atlas.m_tileAlloc.allocate(crntTimestamp, faceTimestamps[i], lightUuid, faceIndices[i],
+											   drawcallsCount[i], lods[i], atlasTileViewports[i]);
+		}
 
 		if(res == TileAllocatorResult::ALLOCATION_FAILED)
 		{
 			ANKI_R_LOGW("There is not enough space in the shadow atlas for more shadow maps. "
 						"Increase the r_shadowMappingTileCountPerRowOrColumn or decrease the scene's shadow casters");
 
-			// Invalidate cache entries for what we already allocated
-			for(U j = 0; j < i; ++j)
+			// Free what we already allocated
+			for(U32 j = 0; j < i; ++j)
 			{
-				m_atlas.m_tileAlloc.invalidateCache(lightUuid, faceIndices[j]);
+				m_atlas.m_tileAlloc.release(lightUuid, faceIndices[j]);
 			}
 
 			return res;
 		}
 
 		subResults[i] = res;
+		++i;
+	}
 
-		// Fix viewport
+	// Fix the viewports
+	for(i = 0; i < faceCount; ++i)
+	{
 		atlasTileViewports[i][0] *= m_atlas.m_tileResolution;
 		atlasTileViewports[i][1] *= m_atlas.m_tileResolution;
 		atlasTileViewports[i][2] *= m_atlas.m_tileResolution;
@@ -387,7 +438,7 @@ TileAllocatorResult ShadowMapping::allocateTilesAndScratchTiles(U64 lightUuid, U
 	}
 
 	// Allocate scratch tiles
-	for(U i = 0; i < faceCount; ++i)
+	for(i = 0; i < faceCount; ++i)
 	{
 		if(subResults[i] == TileAllocatorResult::CACHED)
 		{
@@ -396,7 +447,7 @@ TileAllocatorResult ShadowMapping::allocateTilesAndScratchTiles(U64 lightUuid, U
 
 		ANKI_ASSERT(subResults[i] == TileAllocatorResult::ALLOCATION_SUCCEEDED);
 
-		res = m_scratch.m_tileAlloc.allocate(m_r->getGlobalTimestamp(), faceTimestamps[i], lightUuid, faceIndices[i],
+		res = m_scratch.m_tileAlloc.allocate(crntTimestamp, faceTimestamps[i], lightUuid, faceIndices[i],
 											 drawcallsCount[i], lods[i], scratchTileViewports[i]);
 
 		if(res == TileAllocatorResult::ALLOCATION_FAILED)
@@ -404,10 +455,10 @@ TileAllocatorResult ShadowMapping::allocateTilesAndScratchTiles(U64 lightUuid, U
 			ANKI_R_LOGW("Don't have enough space in the scratch shadow mapping buffer. "
 						"If you see this message too often increase r_shadowMappingScratchTileCountX/Y");
 
-			// Invalidate atlas tiles
+			// Free the atlas tiles
 			for(U j = 0; j < faceCount; ++j)
 			{
-				m_atlas.m_tileAlloc.invalidateCache(lightUuid, faceIndices[j]);
+				m_atlas.m_tileAlloc.release(lightUuid, faceIndices[j]);
 			}
 
 			return res;
@@ -429,6 +480,147 @@ TileAllocatorResult ShadowMapping::allocateTilesAndScratchTiles(U64 lightUuid, U
 	return res;
 }
 
+void ShadowMapping::processPointLight(PointLightQueueElement& light, const Vec4& cameraOrigin,
+									  const Viewport& emptyTileViewport,
+									  DynamicArrayAuto<Scratch::LightToRenderToScratchInfo>& lightsToRender,
+									  DynamicArrayAuto<Atlas::ResolveWorkItem>& atlasWorkItems, U32& drawcallCount)
+{
+	// Prepare data to allocate tiles and allocate
+	Array<U64, 6> timestamps;
+	Array<U32, 6> faceIndices;
+	Array<U32, 6> drawcallCounts;
+	Array<Viewport, 6> atlasViewports;
+	Array<Viewport, 6> scratchViewports;
+	Array<TileAllocatorResult, 6> subResults;
+	Array<U32, 6> lods;
+	U32 numOfFacesThatHaveDrawcalls = 0;
+
+	Bool blurAtlas;
+	U32 lod, renderQueueElementsLod;
+	chooseLod(cameraOrigin, light, blurAtlas, lod, renderQueueElementsLod);
+
+	for(U32 face = 0; face < 6; ++face)
+	{
+		ANKI_ASSERT(light.m_shadowRenderQueues[face]);
+		if(light.m_shadowRenderQueues[face]->m_renderables.getSize())
+		{
+			// Has renderables, need to allocate tiles for it so add it to the arrays
+
+			faceIndices[numOfFacesThatHaveDrawcalls] = face;
+			timestamps[numOfFacesThatHaveDrawcalls] =
+				light.m_shadowRenderQueues[face]->m_shadowRenderablesLastUpdateTimestamp;
+
+			drawcallCounts[numOfFacesThatHaveDrawcalls] = light.m_shadowRenderQueues[face]->m_renderables.getSize();
+
+			lods[numOfFacesThatHaveDrawcalls] = lod;
+
+			++numOfFacesThatHaveDrawcalls;
+		}
+	}
+
+	const Bool allocationFailed =
+		numOfFacesThatHaveDrawcalls == 0
+		|| allocateTilesAndScratchTiles(light.m_uuid, numOfFacesThatHaveDrawcalls, &timestamps[0], &faceIndices[0],
+										&drawcallCounts[0], &lods[0], true, &atlasViewports[0],
+										&scratchViewports[0], &subResults[0])
+			   == TileAllocatorResult::ALLOCATION_FAILED;
+
+	if(!allocationFailed)
+	{
+		// All good, update the lights
+
+		const F32 atlasResolution = F32(m_atlas.m_tileResolution * m_atlas.m_tileCountBothAxis);
+		F32 superTileSize = F32(atlasViewports[0][2]); // Should be the same for all tiles and faces
+		superTileSize -= 1.0f; // Remove 2 half texels to avoid bilinear filtering bleeding
+
+		light.m_shadowAtlasTileSize = superTileSize / atlasResolution;
+
+		numOfFacesThatHaveDrawcalls = 0;
+		for(U face = 0; face < 6; ++face)
+		{
+			if(light.m_shadowRenderQueues[face]->m_renderables.getSize())
+			{
+				// Has drawcalls, asigned it to a tile
+
+				const Viewport& atlasViewport = atlasViewports[numOfFacesThatHaveDrawcalls];
+				const Viewport& scratchViewport = scratchViewports[numOfFacesThatHaveDrawcalls];
+
+				// Add a half texel to the viewport's start to avoid bilinear filtering bleeding
+				light.m_shadowAtlasTileOffsets[face].x() = (F32(atlasViewport[0]) + 0.5f) / atlasResolution;
+				light.m_shadowAtlasTileOffsets[face].y() = (F32(atlasViewport[1]) + 0.5f) / atlasResolution;
+
+				if(subResults[numOfFacesThatHaveDrawcalls] != TileAllocatorResult::CACHED)
+				{
+					newScratchAndAtlasResloveRenderWorkItems(
+						atlasViewport, scratchViewport, blurAtlas, light.m_shadowRenderQueues[face],
+						renderQueueElementsLod, lightsToRender, atlasWorkItems, drawcallCount);
+				}
+
+				++numOfFacesThatHaveDrawcalls;
+			}
+			else
+			{
+				// Doesn't have renderables, point the face to the empty tile
+				Viewport atlasViewport = emptyTileViewport;
+				ANKI_ASSERT(F32(atlasViewport[2]) <= superTileSize && F32(atlasViewport[3]) <= superTileSize);
+				atlasViewport[2] = U32(superTileSize);
+				atlasViewport[3] = U32(superTileSize);
+
+				light.m_shadowAtlasTileOffsets[face].x() = (F32(atlasViewport[0]) + 0.5f) / atlasResolution;
+				light.m_shadowAtlasTileOffsets[face].y() = (F32(atlasViewport[1]) + 0.5f) / atlasResolution;
+			}
+		}
+	}
+	else
+	{
+		// Light can't be a caster this frame
+		zeroMemory(light.m_shadowRenderQueues);
+	}
+}
+
+void ShadowMapping::processSpotLight(SpotLightQueueElement& light, const Vec4& cameraOrigin,
+									 DynamicArrayAuto<Scratch::LightToRenderToScratchInfo>& lightsToRender,
+									 DynamicArrayAuto<Atlas::ResolveWorkItem>& atlasWorkItems, U32& drawcallCount)
+{
+	// Allocate tiles
+	U32 faceIdx = 0;
+	TileAllocatorResult subResult;
+	Viewport atlasViewport;
+	Viewport scratchViewport;
+	const U32 localDrawcallCount = light.m_shadowRenderQueue->m_renderables.getSize();
+
+	Bool blurAtlas;
+	U32 lod, renderQueueElementsLod;
+	chooseLod(cameraOrigin, light, blurAtlas, lod, renderQueueElementsLod);
+
+	const Bool allocationFailed =
+		localDrawcallCount == 0
+		|| allocateTilesAndScratchTiles(
+			   light.m_uuid, 1, &light.m_shadowRenderQueue->m_shadowRenderablesLastUpdateTimestamp, &faceIdx,
+			   &localDrawcallCount, &lod, true, &atlasViewport, &scratchViewport, &subResult)
+			   == TileAllocatorResult::ALLOCATION_FAILED;
+
+	if(!allocationFailed)
+	{
+		// All good, update the light
+
+		// Update the texture matrix to point to the correct region in the atlas
+		light.m_textureMatrix = createSpotLightTextureMatrix(atlasViewport) * light.m_textureMatrix;
+
+		if(subResult != TileAllocatorResult::CACHED)
+		{
+			newScratchAndAtlasResloveRenderWorkItems(atlasViewport, scratchViewport, blurAtlas,
+													 light.m_shadowRenderQueue, renderQueueElementsLod,
+													 lightsToRender, atlasWorkItems, drawcallCount);
+		}
+	}
+	else
+	{
+		// Doesn't have renderables or the allocation failed, won't be a shadow caster
+		light.m_shadowRenderQueue = nullptr;
+	}
+}
+
 void ShadowMapping::processLights(RenderingContext& ctx, U32& threadCountForScratchPass)
 {
 	// Reset the scratch viewport width
@@ -502,8 +694,8 @@ void ShadowMapping::processLights(RenderingContext& ctx, U32& threadCountForScra
 		const Bool allocationFailed =
 			activeCascades == 0
 			|| allocateTilesAndScratchTiles(light.m_uuid, activeCascades, &timestamps[0], &cascadeIndices[0],
-											&drawcallCounts[0], &lods[0], &atlasViewports[0], &scratchViewports[0],
-											&subResults[0])
+											&drawcallCounts[0], &lods[0], false, &atlasViewports[0],
+											&scratchViewports[0], &subResults[0])
 				   == TileAllocatorResult::ALLOCATION_FAILED;
 
 		if(!allocationFailed)
@@ -545,154 +737,84 @@ void ShadowMapping::processLights(RenderingContext& ctx, U32& threadCountForScra
 		}
 	}
 
-	// Process the point lights.
-	for(PointLightQueueElement& light : ctx.m_renderQueue->m_pointLights)
+	// Process the point and spot lights. Process the most important first because they are the ones that will be
+	// refreshed before the refresh budget of the atlas is spent
+	class LightToProcess
+	{
+	public:
+		F32 m_priority;
+		U32 m_lightIdx;
+		Bool m_spot;
+	};
+
+	DynamicArrayAuto<LightToProcess> lightsToProcess(ctx.m_tempAllocator);
+	const Timestamp crntTimestamp = m_r->getGlobalTimestamp();
+
+	for(U32 lightIdx = 0; lightIdx < ctx.m_renderQueue->m_pointLights.getSize(); ++lightIdx)
 	{
+		const PointLightQueueElement& light = ctx.m_renderQueue->m_pointLights[lightIdx];
 		if(!light.hasShadow())
 		{
 			continue;
 		}
 
-		// Prepare data to allocate tiles and allocate
-		Array<U64, 6> timestamps;
-		Array<U32, 6> faceIndices;
-		Array<U32, 6> drawcallCounts;
-		Array<Viewport, 6> atlasViewports;
-		Array<Viewport, 6> scratchViewports;
-		Array<TileAllocatorResult, 6> subResults;
-		Array<U32, 6> lods;
-		U32 numOfFacesThatHaveDrawcalls = 0;
-
-		Bool blurAtlas;
-		U32 lod, renderQueueElementsLod;
-		chooseLod(cameraOrigin, light, blurAtlas, lod, renderQueueElementsLod);
+		const F32 screenSpaceSize = computeScreenSpaceSize(cameraOrigin, light.m_worldPosition.xyz0(), light.m_radius);
 
+		F32 priority = 0.0f;
 		for(U32 face = 0; face < 6; ++face)
 		{
-			ANKI_ASSERT(light.m_shadowRenderQueues[face]);
 			if(light.m_shadowRenderQueues[face]->m_renderables.getSize())
 			{
-				// Has renderables, need to allocate tiles for it so add it to the arrays
-
-				faceIndices[numOfFacesThatHaveDrawcalls] = face;
-				timestamps[numOfFacesThatHaveDrawcalls] =
-					light.m_shadowRenderQueues[face]->m_shadowRenderablesLastUpdateTimestamp;
-
-				drawcallCounts[numOfFacesThatHaveDrawcalls] = light.m_shadowRenderQueues[face]->m_renderables.getSize();
-
-				lods[numOfFacesThatHaveDrawcalls] = lod;
-
-				++numOfFacesThatHaveDrawcalls;
+				priority = max(priority, m_atlas.m_tileAlloc.computeRefreshPriority(crntTimestamp, light.m_uuid, face,
+																					screenSpaceSize));
 			}
 		}
 
-		const Bool allocationFailed =
-			numOfFacesThatHaveDrawcalls == 0
-			|| allocateTilesAndScratchTiles(light.m_uuid, numOfFacesThatHaveDrawcalls, &timestamps[0], &faceIndices[0],
-											&drawcallCounts[0], &lods[0], &atlasViewports[0], &scratchViewports[0],
-											&subResults[0])
-				   == TileAllocatorResult::ALLOCATION_FAILED;
-
-		if(!allocationFailed)
-		{
-			// All good, update the lights
-
-			const F32 atlasResolution = F32(m_atlas.m_tileResolution * m_atlas.m_tileCountBothAxis);
-			F32 superTileSize = F32(atlasViewports[0][2]); // Should be the same for all tiles and faces
-			superTileSize -= 1.0f; // Remove 2 half texels to avoid bilinear filtering bleeding
-
-			light.m_shadowAtlasTileSize = superTileSize / atlasResolution;
-
-			numOfFacesThatHaveDrawcalls = 0;
-			for(U face = 0; face < 6; ++face)
-			{
-				if(light.m_shadowRenderQueues[face]->m_renderables.getSize())
-				{
-					// Has drawcalls, asigned it to a tile
-
-					const Viewport& atlasViewport = atlasViewports[numOfFacesThatHaveDrawcalls];
-					const Viewport& scratchViewport = scratchViewports[numOfFacesThatHaveDrawcalls];
-
-					// Add a half texel to the viewport's start to avoid bilinear filtering bleeding
-					light.m_shadowAtlasTileOffsets[face].x() = (F32(atlasViewport[0]) + 0.5f) / atlasResolution;
-					light.m_shadowAtlasTileOffsets[face].y() = (F32(atlasViewport[1]) + 0.5f) / atlasResolution;
-
-					if(subResults[numOfFacesThatHaveDrawcalls] != TileAllocatorResult::CACHED)
-					{
-						newScratchAndAtlasResloveRenderWorkItems(
-							atlasViewport, scratchViewport, blurAtlas, light.m_shadowRenderQueues[face],
-							renderQueueElementsLod, lightsToRender, atlasWorkItems, drawcallCount);
-					}
-
-					++numOfFacesThatHaveDrawcalls;
-				}
-				else
-				{
-					// Doesn't have renderables, point the face to the empty tile
-					Viewport atlasViewport = emptyTileViewport;
-					ANKI_ASSERT(F32(atlasViewport[2]) <= superTileSize && F32(atlasViewport[3]) <= superTileSize);
-					atlasViewport[2] = U32(superTileSize);
-					atlasViewport[3] = U32(superTileSize);
-
-					light.m_shadowAtlasTileOffsets[face].x() = (F32(atlasViewport[0]) + 0.5f) / atlasResolution;
-					light.m_shadowAtlasTileOffsets[face].y() = (F32(atlasViewport[1]) + 0.5f) / atlasResolution;
-				}
-			}
-		}
-		else
-		{
-			// Light can't be a caster this frame
-			zeroMemory(light.m_shadowRenderQueues);
-		}
+		lightsToProcess.emplaceBack(LightToProcess{priority, lightIdx, false});
 	}
 
-	// Process the spot lights
-	for(SpotLightQueueElement& light : ctx.m_renderQueue->m_spotLights)
+	for(U32 lightIdx = 0; lightIdx < ctx.m_renderQueue->m_spotLights.getSize(); ++lightIdx)
 	{
+		const SpotLightQueueElement& light = ctx.m_renderQueue->m_spotLights[lightIdx];
 		if(!light.hasShadow())
 		{
 			continue;
 		}
 
-		// Allocate tiles
-		U32 faceIdx = 0;
-		TileAllocatorResult subResult;
-		Viewport atlasViewport;
-		Viewport scratchViewport;
-		const U32 localDrawcallCount = light.m_shadowRenderQueue->m_renderables.getSize();
+		// Use the sphere that bounds the cone
+		const Vec4 coneOrigin = light.m_worldTransform.getTranslationPart().xyz0();
+		const Vec4 coneDir = -light.m_worldTransform.getZAxis().xyz0();
+		const F32 screenSpaceSize =
+			computeScreenSpaceSize(cameraOrigin, coneOrigin + coneDir * (light.m_distance / 2.0f),
+								   light.m_distance / 2.0f);
 
-		Bool blurAtlas;
-		U32 lod, renderQueueElementsLod;
-		chooseLod(cameraOrigin, light, blurAtlas, lod, renderQueueElementsLod);
+		const F32 priority =
+			m_atlas.m_tileAlloc.computeRefreshPriority(crntTimestamp, light.m_uuid, 0, screenSpaceSize);
 
-		const Bool allocationFailed =
-			localDrawcallCount == 0
-			|| allocateTilesAndScratchTiles(
-				   light.m_uuid, 1, &light.m_shadowRenderQueue->m_shadowRenderablesLastUpdateTimestamp, &faceIdx,
-				   &localDrawcallCount, &lod, &atlasViewport, &scratchViewport, &subResult)
-				   == TileAllocatorResult::ALLOCATION_FAILED;
-
-		if(!allocationFailed)
-		{
-			// All good, update the light
+		lightsToProcess.emplaceBack(LightToProcess{priority, lightIdx, true});
+	}
 
-			// Update the texture matrix to point to the correct region in the atlas
-			light.m_textureMatrix = createSpotLightTextureMatrix(atlasViewport) * light.m_textureMatrix;
+	std::sort(lightsToProcess.getBegin(), lightsToProcess.getEnd(),
+			  [](const LightToProcess& a, const LightToProcess& b) { return a.m_priority > b.m_priority; });
 
-			if(subResult != TileAllocatorResult::CACHED)
-			{
-				newScratchAndAtlasResloveRenderWorkItems(atlasViewport, scratchViewport, blurAtlas,
-														 light.m_shadowRenderQueue, renderQueueElementsLod,
-														 lightsToRender, atlasWorkItems, drawcallCount);
-			}
+	for(const LightToProcess& lightToProcess : lightsToProcess)
+	{
+		if(lightToProcess.m_spot)
+		{
+			processSpotLight(ctx.m_renderQueue->m_spotLights[lightToProcess.m_lightIdx], cameraOrigin, lightsToRender,
+							 atlasWorkItems, drawcallCount);
 		}
 		else
 		{
-			// Doesn't have renderables or the allocation failed, won't be a shadow caster
-			light.m_shadowRenderQueue = nullptr;
+			processPointLight(ctx.m_renderQueue->m_pointLights[lightToProcess.m_lightIdx], cameraOrigin,
+							  emptyTileViewport, lightsToRender, atlasWorkItems, drawcallCount);
 		}
 	}
 
+	ANKI_TRACE_INC_COUNTER(R_SHADOW_TILE_REFRESHES, m_atlas.m_tileAlloc.getRefreshCount());
+	ANKI_TRACE_INC_COUNTER(R_SHADOW_TILE_DEFERRED_REFRESHES, m_atlas.m_tileAlloc.getDeferredRefreshCount());
+	ANKI_TRACE_INC_COUNTER(R_SHADOW_TILE_DOWNGRADES, m_atlas.m_tileAlloc.getDowngradeCount());
+
 	// Split the work that will happen in the scratch buffer
 	if(lightsToRender.getSize())
 	{
@@ -112,10 +112,12 @@ private:
 				   U32& renderQueueElementsLod) const;
 
 	/// Try to allocate a number of scratch tiles and regular tiles.
+	/// @param[in,out] lods The LODs of the tiles. If @a budgeted is true they may be lowered.
+	/// @param budgeted If true the atlas tiles respect the refresh budget and they can be downgraded to smaller tiles.
 	TileAllocatorResult allocateTilesAndScratchTiles(U64 lightUuid, U32 faceCount, const U64* faceTimestamps,
-													 const U32* faceIndices, const U32* drawcallsCount, const U32* lods,
-													 Viewport* atlasTileViewports, Viewport* scratchTileViewports,
-													 TileAllocatorResult* subResults);
+													 const U32* faceIndices, const U32* drawcallsCount, U32* lods,
+													 Bool budgeted, Viewport* atlasTileViewports,
+													 Viewport* scratchTileViewports, TileAllocatorResult* subResults);
 
 	/// Add new work to render to scratch buffer and atlas buffer.
 	void newScratchAndAtlasResloveRenderWorkItems(
@@ -126,6 +128,14 @@ private:
 	/// Iterate lights and create work items.
 	void processLights(RenderingContext& ctx, U32& threadCountForScratchPass);
 
+	void processPointLight(PointLightQueueElement& light, const Vec4& cameraOrigin, const Viewport& emptyTileViewport,
+						   DynamicArrayAuto<Scratch::LightToRenderToScratchInfo>& lightsToRender,
+						   DynamicArrayAuto<Atlas::ResolveWorkItem>& atlasWorkItems, U32& drawcallCount);
+
+	void processSpotLight(SpotLightQueueElement& light, const Vec4& cameraOrigin,
+						  DynamicArrayAuto<Scratch::LightToRenderToScratchInfo>& lightsToRender,
+						  DynamicArrayAuto<Atlas::ResolveWorkItem>& atlasWorkItems, U32& drawcallCount);
+
 	ANKI_USE_RESULT Error initInternal(const ConfigSet& config);
 	/// @}
 };
@@ -203,6 +203,7 @@ void Ssao::populateRenderGraph(RenderingContext& ctx)
 		if(m_useCompute)
 		{
 			ComputeRenderPassDescription& pass = rgraph.newComputeRenderPass("SSAO main");
+			pass.setQueueHint(GpuQueueType::ASYNC_COMPUTE);
 
 			if(m_useNormal)
 			{
@@ -248,6 +249,7 @@ void Ssao::populateRenderGraph(RenderingContext& ctx)
 		if(m_blurUseCompute)
 		{
 			ComputeRenderPassDescription& pass = rgraph.newComputeRenderPass("SSAO blur");
+			pass.setQueueHint(GpuQueueType::ASYNC_COMPUTE);
 
 			pass.setWork(
 				[](RenderPassWorkContext& rgraphCtx) {
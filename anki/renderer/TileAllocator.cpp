@@ -18,6 +18,8 @@ public:
 	Array<U32, 4> m_viewport = {};
 	Array<U32, 4> m_subTiles = {MAX_U32, MAX_U32, MAX_U32, MAX_U32};
 	U32 m_superTile = MAX_U32;
+	Timestamp m_refreshDeferredTimestamp = 0; ///< The first timestamp the tile got out of date. 0 if it's up to date
+	Timestamp m_refreshTimestamp = 0; ///< The last timestamp that counted the tile in the refresh budget.
 	U8 m_lightLod = 0;
 	U8 m_lightFace = 0;
 };
@@ -34,6 +36,15 @@ public:
 	}
 };
 
+class TileAllocator::SearchResult
+{
+public:
+	U32 m_emptyTileIdx = MAX_U32;
+	U32 m_toKickTileIdx = MAX_U32;
+	Timestamp m_toKickTileTimestamp = MAX_TIMESTAMP;
+	Bool m_toKickTileHasBusySiblings = false;
+};
+
 TileAllocator::~TileAllocator()
 {
 	m_lightInfoToTileIdx.destroy(m_alloc);
@@ -148,8 +159,7 @@ void TileAllocator::updateSuperTiles(const Tile& updateFrom)
 }
 
 Bool TileAllocator::searchTileRecursively(U32 crntTileIdx, U32 crntTileLod, U32 allocationLod, Timestamp crntTimestamp,
-										  U32& emptyTileIdx, U32& toKickTileIdx,
-										  Timestamp& tileToKickMinTimestamp) const
+										  SearchResult& result) const
 {
 	const Tile& tile = m_allTiles[crntTileIdx];
 
@@ -157,8 +167,7 @@ Bool TileAllocator::searchTileRecursively(U32 crntTileIdx, U32 crntTileLod, U32
 	{
 		// We may have a candidate
 
-		const Bool done =
-			evaluateCandidate(crntTileIdx, crntTimestamp, emptyTileIdx, toKickTileIdx, tileToKickMinTimestamp);
+		const Bool done = evaluateCandidate(crntTileIdx, crntTimestamp, result);
 
 		if(done)
 		{
@@ -173,8 +182,7 @@ Bool TileAllocator::searchTileRecursively(U32 crntTileIdx, U32 crntTileLod, U32
 
 		for(const U32 idx : tile.m_subTiles)
 		{
-			const Bool done = searchTileRecursively(idx, crntTileLod >> 1, allocationLod, crntTimestamp, emptyTileIdx,
-													toKickTileIdx, tileToKickMinTimestamp);
+			const Bool done = searchTileRecursively(idx, crntTileLod - 1, allocationLod, crntTimestamp, result);
 
 			if(done)
 			{
@@ -186,31 +194,50 @@ Bool TileAllocator::searchTileRecursively(U32 crntTileIdx, U32 crntTileLod, U32
 	return false;
 }
 
-Bool TileAllocator::evaluateCandidate(U32 tileIdx, Timestamp crntTimestamp, U32& emptyTileIdx, U32& toKickTileIdx,
-									  Timestamp& tileToKickMinTimestamp) const
+Bool TileAllocator::evaluateCandidate(U32 tileIdx, Timestamp crntTimestamp, SearchResult& result) const
 {
 	const Tile& tile = m_allTiles[tileIdx];
 
 	if(m_cachingEnabled)
 	{
+		const Tile* superTile = (tile.m_superTile != MAX_U32) ? &m_allTiles[tile.m_superTile] : nullptr;
+
 		if(tile.m_lastUsedTimestamp == 0)
 		{
-			// Found empty
-			emptyTileIdx = tileIdx;
-			return true;
+			// Found empty. Prefer the empty tiles that have siblings in use to keep the larger tiles free
+
+			if(superTile == nullptr || superTile->m_lastUsedTimestamp != 0)
+			{
+				result.m_emptyTileIdx = tileIdx;
+				return true;
+			}
+			else if(result.m_emptyTileIdx == MAX_U32)
+			{
+				result.m_emptyTileIdx = tileIdx;
+			}
 		}
-		else if(tile.m_lastUsedTimestamp != crntTimestamp && tile.m_lastUsedTimestamp < tileToKickMinTimestamp)
+		else if(tile.m_lastUsedTimestamp != crntTimestamp)
 		{
-			// Found one with low timestamp
-			toKickTileIdx = tileIdx;
-			tileToKickMinTimestamp = tile.m_lightTimestamp;
+			// Found one that can be kicked. Prefer the ones with siblings in use in this timestamp and then the least
+			// recently used
+
+			const Bool busySiblings = superTile && superTile->m_lastUsedTimestamp == crntTimestamp;
+
+			if((busySiblings && !result.m_toKickTileHasBusySiblings)
+			   || (busySiblings == result.m_toKickTileHasBusySiblings
+				   && tile.m_lastUsedTimestamp < result.m_toKickTileTimestamp))
+			{
+				result.m_toKickTileIdx = tileIdx;
+				result.m_toKickTileTimestamp = tile.m_lastUsedTimestamp;
+				result.m_toKickTileHasBusySiblings = busySiblings;
+			}
 		}
 	}
 	else
 	{
 		if(tile.m_lastUsedTimestamp != crntTimestamp)
 		{
-			emptyTileIdx = tileIdx;
+			result.m_emptyTileIdx = tileIdx;
 			return true;
 		}
 	}
@@ -218,8 +245,62 @@ Bool TileAllocator::evaluateCandidate(U32 tileIdx, Timestamp crntTimestamp, U32&
 	return false;
 }
 
+U32 TileAllocator::findTile(U32 lod, Timestamp crntTimestamp) const
+{
+	// Do a hieratchical search to end up with better locality and not better utilization of the atlas' space
+	SearchResult result;
+	const U32 maxLod = m_lodCount - 1;
+	if(lod == maxLod)
+	{
+		// This search is simple, iterate the tiles of the max LOD
+
+		for(U32 tileIdx = m_lodFirstTileIndex[maxLod]; tileIdx <= m_lodFirstTileIndex[maxLod + 1]; ++tileIdx)
+		{
+			const Bool done = evaluateCandidate(tileIdx, crntTimestamp, result);
+
+			if(done)
+			{
+				break;
+			}
+		}
+	}
+	else
+	{
+		// Need to do a recursive search
+
+		for(U32 tileIdx = m_lodFirstTileIndex[maxLod]; tileIdx <= m_lodFirstTileIndex[maxLod + 1]; ++tileIdx)
+		{
+			const Bool done = searchTileRecursively(tileIdx, maxLod, lod, crntTimestamp, result);
+
+			if(done)
+			{
+				break;
+			}
+		}
+	}
+
+	return (result.m_emptyTileIdx != MAX_U32) ? result.m_emptyTileIdx : result.m_toKickTileIdx;
+}
+
 TileAllocatorResult TileAllocator::allocate(Timestamp crntTimestamp, Timestamp lightTimestamp, U64 lightUuid,
 											U32 lightFace, U32 drawcallCount, U32 lod, Array<U32, 4>& tileViewport)
+{
+	U32 tileLod;
+	return allocateInternal(crntTimestamp, lightTimestamp, lightUuid, lightFace, drawcallCount, lod, lod, false,
+							tileViewport, tileLod);
+}
+
+TileAllocatorResult TileAllocator::allocate(Timestamp crntTimestamp, Timestamp lightTimestamp, U64 lightUuid,
+											U32 lightFace, U32 drawcallCount, U32 lod, U32 minLod,
+											Array<U32, 4>& tileViewport, U32& tileLod)
+{
+	return allocateInternal(crntTimestamp, lightTimestamp, lightUuid, lightFace, drawcallCount, lod, minLod, true,
+							tileViewport, tileLod);
+}
+
+TileAllocatorResult TileAllocator::allocateInternal(Timestamp crntTimestamp, Timestamp lightTimestamp, U64 lightUuid,
+													U32 lightFace, U32 drawcallCount, U32 lod, U32 minLod,
+													Bool budgeted, Array<U32, 4>& tileViewport, U32& tileLod)
 {
 	// Preconditions
 	ANKI_ASSERT(crntTimestamp > 0);
@@ -228,98 +309,141 @@ TileAllocatorResult TileAllocator::allocate(Timestamp crntTimestamp, Timestamp l
 	ANKI_ASSERT(lightUuid != 0);
 	ANKI_ASSERT(lightFace < 6);
 	ANKI_ASSERT(lod < m_lodCount);
+	ANKI_ASSERT(minLod <= lod);
+
+	// New timestamp, reset the stats
+	if(m_statsTimestamp != crntTimestamp)
+	{
+		m_statsTimestamp = crntTimestamp;
+		m_refreshCount = 0;
+		m_deferredRefreshCount = 0;
+		m_downgradeCount = 0;
+	}
+
+	const Bool refreshBudgetSpent = budgeted && m_refreshBudget > 0 && m_refreshCount >= m_refreshBudget;
 
 	// 1) Search if it's already cached
 	HashMapKey key;
+	key.m_lightUuid = lightUuid;
+	key.m_face = lightFace;
+	U32 allocatedTileIdx = MAX_U32;
 	if(m_cachingEnabled)
 	{
-		key.m_lightUuid = lightUuid;
-		key.m_face = lightFace;
 		auto it = m_lightInfoToTileIdx.find(key);
 		if(it != m_lightInfoToTileIdx.getEnd())
 		{
 			Tile& tile = m_allTiles[*it];
 
-			if(tile.m_lightUuid != lightUuid || tile.m_lightLod != lod || tile.m_lightFace != lightFace)
+			Bool cacheHit = false;
+			if(tile.m_lightUuid != lightUuid || tile.m_lightLod > lod || tile.m_lightLod < minLod
+			   || tile.m_lightFace != lightFace)
 			{
 				// Cache entry is wrong, remove it
 				m_lightInfoToTileIdx.erase(m_alloc, it);
 			}
+			else if(tile.m_lightLod < lod && !refreshBudgetSpent)
+			{
+				// The light got a smaller tile in the past, try to move it to a tile of the requested size. The lights
+				// that will ask later in this timestamp may lose their tiles but they are supposed to be less important
+				allocatedTileIdx = findTile(lod, crntTimestamp);
+				if(allocatedTileIdx != MAX_U32)
+				{
+					*it = allocatedTileIdx;
+				}
+				else
+				{
+					cacheHit = true;
+				}
+			}
 			else
 			{
-				// Same light & lod & face, found the cache entry.
+				cacheHit = true;
+			}
+
+			if(cacheHit)
+			{
+				// Same light & face and acceptable lod, found the cache entry.
 
 				ANKI_ASSERT(tile.m_lastUsedTimestamp != crntTimestamp
 							&& "Trying to allocate the same thing twice in this timestamp?");
 
-				ANKI_ASSERT(tile.m_lightUuid == lightUuid && tile.m_lightLod == lod && tile.m_lightFace == lightFace);
-
 				tileViewport = {tile.m_viewport[0], tile.m_viewport[1], tile.m_viewport[2], tile.m_viewport[3]};
+				tileLod = tile.m_lightLod;
+				if(tileLod < lod)
+				{
+					++m_downgradeCount;
+				}
 
 				const Bool needsReRendering =
 					tile.m_lightDrawcallCount != drawcallCount || tile.m_lightTimestamp != lightTimestamp;
 
-				tile.m_lightTimestamp = lightTimestamp;
 				tile.m_lastUsedTimestamp = crntTimestamp;
-				tile.m_lightDrawcallCount = drawcallCount;
+
+				TileAllocatorResult res;
+				if(!needsReRendering)
+				{
+					res = TileAllocatorResult::CACHED;
+				}
+				else if(refreshBudgetSpent)
+				{
+					// Out of budget, keep the old content for now
+					if(tile.m_refreshDeferredTimestamp == 0)
+					{
+						tile.m_refreshDeferredTimestamp = crntTimestamp;
+					}
+
+					++m_deferredRefreshCount;
+					res = TileAllocatorResult::CACHED;
+				}
+				else
+				{
+					tile.m_lightTimestamp = lightTimestamp;
+					tile.m_lightDrawcallCount = drawcallCount;
+					tile.m_refreshDeferredTimestamp = 0;
+					tile.m_refreshTimestamp = crntTimestamp;
+
+					++m_refreshCount;
+					res = TileAllocatorResult::ALLOCATION_SUCCEEDED;
+				}
 
 				updateTileHierarchy(tile);
 
-				return (needsReRendering) ? TileAllocatorResult::ALLOCATION_SUCCEEDED : TileAllocatorResult::CACHED;
+				return res;
 			}
 		}
 	}
 
-	// Start searching for a suitable tile. Do a hieratchical search to end up with better locality and not better
-	// utilization of the atlas' space
-	U32 emptyTileIdx = MAX_U32;
-	U32 toKickTileIdx = MAX_U32;
-	Timestamp tileToKickMinTimestamp = MAX_TIMESTAMP;
-	const U32 maxLod = m_lodCount - 1;
-	if(lod == maxLod)
+	// 2) Search for a suitable tile. Try smaller tiles if there is no space
+	if(allocatedTileIdx == MAX_U32)
 	{
-		// This search is simple, iterate the tiles of the max LOD
-
-		for(U32 tileIdx = m_lodFirstTileIndex[maxLod]; tileIdx <= m_lodFirstTileIndex[maxLod + 1]; ++tileIdx)
+		tileLod = lod;
+		allocatedTileIdx = findTile(tileLod, crntTimestamp);
+		while(allocatedTileIdx == MAX_U32 && tileLod > minLod)
 		{
-			const Bool done =
-				evaluateCandidate(tileIdx, crntTimestamp, emptyTileIdx, toKickTileIdx, tileToKickMinTimestamp);
-
-			if(done)
-			{
-				break;
-			}
+			--tileLod;
+			allocatedTileIdx = findTile(tileLod, crntTimestamp);
 		}
-	}
-	else
-	{
-		// Need to do a recursive search
 
-		for(U32 tileIdx = m_lodFirstTileIndex[maxLod]; tileIdx <= m_lodFirstTileIndex[maxLod + 1]; ++tileIdx)
+		if(allocatedTileIdx == MAX_U32)
 		{
-			const Bool done = searchTileRecursively(tileIdx, maxLod, lod, crntTimestamp, emptyTileIdx, toKickTileIdx,
-													tileToKickMinTimestamp);
+			// Out of tiles
+			return TileAllocatorResult::ALLOCATION_FAILED;
+		}
 
-			if(done)
-			{
-				break;
-			}
+		if(tileLod < lod)
+		{
+			++m_downgradeCount;
 		}
-	}
 
-	U32 allocatedTileIdx;
-	if(emptyTileIdx != MAX_U32)
-	{
-		allocatedTileIdx = emptyTileIdx;
-	}
-	else if(toKickTileIdx != MAX_U32)
-	{
-		allocatedTileIdx = toKickTileIdx;
+		// Update the cache
+		if(m_cachingEnabled)
+		{
+			m_lightInfoToTileIdx.emplace(m_alloc, key, allocatedTileIdx);
+		}
 	}
 	else
 	{
-		// Out of tiles
-		return TileAllocatorResult::ALLOCATION_FAILED;
+		tileLod = lod;
 	}
 
 	// Allocation succedded, need to do some bookkeeping
@@ -330,16 +454,14 @@ TileAllocatorResult TileAllocator::allocate(Timestamp crntTimestamp, Timestamp l
 	allocatedTile.m_lastUsedTimestamp = crntTimestamp;
 	allocatedTile.m_lightUuid = lightUuid;
 	allocatedTile.m_lightDrawcallCount = drawcallCount;
-	allocatedTile.m_lightLod = U8(lod);
+	allocatedTile.m_refreshDeferredTimestamp = 0;
+	allocatedTile.m_refreshTimestamp = crntTimestamp;
+	allocatedTile.m_lightLod = U8(tileLod);
 	allocatedTile.m_lightFace = U8(lightFace);
 
 	updateTileHierarchy(allocatedTile);
 
-	// Update the cache
-	if(m_cachingEnabled)
-	{
-		m_lightInfoToTileIdx.emplace(m_alloc, key, allocatedTileIdx);
-	}
+	++m_refreshCount;
 
 	// Return
 	tileViewport = {allocatedTile.m_viewport[0], allocatedTile.m_viewport[1], allocatedTile.m_viewport[2],
@@ -348,6 +470,31 @@ TileAllocatorResult TileAllocator::allocate(Timestamp crntTimestamp, Timestamp l
 	return TileAllocatorResult::ALLOCATION_SUCCEEDED;
 }
 
+F32 TileAllocator::computeRefreshPriority(Timestamp crntTimestamp, U64 lightUuid, U32 lightFace,
+										  F32 screenSpaceSize) const
+{
+	ANKI_ASSERT(m_cachingEnabled);
+	ANKI_ASSERT(screenSpaceSize >= 0.0f);
+
+	HashMapKey key;
+	key.m_lightUuid = lightUuid;
+	key.m_face = lightFace;
+
+	auto it = m_lightInfoToTileIdx.find(key);
+	if(it == m_lightInfoToTileIdx.getEnd() || m_allTiles[*it].m_lightUuid != lightUuid
+	   || m_allTiles[*it].m_lightFace != lightFace)
+	{
+		// Doesn't have content, nothing to show if it doesn't get rendered
+		return MAX_F32;
+	}
+
+	const Tile& tile = m_allTiles[*it];
+	const Timestamp staleness =
+		(tile.m_refreshDeferredTimestamp != 0) ? (crntTimestamp - tile.m_refreshDeferredTimestamp + 1) : 0;
+
+	return screenSpaceSize * F32(staleness + 1);
+}
+
 void TileAllocator::invalidateCache(U64 lightUuid, U32 lightFace)
 {
 	ANKI_ASSERT(m_cachingEnabled);
@@ -364,4 +511,58 @@ void TileAllocator::invalidateCache(U64 lightUuid, U32 lightFace)
 	}
 }
 
+void TileAllocator::release(U64 lightUuid, U32 lightFace)
+{
+	ANKI_ASSERT(m_cachingEnabled);
+	ANKI_ASSERT(lightUuid > 0);
+
+	HashMapKey key;
+	key.m_lightUuid = lightUuid;
+	key.m_face = lightFace;
+
+	auto it = m_lightInfoToTileIdx.find(key);
+	if(it == m_lightInfoToTileIdx.getEnd())
+	{
+		return;
+	}
+
+	Tile& tile = m_allTiles[*it];
+	m_lightInfoToTileIdx.erase(m_alloc, it);
+	ANKI_ASSERT(tile.m_lightUuid == lightUuid && tile.m_lightFace == lightFace);
+	ANKI_ASSERT(tile.m_lastUsedTimestamp == m_statsTimestamp && "Can only release the tiles of this timestamp");
+
+	// Give back the refresh
+	if(tile.m_refreshTimestamp == m_statsTimestamp)
+	{
+		ANKI_ASSERT(m_refreshCount > 0);
+		--m_refreshCount;
+	}
+
+	// The tile might have been half allocated, don't trust its contents
+	tile.m_lightTimestamp = 0;
+	tile.m_lastUsedTimestamp = 0;
+	tile.m_lightUuid = 0;
+	tile.m_lightDrawcallCount = 0;
+	tile.m_refreshDeferredTimestamp = 0;
+	tile.m_refreshTimestamp = 0;
+	tile.m_lightLod = 0;
+	tile.m_lightFace = 0;
+
+	updateSubTiles(tile);
+
+	// The super tiles stay in use if their other sub tiles are
+	U32 superTileIdx = tile.m_superTile;
+	while(superTileIdx != MAX_U32)
+	{
+		Tile& superTile = m_allTiles[superTileIdx];
+		superTile.m_lastUsedTimestamp = 0;
+		for(U32 idx : superTile.m_subTiles)
+		{
+			superTile.m_lastUsedTimestamp = max(superTile.m_lastUsedTimestamp, m_allTiles[idx].m_lastUsedTimestamp);
+		}
+
+		superTileIdx = superTile.m_superTile;
+	}
+}
+
 } // end namespace anki
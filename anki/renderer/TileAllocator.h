@@ -21,7 +21,10 @@ enum class TileAllocatorResult : U32
 	ALLOCATION_SUCCEEDED ///< Allocation succeded but the tile needs update.
 };
 
-/// Allocates tiles out of a tilemap suitable for shadow mapping.
+/// Allocates tiles out of a tilemap suitable for shadow mapping. The tilemap is a quadtree where a tile of some LOD is
+/// made of 4 tiles of the previous LOD. Smaller tiles are packed into larger tiles that are already partially in use to
+/// keep the large tiles available for larger allocations. It can also limit the number of tiles that are re-rendered
+/// per timestamp (refresh budget) and downgrade allocations to smaller tiles when the atlas is under pressure.
 class TileAllocator : public NonCopyable
 {
 public:
@@ -35,15 +38,63 @@ public:
 												 U32 lightFace, U32 drawcallCount, U32 lod,
 												 Array<U32, 4>& tileViewport);
 
+	/// Same as the other allocate() but it respects the refresh budget and it may downgrade the allocation. If the
+	/// budget is spent a cached tile that needs re-rendering will be returned as CACHED and its refresh will be
+	/// deferred to a later timestamp. Tiles that don't have content will always be rendered.
+	/// @param lod The preferred LOD.
+	/// @param minLod If there is no space for @a lod try smaller tiles down to that LOD. A light that got a smaller
+	///               tile will keep it until a tile of @a lod becomes available.
+	/// @param[out] tileViewport The viewport of the tile.
+	/// @param[out] tileLod The LOD of the tile.
+	ANKI_USE_RESULT TileAllocatorResult allocate(Timestamp crntTimestamp, Timestamp lightTimestamp, U64 lightUuid,
+												 U32 lightFace, U32 drawcallCount, U32 lod, U32 minLod,
+												 Array<U32, 4>& tileViewport, U32& tileLod);
+
 	/// Remove an light from the cache.
 	void invalidateCache(U64 lightUuid, U32 lightFace);
 
+	/// Undo an allocation of the current timestamp. The tile becomes free and it gives back its refresh to the budget.
+	/// Use it when the other faces of a light didn't fit.
+	void release(U64 lightUuid, U32 lightFace);
+
+	/// Set the max number of tiles that can be re-rendered in a single timestamp. 0 means no limit.
+	void setRefreshBudget(U32 maxRefreshesPerTimestamp)
+	{
+		m_refreshBudget = maxRefreshesPerTimestamp;
+	}
+
+	/// Compute how important is to refresh the tile of a light face. The budget is given on a first come first served
+	/// basis so sort the allocations using this priority. Faces that don't have a tile come first.
+	/// @param screenSpaceSize A measure of how much of the screen the light covers.
+	F32 computeRefreshPriority(Timestamp crntTimestamp, U64 lightUuid, U32 lightFace, F32 screenSpaceSize) const;
+
+	/// Number of tiles rendered in the last timestamp.
+	U32 getRefreshCount() const
+	{
+		return m_refreshCount;
+	}
+
+	/// Number of tiles that needed rendering in the last timestamp but got deferred because of the refresh budget.
+	U32 getDeferredRefreshCount() const
+	{
+		return m_deferredRefreshCount;
+	}
+
+	/// Number of allocations of the last timestamp that got a smaller tile than the one they asked for.
+	U32 getDowngradeCount() const
+	{
+		return m_downgradeCount;
+	}
+
 private:
 	class Tile;
 
 	/// A HashMap key.
 	class HashMapKey;
 
+	/// The best tiles found while searching.
+	class SearchResult;
+
 	HeapAllocator<U8> m_alloc;
 	DynamicArray<Tile> m_allTiles;
 	DynamicArray<U32> m_lodFirstTileIndex;
@@ -55,6 +106,12 @@ private:
 	U8 m_lodCount = 0;
 	Bool m_cachingEnabled = false;
 
+	U32 m_refreshBudget = 0;
+	Timestamp m_statsTimestamp = 0;
+	U32 m_refreshCount = 0;
+	U32 m_deferredRefreshCount = 0;
+	U32 m_downgradeCount = 0;
+
 	U32 translateTileIdx(U32 x, U32 y, U32 lod) const
 	{
 		const U32 lodWidth = m_tileCountX >> lod;
@@ -76,10 +133,17 @@ private:
 
 	/// Search for a tile recursively.
 	Bool searchTileRecursively(U32 crntTileIdx, U32 crntTileLod, U32 allocationLod, Timestamp crntTimestamp,
-							   U32& emptyTileIdx, U32& toKickTileIdx, Timestamp& tileToKickMinTimestamp) const;
+							   SearchResult& result) const;
+
+	Bool evaluateCandidate(U32 tileIdx, Timestamp crntTimestamp, SearchResult& result) const;
+
+	/// Find a tile for an allocation.
+	/// @return The tile index or MAX_U32 if there is none.
+	U32 findTile(U32 lod, Timestamp crntTimestamp) const;
 
-	Bool evaluateCandidate(U32 tileIdx, Timestamp crntTimestamp, U32& emptyTileIdx, U32& toKickTileIdx,
-						   Timestamp& tileToKickMinTimestamp) const;
+	TileAllocatorResult allocateInternal(Timestamp crntTimestamp, Timestamp lightTimestamp, U64 lightUuid,
+										 U32 lightFace, U32 drawcallCount, U32 lod, U32 minLod, Bool budgeted,
+										 Array<U32, 4>& tileViewport, U32& tileLod);
 };
 /// @}
 
@@ -84,6 +84,7 @@ void VolumetricLightingAccumulation::populateRenderGraph(RenderingContext& ctx)
 	m_runCtx.m_rts[1] = rgraph.importRenderTarget(m_rtTextures[!readRtIdx], TextureUsageBit::NONE);
 
 	ComputeRenderPassDescription& pass = rgraph.newComputeRenderPass("Vol light");
+	pass.setQueueHint(GpuQueueType::ASYNC_COMPUTE);
 
 	auto callback = [](RenderPassWorkContext& rgraphCtx) -> void {
 		static_cast<VolumetricLightingAccumulation*>(rgraphCtx.m_userData)->run(rgraphCtx);
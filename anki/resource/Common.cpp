@@ -15,8 +15,15 @@ template<typename T>
 void ResourcePtrDeleter<T>::operator()(T* ptr)
 {
 	ptr->getManager().unregisterResource(ptr);
+	T* replacement = static_cast<T*>(ptr->getReplacement());
 	auto alloc = ptr->getAllocator();
 	alloc.deleteInstance(ptr);
+
+	// Release the newer version of a reloaded resource
+	if(replacement && replacement->getRefcount().fetchSub(1) == 1)
+	{
+		(*this)(replacement);
+	}
 }
 
 #define ANKI_INSTANTIATE_RESOURCE(rsrc_, ptr_) template void ResourcePtrDeleter<rsrc_>::operator()(rsrc_* ptr);
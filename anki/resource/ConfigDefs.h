@@ -10,3 +10,25 @@ ANKI_CONFIG_OPTION(
 	"The engine loads assets only in from these paths. Separate them with : (it's smart enough to identify drive "
 	"letters in Windows)")
 ANKI_CONFIG_OPTION(rsrc_transferScratchMemorySize, 256_MB, 1_MB, 4_GB)
+ANKI_CONFIG_OPTION(rsrc_shaderVariantManifest, "",
+				   "A file with the shader program variants that the game uses. If it exists only those variants are "
+				   "compiled in advance, the rest are compiled the first time they are used")
+ANKI_CONFIG_OPTION(rsrc_recordShaderVariantManifest, 0, 0, 1,
+				   "Add the shader program variants that the game uses to the rsrc_shaderVariantManifest")
+ANKI_CONFIG_OPTION(rsrc_stripShaderDebugInfo, 1, 0, 1,
+				   "Remove the names and the source info from the SPIR-V of the shader programs. Disable it to debug "
+				   "the shaders in a graphics debugger")
+ANKI_CONFIG_OPTION(rsrc_compressShaderBinaries, 1, 0, 1,
+				   "Compress the SPIR-V of the shader programs. It's decompressed when a variant is created")
+ANKI_CONFIG_OPTION(rsrc_hotReload, 0, 0, 1,
+				   "Watch the data paths and reload the resources that change on disk. The archives are not watched")
+ANKI_CONFIG_OPTION(rsrc_textureStreaming, 1, 0, 1,
+				   "Load only the smallest mips of the material textures and stream the rest when they are visible. "
+				   "It's disabled when ray tracing is enabled")
+ANKI_CONFIG_OPTION(rsrc_textureStreamingBudget, 512_MB, 1_MB, 16_GB,
+				   "The memory that the mips of the streamed textures can use")
+ANKI_CONFIG_OPTION(rsrc_meshStreaming, 1, 0, 1,
+				   "Load only the coarsest LOD of the models and stream the finer LODs when they are visible. It's "
+				   "disabled when ray tracing is enabled")
+ANKI_CONFIG_OPTION(rsrc_meshStreamingBudget, 256_MB, 1_MB, 16_GB,
+				   "The memory that the LODs of the streamed models can use")
@@ -0,0 +1,306 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+// WARNING: This file is auto generated.
+
+#pragma once
+
+#include <anki/resource/Common.h>
+#include <anki/shader_compiler/Common.h>
+#include <anki/util/WeakArray.h>
+
+namespace anki
+{
+
+/// @addtogroup resource
+/// @{
+
+static constexpr const char* MATERIAL_BINARY_MAGIC = "ANKIMTB1";
+static constexpr const char* MODEL_BINARY_MAGIC = "ANKIMDB1";
+static constexpr const char* PARTICLE_EMITTER_BINARY_MAGIC = "ANKIPEB1";
+
+/// Bump it to invalidate all the cooked binaries of the cache.
+constexpr U32 COOKED_RESOURCE_BINARY_VERSION = 1;
+
+/// @name Sizes of the raw parts of the binaries. The resources static_assert them
+/// @{
+constexpr U32 MATERIAL_BINARY_BUILTIN_MUTATOR_COUNT = 6;
+constexpr U32 MATERIAL_BINARY_MAX_VARIABLE_VALUE_SIZE = 64;
+constexpr U32 MATERIAL_BINARY_GPU_DESCRIPTOR_SIZE = 64;
+constexpr U32 MATERIAL_BINARY_RT_TEXTURE_COUNT = 8;
+constexpr U32 PARTICLE_EMITTER_BINARY_PROPERTIES_SIZE = 256;
+/// @}
+
+/// @name Layout versions of the raw structs of the binaries. Bump them when the structs change, they are hashed
+/// @{
+constexpr U32 MATERIAL_BINARY_GPU_DESCRIPTOR_VERSION = 1;
+constexpr U32 PARTICLE_EMITTER_BINARY_PROPERTIES_VERSION = 1;
+/// @}
+
+/// A mutator and its value.
+class MaterialBinaryMutation
+{
+public:
+	U32 m_mutatorIndex = MAX_U32; ///< Index in the mutators of the program.
+	MutatorValue m_value = 0;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doValue("m_mutatorIndex", offsetof(MaterialBinaryMutation, m_mutatorIndex), self.m_mutatorIndex);
+		s.doValue("m_value", offsetof(MaterialBinaryMutation, m_value), self.m_value);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, MaterialBinaryMutation&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const MaterialBinaryMutation&>(serializer, *this);
+	}
+};
+
+/// A material variable. Mirrors MaterialVariable.
+class MaterialBinaryVariable
+{
+public:
+	WeakArray<char> m_name; ///< It includes the null terminator.
+	U32 m_indexInBinary = MAX_U32;
+	U32 m_indexInBinary2ndElement = MAX_U32;
+	U32 m_opaqueBinding = MAX_U32;
+	Bool m_constant = false;
+	Bool m_instanced = false;
+	Bool m_numericValueIsSet = false;
+	ShaderVariableDataType m_dataType = ShaderVariableDataType::NONE;
+	U8 m_builtin = 0; ///< It's a BuiltinMaterialVariableId.
+	Array<U8, MATERIAL_BINARY_MAX_VARIABLE_VALUE_SIZE> m_value = {}; ///< Used if m_numericValueIsSet is true.
+	WeakArray<char> m_texture; ///< The filename of the texture. Empty if there is none.
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doValue("m_name", offsetof(MaterialBinaryVariable, m_name), self.m_name);
+		s.doValue("m_indexInBinary", offsetof(MaterialBinaryVariable, m_indexInBinary), self.m_indexInBinary);
+		s.doValue("m_indexInBinary2ndElement", offsetof(MaterialBinaryVariable, m_indexInBinary2ndElement),
+				  self.m_indexInBinary2ndElement);
+		s.doValue("m_opaqueBinding", offsetof(MaterialBinaryVariable, m_opaqueBinding), self.m_opaqueBinding);
+		s.doValue("m_constant", offsetof(MaterialBinaryVariable, m_constant), self.m_constant);
+		s.doValue("m_instanced", offsetof(MaterialBinaryVariable, m_instanced), self.m_instanced);
+		s.doValue("m_numericValueIsSet", offsetof(MaterialBinaryVariable, m_numericValueIsSet),
+				  self.m_numericValueIsSet);
+		s.doValue("m_dataType", offsetof(MaterialBinaryVariable, m_dataType), self.m_dataType);
+		s.doValue("m_builtin", offsetof(MaterialBinaryVariable, m_builtin), self.m_builtin);
+		s.doArray("m_value", offsetof(MaterialBinaryVariable, m_value), &self.m_value[0], self.m_value.getSize());
+		s.doValue("m_texture", offsetof(MaterialBinaryVariable, m_texture), self.m_texture);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, MaterialBinaryVariable&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const MaterialBinaryVariable&>(serializer, *this);
+	}
+};
+
+/// The program and the mutation of a ray type.
+class MaterialBinaryRayType
+{
+public:
+	WeakArray<char> m_shaderProgram; ///< Empty if the ray type is not supported.
+	U64 m_shaderProgramHash = 0;
+	WeakArray<MaterialBinaryMutation> m_mutation;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doValue("m_shaderProgram", offsetof(MaterialBinaryRayType, m_shaderProgram), self.m_shaderProgram);
+		s.doValue("m_shaderProgramHash", offsetof(MaterialBinaryRayType, m_shaderProgramHash),
+				  self.m_shaderProgramHash);
+		s.doValue("m_mutation", offsetof(MaterialBinaryRayType, m_mutation), self.m_mutation);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, MaterialBinaryRayType&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const MaterialBinaryRayType&>(serializer, *this);
+	}
+};
+
+/// The cooked form of MaterialResource.
+class MaterialBinary
+{
+public:
+	Array<U8, 8> m_magic = {};
+	U64 m_sourceHash = 0; ///< The hash of the XML and the cooking parameters.
+	WeakArray<char> m_shaderProgram;
+	U64 m_shaderProgramHash = 0; ///< Invalidates the binary if the program changes.
+	Bool m_shadow = true;
+	Bool m_forwardShading = false;
+	U8 m_lodCount = 1;
+	U8 m_descriptorSetIdx = MAX_U8;
+	U32 m_perDrawUboIdx = MAX_U32;
+	U32 m_perInstanceUboIdx = MAX_U32;
+	U32 m_perDrawUboBinding = MAX_U32;
+	U32 m_perInstanceUboBinding = MAX_U32;
+	U32 m_boneTrfsBinding = MAX_U32;
+	U32 m_prevFrameBoneTrfsBinding = MAX_U32;
+	Array<U32, MATERIAL_BINARY_BUILTIN_MUTATOR_COUNT> m_builtinMutators = {}; ///< Indices of the program mutators.
+	WeakArray<MaterialBinaryMutation> m_mutation; ///< The non-builtin mutators.
+	WeakArray<MaterialBinaryVariable> m_variables;
+	Array<MaterialBinaryRayType, U32(RayType::COUNT)> m_rayTypes;
+	Array<WeakArray<char>, MATERIAL_BINARY_RT_TEXTURE_COUNT> m_rtTextures; ///< Textures of the MaterialGpuDescriptor.
+	Array<U8, MATERIAL_BINARY_GPU_DESCRIPTOR_SIZE> m_rtGpuDescriptor = {}; ///< A MaterialGpuDescriptor.
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doArray("m_magic", offsetof(MaterialBinary, m_magic), &self.m_magic[0], self.m_magic.getSize());
+		s.doValue("m_sourceHash", offsetof(MaterialBinary, m_sourceHash), self.m_sourceHash);
+		s.doValue("m_shaderProgram", offsetof(MaterialBinary, m_shaderProgram), self.m_shaderProgram);
+		s.doValue("m_shaderProgramHash", offsetof(MaterialBinary, m_shaderProgramHash), self.m_shaderProgramHash);
+		s.doValue("m_shadow", offsetof(MaterialBinary, m_shadow), self.m_shadow);
+		s.doValue("m_forwardShading", offsetof(MaterialBinary, m_forwardShading), self.m_forwardShading);
+		s.doValue("m_lodCount", offsetof(MaterialBinary, m_lodCount), self.m_lodCount);
+		s.doValue("m_descriptorSetIdx", offsetof(MaterialBinary, m_descriptorSetIdx), self.m_descriptorSetIdx);
+		s.doValue("m_perDrawUboIdx", offsetof(MaterialBinary, m_perDrawUboIdx), self.m_perDrawUboIdx);
+		s.doValue("m_perInstanceUboIdx", offsetof(MaterialBinary, m_perInstanceUboIdx), self.m_perInstanceUboIdx);
+		s.doValue("m_perDrawUboBinding", offsetof(MaterialBinary, m_perDrawUboBinding), self.m_perDrawUboBinding);
+		s.doValue("m_perInstanceUboBinding", offsetof(MaterialBinary, m_perInstanceUboBinding),
+				  self.m_perInstanceUboBinding);
+		s.doValue("m_boneTrfsBinding", offsetof(MaterialBinary, m_boneTrfsBinding), self.m_boneTrfsBinding);
+		s.doValue("m_prevFrameBoneTrfsBinding", offsetof(MaterialBinary, m_prevFrameBoneTrfsBinding),
+				  self.m_prevFrameBoneTrfsBinding);
+		s.doArray("m_builtinMutators", offsetof(MaterialBinary, m_builtinMutators), &self.m_builtinMutators[0],
+				  self.m_builtinMutators.getSize());
+		s.doValue("m_mutation", offsetof(MaterialBinary, m_mutation), self.m_mutation);
+		s.doValue("m_variables", offsetof(MaterialBinary, m_variables), self.m_variables);
+		s.doArray("m_rayTypes", offsetof(MaterialBinary, m_rayTypes), &self.m_rayTypes[0], self.m_rayTypes.getSize());
+		s.doArray("m_rtTextures", offsetof(MaterialBinary, m_rtTextures), &self.m_rtTextures[0],
+				  self.m_rtTextures.getSize());
+		s.doArray("m_rtGpuDescriptor", offsetof(MaterialBinary, m_rtGpuDescriptor), &self.m_rtGpuDescriptor[0],
+				  self.m_rtGpuDescriptor.getSize());
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, MaterialBinary&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const MaterialBinary&>(serializer, *this);
+	}
+};
+
+/// The cooked form of ModelPatch.
+class ModelBinaryPatch
+{
+public:
+	Array<WeakArray<char>, MAX_LOD_COUNT> m_meshes; ///< Mesh filenames, one for each LOD.
+	U32 m_meshCount = 0;
+	WeakArray<char> m_material;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doArray("m_meshes", offsetof(ModelBinaryPatch, m_meshes), &self.m_meshes[0], self.m_meshes.getSize());
+		s.doValue("m_meshCount", offsetof(ModelBinaryPatch, m_meshCount), self.m_meshCount);
+		s.doValue("m_material", offsetof(ModelBinaryPatch, m_material), self.m_material);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, ModelBinaryPatch&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const ModelBinaryPatch&>(serializer, *this);
+	}
+};
+
+/// The cooked form of ModelResource.
+class ModelBinary
+{
+public:
+	Array<U8, 8> m_magic = {};
+	U64 m_sourceHash = 0; ///< The hash of the XML and the cooking parameters.
+	WeakArray<ModelBinaryPatch> m_modelPatches;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doArray("m_magic", offsetof(ModelBinary, m_magic), &self.m_magic[0], self.m_magic.getSize());
+		s.doValue("m_sourceHash", offsetof(ModelBinary, m_sourceHash), self.m_sourceHash);
+		s.doValue("m_modelPatches", offsetof(ModelBinary, m_modelPatches), self.m_modelPatches);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, ModelBinary&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const ModelBinary&>(serializer, *this);
+	}
+};
+
+/// The cooked form of ParticleEmitterResource.
+class ParticleEmitterBinary
+{
+public:
+	Array<U8, 8> m_magic = {};
+	U64 m_sourceHash = 0; ///< The hash of the XML and the cooking parameters.
+	Array<U8, PARTICLE_EMITTER_BINARY_PROPERTIES_SIZE> m_properties = {}; ///< The ParticleEmitterProperties.
+	WeakArray<char> m_material;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doArray("m_magic", offsetof(ParticleEmitterBinary, m_magic), &self.m_magic[0], self.m_magic.getSize());
+		s.doValue("m_sourceHash", offsetof(ParticleEmitterBinary, m_sourceHash), self.m_sourceHash);
+		s.doArray("m_properties", offsetof(ParticleEmitterBinary, m_properties), &self.m_properties[0],
+				  self.m_properties.getSize());
+		s.doValue("m_material", offsetof(ParticleEmitterBinary, m_material), self.m_material);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, ParticleEmitterBinary&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const ParticleEmitterBinary&>(serializer, *this);
+	}
+};
+
+/// @}
+
+} // end namespace anki
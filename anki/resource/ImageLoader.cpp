@@ -362,7 +362,7 @@ Error ImageLoader::loadAnkiTexture(FileInterface& file, U32 maxTextureSize,
 								   ImageLoaderDataCompression& preferredCompression,
 								   DynamicArray<ImageLoaderSurface>& surfaces, DynamicArray<ImageLoaderVolume>& volumes,
 								   GenericMemoryPoolAllocator<U8>& alloc, U32& width, U32& height, U32& depth,
-								   U32& layerCount, U32& mipCount, ImageLoaderTextureType& textureType,
+								   U32& layerCount, U32& mipCount, U32& firstMip, ImageLoaderTextureType& textureType,
 								   ImageLoaderColorFormat& colorFormat)
 {
 	//
@@ -566,6 +566,8 @@ Error ImageLoader::loadAnkiTexture(FileInterface& file, U32 maxTextureSize,
 		depth = volumes[0].m_depth;
 	}
 
+	firstMip = header.m_mipCount - mipCount;
+
 	return Error::NONE;
 }
 
@@ -629,6 +631,10 @@ Error ImageLoader::load(const CString& filename, U32 maxTextureSize)
 
 Error ImageLoader::loadInternal(FileInterface& file, const CString& filename, U32 maxTextureSize)
 {
+	// Forget the previous image if the loader is used again
+	destroy();
+	m_firstMip = 0;
+
 	// get the extension
 	StringAuto ext(m_alloc);
 	getFilepathExtension(filename, ext);
@@ -678,7 +684,8 @@ Error ImageLoader::loadInternal(FileInterface& file, const CString& filename, U3
 #endif
 
 		ANKI_CHECK(loadAnkiTexture(file, maxTextureSize, m_compression, m_surfaces, m_volumes, m_alloc, m_width,
-								   m_height, m_depth, m_layerCount, m_mipCount, m_textureType, m_colorFormat));
+								   m_height, m_depth, m_layerCount, m_mipCount, m_firstMip, m_textureType,
+								   m_colorFormat));
 	}
 	else if(ext == "png")
 	{
@@ -95,6 +95,12 @@ public:
 		return m_mipCount;
 	}
 
+	/// The mips of the file that were skipped because of the maxTextureSize. The first mip that was loaded.
+	U32 getFirstMipmap() const
+	{
+		return m_firstMip;
+	}
+
 	U32 getWidth() const
 	{
 		return m_width;
@@ -147,6 +153,7 @@ private:
 	DynamicArray<ImageLoaderVolume> m_volumes;
 
 	U32 m_mipCount = 0;
+	U32 m_firstMip = 0;
 	U32 m_width = 0;
 	U32 m_height = 0;
 	U32 m_depth = 0;
@@ -173,7 +180,8 @@ private:
 	loadAnkiTexture(FileInterface& file, U32 maxTextureSize, ImageLoaderDataCompression& preferredCompression,
 					DynamicArray<ImageLoaderSurface>& surfaces, DynamicArray<ImageLoaderVolume>& volumes,
 					GenericMemoryPoolAllocator<U8>& alloc, U32& width, U32& height, U32& depth, U32& layerCount,
-					U32& mipCount, ImageLoaderTextureType& textureType, ImageLoaderColorFormat& colorFormat);
+					U32& mipCount, U32& firstMip, ImageLoaderTextureType& textureType,
+					ImageLoaderColorFormat& colorFormat);
 
 	ANKI_USE_RESULT Error loadInternal(FileInterface& file, const CString& filename, U32 maxTextureSize);
 };
@@ -6,6 +6,8 @@
 #include <anki/resource/MaterialResource.h>
 #include <anki/resource/ResourceManager.h>
 #include <anki/resource/TextureResource.h>
+#include <anki/resource/TextureStreamer.h>
+#include <anki/resource/CookedResourceBinary.h>
 #include <anki/util/Xml.h>
 
 namespace anki
@@ -154,6 +156,11 @@ static const Array<GpuMaterialFloats, 5> GPU_MATERIAL_FLOATS = {
 	 {"roughness", offsetof(MaterialGpuDescriptor, m_roughness), 1},
 	 {"metalness", offsetof(MaterialGpuDescriptor, m_metalness), 1}}};
 
+static_assert(MATERIAL_BINARY_BUILTIN_MUTATOR_COUNT == U32(BuiltinMutatorId::COUNT), "See file");
+static_assert(MATERIAL_BINARY_MAX_VARIABLE_VALUE_SIZE >= sizeof(Mat4), "See file");
+static_assert(MATERIAL_BINARY_GPU_DESCRIPTOR_SIZE >= sizeof(MaterialGpuDescriptor), "See file");
+static_assert(MATERIAL_BINARY_RT_TEXTURE_COUNT == TEXTURE_CHANNEL_COUNT, "See file");
+
 MaterialVariable::MaterialVariable()
 {
 	m_Mat4 = Mat4::getZero();
@@ -182,8 +189,14 @@ MaterialResource::~MaterialResource()
 				{
 					for(U32 vel = 0; vel <= 1; ++vel)
 					{
-						MaterialVariant& variant = m_variantMatrix[p][l][inst][skinned][vel];
-						variant.m_blockInfos.destroy(getAllocator());
+						MaterialVariant* variant = m_variantMatrix[p][l][inst][skinned][vel];
+						while(variant)
+						{
+							MaterialVariant* replacedVariant = variant->m_replacedVariant;
+							variant->m_blockInfos.destroy(getAllocator());
+							getAllocator().deleteInstance(variant);
+							variant = replacedVariant;
+						}
 					}
 				}
 			}
@@ -197,14 +210,53 @@ MaterialResource::~MaterialResource()
 	m_vars.destroy(getAllocator());
 
 	m_nonBuiltinsMutation.destroy(getAllocator());
+
+	for(DynamicArray<SubMutation>& mutation : m_rtMutations)
+	{
+		mutation.destroy(getAllocator());
+	}
 }
 
 Error MaterialResource::load(const ResourceFilename& filename, Bool async)
 {
+	StringAuto txt(getTempAllocator());
+	ANKI_CHECK(openFileReadAllText(filename, txt));
+
+	// The <rtMaterial> is ignored if RT is disabled so the binary depends on it. The binary has a raw copy of the
+	// MaterialGpuDescriptor so it depends on its layout as well
+	const Array<U64, 3> parameters = {getManager().getGrManager().getDeviceCapabilities().m_rayTracingEnabled,
+									  sizeof(MaterialGpuDescriptor), MATERIAL_BINARY_GPU_DESCRIPTOR_VERSION};
+	const U64 sourceHash = computeCookedBinaryHash(txt, computeHash(&parameters[0], parameters.getSizeInBytes()));
+
+	// Try the cooked binary first
+	MaterialBinary* binary;
+	ANKI_CHECK(loadCookedBinary(filename, MATERIAL_BINARY_MAGIC, sourceHash, binary));
+	if(binary)
+	{
+		Bool upToDate;
+		const Error err = loadCooked(*binary, async, upToDate);
+		freeCookedBinary(binary);
+		ANKI_CHECK(err);
+
+		if(upToDate)
+		{
+			return Error::NONE;
+		}
+	}
+
+	// Parse the XML and cook it for the next time
 	XmlDocument doc;
+	ANKI_CHECK(doc.parse(txt.toCString(), getTempAllocator()));
+	ANKI_CHECK(loadXml(doc, async));
+	cook(filename, sourceHash);
+
+	return Error::NONE;
+}
+
+Error MaterialResource::loadXml(const XmlDocument& doc, Bool async)
+{
 	XmlElement el;
 	Bool present = false;
-	ANKI_CHECK(openFileParseXml(filename, doc));
 
 	// <material>
 	XmlElement rootEl;
@@ -255,6 +307,234 @@ Error MaterialResource::load(const ResourceFilename& filename, Bool async)
 	return Error::NONE;
 }
 
+Error MaterialResource::loadCooked(const MaterialBinary& binary, Bool async, Bool& upToDate)
+{
+	// Load the programs first because the binary is stale if they changed
+	upToDate = false;
+	ANKI_CHECK(getManager().loadResource(fromCookedString(binary.m_shaderProgram), m_prog, async));
+	Bool stale = m_prog->getBinaryHash() != binary.m_shaderProgramHash;
+
+	for(RayType type = RayType::FIRST; type < RayType::COUNT; ++type)
+	{
+		const MaterialBinaryRayType& rayType = binary.m_rayTypes[type];
+		if(rayType.m_shaderProgram.getSize() > 0)
+		{
+			ANKI_CHECK(
+				getManager().loadResource(fromCookedString(rayType.m_shaderProgram), m_rtPrograms[type], false));
+			stale = stale || m_rtPrograms[type]->getBinaryHash() != rayType.m_shaderProgramHash;
+		}
+	}
+
+	if(stale)
+	{
+		m_prog.reset(nullptr);
+		for(ShaderProgramResourcePtr& prog : m_rtPrograms)
+		{
+			prog.reset(nullptr);
+		}
+
+		return Error::NONE;
+	}
+
+	upToDate = true;
+
+	// Misc
+	m_shadow = binary.m_shadow;
+	m_forwardShading = binary.m_forwardShading;
+	m_lodCount = binary.m_lodCount;
+	m_descriptorSetIdx = binary.m_descriptorSetIdx;
+	m_perDrawUboIdx = binary.m_perDrawUboIdx;
+	m_perInstanceUboIdx = binary.m_perInstanceUboIdx;
+	m_perDrawUboBinding = binary.m_perDrawUboBinding;
+	m_perInstanceUboBinding = binary.m_perInstanceUboBinding;
+	m_boneTrfsBinding = binary.m_boneTrfsBinding;
+	m_prevFrameBoneTrfsBinding = binary.m_prevFrameBoneTrfsBinding;
+
+	// Mutators
+	ConstWeakArray<ShaderProgramResourceMutator> mutators = m_prog->getMutators();
+	for(BuiltinMutatorId id : EnumIterable<BuiltinMutatorId>())
+	{
+		const U32 idx = binary.m_builtinMutators[id];
+		m_builtinMutators[id] = (idx != MAX_U32) ? &mutators[idx] : nullptr;
+	}
+
+	if(binary.m_mutation.getSize() > 0)
+	{
+		m_nonBuiltinsMutation.create(getAllocator(), binary.m_mutation.getSize());
+		for(U32 i = 0; i < binary.m_mutation.getSize(); ++i)
+		{
+			m_nonBuiltinsMutation[i].m_mutator = &mutators[binary.m_mutation[i].m_mutatorIndex];
+			m_nonBuiltinsMutation[i].m_value = binary.m_mutation[i].m_value;
+		}
+	}
+
+	// Variables
+	if(binary.m_variables.getSize() > 0)
+	{
+		m_vars.create(getAllocator(), binary.m_variables.getSize());
+	}
+
+	for(U32 i = 0; i < binary.m_variables.getSize(); ++i)
+	{
+		const MaterialBinaryVariable& in = binary.m_variables[i];
+		MaterialVariable& out = m_vars[i];
+
+		out.m_name.create(getAllocator(), fromCookedString(in.m_name));
+		out.m_index = i;
+		out.m_indexInBinary = in.m_indexInBinary;
+		out.m_indexInBinary2ndElement = in.m_indexInBinary2ndElement;
+		out.m_opaqueBinding = in.m_opaqueBinding;
+		out.m_constant = in.m_constant;
+		out.m_instanced = in.m_instanced;
+		out.m_numericValueIsSet = in.m_numericValueIsSet;
+		out.m_dataType = in.m_dataType;
+		out.m_builtin = BuiltinMaterialVariableId(in.m_builtin);
+		memcpy(&out.m_Mat4, &in.m_value[0], sizeof(out.m_Mat4));
+
+		if(in.m_texture.getSize() > 0)
+		{
+			// The renderer asks for the mips of the material textures so they can be streamed
+			TextureStreamingScope streamingScope;
+			ANKI_CHECK(getManager().loadResource(fromCookedString(in.m_texture), out.m_tex, async));
+		}
+	}
+
+	// Ray tracing
+	memcpy(&m_materialGpuDescriptor, &binary.m_rtGpuDescriptor[0], sizeof(m_materialGpuDescriptor));
+
+	for(RayType type = RayType::FIRST; type < RayType::COUNT; ++type)
+	{
+		if(!m_rtPrograms[type].isCreated())
+		{
+			continue;
+		}
+
+		const MaterialBinaryRayType& rayType = binary.m_rayTypes[type];
+		DynamicArrayAuto<SubMutation> mutation(getTempAllocator(), rayType.m_mutation.getSize());
+		for(U32 i = 0; i < rayType.m_mutation.getSize(); ++i)
+		{
+			mutation[i].m_mutator = &m_rtPrograms[type]->getMutators()[rayType.m_mutation[i].m_mutatorIndex];
+			mutation[i].m_value = rayType.m_mutation[i].m_value;
+		}
+
+		initRtVariant(type, mutation);
+	}
+
+	for(U32 slot = 0; slot < TEXTURE_CHANNEL_COUNT; ++slot)
+	{
+		if(binary.m_rtTextures[slot].getSize() > 0)
+		{
+			ANKI_CHECK(loadRtTexture(slot, fromCookedString(binary.m_rtTextures[slot])));
+		}
+	}
+
+	return Error::NONE;
+}
+
+void MaterialResource::cook(const ResourceFilename& filename, U64 sourceHash) const
+{
+	MaterialBinary binary;
+	memcpy(&binary.m_magic[0], MATERIAL_BINARY_MAGIC, sizeof(binary.m_magic));
+	binary.m_sourceHash = sourceHash;
+	binary.m_shaderProgram = toCookedString(m_prog->getFilename());
+	binary.m_shaderProgramHash = m_prog->getBinaryHash();
+
+	// Misc
+	binary.m_shadow = m_shadow;
+	binary.m_forwardShading = m_forwardShading;
+	binary.m_lodCount = m_lodCount;
+	binary.m_descriptorSetIdx = m_descriptorSetIdx;
+	binary.m_perDrawUboIdx = m_perDrawUboIdx;
+	binary.m_perInstanceUboIdx = m_perInstanceUboIdx;
+	binary.m_perDrawUboBinding = m_perDrawUboBinding;
+	binary.m_perInstanceUboBinding = m_perInstanceUboBinding;
+	binary.m_boneTrfsBinding = m_boneTrfsBinding;
+	binary.m_prevFrameBoneTrfsBinding = m_prevFrameBoneTrfsBinding;
+
+	// Mutators
+	const ShaderProgramResourceMutator* firstMutator = m_prog->getMutators().getBegin();
+	for(BuiltinMutatorId id : EnumIterable<BuiltinMutatorId>())
+	{
+		binary.m_builtinMutators[id] = (m_builtinMutators[id]) ? U32(m_builtinMutators[id] - firstMutator) : MAX_U32;
+	}
+
+	DynamicArrayAuto<MaterialBinaryMutation> mutation(getTempAllocator(), m_nonBuiltinsMutation.getSize());
+	for(U32 i = 0; i < m_nonBuiltinsMutation.getSize(); ++i)
+	{
+		mutation[i].m_mutatorIndex = U32(m_nonBuiltinsMutation[i].m_mutator - firstMutator);
+		mutation[i].m_value = m_nonBuiltinsMutation[i].m_value;
+	}
+	binary.m_mutation = WeakArray<MaterialBinaryMutation>(mutation);
+
+	// Variables
+	DynamicArrayAuto<MaterialBinaryVariable> vars(getTempAllocator(), m_vars.getSize());
+	for(U32 i = 0; i < m_vars.getSize(); ++i)
+	{
+		const MaterialVariable& in = m_vars[i];
+		MaterialBinaryVariable& out = vars[i];
+
+		out.m_name = toCookedString(in.m_name);
+		out.m_indexInBinary = in.m_indexInBinary;
+		out.m_indexInBinary2ndElement = in.m_indexInBinary2ndElement;
+		out.m_opaqueBinding = in.m_opaqueBinding;
+		out.m_constant = in.m_constant;
+		out.m_instanced = in.m_instanced;
+		out.m_numericValueIsSet = in.m_numericValueIsSet;
+		out.m_dataType = in.m_dataType;
+		out.m_builtin = U8(in.m_builtin);
+		memcpy(&out.m_value[0], &in.m_Mat4, sizeof(in.m_Mat4));
+		out.m_texture = (in.m_tex.isCreated()) ? toCookedString(in.m_tex->getFilename()) : WeakArray<char>();
+	}
+	binary.m_variables = WeakArray<MaterialBinaryVariable>(vars);
+
+	// Ray tracing. Store the mutations of all ray types in a single array
+	U32 rtMutationCount = 0;
+	for(const DynamicArray<SubMutation>& rtMutation : m_rtMutations)
+	{
+		rtMutationCount += rtMutation.getSize();
+	}
+
+	DynamicArrayAuto<MaterialBinaryMutation> rtMutations(getTempAllocator(), rtMutationCount);
+	rtMutationCount = 0;
+	for(RayType type = RayType::FIRST; type < RayType::COUNT; ++type)
+	{
+		if(!m_rtPrograms[type].isCreated())
+		{
+			continue;
+		}
+
+		MaterialBinaryRayType& out = binary.m_rayTypes[type];
+		out.m_shaderProgram = toCookedString(m_rtPrograms[type]->getFilename());
+		out.m_shaderProgramHash = m_rtPrograms[type]->getBinaryHash();
+
+		const ShaderProgramResourceMutator* firstRtMutator = m_rtPrograms[type]->getMutators().getBegin();
+		if(m_rtMutations[type].getSize() > 0)
+		{
+			out.m_mutation = WeakArray<MaterialBinaryMutation>(&rtMutations[rtMutationCount],
+															   m_rtMutations[type].getSize());
+		}
+
+		for(const SubMutation& in : m_rtMutations[type])
+		{
+			MaterialBinaryMutation& mutation = rtMutations[rtMutationCount++];
+			mutation.m_mutatorIndex = U32(in.m_mutator - firstRtMutator);
+			mutation.m_value = in.m_value;
+		}
+	}
+
+	for(U32 slot = 0; slot < TEXTURE_CHANNEL_COUNT; ++slot)
+	{
+		if(m_textureResources[slot].isCreated())
+		{
+			binary.m_rtTextures[slot] = toCookedString(m_textureResources[slot]->getFilename());
+		}
+	}
+
+	memcpy(&binary.m_rtGpuDescriptor[0], &m_materialGpuDescriptor, sizeof(m_materialGpuDescriptor));
+
+	storeCookedBinary(filename, binary);
+}
+
 Error MaterialResource::parseMutators(XmlElement mutatorsEl)
 {
 	XmlElement mutatorEl;
@@ -840,6 +1120,7 @@ Error MaterialResource::parseInputs(XmlElement inputsEl, Bool async)
 			{
 				CString texfname;
 				ANKI_CHECK(inputEl.getAttributeText("value", texfname));
+				TextureStreamingScope streamingScope;
 				ANKI_CHECK(getManager().loadResource(texfname, foundVar->m_tex, async));
 				break;
 			}
@@ -868,27 +1149,20 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 	ANKI_ASSERT(!key.isSkinned() || m_builtinMutators[BuiltinMutatorId::BONES]);
 	ANKI_ASSERT(!key.hasVelocity() || m_builtinMutators[BuiltinMutatorId::VELOCITY]);
 
-	MaterialVariant& variant =
+	MaterialVariant*& variant =
 		m_variantMatrix[key.getPass()][key.getLod()][instanced][key.isSkinned()][key.hasVelocity()];
 
 	// Check if it's initialized
 	{
 		RLockGuard<RWMutex> lock(m_variantMatrixMtx);
-		if(variant.m_prog.isCreated())
+		if(variant && !variant->m_fallbackProgram)
 		{
-			return variant;
+			return *variant;
 		}
 	}
 
-	// Not initialized, init it
-	WLockGuard<RWMutex> lock(m_variantMatrixMtx);
-
-	// Check again
-	if(variant.m_prog.isCreated())
-	{
-		return variant;
-	}
-
+	// Not initialized or it uses a fallback program. The rest of the material doesn't change so don't lock while
+	// getting the variant of the program
 	ShaderProgramResourceVariantInitInfo initInfo(m_prog);
 
 	for(const SubMutation& m : m_nonBuiltinsMutation)
@@ -948,12 +1222,34 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 	}
 
 	const ShaderProgramResourceVariant* progVariant;
-	m_prog->getOrCreateVariant(initInfo, progVariant);
+	m_prog->getOrCreateVariant(initInfo, progVariant, true);
 
-	// Init the variant
-	initVariant(*progVariant, variant, instanced);
+	if(progVariant->isFallback())
+	{
+		// Still compiling, keep the variant of the fallback if there is one
+		RLockGuard<RWMutex> lock(m_variantMatrixMtx);
+		if(variant)
+		{
+			return *variant;
+		}
+	}
+
+	WLockGuard<RWMutex> lock(m_variantMatrixMtx);
+
+	// Check again
+	if(variant && (!variant->m_fallbackProgram || progVariant->isFallback()))
+	{
+		return *variant;
+	}
 
-	return variant;
+	// Init the variant. Don't touch the old one, other threads might be using it
+	MaterialVariant* newVariant = getAllocator().newInstance<MaterialVariant>();
+	initVariant(*progVariant, *newVariant, instanced);
+	newVariant->m_fallbackProgram = progVariant->isFallback();
+	newVariant->m_replacedVariant = variant;
+	variant = newVariant;
+
+	return *variant;
 }
 
 void MaterialResource::initVariant(const ShaderProgramResourceVariant& progVariant, MaterialVariant& variant,
@@ -1125,8 +1421,6 @@ Error MaterialResource::parseRtMaterial(XmlElement rtMaterialEl)
 			return Error::USER_DATA;
 		}
 
-		m_rayTypes |= RayTypeBit(1 << type);
-
 		// shaderProgram
 		CString fname;
 		ANKI_CHECK(rayTypeEl.getAttributeText("shaderProgram", fname));
@@ -1195,15 +1489,7 @@ Error MaterialResource::parseRtMaterial(XmlElement rtMaterialEl)
 		}
 
 		// Get the shader group handle
-		ShaderProgramResourceVariantInitInfo variantInitInfo(m_rtPrograms[type]);
-		for(const SubMutation& subMutation : mutatorValues)
-		{
-			variantInitInfo.addMutation(subMutation.m_mutator->m_name, subMutation.m_value);
-		}
-
-		const ShaderProgramResourceVariant* progVariant;
-		m_rtPrograms[type]->getOrCreateVariant(variantInitInfo, progVariant);
-		m_rtShaderGroupHandleIndices[type] = progVariant->getHitShaderGroupHandleIndex();
+		initRtVariant(type, mutatorValues);
 
 		// Advance
 		ANKI_CHECK(rayTypeEl.getNextSiblingElement("rayType", rayTypeEl));
@@ -1234,15 +1520,7 @@ Error MaterialResource::parseRtMaterial(XmlElement rtMaterialEl)
 					CString fname;
 					ANKI_CHECK(inputEl.getAttributeText("value", fname));
 
-					const U32 textureIdx = GPU_MATERIAL_TEXTURES[i].m_textureSlot;
-					ANKI_CHECK(getManager().loadResource(fname, m_textureResources[textureIdx], false));
-
-					m_textureViews[m_textureViewCount] = m_textureResources[textureIdx]->getGrTextureView();
-
-					m_materialGpuDescriptor.m_bindlessTextureIndices[textureIdx] =
-						U16(m_textureViews[m_textureViewCount]->getOrCreateBindlessTextureIndex());
-
-					++m_textureViewCount;
+					ANKI_CHECK(loadRtTexture(GPU_MATERIAL_TEXTURES[i].m_textureSlot, fname));
 					found = true;
 					break;
 				}
@@ -1293,4 +1571,40 @@ Error MaterialResource::parseRtMaterial(XmlElement rtMaterialEl)
 	return Error::NONE;
 }
 
+void MaterialResource::initRtVariant(RayType type, ConstWeakArray<SubMutation> mutation)
+{
+	ANKI_ASSERT(m_rtPrograms[type].isCreated() && m_rtMutations[type].getSize() == 0);
+	m_rayTypes |= RayTypeBit(1 << type);
+
+	ShaderProgramResourceVariantInitInfo variantInitInfo(m_rtPrograms[type]);
+	for(const SubMutation& subMutation : mutation)
+	{
+		variantInitInfo.addMutation(subMutation.m_mutator->m_name, subMutation.m_value);
+	}
+
+	const ShaderProgramResourceVariant* progVariant;
+	m_rtPrograms[type]->getOrCreateVariant(variantInitInfo, progVariant);
+	m_rtShaderGroupHandleIndices[type] = progVariant->getHitShaderGroupHandleIndex();
+
+	// Keep it for cooking
+	if(mutation.getSize() > 0)
+	{
+		m_rtMutations[type].create(getAllocator(), mutation.getSize());
+		memcpy(&m_rtMutations[type][0], &mutation[0], mutation.getSizeInBytes());
+	}
+}
+
+Error MaterialResource::loadRtTexture(U32 textureSlot, CString filename)
+{
+	ANKI_CHECK(getManager().loadResource(filename, m_textureResources[textureSlot], false));
+
+	m_textureViews[m_textureViewCount] = m_textureResources[textureSlot]->getGrTextureView();
+
+	m_materialGpuDescriptor.m_bindlessTextureIndices[textureSlot] =
+		U16(m_textureViews[m_textureViewCount]->getOrCreateBindlessTextureIndex());
+
+	++m_textureViewCount;
+	return Error::NONE;
+}
+
 } // end namespace anki
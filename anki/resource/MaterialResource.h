@@ -18,6 +18,8 @@ namespace anki
 
 // Forward
 class XmlElement;
+class XmlDocument;
+class MaterialBinary;
 
 /// @addtogroup resource
 /// @{
@@ -270,6 +272,8 @@ private:
 	BitSet<128, U32> m_activeVars = {false};
 	U32 m_perDrawUboSize = 0;
 	U32 m_perInstanceUboSizeSingleInstance = 0;
+	Bool m_fallbackProgram = false; ///< The program is a fallback, the variant will be replaced when it's compiled.
+	MaterialVariant* m_replacedVariant = nullptr; ///< Keep the replaced variants alive, someone might still use them.
 };
 
 /// Material resource.
@@ -300,6 +304,9 @@ private:
 /// @endcode
 ///
 /// (1): Only for non-builtins.
+///
+/// The parsed material is cooked into a MaterialBinary that is stored in the cache directory. Next time the material
+/// is loaded from that binary unless the XML or the shader programs have changed.
 class MaterialResource : public ResourceObject
 {
 public:
@@ -427,7 +434,7 @@ private:
 	U32 m_prevFrameBoneTrfsBinding = MAX_U32;
 
 	/// Matrix of variants.
-	mutable Array5d<MaterialVariant, U(Pass::COUNT), MAX_LOD_COUNT, 2, 2, 2> m_variantMatrix;
+	mutable Array5d<MaterialVariant*, U(Pass::COUNT), MAX_LOD_COUNT, 2, 2, 2> m_variantMatrix = {};
 	mutable RWMutex m_variantMatrixMtx;
 
 	DynamicArray<MaterialVariable> m_vars;
@@ -436,6 +443,7 @@ private:
 
 	Array<ShaderProgramResourcePtr, U(RayType::COUNT)> m_rtPrograms;
 	Array<U32, U(RayType::COUNT)> m_rtShaderGroupHandleIndices = {};
+	Array<DynamicArray<SubMutation>, U(RayType::COUNT)> m_rtMutations; ///< Kept for cooking.
 
 	MaterialGpuDescriptor m_materialGpuDescriptor;
 
@@ -445,6 +453,15 @@ private:
 
 	RayTypeBit m_rayTypes = RayTypeBit::NONE;
 
+	ANKI_USE_RESULT Error loadXml(const XmlDocument& doc, Bool async);
+
+	/// Load from a cooked binary.
+	/// @param[out] upToDate False if the binary is stale and nothing was loaded.
+	ANKI_USE_RESULT Error loadCooked(const MaterialBinary& binary, Bool async, Bool& upToDate);
+
+	/// Store the loaded material to a cooked binary.
+	void cook(const ResourceFilename& filename, U64 sourceHash) const;
+
 	ANKI_USE_RESULT Error createVars();
 
 	static ANKI_USE_RESULT Error parseVariable(CString fullVarName, Bool instanced, U32& idx, CString& name);
@@ -481,6 +498,10 @@ private:
 	}
 
 	Error parseRtMaterial(XmlElement rootEl);
+
+	void initRtVariant(RayType type, ConstWeakArray<SubMutation> mutation);
+
+	ANKI_USE_RESULT Error loadRtTexture(U32 textureSlot, CString filename);
 };
 /// @}
 
@@ -24,6 +24,7 @@ Error MeshBinaryLoader::load(const ResourceFilename& filename)
 	auto& alloc = m_alloc;
 
 	// Load header
+	m_manager->recordFileDependency(filename);
 	ANKI_CHECK(m_manager->getFilesystem().openFile(filename, m_file));
 	ANKI_CHECK(m_file->read(&m_header, sizeof(m_header)));
 	ANKI_CHECK(checkHeader());
@@ -56,6 +56,18 @@ public:
 		return ConstWeakArray<MeshBinarySubMesh>(m_subMeshes);
 	}
 
+	/// The memory that the index and vertex buffers of the mesh need in the GPU.
+	PtrSize getGpuMemorySize() const
+	{
+		PtrSize size = getAlignedIndexBufferSize();
+		for(U32 i = 0; i < m_header.m_vertexBufferCount; ++i)
+		{
+			size += getAlignedVertexBufferSize(i);
+		}
+
+		return size;
+	}
+
 private:
 	ResourceManager* m_manager;
 	GenericMemoryPoolAllocator<U8> m_alloc;
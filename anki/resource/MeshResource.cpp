@@ -116,7 +116,7 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 	}
 	m_indexBuffer = getManager().getGrManager().newBuffer(
 		BufferInitInfo(indexBuffSize, indexBufferUsage, BufferMapAccessBit::NONE,
-					   StringAuto(getTempAllocator()).sprintf("%s_%s", "Idx", basename.cstr())));
+					   StringInline<64>(getTempAllocator()).sprintf("%s_%s", "Idx", basename.cstr())));
 
 	// Vertex stuff
 	m_vertexCount = header.m_totalVertexCount;
@@ -140,7 +140,7 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 	}
 	m_vertexBuffer = getManager().getGrManager().newBuffer(
 		BufferInitInfo(totalVertexBuffSize, vertexBufferUsage, BufferMapAccessBit::NONE,
-					   StringAuto(getTempAllocator()).sprintf("%s_%s", "Vert", basename.cstr())));
+					   StringInline<64>(getTempAllocator()).sprintf("%s_%s", "Vert", basename.cstr())));
 
 	for(VertexAttributeLocation attrib = VertexAttributeLocation::FIRST; attrib < VertexAttributeLocation::COUNT;
 		++attrib)
@@ -182,7 +182,8 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 	// Create the BLAS
 	if(rayTracingEnabled)
 	{
-		AccelerationStructureInitInfo inf(StringAuto(getTempAllocator()).sprintf("%s_%s", "Blas", basename.cstr()));
+		AccelerationStructureInitInfo inf(
+			StringInline<64>(getTempAllocator()).sprintf("%s_%s", "Blas", basename.cstr()));
 		inf.m_type = AccelerationStructureType::BOTTOM_LEVEL;
 
 		inf.m_bottomLevel.m_indexBuffer = m_indexBuffer;
@@ -270,13 +271,29 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 						   MAX_PTR_SIZE);
 	cmdb->setBufferBarrier(m_indexBuffer, BufferUsageBit::INDEX, BufferUsageBit::TRANSFER_DESTINATION, 0, MAX_PTR_SIZE);
 
-	// Write index buffer
+	// Only the texture streaming needs the UV density
+	const Bool computeUvDensity = getManager().getTextureStreamer() != nullptr
+								  && isVertexAttributePresent(VertexAttributeLocation::UV) && m_indexCount > 0;
+
+	// Write index buffer. Keep a copy of the indices, the positions and the UVs in the CPU if the UV density is needed
+	DynamicArrayAuto<U8, PtrSize> indices(getAllocator());
+	DynamicArrayAuto<U8, PtrSize> positions(getAllocator());
+	DynamicArrayAuto<U8, PtrSize> uvs(getAllocator());
 	{
 		ANKI_CHECK(transferAlloc.allocate(m_indexBuffer->getSize(), handles[1]));
 		void* data = handles[1].getMappedMemory();
 		ANKI_ASSERT(data);
 
-		ANKI_CHECK(loader.storeIndexBuffer(data, m_indexBuffer->getSize()));
+		if(computeUvDensity)
+		{
+			indices.create(m_indexBuffer->getSize());
+			ANKI_CHECK(loader.storeIndexBuffer(&indices[0], indices.getSize()));
+			memcpy(data, &indices[0], indices.getSize());
+		}
+		else
+		{
+			ANKI_CHECK(loader.storeIndexBuffer(data, m_indexBuffer->getSize()));
+		}
 
 		cmdb->copyBufferToBuffer(handles[1].getBuffer(), handles[1].getOffset(), m_indexBuffer, 0,
 								 handles[1].getRange());
@@ -289,14 +306,29 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 		ANKI_ASSERT(data);
 
 		// Load to staging
+		const U32 positionBuffIdx = m_attributes[VertexAttributeLocation::POSITION].m_buffIdx;
+		const U32 uvBuffIdx = (isVertexAttributePresent(VertexAttributeLocation::UV))
+								  ? m_attributes[VertexAttributeLocation::UV].m_buffIdx
+								  : MAX_U32;
 		PtrSize offset = 0;
 		for(U32 i = 0; i < m_vertexBufferInfos.getSize(); ++i)
 		{
 			alignRoundUp(MESH_BINARY_BUFFER_ALIGNMENT, offset);
-			ANKI_CHECK(
-				loader.storeVertexBuffer(i, data + offset, PtrSize(m_vertexBufferInfos[i].m_stride) * m_vertexCount));
-
-			offset += PtrSize(m_vertexBufferInfos[i].m_stride) * m_vertexCount;
+			const PtrSize size = PtrSize(m_vertexBufferInfos[i].m_stride) * m_vertexCount;
+
+			if(computeUvDensity && (i == positionBuffIdx || i == uvBuffIdx))
+			{
+				DynamicArrayAuto<U8, PtrSize>& copy = (i == positionBuffIdx) ? positions : uvs;
+				copy.create(size);
+				ANKI_CHECK(loader.storeVertexBuffer(i, &copy[0], size));
+				memcpy(data + offset, &copy[0], size);
+			}
+			else
+			{
+				ANKI_CHECK(loader.storeVertexBuffer(i, data + offset, size));
+			}
+
+			offset += size;
 		}
 
 		ANKI_ASSERT(offset == m_vertexBuffer->getSize());
@@ -337,6 +369,45 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 	transferAlloc.release(handles[0], fence);
 	transferAlloc.release(handles[1], fence);
 
+	// Compute the UV density
+	if(computeUvDensity)
+	{
+		const AttribInfo& positionInfo = m_attributes[VertexAttributeLocation::POSITION];
+		const AttribInfo& uvInfo = m_attributes[VertexAttributeLocation::UV];
+		ANKI_ASSERT(positionInfo.m_format == Format::R32G32B32_SFLOAT && uvInfo.m_format == Format::R32G32_SFLOAT);
+
+		const U8* positionData = &positions[positionInfo.m_relativeOffset];
+		const U8* uvData = (uvs.getSize()) ? &uvs[uvInfo.m_relativeOffset] : &positions[uvInfo.m_relativeOffset];
+		const PtrSize positionStride = m_vertexBufferInfos[positionInfo.m_buffIdx].m_stride;
+		const PtrSize uvStride = m_vertexBufferInfos[uvInfo.m_buffIdx].m_stride;
+
+		F64 worldArea = 0.0;
+		F64 uvArea = 0.0;
+		for(U32 i = 0; i < m_indexCount; i += 3)
+		{
+			Array<Vec3, 3> pos;
+			Array<Vec2, 3> uv;
+			for(U32 v = 0; v < 3; ++v)
+			{
+				const U32 idx = (m_indexType == IndexType::U16) ? reinterpret_cast<const U16*>(&indices[0])[i + v]
+																: reinterpret_cast<const U32*>(&indices[0])[i + v];
+				ANKI_ASSERT(idx < m_vertexCount);
+				pos[v] = *reinterpret_cast<const Vec3*>(positionData + idx * positionStride);
+				uv[v] = *reinterpret_cast<const Vec2*>(uvData + idx * uvStride);
+			}
+
+			worldArea += (pos[1] - pos[0]).cross(pos[2] - pos[0]).getLength() / 2.0f;
+			const Vec2 uvEdge0 = uv[1] - uv[0];
+			const Vec2 uvEdge1 = uv[2] - uv[0];
+			uvArea += absolute(uvEdge0.x() * uvEdge1.y() - uvEdge0.y() * uvEdge1.x()) / 2.0f;
+		}
+
+		if(worldArea > EPSILON && uvArea > EPSILON)
+		{
+			m_uvDensity.store(F32(sqrt(uvArea / worldArea)));
+		}
+	}
+
 	return Error::NONE;
 }
 
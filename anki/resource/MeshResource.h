@@ -111,6 +111,13 @@ public:
 		return m_meshGpuDescriptor;
 	}
 
+	/// The UV units that a world unit covers on average. The texture streaming uses it. It's 1.0 until the vertices are
+	/// loaded.
+	F32 getUvDensity() const
+	{
+		return m_uvDensity.load();
+	}
+
 	/// Get the buffer that contains all the indices of all submesses.
 	BufferPtr getIndexBuffer() const
 	{
@@ -160,6 +167,7 @@ private:
 	U32 m_vertexCount = 0;
 	Aabb m_aabb;
 	IndexType m_indexType;
+	mutable Atomic<F32> m_uvDensity = {1.0f}; ///< Written by loadAsync().
 
 	// RT
 	AccelerationStructurePtr m_blas;
@@ -0,0 +1,197 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/resource/MeshStreamer.h>
+#include <anki/resource/ModelResource.h>
+#include <anki/resource/ResourceManager.h>
+#include <anki/resource/AsyncLoader.h>
+#include <anki/util/Tracer.h>
+
+namespace anki
+{
+
+static thread_local Bool t_streamTaskRunning = false;
+
+/// Loads the LODs of a model patch in the AsyncLoader.
+class MeshStreamer::StreamTask : public AsyncLoaderTask
+{
+public:
+	MeshStreamer* m_streamer;
+	Result m_result;
+	U32 m_residentFirstLod;
+
+	StreamTask(MeshStreamer* streamer)
+		: m_streamer(streamer)
+	{
+	}
+
+	Error operator()(AsyncLoaderTaskContext& ctx) final
+	{
+		const ModelPatch& patch = *m_result.m_patch;
+
+		t_streamTaskRunning = true;
+		Error err = Error::NONE;
+		for(U32 lod = m_result.m_firstLod; lod < m_residentFirstLod && !err; ++lod)
+		{
+			err = m_streamer->m_manager->loadResource(patch.m_meshFilenames[lod].toCString(), m_result.m_meshes[lod],
+													  false);
+		}
+		t_streamTaskRunning = false;
+
+		if(err)
+		{
+			ANKI_RESOURCE_LOGE("Failed to stream the LODs of model: %s", m_result.m_model->getFilename().cstr());
+		}
+
+		m_result.m_success = !err;
+		m_streamer->addResult(std::move(m_result));
+
+		// Don't stop the loader, the patch keeps the LODs that it has
+		return Error::NONE;
+	}
+};
+
+MeshStreamer::MeshStreamer(ResourceManager* manager, PtrSize budget, AllocAlignedCallback allocCb,
+						   void* allocCbUserData)
+	: m_manager(manager)
+	, m_policy(manager->getAllocator(), budget, MAX_MESH_STREAMING_REQUESTS)
+	, m_tmpAlloc(allocCb, allocCbUserData, 1024 * 1024)
+{
+}
+
+MeshStreamer::~MeshStreamer()
+{
+	// It might delete models so don't hold the lock
+	m_results.destroy(m_manager->getAllocator());
+
+	m_patches.destroy(m_manager->getAllocator());
+}
+
+U32 MeshStreamer::registerModelPatch(ModelPatch* patch, ConstWeakArray<PtrSize> lodSizes)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	// The coarsest LOD is the tail
+	const U32 handle = m_policy.registerResource(lodSizes, lodSizes.getSize() - 1);
+	if(handle >= m_patches.getSize())
+	{
+		m_patches.resize(m_manager->getAllocator(), handle + 1, nullptr);
+	}
+
+	m_patches[handle] = patch;
+	return handle;
+}
+
+void MeshStreamer::unregisterModelPatch(U32 handle)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	m_policy.unregisterResource(handle);
+	m_patches[handle] = nullptr;
+}
+
+void MeshStreamer::requestLod(const ModelPatch& patch, U32 lod)
+{
+	if(patch.m_streamingHandle != MAX_U32)
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		m_policy.requestLevel(patch.m_streamingHandle, lod);
+
+		if(!patch.m_meshes[min<U32>(lod, patch.m_meshLodCount - 1)].isCreated())
+		{
+			++m_lodMissCount;
+		}
+	}
+}
+
+TempResourceAllocator<U8>* MeshStreamer::getStreamingTempAllocator()
+{
+	return (t_streamTaskRunning) ? &m_tmpAlloc : nullptr;
+}
+
+void MeshStreamer::addResult(Result&& result)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	m_results.emplaceBack(m_manager->getAllocator(), std::move(result));
+}
+
+void MeshStreamer::endFrame()
+{
+	ANKI_TRACE_SCOPED_EVENT(RSRC_MESH_STREAMING);
+
+	// Give the LODs that finished loading to the patches
+	DynamicArray<Result> results;
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		results = std::move(m_results);
+	}
+
+	for(Result& result : results)
+	{
+		if(result.m_success)
+		{
+			for(U32 lod = result.m_firstLod; lod < MAX_LOD_COUNT && result.m_meshes[lod].isCreated(); ++lod)
+			{
+				result.m_patch->m_meshes[lod] = std::move(result.m_meshes[lod]);
+			}
+		}
+
+		LockGuard<Mutex> lock(m_mtx);
+		m_policy.completeRequest(result.m_handle, result.m_success);
+	}
+
+	ANKI_TRACE_INC_COUNTER(RSRC_STREAMED_MESHES, results.getSize());
+
+	// It might delete models so don't hold the lock
+	results.destroy(m_manager->getAllocator());
+
+	// Drop the evicted LODs right away and start the new loads
+	DynamicArrayAuto<ResidencyRequest> requests(m_manager->getAllocator());
+	DynamicArrayAuto<MeshResourcePtr> evictedMeshes(m_manager->getAllocator());
+	DynamicArrayAuto<StreamTask*> tasks(m_manager->getAllocator());
+	AsyncLoader& loader = m_manager->getAsyncLoader();
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		m_policy.update(requests);
+
+		for(const ResidencyRequest& request : requests)
+		{
+			ModelPatch& patch = *m_patches[request.m_handle];
+			const U32 residentFirstLod = m_policy.getResidentFirstLevel(request.m_handle);
+
+			if(request.m_firstLevel > residentFirstLod)
+			{
+				for(U32 lod = residentFirstLod; lod < request.m_firstLevel; ++lod)
+				{
+					evictedMeshes.emplaceBack(std::move(patch.m_meshes[lod]));
+				}
+
+				m_policy.completeRequest(request.m_handle, true);
+			}
+			else
+			{
+				StreamTask* task = loader.newTask<StreamTask>(this);
+				task->m_result.m_model.reset(patch.m_model);
+				task->m_result.m_patch = &patch;
+				task->m_result.m_handle = request.m_handle;
+				task->m_result.m_firstLod = request.m_firstLevel;
+				task->m_result.m_success = false;
+				task->m_residentFirstLod = residentFirstLod;
+				tasks.emplaceBack(task);
+			}
+		}
+
+		ANKI_TRACE_INC_COUNTER(RSRC_MESH_LOD_MISSES, m_lodMissCount);
+		ANKI_TRACE_INC_COUNTER(RSRC_STREAMED_MESH_MEMORY, m_policy.getResidentSize());
+		m_lodMissCount = 0;
+	}
+
+	for(StreamTask* task : tasks)
+	{
+		loader.submitTask(task);
+	}
+}
+
+} // end namespace anki
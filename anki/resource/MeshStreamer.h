@@ -0,0 +1,93 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/resource/ResidencyPolicy.h>
+#include <anki/util/Thread.h>
+
+namespace anki
+{
+
+// Forward
+class ModelPatch;
+
+/// @addtogroup resource
+/// @{
+
+/// The number of model patches that can be loading LODs at the same time.
+constexpr U32 MAX_MESH_STREAMING_REQUESTS = 8;
+
+/// Streams the LODs of the model patches. The coarsest LOD of a patch is loaded with the model. Every frame the
+/// renderer asks for the LODs that visibility selected, the ResidencyPolicy decides what fits in the budget and the
+/// finer LODs are loaded in the AsyncLoader. The patches use the coarsest resident LOD until the loads are done.
+class MeshStreamer : public NonCopyable
+{
+public:
+	MeshStreamer(ResourceManager* manager, PtrSize budget, AllocAlignedCallback allocCb, void* allocCbUserData);
+
+	~MeshStreamer();
+
+	/// Add a model patch. It's thread-safe.
+	/// @param lodSizes The GPU memory of each LOD. The first is the finest.
+	/// @return The streaming handle of the patch.
+	U32 registerModelPatch(ModelPatch* patch, ConstWeakArray<PtrSize> lodSizes);
+
+	/// Remove a model patch. It's thread-safe.
+	void unregisterModelPatch(U32 handle);
+
+	/// Ask for a LOD of a model patch in the current frame. It does nothing if the patch is not streamed. It's
+	/// thread-safe.
+	void requestLod(const ModelPatch& patch, U32 lod);
+
+	/// Give the LODs that finished loading to the patches, drop the evicted LODs and start new loads. Call it once per
+	/// frame when the AsyncLoader is paused.
+	void endFrame();
+
+	/// The streaming tasks load meshes in the AsyncLoader thread and they have a temp allocator of their own.
+	/// @return Null if the current thread doesn't run a streaming task.
+	TempResourceAllocator<U8>* getStreamingTempAllocator();
+
+	/// The memory that the LODs of the streamed patches use or will use when the pending loads are done.
+	PtrSize getCommittedSize() const
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		return m_policy.getCommittedSize();
+	}
+
+	/// The memory that the resident LODs of the streamed patches use.
+	PtrSize getResidentSize() const
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		return m_policy.getResidentSize();
+	}
+
+private:
+	class StreamTask;
+
+	class Result
+	{
+	public:
+		ModelResourcePtr m_model;
+		ModelPatch* m_patch;
+		Array<MeshResourcePtr, MAX_LOD_COUNT> m_meshes;
+		U32 m_handle;
+		U32 m_firstLod;
+		Bool m_success;
+	};
+
+	ResourceManager* m_manager;
+	ResidencyPolicy m_policy;
+	DynamicArray<ModelPatch*> m_patches; ///< Indexed by the handle.
+	DynamicArray<Result> m_results; ///< The loads that are done and wait for endFrame().
+	TempResourceAllocator<U8> m_tmpAlloc; ///< The tasks can't share the temp allocator of the ResourceManager.
+	U32 m_lodMissCount = 0; ///< The requests of the current frame that got a coarser LOD.
+	mutable Mutex m_mtx;
+
+	void addResult(Result&& result);
+};
+/// @}
+
+} // end namespace anki
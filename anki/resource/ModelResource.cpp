@@ -6,6 +6,9 @@
 #include <anki/resource/ModelResource.h>
 #include <anki/resource/ResourceManager.h>
 #include <anki/resource/MeshResource.h>
+#include <anki/resource/MeshBinaryLoader.h>
+#include <anki/resource/MeshStreamer.h>
+#include <anki/resource/CookedResourceBinary.h>
 #include <anki/util/Xml.h>
 #include <anki/util/Logger.h>
 
@@ -34,7 +37,7 @@ void ModelPatch::getRenderingInfo(const RenderingKey& key, ModelRenderingInfo& i
 	ANKI_ASSERT(!(!m_model->supportsSkinning() && key.isSkinned()));
 
 	// Get the resources
-	const MeshResource& mesh = *getMesh(min<U32>(key.getLod(), m_meshLodCount - 1));
+	const MeshResource& mesh = *getMesh(key.getLod());
 
 	// Vertex attributes & bindings
 	{
@@ -107,7 +110,7 @@ void ModelPatch::getRayTracingInfo(U32 lod, ModelRayTracingInfo& info) const
 	memset(&info.m_descriptor, 0, sizeof(info.m_descriptor));
 
 	// Mesh
-	const MeshResourcePtr& mesh = m_meshes[min(U32(m_meshLodCount - 1), lod)];
+	const MeshResourcePtr& mesh = getMesh(lod);
 	info.m_bottomLevelAccelerationStructure = mesh->getBottomLevelAccelerationStructure();
 	info.m_descriptor.m_mesh = mesh->getMeshGpuDescriptor();
 	info.m_grObjectReferences[info.m_grObjectReferenceCount++] = mesh->getIndexBuffer();
@@ -143,20 +146,61 @@ Error ModelPatch::init(ModelResource* model, ConstWeakArray<CString> meshFNames,
 	// Load material
 	ANKI_CHECK(manager->loadResource(mtlFName, m_mtl, async));
 
-	// Load meshes
-	m_meshLodCount = 0;
-	for(U32 i = 0; i < meshFNames.getSize(); i++)
+	MeshStreamer* streamer = manager->getMeshStreamer();
+	if(streamer && meshFNames.getSize() > 1)
 	{
-		ANKI_CHECK(manager->loadResource(meshFNames[i], m_meshes[i], async));
+		// Read only the headers of the LODs and load the coarsest. The rest are streamed
+		Array<PtrSize, MAX_LOD_COUNT> lodSizes;
+		U32 subMeshCount = 0;
+		Bool boneInfo = false;
+		for(U32 lod = 0; lod < meshFNames.getSize(); ++lod)
+		{
+			MeshBinaryLoader loader(manager);
+			ANKI_CHECK(loader.load(meshFNames[lod]));
+			const MeshBinaryHeader& header = loader.getHeader();
+
+			if(lod == 0)
+			{
+				subMeshCount = header.m_subMeshCount;
+				boneInfo = loader.hasBoneInfo();
+				m_boundingShape.setMin(header.m_aabbMin);
+				m_boundingShape.setMax(header.m_aabbMax);
+			}
+			else if(header.m_subMeshCount != subMeshCount || loader.hasBoneInfo() != boneInfo)
+			{
+				// Sanity check
+				ANKI_RESOURCE_LOGE("Meshes not compatible");
+				return Error::USER_DATA;
+			}
+
+			lodSizes[lod] = loader.getGpuMemorySize();
+			m_meshFilenames[lod].create(manager->getAllocator(), meshFNames[lod]);
+		}
+
+		m_meshLodCount = U8(meshFNames.getSize());
+		ANKI_CHECK(manager->loadResource(meshFNames[m_meshLodCount - 1], m_meshes[m_meshLodCount - 1], async));
 
-		// Sanity check
-		if(i > 0 && !m_meshes[i]->isCompatible(*m_meshes[i - 1]))
+		m_streamingHandle =
+			streamer->registerModelPatch(this, ConstWeakArray<PtrSize>(&lodSizes[0], m_meshLodCount));
+	}
+	else
+	{
+		m_meshLodCount = 0;
+		for(U32 i = 0; i < meshFNames.getSize(); i++)
 		{
-			ANKI_RESOURCE_LOGE("Meshes not compatible");
-			return Error::USER_DATA;
+			ANKI_CHECK(manager->loadResource(meshFNames[i], m_meshes[i], async));
+
+			// Sanity check
+			if(i > 0 && !m_meshes[i]->isCompatible(*m_meshes[i - 1]))
+			{
+				ANKI_RESOURCE_LOGE("Meshes not compatible");
+				return Error::USER_DATA;
+			}
+
+			++m_meshLodCount;
 		}
 
-		++m_meshLodCount;
+		m_boundingShape = m_meshes[0]->getBoundingShape();
 	}
 
 	return Error::NONE;
@@ -170,18 +214,42 @@ ModelResource::ModelResource(ResourceManager* manager)
 ModelResource::~ModelResource()
 {
 	auto alloc = getAllocator();
+
+	for(ModelPatch& patch : m_modelPatches)
+	{
+		if(patch.m_streamingHandle != MAX_U32)
+		{
+			getManager().getMeshStreamer()->unregisterModelPatch(patch.m_streamingHandle);
+		}
+
+		for(String& filename : patch.m_meshFilenames)
+		{
+			filename.destroy(alloc);
+		}
+	}
+
 	m_modelPatches.destroy(alloc);
 }
 
 Error ModelResource::load(const ResourceFilename& filename, Bool async)
 {
-	auto alloc = getAllocator();
+	StringAuto txt(getTempAllocator());
+	ANKI_CHECK(openFileReadAllText(filename, txt));
+	const U64 sourceHash = computeCookedBinaryHash(txt);
+
+	// Try the cooked binary first
+	ModelBinary* cookedBinary;
+	ANKI_CHECK(loadCookedBinary(filename, MODEL_BINARY_MAGIC, sourceHash, cookedBinary));
+	if(cookedBinary)
+	{
+		const Error err = loadInternal(*cookedBinary, async);
+		freeCookedBinary(cookedBinary);
+		return err;
+	}
 
-	// Load
-	//
-	XmlElement el;
+	// Parse the XML
 	XmlDocument doc;
-	ANKI_CHECK(openFileParseXml(filename, doc));
+	ANKI_CHECK(doc.parse(txt.toCString(), getTempAllocator()));
 
 	XmlElement rootEl;
 	ANKI_CHECK(doc.getChildElement("model", rootEl));
@@ -202,73 +270,104 @@ Error ModelResource::load(const ResourceFilename& filename, Bool async)
 		ANKI_CHECK(modelPatchEl.getNextSiblingElement("modelPatch", modelPatchEl));
 	} while(modelPatchEl);
 
-	// Check number of model patches
-	if(count < 1)
-	{
-		ANKI_RESOURCE_LOGE("Zero number of model patches");
-		return Error::USER_DATA;
-	}
-
-	m_modelPatches.create(alloc, count);
+	DynamicArrayAuto<ModelBinaryPatch> patches(getTempAllocator(), count);
 
 	count = 0;
 	ANKI_CHECK(modelPatchesEl.getChildElement("modelPatch", modelPatchEl));
 	do
 	{
+		ModelBinaryPatch& patch = patches[count];
+
+		// <mesh>, <mesh1> and <mesh2>
+		static const Array<CString, MAX_LOD_COUNT> meshTags = {"mesh", "mesh1", "mesh2"};
+		for(U32 lod = 0; lod < MAX_LOD_COUNT; ++lod)
+		{
+			XmlElement meshEl;
+			if(lod == 0)
+			{
+				ANKI_CHECK(modelPatchEl.getChildElement(meshTags[lod], meshEl));
+			}
+			else
+			{
+				ANKI_CHECK(modelPatchEl.getChildElementOptional(meshTags[lod], meshEl));
+			}
+
+			if(meshEl)
+			{
+				CString cstr;
+				ANKI_CHECK(meshEl.getText(cstr));
+				patch.m_meshes[patch.m_meshCount++] = toCookedString(cstr);
+			}
+		}
+
+		// <material>
 		XmlElement materialEl;
 		ANKI_CHECK(modelPatchEl.getChildElement("material", materialEl));
+		CString cstr;
+		ANKI_CHECK(materialEl.getText(cstr));
+		patch.m_material = toCookedString(cstr);
 
-		Array<CString, 3> meshesFnames;
-		U32 meshesCount = 1;
+		// Move to next
+		ANKI_CHECK(modelPatchEl.getNextSiblingElement("modelPatch", modelPatchEl));
+		++count;
+	} while(modelPatchEl);
+	ANKI_ASSERT(count == patches.getSize());
 
-		XmlElement meshEl;
-		ANKI_CHECK(modelPatchEl.getChildElement("mesh", meshEl));
+	// Load and cook it for the next time
+	ModelBinary binary;
+	memcpy(&binary.m_magic[0], MODEL_BINARY_MAGIC, sizeof(binary.m_magic));
+	binary.m_sourceHash = sourceHash;
+	binary.m_modelPatches = WeakArray<ModelBinaryPatch>(patches);
 
-		XmlElement meshEl1;
-		ANKI_CHECK(modelPatchEl.getChildElementOptional("mesh1", meshEl1));
+	ANKI_CHECK(loadInternal(binary, async));
+	storeCookedBinary(filename, binary);
+
+	return Error::NONE;
+}
 
-		XmlElement meshEl2;
-		ANKI_CHECK(modelPatchEl.getChildElementOptional("mesh2", meshEl2));
+Error ModelResource::loadInternal(const ModelBinary& binary, Bool async)
+{
+	// Check number of model patches
+	if(binary.m_modelPatches.getSize() < 1)
+	{
+		ANKI_RESOURCE_LOGE("Zero number of model patches");
+		return Error::USER_DATA;
+	}
 
-		ANKI_CHECK(meshEl.getText(meshesFnames[0]));
+	m_modelPatches.create(getAllocator(), binary.m_modelPatches.getSize());
 
-		if(meshEl1)
+	for(U32 i = 0; i < m_modelPatches.getSize(); ++i)
+	{
+		const ModelBinaryPatch& in = binary.m_modelPatches[i];
+		if(in.m_meshCount < 1 || in.m_meshCount > MAX_LOD_COUNT)
 		{
-			++meshesCount;
-			ANKI_CHECK(meshEl1.getText(meshesFnames[1]));
+			ANKI_RESOURCE_LOGE("Wrong number of meshes");
+			return Error::USER_DATA;
 		}
 
-		if(meshEl2)
+		Array<CString, MAX_LOD_COUNT> meshesFnames;
+		for(U32 lod = 0; lod < in.m_meshCount; ++lod)
 		{
-			++meshesCount;
-			ANKI_CHECK(meshEl2.getText(meshesFnames[2]));
+			meshesFnames[lod] = fromCookedString(in.m_meshes[lod]);
 		}
 
-		CString cstr;
-		ANKI_CHECK(materialEl.getText(cstr));
-
-		ANKI_CHECK(m_modelPatches[count].init(this, ConstWeakArray<CString>(&meshesFnames[0], meshesCount), cstr, async,
-											  &getManager()));
+		ANKI_CHECK(m_modelPatches[i].init(this, ConstWeakArray<CString>(&meshesFnames[0], in.m_meshCount),
+										  fromCookedString(in.m_material), async, &getManager()));
 
-		if(count > 0 && m_modelPatches[count].supportsSkinning() != m_modelPatches[count - 1].supportsSkinning())
+		if(i > 0 && m_modelPatches[i].supportsSkinning() != m_modelPatches[i - 1].supportsSkinning())
 		{
 			ANKI_RESOURCE_LOGE("All model patches should support skinning or all shouldn't support skinning");
 			return Error::USER_DATA;
 		}
 
-		m_skinning = m_modelPatches[count].supportsSkinning();
-
-		// Move to next
-		ANKI_CHECK(modelPatchEl.getNextSiblingElement("modelPatch", modelPatchEl));
-		++count;
-	} while(modelPatchEl);
-	ANKI_ASSERT(count == m_modelPatches.getSize());
+		m_skinning = m_modelPatches[i].supportsSkinning();
+	}
 
 	// Calculate compound bounding volume
-	m_boundingVolume = m_modelPatches[0].m_meshes[0]->getBoundingShape();
+	m_boundingVolume = m_modelPatches[0].getBoundingShape();
 	for(auto it = m_modelPatches.getBegin() + 1; it != m_modelPatches.getEnd(); ++it)
 	{
-		m_boundingVolume = m_boundingVolume.getCompoundShape((*it).m_meshes[0]->getBoundingShape());
+		m_boundingVolume = m_boundingVolume.getCompoundShape((*it).getBoundingShape());
 	}
 
 	return Error::NONE;
@@ -15,6 +15,9 @@
 namespace anki
 {
 
+// Forward
+class ModelBinary;
+
 /// @addtogroup resource
 /// @{
 
@@ -93,10 +96,12 @@ public:
 	U32 m_grObjectReferenceCount;
 };
 
-/// Model patch class. Its very important class and it binds a material with a few mesh (one for each LOD).
+/// Model patch class. Its very important class and it binds a material with a few mesh (one for each LOD). When the
+/// MeshStreamer is enabled only the coarsest LOD is loaded with the patch and the finer LODs are streamed.
 class ModelPatch
 {
 	friend class ModelResource;
+	friend class MeshStreamer;
 
 public:
 	const MaterialResourcePtr& getMaterial() const
@@ -104,14 +109,27 @@ public:
 		return m_mtl;
 	}
 
+	/// Get the mesh of a LOD. If the LOD is not resident get the closest coarser LOD that is.
 	const MeshResourcePtr& getMesh(U32 lod) const
 	{
+		lod = min<U32>(lod, m_meshLodCount - 1);
+		while(!m_meshes[lod].isCreated())
+		{
+			++lod;
+		}
+
 		return m_meshes[lod];
 	}
 
+	U32 getMeshLodCount() const
+	{
+		return m_meshLodCount;
+	}
+
+	/// The bounding box of the finest LOD.
 	const Aabb& getBoundingShape() const
 	{
-		return m_meshes[0]->getBoundingShape();
+		return m_boundingShape;
 	}
 
 	/// Get information for rendering.
@@ -125,12 +143,28 @@ public:
 		return m_mtl->getSupportedRayTracingTypes();
 	}
 
+	/// Set the LODs without loading them. The null LODs are the ones that are not resident and the coarsest can't be
+	/// null. It's used to test the patch without a mesh file.
+	ANKI_INTERNAL void setMeshes(ConstWeakArray<MeshResourcePtr> meshes)
+	{
+		ANKI_ASSERT(meshes.getSize() > 0 && meshes.getSize() <= MAX_LOD_COUNT && meshes.getBack().isCreated());
+		for(U32 lod = 0; lod < meshes.getSize(); ++lod)
+		{
+			m_meshes[lod] = meshes[lod];
+		}
+
+		m_meshLodCount = U8(meshes.getSize());
+	}
+
 private:
 	ModelResource* m_model ANKI_DEBUG_CODE(= nullptr);
 
 	MaterialResourcePtr m_mtl;
 
-	Array<MeshResourcePtr, MAX_LOD_COUNT> m_meshes; ///< One for each LOD
+	Array<MeshResourcePtr, MAX_LOD_COUNT> m_meshes; ///< One for each LOD. The streamed LODs might be null.
+	Array<String, MAX_LOD_COUNT> m_meshFilenames; ///< Only the streamed patches keep them.
+	Aabb m_boundingShape;
+	U32 m_streamingHandle = MAX_U32;
 	U8 m_meshLodCount = 0;
 
 	ANKI_USE_RESULT Error init(ModelResource* model, ConstWeakArray<CString> meshFNames, const CString& mtlFName,
@@ -138,7 +172,7 @@ private:
 
 	ANKI_USE_RESULT Bool supportsSkinning() const
 	{
-		return m_meshes[0]->hasBoneWeights() && m_mtl->supportsSkinning();
+		return getMesh(0)->hasBoneWeights() && m_mtl->supportsSkinning();
 	}
 };
 
@@ -163,6 +197,8 @@ private:
 /// Requirements:
 /// - If the materials need texture coords then mesh should have them
 /// - If the subMeshIndex is not present then assume the whole mesh
+///
+/// The parsed XML is cooked to a ModelBinary in the cache directory and the next loads skip the XML.
 class ModelResource : public ResourceObject
 {
 public:
@@ -192,6 +228,8 @@ private:
 	DynamicArray<ModelPatch> m_modelPatches;
 	Aabb m_boundingVolume;
 	Bool m_skinning = false;
+
+	ANKI_USE_RESULT Error loadInternal(const ModelBinary& binary, Bool async);
 };
 /// @}
 
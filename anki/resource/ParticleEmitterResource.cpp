@@ -6,6 +6,7 @@
 #include <anki/resource/ParticleEmitterResource.h>
 #include <anki/resource/ResourceManager.h>
 #include <anki/resource/ModelResource.h>
+#include <anki/resource/CookedResourceBinary.h>
 #include <anki/util/StringList.h>
 #include <anki/util/Xml.h>
 #include <cstring>
@@ -25,6 +26,8 @@ ANKI_USE_RESULT Error getXmlVal(const XmlElement& el, const CString& tag, Vec3&
 	return el.getAttributeNumbersOptional(tag, out, found);
 }
 
+static_assert(PARTICLE_EMITTER_BINARY_PROPERTIES_SIZE >= sizeof(ParticleEmitterProperties), "See file");
+
 ParticleEmitterResource::ParticleEmitterResource(ResourceManager* manager)
 	: ResourceObject(manager)
 {
@@ -36,8 +39,26 @@ ParticleEmitterResource::~ParticleEmitterResource()
 
 Error ParticleEmitterResource::load(const ResourceFilename& filename, Bool async)
 {
+	StringAuto txt(getTempAllocator());
+	ANKI_CHECK(openFileReadAllText(filename, txt));
+
+	// The binary has a raw copy of the ParticleEmitterProperties so it depends on their layout
+	const Array<U64, 2> parameters = {sizeof(ParticleEmitterProperties), PARTICLE_EMITTER_BINARY_PROPERTIES_VERSION};
+	const U64 sourceHash = computeCookedBinaryHash(txt, computeHash(&parameters[0], parameters.getSizeInBytes()));
+
+	// Try the cooked binary first
+	ParticleEmitterBinary* cookedBinary;
+	ANKI_CHECK(loadCookedBinary(filename, PARTICLE_EMITTER_BINARY_MAGIC, sourceHash, cookedBinary));
+	if(cookedBinary)
+	{
+		const Error err = loadInternal(*cookedBinary, async);
+		freeCookedBinary(cookedBinary);
+		return err;
+	}
+
+	// Parse the XML
 	XmlDocument doc;
-	ANKI_CHECK(openFileParseXml(filename, doc));
+	ANKI_CHECK(doc.parse(txt.toCString(), getTempAllocator()));
 	XmlElement rootEl; // Root element
 	ANKI_CHECK(doc.getChildElement("particleEmitter", rootEl));
 
@@ -84,8 +105,25 @@ Error ParticleEmitterResource::load(const ResourceFilename& filename, Bool async
 	CString cstr;
 	ANKI_CHECK(rootEl.getChildElement("material", el));
 	ANKI_CHECK(el.getAttributeText("value", cstr));
-	ANKI_CHECK(getManager().loadResource(cstr, m_material, async));
 
+	// Load and cook it for the next time
+	ParticleEmitterBinary binary;
+	memcpy(&binary.m_magic[0], PARTICLE_EMITTER_BINARY_MAGIC, sizeof(binary.m_magic));
+	binary.m_sourceHash = sourceHash;
+	memcpy(&binary.m_properties[0], static_cast<const ParticleEmitterProperties*>(this),
+		   sizeof(ParticleEmitterProperties));
+	binary.m_material = toCookedString(cstr);
+
+	ANKI_CHECK(loadInternal(binary, async));
+	storeCookedBinary(filename, binary);
+
+	return Error::NONE;
+}
+
+Error ParticleEmitterResource::loadInternal(const ParticleEmitterBinary& binary, Bool async)
+{
+	memcpy(static_cast<ParticleEmitterProperties*>(this), &binary.m_properties[0], sizeof(ParticleEmitterProperties));
+	ANKI_CHECK(getManager().loadResource(fromCookedString(binary.m_material), m_material, async));
 	return Error::NONE;
 }
 
@@ -15,11 +15,13 @@ namespace anki
 {
 
 class XmlElement;
+class ParticleEmitterBinary;
 
 /// @addtogroup resource
 /// @{
 
-/// The particle emitter properties. Different class from ParticleEmitterResource so it can be inherited
+/// The particle emitter properties. Different class from ParticleEmitterResource so it can be inherited. The cooked
+/// binaries have a raw copy of it, bump PARTICLE_EMITTER_BINARY_PROPERTIES_VERSION when its layout changes.
 class ParticleEmitterProperties
 {
 public:
@@ -100,7 +102,8 @@ public:
 	}
 };
 
-/// This is the properties of the particle emitter resource
+/// This is the properties of the particle emitter resource. The parsed XML is cooked to a ParticleEmitterBinary in the
+/// cache directory and the next loads skip the XML.
 class ParticleEmitterResource : public ResourceObject, private ParticleEmitterProperties
 {
 public:
@@ -128,7 +131,7 @@ private:
 	MaterialResourcePtr m_material;
 	U8 m_lodCount = 1; ///< Cache the value from the material
 
-	void loadInternal(const XmlElement& el);
+	ANKI_USE_RESULT Error loadInternal(const ParticleEmitterBinary& binary, Bool async);
 
 	template<typename T>
 	ANKI_USE_RESULT Error readVar(const XmlElement& rootEl, CString varName, T& minVal, T& maxVal, const T* defaultVal);
@@ -0,0 +1,242 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/resource/ResidencyPolicy.h>
+#include <algorithm>
+
+namespace anki
+{
+
+ResidencyPolicy::~ResidencyPolicy()
+{
+	for(Resource& rsrc : m_resources)
+	{
+		rsrc.m_sizeFromLevel.destroy(m_alloc);
+	}
+
+	m_resources.destroy(m_alloc);
+	m_freeHandles.destroy(m_alloc);
+}
+
+U32 ResidencyPolicy::registerResource(ConstWeakArray<PtrSize> levelSizes, U32 tailFirstLevel)
+{
+	ANKI_ASSERT(tailFirstLevel < levelSizes.getSize());
+
+	U32 handle;
+	if(m_freeHandles.getSize())
+	{
+		handle = m_freeHandles.getBack();
+		m_freeHandles.popBack(m_alloc);
+	}
+	else
+	{
+		handle = m_resources.getSize();
+		m_resources.emplaceBack(m_alloc);
+	}
+
+	Resource& rsrc = m_resources[handle];
+	rsrc.m_sizeFromLevel.create(m_alloc, levelSizes.getSize());
+	PtrSize size = 0;
+	for(U32 level = levelSizes.getSize(); level > 0; --level)
+	{
+		size += levelSizes[level - 1];
+		rsrc.m_sizeFromLevel[level - 1] = size;
+	}
+
+	rsrc.m_lastUsedFrame = 0;
+	rsrc.m_tailFirstLevel = tailFirstLevel;
+	rsrc.m_residentFirstLevel = tailFirstLevel;
+	rsrc.m_targetFirstLevel = tailFirstLevel;
+	rsrc.m_requestedLevel = MAX_U32;
+	rsrc.m_pending = false;
+
+	m_committedSize += rsrc.m_sizeFromLevel[tailFirstLevel];
+	m_residentSize += rsrc.m_sizeFromLevel[tailFirstLevel];
+
+	return handle;
+}
+
+void ResidencyPolicy::unregisterResource(U32 handle)
+{
+	Resource& rsrc = m_resources[handle];
+	ANKI_ASSERT(rsrc.m_tailFirstLevel != MAX_U32);
+
+	if(rsrc.m_pending)
+	{
+		ANKI_ASSERT(m_pendingRequestCount > 0);
+		--m_pendingRequestCount;
+		rsrc.m_pending = false;
+	}
+
+	m_committedSize -= rsrc.m_sizeFromLevel[rsrc.m_targetFirstLevel];
+	m_residentSize -= rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel];
+
+	rsrc.m_sizeFromLevel.destroy(m_alloc);
+	rsrc.m_tailFirstLevel = MAX_U32;
+	m_freeHandles.emplaceBack(m_alloc, handle);
+}
+
+void ResidencyPolicy::requestLevel(U32 handle, U32 level)
+{
+	Resource& rsrc = m_resources[handle];
+	ANKI_ASSERT(rsrc.m_tailFirstLevel != MAX_U32);
+
+	rsrc.m_requestedLevel = min(rsrc.m_requestedLevel, min(level, rsrc.m_tailFirstLevel));
+	rsrc.m_lastUsedFrame = m_frame;
+}
+
+void ResidencyPolicy::addRequest(U32 handle, U32 firstLevel, DynamicArrayAuto<ResidencyRequest>& requests)
+{
+	Resource& rsrc = m_resources[handle];
+	ANKI_ASSERT(!rsrc.m_pending && firstLevel != rsrc.m_residentFirstLevel);
+
+	m_committedSize =
+		m_committedSize - rsrc.m_sizeFromLevel[rsrc.m_targetFirstLevel] + rsrc.m_sizeFromLevel[firstLevel];
+	rsrc.m_targetFirstLevel = firstLevel;
+	rsrc.m_pending = true;
+	++m_pendingRequestCount;
+
+	ResidencyRequest& request = *requests.emplaceBack();
+	request.m_handle = handle;
+	request.m_firstLevel = firstLevel;
+}
+
+void ResidencyPolicy::update(DynamicArrayAuto<ResidencyRequest>& requests)
+{
+	class Load
+	{
+	public:
+		U32 m_handle;
+		U32 m_level;
+	};
+
+	// Gather the resources that want more levels and the resources that have levels to spare
+	DynamicArrayAuto<Load> loads(m_alloc);
+	DynamicArrayAuto<U32> evictions(m_alloc);
+	PtrSize evictableSize = 0;
+	for(U32 handle = 0; handle < m_resources.getSize(); ++handle)
+	{
+		const Resource& rsrc = m_resources[handle];
+		if(rsrc.m_tailFirstLevel == MAX_U32 || rsrc.m_pending)
+		{
+			continue;
+		}
+
+		const U32 evictionLevel = computeEvictionLevel(rsrc);
+		if(evictionLevel > rsrc.m_residentFirstLevel)
+		{
+			evictions.emplaceBack(handle);
+			evictableSize += rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel] - rsrc.m_sizeFromLevel[evictionLevel];
+		}
+		else if(rsrc.m_lastUsedFrame == m_frame && rsrc.m_requestedLevel < rsrc.m_residentFirstLevel)
+		{
+			Load& load = *loads.emplaceBack();
+			load.m_handle = handle;
+			load.m_level = rsrc.m_requestedLevel;
+		}
+	}
+
+	// The resources that are missing the most levels go first
+	std::sort(loads.getBegin(), loads.getEnd(), [this](const Load& a, const Load& b) {
+		const U32 missingA = m_resources[a.m_handle].m_residentFirstLevel - a.m_level;
+		const U32 missingB = m_resources[b.m_handle].m_residentFirstLevel - b.m_level;
+		return (missingA != missingB) ? missingA > missingB : a.m_handle < b.m_handle;
+	});
+
+	// The resources that were used least recently are evicted first
+	std::sort(evictions.getBegin(), evictions.getEnd(), [this](U32 a, U32 b) {
+		const U64 frameA = m_resources[a].m_lastUsedFrame;
+		const U64 frameB = m_resources[b].m_lastUsedFrame;
+		return (frameA != frameB) ? frameA < frameB : a < b;
+	});
+
+	U32 evictionCount = 0;
+	auto evictNext = [&]() {
+		const U32 handle = evictions[evictionCount++];
+		const Resource& rsrc = m_resources[handle];
+		const U32 evictionLevel = computeEvictionLevel(rsrc);
+		evictableSize -= rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel] - rsrc.m_sizeFromLevel[evictionLevel];
+		addRequest(handle, evictionLevel, requests);
+	};
+
+	// Get under the budget if it shrunk
+	while(m_committedSize > m_budget && evictionCount < evictions.getSize()
+		  && m_pendingRequestCount < m_maxPendingRequests)
+	{
+		evictNext();
+	}
+
+	for(const Load& load : loads)
+	{
+		if(m_pendingRequestCount >= m_maxPendingRequests)
+		{
+			break;
+		}
+
+		// Find the biggest level that fits if everything that can be evicted is evicted
+		const Resource& rsrc = m_resources[load.m_handle];
+		U32 level = load.m_level;
+		while(level < rsrc.m_residentFirstLevel
+			  && m_committedSize + rsrc.m_sizeFromLevel[level] - rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel]
+					 > m_budget + evictableSize)
+		{
+			++level;
+		}
+
+		if(level == rsrc.m_residentFirstLevel)
+		{
+			continue;
+		}
+
+		const PtrSize extraSize = rsrc.m_sizeFromLevel[level] - rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel];
+
+		// Keep a request for the load
+		while(m_committedSize + extraSize > m_budget && m_pendingRequestCount + 1 < m_maxPendingRequests)
+		{
+			evictNext();
+		}
+
+		if(m_committedSize + extraSize > m_budget)
+		{
+			// Out of requests, try again the next frame
+			break;
+		}
+
+		addRequest(load.m_handle, level, requests);
+	}
+
+	// Start a new frame
+	for(Resource& rsrc : m_resources)
+	{
+		rsrc.m_requestedLevel = MAX_U32;
+	}
+
+	++m_frame;
+}
+
+void ResidencyPolicy::completeRequest(U32 handle, Bool success)
+{
+	Resource& rsrc = m_resources[handle];
+	ANKI_ASSERT(rsrc.m_pending);
+	ANKI_ASSERT(m_pendingRequestCount > 0);
+
+	if(success)
+	{
+		m_residentSize = m_residentSize - rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel]
+						 + rsrc.m_sizeFromLevel[rsrc.m_targetFirstLevel];
+		rsrc.m_residentFirstLevel = rsrc.m_targetFirstLevel;
+	}
+	else
+	{
+		m_committedSize = m_committedSize - rsrc.m_sizeFromLevel[rsrc.m_targetFirstLevel]
+						  + rsrc.m_sizeFromLevel[rsrc.m_residentFirstLevel];
+		rsrc.m_targetFirstLevel = rsrc.m_residentFirstLevel;
+	}
+
+	rsrc.m_pending = false;
+	--m_pendingRequestCount;
+}
+
+} // end namespace anki
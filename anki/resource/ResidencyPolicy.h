@@ -0,0 +1,141 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/resource/Common.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/WeakArray.h>
+
+namespace anki
+{
+
+/// @addtogroup resource
+/// @{
+
+/// A change of the resident levels of a resource that the ResidencyPolicy asks for.
+class ResidencyRequest
+{
+public:
+	U32 m_handle;
+	U32 m_firstLevel; ///< The first level that will be resident. The levels after it are resident as well.
+};
+
+/// Decides which levels of the streamed resources are resident. A level is a mip of a texture or a LOD of a mesh. Level
+/// 0 is the biggest and when a level is resident all the levels after it are resident as well. Every frame it gets the
+/// levels that the visible resources need and it asks for the loads that fit in a memory budget. When the budget is not
+/// enough it evicts the levels of the resources that were used least recently. It only does the bookkeeping, the
+/// loading is done by someone else. It's not thread-safe.
+class ResidencyPolicy : public NonCopyable
+{
+public:
+	/// @param budget The memory that the resident levels of all the resources can use.
+	/// @param maxPendingRequests The number of requests that can be in flight at the same time.
+	ResidencyPolicy(GenericMemoryPoolAllocator<U8> alloc, PtrSize budget, U32 maxPendingRequests)
+		: m_alloc(alloc)
+		, m_budget(budget)
+		, m_maxPendingRequests(maxPendingRequests)
+	{
+		ANKI_ASSERT(maxPendingRequests > 0);
+	}
+
+	~ResidencyPolicy();
+
+	/// Add a resource. Its tail is resident from the start and it's never evicted.
+	/// @param levelSizes The size in bytes of each level. The first is the biggest.
+	/// @param tailFirstLevel The first level of the tail.
+	/// @return A handle for the rest of the methods.
+	U32 registerResource(ConstWeakArray<PtrSize> levelSizes, U32 tailFirstLevel);
+
+	/// Remove a resource. If a request of the resource is pending it's dropped and completeRequest() should not be
+	/// called for it.
+	void unregisterResource(U32 handle);
+
+	/// Ask for a level of a resource in the current frame. If it's asked more than once the biggest level wins.
+	void requestLevel(U32 handle, U32 level);
+
+	/// Decide what to load and what to evict. Call it once per frame after the requestLevel() calls. The memory of the
+	/// evicted levels is considered free right away.
+	/// @param[out] requests The changes that need to happen. Call completeRequest() when each of them is done.
+	void update(DynamicArrayAuto<ResidencyRequest>& requests);
+
+	/// Call it when a request that update() returned is done.
+	/// @param success If it's false the levels that were resident before the request stay resident.
+	void completeRequest(U32 handle, Bool success);
+
+	U32 getResidentFirstLevel(U32 handle) const
+	{
+		return m_resources[handle].m_residentFirstLevel;
+	}
+
+	Bool isRequestPending(U32 handle) const
+	{
+		return m_resources[handle].m_pending;
+	}
+
+	/// The memory that the resident levels will use when all the pending requests are done.
+	PtrSize getCommittedSize() const
+	{
+		return m_committedSize;
+	}
+
+	/// The memory that the resident levels use.
+	PtrSize getResidentSize() const
+	{
+		return m_residentSize;
+	}
+
+	PtrSize getBudget() const
+	{
+		return m_budget;
+	}
+
+	/// The resources are evicted in the next update() if the new budget is smaller.
+	void setBudget(PtrSize budget)
+	{
+		m_budget = budget;
+	}
+
+	U32 getPendingRequestCount() const
+	{
+		return m_pendingRequestCount;
+	}
+
+private:
+	class Resource
+	{
+	public:
+		DynamicArray<PtrSize> m_sizeFromLevel; ///< The size of a level and all the levels after it.
+		U64 m_lastUsedFrame = 0;
+		U32 m_tailFirstLevel = MAX_U32; ///< MAX_U32 if the resource is not registered.
+		U32 m_residentFirstLevel = MAX_U32;
+		U32 m_targetFirstLevel = MAX_U32; ///< Same as m_residentFirstLevel if there is no pending request.
+		U32 m_requestedLevel = MAX_U32; ///< The level of the current frame.
+		Bool m_pending = false;
+	};
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	DynamicArray<Resource> m_resources; ///< Indexed by the handle.
+	DynamicArray<U32> m_freeHandles;
+	PtrSize m_budget;
+	PtrSize m_committedSize = 0;
+	PtrSize m_residentSize = 0;
+	U64 m_frame = 1;
+	U32 m_pendingRequestCount = 0;
+	U32 m_maxPendingRequests;
+
+	/// The level that a resource can drop to when it's evicted.
+	U32 computeEvictionLevel(const Resource& rsrc) const
+	{
+		return (rsrc.m_lastUsedFrame == m_frame)
+				   ? min(rsrc.m_tailFirstLevel, max(rsrc.m_requestedLevel, rsrc.m_targetFirstLevel))
+				   : rsrc.m_tailFirstLevel;
+	}
+
+	void addRequest(U32 handle, U32 firstLevel, DynamicArrayAuto<ResidencyRequest>& requests);
+};
+/// @}
+
+} // end namespace anki
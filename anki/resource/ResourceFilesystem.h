@@ -101,6 +101,27 @@ public:
 		return Error::NONE;
 	}
 
+	/// Iterate the filenames of the paths that are plain directories. Archives and the cache are skipped.
+	/// @param func A functor with signature Error(CString directory, CString filename). The filename is relative to the
+	///             directory.
+	template<typename TFunc>
+	ANKI_USE_RESULT Error iterateAllDirectoryFilenames(TFunc func) const
+	{
+		for(const Path& path : m_paths)
+		{
+			if(path.m_isArchive || path.m_isCache)
+			{
+				continue;
+			}
+
+			for(const String& fname : path.m_files)
+			{
+				ANKI_CHECK(func(path.m_path.toCString(), fname.toCString()));
+			}
+		}
+		return Error::NONE;
+	}
+
 #if !ANKI_TESTS
 private:
 #endif
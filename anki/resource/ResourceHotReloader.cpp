@@ -0,0 +1,561 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/resource/ResourceHotReloader.h>
+#include <anki/resource/ResourceManager.h>
+#include <anki/resource/ResourceObject.h>
+#include <anki/resource/ResourceFilesystem.h>
+#include <anki/resource/AsyncLoader.h>
+#include <anki/resource/ShaderProgramResourceSystem.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/Tracer.h>
+
+namespace anki
+{
+
+/// The filename of the resource that the current thread loads.
+static thread_local const char* t_loadingFilename = nullptr;
+
+/// The batch that the current thread reloads.
+static thread_local ResourceHotReloadBatch* t_reloadBatch = nullptr;
+
+/// The changed files of a few frames and the resources that are reloaded because of them.
+class ResourceHotReloadBatch
+{
+public:
+	enum class Phase : U8
+	{
+		COMPILE_PROGRAMS,
+		GATHER,
+		RELOAD,
+		FLUSH,
+		DONE
+	};
+
+	class Reloaded
+	{
+	public:
+		ResourceObject* m_rsrc;
+		ResourceHotReloader::ReloadedResourceCallback m_publish;
+		ResourceHotReloader::ReloadedResourceCallback m_release;
+	};
+
+	ResourceManager* m_manager;
+	ResourceHotReloader* m_reloader;
+	Second m_detectTime;
+
+	StringListAuto m_changedFilenames;
+	StringListAuto m_programFilenames;
+	StringListAuto m_reloadFilenames;
+	StringList::Iterator m_nextReload;
+
+	HashMapAuto<U64, Reloaded> m_reloaded; ///< The key is the hash of the filename.
+	HashMapAuto<U64, U64> m_mustReload; ///< Used as a set, the value is the key.
+
+	Thread m_compileThread = {"RsrcHotReload"};
+	Atomic<U32> m_compileDone = {0};
+	Bool m_compileStarted = false;
+
+	/// Only the AsyncLoader thread writes it. The main thread reads it when the AsyncLoader is paused.
+	Phase m_phase = Phase::COMPILE_PROGRAMS;
+
+	ResourceHotReloadBatch(ResourceManager* manager, ResourceHotReloader* reloader, Second detectTime)
+		: m_manager(manager)
+		, m_reloader(reloader)
+		, m_detectTime(detectTime)
+		, m_changedFilenames(manager->getAllocator())
+		, m_programFilenames(manager->getAllocator())
+		, m_reloadFilenames(manager->getAllocator())
+		, m_reloaded(manager->getAllocator())
+		, m_mustReload(manager->getAllocator())
+	{
+	}
+
+	/// Do a small part of the work so the AsyncLoader can run the other tasks in between.
+	void step(Bool& resubmit);
+
+	static Error compileThreadCallback(ThreadCallbackInfo& info)
+	{
+		ResourceHotReloadBatch& self = *static_cast<ResourceHotReloadBatch*>(info.m_userData);
+		const Error err = self.m_manager->getShaderProgramResourceSystem().recompilePrograms(self.m_programFilenames);
+		self.m_compileDone.store(1);
+		return err;
+	}
+};
+
+/// Runs a ResourceHotReloadBatch one step at a time.
+class ResourceHotReloadTask : public AsyncLoaderTask
+{
+public:
+	ResourceHotReloadBatch* m_batch;
+
+	ResourceHotReloadTask(ResourceHotReloadBatch* batch)
+		: m_batch(batch)
+	{
+	}
+
+	Error operator()(AsyncLoaderTaskContext& ctx) final
+	{
+		// Never return an error, that would stop the AsyncLoader
+		t_reloadBatch = m_batch;
+		m_batch->step(ctx.m_resubmitTask);
+		t_reloadBatch = nullptr;
+		return Error::NONE;
+	}
+};
+
+void ResourceHotReloadBatch::step(Bool& resubmit)
+{
+	resubmit = true;
+
+	switch(m_phase)
+	{
+	case Phase::COMPILE_PROGRAMS:
+		if(!m_compileStarted)
+		{
+			ShaderProgramResourceSystem& programs = m_manager->getShaderProgramResourceSystem();
+			for(const String& fname : m_changedFilenames)
+			{
+				programs.invalidateSourceFile(fname.toCString(), m_programFilenames);
+			}
+
+			if(m_programFilenames.isEmpty())
+			{
+				m_phase = Phase::GATHER;
+			}
+			else
+			{
+				// Compile in another thread, the AsyncLoader has other tasks to run
+				m_compileStarted = true;
+				m_compileThread.start(this, compileThreadCallback);
+			}
+		}
+		else if(m_compileDone.load())
+		{
+			m_compileStarted = false;
+			if(m_compileThread.join())
+			{
+				ANKI_RESOURCE_LOGE("Failed to compile the changed shader programs. The old binaries will be used");
+			}
+
+			m_phase = Phase::GATHER;
+		}
+		else
+		{
+			HighRezTimer::sleep(1.0 / 1000.0);
+		}
+		break;
+	case Phase::GATHER:
+	{
+		StringListAuto changedFilenames(m_manager->getAllocator());
+		for(const String& fname : m_changedFilenames)
+		{
+			changedFilenames.pushBack(fname.toCString());
+		}
+
+		for(const String& fname : m_programFilenames)
+		{
+			changedFilenames.pushBack(fname.toCString());
+		}
+
+		m_reloader->getDependencyGraph().getDependents(changedFilenames, m_reloadFilenames);
+		for(const String& fname : m_reloadFilenames)
+		{
+			const U64 hash = fname.toCString().computeHash();
+			m_mustReload.emplace(hash, hash);
+		}
+
+		m_nextReload = m_reloadFilenames.getBegin();
+		m_phase = Phase::RELOAD;
+		break;
+	}
+	case Phase::RELOAD:
+		if(m_nextReload == m_reloadFilenames.getEnd())
+		{
+			m_phase = Phase::FLUSH;
+		}
+		else
+		{
+			ANKI_TRACE_SCOPED_EVENT(RSRC_HOT_RELOAD);
+
+			const CString fname = m_nextReload->toCString();
+			++m_nextReload;
+
+			if(m_manager->reloadResource(fname))
+			{
+				// The resources that load it will keep using the old one
+				ANKI_RESOURCE_LOGE("Failed to reload %s. The old version will be kept", fname.cstr());
+				auto it = m_mustReload.find(fname.computeHash());
+				ANKI_ASSERT(it != m_mustReload.getEnd());
+				m_mustReload.erase(it);
+			}
+		}
+		break;
+	case Phase::FLUSH:
+		// The tasks that the reloaded resources submitted are before this one in the queue so they are done
+		m_phase = Phase::DONE;
+		resubmit = false;
+		break;
+	default:
+		ANKI_ASSERT(0);
+	}
+}
+
+ResourceDependencyGraph::~ResourceDependencyGraph()
+{
+	for(Node* node : m_nodes)
+	{
+		node->m_fname.destroy(m_alloc);
+		node->m_dependents.destroy(m_alloc);
+		m_alloc.deleteInstance(node);
+	}
+	m_nodes.destroy(m_alloc);
+}
+
+ResourceDependencyGraph::Node& ResourceDependencyGraph::getOrCreateNode(CString fname)
+{
+	const U64 hash = fname.computeHash();
+	auto it = m_nodes.find(hash);
+	if(it != m_nodes.getEnd())
+	{
+		return **it;
+	}
+
+	Node* node = m_alloc.newInstance<Node>();
+	node->m_fname.create(m_alloc, fname);
+	m_nodes.emplace(m_alloc, hash, node);
+	return *node;
+}
+
+void ResourceDependencyGraph::addDependency(CString resourceFilename, CString filename)
+{
+	if(resourceFilename == filename)
+	{
+		return;
+	}
+
+	const U64 resourceHash = resourceFilename.computeHash();
+
+	LockGuard<Mutex> lock(m_mtx);
+
+	getOrCreateNode(resourceFilename);
+	Node& node = getOrCreateNode(filename);
+	for(U64 hash : node.m_dependents)
+	{
+		if(hash == resourceHash)
+		{
+			return;
+		}
+	}
+
+	node.m_dependents.emplaceBack(m_alloc, resourceHash);
+}
+
+void ResourceDependencyGraph::getDependents(const StringListAuto& changedFilenames, StringListAuto& dependents) const
+{
+	HashMapAuto<U64, U64> visited(m_alloc); // Used as a set, the value is the key
+	DynamicArrayAuto<U64> queue(m_alloc);
+
+	LockGuard<Mutex> lock(m_mtx);
+
+	for(const String& fname : changedFilenames)
+	{
+		const U64 hash = fname.toCString().computeHash();
+		if(visited.find(hash) == visited.getEnd())
+		{
+			visited.emplace(hash, hash);
+			queue.emplaceBack(hash);
+			dependents.pushBack(fname.toCString());
+		}
+	}
+
+	// Breadth first so the files that changed come before the resources that load them
+	for(U32 i = 0; i < queue.getSize(); ++i)
+	{
+		auto it = m_nodes.find(queue[i]);
+		if(it == m_nodes.getEnd())
+		{
+			continue;
+		}
+
+		for(U64 hash : (*it)->m_dependents)
+		{
+			if(visited.find(hash) != visited.getEnd())
+			{
+				continue;
+			}
+
+			visited.emplace(hash, hash);
+			queue.emplaceBack(hash);
+
+			auto dependentIt = m_nodes.find(hash);
+			ANKI_ASSERT(dependentIt != m_nodes.getEnd());
+			dependents.pushBack((*dependentIt)->m_fname.toCString());
+		}
+	}
+}
+
+ResourceHotReloader::LoadingScope::LoadingScope(ResourceHotReloader* reloader, CString filename)
+	: m_enabled(reloader != nullptr)
+{
+	if(m_enabled)
+	{
+		m_prevFilename = t_loadingFilename;
+		t_loadingFilename = filename.cstr();
+	}
+}
+
+ResourceHotReloader::LoadingScope::~LoadingScope()
+{
+	if(m_enabled)
+	{
+		t_loadingFilename = m_prevFilename;
+	}
+}
+
+ResourceHotReloader::ResourceHotReloader(ResourceManager* manager)
+	: m_manager(manager)
+	, m_graph(manager->getAllocator())
+{
+}
+
+ResourceHotReloader::~ResourceHotReloader()
+{
+	if(m_batch)
+	{
+		deleteBatch();
+	}
+
+	ResourceAllocator<U8> alloc = m_manager->getAllocator();
+	for(String& dir : m_watchDirs)
+	{
+		dir.destroy(alloc);
+	}
+	m_watchDirs.destroy(alloc);
+
+	m_pendingFilenames.destroy(alloc);
+}
+
+Error ResourceHotReloader::init(AllocAlignedCallback allocCb, void* allocCbUserData)
+{
+	m_tmpAlloc = TempResourceAllocator<U8>(allocCb, allocCbUserData, 10 * 1024 * 1024);
+
+	// One watch for every directory because they don't watch the subdirectories. They share the INotify so the poll
+	// is a single syscall
+	ResourceAllocator<U8> alloc = m_manager->getAllocator();
+	ANKI_CHECK(m_inotify.init(alloc));
+	HashMapAuto<U64, U64> dirs(alloc); // Used as a set, the value is the key
+	ANKI_CHECK(m_manager->getFilesystem().iterateAllDirectoryFilenames([&](CString path, CString fname) -> Error {
+		const char* lastSlash = nullptr;
+		for(const char* c = fname.getBegin(); c != fname.getEnd(); ++c)
+		{
+			if(*c == '/')
+			{
+				lastSlash = c;
+			}
+		}
+
+		StringAuto dir(alloc);
+		StringAuto fullDir(alloc);
+		if(lastSlash)
+		{
+			dir.create(fname.getBegin(), lastSlash);
+			fullDir.sprintf("%s/%s", path.cstr(), dir.cstr());
+		}
+		else
+		{
+			fullDir.create(path);
+		}
+
+		const U64 hash = fullDir.toCString().computeHash();
+		if(dirs.find(hash) != dirs.getEnd())
+		{
+			return Error::NONE;
+		}
+		dirs.emplace(hash, hash);
+
+		U32 pathIdx;
+		ANKI_CHECK(m_inotify.addPath(fullDir, pathIdx));
+
+		ANKI_ASSERT(pathIdx == m_watchDirs.getSize());
+		m_watchDirs.emplaceBack(alloc);
+		if(!dir.isEmpty())
+		{
+			m_watchDirs.getBack().create(alloc, dir);
+		}
+
+		return Error::NONE;
+	}));
+
+	ANKI_RESOURCE_LOGI("Hot reload is watching %u directories", m_watchDirs.getSize());
+	return Error::NONE;
+}
+
+void ResourceHotReloader::recordDependency(CString filename)
+{
+	if(t_loadingFilename)
+	{
+		m_graph.addDependency(t_loadingFilename, filename);
+	}
+}
+
+void ResourceHotReloader::pollWatches()
+{
+	ResourceAllocator<U8> alloc = m_manager->getAllocator();
+	const Second now = HighRezTimer::getCurrentTime();
+
+	Bool modified = false;
+	StringListAuto names(alloc);
+	DynamicArrayAuto<U32> namePaths(alloc);
+	if(m_inotify.pollEvents(modified, &names, &namePaths))
+	{
+		return;
+	}
+
+	U32 nameIdx = 0;
+	for(const String& name : names)
+	{
+		const String& dir = m_watchDirs[namePaths[nameIdx++]];
+
+		StringAuto fname(alloc);
+		if(dir.isEmpty())
+		{
+			fname.create(name.toCString());
+		}
+		else
+		{
+			fname.sprintf("%s/%s", dir.cstr(), name.cstr());
+		}
+
+		Bool pending = false;
+		for(const String& pendingFname : m_pendingFilenames)
+		{
+			if(pendingFname == fname.toCString())
+			{
+				pending = true;
+				break;
+			}
+		}
+
+		if(!pending)
+		{
+			if(m_pendingFilenames.isEmpty())
+			{
+				m_firstChangeTime = now;
+			}
+
+			m_pendingFilenames.pushBack(alloc, fname.toCString());
+		}
+
+		m_lastChangeTime = now;
+	}
+}
+
+void ResourceHotReloader::endFrame()
+{
+	pollWatches();
+
+	if(m_batch && m_batch->m_phase == ResourceHotReloadBatch::Phase::DONE)
+	{
+		publishBatch();
+		deleteBatch();
+	}
+
+	// Start a new batch when the files stop changing. One batch at a time
+	const Second now = HighRezTimer::getCurrentTime();
+	if(!m_batch && !m_pendingFilenames.isEmpty() && now - m_lastChangeTime >= HOT_RELOAD_SETTLE_TIME)
+	{
+		ResourceAllocator<U8> alloc = m_manager->getAllocator();
+		m_batch = alloc.newInstance<ResourceHotReloadBatch>(m_manager, this, m_firstChangeTime);
+		for(const String& fname : m_pendingFilenames)
+		{
+			m_batch->m_changedFilenames.pushBack(fname.toCString());
+		}
+		m_pendingFilenames.destroy(alloc);
+
+		m_manager->getAsyncLoader().submitNewTask<ResourceHotReloadTask>(m_batch);
+	}
+}
+
+void ResourceHotReloader::publishBatch()
+{
+	ANKI_TRACE_SCOPED_EVENT(RSRC_HOT_RELOAD_PUBLISH);
+
+	U32 count = 0;
+	for(const ResourceHotReloadBatch::Reloaded& reloaded : m_batch->m_reloaded)
+	{
+		reloaded.m_publish(*m_manager, reloaded.m_rsrc);
+		++count;
+	}
+
+	const Second now = HighRezTimer::getCurrentTime();
+	ANKI_TRACE_CUSTOM_EVENT(RSRC_HOT_RELOAD_LATENCY, m_batch->m_detectTime, now - m_batch->m_detectTime);
+	ANKI_TRACE_INC_COUNTER(RSRC_HOT_RELOADED, count);
+	ANKI_RESOURCE_LOGI("Reloaded %u resources %.1fms after the files changed", count,
+					   (now - m_batch->m_detectTime) * 1000.0);
+}
+
+void ResourceHotReloader::deleteBatch()
+{
+	if(m_batch->m_compileStarted)
+	{
+		const Error err = m_batch->m_compileThread.join();
+		(void)err;
+	}
+
+	// The published resources hold a reference of their own
+	for(const ResourceHotReloadBatch::Reloaded& reloaded : m_batch->m_reloaded)
+	{
+		reloaded.m_release(*m_manager, reloaded.m_rsrc);
+	}
+
+	m_manager->getAllocator().deleteInstance(m_batch);
+	m_batch = nullptr;
+}
+
+void ResourceHotReloader::findReloadedResource(CString filename, ResourceObject*& rsrc, Bool& mustReload) const
+{
+	rsrc = nullptr;
+	mustReload = false;
+
+	const ResourceHotReloadBatch* batch = t_reloadBatch;
+	if(!batch)
+	{
+		return;
+	}
+
+	const U64 hash = filename.computeHash();
+	auto it = batch->m_reloaded.find(hash);
+	if(it != batch->m_reloaded.getEnd())
+	{
+		rsrc = it->m_rsrc;
+	}
+	else
+	{
+		mustReload = batch->m_mustReload.find(hash) != batch->m_mustReload.getEnd();
+	}
+}
+
+void ResourceHotReloader::addReloadedResource(ResourceObject* rsrc, ReloadedResourceCallback publish,
+											  ReloadedResourceCallback release)
+{
+	ResourceHotReloadBatch* batch = t_reloadBatch;
+	ANKI_ASSERT(batch);
+
+	rsrc->getRefcount().fetchAdd(1);
+
+	ResourceHotReloadBatch::Reloaded reloaded;
+	reloaded.m_rsrc = rsrc;
+	reloaded.m_publish = publish;
+	reloaded.m_release = release;
+	batch->m_reloaded.emplace(rsrc->getFilename().computeHash(), reloaded);
+}
+
+TempResourceAllocator<U8>* ResourceHotReloader::getReloadTempAllocator()
+{
+	return (t_reloadBatch) ? &m_tmpAlloc : nullptr;
+}
+
+} // end namespace anki
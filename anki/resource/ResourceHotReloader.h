@@ -0,0 +1,134 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/resource/Common.h>
+#include <anki/util/HashMap.h>
+#include <anki/util/StringList.h>
+#include <anki/util/Thread.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/INotify.h>
+
+namespace anki
+{
+
+// Forward
+class ResourceObject;
+class ResourceHotReloadBatch;
+
+/// @addtogroup resource
+/// @{
+
+/// The time a file needs to stay untouched before it's reloaded. Editors write a file in more than one step.
+constexpr Second HOT_RELOAD_SETTLE_TIME = 0.1;
+
+/// A thread-safe graph of the files that the resources read. A file is a resource or any other file that a resource
+/// reads while it's loaded. It's used to find the resources that need to be loaded again when a file changes.
+class ResourceDependencyGraph : public NonCopyable
+{
+public:
+	ResourceDependencyGraph(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~ResourceDependencyGraph();
+
+	/// Record that a resource reads a file or loads another resource.
+	void addDependency(CString resourceFilename, CString filename);
+
+	/// Get the files that depend on some files, directly or not.
+	/// @param[out] dependents The changed files and all the resources that depend on them. There are no duplicates.
+	void getDependents(const StringListAuto& changedFilenames, StringListAuto& dependents) const;
+
+private:
+	class Node
+	{
+	public:
+		String m_fname;
+		DynamicArray<U64> m_dependents; ///< The hashes of the filenames of the resources that read this file.
+	};
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	HashMap<U64, Node*> m_nodes; ///< The key is the hash of the filename.
+	mutable Mutex m_mtx;
+
+	Node& getOrCreateNode(CString fname);
+};
+
+/// Watches the directories of the ResourceFilesystem and loads again the resources whose files change. The new
+/// resources are loaded in the AsyncLoader and they replace the old ones in ResourceManager::endFrame().
+class ResourceHotReloader : public NonCopyable
+{
+public:
+	using ReloadedResourceCallback = void (*)(ResourceManager& manager, ResourceObject* rsrc);
+
+	/// While a resource is loaded the resources and the files that it loads are its dependencies.
+	class LoadingScope : public NonCopyable
+	{
+	public:
+		LoadingScope(ResourceHotReloader* reloader, CString filename);
+
+		~LoadingScope();
+
+	private:
+		const char* m_prevFilename = nullptr;
+		Bool m_enabled = false;
+	};
+
+	ResourceHotReloader(ResourceManager* manager);
+
+	~ResourceHotReloader();
+
+	ANKI_USE_RESULT Error init(AllocAlignedCallback allocCb, void* allocCbUserData);
+
+	/// Check for changes and publish the resources that finished reloading. Call it when the AsyncLoader is paused.
+	void endFrame();
+
+	/// Record that the resource that the current thread loads reads a file.
+	void recordDependency(CString filename);
+
+	ResourceDependencyGraph& getDependencyGraph()
+	{
+		return m_graph;
+	}
+
+	/// Used by ResourceManager::loadResource when the current thread reloads resources.
+	/// @param[out] rsrc The new resource if it's already reloaded.
+	/// @param[out] mustReload True if the resource is going to be replaced so it needs to be loaded again.
+	void findReloadedResource(CString filename, ResourceObject*& rsrc, Bool& mustReload) const;
+
+	/// Keep a reloaded resource until it's published. It takes a reference.
+	/// @param publish Replaces the old resource in the ResourceManager.
+	/// @param release Releases the reference.
+	void addReloadedResource(ResourceObject* rsrc, ReloadedResourceCallback publish, ReloadedResourceCallback release);
+
+	/// Get the temp allocator of the current thread if it reloads resources.
+	TempResourceAllocator<U8>* getReloadTempAllocator();
+
+private:
+	ResourceManager* m_manager;
+	ResourceDependencyGraph m_graph;
+	TempResourceAllocator<U8> m_tmpAlloc; ///< The reload thread can't share the temp allocator of the ResourceManager.
+
+	INotify m_inotify; ///< Watches all the directories.
+	DynamicArray<String> m_watchDirs; ///< The directory of each path of m_inotify relative to the ResourceFilesystem.
+
+	StringList m_pendingFilenames; ///< Changed files that wait for the next batch.
+	Second m_firstChangeTime = 0.0;
+	Second m_lastChangeTime = 0.0;
+
+	ResourceHotReloadBatch* m_batch = nullptr; ///< The batch that is reloading.
+
+	void pollWatches();
+
+	void publishBatch();
+
+	void deleteBatch();
+};
+/// @}
+
+} // end namespace anki
@@ -6,6 +6,9 @@
 #include <anki/resource/ResourceManager.h>
 #include <anki/resource/AsyncLoader.h>
 #include <anki/resource/ShaderProgramResourceSystem.h>
+#include <anki/resource/ResourceHotReloader.h>
+#include <anki/resource/TextureStreamer.h>
+#include <anki/resource/MeshStreamer.h>
 #include <anki/resource/AnimationResource.h>
 #include <anki/util/Logger.h>
 #include <anki/core/ConfigSet.h>
@@ -34,6 +37,9 @@ ResourceManager::~ResourceManager()
 {
 	m_cacheDir.destroy(m_alloc);
 	m_alloc.deleteInstance(m_asyncLoader);
+	m_alloc.deleteInstance(m_hotReloader);
+	m_alloc.deleteInstance(m_textureStreamer);
+	m_alloc.deleteInstance(m_meshStreamer);
 	m_alloc.deleteInstance(m_shaderProgramSystem);
 	m_alloc.deleteInstance(m_transferGpuAlloc);
 }
@@ -68,8 +74,43 @@ Error ResourceManager::init(ResourceManagerInitInfo& init)
 	ANKI_CHECK(m_transferGpuAlloc->init(init.m_config->getNumberU32("rsrc_transferScratchMemorySize"), m_gr, m_alloc));
 
 	// Init the programs
+	ShaderProgramPostCompileFlag postCompileFlags = ShaderProgramPostCompileFlag::NONE;
+	if(init.m_config->getBool("rsrc_stripShaderDebugInfo"))
+	{
+		postCompileFlags |= ShaderProgramPostCompileFlag::STRIP_DEBUG_INFO;
+	}
+
+	if(init.m_config->getBool("rsrc_compressShaderBinaries"))
+	{
+		postCompileFlags |= ShaderProgramPostCompileFlag::COMPRESS_CODE_BLOCKS;
+	}
+
 	m_shaderProgramSystem = m_alloc.newInstance<ShaderProgramResourceSystem>(m_cacheDir, m_gr, m_fs, m_alloc);
-	ANKI_CHECK(m_shaderProgramSystem->init());
+	ANKI_CHECK(m_shaderProgramSystem->init(init.m_config->getString("rsrc_shaderVariantManifest"),
+										   init.m_config->getBool("rsrc_recordShaderVariantManifest"),
+										   postCompileFlags));
+
+	// Init the hot reload
+	if(init.m_config->getBool("rsrc_hotReload"))
+	{
+		m_hotReloader = m_alloc.newInstance<ResourceHotReloader>(this);
+		ANKI_CHECK(m_hotReloader->init(init.m_allocCallback, init.m_allocCallbackData));
+	}
+
+	// Init the texture streaming. Ray tracing keeps the bindless indices of the texture views so the views can't change
+	if(init.m_config->getBool("rsrc_textureStreaming") && !m_gr->getDeviceCapabilities().m_rayTracingEnabled)
+	{
+		m_textureStreamer =
+			m_alloc.newInstance<TextureStreamer>(this, init.m_config->getNumberU64("rsrc_textureStreamingBudget"));
+	}
+
+	// Init the mesh streaming. Same as the textures, ray tracing keeps the addresses of the buffers of the meshes
+	if(init.m_config->getBool("rsrc_meshStreaming") && !m_gr->getDeviceCapabilities().m_rayTracingEnabled)
+	{
+		m_meshStreamer =
+			m_alloc.newInstance<MeshStreamer>(this, init.m_config->getNumberU64("rsrc_meshStreamingBudget"),
+											  init.m_allocCallback, init.m_allocCallbackData);
+	}
 
 	return Error::NONE;
 }
@@ -79,20 +120,126 @@ U64 ResourceManager::getAsyncTaskCompletedCount() const
 	return m_asyncLoader->getCompletedTaskCount();
 }
 
+TempResourceAllocator<U8>& ResourceManager::getTempAllocator()
+{
+	TempResourceAllocator<U8>* alloc = (m_hotReloader) ? m_hotReloader->getReloadTempAllocator() : nullptr;
+	if(!alloc && m_meshStreamer)
+	{
+		alloc = m_meshStreamer->getStreamingTempAllocator();
+	}
+
+	return (alloc) ? *alloc : m_tmpAlloc;
+}
+
+void ResourceManager::endFrame()
+{
+	if(m_hotReloader)
+	{
+		m_hotReloader->endFrame();
+	}
+
+	if(m_textureStreamer)
+	{
+		m_textureStreamer->endFrame();
+	}
+
+	if(m_meshStreamer)
+	{
+		m_meshStreamer->endFrame();
+	}
+}
+
+void ResourceManager::recordFileDependency(CString filename)
+{
+	if(m_hotReloader)
+	{
+		m_hotReloader->recordDependency(filename);
+	}
+}
+
+Error ResourceManager::reloadResource(CString filename)
+{
+	// A file might be loaded as more than one type
+#define ANKI_INSTANTIATE_RESOURCE(rsrc_, ptr_) \
+	if(findLoadedResource<rsrc_>(filename)) \
+	{ \
+		ptr_ ptr; \
+		ANKI_CHECK(loadResource(filename, ptr, false)); \
+	}
+#define ANKI_INSTANSIATE_RESOURCE_DELIMITER()
+#include <anki/resource/InstantiationMacros.h>
+#undef ANKI_INSTANTIATE_RESOURCE
+#undef ANKI_INSTANSIATE_RESOURCE_DELIMITER
+
+	return Error::NONE;
+}
+
+template<typename T>
+void ResourceManager::publishReloadedResource(ResourceManager& manager, ResourceObject* rsrc)
+{
+	T* newPtr = static_cast<T*>(rsrc);
+
+	LockGuard<Mutex> lock(manager.m_registryMtx);
+
+	// If no-one holds the old version there is nothing to replace
+	T* oldPtr = manager.TypeResourceManager<T>::findLoadedResource(newPtr->getFilename());
+	if(oldPtr)
+	{
+		ANKI_ASSERT(oldPtr->m_replacement == nullptr);
+		manager.TypeResourceManager<T>::unregisterResource(oldPtr);
+
+		// The old version holds the new one so refreshResource() can find it
+		newPtr->getRefcount().fetchAdd(1);
+		oldPtr->m_replacement = newPtr;
+
+		manager.TypeResourceManager<T>::registerResource(newPtr);
+	}
+}
+
+template<typename T>
+void ResourceManager::releaseReloadedResource(ResourceManager& manager, ResourceObject* rsrc)
+{
+	T* ptr = static_cast<T*>(rsrc);
+	if(ptr->getRefcount().fetchSub(1) == 1)
+	{
+		ResourcePtrDeleter<T> deleter;
+		deleter(ptr);
+	}
+}
+
 template<typename T>
 Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out, Bool async)
 {
 	ANKI_ASSERT(!out.isCreated() && "Already loaded");
 
 	Error err = Error::NONE;
-	++m_loadRequestCount;
+	m_loadRequestCount.fetchAdd(1);
+
+	// The resource that loads this one depends on it
+	recordFileDependency(filename);
+
+	// When the current thread reloads resources the resources that are replaced are loaded again and the new versions
+	// are shared between the resources that load them
+	Bool reload = false;
+	if(m_hotReloader)
+	{
+		ResourceObject* reloaded;
+		m_hotReloader->findReloadedResource(filename, reloaded, reload);
+		if(reloaded)
+		{
+			out.reset(static_cast<T*>(reloaded));
+			return err;
+		}
+	}
 
-	T* const other = findLoadedResource<T>(filename);
+	// Take the reference in the lock, a resource that is found might be deleted right after the lock is released
+	T* const other = (reload) ? nullptr : retainLoadedResource<T>(filename);
 
 	if(other)
 	{
-		// Found
+		// Found. Drop the reference of the lookup, the out holds one
 		out.reset(other);
+		other->getRefcount().fetchSub(1);
 	}
 	else
 	{
@@ -104,12 +251,13 @@ Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out
 		ptr->getRefcount().fetchAdd(1);
 
 		// Populate the ptr. Use a block to cleanup temp_pool allocations
-		auto& pool = m_tmpAlloc.getMemoryPool();
+		auto& pool = getTempAllocator().getMemoryPool();
 
 		{
 			U allocsCountBefore = pool.getAllocationsCount();
 			(void)allocsCountBefore;
 
+			ResourceHotReloader::LoadingScope loadingScope(m_hotReloader, filename);
 			err = ptr->load(filename, async);
 			if(err)
 			{
@@ -122,7 +270,7 @@ Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out
 		}
 
 		ptr->setFilename(filename);
-		ptr->setUuid(++m_uuid);
+		ptr->setUuid(m_uuid.fetchAdd(1) + 1);
 
 		// Reset the memory pool if no-one is using it.
 		// NOTE: Check because resources load other resources
@@ -131,12 +279,34 @@ Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out
 			pool.reset();
 		}
 
-		// Register resource
-		registerResource(ptr);
-		out.reset(ptr);
+		if(reload)
+		{
+			// It will be registered when it replaces the old version
+			m_hotReloader->addReloadedResource(ptr, publishReloadedResource<T>, releaseReloadedResource<T>);
+			out.reset(ptr);
+		}
+		else
+		{
+			// Register resource. The hot reload might have loaded the same resource in the meantime
+			LockGuard<Mutex> lock(m_registryMtx);
+			T* const other2 = TypeResourceManager<T>::retainLoadedResource(filename);
+			if(other2)
+			{
+				out.reset(other2);
+				other2->getRefcount().fetchSub(1);
+			}
+			else
+			{
+				TypeResourceManager<T>::registerResource(ptr);
+				out.reset(ptr);
+			}
+		}
 
 		// Decrement because of the increment happened a few lines above
-		ptr->getRefcount().fetchSub(1);
+		if(ptr->getRefcount().fetchSub(1) == 1)
+		{
+			m_alloc.deleteInstance(ptr);
+		}
 	}
 
 	return err;
@@ -9,6 +9,8 @@
 #include <anki/util/List.h>
 #include <anki/util/Functions.h>
 #include <anki/util/String.h>
+#include <anki/util/Thread.h>
+#include <anki/util/Atomic.h>
 
 namespace anki
 {
@@ -22,6 +24,10 @@ class AsyncLoader;
 class ResourceManagerModel;
 class ShaderCompilerCache;
 class ShaderProgramResourceSystem;
+class ResourceHotReloader;
+class ResourceObject;
+class TextureStreamer;
+class MeshStreamer;
 
 /// @addtogroup resource
 /// @{
@@ -47,6 +53,25 @@ protected:
 		return (it != m_ptrs.end()) ? *it : nullptr;
 	}
 
+	/// Find a resource and take a reference of it. The registry lock should be held.
+	Type* retainLoadedResource(const CString& filename)
+	{
+		Type* ptr = findLoadedResource(filename);
+		if(ptr)
+		{
+			I32 refcount = ptr->getRefcount().load();
+			do
+			{
+				if(refcount == 0)
+				{
+					return nullptr;
+				}
+			} while(!ptr->getRefcount().compareExchange(refcount, refcount + 1));
+		}
+
+		return ptr;
+	}
+
 	void registerResource(Type* ptr)
 	{
 		ANKI_ASSERT(find(ptr->getFilename()) == m_ptrs.getEnd());
@@ -55,9 +80,15 @@ protected:
 
 	void unregisterResource(Type* ptr)
 	{
-		auto it = find(ptr->getFilename());
-		ANKI_ASSERT(it != m_ptrs.end());
-		m_ptrs.erase(m_alloc, it);
+		// Search by pointer because a reloaded resource with the same name might have replaced it
+		for(auto it = m_ptrs.getBegin(); it != m_ptrs.getEnd(); ++it)
+		{
+			if(*it == ptr)
+			{
+				m_ptrs.erase(m_alloc, it);
+				break;
+			}
+		}
 	}
 
 	void init(ResourceAllocator<U8> alloc)
@@ -77,7 +108,9 @@ private:
 
 		for(it = m_ptrs.getBegin(); it != m_ptrs.getEnd(); ++it)
 		{
-			if((*it)->getFilename() == filename)
+			// A resource that its refcount dropped to zero is being deleted and it counts as not loaded. It will
+			// unregister itself
+			if((*it)->getFilename() == filename && (*it)->getRefcount().load() > 0)
 			{
 				break;
 			}
@@ -127,6 +160,27 @@ public:
 	template<typename T>
 	ANKI_USE_RESULT Error loadResource(const CString& filename, ResourcePtr<T>& out, Bool async = true);
 
+	/// Call it once per frame when the AsyncLoader is paused. The resources that were reloaded replace the old ones,
+	/// the textures that got more mips replace their GPU textures and the model patches get their streamed LODs.
+	void endFrame();
+
+	/// If the resource was reloaded point to the newest version of it. The old version stays alive as long as someone
+	/// holds it.
+	/// @return True if the pointer changed.
+	template<typename T>
+	static Bool refreshResource(ResourcePtr<T>& ptr)
+	{
+		Bool refreshed = false;
+		while(ptr.isCreated() && ptr->getReplacement())
+		{
+			ResourcePtr<T> newPtr(static_cast<T*>(ptr->getReplacement()));
+			ptr = newPtr;
+			refreshed = true;
+		}
+
+		return refreshed;
+	}
+
 	// Internals:
 
 	ANKI_INTERNAL U32 getMaxTextureSize() const
@@ -144,10 +198,8 @@ public:
 		return m_alloc;
 	}
 
-	ANKI_INTERNAL TempResourceAllocator<U8>& getTempAllocator()
-	{
-		return m_tmpAlloc;
-	}
+	/// The thread that reloads resources and the thread that streams meshes have temp allocators of their own.
+	ANKI_INTERNAL TempResourceAllocator<U8>& getTempAllocator();
 
 	ANKI_INTERNAL GrManager& getGrManager()
 	{
@@ -180,30 +232,58 @@ public:
 	template<typename T>
 	ANKI_INTERNAL T* findLoadedResource(const CString& filename)
 	{
+		LockGuard<Mutex> lock(m_registryMtx);
 		return TypeResourceManager<T>::findLoadedResource(filename);
 	}
 
+	template<typename T>
+	ANKI_INTERNAL T* retainLoadedResource(const CString& filename)
+	{
+		LockGuard<Mutex> lock(m_registryMtx);
+		return TypeResourceManager<T>::retainLoadedResource(filename);
+	}
+
 	template<typename T>
 	ANKI_INTERNAL void registerResource(T* ptr)
 	{
+		LockGuard<Mutex> lock(m_registryMtx);
 		TypeResourceManager<T>::registerResource(ptr);
 	}
 
 	template<typename T>
 	ANKI_INTERNAL void unregisterResource(T* ptr)
 	{
+		LockGuard<Mutex> lock(m_registryMtx);
 		TypeResourceManager<T>::unregisterResource(ptr);
 	}
 
+	/// Load again all the loaded resources with that filename. Used by the hot reload.
+	ANKI_INTERNAL ANKI_USE_RESULT Error reloadResource(CString filename);
+
+	/// Record that the resource that the current thread loads reads a file. Used by the hot reload.
+	ANKI_INTERNAL void recordFileDependency(CString filename);
+
 	ANKI_INTERNAL AsyncLoader& getAsyncLoader()
 	{
 		return *m_asyncLoader;
 	}
 
+	/// Null if the texture streaming is disabled.
+	ANKI_INTERNAL TextureStreamer* getTextureStreamer() const
+	{
+		return m_textureStreamer;
+	}
+
+	/// Null if the mesh streaming is disabled.
+	ANKI_INTERNAL MeshStreamer* getMeshStreamer() const
+	{
+		return m_meshStreamer;
+	}
+
 	/// Get the number of times loadResource() was called.
 	ANKI_INTERNAL U64 getLoadingRequestCount() const
 	{
-		return m_loadRequestCount;
+		return m_loadRequestCount.load();
 	}
 
 	/// Get the total number of completed async tasks.
@@ -215,6 +295,11 @@ public:
 		return *m_shaderProgramSystem;
 	}
 
+	ShaderProgramResourceSystem& getShaderProgramResourceSystem()
+	{
+		return *m_shaderProgramSystem;
+	}
+
 private:
 	GrManager* m_gr = nullptr;
 	PhysicsWorld* m_physics = nullptr;
@@ -225,10 +310,23 @@ private:
 	U32 m_maxTextureSize;
 	AsyncLoader* m_asyncLoader = nullptr; ///< Async loading thread
 	ShaderProgramResourceSystem* m_shaderProgramSystem = nullptr;
-	U64 m_uuid = 0;
-	U64 m_loadRequestCount = 0;
+	ResourceHotReloader* m_hotReloader = nullptr; ///< Null if the hot reload is disabled.
+	TextureStreamer* m_textureStreamer = nullptr;
+	MeshStreamer* m_meshStreamer = nullptr;
+	Atomic<U64> m_uuid = {0};
+	Atomic<U64> m_loadRequestCount = {0};
 	TransferGpuAllocator* m_transferGpuAlloc = nullptr;
 	Bool m_dumpShaderSource = false;
+
+	/// Protects the containers of the TypeResourceManagers. The hot reload loads resources in the AsyncLoader thread.
+	Mutex m_registryMtx;
+
+	/// Replace the old version of a reloaded resource.
+	template<typename T>
+	static void publishReloadedResource(ResourceManager& manager, ResourceObject* rsrc);
+
+	template<typename T>
+	static void releaseReloadedResource(ResourceManager& manager, ResourceObject* rsrc);
 };
 /// @}
 
@@ -5,6 +5,7 @@
 
 #include <anki/resource/ResourceObject.h>
 #include <anki/resource/ResourceManager.h>
+#include <anki/resource/CookedResourceBinary.h>
 #include <anki/util/Xml.h>
 
 namespace anki
@@ -33,6 +34,7 @@ TempResourceAllocator<U8> ResourceObject::getTempAllocator() const
 
 Error ResourceObject::openFile(const CString& filename, ResourceFilePtr& file)
 {
+	m_manager->recordFileDependency(filename);
 	return m_manager->getFilesystem().openFile(filename, file);
 }
 
@@ -40,7 +42,7 @@ Error ResourceObject::openFileReadAllText(const CString& filename, StringAuto& t
 {
 	// Load file
 	ResourceFilePtr file;
-	ANKI_CHECK(m_manager->getFilesystem().openFile(filename, file));
+	ANKI_CHECK(openFile(filename, file));
 
 	// Read string
 	text = StringAuto(getTempAllocator());
@@ -59,4 +61,26 @@ Error ResourceObject::openFileParseXml(const CString& filename, XmlDocument& xml
 	return Error::NONE;
 }
 
+U64 ResourceObject::computeCookedBinaryHash(CString sourceText, U64 parametersHash)
+{
+	const Array<U64, 2> hashes = {parametersHash, COOKED_RESOURCE_BINARY_VERSION};
+	U64 hash = computeHash(&hashes[0], hashes.getSizeInBytes());
+	if(!sourceText.isEmpty())
+	{
+		hash = appendHash(sourceText.cstr(), sourceText.getLength(), hash);
+	}
+
+	return hash;
+}
+
+void ResourceObject::getCookedBinaryFilename(const ResourceFilename& filename, StringAuto& binaryFilename) const
+{
+	// Use the hash of the whole filename because the base filename is not unique
+	StringAuto baseFilename(getTempAllocator());
+	getFilepathFilename(filename, baseFilename);
+	const U64 filenameHash = computeHash(filename.cstr(), filename.getLength());
+	binaryFilename.sprintf("%s/%016" PRIx64 "_%sbin", m_manager->getCacheDirectory().cstr(), filenameHash,
+						   baseFilename.cstr());
+}
+
 } // end namespace anki
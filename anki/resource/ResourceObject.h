@@ -9,6 +9,8 @@
 #include <anki/resource/ResourceFilesystem.h>
 #include <anki/util/Atomic.h>
 #include <anki/util/String.h>
+#include <anki/util/Serializer.h>
+#include <anki/util/Filesystem.h>
 
 namespace anki
 {
@@ -75,18 +77,110 @@ public:
 		return m_uuid;
 	}
 
+	/// The newer version of the resource if it was reloaded. See ResourceManager::refreshResource().
+	ANKI_INTERNAL ResourceObject* getReplacement() const
+	{
+		return m_replacement;
+	}
+
 	ANKI_INTERNAL ANKI_USE_RESULT Error openFile(const ResourceFilename& filename, ResourceFilePtr& file);
 
 	ANKI_INTERNAL ANKI_USE_RESULT Error openFileReadAllText(const ResourceFilename& filename, StringAuto& file);
 
 	ANKI_INTERNAL ANKI_USE_RESULT Error openFileParseXml(const ResourceFilename& filename, XmlDocument& xml);
 
+	/// Compute the hash that keys the cooked binary of a resource.
+	/// @param sourceText The text of the resource's file.
+	/// @param parametersHash The hash of anything else the cooked binary depends on.
+	ANKI_INTERNAL static U64 computeCookedBinaryHash(CString sourceText, U64 parametersHash = 0);
+
+	/// Load the cooked binary of a resource from the cache directory. The binary is a single allocation of the temp
+	/// allocator.
+	/// @param[out] binary It will be nullptr if there is no binary in the cache or if it's stale.
+	template<typename T>
+	ANKI_INTERNAL ANKI_USE_RESULT Error loadCookedBinary(const ResourceFilename& filename, const char* magic,
+														 U64 sourceHash, T*& binary);
+
+	/// Free a binary returned by loadCookedBinary.
+	template<typename T>
+	ANKI_INTERNAL void freeCookedBinary(T*& binary)
+	{
+		getTempAllocator().getMemoryPool().free(binary);
+		binary = nullptr;
+	}
+
+	/// Strings in the cooked binaries include the null terminator.
+	ANKI_INTERNAL static WeakArray<char> toCookedString(CString str)
+	{
+		return (str.isEmpty()) ? WeakArray<char>()
+							   : WeakArray<char>(const_cast<char*>(str.cstr()), U32(str.getLength() + 1));
+	}
+
+	ANKI_INTERNAL static CString fromCookedString(ConstWeakArray<char> str)
+	{
+		ANKI_ASSERT(str.getSize() == 0 || str[str.getSize() - 1] == '\0');
+		return (str.getSize()) ? CString(&str[0]) : CString();
+	}
+
+	/// Write the cooked binary of a resource to the cache directory. It's not an error if that fails, the resource
+	/// will be cooked again the next time.
+	template<typename T>
+	ANKI_INTERNAL void storeCookedBinary(const ResourceFilename& filename, const T& binary) const;
+
 private:
 	ResourceManager* m_manager;
 	Atomic<I32> m_refcount;
 	String m_fname; ///< Unique resource name.
 	U64 m_uuid = 0;
+	ResourceObject* m_replacement = nullptr; ///< It holds a reference.
+
+	void getCookedBinaryFilename(const ResourceFilename& filename, StringAuto& binaryFilename) const;
 };
+
+template<typename T>
+Error ResourceObject::loadCookedBinary(const ResourceFilename& filename, const char* magic, U64 sourceHash,
+									   T*& binary)
+{
+	binary = nullptr;
+
+	StringAuto binaryFilename(getTempAllocator());
+	getCookedBinaryFilename(filename, binaryFilename);
+	if(!fileExists(binaryFilename))
+	{
+		return Error::NONE;
+	}
+
+	File file;
+	ANKI_CHECK(file.open(binaryFilename, FileOpenFlag::READ | FileOpenFlag::BINARY));
+	if(BinaryDeserializer::deserialize(binary, getTempAllocator(), file))
+	{
+		ANKI_RESOURCE_LOGW("Ignoring the corrupted cooked binary of %s", filename.cstr());
+		binary = nullptr;
+		return Error::NONE;
+	}
+
+	if(memcmp(&binary->m_magic[0], magic, binary->m_magic.getSize()) != 0 || binary->m_sourceHash != sourceHash)
+	{
+		freeCookedBinary(binary);
+	}
+
+	return Error::NONE;
+}
+
+template<typename T>
+void ResourceObject::storeCookedBinary(const ResourceFilename& filename, const T& binary) const
+{
+	StringAuto binaryFilename(getTempAllocator());
+	getCookedBinaryFilename(filename, binaryFilename);
+
+	File file;
+	BinarySerializer serializer;
+	if(file.open(binaryFilename, FileOpenFlag::WRITE | FileOpenFlag::BINARY)
+	   || serializer.serialize(binary, getTempAllocator(), file))
+	{
+		ANKI_RESOURCE_LOGW("Failed to store the cooked binary of %s", filename.cstr());
+	}
+}
 /// @}
 
 } // end namespace anki
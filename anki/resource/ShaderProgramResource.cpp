@@ -6,6 +6,7 @@
 #include <anki/resource/ShaderProgramResource.h>
 #include <anki/resource/ResourceManager.h>
 #include <anki/resource/ShaderProgramResourceSystem.h>
+#include <anki/resource/AsyncLoader.h>
 #include <anki/gr/ShaderProgram.h>
 #include <anki/gr/GrManager.h>
 #include <anki/util/Filesystem.h>
@@ -22,6 +23,57 @@ ShaderProgramResourceVariant::~ShaderProgramResourceVariant()
 {
 }
 
+/// Compiles the variant that a fallback stands in for.
+class ShaderProgramResource::CompileVariantTask : public AsyncLoaderTask
+{
+public:
+	ShaderProgramResourcePtr m_program;
+	const ShaderProgramResourceVariant* m_fallback;
+
+	CompileVariantTask(const ShaderProgramResourcePtr& program, const ShaderProgramResourceVariant* fallback)
+		: m_program(program)
+		, m_fallback(fallback)
+	{
+	}
+
+	Error operator()(AsyncLoaderTaskContext& ctx) final
+	{
+		// Don't fail the loader, the fallback will stay if the compilation fails
+		m_program->compileMissingVariant(*m_fallback);
+		return Error::NONE;
+	}
+};
+
+/// Find an element of the reflection of a binary by its name. Returns MAX_U32 if it's not found.
+template<typename TArray>
+static U32 findReflectionByName(const TArray& arr, CString name)
+{
+	for(U32 i = 0; i < arr.getSize(); ++i)
+	{
+		if(CString(&arr[i].m_name[0]) == name)
+		{
+			return i;
+		}
+	}
+
+	return MAX_U32;
+}
+
+static Bool remapBlockInstance(const ShaderProgramBinaryBlock& programBlock, const ShaderProgramBinaryBlock& block,
+							   ShaderProgramBinaryBlockInstance& instance)
+{
+	for(ShaderProgramBinaryVariableInstance& var : instance.m_variables)
+	{
+		var.m_index = findReflectionByName(programBlock.m_variables, &block.m_variables[var.m_index].m_name[0]);
+		if(var.m_index == MAX_U32)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 ShaderProgramResource::ShaderProgramResource(ResourceManager* manager)
 	: ResourceObject(manager)
 	, m_binary(getAllocator())
@@ -42,9 +94,22 @@ ShaderProgramResource::~ShaderProgramResource()
 	for(auto it : m_variants)
 	{
 		ShaderProgramResourceVariant* variant = &(*it);
-		getAllocator().deleteInstance(variant);
+		deleteVariant(variant);
 	}
 	m_variants.destroy(getAllocator());
+
+	for(ShaderProgramResourceVariant* variant : m_retiredFallbacks)
+	{
+		deleteVariant(variant);
+	}
+	m_retiredFallbacks.destroy(getAllocator());
+}
+
+void ShaderProgramResource::deleteVariant(ShaderProgramResourceVariant* variant) const
+{
+	getAllocator().deleteInstance(variant->m_binary);
+	getAllocator().deleteInstance(variant->m_fallbackInfo);
+	getAllocator().deleteInstance(variant);
 }
 
 Error ShaderProgramResource::load(const ResourceFilename& filename, Bool async)
@@ -163,8 +228,51 @@ Error ShaderProgramResource::load(const ResourceFilename& filename, Bool async)
 		}
 	}
 
+	// The variants are found with a binary search
+	for(U32 i = 1; i < binary.m_mutations.getSize(); ++i)
+	{
+		if(binary.m_mutations[i - 1].m_hash > binary.m_mutations[i].m_hash)
+		{
+			ANKI_RESOURCE_LOGE("The mutations of the binary are not sorted: %s", binaryFilename.cstr());
+			return Error::USER_DATA;
+		}
+	}
+
 	m_shaderStages = binary.m_presentShaderTypes;
 
+	// Hash what the users of the program might cache. The code blocks imply the reflection but hash the names as well
+	// in case the IR is stripped
+	m_binaryHash = computeHash(&SHADER_BINARY_VERSION, sizeof(SHADER_BINARY_VERSION));
+	for(const ShaderProgramBinaryCodeBlock& block : binary.m_codeBlocks)
+	{
+		m_binaryHash = appendHash(&block.m_hash, sizeof(block.m_hash), m_binaryHash);
+	}
+
+	for(const ShaderProgramBinaryMutator& mutator : binary.m_mutators)
+	{
+		m_binaryHash = appendHash(&mutator.m_name[0], mutator.m_name.getSizeInBytes(), m_binaryHash);
+		m_binaryHash = appendHash(mutator.m_values.getBegin(), mutator.m_values.getSizeInBytes(), m_binaryHash);
+	}
+
+	for(const ShaderProgramBinaryBlock& block : binary.m_uniformBlocks)
+	{
+		m_binaryHash = appendHash(&block.m_name[0], block.m_name.getSizeInBytes(), m_binaryHash);
+		for(const ShaderProgramBinaryVariable& var : block.m_variables)
+		{
+			m_binaryHash = appendHash(&var.m_name[0], var.m_name.getSizeInBytes(), m_binaryHash);
+		}
+	}
+
+	for(const ShaderProgramBinaryOpaque& o : binary.m_opaques)
+	{
+		m_binaryHash = appendHash(&o.m_name[0], o.m_name.getSizeInBytes(), m_binaryHash);
+	}
+
+	for(const ShaderProgramBinaryConstant& c : binary.m_constants)
+	{
+		m_binaryHash = appendHash(&c.m_name[0], c.m_name.getSizeInBytes(), m_binaryHash);
+	}
+
 	// Do some RT checks
 	if(!!(m_shaderStages & ShaderTypeBit::ALL_RAY_TRACING))
 	{
@@ -207,7 +315,7 @@ Error ShaderProgramResource::parseConst(CString constName, U32& componentIdx, U3
 }
 
 void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
-											   const ShaderProgramResourceVariant*& variant) const
+											   const ShaderProgramResourceVariant*& variant, Bool acceptFallback) const
 {
 	// Sanity checks
 	ANKI_ASSERT(info.m_setMutators.getEnabledBitCount() == m_mutators.getSize());
@@ -226,6 +334,11 @@ void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVarian
 			appendHash(info.m_constantValues.getBegin(), m_consts.getSize() * sizeof(info.m_constantValues[0]), hash);
 	}
 
+	// A fallback without a program had no compatible variant in the binary so it can't stand in
+	auto usable = [acceptFallback](const ShaderProgramResourceVariant& v) {
+		return !v.isFallback() || (acceptFallback && v.m_prog.isCreated());
+	};
+
 	// Check if the variant is in the cache
 	{
 		RLockGuard<RWMutex> lock(m_mtx);
@@ -233,68 +346,299 @@ void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVarian
 		auto it = m_variants.find(hash);
 		variant = (it != m_variants.getEnd()) ? *it : nullptr;
 
-		if(variant != nullptr)
+		if(variant != nullptr && usable(*variant))
 		{
 			// Done
 			return;
 		}
 	}
 
-	// Create the variant
-	WLockGuard<RWMutex> lock(m_mtx);
+	if(variant == nullptr)
+	{
+		// Create the variant
+		WLockGuard<RWMutex> lock(m_mtx);
+
+		// Check again
+		auto it = m_variants.find(hash);
+		variant = (it != m_variants.getEnd()) ? *it : nullptr;
+		if(variant == nullptr)
+		{
+			// Create
+			ShaderProgramResourceVariant* v = getAllocator().newInstance<ShaderProgramResourceVariant>();
+			const ShaderProgramBinaryVariant* binaryVariant = tryFindBinaryVariant(info);
+			if(binaryVariant)
+			{
+				initVariant(info, m_binary.getBinary().m_codeBlocks, *binaryVariant, *v);
+			}
+			else
+			{
+				// Not in the binary, create a fallback from a similar variant. If there is none the variant is compiled
+				// below
+				const ShaderProgramBinaryVariant* fallbackBinaryVariant = findFallbackBinaryVariant(info);
+				if(fallbackBinaryVariant)
+				{
+					initVariant(info, m_binary.getBinary().m_codeBlocks, *fallbackBinaryVariant, *v);
+				}
+
+				// Copy the info without the pointer to the program, the program would never get deleted
+				v->m_fallbackInfo = getAllocator().newInstance<ShaderProgramResourceVariantInitInfo>();
+				memcpy(&v->m_fallbackInfo->m_constantValues, &info.m_constantValues, sizeof(info.m_constantValues));
+				v->m_fallbackInfo->m_setConstants = info.m_setConstants;
+				v->m_fallbackInfo->m_mutation = info.m_mutation;
+				v->m_fallbackInfo->m_setMutators = info.m_setMutators;
+				v->m_hash = hash;
 
-	// Check again
-	auto it = m_variants.find(hash);
-	variant = (it != m_variants.getEnd()) ? *it : nullptr;
-	if(variant != nullptr)
+				if(acceptFallback && fallbackBinaryVariant)
+				{
+					getManager().getAsyncLoader().submitNewTask<CompileVariantTask>(
+						ShaderProgramResourcePtr(const_cast<ShaderProgramResource*>(this)), v);
+				}
+			}
+
+			m_variants.emplace(getAllocator(), hash, v);
+			variant = v;
+
+			if(m_mutators.getSize())
+			{
+				getManager().getShaderProgramResourceSystem().recordVariant(
+					getFilename(), ConstWeakArray<MutatorValue>(info.m_mutation.getBegin(), m_mutators.getSize()));
+			}
+		}
+
+		if(usable(*variant))
+		{
+			// Done
+			return;
+		}
+	}
+
+	// The caller can't use the fallback, compile the variant now
+	variant = compileMissingVariant(*variant);
+}
+
+const ShaderProgramBinaryVariant*
+ShaderProgramResource::tryFindBinaryVariant(const ShaderProgramResourceVariantInitInfo& info) const
+{
+	const ShaderProgramBinary& binary = m_binary.getBinary();
+
+	if(m_mutators.getSize() == 0)
 	{
-		// Done
-		return;
+		ANKI_ASSERT(binary.m_variants.getSize() == 1);
+		return &binary.m_variants[0];
 	}
 
-	// Create
-	ShaderProgramResourceVariant* v = getAllocator().newInstance<ShaderProgramResourceVariant>();
-	initVariant(info, *v);
-	m_variants.emplace(getAllocator(), hash, v);
-	variant = v;
+	// Search for the mutation in the binary. The mutations are sorted by their hash
+	class Compare
+	{
+	public:
+		Bool operator()(const ShaderProgramBinaryMutation& a, U64 b) const
+		{
+			return a.m_hash < b;
+		}
+
+		Bool operator()(U64 a, const ShaderProgramBinaryMutation& b) const
+		{
+			return a < b.m_hash;
+		}
+	};
+
+	const U64 mutationHash =
+		computeHash(info.m_mutation.getBegin(), m_mutators.getSize() * sizeof(info.m_mutation[0]));
+	const ShaderProgramBinaryMutation* mutation =
+		binarySearch(binary.m_mutations.getBegin(), binary.m_mutations.getEnd(), mutationHash, Compare());
+	ANKI_ASSERT(mutation != binary.m_mutations.getEnd() && "Mutation not found");
+
+	return (mutation->m_variantIndex != MAX_U32) ? &binary.m_variants[mutation->m_variantIndex] : nullptr;
 }
 
-void ShaderProgramResource::initVariant(const ShaderProgramResourceVariantInitInfo& info,
-										ShaderProgramResourceVariant& variant) const
+const ShaderProgramBinaryVariant*
+ShaderProgramResource::findFallbackBinaryVariant(const ShaderProgramResourceVariantInitInfo& info) const
 {
 	const ShaderProgramBinary& binary = m_binary.getBinary();
 
-	// Get the binary program variant
-	const ShaderProgramBinaryVariant* binaryVariant = nullptr;
-	U64 mutationHash = 0;
-	if(m_mutators.getSize())
+	const ShaderProgramBinaryMutation* bestMutation = nullptr;
+	U32 bestCommonValueCount = 0;
+	for(const ShaderProgramBinaryMutation& mutation : binary.m_mutations)
 	{
-		// Create the mutation hash
-		mutationHash = computeHash(info.m_mutation.getBegin(), m_mutators.getSize() * sizeof(info.m_mutation[0]));
+		if(mutation.m_variantIndex == MAX_U32)
+		{
+			continue;
+		}
 
-		// Search for the mutation in the binary
-		// TODO optimize the search
-		for(const ShaderProgramBinaryMutation& mutation : binary.m_mutations)
+		// The builtin mutators change the vertex inputs and the attachments so they have to match
+		U32 commonValueCount = 0;
+		Bool builtinsMatch = true;
+		for(U32 i = 0; i < m_mutators.getSize() && builtinsMatch; ++i)
 		{
-			if(mutation.m_hash == mutationHash)
-			{
-				binaryVariant = &binary.m_variants[mutation.m_variantIndex];
-				break;
-			}
+			const Bool same = mutation.m_values[i] == info.m_mutation[i];
+			commonValueCount += same;
+			builtinsMatch = same || m_mutators[i].m_name.find("ANKI_") != 0;
+		}
+
+		if(builtinsMatch && (bestMutation == nullptr || commonValueCount > bestCommonValueCount))
+		{
+			bestMutation = &mutation;
+			bestCommonValueCount = commonValueCount;
+		}
+	}
+
+	return (bestMutation) ? &binary.m_variants[bestMutation->m_variantIndex] : nullptr;
+}
+
+const ShaderProgramResourceVariant*
+ShaderProgramResource::compileMissingVariant(const ShaderProgramResourceVariant& fallback) const
+{
+	ANKI_ASSERT(fallback.isFallback());
+	const ShaderProgramResourceVariantInitInfo& info = *fallback.m_fallbackInfo;
+
+	// Someone might have compiled it already
+	{
+		RLockGuard<RWMutex> lock(m_mtx);
+		auto it = m_variants.find(fallback.m_hash);
+		ANKI_ASSERT(it != m_variants.getEnd());
+		if(*it != &fallback)
+		{
+			return *it;
 		}
 	}
+
+	// Compile
+	ShaderProgramBinaryWrapper* binary = getAllocator().newInstance<ShaderProgramBinaryWrapper>(getAllocator());
+	const ConstWeakArray<MutatorValue> mutation(info.m_mutation.getBegin(), m_mutators.getSize());
+	Error err = getManager().getShaderProgramResourceSystem().compileVariant(getFilename(), mutation, *binary);
+
+	// The binary was created here and no one else sees it, it's fine to modify it
+	if(!err && !remapBinary(m_binary.getBinary(), const_cast<ShaderProgramBinary&>(binary->getBinary())))
+	{
+		ANKI_RESOURCE_LOGE("The interface of the variant is not part of the binary. Add the variant to the manifest");
+		err = Error::USER_DATA;
+	}
+
+	ShaderProgramResourceVariant* variant = getAllocator().newInstance<ShaderProgramResourceVariant>();
+	if(!err)
+	{
+		ANKI_ASSERT(binary->getBinary().m_variants.getSize() == 1);
+		initVariant(info, binary->getBinary().m_codeBlocks, binary->getBinary().m_variants[0], *variant);
+		variant->m_binary = binary;
+	}
 	else
 	{
-		ANKI_ASSERT(binary.m_variants.getSize() == 1);
-		binaryVariant = &binary.m_variants[0];
+		if(!fallback.m_prog.isCreated())
+		{
+			ANKI_RESOURCE_LOGF("Failed to compile a variant of %s and there is no fallback", getFilename().cstr());
+		}
+
+		ANKI_RESOURCE_LOGE("Failed to compile a variant of %s. Will keep using a fallback", getFilename().cstr());
+		getAllocator().deleteInstance(binary);
+
+		// Don't try again, make the fallback permanent
+		variant->m_prog = fallback.m_prog;
+		variant->m_binaryVariant = fallback.m_binaryVariant;
+		variant->m_activeConsts = fallback.m_activeConsts;
+		variant->m_workgroupSizes = fallback.m_workgroupSizes;
+		variant->m_hitShaderGroupHandleIndex = fallback.m_hitShaderGroupHandleIndex;
 	}
-	ANKI_ASSERT(binaryVariant);
-	variant.m_binaryVariant = binaryVariant;
+
+	// Replace the fallback
+	WLockGuard<RWMutex> lock(m_mtx);
+	auto it = m_variants.find(fallback.m_hash);
+	if(*it != &fallback)
+	{
+		// Someone was faster
+		deleteVariant(variant);
+		return *it;
+	}
+
+	*it = variant;
+	m_retiredFallbacks.emplaceBack(getAllocator(), const_cast<ShaderProgramResourceVariant*>(&fallback));
+	return variant;
+}
+
+Bool ShaderProgramResource::remapBinary(const ShaderProgramBinary& programBinary, ShaderProgramBinary& binary)
+{
+	for(ShaderProgramBinaryVariant& variant : binary.m_variants)
+	{
+		for(ShaderProgramBinaryBlockInstance& instance : variant.m_uniformBlocks)
+		{
+			const ShaderProgramBinaryBlock& block = binary.m_uniformBlocks[instance.m_index];
+			instance.m_index = findReflectionByName(programBinary.m_uniformBlocks, &block.m_name[0]);
+			if(instance.m_index == MAX_U32
+			   || !remapBlockInstance(programBinary.m_uniformBlocks[instance.m_index], block, instance))
+			{
+				return false;
+			}
+		}
+
+		for(ShaderProgramBinaryBlockInstance& instance : variant.m_storageBlocks)
+		{
+			const ShaderProgramBinaryBlock& block = binary.m_storageBlocks[instance.m_index];
+			instance.m_index = findReflectionByName(programBinary.m_storageBlocks, &block.m_name[0]);
+			if(instance.m_index == MAX_U32
+			   || !remapBlockInstance(programBinary.m_storageBlocks[instance.m_index], block, instance))
+			{
+				return false;
+			}
+		}
+
+		if(variant.m_pushConstantBlock)
+		{
+			ANKI_ASSERT(binary.m_pushConstantBlock);
+			if(programBinary.m_pushConstantBlock == nullptr
+			   || !remapBlockInstance(*programBinary.m_pushConstantBlock, *binary.m_pushConstantBlock,
+									  *variant.m_pushConstantBlock))
+			{
+				return false;
+			}
+		}
+
+		for(ShaderProgramBinaryOpaqueInstance& instance : variant.m_opaques)
+		{
+			instance.m_index =
+				findReflectionByName(programBinary.m_opaques, &binary.m_opaques[instance.m_index].m_name[0]);
+			if(instance.m_index == MAX_U32)
+			{
+				return false;
+			}
+		}
+
+		for(ShaderProgramBinaryConstantInstance& instance : variant.m_constants)
+		{
+			instance.m_index =
+				findReflectionByName(programBinary.m_constants, &binary.m_constants[instance.m_index].m_name[0]);
+			if(instance.m_index == MAX_U32)
+			{
+				return false;
+			}
+		}
+
+		for(U32& idx : variant.m_workgroupSizesConstants)
+		{
+			if(idx != MAX_U32)
+			{
+				idx = findReflectionByName(programBinary.m_constants, &binary.m_constants[idx].m_name[0]);
+				if(idx == MAX_U32)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void ShaderProgramResource::initVariant(const ShaderProgramResourceVariantInitInfo& info,
+										ConstWeakArray<ShaderProgramBinaryCodeBlock> codeBlocks,
+										const ShaderProgramBinaryVariant& binaryVariant,
+										ShaderProgramResourceVariant& variant) const
+{
+	const ShaderProgramBinary& binary = m_binary.getBinary();
+	variant.m_binaryVariant = &binaryVariant;
 
 	// Set the constant values
 	Array<ShaderSpecializationConstValue, 64> constValues;
 	U32 constValueCount = 0;
-	for(const ShaderProgramBinaryConstantInstance& instance : binaryVariant->m_constants)
+	for(const ShaderProgramBinaryConstantInstance& instance : binaryVariant.m_constants)
 	{
 		const ShaderProgramBinaryConstant& c = binary.m_constants[instance.m_index];
 		const U32 inputIdx = m_constBinaryMapping[instance.m_index].m_constsIdx;
@@ -323,18 +667,18 @@ void ShaderProgramResource::initVariant(const ShaderProgramResourceVariantInitIn
 	{
 		for(U32 i = 0; i < 3; ++i)
 		{
-			if(binaryVariant->m_workgroupSizes[i] != MAX_U32)
+			if(binaryVariant.m_workgroupSizes[i] != MAX_U32)
 			{
 				// Size didn't come from specialization const
-				variant.m_workgroupSizes[i] = binaryVariant->m_workgroupSizes[i];
+				variant.m_workgroupSizes[i] = binaryVariant.m_workgroupSizes[i];
 			}
 			else
 			{
 				// Size is specialization const
 
-				ANKI_ASSERT(binaryVariant->m_workgroupSizesConstants[i] != MAX_U32);
+				ANKI_ASSERT(binaryVariant.m_workgroupSizesConstants[i] != MAX_U32);
 
-				const U32 binaryConstIdx = binaryVariant->m_workgroupSizesConstants[i];
+				const U32 binaryConstIdx = binaryVariant.m_workgroupSizesConstants[i];
 				const U32 constIdx = m_constBinaryMapping[binaryConstIdx].m_constsIdx;
 				const U32 component = m_constBinaryMapping[binaryConstIdx].m_component;
 				const Const& c = m_consts[constIdx];
@@ -381,9 +725,17 @@ void ShaderProgramResource::initVariant(const ShaderProgramResourceVariantInitIn
 				continue;
 			}
 
+			// The code blocks might be compressed. Decompress only the ones the variant needs
+			DynamicArrayAuto<U8> spirvStorage(getTempAllocator());
+			ConstWeakArray<U8> spirv;
+			if(getCodeBlockSpirv(codeBlocks[binaryVariant.m_codeBlockIndices[shaderType]], spirvStorage, spirv))
+			{
+				ANKI_RESOURCE_LOGF("Corrupted shader binary of %s. Clean the shader cache", getFilename().cstr());
+			}
+
 			ShaderInitInfo inf(cprogName);
 			inf.m_shaderType = shaderType;
-			inf.m_binary = binary.m_codeBlocks[binaryVariant->m_codeBlockIndices[shaderType]].m_binary;
+			inf.m_binary = spirv;
 			inf.m_constValues.setArray((constValueCount) ? constValues.getBegin() : nullptr, constValueCount);
 			ShaderPtr shader = getManager().getGrManager().newShader(inf);
 
@@ -440,6 +792,10 @@ void ShaderProgramResource::initVariant(const ShaderProgramResourceVariantInitIn
 		else
 		{
 			ANKI_ASSERT(!!(m_shaderStages & (ShaderTypeBit::ANY_HIT | ShaderTypeBit::CLOSEST_HIT)));
+			const U64 mutationHash =
+				(m_mutators.getSize())
+					? computeHash(info.m_mutation.getBegin(), m_mutators.getSize() * sizeof(info.m_mutation[0]))
+					: 0;
 			variant.m_hitShaderGroupHandleIndex = foundLib->getHitShaderGroupHandleIndex(getFilename(), mutationHash);
 		}
 	}
@@ -97,12 +97,23 @@ public:
 		return m_hitShaderGroupHandleIndex;
 	}
 
+	/// A fallback is a similar variant that stands in for a variant that is not compiled yet.
+	/// @see ShaderProgramResource::getOrCreateVariant
+	Bool isFallback() const
+	{
+		return m_fallbackInfo != nullptr;
+	}
+
 private:
 	ShaderProgramPtr m_prog;
 	const ShaderProgramBinaryVariant* m_binaryVariant = nullptr;
 	BitSet<128, U64> m_activeConsts = {false};
 	Array<U32, 3> m_workgroupSizes;
 	U32 m_hitShaderGroupHandleIndex = MAX_U32; ///< Cache the index of the handle here.
+
+	ShaderProgramBinaryWrapper* m_binary = nullptr; ///< The binary of a variant that was compiled on demand.
+	ShaderProgramResourceVariantInitInfo* m_fallbackInfo = nullptr; ///< What the fallback stands in for.
+	U64 m_hash = 0; ///< The hash of the variant that the fallback stands in for.
 };
 
 /// The value of a constant.
@@ -233,10 +244,22 @@ public:
 		return m_binary.getBinary();
 	}
 
-	/// Get or create a graphics shader program variant.
+	/// A hash of the binary. It changes when the program or its interface changes.
+	U64 getBinaryHash() const
+	{
+		ANKI_ASSERT(m_binaryHash != 0);
+		return m_binaryHash;
+	}
+
+	/// Get or create a graphics shader program variant. If the variant was left out of the binary (see
+	/// ShaderProgramVariantManifest) it will be compiled.
+	/// @param acceptFallback If true and the variant is not in the binary it will be compiled in the background and a
+	///                       fallback will be returned until it's ready. Call this method again to get the actual
+	///                       variant. If false or if no variant of the binary has the same builtin mutator values the
+	///                       variant will be compiled by the caller.
 	/// @note It's thread-safe.
 	void getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
-							const ShaderProgramResourceVariant*& variant) const;
+							const ShaderProgramResourceVariant*& variant, Bool acceptFallback = false) const;
 
 	/// @copydoc getOrCreateVariant
 	void getOrCreateVariant(const ShaderProgramResourceVariant*& variant) const
@@ -248,6 +271,8 @@ private:
 	using Mutator = ShaderProgramResourceMutator;
 	using Const = ShaderProgramResourceConstant;
 
+	class CompileVariantTask;
+
 	ShaderProgramBinaryWrapper m_binary;
 
 	DynamicArray<Const> m_consts;
@@ -263,11 +288,32 @@ private:
 	DynamicArray<ConstMapping> m_constBinaryMapping;
 
 	mutable HashMap<U64, ShaderProgramResourceVariant*> m_variants;
+	mutable DynamicArray<ShaderProgramResourceVariant*> m_retiredFallbacks; ///< Someone might still use them.
 	mutable RWMutex m_mtx;
 
 	ShaderTypeBit m_shaderStages = ShaderTypeBit::NONE;
 
-	void initVariant(const ShaderProgramResourceVariantInitInfo& info, ShaderProgramResourceVariant& variant) const;
+	U64 m_binaryHash = 0;
+
+	void initVariant(const ShaderProgramResourceVariantInitInfo& info,
+					 ConstWeakArray<ShaderProgramBinaryCodeBlock> codeBlocks,
+					 const ShaderProgramBinaryVariant& binaryVariant, ShaderProgramResourceVariant& variant) const;
+
+	/// Return nullptr if the variant was left out of the binary.
+	const ShaderProgramBinaryVariant* tryFindBinaryVariant(const ShaderProgramResourceVariantInitInfo& info) const;
+
+	/// Find the variant in the binary that has the most mutator values in common with the given mutation. The values of
+	/// the builtin mutators (the ANKI_ ones) have to be the same.
+	/// @return nullptr if no variant has the same builtin mutator values.
+	const ShaderProgramBinaryVariant* findFallbackBinaryVariant(const ShaderProgramResourceVariantInitInfo& info) const;
+
+	/// Compile the variant that a fallback stands in for and replace the fallback with it.
+	const ShaderProgramResourceVariant* compileMissingVariant(const ShaderProgramResourceVariant& fallback) const;
+
+	/// Make the indices of the reflection of a binary point to the reflection of the binary of the program.
+	static Bool remapBinary(const ShaderProgramBinary& programBinary, ShaderProgramBinary& binary);
+
+	void deleteVariant(ShaderProgramResourceVariant* variant) const;
 
 	static ANKI_USE_RESULT Error parseConst(CString constName, U32& componentIdx, U32& componentCount, CString& name);
 };
@@ -8,6 +8,7 @@
 #include <anki/util/Tracer.h>
 #include <anki/gr/GrManager.h>
 #include <anki/shader_compiler/ShaderProgramCompiler.h>
+#include <anki/shader_compiler/ShaderProgramSpirvCache.h>
 #include <anki/util/Filesystem.h>
 #include <anki/util/ThreadHive.h>
 #include <anki/util/System.h>
@@ -15,9 +16,163 @@
 namespace anki
 {
 
+ShaderProgramVariantManifest::~ShaderProgramVariantManifest()
+{
+	for(String& line : m_lines)
+	{
+		line.destroy(m_alloc);
+	}
+
+	m_lines.destroy(m_alloc);
+	m_programHashes.destroy(m_alloc);
+}
+
+void ShaderProgramVariantManifest::generateLine(CString programFilename, ConstWeakArray<MutatorValue> mutation,
+												 StringAuto& line)
+{
+	StringListAuto tokens(line.getAllocator());
+	tokens.pushBack(programFilename);
+	for(MutatorValue value : mutation)
+	{
+		tokens.pushBackSprintf("%d", value);
+	}
+
+	tokens.join(" ", line);
+}
+
+void ShaderProgramVariantManifest::addVariantInternal(CString programFilename, ConstWeakArray<MutatorValue> mutation)
+{
+	StringAuto line(m_alloc);
+	generateLine(programFilename, mutation, line);
+	const U64 lineHash = computeHash(line.cstr(), line.getLength());
+
+	if(m_lines.find(lineHash) != m_lines.getEnd())
+	{
+		return;
+	}
+
+	String str;
+	str.create(m_alloc, line.toCString());
+	m_lines.emplace(m_alloc, lineHash, std::move(str));
+
+	// The variants of a program are unordered so combine their hashes with an addition
+	const U64 programHash = computeHash(programFilename.cstr(), programFilename.getLength());
+	auto it = m_programHashes.find(programHash);
+	if(it != m_programHashes.getEnd())
+	{
+		*it += lineHash;
+	}
+	else
+	{
+		m_programHashes.emplace(m_alloc, programHash, lineHash);
+	}
+}
+
+Error ShaderProgramVariantManifest::load(CString filename)
+{
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+	StringAuto txt(m_alloc);
+	ANKI_CHECK(file.readAllText(txt));
+
+	StringListAuto lines(m_alloc);
+	lines.splitString(txt.toCString(), '\n');
+
+	LockGuard<Mutex> lock(m_mtx);
+	for(const String& line : lines)
+	{
+		StringListAuto tokens(m_alloc);
+		tokens.splitString(line.toCString(), ' ');
+		if(tokens.isEmpty())
+		{
+			continue;
+		}
+
+		DynamicArrayAuto<MutatorValue> mutation(m_alloc);
+		auto it = tokens.getBegin();
+		const CString programFilename = it->toCString();
+		for(++it; it != tokens.getEnd(); ++it)
+		{
+			I32 value;
+			if(it->toNumber(value))
+			{
+				ANKI_RESOURCE_LOGE("Wrong line in the shader variant manifest %s: %s", filename.cstr(), line.cstr());
+				return Error::USER_DATA;
+			}
+
+			mutation.emplaceBack(value);
+		}
+
+		addVariantInternal(programFilename, mutation);
+	}
+
+	return Error::NONE;
+}
+
+Error ShaderProgramVariantManifest::store(CString filename) const
+{
+	StringListAuto lines(m_alloc);
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		for(const String& line : m_lines)
+		{
+			lines.pushBack(line.toCString());
+		}
+	}
+
+	// Sort to keep the diffs of the file small
+	lines.sortAll();
+
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::WRITE));
+	for(const String& line : lines)
+	{
+		ANKI_CHECK(file.writeText("%s\n", line.cstr()));
+	}
+
+	return Error::NONE;
+}
+
+void ShaderProgramVariantManifest::addVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	const U32 lineCount = U32(m_lines.getSize());
+	addVariantInternal(programFilename, mutation);
+	m_dirty = m_dirty || lineCount != m_lines.getSize();
+}
+
+Bool ShaderProgramVariantManifest::hasVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation) const
+{
+	StringAuto line(m_alloc);
+	generateLine(programFilename, mutation, line);
+	const U64 lineHash = computeHash(line.cstr(), line.getLength());
+
+	LockGuard<Mutex> lock(m_mtx);
+	return m_lines.find(lineHash) != m_lines.getEnd();
+}
+
+U64 ShaderProgramVariantManifest::getProgramHash(CString programFilename) const
+{
+	const U64 programHash = computeHash(programFilename.cstr(), programFilename.getLength());
+
+	LockGuard<Mutex> lock(m_mtx);
+	auto it = m_programHashes.find(programHash);
+	return (it != m_programHashes.getEnd()) ? *it : 0;
+}
+
 ShaderProgramResourceSystem::~ShaderProgramResourceSystem()
 {
+	if(m_recordManifest && m_manifest.isDirty())
+	{
+		ANKI_RESOURCE_LOGI("Storing the shader variant manifest: %s", m_manifestFilename.cstr());
+		if(m_manifest.store(m_manifestFilename))
+		{
+			ANKI_RESOURCE_LOGE("Failed to store the shader variant manifest");
+		}
+	}
+
 	m_cacheDir.destroy(m_alloc);
+	m_manifestFilename.destroy(m_alloc);
 
 	for(ShaderProgramRaytracingLibrary& lib : m_rtLibraries)
 	{
@@ -28,12 +183,34 @@ ShaderProgramResourceSystem::~ShaderProgramResourceSystem()
 	m_rtLibraries.destroy(m_alloc);
 }
 
-Error ShaderProgramResourceSystem::init()
+Error ShaderProgramResourceSystem::init(CString variantManifestFilename, Bool recordVariantManifest,
+										ShaderProgramPostCompileFlag postCompileFlags)
 {
 	ANKI_TRACE_SCOPED_EVENT(COMPILE_SHADERS);
 
+	m_postCompileFlags = postCompileFlags;
+
+	// Load the manifest. Without one compile all variants in advance, it's the first time the game runs
+	if(!variantManifestFilename.isEmpty())
+	{
+		m_manifestFilename.create(m_alloc, variantManifestFilename);
+		m_recordManifest = recordVariantManifest;
+
+		if(fileExists(variantManifestFilename))
+		{
+			ANKI_CHECK(m_manifest.load(variantManifestFilename));
+			m_lazyVariants = true;
+		}
+		else if(!m_recordManifest)
+		{
+			ANKI_RESOURCE_LOGW("Shader variant manifest not found, will compile all variants: %s",
+							   variantManifestFilename.cstr());
+		}
+	}
+
 	StringListAuto rtProgramFilenames(m_alloc);
-	ANKI_CHECK(compileAllShaders(m_cacheDir, *m_gr, *m_fs, m_alloc, rtProgramFilenames));
+	ANKI_CHECK(compileAllShaders(m_cacheDir, *m_gr, *m_fs, (m_lazyVariants) ? &m_manifest : nullptr, m_postCompileFlags,
+								 m_includeCache, m_alloc, rtProgramFilenames));
 
 	if(m_gr->getDeviceCapabilities().m_rayTracingEnabled)
 	{
@@ -43,9 +220,140 @@ Error ShaderProgramResourceSystem::init()
 	return Error::NONE;
 }
 
-Error ShaderProgramResourceSystem::compileAllShaders(CString cacheDir, GrManager& gr, ResourceFilesystem& fs,
-													 GenericMemoryPoolAllocator<U8>& alloc,
-													 StringListAuto& rtProgramFilenames)
+/// Feeds the variant tasks of a single program to the ThreadHive that is shared by all programs. The thread that joins
+/// the tasks also runs the ones that no hive thread picked yet, this way a program task never blocks waiting for tasks
+/// that are queued behind it.
+class ShaderProgramTaskManager final : public ShaderProgramAsyncTaskInterface
+{
+public:
+	ShaderProgramTaskManager(ThreadHive* hive, GenericMemoryPoolAllocator<U8> alloc)
+		: m_hive(hive)
+		, m_tasks(alloc)
+	{
+	}
+
+	void enqueueTask(void (*callback)(void* userData), void* userData) final
+	{
+		{
+			LockGuard<Mutex> lock(m_mtx);
+			Task& task = *m_tasks.emplaceBack();
+			task.m_callback = callback;
+			task.m_userData = userData;
+		}
+
+		m_hive->submitTask(
+			[](void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore) {
+				static_cast<ShaderProgramTaskManager*>(userData)->runOneTask();
+			},
+			this);
+	}
+
+	Error joinTasks() final
+	{
+		while(runOneTask())
+		{
+		}
+
+		LockGuard<Mutex> lock(m_mtx);
+		while(m_completedTaskCount < m_tasks.getSize())
+		{
+			m_cvar.wait(m_mtx);
+		}
+
+		return Error::NONE;
+	}
+
+private:
+	class Task
+	{
+	public:
+		void (*m_callback)(void* userData);
+		void* m_userData;
+	};
+
+	ThreadHive* m_hive;
+	Mutex m_mtx;
+	ConditionVariable m_cvar;
+	DynamicArrayAuto<Task> m_tasks;
+	U32 m_nextTask = 0;
+	U32 m_completedTaskCount = 0;
+
+	/// Run the next pending task. Returns false if there is none.
+	Bool runOneTask()
+	{
+		Task task;
+		{
+			LockGuard<Mutex> lock(m_mtx);
+			if(m_nextTask == m_tasks.getSize())
+			{
+				return false;
+			}
+
+			task = m_tasks[m_nextTask++];
+		}
+
+		task.m_callback(task.m_userData);
+
+		LockGuard<Mutex> lock(m_mtx);
+		++m_completedTaskCount;
+		if(m_completedTaskCount == m_tasks.getSize())
+		{
+			m_cvar.notifyAll();
+		}
+
+		return true;
+	}
+};
+
+/// Load the source of the programs from the ResourceFilesystem.
+class ShaderProgramFilesystem : public ShaderProgramFilesystemInterface
+{
+public:
+	ResourceFilesystem* m_fsystem = nullptr;
+
+	Error readAllText(CString filename, StringAuto& txt) final
+	{
+		ResourceFilePtr file;
+		ANKI_CHECK(m_fsystem->openFile(filename, file));
+		ANKI_CHECK(file->readAllText(txt));
+		return Error::NONE;
+	}
+};
+
+/// The state of a single program while compileAllShaders() is running.
+class ShaderProgramCompileContext
+{
+public:
+	CString m_cacheDir;
+	GpuDeviceCapabilities m_caps;
+	BindlessLimits m_limits;
+	U64 m_gpuHash = 0;
+	ResourceFilesystem* m_fs = nullptr;
+	ShaderProgramSpirvCacheInterface* m_spirvCache = nullptr;
+	ShaderProgramIncludeCache* m_includeCache = nullptr;
+	const ShaderProgramVariantManifest* m_manifest = nullptr;
+	ShaderProgramPostCompileFlag m_postCompileFlags = ShaderProgramPostCompileFlag::NONE;
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	Atomic<U32>* m_processedProgramCount = nullptr;
+	U32 m_programCount = 0;
+
+	CString m_fname;
+	ShaderProgramTaskManager m_taskManager;
+	Error m_err = Error::NONE;
+	Bool m_compiled = false;
+	Bool m_rayTracing = false;
+	PtrSize m_codeSize = 0; ///< The size of the code blocks before the post-compile stages.
+	PtrSize m_finalCodeSize = 0; ///< The size of the code blocks that got stored.
+
+	ShaderProgramCompileContext(ThreadHive* hive, GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+		, m_taskManager(hive, alloc)
+	{
+	}
+};
+
+/// Parse, compile and store a single program. It runs in a ThreadHive task and its variants are more tasks.
+static Error compileShaderProgramTask(ShaderProgramCompileContext& ctx)
 {
 	class MetaFileData
 	{
@@ -55,18 +363,143 @@ Error ShaderProgramResourceSystem::compileAllShaders(CString cacheDir, GrManager
 		Array<U16, 3> m_padding = {};
 	};
 
-	ANKI_RESOURCE_LOGI("Compiling shader programs");
-	U32 shadersCompileCount = 0;
+	GenericMemoryPoolAllocator<U8> alloc = ctx.m_alloc;
 
-	ThreadHive threadHive(getCpuCoresCount(), alloc, false);
+	// Get some filenames
+	StringAuto baseFname(alloc);
+	getFilepathFilename(ctx.m_fname, baseFname);
+	StringAuto metaFname(alloc);
+	metaFname.sprintf("%s/%smeta", ctx.m_cacheDir.cstr(), baseFname.cstr());
+
+	// Get the hash from the meta file
+	U64 metafileHash = 0;
+	ShaderTypeBit metafileShaderTypes = ShaderTypeBit::NONE;
+	if(fileExists(metaFname))
+	{
+		File metaFile;
+		ANKI_CHECK(metaFile.open(metaFname, FileOpenFlag::READ | FileOpenFlag::BINARY));
+		MetaFileData data;
+		ANKI_CHECK(metaFile.read(&data, sizeof(data)));
+
+		if(data.m_hash == 0 || data.m_shaderTypes == ShaderTypeBit::NONE)
+		{
+			ANKI_RESOURCE_LOGE("Wrong data found in the metafile: %s", metaFname.cstr());
+			return Error::USER_DATA;
+		}
+
+		metafileHash = data.m_hash;
+		metafileShaderTypes = data.m_shaderTypes;
+	}
+
+	// Load interface
+	ShaderProgramFilesystem fsystem;
+	fsystem.m_fsystem = ctx.m_fs;
+
+	// Skip interface
+	class Skip : public ShaderProgramPostParseInterface
+	{
+	public:
+		U64 m_metafileHash;
+		U64 m_newHash;
+		U64 m_gpuHash;
+		U64 m_manifestHash;
+		CString m_fname;
+		const ShaderProgramVariantManifest* m_manifest;
+
+		Bool skipCompilation(U64 hash)
+		{
+			ANKI_ASSERT(hash != 0);
+			const Array<U64, 3> hashes = {hash, m_gpuHash, m_manifestHash};
+			const U64 finalHash = computeHash(hashes.getBegin(), hashes.getSizeInBytes());
+
+			m_newHash = finalHash;
+			return finalHash == m_metafileHash;
+		};
+
+		Bool skipVariant(ConstWeakArray<MutatorValue> mutation) final
+		{
+			return m_manifest && !m_manifest->hasVariant(m_fname, mutation);
+		}
+	} skip;
+	skip.m_metafileHash = metafileHash;
+	skip.m_newHash = 0;
+	skip.m_gpuHash = ctx.m_gpuHash;
+	skip.m_fname = ctx.m_fname;
+	skip.m_manifest = ctx.m_manifest;
+	// The binary changes when the variants in the manifest change. Mix in a 1 to tell a program with no variants in the
+	// manifest apart from a build without a manifest
+	skip.m_manifestHash = (ctx.m_manifest) ? ctx.m_manifest->getProgramHash(ctx.m_fname) + 1 : 0;
+
+	// Compile
+	ShaderProgramBinaryWrapper binary(alloc);
+	ANKI_CHECK(compileShaderProgram(ctx.m_fname, fsystem, &skip, &ctx.m_taskManager, ctx.m_spirvCache,
+									ctx.m_includeCache, alloc, ctx.m_caps, ctx.m_limits, binary));
+
+	const Bool cachedBinIsUpToDate = metafileHash == skip.m_newHash;
+	if(!cachedBinIsUpToDate)
+	{
+		// The RT programs are created all at once at init, don't bother compressing them
+		ShaderProgramPostCompileFlag postCompileFlags = ctx.m_postCompileFlags;
+		if(!!(binary.getBinary().m_presentShaderTypes & ShaderTypeBit::ALL_RAY_TRACING))
+		{
+			postCompileFlags &= ~ShaderProgramPostCompileFlag::COMPRESS_CODE_BLOCKS;
+		}
+
+		for(const ShaderProgramBinaryCodeBlock& block : binary.getBinary().m_codeBlocks)
+		{
+			ctx.m_codeSize += block.m_binary.getSize();
+		}
+
+		ANKI_CHECK(binary.postCompile(postCompileFlags));
+
+		for(const ShaderProgramBinaryCodeBlock& block : binary.getBinary().m_codeBlocks)
+		{
+			ctx.m_finalCodeSize += block.m_binary.getSize();
+		}
+
+		// Save the binary to the cache
+		StringAuto storeFname(alloc);
+		storeFname.sprintf("%s/%sbin", ctx.m_cacheDir.cstr(), baseFname.cstr());
+		ANKI_CHECK(binary.serializeToFile(storeFname));
+
+		// Update the meta file. Write it last so an interrupted build compiles the program again
+		File metaFile;
+		ANKI_CHECK(metaFile.open(metaFname, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+
+		MetaFileData data;
+		data.m_hash = skip.m_newHash;
+		data.m_shaderTypes = binary.getBinary().m_presentShaderTypes;
+		metafileShaderTypes = data.m_shaderTypes;
+		ANKI_CHECK(metaFile.write(&data, sizeof(data)));
+
+		ctx.m_compiled = true;
+	}
+
+	ctx.m_rayTracing = !!(metafileShaderTypes & ShaderTypeBit::ALL_RAY_TRACING);
+
+	// Progress
+	const U32 processedCount = ctx.m_processedProgramCount->fetchAdd(1) + 1;
+	if(ctx.m_compiled)
+	{
+		ANKI_RESOURCE_LOGI("\t[%u/%u] %s", processedCount, ctx.m_programCount, ctx.m_fname.cstr());
+	}
+
+	return Error::NONE;
+}
+
+Error ShaderProgramResourceSystem::compileAllShaders(CString cacheDir, GrManager& gr, ResourceFilesystem& fs,
+													 const ShaderProgramVariantManifest* manifest,
+													 ShaderProgramPostCompileFlag postCompileFlags,
+													 ShaderProgramIncludeCache& includeCache,
+													 GenericMemoryPoolAllocator<U8>& alloc,
+													 StringListAuto& rtProgramFilenames)
+{
+	ANKI_RESOURCE_LOGI("Compiling shader programs%s", (manifest) ? " (only the variants in the manifest)" : "");
 
-	// Compute hash for both
 	const GpuDeviceCapabilities caps = gr.getDeviceCapabilities();
-	const BindlessLimits limits = gr.getBindlessLimits();
-	U64 gpuHash = computeHash(&caps, sizeof(caps));
-	gpuHash = appendHash(&limits, sizeof(limits), gpuHash);
-	gpuHash = appendHash(&SHADER_BINARY_VERSION, sizeof(SHADER_BINARY_VERSION), gpuHash);
 
+	// Gather the programs
+	StringListAuto programFilenames(alloc);
 	ANKI_CHECK(fs.iterateAllFilenames([&](CString fname) -> Error {
 		// Check file extension
 		StringAuto extension(alloc);
@@ -76,166 +509,184 @@ Error ShaderProgramResourceSystem::compileAllShaders(CString cacheDir, GrManager
 			return Error::NONE;
 		}
 
-		if(fname.find("/Rt") != CString::NPOS && !gr.getDeviceCapabilities().m_rayTracingEnabled)
+		if(fname.find("/Rt") != CString::NPOS && !caps.m_rayTracingEnabled)
 		{
 			// Skip RT programs when RT is disabled
 			return Error::NONE;
 		}
 
-		// Get some filenames
-		StringAuto baseFname(alloc);
-		getFilepathFilename(fname, baseFname);
-		StringAuto metaFname(alloc);
-		metaFname.sprintf("%s/%smeta", cacheDir.cstr(), baseFname.cstr());
-
-		// Get the hash from the meta file
-		U64 metafileHash = 0;
-		ShaderTypeBit metafileShaderTypes = ShaderTypeBit::NONE;
-		if(fileExists(metaFname))
-		{
-			File metaFile;
-			ANKI_CHECK(metaFile.open(metaFname, FileOpenFlag::READ | FileOpenFlag::BINARY));
-			MetaFileData data;
-			ANKI_CHECK(metaFile.read(&data, sizeof(data)));
-
-			if(data.m_hash == 0 || data.m_shaderTypes == ShaderTypeBit::NONE)
-			{
-				ANKI_RESOURCE_LOGE("Wrong data found in the metafile: %s", metaFname.cstr());
-				return Error::USER_DATA;
-			}
+		programFilenames.pushBack(fname);
+		return Error::NONE;
+	}));
 
-			metafileHash = data.m_hash;
-			metafileShaderTypes = data.m_shaderTypes;
-		}
+	return compilePrograms(cacheDir, gr, fs, manifest, postCompileFlags, includeCache, alloc, programFilenames,
+						   rtProgramFilenames);
+}
 
-		// Load interface
-		class FSystem : public ShaderProgramFilesystemInterface
-		{
-		public:
-			ResourceFilesystem* m_fsystem = nullptr;
+Error ShaderProgramResourceSystem::compilePrograms(CString cacheDir, GrManager& gr, ResourceFilesystem& fs,
+												   const ShaderProgramVariantManifest* manifest,
+												   ShaderProgramPostCompileFlag postCompileFlags,
+												   ShaderProgramIncludeCache& includeCache,
+												   GenericMemoryPoolAllocator<U8>& alloc,
+												   const StringListAuto& programFilenames,
+												   StringListAuto& rtProgramFilenames)
+{
+	const U32 programCount = U32(programFilenames.getSize());
+	if(programCount == 0)
+	{
+		ANKI_RESOURCE_LOGI("Compiled 0 shader programs");
+		return Error::NONE;
+	}
 
-			Error readAllText(CString filename, StringAuto& txt) final
-			{
-				ResourceFilePtr file;
-				ANKI_CHECK(m_fsystem->openFile(filename, file));
-				ANKI_CHECK(file->readAllText(txt));
-				return Error::NONE;
-			}
-		} fsystem;
-		fsystem.m_fsystem = &fs;
+	// Compute hash for both
+	const GpuDeviceCapabilities caps = gr.getDeviceCapabilities();
+	const BindlessLimits limits = gr.getBindlessLimits();
+	U64 gpuHash = computeHash(&caps, sizeof(caps));
+	gpuHash = appendHash(&limits, sizeof(limits), gpuHash);
+	gpuHash = appendHash(&SHADER_BINARY_VERSION, sizeof(SHADER_BINARY_VERSION), gpuHash);
+	gpuHash = appendHash(&postCompileFlags, sizeof(postCompileFlags), gpuHash);
 
-		// Skip interface
-		class Skip : public ShaderProgramPostParseInterface
-		{
-		public:
-			U64 m_metafileHash;
-			U64 m_newHash;
-			U64 m_gpuHash;
-			CString m_fname;
+	// The SPIR-V of the shader stages is shared by all programs and survives the edits of the programs
+	StringAuto spirvCacheDir(alloc);
+	spirvCacheDir.sprintf("%s/spirv", cacheDir.cstr());
+	ShaderProgramSpirvFileCache spirvCache(alloc);
+	ANKI_CHECK(spirvCache.init(spirvCacheDir));
 
-			Bool skipCompilation(U64 hash)
-			{
-				ANKI_ASSERT(hash != 0);
-				const Array<U64, 2> hashes = {hash, m_gpuHash};
-				const U64 finalHash = computeHash(hashes.getBegin(), hashes.getSizeInBytes());
+	// Submit one task for each program. The variants of all programs end up in the same hive so all cores are busy
+	// even if the programs have a few variants
+	ThreadHive threadHive(getCpuCoresCount(), alloc, false);
+	Atomic<U32> processedProgramCount(0);
 
-				m_newHash = finalHash;
-				const Bool skip = finalHash == m_metafileHash;
+	DynamicArrayAuto<ShaderProgramCompileContext*> ctxs(alloc, programCount);
+	U32 count = 0;
+	for(const String& fname : programFilenames)
+	{
+		ctxs[count] = alloc.newInstance<ShaderProgramCompileContext>(&threadHive, alloc);
+		ShaderProgramCompileContext& ctx = *ctxs[count++];
+		ctx.m_cacheDir = cacheDir;
+		ctx.m_caps = caps;
+		ctx.m_limits = limits;
+		ctx.m_gpuHash = gpuHash;
+		ctx.m_fs = &fs;
+		ctx.m_spirvCache = &spirvCache;
+		ctx.m_includeCache = &includeCache;
+		ctx.m_manifest = manifest;
+		ctx.m_postCompileFlags = postCompileFlags;
+		ctx.m_processedProgramCount = &processedProgramCount;
+		ctx.m_programCount = programCount;
+		ctx.m_fname = fname;
+	}
 
-				if(!skip)
-				{
-					ANKI_RESOURCE_LOGI("\t%s", m_fname.cstr());
-				}
+	for(ShaderProgramCompileContext* ctx : ctxs)
+	{
+		threadHive.submitTask(
+			[](void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore) {
+				ShaderProgramCompileContext& ctx = *static_cast<ShaderProgramCompileContext*>(userData);
+				ctx.m_err = compileShaderProgramTask(ctx);
+			},
+			ctx);
+	}
 
-				return skip;
-			};
-		} skip;
-		skip.m_metafileHash = metafileHash;
-		skip.m_newHash = 0;
-		skip.m_gpuHash = gpuHash;
-		skip.m_fname = fname;
+	threadHive.waitAllTasks();
 
-		// Threading interface
-		class TaskManager : public ShaderProgramAsyncTaskInterface
+	// Gather the results in the order of the filesystem
+	Error err = Error::NONE;
+	U32 shadersCompileCount = 0;
+	PtrSize codeSize = 0;
+	PtrSize finalCodeSize = 0;
+	for(ShaderProgramCompileContext* ctx : ctxs)
+	{
+		if(ctx->m_err)
+		{
+			err = (err) ? err : ctx->m_err;
+		}
+		else
 		{
-		public:
-			ThreadHive* m_hive = nullptr;
-			GenericMemoryPoolAllocator<U8> m_alloc;
+			shadersCompileCount += ctx->m_compiled;
+			codeSize += ctx->m_codeSize;
+			finalCodeSize += ctx->m_finalCodeSize;
 
-			void enqueueTask(void (*callback)(void* userData), void* userData)
+			if(ctx->m_rayTracing)
 			{
-				class Ctx
-				{
-				public:
-					void (*m_callback)(void* userData);
-					void* m_userData;
-					GenericMemoryPoolAllocator<U8> m_alloc;
-				};
-				Ctx* ctx = m_alloc.newInstance<Ctx>();
-				ctx->m_callback = callback;
-				ctx->m_userData = userData;
-				ctx->m_alloc = m_alloc;
-
-				m_hive->submitTask(
-					[](void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore) {
-						Ctx* ctx = static_cast<Ctx*>(userData);
-						ctx->m_callback(ctx->m_userData);
-						auto alloc = ctx->m_alloc;
-						alloc.deleteInstance(ctx);
-					},
-					ctx);
+				rtProgramFilenames.pushBack(ctx->m_fname);
 			}
+		}
 
-			Error joinTasks()
-			{
-				m_hive->waitAllTasks();
-				return Error::NONE;
-			}
-		} taskManager;
-		taskManager.m_hive = &threadHive;
-		taskManager.m_alloc = alloc;
+		alloc.deleteInstance(ctx);
+	}
 
-		// Compile
-		ShaderProgramBinaryWrapper binary(alloc);
-		ANKI_CHECK(compileShaderProgram(fname, fsystem, &skip, &taskManager, alloc, caps, limits, binary));
+	if(!err)
+	{
+		ANKI_RESOURCE_LOGI("Compiled %u shader programs. SPIR-V cache hits %u, misses %u. Include cache hits %u, "
+						   "misses %u",
+						   shadersCompileCount, spirvCache.getHitCount(), spirvCache.getMissCount(),
+						   includeCache.getHitCount(), includeCache.getMissCount());
 
-		const Bool cachedBinIsUpToDate = metafileHash == skip.m_newHash;
-		if(!cachedBinIsUpToDate)
+		if(shadersCompileCount)
 		{
-			++shadersCompileCount;
+			ANKI_RESOURCE_LOGI("The SPIR-V of the compiled programs is %zuKB, %zuKB after the post-compile stages",
+							   codeSize / 1024, finalCodeSize / 1024);
 		}
+	}
 
-		// Update the meta file
-		if(!cachedBinIsUpToDate)
-		{
-			File metaFile;
-			ANKI_CHECK(metaFile.open(metaFname, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+	return err;
+}
 
-			MetaFileData data;
-			data.m_hash = skip.m_newHash;
-			data.m_shaderTypes = binary.getBinary().m_presentShaderTypes;
-			metafileShaderTypes = data.m_shaderTypes;
-			ANKI_CHECK(metaFile.write(&data, sizeof(data)));
-		}
+Error ShaderProgramResourceSystem::compileVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation,
+												  ShaderProgramBinaryWrapper& binary)
+{
+	ANKI_TRACE_SCOPED_EVENT(COMPILE_SHADERS);
 
-		// Save the binary to the cache
-		if(!cachedBinIsUpToDate)
+	ShaderProgramFilesystem fsystem;
+	fsystem.m_fsystem = m_fs;
+
+	class Filter : public ShaderProgramPostParseInterface
+	{
+	public:
+		ConstWeakArray<MutatorValue> m_mutation;
+
+		Bool skipCompilation(U64 hash) final
 		{
-			StringAuto storeFname(alloc);
-			storeFname.sprintf("%s/%sbin", cacheDir.cstr(), baseFname.cstr());
-			ANKI_CHECK(binary.serializeToFile(storeFname));
+			return false;
 		}
 
-		// Gather RT programs
-		if(!!(metafileShaderTypes & ShaderTypeBit::ALL_RAY_TRACING))
+		Bool skipVariant(ConstWeakArray<MutatorValue> mutation) final
 		{
-			rtProgramFilenames.pushBack(fname);
+			ANKI_ASSERT(mutation.getSize() == m_mutation.getSize());
+			return memcmp(mutation.getBegin(), m_mutation.getBegin(), mutation.getSizeInBytes()) != 0;
 		}
+	} filter;
+	filter.m_mutation = mutation;
 
-		return Error::NONE;
-	}));
+	// Share the SPIR-V with the programs, another run might have compiled this variant already
+	StringAuto spirvCacheDir(m_alloc);
+	spirvCacheDir.sprintf("%s/spirv", m_cacheDir.cstr());
+	ShaderProgramSpirvFileCache spirvCache(m_alloc);
+	ANKI_CHECK(spirvCache.init(spirvCacheDir));
+
+	ANKI_CHECK(compileShaderProgram(programFilename, fsystem, &filter, nullptr, &spirvCache, &m_includeCache, m_alloc,
+									m_gr->getDeviceCapabilities(), m_gr->getBindlessLimits(), binary));
+
+	// The variant is used right away, compressing it would only waste time
+	ANKI_CHECK(binary.postCompile(m_postCompileFlags & ~ShaderProgramPostCompileFlag::COMPRESS_CODE_BLOCKS));
+
+	return Error::NONE;
+}
+
+Error ShaderProgramResourceSystem::recompilePrograms(const StringListAuto& programFilenames)
+{
+	ANKI_TRACE_SCOPED_EVENT(COMPILE_SHADERS);
+
+	// The ray tracing libraries are created once at init, their programs can't change
+	StringListAuto rtProgramFilenames(m_alloc);
+	ANKI_CHECK(compilePrograms(m_cacheDir, *m_gr, *m_fs, (m_lazyVariants) ? &m_manifest : nullptr, m_postCompileFlags,
+							   m_includeCache, m_alloc, programFilenames, rtProgramFilenames));
+
+	for(const String& fname : rtProgramFilenames)
+	{
+		ANKI_RESOURCE_LOGW("Ray tracing programs can't be reloaded, restart to see the changes: %s", fname.cstr());
+	}
 
-	ANKI_RESOURCE_LOGI("Compiled %u shader programs", shadersCompileCount);
 	return Error::NONE;
 }
 
@@ -304,6 +755,14 @@ Error ShaderProgramResourceSystem::createRayTracingPrograms(CString cacheDir, co
 		ANKI_CHECK(binaryw.deserializeFromFile(binaryFilename));
 		const ShaderProgramBinary& binary = binaryw.getBinary();
 
+#if ANKI_EXTRA_CHECKS
+		// The RT programs are never compressed, see compileShaderProgramTask()
+		for(const ShaderProgramBinaryCodeBlock& block : binary.m_codeBlocks)
+		{
+			ANKI_ASSERT(block.m_uncompressedSize == 0);
+		}
+#endif
+
 		// Checks
 		if(binary.m_libraryName[0] == '\0')
 		{
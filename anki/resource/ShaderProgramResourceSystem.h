@@ -9,7 +9,8 @@
 #include <anki/gr/ShaderProgram.h>
 #include <anki/util/HashMap.h>
 #include <anki/util/StringList.h>
-#include <anki/shader_compiler/ShaderProgramBinary.h>
+#include <anki/util/Thread.h>
+#include <anki/shader_compiler/ShaderProgramCompiler.h>
 
 namespace anki
 {
@@ -81,6 +82,51 @@ private:
 	void getShaderGroupHandle(U32 groupIndex, WeakArray<U8>& handle) const;
 };
 
+/// The shader program variants that the game uses. It's a text file with one variant per line. Every line has the
+/// filename of the program and the values of the mutators of the variant, separated by spaces.
+class ShaderProgramVariantManifest
+{
+public:
+	ShaderProgramVariantManifest(const GenericMemoryPoolAllocator<U8>& alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~ShaderProgramVariantManifest();
+
+	ANKI_USE_RESULT Error load(CString filename);
+
+	ANKI_USE_RESULT Error store(CString filename) const;
+
+	/// Add a variant.
+	/// @note It's thread-safe.
+	void addVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation);
+
+	/// @note It's thread-safe.
+	Bool hasVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation) const;
+
+	/// Get a hash of all the variants of a program. It's zero if the manifest doesn't have any.
+	/// @note It's thread-safe.
+	U64 getProgramHash(CString programFilename) const;
+
+	/// Return true if variants were added after load().
+	Bool isDirty() const
+	{
+		return m_dirty;
+	}
+
+private:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	HashMap<U64, String> m_lines; ///< The key is the hash of the line.
+	HashMap<U64, U64> m_programHashes; ///< From the hash of the program filename to the hash of its variants.
+	mutable Mutex m_mtx;
+	Bool m_dirty = false;
+
+	void addVariantInternal(CString programFilename, ConstWeakArray<MutatorValue> mutation);
+
+	static void generateLine(CString programFilename, ConstWeakArray<MutatorValue> mutation, StringAuto& line);
+};
+
 /// A system that does some work on shader programs before resources start loading.
 class ShaderProgramResourceSystem
 {
@@ -90,19 +136,55 @@ public:
 		: m_alloc(alloc)
 		, m_gr(gr)
 		, m_fs(fs)
+		, m_manifest(alloc)
+		, m_includeCache(alloc)
 	{
 		m_cacheDir.create(alloc, cacheDir);
 	}
 
 	~ShaderProgramResourceSystem();
 
-	ANKI_USE_RESULT Error init();
+	/// @param variantManifestFilename If the manifest exists only the variants in it will be compiled in advance. Can
+	///                                be empty.
+	/// @param recordVariantManifest Add the variants that getOrCreateVariant() creates to the manifest and store it
+	///                              at the end.
+	/// @param postCompileFlags The stages to run on the binaries after the compilation.
+	ANKI_USE_RESULT Error init(CString variantManifestFilename = CString(), Bool recordVariantManifest = false,
+							   ShaderProgramPostCompileFlag postCompileFlags = ShaderProgramPostCompileFlag::NONE);
 
 	ConstWeakArray<ShaderProgramRaytracingLibrary> getRayTracingLibraries() const
 	{
 		return m_rtLibraries;
 	}
 
+	/// Record a variant that a ShaderProgramResource created.
+	/// @note It's thread-safe.
+	void recordVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation)
+	{
+		if(m_recordManifest)
+		{
+			m_manifest.addVariant(programFilename, mutation);
+		}
+	}
+
+	/// Compile a variant that is not part of the binary of its program. The binary will contain only that variant.
+	/// @note It's thread-safe.
+	ANKI_USE_RESULT Error compileVariant(CString programFilename, ConstWeakArray<MutatorValue> mutation,
+										 ShaderProgramBinaryWrapper& binary);
+
+	/// Forget a source file that changed on disk.
+	/// @param[out] programs The programs that include that file, directly or not. They need to be compiled again.
+	/// @note It's thread-safe.
+	void invalidateSourceFile(CString filename, StringListAuto& programs)
+	{
+		m_includeCache.invalidate(filename);
+		m_includeCache.getDependentPrograms(filename, programs);
+	}
+
+	/// Compile some programs again and store them to the cache. It's used by the hot reload.
+	/// @note It's thread-safe.
+	ANKI_USE_RESULT Error recompilePrograms(const StringListAuto& programFilenames);
+
 private:
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	String m_cacheDir;
@@ -110,9 +192,29 @@ private:
 	ResourceFilesystem* m_fs;
 	DynamicArray<ShaderProgramRaytracingLibrary> m_rtLibraries;
 
+	ShaderProgramVariantManifest m_manifest;
+	String m_manifestFilename;
+	Bool m_recordManifest = false;
+	Bool m_lazyVariants = false; ///< Only the variants in the manifest are compiled in advance.
+
+	ShaderProgramPostCompileFlag m_postCompileFlags = ShaderProgramPostCompileFlag::NONE;
+
+	ShaderProgramIncludeCache m_includeCache; ///< Shared by all programs and by the variants compiled later.
+
 	/// Iterate all programs in the filesystem and compile them to AnKi's binary format.
+	/// @param manifest If not nullptr only the variants in the manifest will be compiled.
 	static Error compileAllShaders(CString cacheDir, GrManager& gr, ResourceFilesystem& fs,
-								   GenericMemoryPoolAllocator<U8>& alloc, StringListAuto& rtProgramFilenames);
+								   const ShaderProgramVariantManifest* manifest,
+								   ShaderProgramPostCompileFlag postCompileFlags,
+								   ShaderProgramIncludeCache& includeCache, GenericMemoryPoolAllocator<U8>& alloc,
+								   StringListAuto& rtProgramFilenames);
+
+	/// Compile some programs to AnKi's binary format.
+	static Error compilePrograms(CString cacheDir, GrManager& gr, ResourceFilesystem& fs,
+								 const ShaderProgramVariantManifest* manifest,
+								 ShaderProgramPostCompileFlag postCompileFlags, ShaderProgramIncludeCache& includeCache,
+								 GenericMemoryPoolAllocator<U8>& alloc, const StringListAuto& programFilenames,
+								 StringListAuto& rtProgramFilenames);
 
 	static Error createRayTracingPrograms(CString cacheDir, const StringListAuto& rtProgramFilenames, GrManager& gr,
 										  GenericMemoryPoolAllocator<U8>& alloc,
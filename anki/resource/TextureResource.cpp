@@ -7,6 +7,7 @@
 #include <anki/resource/ImageLoader.h>
 #include <anki/resource/ResourceManager.h>
 #include <anki/resource/AsyncLoader.h>
+#include <anki/resource/TextureStreamer.h>
 
 namespace anki
 {
@@ -45,37 +46,11 @@ public:
 	}
 };
 
-TextureResource::~TextureResource()
-{
-}
-
-Error TextureResource::load(const ResourceFilename& filename, Bool async)
+/// Fill the TextureInitInfo with what the ImageLoader loaded.
+static void fillTextureInitInfo(const ImageLoader& loader, TextureInitInfo& init, U32& faces)
 {
-	TexUploadTask* task;
-	LoadingContext* ctx;
-	LoadingContext localCtx(getTempAllocator());
-
-	if(async)
-	{
-		task = getManager().getAsyncLoader().newTask<TexUploadTask>(getManager().getAsyncLoader().getAllocator());
-		ctx = &task->m_ctx;
-	}
-	else
-	{
-		task = nullptr;
-		ctx = &localCtx;
-	}
-	ImageLoader& loader = ctx->m_loader;
-
-	TextureInitInfo init("RsrcTex");
 	init.m_usage = TextureUsageBit::ALL_SAMPLED | TextureUsageBit::TRANSFER_DESTINATION;
 	init.m_initialUsage = TextureUsageBit::ALL_SAMPLED;
-	U32 faces = 0;
-
-	ResourceFilePtr file;
-	ANKI_CHECK(openFile(filename, file));
-
-	ANKI_CHECK(loader.load(file, filename, getManager().getMaxTextureSize()));
 
 	// Various sizes
 	init.m_width = loader.getWidth();
@@ -147,6 +122,68 @@ Error TextureResource::load(const ResourceFilename& filename, Bool async)
 
 	// mipmapsCount
 	init.m_mipmapCount = U8(loader.getMipmapCount());
+}
+
+TextureResource::~TextureResource()
+{
+	if(m_streamingHandle != MAX_U32)
+	{
+		getManager().getTextureStreamer()->unregisterTexture(m_streamingHandle);
+	}
+}
+
+Error TextureResource::load(const ResourceFilename& filename, Bool async)
+{
+	TexUploadTask* task;
+	LoadingContext* ctx;
+	LoadingContext localCtx(getTempAllocator());
+
+	if(async)
+	{
+		task = getManager().getAsyncLoader().newTask<TexUploadTask>(getManager().getAsyncLoader().getAllocator());
+		ctx = &task->m_ctx;
+	}
+	else
+	{
+		task = nullptr;
+		ctx = &localCtx;
+	}
+	ImageLoader& loader = ctx->m_loader;
+
+	TextureInitInfo init("RsrcTex");
+	U32 faces = 0;
+
+	ResourceFilePtr file;
+	ANKI_CHECK(openFile(filename, file));
+
+	// A streamed texture starts with the tail mips
+	TextureStreamer* streamer = (TextureStreamingScope::isActive()) ? getManager().getTextureStreamer() : nullptr;
+	const U32 maxTextureSize = getManager().getMaxTextureSize();
+	const U32 loadSize = (streamer) ? min(maxTextureSize, TEXTURE_STREAMING_TAIL_SIZE) : maxTextureSize;
+	ANKI_CHECK(loader.load(file, filename, loadSize));
+
+	if(streamer && loader.getTextureType() != ImageLoaderTextureType::_2D && loader.getFirstMipmap() > 0)
+	{
+		// Only the 2D textures are streamed, load all the mips
+		streamer = nullptr;
+		ANKI_CHECK(file->seek(0, FileSeekOrigin::BEGINNING));
+		ANKI_CHECK(loader.load(file, filename, maxTextureSize));
+	}
+
+	fillTextureInitInfo(loader, init, faces);
+
+	// Find the mips that were skipped because of the streaming. The biggest mip is the biggest that the
+	// maxTextureSize allows
+	const U32 fileWidth = loader.getWidth() << loader.getFirstMipmap();
+	const U32 fileHeight = loader.getHeight() << loader.getFirstMipmap();
+	const U32 fileMipCount = loader.getFirstMipmap() + loader.getMipmapCount();
+	U32 topMip = 0;
+	while(topMip + 1 < fileMipCount && max(fileWidth >> topMip, fileHeight >> topMip) > maxTextureSize)
+	{
+		++topMip;
+	}
+	const U32 tailFirstMip = loader.getFirstMipmap() - topMip;
+	ANKI_ASSERT(tailFirstMip == 0 || streamer);
 
 	// Create the texture
 	m_tex = getManager().getGrManager().newTexture(init);
@@ -169,13 +206,59 @@ Error TextureResource::load(const ResourceFilename& filename, Bool async)
 		ANKI_CHECK(load(*ctx));
 	}
 
-	m_size = UVec3(init.m_width, init.m_height, init.m_depth);
+	m_size = UVec3(init.m_width << tailFirstMip, init.m_height << tailFirstMip, init.m_depth);
 	m_layerCount = init.m_layerCount;
 
 	// Create the texture view
 	TextureViewInitInfo viewInit(m_tex, "Rsrc");
 	m_texView = getManager().getGrManager().newTextureView(viewInit);
 
+	// Stream the rest of the mips
+	if(tailFirstMip > 0)
+	{
+		DynamicArrayAuto<PtrSize> mipSizes(getTempAllocator());
+		for(U32 mip = 0; mip < tailFirstMip + init.m_mipmapCount; ++mip)
+		{
+			mipSizes.emplaceBack(
+				computeSurfaceSize(max(1u, m_size.x() >> mip), max(1u, m_size.y() >> mip), init.m_format));
+		}
+
+		m_streamingHandle = streamer->registerTexture(this, mipSizes, tailFirstMip);
+	}
+
+	return Error::NONE;
+}
+
+Error TextureResource::loadMips(U32 firstMip, TexturePtr& tex, TextureViewPtr& view) const
+{
+	ANKI_ASSERT(m_streamingHandle != MAX_U32);
+
+	LoadingContext ctx(getManager().getAsyncLoader().getAllocator());
+
+	// Not through openFile(), the texture doesn't depend on anything new
+	ResourceFilePtr file;
+	ANKI_CHECK(getManager().getFilesystem().openFile(getFilename(), file));
+	ANKI_CHECK(ctx.m_loader.load(file, getFilename(), max(m_size.x(), m_size.y()) >> firstMip));
+
+	if(ctx.m_loader.getTextureType() != ImageLoaderTextureType::_2D)
+	{
+		ANKI_RESOURCE_LOGE("The texture is not 2D any more");
+		return Error::USER_DATA;
+	}
+
+	TextureInitInfo init("RsrcTex");
+	fillTextureInitInfo(ctx.m_loader, init, ctx.m_faces);
+	tex = getManager().getGrManager().newTexture(init);
+
+	ctx.m_layerCount = init.m_layerCount;
+	ctx.m_gr = &getManager().getGrManager();
+	ctx.m_trfAlloc = &getManager().getTransferGpuAllocator();
+	ctx.m_texType = init.m_type;
+	ctx.m_tex = tex;
+	ANKI_CHECK(load(ctx));
+
+	view = getManager().getGrManager().newTextureView(TextureViewInitInfo(tex, "Rsrc"));
+
 	return Error::NONE;
 }
 
@@ -17,7 +17,9 @@ namespace anki
 /// Texture resource class.
 ///
 /// It loads or creates an image and then loads it in the GPU. It supports compressed and uncompressed TGAs and AnKi's
-/// texture format.
+/// texture format. The 2D textures that are loaded inside a TextureStreamingScope start with the tail mips only and the
+/// TextureStreamer replaces the GPU texture when it loads more mips. The sizes are always the sizes of the whole
+/// texture.
 class TextureResource : public ResourceObject
 {
 public:
@@ -67,6 +69,23 @@ public:
 		return m_layerCount;
 	}
 
+	/// The handle of the TextureStreamer or MAX_U32 if the texture is not streamed.
+	ANKI_INTERNAL U32 getStreamingHandle() const
+	{
+		return m_streamingHandle;
+	}
+
+	/// Load the texture again starting from a mip. It runs in the AsyncLoader thread.
+	ANKI_INTERNAL ANKI_USE_RESULT Error loadMips(U32 firstMip, TexturePtr& tex, TextureViewPtr& view) const;
+
+	/// Replace the GPU texture with one that has more or less mips. Call it when the AsyncLoader is paused.
+	ANKI_INTERNAL void setStreamedTexture(const TexturePtr& tex, const TextureViewPtr& view)
+	{
+		ANKI_ASSERT(m_streamingHandle != MAX_U32);
+		m_tex = tex;
+		m_texView = view;
+	}
+
 private:
 	static constexpr U32 MAX_COPIES_BEFORE_FLUSH = 4;
 
@@ -77,6 +96,7 @@ private:
 	TextureViewPtr m_texView;
 	UVec3 m_size = UVec3(0u);
 	U32 m_layerCount = 0;
+	U32 m_streamingHandle = MAX_U32;
 
 	ANKI_USE_RESULT static Error load(LoadingContext& ctx);
 };
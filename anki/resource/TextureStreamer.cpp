@@ -0,0 +1,167 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/resource/TextureStreamer.h>
+#include <anki/resource/TextureResource.h>
+#include <anki/resource/ResourceManager.h>
+#include <anki/resource/AsyncLoader.h>
+#include <anki/util/Tracer.h>
+
+namespace anki
+{
+
+static thread_local Bool t_streamingScopeActive = false;
+
+TextureStreamingScope::TextureStreamingScope()
+	: m_prevActive(t_streamingScopeActive)
+{
+	t_streamingScopeActive = true;
+}
+
+TextureStreamingScope::~TextureStreamingScope()
+{
+	t_streamingScopeActive = m_prevActive;
+}
+
+Bool TextureStreamingScope::isActive()
+{
+	return t_streamingScopeActive;
+}
+
+/// Loads the mips of a texture in the AsyncLoader.
+class TextureStreamer::StreamTask : public AsyncLoaderTask
+{
+public:
+	TextureStreamer* m_streamer;
+	Result m_result;
+
+	StreamTask(TextureStreamer* streamer)
+		: m_streamer(streamer)
+	{
+	}
+
+	Error operator()(AsyncLoaderTaskContext& ctx) final
+	{
+		const Error err = m_result.m_tex->loadMips(m_result.m_firstMip, m_result.m_grTex, m_result.m_grTexView);
+		if(err)
+		{
+			ANKI_RESOURCE_LOGE("Failed to stream the mips of texture: %s", m_result.m_tex->getFilename().cstr());
+		}
+
+		m_result.m_success = !err;
+		m_streamer->addResult(std::move(m_result));
+
+		// Don't stop the loader, the texture keeps the mips that it has
+		return Error::NONE;
+	}
+};
+
+TextureStreamer::TextureStreamer(ResourceManager* manager, PtrSize budget)
+	: m_manager(manager)
+	, m_policy(manager->getAllocator(), budget, MAX_TEXTURE_STREAMING_REQUESTS)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// It might delete textures so don't hold the lock
+	m_results.destroy(m_manager->getAllocator());
+
+	m_textures.destroy(m_manager->getAllocator());
+}
+
+U32 TextureStreamer::registerTexture(TextureResource* tex, ConstWeakArray<PtrSize> mipSizes, U32 tailFirstMip)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	const U32 handle = m_policy.registerResource(mipSizes, tailFirstMip);
+	if(handle >= m_textures.getSize())
+	{
+		m_textures.resize(m_manager->getAllocator(), handle + 1, nullptr);
+	}
+
+	m_textures[handle] = tex;
+	return handle;
+}
+
+void TextureStreamer::unregisterTexture(U32 handle)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	m_policy.unregisterResource(handle);
+	m_textures[handle] = nullptr;
+}
+
+void TextureStreamer::requestMip(const TextureResource& tex, U32 mip)
+{
+	const U32 handle = tex.getStreamingHandle();
+	if(handle != MAX_U32)
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		m_policy.requestLevel(handle, mip);
+	}
+}
+
+void TextureStreamer::addResult(Result&& result)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	m_results.emplaceBack(m_manager->getAllocator(), std::move(result));
+}
+
+void TextureStreamer::endFrame()
+{
+	ANKI_TRACE_SCOPED_EVENT(RSRC_TEXTURE_STREAMING);
+
+	// Replace the textures that finished loading
+	DynamicArray<Result> results;
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		results = std::move(m_results);
+	}
+
+	for(Result& result : results)
+	{
+		if(result.m_success)
+		{
+			result.m_tex->setStreamedTexture(result.m_grTex, result.m_grTexView);
+		}
+
+		LockGuard<Mutex> lock(m_mtx);
+		m_policy.completeRequest(result.m_handle, result.m_success);
+	}
+
+	ANKI_TRACE_INC_COUNTER(RSRC_STREAMED_TEXTURES, results.getSize());
+
+	// It might delete textures so don't hold the lock
+	results.destroy(m_manager->getAllocator());
+
+	// Start the new loads
+	DynamicArrayAuto<ResidencyRequest> requests(m_manager->getAllocator());
+	DynamicArrayAuto<TextureResourcePtr> textures(m_manager->getAllocator());
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		m_policy.update(requests);
+
+		for(const ResidencyRequest& request : requests)
+		{
+			textures.emplaceBack(m_textures[request.m_handle]);
+		}
+
+		ANKI_TRACE_INC_COUNTER(RSRC_STREAMED_TEXTURE_MEMORY, m_policy.getCommittedSize());
+	}
+
+	AsyncLoader& loader = m_manager->getAsyncLoader();
+	for(U32 i = 0; i < requests.getSize(); ++i)
+	{
+		StreamTask* task = loader.newTask<StreamTask>(this);
+		task->m_result.m_tex = std::move(textures[i]);
+		task->m_result.m_handle = requests[i].m_handle;
+		task->m_result.m_firstMip = requests[i].m_firstLevel;
+		task->m_result.m_success = false;
+		loader.submitTask(task);
+	}
+}
+
+} // end namespace anki
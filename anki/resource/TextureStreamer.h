@@ -0,0 +1,110 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/resource/ResidencyPolicy.h>
+#include <anki/util/Thread.h>
+#include <anki/Math.h>
+#include <anki/Gr.h>
+
+namespace anki
+{
+
+/// @addtogroup resource
+/// @{
+
+/// The mips with this size or smaller are the tail of a streamed texture. The tail is loaded with the texture.
+constexpr U32 TEXTURE_STREAMING_TAIL_SIZE = 64;
+
+/// The number of textures that can be loading at the same time.
+constexpr U32 MAX_TEXTURE_STREAMING_REQUESTS = 16;
+
+/// The 2D textures that a thread loads while this is alive are streamed. The textures that are bound without asking
+/// for mips (render targets, look up tables etc) should not be streamed.
+class TextureStreamingScope : public NonCopyable
+{
+public:
+	TextureStreamingScope();
+
+	~TextureStreamingScope();
+
+	/// Check if the current thread is inside a scope.
+	static Bool isActive();
+
+private:
+	Bool m_prevActive;
+};
+
+/// Streams the mips of the textures. Every frame the renderer asks for the mips that the visible textures need, the
+/// ResidencyPolicy decides what fits in the budget and the new mips are loaded in the AsyncLoader. The textures
+/// are created again with the new mips and they replace the old ones in endFrame().
+class TextureStreamer : public NonCopyable
+{
+public:
+	TextureStreamer(ResourceManager* manager, PtrSize budget);
+
+	~TextureStreamer();
+
+	/// Add a texture. It's thread-safe.
+	/// @param mipSizes The size in bytes of each mip. The first is the biggest.
+	/// @param tailFirstMip The first mip of the tail. It's the only resident mip when the texture is loaded.
+	/// @return The streaming handle of the texture.
+	U32 registerTexture(TextureResource* tex, ConstWeakArray<PtrSize> mipSizes, U32 tailFirstMip);
+
+	/// Remove a texture. It's thread-safe.
+	void unregisterTexture(U32 handle);
+
+	/// Ask for a mip of a texture in the current frame. It does nothing if the texture is not streamed. It's
+	/// thread-safe.
+	void requestMip(const TextureResource& tex, U32 mip);
+
+	/// Replace the textures that finished loading and start new loads. Call it once per frame when the AsyncLoader is
+	/// paused.
+	void endFrame();
+
+	/// Compute the mip that a texture needs so that one of its texels covers at least one pixel.
+	/// @param textureSize The biggest side of the texture in texels.
+	/// @param uvDensity The UV units that a world unit covers on the surface that uses the texture.
+	/// @param pixelsPerWorldUnit The pixels that a world unit covers on the screen.
+	static U32 computeMip(U32 textureSize, F32 uvDensity, F32 pixelsPerWorldUnit)
+	{
+		ANKI_ASSERT(textureSize > 0);
+		const F32 texelsPerPixel = F32(textureSize) * uvDensity / max(pixelsPerWorldUnit, EPSILON);
+		return (texelsPerPixel > 1.0f) ? U32(min(log2(texelsPerPixel), 31.0f)) : 0;
+	}
+
+	/// The memory that the mips of the streamed textures use or will use when the pending loads are done.
+	PtrSize getCommittedSize() const
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		return m_policy.getCommittedSize();
+	}
+
+private:
+	class StreamTask;
+
+	class Result
+	{
+	public:
+		TextureResourcePtr m_tex;
+		TexturePtr m_grTex;
+		TextureViewPtr m_grTexView;
+		U32 m_handle;
+		U32 m_firstMip;
+		Bool m_success;
+	};
+
+	ResourceManager* m_manager;
+	ResidencyPolicy m_policy;
+	DynamicArray<TextureResource*> m_textures; ///< Indexed by the handle.
+	DynamicArray<Result> m_results; ///< The loads that are done and wait for endFrame().
+	mutable Mutex m_mtx;
+
+	void addResult(Result&& result);
+};
+/// @}
+
+} // end namespace anki
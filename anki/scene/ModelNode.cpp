@@ -139,6 +139,7 @@ void ModelNode::initRenderComponents()
 			&m_renderProxies[patchIdx], modelc.getRenderMergeKeys()[patchIdx]);
 
 		rc.setFlagsFromMaterial(model->getModelPatches()[patchIdx].getMaterial());
+		rc.initStreaming(&model->getModelPatches()[patchIdx]);
 
 		if(model->getModelPatches()[patchIdx].getSupportedRayTracingTypes() != RayTypeBit::NONE)
 		{
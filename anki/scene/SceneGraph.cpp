@@ -68,6 +68,7 @@ Error SceneGraph::init(AllocAlignedCallback allocCb, void* allocCbData, ThreadHi
 
 	m_alloc = SceneAllocator<U8>(allocCb, allocCbData);
 	m_frameAlloc = SceneFrameAllocator<U8>(allocCb, allocCbData, 1 * 1024 * 1024);
+	m_frameAlloc.getMemoryPool().setThreadArenaSize(16_KB);
 
 	// Limits & stuff
 	m_config.m_earlyZDistance = config.getNumberF32("scene_earlyZDistance");
@@ -198,6 +199,7 @@ Error SceneGraph::update(Second prevUpdateTime, Second crntTime)
 
 	// Reset the framepool
 	m_frameAlloc.getMemoryPool().reset();
+	ANKI_TRACE_INC_COUNTER(SCENE_FRAME_ALLOC_WASTED_BYTES, m_frameAlloc.getMemoryPool().getThreadArenaWastedBytes());
 
 	// Delete stuff
 	{
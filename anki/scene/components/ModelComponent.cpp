@@ -47,4 +47,30 @@ Error ModelComponent::loadModelResource(CString filename)
 	return Error::NONE;
 }
 
+Error ModelComponent::update(SceneNode& node, Second prevTime, Second crntTime, Bool& updated)
+{
+	// Switch to the newest version of the model if it was reloaded
+	if(m_model.isCreated() && m_model->getReplacement() && m_model->getReplacement() != m_ignoredReplacement)
+	{
+		ModelResourcePtr newModel = m_model;
+		ResourceManager::refreshResource(newModel);
+
+		// The scene node creates one render component per patch
+		if(newModel->getModelPatches().getSize() == m_model->getModelPatches().getSize())
+		{
+			ANKI_CHECK(loadModelResource(newModel->getFilename()));
+		}
+		else
+		{
+			ANKI_SCENE_LOGW("The reloaded model has a different number of patches, restart to see it: %s",
+							newModel->getFilename().cstr());
+			m_ignoredReplacement = static_cast<const ModelResource*>(m_model->getReplacement());
+		}
+	}
+
+	updated = m_dirty;
+	m_dirty = false;
+	return Error::NONE;
+}
+
 } // end namespace anki
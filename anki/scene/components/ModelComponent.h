@@ -32,12 +32,7 @@ public:
 		return m_model;
 	}
 
-	Error update(SceneNode& node, Second prevTime, Second crntTime, Bool& updated) override
-	{
-		updated = m_dirty;
-		m_dirty = false;
-		return Error::NONE;
-	}
+	Error update(SceneNode& node, Second prevTime, Second crntTime, Bool& updated) override;
 
 	ConstWeakArray<U64> getRenderMergeKeys() const
 	{
@@ -54,6 +49,7 @@ private:
 	ModelResourcePtr m_model;
 
 	DynamicArray<U64> m_modelPatchMergeKeys;
+	const ModelResource* m_ignoredReplacement = nullptr; ///< A reloaded model that can't replace the current one.
 	Bool m_dirty = true;
 };
 /// @}
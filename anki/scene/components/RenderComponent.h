@@ -73,6 +73,12 @@ public:
 		m_mergeKey = mergeKey;
 	}
 
+	/// The model patch that the mesh and texture streaming use to find the LODs and the mips that it needs.
+	void initStreaming(const ModelPatch* patch)
+	{
+		m_modelPatch = patch;
+	}
+
 	void initRayTracing(FillRayTracingInstanceQueueElementCallback callback, const void* userData)
 	{
 		m_rtCallback = callback;
@@ -89,6 +95,7 @@ public:
 		el.m_mergeKey = m_mergeKey;
 		el.m_distanceFromCamera = -1.0f;
 		el.m_lod = MAX_U8;
+		el.m_modelPatch = m_modelPatch;
 	}
 
 	void setupRayTracingInstanceQueueElement(U32 lod, RayTracingInstanceQueueElement& el) const
@@ -113,6 +120,7 @@ private:
 	U64 m_mergeKey = MAX_U64;
 	FillRayTracingInstanceQueueElementCallback m_rtCallback = nullptr;
 	const void* m_rtCallbackUserData = nullptr;
+	const ModelPatch* m_modelPatch = nullptr;
 	RenderComponentFlag m_flags = RenderComponentFlag::NONE;
 };
 /// @}
@@ -6,10 +6,27 @@
 // WARNING: This file is auto generated.
 
 #include <anki/script/LuaBinder.h>
+#include <anki/util/TracerStatistics.h>
 
 namespace anki
 {
 
+static void printTraceStatistics(lua_State* l)
+{
+	LuaBinder* binder = nullptr;
+	lua_getallocf(l, reinterpret_cast<void**>(&binder));
+
+	const TracerStatistics* stats = binder->getOtherSystems().m_tracerStatistics;
+	if(stats)
+	{
+		stats->log();
+	}
+	else
+	{
+		ANKI_SCRIPT_LOGW("There are no trace statistics. Tracing is disabled");
+	}
+}
+
 /// Pre-wrap function logi.
 static inline int pwraplogi(lua_State* l)
 {
@@ -133,12 +150,47 @@ static int wraplogw(lua_State* l)
 	return 0;
 }
 
+/// Pre-wrap function printTraceStatistics.
+static inline int pwrapprintTraceStatistics(lua_State* l)
+{
+	LuaUserData* ud;
+	(void)ud;
+	void* voidp;
+	(void)voidp;
+	PtrSize size;
+	(void)size;
+
+	if(ANKI_UNLIKELY(LuaBinder::checkArgsCount(l, 0)))
+	{
+		return -1;
+	}
+
+	// Call the function
+	printTraceStatistics(l);
+
+	return 0;
+}
+
+/// Wrap function printTraceStatistics.
+static int wrapprintTraceStatistics(lua_State* l)
+{
+	int res = pwrapprintTraceStatistics(l);
+	if(res >= 0)
+	{
+		return res;
+	}
+
+	lua_error(l);
+	return 0;
+}
+
 /// Wrap the module.
 void wrapModuleLogger(lua_State* l)
 {
 	LuaBinder::pushLuaCFunc(l, "logi", wraplogi);
 	LuaBinder::pushLuaCFunc(l, "loge", wraploge);
 	LuaBinder::pushLuaCFunc(l, "logw", wraplogw);
+	LuaBinder::pushLuaCFunc(l, "printTraceStatistics", wrapprintTraceStatistics);
 }
 
 } // end namespace anki
@@ -24,6 +24,7 @@ namespace anki
 class LuaUserData;
 class SceneGraph;
 class MainRenderer;
+class TracerStatistics;
 
 /// @addtogroup script
 /// @{
@@ -145,6 +146,7 @@ class LuaBinderOtherSystems
 public:
 	SceneGraph* m_sceneGraph;
 	MainRenderer* m_renderer;
+	const TracerStatistics* m_tracerStatistics = nullptr; ///< Optional, it's null if tracing is disabled.
 };
 
 /// Lua binder class. A wrapper on top of LUA
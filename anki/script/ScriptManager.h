@@ -37,6 +37,11 @@ public:
 		m_otherSystems.m_sceneGraph = scene;
 	}
 
+	void setTracerStatistics(const TracerStatistics* stats)
+	{
+		m_otherSystems.m_tracerStatistics = stats;
+	}
+
 	LuaBinderOtherSystems& getOtherSystems()
 	{
 		return m_otherSystems;
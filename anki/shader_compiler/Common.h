@@ -8,6 +8,8 @@
 #include <anki/util/Logger.h>
 #include <anki/util/String.h>
 #include <anki/util/BitSet.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/WeakArray.h>
 
 namespace anki
 {
@@ -36,6 +38,14 @@ class ShaderProgramPostParseInterface
 {
 public:
 	virtual Bool skipCompilation(U64 programHash) = 0;
+
+	/// Return true to leave a variant out of the binary. It's useful when the variants that will be used are known in
+	/// advance. If all variants are skipped the first one is compiled anyway. The variants of the ray tracing programs
+	/// are never skipped.
+	virtual Bool skipVariant(ConstWeakArray<MutatorValue> mutation)
+	{
+		return false;
+	}
 };
 
 /// An interface for asynchronous shader compilation.
@@ -46,6 +56,20 @@ public:
 
 	virtual ANKI_USE_RESULT Error joinTasks() = 0;
 };
+
+/// A content-addressed cache of the SPIR-V of single shader stages. It lets the ShaderProgramCompiler skip glslang for
+/// stages that it has seen before, even if they belong to another program. The implementations need to be thread-safe.
+class ShaderProgramSpirvCacheInterface
+{
+public:
+	/// @param key The hash of the preprocessed source, the shader type and the compile options.
+	/// @param[out] spirv The SPIR-V if it's found.
+	/// @param[out] found False if the cache doesn't have that key.
+	virtual ANKI_USE_RESULT Error load(U64 key, DynamicArrayAuto<U8>& spirv, Bool& found) = 0;
+
+	/// If it fails the compiler logs a warning and continues with the SPIR-V it compiled.
+	virtual ANKI_USE_RESULT Error store(U64 key, ConstWeakArray<U8> spirv) = 0;
+};
 /// @}
 
 } // end namespace anki
@@ -6,6 +6,7 @@
 #include <anki/shader_compiler/Glslang.h>
 #include <anki/util/StringList.h>
 #include <anki/util/File.h>
+#include <anki/util/Hash.h>
 
 #if ANKI_COMPILER_GCC_COMPATIBLE
 #	pragma GCC diagnostic push
@@ -141,6 +142,11 @@ static TBuiltInResource setGlslangLimits()
 
 static TBuiltInResource GLSLANG_LIMITS = setGlslangLimits();
 
+/// The options of compilerGlslToSpirv(). Part of the key of the SPIR-V cache so keep all of them here.
+static const EShMessages GLSLANG_SPIRV_MESSAGES = EShMessages(EShMsgSpvRules | EShMsgVulkanRules);
+static const glslang::EShTargetLanguageVersion GLSLANG_SPIRV_VERSION = glslang::EShTargetSpv_1_3;
+static const Bool GLSLANG_SPIRV_OPTIMIZE_SIZE = true;
+
 static EShLanguage ankiToGlslangShaderType(ShaderType shaderType)
 {
 	EShLanguage gslangShader;
@@ -245,8 +251,8 @@ Error compilerGlslToSpirv(CString src, ShaderType shaderType, GenericMemoryPoolA
 						  DynamicArrayAuto<U8>& spirv)
 {
 	const EShLanguage stage = ankiToGlslangShaderType(shaderType);
-	const EShMessages messages = EShMessages(EShMsgSpvRules | EShMsgVulkanRules);
-	const glslang::EShTargetLanguageVersion langVersion = glslang::EShTargetSpv_1_3;
+	const EShMessages messages = GLSLANG_SPIRV_MESSAGES;
+	const glslang::EShTargetLanguageVersion langVersion = GLSLANG_SPIRV_VERSION;
 
 	glslang::TShader shader(stage);
 	Array<const char*, 1> csrc = {&src[0]};
@@ -270,7 +276,7 @@ Error compilerGlslToSpirv(CString src, ShaderType shaderType, GenericMemoryPoolA
 
 	// Gen SPIRV
 	glslang::SpvOptions spvOptions;
-	spvOptions.optimizeSize = true;
+	spvOptions.optimizeSize = GLSLANG_SPIRV_OPTIMIZE_SIZE;
 	spvOptions.disableOptimizer = false;
 	std::vector<unsigned int> glslangSpirv;
 	glslang::GlslangToSpv(*program.getIntermediate(stage), glslangSpirv, &spvOptions);
@@ -299,4 +305,15 @@ Error compilerGlslToSpirv(CString src, ShaderType shaderType, GenericMemoryPoolA
 	return Error::NONE;
 }
 
+U64 computeGlslToSpirvKey(CString src, ShaderType shaderType)
+{
+	const Array<U32, 4> options = {U32(shaderType), U32(GLSLANG_SPIRV_MESSAGES), U32(GLSLANG_SPIRV_VERSION),
+								   U32(GLSLANG_SPIRV_OPTIMIZE_SIZE)};
+
+	U64 hash = computeHash(&GLSLANG_LIMITS, sizeof(GLSLANG_LIMITS));
+	hash = appendHash(options.getBegin(), options.getSizeInBytes(), hash);
+	hash = appendHash(src.cstr(), src.getLength(), hash);
+	return hash;
+}
+
 } // end namespace anki
@@ -22,6 +22,10 @@ ANKI_USE_RESULT Error preprocessGlsl(CString in, StringAuto& out);
 /// Compile glsl to SPIR-V.
 ANKI_USE_RESULT Error compilerGlslToSpirv(CString src, ShaderType shaderType, GenericMemoryPoolAllocator<U8> tmpAlloc,
 										  DynamicArrayAuto<U8>& spirv);
+
+/// Compute a key that identifies the output of compilerGlslToSpirv(). It covers the source, the shader type and the
+/// compile options. Give it the output of preprocessGlsl() to have a key that ignores the inactive code.
+ANKI_USE_RESULT U64 computeGlslToSpirvKey(CString src, ShaderType shaderType);
 /// @}
 
 } // end namespace anki
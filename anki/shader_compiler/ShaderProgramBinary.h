@@ -317,13 +317,16 @@ class ShaderProgramBinaryCodeBlock
 {
 public:
 	WeakArray<U8> m_binary;
-	U64 m_hash = 0;
+	U64 m_hash = 0; ///< The hash of the SPIR-V before it's stripped or compressed.
+	U32 m_uncompressedSize = 0; ///< If not zero m_binary is compressed with zlib.
 
 	template<typename TSerializer, typename TClass>
 	static void serializeCommon(TSerializer& s, TClass self)
 	{
 		s.doValue("m_binary", offsetof(ShaderProgramBinaryCodeBlock, m_binary), self.m_binary);
 		s.doValue("m_hash", offsetof(ShaderProgramBinaryCodeBlock, m_hash), self.m_hash);
+		s.doValue("m_uncompressedSize", offsetof(ShaderProgramBinaryCodeBlock, m_uncompressedSize),
+				  self.m_uncompressedSize);
 	}
 
 	template<typename TDeserializer>
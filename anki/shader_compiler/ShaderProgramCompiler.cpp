@@ -9,12 +9,13 @@
 #include <anki/shader_compiler/ShaderProgramReflection.h>
 #include <anki/util/Serializer.h>
 #include <anki/util/HashMap.h>
+#include <zlib.h>
 
 namespace anki
 {
 
-static const char* SHADER_BINARY_MAGIC = "ANKISDR5"; ///< @warning If changed change SHADER_BINARY_VERSION
-const U32 SHADER_BINARY_VERSION = 5;
+static const char* SHADER_BINARY_MAGIC = "ANKISDR6"; ///< @warning If changed change SHADER_BINARY_VERSION
+const U32 SHADER_BINARY_VERSION = 6;
 
 Error ShaderProgramBinaryWrapper::serializeToFile(CString fname) const
 {
@@ -53,6 +54,117 @@ Error ShaderProgramBinaryWrapper::deserializeFromFile(CString fname)
 	return Error::NONE;
 }
 
+/// Remove the instructions that don't affect the semantics of a SPIR-V module.
+/// @return The new size in bytes.
+static U32 stripSpirv(WeakArray<U8> spirv)
+{
+	ANKI_ASSERT((spirv.getSize() % sizeof(U32)) == 0);
+	U32* words = reinterpret_cast<U32*>(spirv.getBegin());
+	const U32 wordCount = spirv.getSize() / sizeof(U32);
+
+	constexpr U32 HEADER_WORD_COUNT = 5;
+	if(wordCount < HEADER_WORD_COUNT)
+	{
+		return spirv.getSize();
+	}
+
+	U32 outWord = HEADER_WORD_COUNT;
+	U32 inWord = HEADER_WORD_COUNT;
+	while(inWord < wordCount)
+	{
+		const U32 instructionWordCount = words[inWord] >> 16u;
+		const U32 opcode = words[inWord] & 0xFFFFu;
+		if(instructionWordCount == 0 || inWord + instructionWordCount > wordCount)
+		{
+			// Malformed, leave it as is
+			return spirv.getSize();
+		}
+
+		// OpSourceContinued, OpSource, OpSourceExtension, OpName, OpMemberName, OpString, OpLine, OpNoLine and
+		// OpModuleProcessed
+		const Bool strip = (opcode >= 2 && opcode <= 8) || opcode == 317 || opcode == 330;
+		if(!strip)
+		{
+			memmove(&words[outWord], &words[inWord], instructionWordCount * sizeof(U32));
+			outWord += instructionWordCount;
+		}
+
+		inWord += instructionWordCount;
+	}
+
+	return outWord * sizeof(U32);
+}
+
+Error ShaderProgramBinaryWrapper::postCompile(ShaderProgramPostCompileFlag flags)
+{
+	ANKI_ASSERT(m_binary && !m_singleAllocation && "Should be called on a binary that was just compiled");
+
+	for(ShaderProgramBinaryCodeBlock& block : m_binary->m_codeBlocks)
+	{
+		ANKI_ASSERT(block.m_uncompressedSize == 0 && "Already compressed");
+
+		if(!!(flags & ShaderProgramPostCompileFlag::STRIP_DEBUG_INFO))
+		{
+			// Strip in place, the allocation just gets a bit bigger than it needs to be
+			block.m_binary.setArray(block.m_binary.getBegin(), stripSpirv(block.m_binary));
+		}
+
+		if(!!(flags & ShaderProgramPostCompileFlag::COMPRESS_CODE_BLOCKS))
+		{
+			uLongf compressedSize = compressBound(block.m_binary.getSize());
+			U8* compressed = static_cast<U8*>(m_alloc.getMemoryPool().allocate(compressedSize, 1));
+			const I32 ret =
+				compress2(compressed, &compressedSize, block.m_binary.getBegin(), block.m_binary.getSize(), 9);
+
+			if(ret != Z_OK)
+			{
+				m_alloc.getMemoryPool().free(compressed);
+				ANKI_SHADER_COMPILER_LOGE("Failed to compress a code block: %d", ret);
+				return Error::FUNCTION_FAILED;
+			}
+
+			if(compressedSize >= block.m_binary.getSize())
+			{
+				// Not worth it, keep it uncompressed
+				m_alloc.getMemoryPool().free(compressed);
+				continue;
+			}
+
+			U8* code = m_alloc.allocate(compressedSize);
+			memcpy(code, compressed, compressedSize);
+			m_alloc.getMemoryPool().free(compressed);
+
+			block.m_uncompressedSize = block.m_binary.getSize();
+			m_alloc.getMemoryPool().free(block.m_binary.getBegin());
+			block.m_binary.setArray(code, U32(compressedSize));
+		}
+	}
+
+	return Error::NONE;
+}
+
+Error getCodeBlockSpirv(const ShaderProgramBinaryCodeBlock& block, DynamicArrayAuto<U8>& storage,
+						ConstWeakArray<U8>& spirv)
+{
+	if(block.m_uncompressedSize == 0)
+	{
+		spirv = block.m_binary;
+		return Error::NONE;
+	}
+
+	storage.resize(block.m_uncompressedSize);
+	uLongf size = block.m_uncompressedSize;
+	const I32 ret = uncompress(storage.getBegin(), &size, block.m_binary.getBegin(), block.m_binary.getSize());
+	if(ret != Z_OK || size != block.m_uncompressedSize)
+	{
+		ANKI_SHADER_COMPILER_LOGE("Failed to decompress a code block: %d", ret);
+		return Error::USER_DATA;
+	}
+
+	spirv = storage;
+	return Error::NONE;
+}
+
 void ShaderProgramBinaryWrapper::cleanup()
 {
 	if(m_binary == nullptr)
@@ -169,7 +281,7 @@ static Bool spinDials(DynamicArrayAuto<U32>& dials, ConstWeakArray<ShaderProgram
 }
 
 static Error compileSpirv(ConstWeakArray<MutatorValue> mutation, const ShaderProgramParser& parser,
-						  GenericMemoryPoolAllocator<U8>& tmpAlloc,
+						  ShaderProgramSpirvCacheInterface* spirvCache, GenericMemoryPoolAllocator<U8>& tmpAlloc,
 						  Array<DynamicArrayAuto<U8>, U32(ShaderType::COUNT)>& spirv)
 {
 	// Generate the source and the rest for the variant
@@ -184,8 +296,32 @@ static Error compileSpirv(ConstWeakArray<MutatorValue> mutation, const ShaderPro
 			continue;
 		}
 
+		const CString src = parserVariant.getSource(shaderType);
+
+		// Try the cache first. The key uses the preprocessed source so the code of the other stages and the comments
+		// don't affect it
+		U64 cacheKey = 0;
+		Bool foundInCache = false;
+		if(spirvCache)
+		{
+			StringAuto preprocessedSrc(tmpAlloc);
+			ANKI_CHECK(preprocessGlsl(src, preprocessedSrc));
+			cacheKey = computeGlslToSpirvKey(preprocessedSrc, shaderType);
+			ANKI_CHECK(spirvCache->load(cacheKey, spirv[shaderType], foundInCache));
+		}
+
 		// Compile
-		ANKI_CHECK(compilerGlslToSpirv(parserVariant.getSource(shaderType), shaderType, tmpAlloc, spirv[shaderType]));
+		if(!foundInCache)
+		{
+			ANKI_CHECK(compilerGlslToSpirv(src, shaderType, tmpAlloc, spirv[shaderType]));
+
+			// The cache is only an optimization, a failed store shouldn't fail the compilation
+			if(spirvCache && spirvCache->store(cacheKey, spirv[shaderType]))
+			{
+				ANKI_SHADER_COMPILER_LOGW("Failed to store the SPIR-V in the cache. Will continue without it");
+			}
+		}
+
 		ANKI_ASSERT(spirv[shaderType].getSize() > 0);
 	}
 
@@ -195,9 +331,10 @@ static Error compileSpirv(ConstWeakArray<MutatorValue> mutation, const ShaderPro
 static void compileVariantAsync(ConstWeakArray<MutatorValue> mutation, const ShaderProgramParser& parser,
 								ShaderProgramBinaryVariant& variant,
 								DynamicArrayAuto<ShaderProgramBinaryCodeBlock>& codeBlocks,
-								DynamicArrayAuto<U64>& codeBlockHashes, GenericMemoryPoolAllocator<U8>& tmpAlloc,
+								HashMapAuto<U64, U32>& codeBlockIndices, GenericMemoryPoolAllocator<U8>& tmpAlloc,
 								GenericMemoryPoolAllocator<U8>& binaryAlloc,
-								ShaderProgramAsyncTaskInterface& taskManager, Mutex& mtx, Atomic<I32>& error)
+								ShaderProgramAsyncTaskInterface& taskManager,
+								ShaderProgramSpirvCacheInterface* spirvCache, Mutex& mtx, Atomic<I32>& error)
 {
 	variant = {};
 
@@ -208,9 +345,10 @@ static void compileVariantAsync(ConstWeakArray<MutatorValue> mutation, const Sha
 		GenericMemoryPoolAllocator<U8> m_binaryAlloc;
 		DynamicArrayAuto<MutatorValue> m_mutation = {m_tmpAlloc};
 		const ShaderProgramParser* m_parser;
+		ShaderProgramSpirvCacheInterface* m_spirvCache;
 		ShaderProgramBinaryVariant* m_variant;
 		DynamicArrayAuto<ShaderProgramBinaryCodeBlock>* m_codeBlocks;
-		DynamicArrayAuto<U64>* m_codeBlockHashes;
+		HashMapAuto<U64, U32>* m_codeBlockIndices; ///< From the hash of the SPIR-V to the index in m_codeBlocks.
 		Mutex* m_mtx;
 		Atomic<I32>* m_err;
 
@@ -225,9 +363,10 @@ static void compileVariantAsync(ConstWeakArray<MutatorValue> mutation, const Sha
 	ctx->m_mutation.create(mutation.getSize());
 	memcpy(ctx->m_mutation.getBegin(), mutation.getBegin(), mutation.getSizeInBytes());
 	ctx->m_parser = &parser;
+	ctx->m_spirvCache = spirvCache;
 	ctx->m_variant = &variant;
 	ctx->m_codeBlocks = &codeBlocks;
-	ctx->m_codeBlockHashes = &codeBlockHashes;
+	ctx->m_codeBlockIndices = &codeBlockIndices;
 	ctx->m_mtx = &mtx;
 	ctx->m_err = &error;
 
@@ -255,11 +394,17 @@ static void compileVariantAsync(ConstWeakArray<MutatorValue> mutation, const Sha
 																	   {tmpAlloc},
 																	   {tmpAlloc},
 																	   {tmpAlloc}}};
-		const Error err = compileSpirv(ctx.m_mutation, *ctx.m_parser, tmpAlloc, spirvs);
+		const Error err = compileSpirv(ctx.m_mutation, *ctx.m_parser, ctx.m_spirvCache, tmpAlloc, spirvs);
 
 		if(!err)
 		{
-			// No error, check if the spirvs are common with some other variant and store it
+			// No error, check if the spirvs are common with some other variant and store it. Hash outside the lock
+			Array<U64, U32(ShaderType::COUNT)> hashes;
+			for(ShaderType shaderType : EnumIterable<ShaderType>())
+			{
+				const DynamicArrayAuto<U8>& spirv = spirvs[shaderType];
+				hashes[shaderType] = (spirv.isEmpty()) ? 0 : computeHash(&spirv[0], spirv.getSize());
+			}
 
 			LockGuard<Mutex> lock(*ctx.m_mtx);
 
@@ -274,22 +419,16 @@ static void compileVariantAsync(ConstWeakArray<MutatorValue> mutation, const Sha
 				}
 
 				// Check if the spirv is already generated
-				const U64 newHash = computeHash(&spirv[0], spirv.getSize());
-				Bool found = false;
-				for(U32 i = 0; i < ctx.m_codeBlockHashes->getSize(); ++i)
+				const U64 newHash = hashes[shaderType];
+				auto it = ctx.m_codeBlockIndices->find(newHash);
+				if(it != ctx.m_codeBlockIndices->getEnd())
 				{
-					if((*ctx.m_codeBlockHashes)[i] == newHash)
-					{
-						// Found it
-						ctx.m_variant->m_codeBlockIndices[shaderType] = i;
-						found = true;
-						break;
-					}
+					// Found it
+					ctx.m_variant->m_codeBlockIndices[shaderType] = *it;
 				}
-
-				// Create it if not found
-				if(!found)
+				else
 				{
+					// Create it if not found
 					U8* code = ctx.m_binaryAlloc.allocate(spirv.getSizeInBytes());
 					memcpy(code, &spirv[0], spirv.getSizeInBytes());
 
@@ -298,7 +437,7 @@ static void compileVariantAsync(ConstWeakArray<MutatorValue> mutation, const Sha
 					block.m_hash = newHash;
 
 					ctx.m_codeBlocks->emplaceBack(block);
-					ctx.m_codeBlockHashes->emplaceBack(newHash);
+					ctx.m_codeBlockIndices->emplace(newHash, ctx.m_codeBlocks->getSize() - 1);
 
 					ctx.m_variant->m_codeBlockIndices[shaderType] = ctx.m_codeBlocks->getSize() - 1;
 				}
@@ -766,6 +905,8 @@ static Error doReflection(ShaderProgramBinary& binary, GenericMemoryPoolAllocato
 Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterface& fsystem,
 								   ShaderProgramPostParseInterface* postParseCallback,
 								   ShaderProgramAsyncTaskInterface* taskManager_,
+								   ShaderProgramSpirvCacheInterface* spirvCache,
+								   ShaderProgramIncludeCache* includeCache,
 								   GenericMemoryPoolAllocator<U8> tempAllocator,
 								   const GpuDeviceCapabilities& gpuCapabilities, const BindlessLimits& bindlessLimits,
 								   ShaderProgramBinaryWrapper& binaryW)
@@ -780,7 +921,7 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 	memcpy(&binary.m_magic[0], SHADER_BINARY_MAGIC, 8);
 
 	// Parse source
-	ShaderProgramParser parser(fname, &fsystem, tempAllocator, gpuCapabilities, bindlessLimits);
+	ShaderProgramParser parser(fname, &fsystem, tempAllocator, gpuCapabilities, bindlessLimits, includeCache);
 	ANKI_CHECK(parser.parse());
 
 	if(postParseCallback && postParseCallback->skipCompilation(parser.getHash()))
@@ -843,13 +984,16 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 		DynamicArrayAuto<ShaderProgramBinaryVariant> variants(binaryAllocator);
 		DynamicArrayAuto<ShaderProgramBinaryCodeBlock> codeBlocks(binaryAllocator);
 		DynamicArrayAuto<ShaderProgramBinaryMutation> mutations(binaryAllocator, mutationCount);
-		DynamicArrayAuto<U64> codeBlockHashes(tempAllocator);
+		HashMapAuto<U64, U32> codeBlockIndices(tempAllocator);
 		HashMapAuto<U64, U32> mutationHashToIdx(tempAllocator);
 
 		// Grow the storage of the variants array. Can't have it resize, threads will work on stale data
 		variants.resizeStorage(mutationCount);
 		const ShaderProgramBinaryVariant* baseVariant = nullptr;
 
+		// The ray tracing libraries need all the hit groups when they are created so never skip variants there
+		const Bool canSkipVariants = postParseCallback && !(parser.getShaderTypes() & ShaderTypeBit::ALL_RAY_TRACING);
+
 		mutationCount = 0;
 
 		// Spin for all possible combinations of mutators and
@@ -876,18 +1020,23 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 			const Bool rewritten = parser.rewriteMutation(
 				WeakArray<MutatorValue>(rewrittenMutationValues.getBegin(), rewrittenMutationValues.getSize()));
 
+			const Bool skip = canSkipVariants && postParseCallback->skipVariant(originalMutationValues);
+
 			// Create the variant
 			if(!rewritten)
 			{
 				// New and unique mutation and thus variant, add it
 
-				ShaderProgramBinaryVariant& variant = *variants.emplaceBack();
-				baseVariant = (baseVariant == nullptr) ? variants.getBegin() : baseVariant;
+				if(!skip)
+				{
+					ShaderProgramBinaryVariant& variant = *variants.emplaceBack();
+					baseVariant = (baseVariant == nullptr) ? variants.getBegin() : baseVariant;
 
-				compileVariantAsync(originalMutationValues, parser, variant, codeBlocks, codeBlockHashes, tempAllocator,
-									binaryAllocator, taskManager, mtx, errorAtomic);
+					compileVariantAsync(originalMutationValues, parser, variant, codeBlocks, codeBlockIndices,
+										tempAllocator, binaryAllocator, taskManager, spirvCache, mtx, errorAtomic);
 
-				mutation.m_variantIndex = variants.getSize() - 1;
+					mutation.m_variantIndex = variants.getSize() - 1;
+				}
 
 				ANKI_ASSERT(mutationHashToIdx.find(mutation.m_hash) == mutationHashToIdx.getEnd());
 				mutationHashToIdx.emplace(mutation.m_hash, mutationCount - 1);
@@ -907,8 +1056,8 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 					variant = variants.emplaceBack();
 					baseVariant = (baseVariant == nullptr) ? variants.getBegin() : baseVariant;
 
-					compileVariantAsync(originalMutationValues, parser, *variant, codeBlocks, codeBlockHashes,
-										tempAllocator, binaryAllocator, taskManager, mtx, errorAtomic);
+					compileVariantAsync(originalMutationValues, parser, *variant, codeBlocks, codeBlockIndices,
+										tempAllocator, binaryAllocator, taskManager, spirvCache, mtx, errorAtomic);
 
 					ShaderProgramBinaryMutation& otherMutation = mutations[mutationCount++];
 					otherMutation.m_values.setArray(
@@ -922,6 +1071,18 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 
 					it = mutationHashToIdx.emplace(otherMutationHash, mutationCount - 1);
 				}
+				else if(mutations[*it].m_variantIndex == MAX_U32 && !skip)
+				{
+					// The rewritten mutation was skipped but this one is needed, create the variant
+
+					variant = variants.emplaceBack();
+					baseVariant = (baseVariant == nullptr) ? variants.getBegin() : baseVariant;
+
+					compileVariantAsync(originalMutationValues, parser, *variant, codeBlocks, codeBlockIndices,
+										tempAllocator, binaryAllocator, taskManager, spirvCache, mtx, errorAtomic);
+
+					mutations[*it].m_variantIndex = variants.getSize() - 1;
+				}
 
 				// Setup the new mutation
 				mutation.m_variantIndex = mutations[*it].m_variantIndex;
@@ -931,6 +1092,18 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 		} while(!spinDials(dials, parser.getMutators()));
 
 		ANKI_ASSERT(mutationCount == mutations.getSize());
+
+		// Always have one variant
+		if(variants.getSize() == 0)
+		{
+			ShaderProgramBinaryVariant& variant = *variants.emplaceBack();
+			baseVariant = variants.getBegin();
+
+			compileVariantAsync(mutations[0].m_values, parser, variant, codeBlocks, codeBlockIndices, tempAllocator,
+								binaryAllocator, taskManager, spirvCache, mtx, errorAtomic);
+
+			mutations[0].m_variantIndex = 0;
+		}
 		ANKI_ASSERT(baseVariant == variants.getBegin() && "Can't have the variants array grow");
 
 		// Done, wait the threads
@@ -955,12 +1128,12 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 	{
 		DynamicArrayAuto<MutatorValue> mutation(tempAllocator);
 		DynamicArrayAuto<ShaderProgramBinaryCodeBlock> codeBlocks(binaryAllocator);
-		DynamicArrayAuto<U64> codeBlockHashes(tempAllocator);
+		HashMapAuto<U64, U32> codeBlockIndices(tempAllocator);
 
 		binary.m_variants.setArray(binaryAllocator.newInstance<ShaderProgramBinaryVariant>(), 1);
 
-		compileVariantAsync(mutation, parser, binary.m_variants[0], codeBlocks, codeBlockHashes, tempAllocator,
-							binaryAllocator, taskManager, mtx, errorAtomic);
+		compileVariantAsync(mutation, parser, binary.m_variants[0], codeBlocks, codeBlockIndices, tempAllocator,
+							binaryAllocator, taskManager, spirvCache, mtx, errorAtomic);
 
 		ANKI_CHECK(taskManager.joinTasks());
 		ANKI_CHECK(Error(errorAtomic.getNonAtomically()));
@@ -1007,12 +1180,14 @@ Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterfa
 
 Error compileShaderProgram(CString fname, ShaderProgramFilesystemInterface& fsystem,
 						   ShaderProgramPostParseInterface* postParseCallback,
-						   ShaderProgramAsyncTaskInterface* taskManager, GenericMemoryPoolAllocator<U8> tempAllocator,
+						   ShaderProgramAsyncTaskInterface* taskManager, ShaderProgramSpirvCacheInterface* spirvCache,
+						   ShaderProgramIncludeCache* includeCache, GenericMemoryPoolAllocator<U8> tempAllocator,
 						   const GpuDeviceCapabilities& gpuCapabilities, const BindlessLimits& bindlessLimits,
 						   ShaderProgramBinaryWrapper& binaryW)
 {
-	const Error err = compileShaderProgramInternal(fname, fsystem, postParseCallback, taskManager, tempAllocator,
-												   gpuCapabilities, bindlessLimits, binaryW);
+	const Error err = compileShaderProgramInternal(fname, fsystem, postParseCallback, taskManager, spirvCache,
+												   includeCache, tempAllocator, gpuCapabilities, bindlessLimits,
+												   binaryW);
 	if(err)
 	{
 		ANKI_SHADER_COMPILER_LOGE("Failed to compile: %s", fname.cstr());
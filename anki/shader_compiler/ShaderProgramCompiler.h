@@ -6,6 +6,7 @@
 #pragma once
 
 #include <anki/shader_compiler/ShaderProgramDump.h>
+#include <anki/shader_compiler/ShaderProgramIncludeCache.h>
 #include <anki/util/String.h>
 #include <anki/gr/Common.h>
 
@@ -17,6 +18,16 @@ namespace anki
 
 extern const U32 SHADER_BINARY_VERSION;
 
+/// The optional stages that run on the code blocks after the compilation.
+/// @memberof ShaderProgramBinaryWrapper
+enum class ShaderProgramPostCompileFlag : U8
+{
+	NONE = 0,
+	STRIP_DEBUG_INFO = 1 << 0, ///< Remove the names, the source and the line info from the SPIR-V.
+	COMPRESS_CODE_BLOCKS = 1 << 1 ///< Compress the code blocks. They can be decompressed one by one.
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(ShaderProgramPostCompileFlag)
+
 /// A wrapper over the POD ShaderProgramBinary class.
 /// @memberof ShaderProgramCompiler
 class ShaderProgramBinaryWrapper : public NonCopyable
@@ -24,6 +35,8 @@ class ShaderProgramBinaryWrapper : public NonCopyable
 	friend Error compileShaderProgramInternal(CString fname, ShaderProgramFilesystemInterface& fsystem,
 											  ShaderProgramPostParseInterface* postParseCallback,
 											  ShaderProgramAsyncTaskInterface* taskManager,
+											  ShaderProgramSpirvCacheInterface* spirvCache,
+											  ShaderProgramIncludeCache* includeCache,
 											  GenericMemoryPoolAllocator<U8> tempAllocator,
 											  const GpuDeviceCapabilities& gpuCapabilities,
 											  const BindlessLimits& bindlessLimits, ShaderProgramBinaryWrapper& binary);
@@ -43,6 +56,9 @@ public:
 
 	ANKI_USE_RESULT Error deserializeFromFile(CString fname);
 
+	/// Run the post-compile stages on a binary that compileShaderProgram() created. Call it before serializeToFile().
+	ANKI_USE_RESULT Error postCompile(ShaderProgramPostCompileFlag flags);
+
 	const ShaderProgramBinary& getBinary() const
 	{
 		ANKI_ASSERT(m_binary);
@@ -58,12 +74,22 @@ private:
 };
 
 /// Takes an AnKi special shader program and spits a binary.
+/// @param spirvCache Optional cache for the SPIR-V of the shader stages.
+/// @param includeCache Optional cache for the files that the parser reads.
 ANKI_USE_RESULT Error compileShaderProgram(CString fname, ShaderProgramFilesystemInterface& fsystem,
 										   ShaderProgramPostParseInterface* postParseCallback,
 										   ShaderProgramAsyncTaskInterface* taskManager,
+										   ShaderProgramSpirvCacheInterface* spirvCache,
+										   ShaderProgramIncludeCache* includeCache,
 										   GenericMemoryPoolAllocator<U8> tempAllocator,
 										   const GpuDeviceCapabilities& gpuCapabilities,
 										   const BindlessLimits& bindlessLimits, ShaderProgramBinaryWrapper& binary);
+
+/// Get the SPIR-V of a code block.
+/// @param[out] storage If the block is compressed it will hold the decompressed SPIR-V.
+/// @param[out] spirv Points to the block or to the storage.
+ANKI_USE_RESULT Error getCodeBlockSpirv(const ShaderProgramBinaryCodeBlock& block, DynamicArrayAuto<U8>& storage,
+										ConstWeakArray<U8>& spirv);
 /// @}
 
 } // end namespace anki
@@ -4,6 +4,7 @@
 // http://www.anki3d.org/LICENSE
 
 #include <anki/shader_compiler/ShaderProgramDump.h>
+#include <anki/shader_compiler/ShaderProgramCompiler.h>
 #include <anki/util/Serializer.h>
 #include <anki/util/StringList.h>
 #include <SPIRV-Cross/spirv_glsl.hpp>
@@ -146,13 +147,21 @@ void dumpShaderProgramBinary(const ShaderProgramBinary& binary, StringAuto& huma
 	U32 count = 0;
 	for(const ShaderProgramBinaryCodeBlock& code : binary.m_codeBlocks)
 	{
+		DynamicArrayAuto<U8> storage(alloc);
+		ConstWeakArray<U8> spirv;
+		if(getCodeBlockSpirv(code, storage, spirv))
+		{
+			lines.pushBackSprintf(ANKI_TAB "#%u \n" ANKI_TAB ANKI_TAB "<corrupted>\n", count++);
+			continue;
+		}
+
 		spirv_cross::CompilerGLSL::Options options;
 		options.vulkan_semantics = true;
 		options.version = 460;
 
-		const unsigned int* spvb = reinterpret_cast<const unsigned int*>(code.m_binary.getBegin());
-		ANKI_ASSERT((code.m_binary.getSize() % (sizeof(unsigned int))) == 0);
-		std::vector<unsigned int> spv(spvb, spvb + code.m_binary.getSize() / sizeof(unsigned int));
+		const unsigned int* spvb = reinterpret_cast<const unsigned int*>(spirv.getBegin());
+		ANKI_ASSERT((spirv.getSize() % (sizeof(unsigned int))) == 0);
+		std::vector<unsigned int> spv(spvb, spvb + spirv.getSize() / sizeof(unsigned int));
 		spirv_cross::CompilerGLSL compiler(spv);
 		compiler.set_common_options(options);
 
@@ -0,0 +1,298 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/shader_compiler/ShaderProgramIncludeCache.h>
+#include <anki/util/Hash.h>
+
+namespace anki
+{
+
+static U64 computeTextHash(CString txt)
+{
+	return (txt.getLength()) ? computeHash(txt.cstr(), txt.getLength()) : 1;
+}
+
+ShaderProgramParserFile::~ShaderProgramParserFile()
+{
+	m_fname.destroy(m_alloc);
+	m_chars.destroy(m_alloc);
+	m_lines.destroy(m_alloc);
+	m_tokens.destroy(m_alloc);
+}
+
+Error ShaderProgramParserFile::load(CString fname, ShaderProgramFilesystemInterface& fsystem)
+{
+	ANKI_ASSERT(m_fname.isEmpty());
+	m_fname.create(m_alloc, fname);
+
+	StringAuto txt(m_alloc);
+	ANKI_CHECK(fsystem.readAllText(fname, txt));
+	const U32 length = U32(txt.getLength());
+	m_hash = computeTextHash(txt);
+
+	// The tokens of a line are never more than the line plus its terminator so the tokens fit in the second half
+	m_chars.create(m_alloc, (length + 1) * 2);
+	if(length)
+	{
+		memcpy(&m_chars[0], txt.cstr(), length);
+	}
+	m_chars[length] = '\0';
+	U32 tokenChars = length + 1;
+
+	// Split in lines and drop the empty ones
+	U32 lineBegin = 0;
+	for(U32 i = 0; i <= length; ++i)
+	{
+		if(m_chars[i] != '\n' && m_chars[i] != '\0')
+		{
+			continue;
+		}
+
+		m_chars[i] = '\0';
+		if(lineBegin == i)
+		{
+			++lineBegin;
+			continue;
+		}
+
+		Line& line = *m_lines.emplaceBack(m_alloc);
+		line.m_text = CString(&m_chars[lineBegin]);
+		line.m_firstToken = m_tokens.getSize();
+		lineBegin = i + 1;
+
+		// Tokenize only the lines that might have a directive that the parser cares about
+		if(line.m_text.find("pragma") == CString::NPOS && line.m_text.find("include") == CString::NPOS)
+		{
+			continue;
+		}
+
+		// Split on spaces and tabs
+		const char* it = line.m_text.getBegin();
+		const char* end = line.m_text.getEnd();
+		while(it != end)
+		{
+			while(it != end && (*it == ' ' || *it == '\t'))
+			{
+				++it;
+			}
+
+			const char* tokenBegin = it;
+			while(it != end && *it != ' ' && *it != '\t')
+			{
+				++it;
+			}
+
+			if(tokenBegin != it)
+			{
+				char* token = &m_chars[tokenChars];
+				memcpy(token, tokenBegin, PtrSize(it - tokenBegin));
+				token[it - tokenBegin] = '\0';
+				tokenChars += U32(it - tokenBegin) + 1;
+
+				m_tokens.emplaceBack(m_alloc, token);
+				++line.m_tokenCount;
+			}
+		}
+
+		ANKI_ASSERT(tokenChars <= m_chars.getSize());
+	}
+
+	return Error::NONE;
+}
+
+ShaderProgramIncludeCache::~ShaderProgramIncludeCache()
+{
+	for(ShaderProgramParserFile* file : m_files)
+	{
+		m_alloc.deleteInstance(file);
+	}
+	m_files.destroy(m_alloc);
+
+	for(ShaderProgramParserFile* file : m_retiredFiles)
+	{
+		m_alloc.deleteInstance(file);
+	}
+	m_retiredFiles.destroy(m_alloc);
+
+	for(Program* program : m_programs)
+	{
+		program->m_fname.destroy(m_alloc);
+		program->m_fileHashes.destroy(m_alloc);
+		m_alloc.deleteInstance(program);
+	}
+	m_programs.destroy(m_alloc);
+}
+
+Error ShaderProgramIncludeCache::getOrLoadFile(CString fname, ShaderProgramFilesystemInterface& fsystem,
+											   const ShaderProgramParserFile*& file)
+{
+	const U64 hash = fname.computeHash();
+
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		auto it = m_files.find(hash);
+		if(it != m_files.getEnd())
+		{
+			file = *it;
+			m_hitCount.fetchAdd(1);
+			return Error::NONE;
+		}
+	}
+
+	// Load it outside the lock so the other parsers can keep going
+	ShaderProgramParserFile* newFile = m_alloc.newInstance<ShaderProgramParserFile>(m_alloc);
+	const Error err = newFile->load(fname, fsystem);
+	if(err)
+	{
+		m_alloc.deleteInstance(newFile);
+		return err;
+	}
+
+	m_missCount.fetchAdd(1);
+
+	LockGuard<Mutex> lock(m_mtx);
+	auto it = m_files.find(hash);
+	if(it != m_files.getEnd())
+	{
+		// Another parser loaded it first
+		m_alloc.deleteInstance(newFile);
+		file = *it;
+	}
+	else
+	{
+		m_files.emplace(m_alloc, hash, newFile);
+		file = newFile;
+	}
+
+	return Error::NONE;
+}
+
+void ShaderProgramIncludeCache::setProgramDependencies(CString programFname, ConstWeakArray<U64> fileHashes)
+{
+	const U64 hash = programFname.computeHash();
+
+	LockGuard<Mutex> lock(m_mtx);
+
+	Program* program;
+	auto it = m_programs.find(hash);
+	if(it != m_programs.getEnd())
+	{
+		program = *it;
+		program->m_fileHashes.destroy(m_alloc);
+	}
+	else
+	{
+		program = m_alloc.newInstance<Program>();
+		program->m_fname.create(m_alloc, programFname);
+		m_programs.emplace(m_alloc, hash, program);
+	}
+
+	program->m_fileHashes.create(m_alloc, fileHashes.getSize());
+	if(fileHashes.getSize())
+	{
+		memcpy(&program->m_fileHashes[0], fileHashes.getBegin(), fileHashes.getSizeInBytes());
+	}
+}
+
+void ShaderProgramIncludeCache::invalidateInternal(U64 fnameHash)
+{
+	auto it = m_files.find(fnameHash);
+	if(it != m_files.getEnd())
+	{
+		m_retiredFiles.emplaceBack(m_alloc, *it);
+		m_files.erase(m_alloc, it);
+	}
+}
+
+void ShaderProgramIncludeCache::invalidate(CString fname)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	invalidateInternal(fname.computeHash());
+}
+
+void ShaderProgramIncludeCache::getDependentPrograms(CString fname, StringListAuto& programs) const
+{
+	const U64 hash = fname.computeHash();
+
+	LockGuard<Mutex> lock(m_mtx);
+	for(const Program* program : m_programs)
+	{
+		for(U64 fileHash : program->m_fileHashes)
+		{
+			if(fileHash == hash)
+			{
+				programs.pushBack(program->m_fname);
+				break;
+			}
+		}
+	}
+}
+
+void ShaderProgramIncludeCache::getFilenames(StringListAuto& fnames) const
+{
+	LockGuard<Mutex> lock(m_mtx);
+	for(const ShaderProgramParserFile* file : m_files)
+	{
+		fnames.pushBack(file->getFilename());
+	}
+}
+
+Error ShaderProgramIncludeCache::refresh(ShaderProgramFilesystemInterface& fsystem, StringListAuto& programs)
+{
+	// Copy the names and the hashes, the files are read without holding the lock
+	StringListAuto fnames(m_alloc);
+	DynamicArrayAuto<U64> textHashes(m_alloc);
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		for(const ShaderProgramParserFile* file : m_files)
+		{
+			fnames.pushBack(file->getFilename());
+			textHashes.emplaceBack(file->getHash());
+		}
+	}
+
+	HashMapAuto<U64, U64> changedFiles(m_alloc); // Used as a set, the value is the key
+	U32 count = 0;
+	for(const String& fname : fnames)
+	{
+		StringAuto txt(m_alloc);
+		const Bool changed = fsystem.readAllText(fname, txt) || computeTextHash(txt) != textHashes[count];
+		if(changed)
+		{
+			const U64 fnameHash = fname.toCString().computeHash();
+			changedFiles.emplace(fnameHash, fnameHash);
+		}
+
+		++count;
+	}
+
+	if(changedFiles.isEmpty())
+	{
+		return Error::NONE;
+	}
+
+	LockGuard<Mutex> lock(m_mtx);
+
+	for(U64 fnameHash : changedFiles)
+	{
+		invalidateInternal(fnameHash);
+	}
+
+	for(const Program* program : m_programs)
+	{
+		for(U64 fileHash : program->m_fileHashes)
+		{
+			if(changedFiles.find(fileHash) != changedFiles.getEnd())
+			{
+				programs.pushBack(program->m_fname);
+				break;
+			}
+		}
+	}
+
+	return Error::NONE;
+}
+
+} // end namespace anki
@@ -0,0 +1,140 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/shader_compiler/Common.h>
+#include <anki/util/StringList.h>
+#include <anki/util/HashMap.h>
+#include <anki/util/Thread.h>
+#include <anki/util/Atomic.h>
+
+namespace anki
+{
+
+/// @addtogroup shader_compiler
+/// @{
+
+/// A source file split in lines. The lines that might have a directive that the ShaderProgramParser cares about are
+/// tokenized as well. It's immutable after it's loaded so it can be shared by parsers that run in parallel.
+/// @memberof ShaderProgramIncludeCache
+class ShaderProgramParserFile : public NonCopyable
+{
+public:
+	class Line
+	{
+	public:
+		CString m_text;
+		U32 m_firstToken = 0;
+		U32 m_tokenCount = 0; ///< If zero the line has nothing for the parser.
+	};
+
+	ShaderProgramParserFile(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~ShaderProgramParserFile();
+
+	ANKI_USE_RESULT Error load(CString fname, ShaderProgramFilesystemInterface& fsystem);
+
+	CString getFilename() const
+	{
+		return m_fname;
+	}
+
+	ConstWeakArray<Line> getLines() const
+	{
+		return m_lines;
+	}
+
+	ConstWeakArray<CString> getTokens(const Line& line) const
+	{
+		return ConstWeakArray<CString>((line.m_tokenCount) ? &m_tokens[line.m_firstToken] : nullptr,
+									   line.m_tokenCount);
+	}
+
+	/// The hash of the text of the file.
+	U64 getHash() const
+	{
+		return m_hash;
+	}
+
+private:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	String m_fname;
+	DynamicArray<char> m_chars; ///< The lines and then the tokens. All of them are null terminated.
+	DynamicArray<Line> m_lines;
+	DynamicArray<CString> m_tokens;
+	U64 m_hash = 0;
+};
+
+/// A thread-safe cache of the files that the ShaderProgramParser reads. Without it every program reads and tokenizes
+/// the common headers again. It also keeps the files that every program includes so it can tell which programs need
+/// to be compiled again when a file changes.
+class ShaderProgramIncludeCache : public NonCopyable
+{
+	friend class ShaderProgramParser;
+
+public:
+	ShaderProgramIncludeCache(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~ShaderProgramIncludeCache();
+
+	/// Drop a file from the cache. The next parser that needs it will read it again.
+	void invalidate(CString fname);
+
+	/// Read all cached files again and drop the ones that changed.
+	/// @param[out] programs The programs that include the changed files, directly or not.
+	ANKI_USE_RESULT Error refresh(ShaderProgramFilesystemInterface& fsystem, StringListAuto& programs);
+
+	/// Get the programs that include a file, directly or not. A program depends on itself as well.
+	void getDependentPrograms(CString fname, StringListAuto& programs) const;
+
+	/// Get the names of all the cached files.
+	void getFilenames(StringListAuto& fnames) const;
+
+	U32 getHitCount() const
+	{
+		return m_hitCount.load();
+	}
+
+	U32 getMissCount() const
+	{
+		return m_missCount.load();
+	}
+
+private:
+	/// The files that a program read the last time it was parsed.
+	class Program
+	{
+	public:
+		String m_fname;
+		DynamicArray<U64> m_fileHashes; ///< The hashes of the filenames.
+	};
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	HashMap<U64, ShaderProgramParserFile*> m_files; ///< The key is the hash of the filename.
+	HashMap<U64, Program*> m_programs; ///< The key is the hash of the filename.
+	DynamicArray<ShaderProgramParserFile*> m_retiredFiles; ///< Invalidated files that some parser might still use.
+	mutable Mutex m_mtx;
+
+	Atomic<U32> m_hitCount = {0};
+	Atomic<U32> m_missCount = {0};
+
+	/// Get a file from the cache or load it.
+	ANKI_USE_RESULT Error getOrLoadFile(CString fname, ShaderProgramFilesystemInterface& fsystem,
+										const ShaderProgramParserFile*& file);
+
+	void setProgramDependencies(CString programFname, ConstWeakArray<U64> fileHashes);
+
+	void invalidateInternal(U64 fnameHash);
+};
+/// @}
+
+} // end namespace anki
@@ -246,10 +246,11 @@ static const U64 SHADER_HEADER_HASH = computeHash(SHADER_HEADER, sizeof(SHADER_H
 ShaderProgramParser::ShaderProgramParser(CString fname, ShaderProgramFilesystemInterface* fsystem,
 										 GenericMemoryPoolAllocator<U8> alloc,
 										 const GpuDeviceCapabilities& gpuCapabilities,
-										 const BindlessLimits& bindlessLimits)
+										 const BindlessLimits& bindlessLimits, ShaderProgramIncludeCache* includeCache)
 	: m_alloc(alloc)
 	, m_fname(alloc, fname)
 	, m_fsystem(fsystem)
+	, m_includeCache(includeCache)
 	, m_gpuCapabilities(gpuCapabilities)
 	, m_bindlessLimits(bindlessLimits)
 {
@@ -259,33 +260,7 @@ ShaderProgramParser::~ShaderProgramParser()
 {
 }
 
-void ShaderProgramParser::tokenizeLine(CString line, DynamicArrayAuto<StringAuto>& tokens) const
-{
-	ANKI_ASSERT(line.getLength() > 0);
-
-	StringAuto l(m_alloc, line);
-
-	// Replace all tabs with spaces
-	for(char& c : l)
-	{
-		if(c == '\t')
-		{
-			c = ' ';
-		}
-	}
-
-	// Split
-	StringListAuto spaceTokens(m_alloc);
-	spaceTokens.splitString(l, ' ', false);
-
-	// Create the array
-	for(const String& s : spaceTokens)
-	{
-		tokens.emplaceBack(m_alloc, s);
-	}
-}
-
-Error ShaderProgramParser::parsePragmaStart(const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+Error ShaderProgramParser::parsePragmaStart(const Token* begin, const Token* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -374,7 +349,7 @@ Error ShaderProgramParser::parsePragmaStart(const StringAuto* begin, const Strin
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parsePragmaEnd(const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+Error ShaderProgramParser::parsePragmaEnd(const Token* begin, const Token* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -397,7 +372,7 @@ Error ShaderProgramParser::parsePragmaEnd(const StringAuto* begin, const StringA
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parsePragmaMutator(const StringAuto* begin, const StringAuto* end, CString line,
+Error ShaderProgramParser::parsePragmaMutator(const Token* begin, const Token* end, CString line,
 											  CString fname)
 {
 	ANKI_ASSERT(begin && end);
@@ -432,7 +407,7 @@ Error ShaderProgramParser::parsePragmaMutator(const StringAuto* begin, const Str
 			ANKI_PP_ERROR_MALFORMED_MSG("Too big name");
 		}
 
-		mutator.m_name.create(begin->toCString());
+		mutator.m_name.create(*begin);
 		++begin;
 	}
 
@@ -443,7 +418,7 @@ Error ShaderProgramParser::parsePragmaMutator(const StringAuto* begin, const Str
 		{
 			MutatorValue value = 0;
 
-			if(tokenIsComment(begin->toCString()))
+			if(tokenIsComment(*begin))
 			{
 				break;
 			}
@@ -477,7 +452,7 @@ Error ShaderProgramParser::parsePragmaMutator(const StringAuto* begin, const Str
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parsePragmaLibraryName(const StringAuto* begin, const StringAuto* end, CString line,
+Error ShaderProgramParser::parsePragmaLibraryName(const Token* begin, const Token* end, CString line,
 												  CString fname)
 {
 	ANKI_ASSERT(begin && end);
@@ -497,7 +472,7 @@ Error ShaderProgramParser::parsePragmaLibraryName(const StringAuto* begin, const
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parsePragmaRayType(const StringAuto* begin, const StringAuto* end, CString line,
+Error ShaderProgramParser::parsePragmaRayType(const Token* begin, const Token* end, CString line,
 											  CString fname)
 {
 	ANKI_ASSERT(begin && end);
@@ -522,7 +497,7 @@ Error ShaderProgramParser::parsePragmaRayType(const StringAuto* begin, const Str
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parsePragmaRewriteMutation(const StringAuto* begin, const StringAuto* end, CString line,
+Error ShaderProgramParser::parsePragmaRewriteMutation(const Token* begin, const Token* end, CString line,
 													  CString fname)
 {
 	ANKI_ASSERT(begin && end);
@@ -663,7 +638,7 @@ Error ShaderProgramParser::parsePragmaRewriteMutation(const StringAuto* begin, c
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parseInclude(const StringAuto* begin, const StringAuto* end, CString line, CString fname,
+Error ShaderProgramParser::parseInclude(const Token* begin, const Token* end, CString line, CString fname,
 										U32 depth)
 {
 	// Gather the path
@@ -700,15 +675,13 @@ Error ShaderProgramParser::parseInclude(const StringAuto* begin, const StringAut
 	return Error::NONE;
 }
 
-Error ShaderProgramParser::parseLine(CString line, CString fname, Bool& foundPragmaOnce, U32 depth)
+Error ShaderProgramParser::parseLine(CString line, ConstWeakArray<Token> tokens, CString fname, Bool& foundPragmaOnce,
+									U32 depth)
 {
-	// Tokenize
-	DynamicArrayAuto<StringAuto> tokens(m_alloc);
-	tokenizeLine(line, tokens);
 	ANKI_ASSERT(tokens.getSize() > 0);
 
-	const StringAuto* token = tokens.getBegin();
-	const StringAuto* end = tokens.getEnd();
+	const Token* token = tokens.getBegin();
+	const Token* end = tokens.getEnd();
 
 	// Skip the hash
 	Bool foundAloneHash = false;
@@ -727,6 +700,10 @@ Error ShaderProgramParser::parseLine(CString line, CString fname, Bool& foundPra
 	{
 		// We may have a #pragma once or a #pragma anki or something else
 		++token;
+		if(token == end)
+		{
+			ANKI_PP_ERROR_MALFORMED();
+		}
 
 		if(*token == "once")
 		{
@@ -754,6 +731,10 @@ Error ShaderProgramParser::parseLine(CString line, CString fname, Bool& foundPra
 			// Must be a #pragma anki
 
 			++token;
+			if(token == end)
+			{
+				ANKI_PP_ERROR_MALFORMED();
+			}
 
 			if(*token == "mutator")
 			{
@@ -809,33 +790,46 @@ Error ShaderProgramParser::parseFile(CString fname, U32 depth)
 	if(depth > MAX_INCLUDE_DEPTH)
 	{
 		ANKI_SHADER_COMPILER_LOGE("The include depth is too high. Probably circular includance");
+		return Error::USER_DATA;
 	}
 
-	Bool foundPragmaOnce = false;
+	// Get the file split in lines. Without a cache it's loaded just for this parser
+	const ShaderProgramParserFile* file;
+	ShaderProgramParserFile localFile(m_alloc);
+	if(m_includeCache)
+	{
+		ANKI_CHECK(m_includeCache->getOrLoadFile(fname, *m_fsystem, file));
 
-	// Load file in lines
-	StringAuto txt(m_alloc);
-	ANKI_CHECK(m_fsystem->readAllText(fname, txt));
+		const U64 fnameHash = fname.computeHash();
+		if(std::find(m_fileHashes.getBegin(), m_fileHashes.getEnd(), fnameHash) == m_fileHashes.getEnd())
+		{
+			m_fileHashes.emplaceBack(fnameHash);
+		}
+	}
+	else
+	{
+		ANKI_CHECK(localFile.load(fname, *m_fsystem));
+		file = &localFile;
+	}
 
-	StringListAuto lines(m_alloc);
-	lines.splitString(txt.toCString(), '\n');
-	if(lines.getSize() < 1)
+	if(file->getLines().getSize() < 1)
 	{
 		ANKI_SHADER_COMPILER_LOGE("Source is empty");
 	}
 
 	// Parse lines
-	for(const String& line : lines)
+	Bool foundPragmaOnce = false;
+	for(const ShaderProgramParserFile::Line& line : file->getLines())
 	{
-		if(line.find("pragma") != CString::NPOS || line.find("include") != CString::NPOS)
+		if(line.m_tokenCount)
 		{
 			// Possibly a preprocessor directive we care
-			ANKI_CHECK(parseLine(line.toCString(), fname, foundPragmaOnce, depth));
+			ANKI_CHECK(parseLine(line.m_text, file->getTokens(line), fname, foundPragmaOnce, depth));
 		}
 		else
 		{
 			// Just append the line
-			m_codeLines.pushBack(line.toCString());
+			m_codeLines.pushBack(line.m_text);
 		}
 	}
 
@@ -858,6 +852,11 @@ Error ShaderProgramParser::parse()
 	// Parse recursively
 	ANKI_CHECK(parseFile(fname, 0));
 
+	if(m_includeCache)
+	{
+		m_includeCache->setProgramDependencies(fname, m_fileHashes);
+	}
+
 	// Checks
 	{
 		if(!!(m_shaderTypes & ShaderTypeBit::COMPUTE))
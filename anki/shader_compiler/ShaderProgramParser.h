@@ -5,7 +5,7 @@
 
 #pragma once
 
-#include <anki/shader_compiler/Common.h>
+#include <anki/shader_compiler/ShaderProgramIncludeCache.h>
 #include <anki/util/StringList.h>
 #include <anki/util/WeakArray.h>
 #include <anki/util/DynamicArray.h>
@@ -90,8 +90,10 @@ private:
 class ShaderProgramParser : public NonCopyable
 {
 public:
+	/// @param includeCache Optional cache of the files that can be shared by many parsers.
 	ShaderProgramParser(CString fname, ShaderProgramFilesystemInterface* fsystem, GenericMemoryPoolAllocator<U8> alloc,
-						const GpuDeviceCapabilities& gpuCapabilities, const BindlessLimits& bindlessLimits);
+						const GpuDeviceCapabilities& gpuCapabilities, const BindlessLimits& bindlessLimits,
+						ShaderProgramIncludeCache* includeCache = nullptr);
 
 	~ShaderProgramParser();
 
@@ -139,6 +141,9 @@ public:
 private:
 	using Mutator = ShaderProgramParserMutator;
 
+	/// The tokens point to the ShaderProgramParserFile.
+	using Token = CString;
+
 	class MutationRewrite
 	{
 	public:
@@ -169,6 +174,8 @@ private:
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	StringAuto m_fname;
 	ShaderProgramFilesystemInterface* m_fsystem = nullptr;
+	ShaderProgramIncludeCache* m_includeCache = nullptr;
+	DynamicArrayAuto<U64> m_fileHashes = {m_alloc}; ///< The hashes of the names of the files that were read.
 
 	StringListAuto m_codeLines = {m_alloc}; ///< The code.
 	StringAuto m_codeSource = {m_alloc};
@@ -186,22 +193,21 @@ private:
 	U32 m_rayType = MAX_U32;
 
 	ANKI_USE_RESULT Error parseFile(CString fname, U32 depth);
-	ANKI_USE_RESULT Error parseLine(CString line, CString fname, Bool& foundPragmaOnce, U32 depth);
-	ANKI_USE_RESULT Error parseInclude(const StringAuto* begin, const StringAuto* end, CString line, CString fname,
+	ANKI_USE_RESULT Error parseLine(CString line, ConstWeakArray<Token> tokens, CString fname, Bool& foundPragmaOnce,
+									U32 depth);
+	ANKI_USE_RESULT Error parseInclude(const Token* begin, const Token* end, CString line, CString fname,
 									   U32 depth);
-	ANKI_USE_RESULT Error parsePragmaMutator(const StringAuto* begin, const StringAuto* end, CString line,
+	ANKI_USE_RESULT Error parsePragmaMutator(const Token* begin, const Token* end, CString line,
 											 CString fname);
-	ANKI_USE_RESULT Error parsePragmaStart(const StringAuto* begin, const StringAuto* end, CString line, CString fname);
-	ANKI_USE_RESULT Error parsePragmaEnd(const StringAuto* begin, const StringAuto* end, CString line, CString fname);
-	ANKI_USE_RESULT Error parsePragmaRewriteMutation(const StringAuto* begin, const StringAuto* end, CString line,
+	ANKI_USE_RESULT Error parsePragmaStart(const Token* begin, const Token* end, CString line, CString fname);
+	ANKI_USE_RESULT Error parsePragmaEnd(const Token* begin, const Token* end, CString line, CString fname);
+	ANKI_USE_RESULT Error parsePragmaRewriteMutation(const Token* begin, const Token* end, CString line,
 													 CString fname);
-	ANKI_USE_RESULT Error parsePragmaLibraryName(const StringAuto* begin, const StringAuto* end, CString line,
+	ANKI_USE_RESULT Error parsePragmaLibraryName(const Token* begin, const Token* end, CString line,
 												 CString fname);
-	ANKI_USE_RESULT Error parsePragmaRayType(const StringAuto* begin, const StringAuto* end, CString line,
+	ANKI_USE_RESULT Error parsePragmaRayType(const Token* begin, const Token* end, CString line,
 											 CString fname);
 
-	void tokenizeLine(CString line, DynamicArrayAuto<StringAuto>& tokens) const;
-
 	static Bool tokenIsComment(CString token)
 	{
 		return token.getLength() >= 2 && token[0] == '/' && (token[1] == '/' || token[1] == '*');
@@ -0,0 +1,122 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/shader_compiler/ShaderProgramSpirvCache.h>
+#include <anki/util/File.h>
+#include <anki/util/Filesystem.h>
+#include <anki/util/Hash.h>
+#include <cinttypes>
+
+namespace anki
+{
+
+static const char* SPIRV_CACHE_MAGIC = "ANKISPV1";
+
+/// The header of every file of the cache. Two threads may store the same blob at the same time so the hash of the
+/// SPIR-V guards against reading a half written file.
+class SpirvCacheFileHeader
+{
+public:
+	Array<U8, 8> m_magic;
+	U32 m_spirvSize;
+	U32 m_padding;
+	U64 m_spirvHash;
+};
+
+ShaderProgramSpirvFileCache::~ShaderProgramSpirvFileCache()
+{
+	m_directory.destroy(m_alloc);
+}
+
+Error ShaderProgramSpirvFileCache::init(CString directory)
+{
+	ANKI_ASSERT(!directory.isEmpty());
+
+	if(!directoryExists(directory))
+	{
+		ANKI_CHECK(createDirectory(directory));
+	}
+
+	m_directory.create(m_alloc, directory);
+	return Error::NONE;
+}
+
+void ShaderProgramSpirvFileCache::getFilename(U64 key, StringAuto& filename) const
+{
+	filename.sprintf("%s/%016" PRIx64 ".spv", m_directory.cstr(), key);
+}
+
+Error ShaderProgramSpirvFileCache::load(U64 key, DynamicArrayAuto<U8>& spirv, Bool& found)
+{
+	found = false;
+
+	StringAuto filename(m_alloc);
+	getFilename(key, filename);
+
+	if(fileExists(filename))
+	{
+		File file;
+		ANKI_CHECK(file.open(filename, FileOpenFlag::READ | FileOpenFlag::BINARY));
+
+		SpirvCacheFileHeader header;
+		if(file.getSize() > sizeof(header))
+		{
+			ANKI_CHECK(file.read(&header, sizeof(header)));
+		}
+		else
+		{
+			memset(&header, 0, sizeof(header));
+		}
+
+		if(memcmp(&header.m_magic[0], SPIRV_CACHE_MAGIC, sizeof(header.m_magic)) == 0
+		   && header.m_spirvSize == file.getSize() - sizeof(header))
+		{
+			spirv.resize(header.m_spirvSize);
+			ANKI_CHECK(file.read(&spirv[0], header.m_spirvSize));
+
+			found = computeHash(&spirv[0], header.m_spirvSize) == header.m_spirvHash;
+		}
+
+		if(!found)
+		{
+			ANKI_SHADER_COMPILER_LOGW("Ignoring corrupted SPIR-V cache file: %s", filename.cstr());
+			spirv.destroy();
+		}
+	}
+
+	if(found)
+	{
+		m_hitCount.fetchAdd(1);
+	}
+	else
+	{
+		m_missCount.fetchAdd(1);
+	}
+
+	return Error::NONE;
+}
+
+Error ShaderProgramSpirvFileCache::store(U64 key, ConstWeakArray<U8> spirv)
+{
+	ANKI_ASSERT(spirv.getSize() > 0);
+
+	StringAuto filename(m_alloc);
+	getFilename(key, filename);
+
+	SpirvCacheFileHeader header;
+	memcpy(&header.m_magic[0], SPIRV_CACHE_MAGIC, sizeof(header.m_magic));
+	header.m_spirvSize = spirv.getSize();
+	header.m_padding = 0;
+	header.m_spirvHash = computeHash(&spirv[0], spirv.getSize());
+
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+	ANKI_CHECK(file.write(&header, sizeof(header)));
+	ANKI_CHECK(file.write(&spirv[0], spirv.getSize()));
+
+	return Error::NONE;
+}
+
+} // end namespace anki
@@ -0,0 +1,56 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/shader_compiler/Common.h>
+#include <anki/util/Atomic.h>
+
+namespace anki
+{
+
+/// @addtogroup shader_compiler
+/// @{
+
+/// A ShaderProgramSpirvCacheInterface that stores every SPIR-V blob in its own file in a directory. The files are named
+/// after the key so the same blob is stored once and shared by all programs.
+class ShaderProgramSpirvFileCache final : public ShaderProgramSpirvCacheInterface
+{
+public:
+	ShaderProgramSpirvFileCache(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~ShaderProgramSpirvFileCache();
+
+	/// @param directory Where to store the blobs. It will be created if it doesn't exist.
+	ANKI_USE_RESULT Error init(CString directory);
+
+	ANKI_USE_RESULT Error load(U64 key, DynamicArrayAuto<U8>& spirv, Bool& found) final;
+
+	ANKI_USE_RESULT Error store(U64 key, ConstWeakArray<U8> spirv) final;
+
+	U32 getHitCount() const
+	{
+		return m_hitCount.load();
+	}
+
+	U32 getMissCount() const
+	{
+		return m_missCount.load();
+	}
+
+private:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	String m_directory;
+	Atomic<U32> m_hitCount = {0};
+	Atomic<U32> m_missCount = {0};
+
+	void getFilename(U64 key, StringAuto& filename) const;
+};
+/// @}
+
+} // end namespace anki
@@ -63,6 +63,7 @@ const U32 TEXTURE_CHANNEL_AUX_2 = 7;
 
 const U32 TEXTURE_CHANNEL_COUNT = 8;
 
+/// The cooked material binaries have a raw copy of it. Bump MATERIAL_BINARY_GPU_DESCRIPTOR_VERSION when it changes.
 struct MaterialGpuDescriptor
 {
 	U16 m_bindlessTextureIndices[TEXTURE_CHANNEL_COUNT];
@@ -7,6 +7,7 @@
 
 #include <anki/util/Allocator.h>
 #include <anki/util/Functions.h>
+#include <anki/util/Array.h>
 
 namespace anki
 {
@@ -14,6 +15,8 @@ namespace anki
 // Forward
 template<typename T, typename TSize>
 class DynamicArrayAuto;
+template<typename T, U32 N, typename TSize>
+class DynamicArrayInline;
 
 /// @addtogroup util_containers
 /// @{
@@ -455,6 +458,232 @@ public:
 private:
 	GenericMemoryPoolAllocator<T> m_alloc;
 };
+
+/// Dynamic array with inline storage for N elements. It only touches the allocator when it outgrows that storage. Use
+/// it for temp arrays that are small most of the time. It holds the allocator and performs automatic destruction.
+/// @tparam T The type this array will hold.
+/// @tparam N The number of elements of the inline storage.
+/// @tparam TSize The type that denotes the maximum number of elements of the array.
+template<typename T, U32 N, typename TSize = U32>
+class DynamicArrayInline
+{
+public:
+	using Value = T;
+	using Iterator = Value*;
+	using ConstIterator = const Value*;
+	using Reference = Value&;
+	using ConstReference = const Value&;
+	using Size = TSize;
+
+	static constexpr F32 GROW_SCALE = 2.0f;
+
+	template<typename TAllocator>
+	DynamicArrayInline(TAllocator alloc)
+		: m_alloc(alloc)
+	{
+		static_assert(N > 0, "Wrong size");
+		m_data = reinterpret_cast<Value*>(&m_inlineStorage[0]);
+	}
+
+	/// And resize.
+	template<typename TAllocator>
+	DynamicArrayInline(TAllocator alloc, Size size)
+		: DynamicArrayInline(alloc)
+	{
+		resize(size);
+	}
+
+	/// Copy.
+	DynamicArrayInline(const DynamicArrayInline& b)
+		: DynamicArrayInline(b.m_alloc)
+	{
+		*this = b;
+	}
+
+	/// Move.
+	DynamicArrayInline(DynamicArrayInline&& b)
+		: DynamicArrayInline(b.m_alloc)
+	{
+		*this = std::move(b);
+	}
+
+	~DynamicArrayInline()
+	{
+		destroy();
+	}
+
+	/// Copy.
+	DynamicArrayInline& operator=(const DynamicArrayInline& b)
+	{
+		if(this != &b)
+		{
+			destroy();
+			reserve(b.m_size);
+			for(Size i = 0; i < b.m_size; ++i)
+			{
+				m_alloc.construct(&m_data[i], b.m_data[i]);
+			}
+			m_size = b.m_size;
+		}
+		return *this;
+	}
+
+	/// Move. It moves the elements one by one if the other array is inline.
+	DynamicArrayInline& operator=(DynamicArrayInline&& b);
+
+	Reference operator[](const Size n)
+	{
+		ANKI_ASSERT(n < m_size);
+		return m_data[n];
+	}
+
+	ConstReference operator[](const Size n) const
+	{
+		ANKI_ASSERT(n < m_size);
+		return m_data[n];
+	}
+
+	Iterator getBegin()
+	{
+		return m_data;
+	}
+
+	ConstIterator getBegin() const
+	{
+		return m_data;
+	}
+
+	Iterator getEnd()
+	{
+		return m_data + m_size;
+	}
+
+	ConstIterator getEnd() const
+	{
+		return m_data + m_size;
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	Iterator begin()
+	{
+		return getBegin();
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	ConstIterator begin() const
+	{
+		return getBegin();
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	Iterator end()
+	{
+		return getEnd();
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	ConstIterator end() const
+	{
+		return getEnd();
+	}
+
+	/// Get first element.
+	Reference getFront()
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[0];
+	}
+
+	/// Get first element.
+	ConstReference getFront() const
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[0];
+	}
+
+	/// Get last element.
+	Reference getBack()
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[m_size - 1];
+	}
+
+	/// Get last element.
+	ConstReference getBack() const
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[m_size - 1];
+	}
+
+	Size getSize() const
+	{
+		return m_size;
+	}
+
+	Size getCapacity() const
+	{
+		return m_capacity;
+	}
+
+	Bool isEmpty() const
+	{
+		return m_size == 0;
+	}
+
+	/// Return true if the elements still fit in the inline storage.
+	Bool isInline() const
+	{
+		return m_data == reinterpret_cast<const Value*>(&m_inlineStorage[0]);
+	}
+
+	PtrSize getSizeInBytes() const
+	{
+		return m_size * sizeof(Value);
+	}
+
+	/// Push back value.
+	template<typename... TArgs>
+	Iterator emplaceBack(TArgs&&... args)
+	{
+		reserve(m_size + 1);
+		m_alloc.construct(&m_data[m_size], std::forward<TArgs>(args)...);
+		++m_size;
+		return &m_data[m_size - 1];
+	}
+
+	/// Remove the last value.
+	void popBack()
+	{
+		ANKI_ASSERT(!isEmpty());
+		--m_size;
+		m_data[m_size].~T();
+	}
+
+	/// Grow or shrink the array. @a T needs to be default constructible.
+	void resize(Size size);
+
+	/// Grow or shrink the array. @a T needs to be copyable.
+	void resize(Size size, const Value& v);
+
+	/// Make room for some elements. It doesn't construct any.
+	void reserve(Size capacity);
+
+	/// Destroy the elements and free the allocated memory, if any.
+	void destroy();
+
+	/// Get the allocator.
+	const GenericMemoryPoolAllocator<T>& getAllocator() const
+	{
+		return m_alloc;
+	}
+
+private:
+	GenericMemoryPoolAllocator<T> m_alloc;
+	Value* m_data;
+	Size m_size = 0;
+	Size m_capacity = N;
+	alignas(T) Array<U8, sizeof(T) * N> m_inlineStorage;
+};
 /// @}
 
 } // end namespace anki
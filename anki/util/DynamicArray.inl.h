@@ -205,4 +205,123 @@ typename DynamicArray<T, TSize>::Iterator DynamicArray<T, TSize>::emplaceAt(TAll
 	return &m_data[outIdx];
 }
 
+template<typename T, U32 N, typename TSize>
+DynamicArrayInline<T, N, TSize>& DynamicArrayInline<T, N, TSize>::operator=(DynamicArrayInline&& b)
+{
+	if(this == &b)
+	{
+		return *this;
+	}
+
+	destroy();
+	m_alloc = b.m_alloc;
+
+	if(b.isInline())
+	{
+		for(Size i = 0; i < b.m_size; ++i)
+		{
+			m_alloc.construct(&m_data[i], std::move(b.m_data[i]));
+		}
+		m_size = b.m_size;
+		b.destroy();
+	}
+	else
+	{
+		m_data = b.m_data;
+		m_size = b.m_size;
+		m_capacity = b.m_capacity;
+
+		b.m_data = reinterpret_cast<Value*>(&b.m_inlineStorage[0]);
+		b.m_size = 0;
+		b.m_capacity = N;
+	}
+
+	return *this;
+}
+
+template<typename T, U32 N, typename TSize>
+void DynamicArrayInline<T, N, TSize>::reserve(Size capacity)
+{
+	if(capacity <= m_capacity)
+	{
+		return;
+	}
+
+	const Size newCapacity = max(capacity, Size(F32(m_capacity) * GROW_SCALE));
+	Value* newStorage =
+		static_cast<Value*>(m_alloc.getMemoryPool().allocate(newCapacity * sizeof(Value), alignof(Value)));
+	if(ANKI_UNLIKELY(newStorage == nullptr))
+	{
+		ANKI_UTIL_LOGF("Out of memory");
+	}
+
+	// Move old elements to the new storage
+	for(Size i = 0; i < m_size; ++i)
+	{
+		m_alloc.construct(&newStorage[i], std::move(m_data[i]));
+		m_data[i].~T();
+	}
+
+	if(!isInline())
+	{
+		m_alloc.getMemoryPool().free(m_data);
+	}
+
+	m_data = newStorage;
+	m_capacity = newCapacity;
+}
+
+template<typename T, U32 N, typename TSize>
+void DynamicArrayInline<T, N, TSize>::resize(Size size)
+{
+	reserve(size);
+
+	for(Size i = m_size; i < size; ++i)
+	{
+		m_alloc.construct(&m_data[i]);
+	}
+
+	for(Size i = size; i < m_size; ++i)
+	{
+		m_data[i].~T();
+	}
+
+	m_size = size;
+}
+
+template<typename T, U32 N, typename TSize>
+void DynamicArrayInline<T, N, TSize>::resize(Size size, const Value& v)
+{
+	reserve(size);
+
+	for(Size i = m_size; i < size; ++i)
+	{
+		m_alloc.construct(&m_data[i], v);
+	}
+
+	for(Size i = size; i < m_size; ++i)
+	{
+		m_data[i].~T();
+	}
+
+	m_size = size;
+}
+
+template<typename T, U32 N, typename TSize>
+void DynamicArrayInline<T, N, TSize>::destroy()
+{
+	for(Size i = 0; i < m_size; ++i)
+	{
+		m_data[i].~T();
+	}
+	m_size = 0;
+
+	if(!isInline())
+	{
+		m_alloc.getMemoryPool().free(m_data);
+		m_data = reinterpret_cast<Value*>(&m_inlineStorage[0]);
+		m_capacity = N;
+	}
+}
+
 } // end namespace anki
@@ -0,0 +1,536 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/HashMap.h>
+#include <anki/util/WeakArray.h>
+#if ANKI_SIMD_SSE
+#	include <emmintrin.h>
+#endif
+#if ANKI_COMPILER_MSVC
+#	include <intrin.h>
+#endif
+
+namespace anki
+{
+
+/// @addtogroup util_containers
+/// @{
+
+namespace detail
+{
+
+/// The control bytes of a FlatHashMap. Every slot has one. It's EMPTY or 7 bits of the hash of the key. The map
+/// compares GROUP_SIZE of them at once.
+class FlatHashMapControl
+{
+public:
+	static constexpr U32 GROUP_SIZE = 16;
+	static constexpr U8 EMPTY = 0x80;
+
+	/// Get a bit for every byte of the group that is equal to @a h2.
+	static U32 match(const U8* group, U8 h2)
+	{
+#if ANKI_SIMD_SSE
+		const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return U32(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(I8(h2)))));
+#else
+		U32 mask = 0;
+		for(U32 i = 0; i < GROUP_SIZE; ++i)
+		{
+			mask |= U32(group[i] == h2) << i;
+		}
+		return mask;
+#endif
+	}
+
+	/// Get a bit for every empty byte of the group.
+	static U32 matchEmpty(const U8* group)
+	{
+#if ANKI_SIMD_SSE
+		const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return U32(_mm_movemask_epi8(ctrl));
+#else
+		U32 mask = 0;
+		for(U32 i = 0; i < GROUP_SIZE; ++i)
+		{
+			mask |= U32(group[i] >> 7u) << i;
+		}
+		return mask;
+#endif
+	}
+
+	/// Index of the lowest set bit. The mask shouldn't be zero.
+	static U32 getFirstSetBit(U32 mask)
+	{
+		ANKI_ASSERT(mask != 0);
+#if ANKI_COMPILER_MSVC
+		unsigned long idx;
+		_BitScanForward(&idx, mask);
+		return U32(idx);
+#else
+		return U32(__builtin_ctz(mask));
+#endif
+	}
+};
+
+} // end namespace detail
+
+/// FlatHashMap iterator.
+template<typename TValuePointer, typename TValueReference, typename TKeyReference, typename TMapPointer>
+class FlatHashMapIterator
+{
+	template<typename, typename, typename>
+	friend class FlatHashMap;
+
+	template<typename, typename, typename, typename>
+	friend class FlatHashMapIterator;
+
+public:
+	FlatHashMapIterator() = default;
+
+	/// Allow conversion from iterator to const iterator.
+	template<typename YValuePointer, typename YValueReference, typename YKeyReference, typename YMapPointer>
+	FlatHashMapIterator(const FlatHashMapIterator<YValuePointer, YValueReference, YKeyReference, YMapPointer>& b)
+		: m_map(b.m_map)
+		, m_slotIdx(b.m_slotIdx)
+	{
+	}
+
+	FlatHashMapIterator(TMapPointer map, U32 slotIdx)
+		: m_map(map)
+		, m_slotIdx(slotIdx)
+	{
+	}
+
+	TValueReference operator*() const
+	{
+		check();
+		return m_map->m_slots[m_slotIdx].m_value;
+	}
+
+	TValuePointer operator->() const
+	{
+		check();
+		return &m_map->m_slots[m_slotIdx].m_value;
+	}
+
+	TKeyReference getKey() const
+	{
+		check();
+		return m_map->m_slots[m_slotIdx].m_key;
+	}
+
+	FlatHashMapIterator& operator++()
+	{
+		check();
+		m_slotIdx = m_map->findAlive(m_slotIdx + 1);
+		return *this;
+	}
+
+	FlatHashMapIterator operator++(int)
+	{
+		FlatHashMapIterator out = *this;
+		++(*this);
+		return out;
+	}
+
+	Bool operator==(const FlatHashMapIterator& b) const
+	{
+		ANKI_ASSERT(m_map == b.m_map);
+		return m_slotIdx == b.m_slotIdx;
+	}
+
+	Bool operator!=(const FlatHashMapIterator& b) const
+	{
+		return !(*this == b);
+	}
+
+private:
+	TMapPointer m_map = nullptr;
+	U32 m_slotIdx = MAX_U32;
+
+	void check() const
+	{
+		ANKI_ASSERT(m_map && m_slotIdx < m_map->m_capacity);
+		ANKI_ASSERT(m_map->m_ctrl[m_slotIdx] != detail::FlatHashMapControl::EMPTY);
+	}
+};
+
+/// An open addressing hash map that keeps the keys and the values in a single flat array. Next to it there is an array
+/// of control bytes, one per slot, that holds 7 bits of the hash. Lookups compare 16 control bytes at once (SSE2 or a
+/// scalar fallback) and touch the slots only on a probable hit. It uses linear probing and erase shifts the following
+/// elements back so there are no tombstones and lookups don't get slower after many erases.
+/// @note Unlike HashMap it stores and compares the keys. Erase and emplace invalidate the iterators.
+template<typename TKey, typename TValue, typename THasher = DefaultHasher<TKey>>
+class FlatHashMap
+{
+	template<typename, typename, typename, typename>
+	friend class FlatHashMapIterator;
+
+public:
+	using Key = TKey;
+	using Value = TValue;
+	using Hasher = THasher;
+	using Iterator = FlatHashMapIterator<TValue*, TValue&, const TKey&, FlatHashMap*>;
+	using ConstIterator = FlatHashMapIterator<const TValue*, const TValue&, const TKey&, const FlatHashMap*>;
+
+	static constexpr U32 MIN_CAPACITY = detail::FlatHashMapControl::GROUP_SIZE;
+
+	/// The map grows when the elements exceed that fraction of the capacity.
+	static constexpr F32 MAX_LOAD_FACTOR = 0.75f;
+
+	FlatHashMap() = default;
+
+	/// Move.
+	FlatHashMap(FlatHashMap&& b)
+	{
+		*this = std::move(b);
+	}
+
+	/// You need to manually destroy the map.
+	/// @see FlatHashMap::destroy
+	~FlatHashMap()
+	{
+		ANKI_ASSERT(m_slots == nullptr && "Forgot to destroy");
+	}
+
+	/// Move.
+	FlatHashMap& operator=(FlatHashMap&& b)
+	{
+		ANKI_ASSERT(m_slots == nullptr && "Forgot to destroy");
+		m_slots = b.m_slots;
+		m_ctrl = b.m_ctrl;
+		m_capacity = b.m_capacity;
+		m_elementCount = b.m_elementCount;
+		m_shift = b.m_shift;
+		b.resetMembers();
+		return *this;
+	}
+
+	Iterator getBegin()
+	{
+		return Iterator(this, findAlive(0));
+	}
+
+	ConstIterator getBegin() const
+	{
+		return ConstIterator(this, findAlive(0));
+	}
+
+	Iterator getEnd()
+	{
+		return Iterator(this, MAX_U32);
+	}
+
+	ConstIterator getEnd() const
+	{
+		return ConstIterator(this, MAX_U32);
+	}
+
+	Iterator begin()
+	{
+		return getBegin();
+	}
+
+	ConstIterator begin() const
+	{
+		return getBegin();
+	}
+
+	Iterator end()
+	{
+		return getEnd();
+	}
+
+	ConstIterator end() const
+	{
+		return getEnd();
+	}
+
+	Bool isEmpty() const
+	{
+		return m_elementCount == 0;
+	}
+
+	U32 getSize() const
+	{
+		return m_elementCount;
+	}
+
+	U32 getCapacity() const
+	{
+		return m_capacity;
+	}
+
+	/// Destroy the map.
+	template<typename TAllocator>
+	void destroy(TAllocator alloc)
+	{
+		destroyElements();
+		if(m_slots)
+		{
+			alloc.getMemoryPool().free(m_slots);
+		}
+		resetMembers();
+	}
+
+	/// Make room for some elements.
+	template<typename TAllocator>
+	void reserve(TAllocator alloc, U32 elementCount)
+	{
+		const U32 capacity = computeCapacity(elementCount);
+		if(capacity > m_capacity)
+		{
+			rehash(alloc, capacity);
+		}
+	}
+
+	/// Construct an element inside the map. The key shouldn't be in the map already.
+	template<typename TAllocator, typename... TArgs>
+	Iterator emplace(TAllocator alloc, const TKey& key, TArgs&&... args)
+	{
+		if(F32(m_elementCount + 1) > F32(m_capacity) * MAX_LOAD_FACTOR)
+		{
+			rehash(alloc, max(MIN_CAPACITY, m_capacity * 2));
+		}
+
+		return Iterator(this, insert(key, std::forward<TArgs>(args)...));
+	}
+
+	/// Erase an element. It invalidates the iterators.
+	template<typename TAllocator>
+	void erase(TAllocator alloc, Iterator it)
+	{
+		(void)alloc;
+		eraseInternal(it);
+	}
+
+	/// Find a value using a key.
+	Iterator find(const TKey& key)
+	{
+		return Iterator(this, findInternal(key));
+	}
+
+	/// Find a value using a key.
+	ConstIterator find(const TKey& key) const
+	{
+		return ConstIterator(this, findInternal(key));
+	}
+
+protected:
+	class Slot
+	{
+	public:
+		TKey m_key;
+		TValue m_value;
+
+		template<typename... TArgs>
+		Slot(const TKey& key, TArgs&&... args)
+			: m_key(key)
+			, m_value(std::forward<TArgs>(args)...)
+		{
+		}
+	};
+
+	Slot* m_slots = nullptr;
+	U8* m_ctrl = nullptr; ///< m_capacity + GROUP_SIZE bytes. The last bytes mirror the first ones.
+	U32 m_capacity = 0; ///< Power of 2.
+	U32 m_elementCount = 0;
+	U32 m_shift = 64; ///< Shift of the mixed hash to get the home slot.
+
+	void resetMembers()
+	{
+		m_slots = nullptr;
+		m_ctrl = nullptr;
+		m_capacity = 0;
+		m_elementCount = 0;
+		m_shift = 64;
+	}
+
+	/// The memory that holds the slots and the control bytes of some capacity.
+	static PtrSize computeStorageSize(U32 capacity)
+	{
+		return getAlignedRoundUp(alignof(Slot), sizeof(Slot) * capacity)
+			   + capacity + detail::FlatHashMapControl::GROUP_SIZE;
+	}
+
+	/// The capacity that can hold some elements.
+	static U32 computeCapacity(U32 elementCount)
+	{
+		U32 capacity = MIN_CAPACITY;
+		while(F32(elementCount) > F32(capacity) * MAX_LOAD_FACTOR)
+		{
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	/// Use some memory as storage. The map should be empty.
+	void setStorage(void* mem, U32 capacity);
+
+	template<typename TAllocator>
+	void rehash(TAllocator& alloc, U32 newCapacity);
+
+	template<typename... TArgs>
+	U32 insert(const TKey& key, TArgs&&... args);
+
+	void eraseInternal(Iterator it);
+
+	U32 findInternal(const TKey& key) const;
+
+	void destroyElements();
+
+	/// Get the first alive slot starting from @a slotIdx. MAX_U32 if there is none.
+	U32 findAlive(U32 slotIdx) const
+	{
+		while(slotIdx < m_capacity && m_ctrl[slotIdx] == detail::FlatHashMapControl::EMPTY)
+		{
+			++slotIdx;
+		}
+
+		return (slotIdx < m_capacity) ? slotIdx : MAX_U32;
+	}
+
+	/// Spread the bits of the hash. Many hashers return the key itself.
+	static U64 mixHash(const TKey& key)
+	{
+		return THasher()(key) * 0x9E3779B97F4A7C15ull;
+	}
+
+	U32 computeHomeSlot(U64 mixedHash) const
+	{
+		return U32(mixedHash >> U64(m_shift));
+	}
+
+	static U8 computeH2(U64 mixedHash)
+	{
+		return U8(mixedHash & 0x7Fu);
+	}
+
+	void setControl(U32 slotIdx, U8 ctrl)
+	{
+		m_ctrl[slotIdx] = ctrl;
+		if(slotIdx < detail::FlatHashMapControl::GROUP_SIZE - 1)
+		{
+			m_ctrl[m_capacity + slotIdx] = ctrl;
+		}
+	}
+};
+
+/// FlatHashMap with automatic cleanup.
+template<typename TKey, typename TValue, typename THasher = DefaultHasher<TKey>>
+class FlatHashMapAuto : public FlatHashMap<TKey, TValue, THasher>
+{
+public:
+	using Base = FlatHashMap<TKey, TValue, THasher>;
+
+	FlatHashMapAuto(const GenericMemoryPoolAllocator<U8>& alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	/// Move.
+	FlatHashMapAuto(FlatHashMapAuto&& b)
+		: Base(std::move(b))
+		, m_alloc(b.m_alloc)
+	{
+	}
+
+	~FlatHashMapAuto()
+	{
+		destroy();
+	}
+
+	/// Move.
+	FlatHashMapAuto& operator=(FlatHashMapAuto&& b)
+	{
+		destroy();
+		Base::operator=(std::move(b));
+		m_alloc = b.m_alloc;
+		return *this;
+	}
+
+	/// Construct an element inside the map.
+	template<typename... TArgs>
+	typename Base::Iterator emplace(const TKey& key, TArgs&&... args)
+	{
+		return Base::emplace(m_alloc, key, std::forward<TArgs>(args)...);
+	}
+
+	/// Erase an element.
+	void erase(typename Base::Iterator it)
+	{
+		Base::erase(m_alloc, it);
+	}
+
+	void reserve(U32 elementCount)
+	{
+		Base::reserve(m_alloc, elementCount);
+	}
+
+	/// Clean up the map.
+	void destroy()
+	{
+		Base::destroy(m_alloc);
+	}
+
+private:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+};
+
+/// A FlatHashMap that lives in memory the caller gives, a frame arena for example. It never grows and it never frees
+/// the memory. Use computeMemorySize() to know how much memory some elements need.
+template<typename TKey, typename TValue, typename THasher = DefaultHasher<TKey>>
+class FlatHashMapFixed : public FlatHashMap<TKey, TValue, THasher>
+{
+public:
+	using Base = FlatHashMap<TKey, TValue, THasher>;
+
+	/// @param memory Should be at least computeMemorySize(maxElementCount) bytes and aligned to alignof(TKey) and
+	///               alignof(TValue).
+	/// @param maxElementCount The max number of elements the map will hold.
+	FlatHashMapFixed(void* memory, U32 maxElementCount)
+	{
+		Base::setStorage(memory, Base::computeCapacity(maxElementCount));
+	}
+
+	/// It only calls the destructors of the elements.
+	~FlatHashMapFixed()
+	{
+		Base::destroyElements();
+		Base::resetMembers();
+	}
+
+	/// The memory that some elements need.
+	static PtrSize computeMemorySize(U32 maxElementCount)
+	{
+		return Base::computeStorageSize(Base::computeCapacity(maxElementCount));
+	}
+
+	/// Construct an element inside the map. Returns end() if the map is full.
+	template<typename... TArgs>
+	typename Base::Iterator emplace(const TKey& key, TArgs&&... args)
+	{
+		if(F32(Base::m_elementCount + 1) > F32(Base::m_capacity) * Base::MAX_LOAD_FACTOR)
+		{
+			return Base::getEnd();
+		}
+
+		return typename Base::Iterator(this, Base::insert(key, std::forward<TArgs>(args)...));
+	}
+
+	/// Erase an element.
+	void erase(typename Base::Iterator it)
+	{
+		Base::eraseInternal(it);
+	}
+};
+/// @}
+
+} // end namespace anki
+
+#include <anki/util/FlatHashMap.inl.h>
@@ -0,0 +1,184 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/FlatHashMap.h>
+
+namespace anki
+{
+
+template<typename TKey, typename TValue, typename THasher>
+void FlatHashMap<TKey, TValue, THasher>::setStorage(void* mem, U32 capacity)
+{
+	ANKI_ASSERT(mem && isAligned(alignof(Slot), mem));
+	ANKI_ASSERT(isPowerOfTwo(capacity) && capacity >= MIN_CAPACITY);
+	ANKI_ASSERT(m_elementCount == 0);
+
+	m_slots = static_cast<Slot*>(mem);
+	m_ctrl = static_cast<U8*>(mem) + getAlignedRoundUp(alignof(Slot), sizeof(Slot) * capacity);
+	m_capacity = capacity;
+	m_shift = 64 - detail::FlatHashMapControl::getFirstSetBit(capacity);
+	memset(m_ctrl, detail::FlatHashMapControl::EMPTY, capacity + detail::FlatHashMapControl::GROUP_SIZE);
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+void FlatHashMap<TKey, TValue, THasher>::rehash(TAllocator& alloc, U32 newCapacity)
+{
+	ANKI_ASSERT(newCapacity > m_capacity);
+
+	void* mem = alloc.getMemoryPool().allocate(computeStorageSize(newCapacity), alignof(Slot));
+	if(ANKI_UNLIKELY(mem == nullptr))
+	{
+		ANKI_UTIL_LOGF("Out of memory");
+	}
+
+	Slot* oldSlots = m_slots;
+	const U8* oldCtrl = m_ctrl;
+	const U32 oldCapacity = m_capacity;
+
+	m_elementCount = 0;
+	setStorage(mem, newCapacity);
+
+	for(U32 i = 0; i < oldCapacity; ++i)
+	{
+		if(oldCtrl[i] != detail::FlatHashMapControl::EMPTY)
+		{
+			Slot& slot = oldSlots[i];
+			insert(slot.m_key, std::move(slot.m_value));
+			slot.~Slot();
+		}
+	}
+
+	if(oldSlots)
+	{
+		alloc.getMemoryPool().free(oldSlots);
+	}
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename... TArgs>
+U32 FlatHashMap<TKey, TValue, THasher>::insert(const TKey& key, TArgs&&... args)
+{
+	ANKI_ASSERT(m_elementCount < m_capacity);
+	ANKI_ASSERT(findInternal(key) == MAX_U32 && "Key already in the map");
+
+	const U64 hash = mixHash(key);
+	const U32 mask = m_capacity - 1;
+	U32 groupIdx = computeHomeSlot(hash);
+	U32 slotIdx;
+	while(true)
+	{
+		const U32 emptyMask = detail::FlatHashMapControl::matchEmpty(&m_ctrl[groupIdx]);
+		if(emptyMask)
+		{
+			slotIdx = (groupIdx + detail::FlatHashMapControl::getFirstSetBit(emptyMask)) & mask;
+			break;
+		}
+
+		groupIdx = (groupIdx + detail::FlatHashMapControl::GROUP_SIZE) & mask;
+	}
+
+	::new(&m_slots[slotIdx]) Slot(key, std::forward<TArgs>(args)...);
+	setControl(slotIdx, computeH2(hash));
+	++m_elementCount;
+	return slotIdx;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+U32 FlatHashMap<TKey, TValue, THasher>::findInternal(const TKey& key) const
+{
+	if(m_elementCount == 0)
+	{
+		return MAX_U32;
+	}
+
+	const U64 hash = mixHash(key);
+	const U8 h2 = computeH2(hash);
+	const U32 mask = m_capacity - 1;
+	U32 groupIdx = computeHomeSlot(hash);
+	while(true)
+	{
+		const U32 emptyMask = detail::FlatHashMapControl::matchEmpty(&m_ctrl[groupIdx]);
+		U32 matchMask = detail::FlatHashMapControl::match(&m_ctrl[groupIdx], h2);
+
+		// The elements are contiguous from their home slot so ignore anything after the first empty slot
+		if(emptyMask)
+		{
+			matchMask &= (emptyMask & (~emptyMask + 1)) - 1;
+		}
+
+		while(matchMask)
+		{
+			const U32 slotIdx = (groupIdx + detail::FlatHashMapControl::getFirstSetBit(matchMask)) & mask;
+			if(m_slots[slotIdx].m_key == key)
+			{
+				return slotIdx;
+			}
+
+			matchMask &= matchMask - 1;
+		}
+
+		if(emptyMask)
+		{
+			return MAX_U32;
+		}
+
+		groupIdx = (groupIdx + detail::FlatHashMapControl::GROUP_SIZE) & mask;
+	}
+}
+
+template<typename TKey, typename TValue, typename THasher>
+void FlatHashMap<TKey, TValue, THasher>::eraseInternal(Iterator it)
+{
+	ANKI_ASSERT(it.m_map == this);
+	it.check();
+
+	const U32 mask = m_capacity - 1;
+	U32 holeIdx = it.m_slotIdx;
+	m_slots[holeIdx].~Slot();
+
+	// Shift back the elements that follow the hole and aren't in their home slot
+	U32 slotIdx = holeIdx;
+	while(true)
+	{
+		slotIdx = (slotIdx + 1) & mask;
+		if(m_ctrl[slotIdx] == detail::FlatHashMapControl::EMPTY)
+		{
+			break;
+		}
+
+		// Move the element if its home slot is not cyclically in (holeIdx, slotIdx]
+		const U32 homeIdx = computeHomeSlot(mixHash(m_slots[slotIdx].m_key));
+		const Bool stays = (holeIdx <= slotIdx) ? (holeIdx < homeIdx && homeIdx <= slotIdx)
+												: (holeIdx < homeIdx || homeIdx <= slotIdx);
+		if(!stays)
+		{
+			::new(&m_slots[holeIdx]) Slot(std::move(m_slots[slotIdx]));
+			m_slots[slotIdx].~Slot();
+			setControl(holeIdx, m_ctrl[slotIdx]);
+			holeIdx = slotIdx;
+		}
+	}
+
+	setControl(holeIdx, detail::FlatHashMapControl::EMPTY);
+	--m_elementCount;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+void FlatHashMap<TKey, TValue, THasher>::destroyElements()
+{
+	for(U32 i = 0; i < m_capacity && m_elementCount > 0; ++i)
+	{
+		if(m_ctrl[i] != detail::FlatHashMapControl::EMPTY)
+		{
+			m_slots[i].~Slot();
+			--m_elementCount;
+		}
+	}
+
+	ANKI_ASSERT(m_elementCount == 0);
+}
+
+} // end namespace anki
@@ -16,6 +16,9 @@
 #include <cstring>
 #include <algorithm>
 #include <functional>
+#if ANKI_COMPILER_MSVC
+#	include <intrin.h>
+#endif
 
 namespace anki
 {
@@ -174,6 +177,19 @@ inline constexpr Int nextPowerOfTwo(Int x)
 	return Int(res);
 }
 
+/// Count the zero bits after the least significant set bit. The number shouldn't be zero.
+inline U32 countTrailingZeros(U64 x)
+{
+	ANKI_ASSERT(x != 0);
+#if ANKI_COMPILER_MSVC
+	unsigned long idx;
+	_BitScanForward64(&idx, x);
+	return U32(idx);
+#else
+	return U32(__builtin_ctzll(x));
+#endif
+}
+
 /// Get the aligned number rounded up.
 /// @param alignment The bytes of alignment
 /// @param value The value to align
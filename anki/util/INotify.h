@@ -6,6 +6,9 @@
 #pragma once
 
 #include <anki/util/String.h>
+#include <anki/util/StringList.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/HashMap.h>
 
 namespace anki
 {
@@ -13,7 +16,7 @@ namespace anki
 /// @addtogroup util_file
 /// @{
 
-/// A wrapper on top of inotify. Check for filesystem updates.
+/// A wrapper on top of inotify. Check for filesystem updates. It can watch many paths with a single inotify instance.
 class INotify
 {
 public:
@@ -25,33 +28,62 @@ public:
 	~INotify()
 	{
 		destroyInternal();
-		m_path.destroy(m_alloc);
+
+		for(String& path : m_paths)
+		{
+			path.destroy(m_alloc);
+		}
+		m_paths.destroy(m_alloc);
 	}
 
 	// Non-copyable
 	INotify& operator=(const INotify&) = delete;
 
-	/// @param path Path to file or directory.
-	ANKI_USE_RESULT Error init(GenericMemoryPoolAllocator<U8> alloc, CString path)
+	/// Initialize without a path. Use addPath() to watch something.
+	ANKI_USE_RESULT Error init(GenericMemoryPoolAllocator<U8> alloc)
 	{
 		m_alloc = alloc;
-		m_path.create(alloc, path);
 		return initInternal();
 	}
 
-	/// Check if the file was modified in any way.
-	ANKI_USE_RESULT Error pollEvents(Bool& modified);
+	/// @param path Path to file or directory.
+	ANKI_USE_RESULT Error init(GenericMemoryPoolAllocator<U8> alloc, CString path)
+	{
+		ANKI_CHECK(init(alloc));
+		U32 pathIdx;
+		return addPath(path, pathIdx);
+	}
+
+	/// Watch one more file or directory.
+	/// @param path Path to file or directory.
+	/// @param[out] pathIdx The index of the path. See pollEvents().
+	ANKI_USE_RESULT Error addPath(CString path, U32& pathIdx)
+	{
+		pathIdx = m_paths.getSize();
+		m_paths.emplaceBack(m_alloc);
+		m_paths.getBack().create(m_alloc, path);
+		return addPathInternal(pathIdx);
+	}
+
+	/// Check if any of the paths was modified in any way.
+	/// @param[out] modifiedFilenames Optional. If a path is a directory get the names of the files inside it that
+	///                               were modified. They are relative to the directory.
+	/// @param[out] modifiedFilenamePaths Optional. The index of the path of each of the modifiedFilenames.
+	ANKI_USE_RESULT Error pollEvents(Bool& modified, StringListAuto* modifiedFilenames = nullptr,
+									 DynamicArrayAuto<U32>* modifiedFilenamePaths = nullptr);
 
 private:
 	GenericMemoryPoolAllocator<U8> m_alloc;
-	String m_path;
+	DynamicArray<String> m_paths;
 #if ANKI_OS_LINUX
 	int m_fd = -1;
-	int m_watch = -1;
+	DynamicArray<int> m_watches; ///< The watch descriptor of each path. -1 if the path is not watched.
+	HashMap<U32, U32> m_watchPaths; ///< Map a watch descriptor to the index of its path.
 #endif
 
 	void destroyInternal();
 	ANKI_USE_RESULT Error initInternal();
+	ANKI_USE_RESULT Error addPathInternal(U32 pathIdx);
 };
 /// @}
 
@@ -14,46 +14,71 @@ namespace anki
 
 Error INotify::initInternal()
 {
-	ANKI_ASSERT(m_fd < 0 && m_watch < 0);
-
-	Error err = Error::NONE;
+	ANKI_ASSERT(m_fd < 0);
 
 	m_fd = inotify_init();
 	if(m_fd < 0)
 	{
 		ANKI_UTIL_LOGE("inotify_init() failed: %s", strerror(errno));
-		err = Error::FUNCTION_FAILED;
+		return Error::FUNCTION_FAILED;
 	}
 
-	if(!err)
+	return Error::NONE;
+}
+
+Error INotify::addPathInternal(U32 pathIdx)
+{
+	ANKI_ASSERT(m_fd >= 0);
+
+	if(pathIdx >= m_watches.getSize())
 	{
-		m_watch = inotify_add_watch(m_fd, &m_path[0], IN_MODIFY | IN_CREATE | IN_DELETE | IN_IGNORED | IN_DELETE_SELF);
-		if(m_watch < 0)
-		{
-			ANKI_UTIL_LOGE("inotify_add_watch() failed: %s", strerror(errno));
-			err = Error::FUNCTION_FAILED;
-		}
+		m_watches.resize(m_alloc, pathIdx + 1, -1);
 	}
 
-	if(err)
+	ANKI_ASSERT(m_watches[pathIdx] < 0);
+	const int watch = inotify_add_watch(m_fd, m_paths[pathIdx].cstr(),
+										IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_IGNORED | IN_DELETE_SELF);
+	if(watch < 0)
 	{
-		destroyInternal();
+		ANKI_UTIL_LOGE("inotify_add_watch() failed for %s: %s", m_paths[pathIdx].cstr(), strerror(errno));
+		return Error::FUNCTION_FAILED;
 	}
 
-	return err;
+	m_watches[pathIdx] = watch;
+
+	// Two paths of the same file or directory get the same watch descriptor. Keep the first
+	if(m_watchPaths.find(U32(watch)) == m_watchPaths.getEnd())
+	{
+		m_watchPaths.emplace(m_alloc, U32(watch), pathIdx);
+	}
+
+	return Error::NONE;
 }
 
 void INotify::destroyInternal()
 {
-	if(m_watch >= 0)
+	for(int& watch : m_watches)
 	{
-		int err = inotify_rm_watch(m_fd, m_watch);
-		if(err < 0)
+		if(watch >= 0)
 		{
-			ANKI_UTIL_LOGE("inotify_rm_watch() failed: %s\n", strerror(errno));
+			// The paths that share a watch descriptor have removed it already
+			auto it = m_watchPaths.find(U32(watch));
+			if(it != m_watchPaths.getEnd())
+			{
+				m_watchPaths.erase(m_alloc, it);
+
+				int err = inotify_rm_watch(m_fd, watch);
+				if(err < 0)
+				{
+					ANKI_UTIL_LOGE("inotify_rm_watch() failed: %s\n", strerror(errno));
+				}
+			}
+
+			watch = -1;
 		}
-		m_watch = -1;
 	}
+	m_watches.destroy(m_alloc);
+	m_watchPaths.destroy(m_alloc);
 
 	if(m_fd >= 0)
 	{
@@ -66,15 +91,17 @@ void INotify::destroyInternal()
 	}
 }
 
-Error INotify::pollEvents(Bool& modified)
+Error INotify::pollEvents(Bool& modified, StringListAuto* modifiedFilenames,
+						  DynamicArrayAuto<U32>* modifiedFilenamePaths)
 {
-	ANKI_ASSERT(m_fd >= 0 && m_watch >= 0);
+	ANKI_ASSERT(m_fd >= 0);
 
 	Error err = Error::NONE;
 	modified = false;
 
 	while(true)
 	{
+		// A single syscall checks all the paths
 		pollfd pfd = {m_fd, POLLIN, 0};
 		int ret = poll(&pfd, 1, 0);
 
@@ -91,30 +118,55 @@ Error INotify::pollEvents(Bool& modified)
 		}
 		else
 		{
-			// Process the new event
+			// Process the new events
 
-			Array<U8, 2_KB> readBuff;
-			PtrSize nbytes = read(m_fd, &readBuff[0], sizeof(readBuff));
+			alignas(inotify_event) Array<U8, 2_KB> readBuff;
+			const ssize_t nbytes = read(m_fd, &readBuff[0], sizeof(readBuff));
 			if(nbytes > 0)
 			{
-				inotify_event* event = reinterpret_cast<inotify_event*>(&readBuff[0]);
-
-				if(event->mask & IN_IGNORED)
+				PtrSize offset = 0;
+				while(offset < PtrSize(nbytes))
 				{
-					// File was moved or deleted. Some editors on save they delete the file and move another file to
-					// its place. In that case the m_fd and the m_watch need to be re-created.
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(&readBuff[offset]);
+					offset += sizeof(inotify_event) + event->len;
 
-					m_watch = -1; // Watch descriptor was removed implicitly
-					destroyInternal();
-					err = initInternal();
-					if(err)
+					auto it = m_watchPaths.find(U32(event->wd));
+					if(it == m_watchPaths.getEnd())
 					{
-						break;
+						// The event of a watch that was removed
+						continue;
+					}
+
+					const U32 pathIdx = *it;
+					modified = true;
+
+					if(event->mask & IN_IGNORED)
+					{
+						// File was moved or deleted. Some editors on save they delete the file and move another file
+						// to its place. In that case the watch needs to be re-created. The watch descriptor was removed
+						// implicitly
+						m_watchPaths.erase(m_alloc, it);
+						m_watches[pathIdx] = -1;
+						err = addPathInternal(pathIdx);
+						if(err)
+						{
+							break;
+						}
+					}
+					else if(modifiedFilenames && event->len > 0 && event->name[0] != '\0')
+					{
+						// The name is there only if the path is a directory
+						modifiedFilenames->pushBack(&event->name[0]);
+						if(modifiedFilenamePaths)
+						{
+							modifiedFilenamePaths->emplaceBack(pathIdx);
+						}
 					}
 				}
-				else
+
+				if(err)
 				{
-					modified = true;
+					break;
 				}
 			}
 			else
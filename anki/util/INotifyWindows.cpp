@@ -14,12 +14,19 @@ Error INotify::initInternal()
 	return Error::NONE;
 }
 
+Error INotify::addPathInternal(U32 pathIdx)
+{
+	// TODO
+	return Error::NONE;
+}
+
 void INotify::destroyInternal()
 {
 	// TODO
 }
 
-Error INotify::pollEvents(Bool& modified)
+Error INotify::pollEvents(Bool& modified, StringListAuto* modifiedFilenames,
+						  DynamicArrayAuto<U32>* modifiedFilenamePaths)
 {
 	// TODO
 	modified = false;
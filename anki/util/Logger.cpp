@@ -6,6 +6,7 @@
 #include <anki/util/File.h>
 #include <anki/util/Logger.h>
 #include <anki/util/System.h>
+#include <anki/util/Functions.h>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -22,13 +23,29 @@ namespace anki
 
 static const Array<const char*, static_cast<U>(LoggerMessageType::COUNT)> MSG_TEXT = {"I", "E", "W", "F"};
 
+/// A preformatted message that sits in the ring. The sequence tells if the record is free or full.
+class Logger::AsyncRecord
+{
+public:
+	Atomic<U64> m_sequence;
+	const char* m_file;
+	const char* m_func;
+	const char* m_subsystem;
+	ThreadId m_tid;
+	I32 m_line;
+	LoggerMessageType m_type;
+	Array<char, MAX_ASYNC_MESSAGE_LENGTH> m_msg;
+};
+
 Logger::Logger()
+	: m_writerThread("AnKiLogger")
 {
 	addMessageHandler(this, &defaultSystemMessageHandler);
 }
 
 Logger::~Logger()
 {
+	disableAsync();
 }
 
 void Logger::addMessageHandler(void* data, LoggerMessageHandlerCallback callback)
@@ -63,16 +80,24 @@ void Logger::removeMessageHandler(void* data, LoggerMessageHandlerCallback callb
 void Logger::write(const char* file, int line, const char* func, const char* subsystem, LoggerMessageType type,
 				   ThreadId tid, const char* msg)
 {
-	m_mutex.lock();
-
 	LoggerMessageInfo inf = {file, line, func, type, msg, subsystem, tid};
 
-	U count = m_handlersCount;
-	while(count-- != 0)
+	// The writer thread can't wait for itself so it writes synchronously
+	if(isAsync() && Thread::getCurrentThreadId() != m_writerThreadId.load(AtomicMemoryOrder::ACQUIRE))
 	{
-		m_handlers[count].m_callback(m_handlers[count].m_data, inf);
+		enqueue(inf);
+
+		if(type == LoggerMessageType::FATAL)
+		{
+			flush();
+			abort();
+		}
+
+		return;
 	}
 
+	m_mutex.lock();
+	dispatch(inf, true);
 	m_mutex.unlock();
 
 	if(type == LoggerMessageType::FATAL)
@@ -81,6 +106,255 @@ void Logger::write(const char* file, int line, const char* func, const char* sub
 	}
 }
 
+void Logger::dispatch(const LoggerMessageInfo& info, Bool flushFiles)
+{
+	U count = m_handlersCount;
+	while(count-- != 0)
+	{
+		const Handler& handler = m_handlers[count];
+		if(handler.m_callback == &fileMessageHandler && !flushFiles)
+		{
+			writeFileMessage(*static_cast<File*>(handler.m_data), info);
+		}
+		else
+		{
+			handler.m_callback(handler.m_data, info);
+		}
+	}
+}
+
+void Logger::enqueue(const LoggerMessageInfo& info)
+{
+	// Errors are important, never drop them
+	const Bool canDrop = m_overflowPolicy == LoggerOverflowPolicy::DROP && info.m_type != LoggerMessageType::ERROR
+						 && info.m_type != LoggerMessageType::FATAL;
+	Bool blocked = false;
+
+	// Claim a record
+	AsyncRecord* record;
+	U64 pos = m_enqueuePos.load(AtomicMemoryOrder::RELAXED);
+	while(true)
+	{
+		record = &m_records[pos & m_recordMask];
+		const U64 seq = record->m_sequence.load(AtomicMemoryOrder::ACQUIRE);
+		const I64 diff = I64(seq) - I64(pos);
+
+		if(diff == 0)
+		{
+			if(m_enqueuePos.compareExchange(pos, pos + 1, AtomicMemoryOrder::RELAXED, AtomicMemoryOrder::RELAXED))
+			{
+				break;
+			}
+		}
+		else if(diff < 0)
+		{
+			// The ring is full
+			if(canDrop)
+			{
+				m_droppedCount.fetchAdd(1, AtomicMemoryOrder::RELAXED);
+				return;
+			}
+
+			blocked = true;
+			wakeWriter();
+			std::this_thread::yield();
+			pos = m_enqueuePos.load(AtomicMemoryOrder::RELAXED);
+		}
+		else
+		{
+			// Some other thread claimed it
+			pos = m_enqueuePos.load(AtomicMemoryOrder::RELAXED);
+		}
+	}
+
+	// Fill it
+	record->m_file = info.m_file;
+	record->m_func = info.m_func;
+	record->m_subsystem = info.m_subsystem;
+	record->m_tid = info.m_tid;
+	record->m_line = info.m_line;
+	record->m_type = info.m_type;
+
+	const PtrSize len = strlen(info.m_msg);
+	const PtrSize copyLen = min<PtrSize>(len, record->m_msg.getSize() - 1);
+	memcpy(&record->m_msg[0], info.m_msg, copyLen);
+	record->m_msg[copyLen] = '\0';
+	if(copyLen < len)
+	{
+		m_truncatedCount.fetchAdd(1, AtomicMemoryOrder::RELAXED);
+	}
+
+	if(blocked)
+	{
+		m_blockedCount.fetchAdd(1, AtomicMemoryOrder::RELAXED);
+	}
+
+	// Publish it
+	record->m_sequence.store(pos + 1, AtomicMemoryOrder::SEQ_CST);
+
+	if(m_writerSleeping.load(AtomicMemoryOrder::SEQ_CST))
+	{
+		wakeWriter();
+	}
+}
+
+void Logger::wakeWriter()
+{
+	LockGuard<Mutex> lock(m_writerMtx);
+	m_writerCondVar.notifyOne();
+}
+
+Bool Logger::hasPendingRecords() const
+{
+	const AsyncRecord& record = m_records[m_dequeuePos & m_recordMask];
+	return record.m_sequence.load(AtomicMemoryOrder::SEQ_CST) == m_dequeuePos + 1;
+}
+
+U32 Logger::writePendingRecords()
+{
+	const U32 maxBatchSize = m_recordMask + 1;
+	U32 count = 0;
+
+	LockGuard<Mutex> lock(m_mutex);
+
+	while(count < maxBatchSize && hasPendingRecords())
+	{
+		AsyncRecord& record = m_records[m_dequeuePos & m_recordMask];
+
+		const LoggerMessageInfo info = {record.m_file, record.m_line,		 record.m_func, record.m_type,
+										&record.m_msg[0], record.m_subsystem, record.m_tid};
+		dispatch(info, false);
+
+		// Give the record back to the producers
+		record.m_sequence.store(m_dequeuePos + m_recordMask + 1, AtomicMemoryOrder::RELEASE);
+		++m_dequeuePos;
+		++count;
+	}
+
+	// Flush the files once per batch
+	if(count > 0)
+	{
+		for(U32 i = 0; i < m_handlersCount; ++i)
+		{
+			if(m_handlers[i].m_callback == &fileMessageHandler)
+			{
+				const Error err = static_cast<File*>(m_handlers[i].m_data)->flush();
+				(void)err;
+			}
+		}
+
+		m_writtenCount.fetchAdd(count, AtomicMemoryOrder::RELAXED);
+	}
+
+	m_flushedPos.store(m_dequeuePos, AtomicMemoryOrder::RELEASE);
+	return count;
+}
+
+Error Logger::writerThreadCallback(ThreadCallbackInfo& info)
+{
+	Logger& self = *static_cast<Logger*>(info.m_userData);
+	self.m_writerThreadId.store(Thread::getCurrentThreadId(), AtomicMemoryOrder::RELEASE);
+
+	while(true)
+	{
+		if(self.writePendingRecords() > 0)
+		{
+			continue;
+		}
+
+		if(self.m_quitWriter.load(AtomicMemoryOrder::ACQUIRE))
+		{
+			// Write what is left and leave
+			while(self.writePendingRecords() > 0)
+			{
+			}
+			break;
+		}
+
+		// Nothing to do, sleep. Set the flag before checking the ring so the producers will see it
+		LockGuard<Mutex> lock(self.m_writerMtx);
+		self.m_writerSleeping.store(1, AtomicMemoryOrder::SEQ_CST);
+		if(!self.hasPendingRecords() && !self.m_quitWriter.load(AtomicMemoryOrder::SEQ_CST))
+		{
+			self.m_writerCondVar.wait(self.m_writerMtx);
+		}
+		self.m_writerSleeping.store(0, AtomicMemoryOrder::SEQ_CST);
+	}
+
+	self.m_writerThreadId.store(0, AtomicMemoryOrder::RELEASE);
+	return Error::NONE;
+}
+
+void Logger::enableAsync(U32 recordCount, LoggerOverflowPolicy policy)
+{
+	ANKI_ASSERT(isPowerOfTwo(recordCount));
+	if(isAsync())
+	{
+		return;
+	}
+
+	m_records = static_cast<AsyncRecord*>(malloc(sizeof(AsyncRecord) * recordCount));
+	if(m_records == nullptr)
+	{
+		fprintf(stderr, "Logger::enableAsync() failed to allocate. Will stay synchronous");
+		return;
+	}
+
+	for(U32 i = 0; i < recordCount; ++i)
+	{
+		::new(&m_records[i]) AsyncRecord();
+		m_records[i].m_sequence.setNonAtomically(i);
+	}
+
+	m_recordMask = recordCount - 1;
+	m_overflowPolicy = policy;
+	m_enqueuePos.setNonAtomically(0);
+	m_dequeuePos = 0;
+	m_flushedPos.setNonAtomically(0);
+	m_quitWriter.setNonAtomically(0);
+
+	m_writerThread.start(this, writerThreadCallback);
+}
+
+void Logger::disableAsync()
+{
+	if(!isAsync())
+	{
+		return;
+	}
+
+	m_quitWriter.store(1, AtomicMemoryOrder::SEQ_CST);
+	wakeWriter();
+	const Error err = m_writerThread.join();
+	(void)err;
+
+	free(m_records);
+	m_records = nullptr;
+}
+
+void Logger::flush()
+{
+	if(!isAsync())
+	{
+		return;
+	}
+
+	const U64 pos = m_enqueuePos.load(AtomicMemoryOrder::ACQUIRE);
+	while(m_flushedPos.load(AtomicMemoryOrder::ACQUIRE) < pos)
+	{
+		wakeWriter();
+		std::this_thread::yield();
+	}
+}
+
+void Logger::getAsyncStatistics(LoggerAsyncStatistics& stats) const
+{
+	stats.m_writtenCount = m_writtenCount.load(AtomicMemoryOrder::RELAXED);
+	stats.m_droppedCount = m_droppedCount.load(AtomicMemoryOrder::RELAXED);
+	stats.m_blockedCount = m_blockedCount.load(AtomicMemoryOrder::RELAXED);
+	stats.m_truncatedCount = m_truncatedCount.load(AtomicMemoryOrder::RELAXED);
+}
+
 void Logger::writeFormated(const char* file, int line, const char* func, const char* subsystem, LoggerMessageType type,
 						   ThreadId tid, const char* fmt, ...)
 {
@@ -262,16 +536,17 @@ void Logger::defaultSystemMessageHandler(void*, const LoggerMessageInfo& info)
 
 void Logger::fileMessageHandler(void* pfile, const LoggerMessageInfo& info)
 {
-	File* file = reinterpret_cast<File*>(pfile);
-
-	Error err = file->writeText("[%s] %s (%s:%d %s)\n", MSG_TEXT[static_cast<U>(info.m_type)], info.m_msg, info.m_file,
-								info.m_line, info.m_func);
+	File& file = *reinterpret_cast<File*>(pfile);
+	writeFileMessage(file, info);
+	const Error err = file.flush();
+	(void)err;
+}
 
-	if(!err)
-	{
-		err = file->flush();
-		(void)err;
-	}
+void Logger::writeFileMessage(File& file, const LoggerMessageInfo& info)
+{
+	const Error err = file.writeText("[%s] %s (%s:%d %s)\n", MSG_TEXT[static_cast<U>(info.m_type)], info.m_msg,
+									 info.m_file, info.m_line, info.m_func);
+	(void)err;
 }
 
 } // end namespace anki
@@ -47,13 +47,36 @@ public:
 /// @memberof Logger
 using LoggerMessageHandlerCallback = void (*)(void*, const LoggerMessageInfo& info);
 
+/// What the async mode of the Logger does when its ring of records is full.
+/// @memberof Logger
+enum class LoggerOverflowPolicy : U8
+{
+	DROP, ///< Drop the message. Errors and fatal errors are never dropped, they block.
+	BLOCK ///< Wait for the writer thread to make room.
+};
+
+/// Statistics of the async mode of the Logger.
+/// @memberof Logger
+class LoggerAsyncStatistics
+{
+public:
+	U64 m_writtenCount = 0; ///< Messages the writer thread passed to the handlers.
+	U64 m_droppedCount = 0; ///< Messages dropped because the ring was full.
+	U64 m_blockedCount = 0; ///< Messages that had to wait because the ring was full.
+	U64 m_truncatedCount = 0; ///< Messages that didn't fit in a record.
+};
+
 /// The logger singleton class. The logger cannot print errors or throw exceptions, it has to recover somehow. It's
 /// thread safe.
 /// To add a new signal:
 /// @code logger.addMessageHandler((void*)obj, &function) @endcode
+/// By default the handlers run on the thread that writes the message. In async mode the messages are copied to a ring
+/// of records without locking and a writer thread passes them to the handlers in batches.
 class Logger
 {
 public:
+	/// The max length of a message in async mode. Longer messages get truncated.
+	static constexpr U32 MAX_ASYNC_MESSAGE_LENGTH = 448;
 	/// Initialize the logger and add the default message handler
 	Logger();
 
@@ -77,6 +100,24 @@ public:
 	void writeFormated(const char* file, int line, const char* func, const char* subsystem, LoggerMessageType type,
 					   ThreadId tid, const char* fmt, ...);
 
+	/// Start the writer thread. Don't call it while other threads are logging.
+	/// @param recordCount The size of the ring. Should be a power of 2.
+	/// @param policy What to do when the ring is full.
+	void enableAsync(U32 recordCount = 1024, LoggerOverflowPolicy policy = LoggerOverflowPolicy::DROP);
+
+	/// Write the pending messages and stop the writer thread. Don't call it while other threads are logging.
+	void disableAsync();
+
+	Bool isAsync() const
+	{
+		return m_records != nullptr;
+	}
+
+	/// Wait for the writer thread to write all the messages sent so far. It does nothing if not in async mode.
+	void flush();
+
+	void getAsyncStatistics(LoggerAsyncStatistics& stats) const;
+
 private:
 	class Handler
 	{
@@ -95,12 +136,52 @@ private:
 		}
 	};
 
+	class AsyncRecord;
+
 	Mutex m_mutex; ///< For thread safety
 	Array<Handler, 4> m_handlers;
 	U32 m_handlersCount = 0;
 
+	/// @name Async mode
+	/// @{
+	AsyncRecord* m_records = nullptr;
+	U32 m_recordMask = 0;
+	LoggerOverflowPolicy m_overflowPolicy = LoggerOverflowPolicy::DROP;
+	Atomic<U64> m_enqueuePos = {0};
+	U64 m_dequeuePos = 0; ///< Only the writer thread touches it.
+	Atomic<U64> m_flushedPos = {0}; ///< All the records before that are written and the files are flushed.
+
+	Thread m_writerThread;
+	Atomic<ThreadId> m_writerThreadId = {0};
+	Mutex m_writerMtx;
+	ConditionVariable m_writerCondVar;
+	Atomic<U32> m_writerSleeping = {0};
+	Atomic<U32> m_quitWriter = {0};
+
+	Atomic<U64> m_writtenCount = {0};
+	Atomic<U64> m_droppedCount = {0};
+	Atomic<U64> m_blockedCount = {0};
+	Atomic<U64> m_truncatedCount = {0};
+	/// @}
+
+	/// Call the handlers. The caller should hold m_mutex.
+	void dispatch(const LoggerMessageInfo& info, Bool flushFiles);
+
+	/// Copy a message to the ring.
+	void enqueue(const LoggerMessageInfo& info);
+
+	/// Pass the pending records to the handlers. Returns the number of records.
+	U32 writePendingRecords();
+
+	Bool hasPendingRecords() const;
+
+	void wakeWriter();
+
+	static Error writerThreadCallback(ThreadCallbackInfo& info);
+
 	static void defaultSystemMessageHandler(void*, const LoggerMessageInfo& info);
 	static void fileMessageHandler(void* file, const LoggerMessageInfo& info);
+	static void writeFileMessage(File& file, const LoggerMessageInfo& info);
 };
 
 using LoggerSingleton = Singleton<Logger>;
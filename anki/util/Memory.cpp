@@ -4,6 +4,8 @@
 // http://www.anki3d.org/LICENSE
 
 #include <anki/util/Memory.h>
+#include <anki/util/ThreadCachingHeap.h>
+#include <anki/util/MemoryTag.h>
 #include <anki/util/Functions.h>
 #include <anki/util/Assert.h>
 #include <anki/util/NonCopyable.h>
@@ -119,6 +121,65 @@ void freeAligned(void* ptr)
 #endif
 }
 
+namespace detail
+{
+
+/// One bit per thread slot.
+static Atomic<U64, AtomicMemoryOrder::SEQ_CST> g_threadSlotMask = {0};
+
+/// The slot of the thread. It lives outside of the ThreadSlotReleaser because the compiler drops the stores that a
+/// destructor makes to its own object.
+static thread_local U32 g_threadSlot = MAX_U32;
+static thread_local Bool g_threadSlotAcquired = false;
+
+/// Releases the slot of a thread when the thread exits.
+class ThreadSlotReleaser
+{
+public:
+	~ThreadSlotReleaser()
+	{
+		if(g_threadSlot != MAX_U32)
+		{
+			g_threadSlotMask.fetchAnd(~(U64(1) << U64(g_threadSlot)));
+
+			// Another thread might get the slot. The allocations of the rest of the thread's exit use the shared path
+			g_threadSlot = MAX_U32;
+		}
+	}
+};
+
+static thread_local ThreadSlotReleaser g_threadSlotReleaser;
+
+static U32 acquireThreadSlot()
+{
+	g_threadSlotAcquired = true;
+
+	// Touch the releaser so its destructor runs when the thread exits
+	ThreadSlotReleaser* releaser = &g_threadSlotReleaser;
+	(void)releaser;
+
+	U64 mask = g_threadSlotMask.load();
+	while(mask != MAX_U64)
+	{
+		const U32 slot = countTrailingZeros(~mask);
+		if(g_threadSlotMask.compareExchange(mask, mask | (U64(1) << U64(slot))))
+		{
+			g_threadSlot = slot;
+			break;
+		}
+	}
+
+	return g_threadSlot;
+}
+
+U32 getThreadSlot()
+{
+	static_assert(MAX_THREAD_SLOTS == sizeof(U64) * 8, "Wrong assumption");
+	return ANKI_LIKELY(g_threadSlotAcquired) ? g_threadSlot : acquireThreadSlot();
+}
+
+} // end namespace detail
+
 void* allocAligned(void* userData, void* ptr, PtrSize size, PtrSize alignment)
 {
 	(void)userData;
@@ -153,6 +214,11 @@ Bool BaseMemoryPool::isInitialized() const
 	return m_allocCb != nullptr;
 }
 
+MemoryTag* BaseMemoryPool::getMemoryTag() const
+{
+	return (m_allocCb == MemoryTag::allocCallback) ? static_cast<MemoryTag*>(m_allocCbUserData) : nullptr;
+}
+
 HeapMemoryPool::HeapMemoryPool()
 	: BaseMemoryPool(Type::HEAP)
 {
@@ -160,16 +226,32 @@ HeapMemoryPool::HeapMemoryPool()
 
 HeapMemoryPool::~HeapMemoryPool()
 {
-	const U32 count = m_allocationsCount.load();
+	U64 count = m_allocationsCount.load();
+
+	if(m_cachingHeap)
+	{
+		ThreadCachingHeapStatistics stats;
+		m_cachingHeap->getStatistics(stats);
+		count = 0;
+		for(U32 i = 0; i < stats.m_allocationCounts.getSize(); ++i)
+		{
+			count += stats.m_allocationCounts[i] - stats.m_freeCounts[i];
+		}
+
+		m_cachingHeap->~ThreadCachingHeap();
+		m_allocCb(m_allocCbUserData, m_cachingHeap, 0, 0);
+		m_cachingHeap = nullptr;
+	}
+
 	if(count != 0)
 	{
 		ANKI_UTIL_LOGW("Memory pool destroyed before all memory being released "
 					   "(%u deallocations missed)",
-					   count);
+					   U32(count));
 	}
 }
 
-void HeapMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData)
+void HeapMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData, Bool threadCaching)
 {
 	ANKI_ASSERT(!isInitialized());
 	ANKI_ASSERT(m_allocCb == nullptr);
@@ -180,6 +262,23 @@ void HeapMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData)
 #if ANKI_MEM_EXTRA_CHECKS
 	m_signature = computePoolSignature(this);
 #endif
+
+	if(threadCaching)
+	{
+		void* mem = m_allocCb(m_allocCbUserData, nullptr, sizeof(ThreadCachingHeap), alignof(ThreadCachingHeap));
+		if(mem == nullptr)
+		{
+			ANKI_CREATION_OOM_ACTION();
+		}
+
+		m_cachingHeap = ::new(mem) ThreadCachingHeap(m_allocCb, m_allocCbUserData);
+	}
+}
+
+void HeapMemoryPool::getStatistics(ThreadCachingHeapStatistics& stats) const
+{
+	ANKI_ASSERT(m_cachingHeap && "The pool is not thread caching");
+	m_cachingHeap->getStatistics(stats);
 }
 
 void* HeapMemoryPool::allocate(PtrSize size, PtrSize alignment)
@@ -190,11 +289,22 @@ void* HeapMemoryPool::allocate(PtrSize size, PtrSize alignment)
 	size += ALLOCATION_HEADER_SIZE;
 #endif
 
-	void* mem = m_allocCb(m_allocCbUserData, nullptr, size, alignment);
+	void* mem;
+	if(m_cachingHeap)
+	{
+		mem = m_cachingHeap->allocate(size, alignment);
+	}
+	else
+	{
+		mem = m_allocCb(m_allocCbUserData, nullptr, size, alignment);
+	}
 
 	if(mem != nullptr)
 	{
-		m_allocationsCount.fetchAdd(1);
+		if(!m_cachingHeap)
+		{
+			m_allocationsCount.fetchAdd(1);
+		}
 
 #if ANKI_MEM_EXTRA_CHECKS
 		memset(mem, 0, ALLOCATION_HEADER_SIZE);
@@ -233,8 +343,15 @@ void HeapMemoryPool::free(void* ptr)
 	ptr = static_cast<void*>(memU8);
 	invalidateMemory(ptr, header.m_allocationSize);
 #endif
-	m_allocationsCount.fetchSub(1);
-	m_allocCb(m_allocCbUserData, ptr, 0, 0);
+	if(m_cachingHeap)
+	{
+		m_cachingHeap->free(ptr);
+	}
+	else
+	{
+		m_allocationsCount.fetchSub(1);
+		m_allocCb(m_allocCbUserData, ptr, 0, 0);
+	}
 }
 
 StackMemoryPool::StackMemoryPool()
@@ -244,6 +361,11 @@ StackMemoryPool::StackMemoryPool()
 
 StackMemoryPool::~StackMemoryPool()
 {
+	if(m_threadArenas)
+	{
+		m_allocCb(m_allocCbUserData, m_threadArenas, 0, 0);
+	}
+
 	// Iterate all until you find an unused
 	for(Chunk& ch : m_chunks)
 	{
@@ -305,6 +427,29 @@ void StackMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData,
 	}
 }
 
+void StackMemoryPool::setThreadArenaSize(PtrSize arenaSize)
+{
+	ANKI_ASSERT(isInitialized());
+	ANKI_ASSERT(m_threadArenas == nullptr && "Can't change it");
+	ANKI_ASSERT(arenaSize > 0 && arenaSize <= m_initialChunkSize);
+
+	// Keep the arenas in different cache lines to avoid false sharing
+	static_assert(alignof(ThreadArena) == ANKI_CACHE_LINE_SIZE, "See file");
+	const PtrSize size = sizeof(ThreadArena) * detail::MAX_THREAD_SLOTS;
+	m_threadArenas = static_cast<ThreadArena*>(m_allocCb(m_allocCbUserData, nullptr, size, ANKI_CACHE_LINE_SIZE));
+	if(m_threadArenas == nullptr)
+	{
+		ANKI_CREATION_OOM_ACTION();
+	}
+
+	for(U32 i = 0; i < detail::MAX_THREAD_SLOTS; ++i)
+	{
+		::new(&m_threadArenas[i]) ThreadArena();
+	}
+
+	m_threadArenaSize = getAlignedRoundUp(m_alignmentBytes, arenaSize);
+}
+
 void* StackMemoryPool::allocate(PtrSize size, PtrSize alignment)
 {
 	ANKI_ASSERT(isInitialized());
@@ -313,6 +458,54 @@ void* StackMemoryPool::allocate(PtrSize size, PtrSize alignment)
 
 	size = getAlignedRoundUp(m_alignmentBytes, size);
 	ANKI_ASSERT(size > 0);
+
+	if(m_threadArenas == nullptr)
+	{
+		void* out = allocateShared(size);
+		if(out)
+		{
+			m_allocationsCount.fetchAdd(1);
+		}
+
+		return out;
+	}
+
+	// Big allocations would waste too much of the arenas
+	const U32 slot = detail::getThreadSlot();
+	if(size > m_threadArenaSize / 4 || slot == MAX_U32)
+	{
+		return allocateShared(size);
+	}
+
+	// Only the thread of the slot touches the arena
+	ThreadArena& arena = m_threadArenas[slot];
+	if(arena.m_frame != m_frame)
+	{
+		arena.m_mem = nullptr;
+		arena.m_end = nullptr;
+		arena.m_frame = m_frame;
+	}
+
+	if(ANKI_UNLIKELY(PtrSize(arena.m_end - arena.m_mem) < size))
+	{
+		U8* mem = static_cast<U8*>(allocateShared(m_threadArenaSize));
+		if(ANKI_UNLIKELY(mem == nullptr))
+		{
+			return nullptr;
+		}
+
+		m_threadArenaWastedBytes.fetchAdd(PtrSize(arena.m_end - arena.m_mem));
+		arena.m_mem = mem;
+		arena.m_end = mem + m_threadArenaSize;
+	}
+
+	void* out = arena.m_mem;
+	arena.m_mem += size;
+	return out;
+}
+
+void* StackMemoryPool::allocateShared(PtrSize size)
+{
 	ANKI_ASSERT(size <= m_initialChunkSize && "The chunks should have enough space to hold at least one allocation");
 
 	Chunk* crntChunk = nullptr;
@@ -330,9 +523,7 @@ void* StackMemoryPool::allocate(PtrSize size, PtrSize alignment)
 		if(PtrSize(out + size - crntChunk->m_baseMem) <= crntChunk->m_size)
 		{
 			// All is fine, there is enough space in the chunk
-
 			retry = false;
-			m_allocationsCount.fetchAdd(1);
 		}
 		else
 		{
@@ -411,9 +602,12 @@ void StackMemoryPool::free(void* ptr)
 	// allocated by this class
 	ANKI_ASSERT(ptr != nullptr && isAligned(m_alignmentBytes, ptr));
 
-	auto count = m_allocationsCount.fetchSub(1);
-	ANKI_ASSERT(count > 0);
-	(void)count;
+	if(m_threadArenas == nullptr)
+	{
+		auto count = m_allocationsCount.fetchSub(1);
+		ANKI_ASSERT(count > 0);
+		(void)count;
+	}
 }
 
 void StackMemoryPool::reset()
@@ -440,6 +634,23 @@ void StackMemoryPool::reset()
 	m_chunks[0].checkReset();
 	m_crntChunkIdx.store(0);
 
+	// Gather the wasted bytes of the thread arenas and invalidate them
+	if(m_threadArenas)
+	{
+		PtrSize wasted = m_threadArenaWastedBytes.exchange(0);
+		for(U32 i = 0; i < detail::MAX_THREAD_SLOTS; ++i)
+		{
+			const ThreadArena& arena = m_threadArenas[i];
+			if(arena.m_frame == m_frame)
+			{
+				wasted += PtrSize(arena.m_end - arena.m_mem);
+			}
+		}
+
+		m_threadArenaWastedBytesPrevFrame = wasted;
+		++m_frame;
+	}
+
 	// Reset allocation count and do some error checks
 	auto allocCount = m_allocationsCount.exchange(0);
 	if(!m_ignoreDeallocationErrors && allocCount != 0)
@@ -37,6 +37,24 @@ using AllocAlignedCallback = void* (*)(void* userData, void* ptr, PtrSize size,
 /// An internal type.
 using PoolSignature = U32;
 
+// Forward
+class MemoryTag;
+class ThreadCachingHeap;
+class ThreadCachingHeapStatistics;
+
+namespace detail
+{
+
+/// The max number of threads that can have a slot at the same time.
+constexpr U32 MAX_THREAD_SLOTS = 64;
+
+/// Get a small index that is unique among the threads that are alive. The pools use it to index their per-thread
+/// state. Returns MAX_U32 if more than MAX_THREAD_SLOTS threads asked for one or if the thread released its slot
+/// because it exits.
+U32 getThreadSlot();
+
+} // end namespace detail
+
 /// This is a function that allocates and deallocates heap memory. If the @a ptr is nullptr then it allocates using the
 /// @a size and @a alignment. If the @a ptr is not nullptr it deallocates the memory and the @a size and @a alignment is
 /// ignored.
@@ -95,6 +113,10 @@ public:
 		return m_allocationsCount.load();
 	}
 
+	/// Get the tag that owns the memory of the pool. It's not nullptr if the pool was initialized with
+	/// MemoryTag::allocCallback.
+	MemoryTag* getMemoryTag() const;
+
 protected:
 	/// Pool type.
 	enum class Type : U8
@@ -144,7 +166,10 @@ public:
 	/// The real constructor.
 	/// @param allocCb The allocation function callback
 	/// @param allocCbUserData The user data to pass to the allocation function
-	void init(AllocAlignedCallback allocCb, void* allocCbUserData);
+	/// @param threadCaching Serve the small allocations from per-thread caches (see ThreadCachingHeap). It scales
+	///                      better when many threads allocate at the same time. In that mode getAllocationsCount()
+	///                      is not updated, use getStatistics() instead.
+	void init(AllocAlignedCallback allocCb, void* allocCbUserData, Bool threadCaching = false);
 
 	/// Allocate memory
 	void* allocate(PtrSize size, PtrSize alignment);
@@ -153,7 +178,17 @@ public:
 	/// @param[in, out] ptr Memory block to deallocate.
 	void free(void* ptr);
 
+	/// Get the statistics of the thread caching heap. Only valid if the pool was initialized with threadCaching.
+	void getStatistics(ThreadCachingHeapStatistics& stats) const;
+
+	Bool isThreadCaching() const
+	{
+		return m_cachingHeap != nullptr;
+	}
+
 private:
+	ThreadCachingHeap* m_cachingHeap = nullptr;
+
 #if ANKI_MEM_EXTRA_CHECKS
 	PoolSignature m_signature = 0;
 #endif
@@ -202,6 +237,18 @@ public:
 	/// Get the current capacity of the pool. It's not thread safe.
 	PtrSize getMemoryCapacity() const;
 
+	/// Make every thread grab blocks of arenaSize from the pool and bump allocate from them without atomics. Big
+	/// allocations still go to the shared stack. In that mode getAllocationsCount() is not updated. Call it right after
+	/// init().
+	/// @param arenaSize The size of the blocks. It should be less than the initial chunk size.
+	void setThreadArenaSize(PtrSize arenaSize);
+
+	/// The bytes left unused at the end of the thread blocks during the previous frame (between the last 2 resets).
+	PtrSize getThreadArenaWastedBytes() const
+	{
+		return m_threadArenaWastedBytesPrevFrame;
+	}
+
 private:
 	/// The memory chunk.
 	class Chunk
@@ -260,6 +307,25 @@ private:
 
 	/// Protect the m_crntChunkIdx.
 	Mutex m_lock;
+
+	/// A block of the shared stack that belongs to a single thread. Every bump allocation writes it so it has its own
+	/// cache line.
+	class alignas(ANKI_CACHE_LINE_SIZE) ThreadArena
+	{
+	public:
+		U8* m_mem = nullptr;
+		U8* m_end = nullptr;
+		U32 m_frame = 0; ///< If it's not the same as m_frame of the pool the arena is stale.
+	};
+
+	ThreadArena* m_threadArenas = nullptr; ///< One per thread slot.
+	PtrSize m_threadArenaSize = 0;
+	U32 m_frame = 0; ///< Increases on every reset.
+	Atomic<PtrSize> m_threadArenaWastedBytes = {0};
+	PtrSize m_threadArenaWastedBytesPrevFrame = 0;
+
+	/// Allocate from the shared stack.
+	void* allocateShared(PtrSize size);
 };
 
 /// Chain memory pool. Almost similar to StackMemoryPool but more flexible and at the same time a bit slower.
@@ -0,0 +1,297 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/MemoryTag.h>
+#include <anki/util/Functions.h>
+#include <anki/util/Hash.h>
+#include <anki/util/Logger.h>
+#include <anki/util/Tracer.h>
+#include <cstdio>
+#include <cinttypes>
+#include <cstring>
+#include <algorithm>
+#if ANKI_POSIX && !ANKI_OS_ANDROID
+#	include <execinfo.h>
+#	include <cstdlib>
+#endif
+
+namespace anki
+{
+
+/// Sits right before the memory returned to the user.
+class MemoryTag::Header
+{
+public:
+	PtrSize m_size;
+	U32 m_callstackIdx; ///< MAX_U32 if the allocation wasn't sampled.
+	U32 m_headerSize; ///< The distance from the start of the real allocation to the user memory.
+};
+
+class MemoryTag::Callstack
+{
+public:
+	U64 m_hash;
+	Array<void*, MAX_CALLSTACK_DEPTH> m_frames;
+	U32 m_frameCount;
+	U64 m_sampleCount; ///< Number of sampled allocations that had that callstack.
+	PtrSize m_liveBytes; ///< Live bytes of the sampled allocations.
+};
+
+MemoryTag::~MemoryTag()
+{
+	if(m_liveBytes.load() != 0)
+	{
+		ANKI_UTIL_LOGW("Memory tag %s destroyed with %" PRIu64 " live bytes", m_name, U64(m_liveBytes.load()));
+	}
+
+	if(m_callstacks)
+	{
+		m_allocCb(m_allocCbUserData, m_callstacks, 0, 0);
+	}
+}
+
+void MemoryTag::init(const char* name, AllocAlignedCallback allocCb, void* allocCbUserData, MemoryTag* parent)
+{
+	ANKI_ASSERT(name && allocCb);
+	ANKI_ASSERT(m_allocCb == nullptr && "Already initialized");
+	m_name = name;
+	m_allocCb = allocCb;
+	m_allocCbUserData = allocCbUserData;
+	m_parent = parent;
+
+	snprintf(&m_liveBytesCounterName[0], m_liveBytesCounterName.getSize(), "MEM_%s_LIVE_BYTES", name);
+	snprintf(&m_allocatedBytesCounterName[0], m_allocatedBytesCounterName.getSize(), "MEM_%s_ALLOCATED_BYTES", name);
+	snprintf(&m_allocationCountCounterName[0], m_allocationCountCounterName.getSize(), "MEM_%s_ALLOCATIONS", name);
+}
+
+void* MemoryTag::allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment)
+{
+	ANKI_ASSERT(userData);
+	MemoryTag& self = *static_cast<MemoryTag*>(userData);
+	ANKI_ASSERT(self.m_allocCb && "Not initialized");
+
+	if(ptr == nullptr)
+	{
+		ANKI_ASSERT(size > 0 && alignment > 0);
+
+		// The header takes a whole alignment to keep the user memory aligned
+		alignment = max<PtrSize>(alignment, sizeof(Header));
+		const PtrSize headerSize = alignment;
+		U8* mem = static_cast<U8*>(self.m_allocCb(self.m_allocCbUserData, nullptr, size + headerSize, alignment));
+		if(ANKI_UNLIKELY(mem == nullptr))
+		{
+			return nullptr;
+		}
+
+		U8* out = mem + headerSize;
+		Header& header = *(reinterpret_cast<Header*>(out) - 1);
+		header.m_size = size;
+		header.m_headerSize = U32(headerSize);
+		header.m_callstackIdx = MAX_U32;
+
+		const U64 allocationIdx = self.m_allocationCount.fetchAdd(1);
+		if(self.m_callstackSamplingRate > 0 && (allocationIdx % self.m_callstackSamplingRate) == 0)
+		{
+			header.m_callstackIdx = self.sampleCallstack(size);
+		}
+
+		self.trackAllocation(size);
+		return out;
+	}
+	else
+	{
+		U8* out = static_cast<U8*>(ptr);
+		const Header& header = *(reinterpret_cast<Header*>(out) - 1);
+		const PtrSize size = header.m_size;
+
+		if(header.m_callstackIdx != MAX_U32)
+		{
+			self.freeSampledCallstack(header.m_callstackIdx, size);
+		}
+
+		self.m_freeCount.fetchAdd(1);
+		self.trackFree(size);
+		self.m_allocCb(self.m_allocCbUserData, out - header.m_headerSize, 0, 0);
+		return nullptr;
+	}
+}
+
+void MemoryTag::trackAllocation(PtrSize size)
+{
+	MemoryTag* tag = this;
+	while(tag)
+	{
+		const PtrSize live = tag->m_liveBytes.fetchAdd(size) + size;
+		tag->m_peakLiveBytes.max(live);
+		tag->m_allocatedBytes.fetchAdd(size);
+
+		tag = tag->m_parent;
+		if(tag)
+		{
+			tag->m_allocationCount.fetchAdd(1);
+		}
+	}
+}
+
+void MemoryTag::trackFree(PtrSize size)
+{
+	MemoryTag* tag = this;
+	while(tag)
+	{
+		ANKI_ASSERT(tag->m_liveBytes.load() >= size);
+		tag->m_liveBytes.fetchSub(size);
+
+		tag = tag->m_parent;
+		if(tag)
+		{
+			tag->m_freeCount.fetchAdd(1);
+		}
+	}
+}
+
+U32 MemoryTag::sampleCallstack(PtrSize size)
+{
+#if ANKI_POSIX && !ANKI_OS_ANDROID
+	Array<void*, MAX_CALLSTACK_DEPTH + 2> frames;
+	const I32 frameCount = backtrace(&frames[0], I32(frames.getSize()));
+
+	// Skip this function and allocCallback
+	const U32 skip = 2;
+	if(frameCount <= I32(skip))
+	{
+		return MAX_U32;
+	}
+
+	const U32 depth = U32(frameCount) - skip;
+	const U64 hash = computeHash(&frames[skip], sizeof(void*) * depth);
+
+	LockGuard<Mutex> lock(m_callstackMtx);
+
+	if(m_callstacks == nullptr)
+	{
+		m_callstacks = static_cast<Callstack*>(
+			m_allocCb(m_allocCbUserData, nullptr, sizeof(Callstack) * MAX_CALLSTACKS, alignof(Callstack)));
+		if(m_callstacks == nullptr)
+		{
+			return MAX_U32;
+		}
+	}
+
+	U32 idx = 0;
+	while(idx < m_callstackCount && m_callstacks[idx].m_hash != hash)
+	{
+		++idx;
+	}
+
+	if(idx == m_callstackCount)
+	{
+		if(m_callstackCount == MAX_CALLSTACKS)
+		{
+			return MAX_U32;
+		}
+
+		Callstack& callstack = m_callstacks[m_callstackCount++];
+		callstack.m_hash = hash;
+		callstack.m_frameCount = depth;
+		memcpy(&callstack.m_frames[0], &frames[skip], sizeof(void*) * depth);
+		callstack.m_sampleCount = 0;
+		callstack.m_liveBytes = 0;
+	}
+
+	++m_callstacks[idx].m_sampleCount;
+	m_callstacks[idx].m_liveBytes += size;
+	return idx;
+#else
+	(void)size;
+	return MAX_U32;
+#endif
+}
+
+void MemoryTag::freeSampledCallstack(U32 callstackIdx, PtrSize size)
+{
+	LockGuard<Mutex> lock(m_callstackMtx);
+	ANKI_ASSERT(callstackIdx < m_callstackCount);
+	ANKI_ASSERT(m_callstacks[callstackIdx].m_liveBytes >= size);
+	m_callstacks[callstackIdx].m_liveBytes -= size;
+}
+
+void MemoryTag::getStatistics(MemoryTagStatistics& stats) const
+{
+	stats.m_liveBytes = m_liveBytes.load();
+	stats.m_peakLiveBytes = m_peakLiveBytes.load();
+	stats.m_allocatedBytes = m_allocatedBytes.load();
+	stats.m_allocationCount = m_allocationCount.load();
+	stats.m_freeCount = m_freeCount.load();
+}
+
+void MemoryTag::endFrame()
+{
+	MemoryTagStatistics stats;
+	getStatistics(stats);
+
+	// Check the budget. Warn once every time it's exceeded
+	const Bool overBudget = m_budget > 0 && stats.m_liveBytes > m_budget;
+	if(overBudget && !m_overBudget)
+	{
+		ANKI_UTIL_LOGW("Memory tag %s exceeded its budget: %" PRIu64 "KB of %" PRIu64 "KB", m_name,
+					   U64(stats.m_liveBytes / 1024), U64(m_budget / 1024));
+	}
+	m_overBudget = overBudget;
+
+#if ANKI_ENABLE_TRACE
+	if(TracerSingleton::isInitialized() && TracerSingleton::get().getEnabled())
+	{
+		Tracer& tracer = TracerSingleton::get();
+		tracer.incrementCounter(&m_liveBytesCounterName[0], stats.m_liveBytes);
+		tracer.incrementCounter(&m_allocatedBytesCounterName[0], stats.m_allocatedBytes - m_prevFrameAllocatedBytes);
+		tracer.incrementCounter(&m_allocationCountCounterName[0],
+								stats.m_allocationCount - m_prevFrameAllocationCount);
+	}
+#endif
+
+	m_prevFrameAllocatedBytes = stats.m_allocatedBytes;
+	m_prevFrameAllocationCount = stats.m_allocationCount;
+}
+
+void MemoryTag::logSampledCallstacks(U32 maxCount) const
+{
+	LockGuard<Mutex> lock(m_callstackMtx);
+
+	if(m_callstackCount == 0)
+	{
+		ANKI_UTIL_LOGI("Memory tag %s has no sampled callstacks", m_name);
+		return;
+	}
+
+	Array<U32, MAX_CALLSTACKS> indices;
+	for(U32 i = 0; i < m_callstackCount; ++i)
+	{
+		indices[i] = i;
+	}
+
+	std::sort(indices.getBegin(), indices.getBegin() + m_callstackCount, [this](U32 a, U32 b) {
+		return m_callstacks[a].m_liveBytes > m_callstacks[b].m_liveBytes
+			   || (m_callstacks[a].m_liveBytes == m_callstacks[b].m_liveBytes
+				   && m_callstacks[a].m_sampleCount > m_callstacks[b].m_sampleCount);
+	});
+
+	for(U32 i = 0; i < min(maxCount, m_callstackCount); ++i)
+	{
+		const Callstack& callstack = m_callstacks[indices[i]];
+		ANKI_UTIL_LOGI("Memory tag %s callstack #%u: %" PRIu64 " samples, %" PRIu64 " live bytes", m_name, i,
+					   callstack.m_sampleCount, U64(callstack.m_liveBytes));
+
+#if ANKI_POSIX && !ANKI_OS_ANDROID
+		char** symbols = backtrace_symbols(&callstack.m_frames[0], I32(callstack.m_frameCount));
+		for(U32 f = 0; f < callstack.m_frameCount; ++f)
+		{
+			ANKI_UTIL_LOGI("    %s", (symbols) ? symbols[f] : "?");
+		}
+		::free(symbols);
+#endif
+	}
+}
+
+} // end namespace anki
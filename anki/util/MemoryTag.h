@@ -0,0 +1,118 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/Memory.h>
+
+namespace anki
+{
+
+/// @addtogroup util_memory
+/// @{
+
+/// Memory statistics of a MemoryTag.
+class MemoryTagStatistics
+{
+public:
+	PtrSize m_liveBytes = 0;
+	PtrSize m_peakLiveBytes = 0;
+	PtrSize m_allocatedBytes = 0; ///< All the bytes that were ever allocated.
+	U64 m_allocationCount = 0;
+	U64 m_freeCount = 0;
+};
+
+/// Tracks the memory that goes through an allocation callback. Initialize a memory pool with
+/// MemoryTag::allocCallback and a tag as user data and the tag will own the memory of that pool. Many pools can share a
+/// tag (all the pools of a subsystem for example) and tags can have a parent to build a hierarchy.
+class MemoryTag : public NonCopyable
+{
+public:
+	static constexpr U32 MAX_CALLSTACKS = 256;
+	static constexpr U32 MAX_CALLSTACK_DEPTH = 16;
+
+	MemoryTag() = default;
+
+	~MemoryTag();
+
+	/// @param name The name of the tag. Should be a static string.
+	/// @param allocCb The callback that does the real allocations.
+	/// @param allocCbUserData The user data of allocCb.
+	/// @param parent An optional tag that will also own the memory of this one.
+	void init(const char* name, AllocAlignedCallback allocCb, void* allocCbUserData, MemoryTag* parent = nullptr);
+
+	/// The callback to pass to the memory pools. The user data should be a MemoryTag.
+	static void* allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment);
+
+	const char* getName() const
+	{
+		return m_name;
+	}
+
+	/// Log a warning when the live bytes exceed the budget. Zero means no budget.
+	void setBudget(PtrSize bytes)
+	{
+		m_budget = bytes;
+	}
+
+	/// Capture the callstack of every rate-th allocation. Zero disables the sampling.
+	void setCallstackSamplingRate(U32 rate)
+	{
+		m_callstackSamplingRate = rate;
+	}
+
+	void getStatistics(MemoryTagStatistics& stats) const;
+
+	/// Call it once per frame. It checks the budget and streams the live bytes and the allocations of the frame to the
+	/// tracer counters.
+	void endFrame();
+
+	/// Log the sampled callstacks that have the most live bytes. Useful to hunt leaks.
+	void logSampledCallstacks(U32 maxCount) const;
+
+private:
+	class Header;
+	class Callstack;
+
+	const char* m_name = nullptr;
+	AllocAlignedCallback m_allocCb = nullptr;
+	void* m_allocCbUserData = nullptr;
+	MemoryTag* m_parent = nullptr;
+
+	Atomic<PtrSize> m_liveBytes = {0};
+	Atomic<PtrSize> m_peakLiveBytes = {0};
+	Atomic<PtrSize> m_allocatedBytes = {0};
+	Atomic<U64> m_allocationCount = {0};
+	Atomic<U64> m_freeCount = {0};
+
+	PtrSize m_budget = 0;
+	Bool m_overBudget = false;
+
+	/// The values of the previous endFrame() to compute the deltas.
+	PtrSize m_prevFrameAllocatedBytes = 0;
+	U64 m_prevFrameAllocationCount = 0;
+
+	/// Tracer counter names.
+	Array<char, 64> m_liveBytesCounterName = {};
+	Array<char, 64> m_allocatedBytesCounterName = {};
+	Array<char, 64> m_allocationCountCounterName = {};
+
+	U32 m_callstackSamplingRate = 0;
+	Callstack* m_callstacks = nullptr; ///< Lazily allocated. MAX_CALLSTACKS of them.
+	U32 m_callstackCount = 0;
+	mutable Mutex m_callstackMtx;
+
+	void trackAllocation(PtrSize size);
+
+	void trackFree(PtrSize size);
+
+	/// Capture the current callstack and return its index. MAX_U32 if it's not possible.
+	U32 sampleCallstack(PtrSize size);
+
+	void freeSampledCallstack(U32 callstackIdx, PtrSize size);
+};
+/// @}
+
+} // end namespace anki
@@ -195,37 +195,49 @@ Error BinaryDeserializer::deserialize(T*& x, GenericMemoryPoolAllocator<U8> allo
 		}
 	}
 
-	// Allocate & read data
-	U8* const baseAddress =
-		static_cast<U8*>(allocator.getMemoryPool().allocate(header.m_dataSize, ANKI_SAFE_ALIGNMENT));
-	ANKI_CHECK(file.read(baseAddress, header.m_dataSize));
+	if(header.m_pointerCount && header.m_pointerArrayFilePosition != dataFilePos + header.m_dataSize)
+	{
+		ANKI_UTIL_LOGE("The pointer array should follow the data");
+		return Error::USER_DATA;
+	}
+
+	// Allocate & read the data and the pointer array with a single read. The pointer array stays at the end of the
+	// allocation
+	const PtrSize pointerArraySize = header.m_pointerCount * sizeof(PtrSize);
+	U8* const baseAddress = static_cast<U8*>(
+		allocator.getMemoryPool().allocate(header.m_dataSize + pointerArraySize, ANKI_SAFE_ALIGNMENT));
+	Error err = file.read(baseAddress, header.m_dataSize + pointerArraySize);
 
 	// Fix pointers
-	if(header.m_pointerCount)
+	for(PtrSize i = 0; i < header.m_pointerCount && !err; ++i)
 	{
-		ANKI_CHECK(file.seek(header.m_pointerArrayFilePosition, FileSeekOrigin::BEGINNING));
-		for(PtrSize i = 0; i < header.m_pointerCount; ++i)
+		// Read the location of the pointer. The array might not be aligned
+		PtrSize offsetFromBeginOfData;
+		memcpy(&offsetFromBeginOfData, baseAddress + header.m_dataSize + i * sizeof(PtrSize), sizeof(PtrSize));
+		if(offsetFromBeginOfData + sizeof(PtrSize) > header.m_dataSize)
+		{
+			ANKI_UTIL_LOGE("Corrupt pointer");
+			err = Error::USER_DATA;
+			break;
+		}
+
+		// Add to the location the actual base address
+		U8* ptrLocation = baseAddress + offsetFromBeginOfData;
+		PtrSize& ptrValue = *reinterpret_cast<PtrSize*>(ptrLocation);
+		if(ptrValue >= header.m_dataSize)
 		{
-			// Read the location of the pointer
-			PtrSize offsetFromBeginOfData;
-			ANKI_CHECK(file.read(&offsetFromBeginOfData, sizeof(offsetFromBeginOfData)));
-			if(offsetFromBeginOfData >= header.m_dataSize)
-			{
-				ANKI_UTIL_LOGE("Corrupt pointer");
-				return Error::USER_DATA;
-			}
-
-			// Add to the location the actual base address
-			U8* ptrLocation = baseAddress + offsetFromBeginOfData;
-			PtrSize& ptrValue = *reinterpret_cast<PtrSize*>(ptrLocation);
-			if(ptrValue >= header.m_dataSize)
-			{
-				ANKI_UTIL_LOGE("Corrupt pointer");
-				return Error::USER_DATA;
-			}
-
-			ptrValue += ptrToNumber(baseAddress);
+			ANKI_UTIL_LOGE("Corrupt pointer");
+			err = Error::USER_DATA;
+			break;
 		}
+
+		ptrValue += ptrToNumber(baseAddress);
+	}
+
+	if(err)
+	{
+		allocator.getMemoryPool().free(baseAddress);
+		return err;
 	}
 
 	// Done
@@ -82,6 +82,11 @@ public:
 		return *m_instance;
 	}
 
+	static Bool isInitialized()
+	{
+		return m_instance != nullptr;
+	}
+
 	/// Cleanup
 	static void destroy()
 	{
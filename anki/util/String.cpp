@@ -310,4 +310,105 @@ String& String::replaceAll(Allocator alloc, CString from, CString to)
 	return *this;
 }
 
+void StringInlineBase::reserve(PtrSize length)
+{
+	if(length + 1 <= m_capacity)
+	{
+		return;
+	}
+
+	const PtrSize newCapacity = max(length + 1, m_capacity * 2);
+	Char* newData = static_cast<Char*>(m_alloc.getMemoryPool().allocate(newCapacity, alignof(Char)));
+	if(ANKI_UNLIKELY(newData == nullptr))
+	{
+		ANKI_UTIL_LOGF("Out of memory");
+	}
+
+	memcpy(newData, m_data, m_length + 1);
+
+	if(!isInline())
+	{
+		m_alloc.getMemoryPool().free(m_data);
+	}
+
+	m_data = newData;
+	m_capacity = newCapacity;
+}
+
+StringInlineBase& StringInlineBase::append(ConstIterator first, ConstIterator oneAfterLast)
+{
+	ANKI_ASSERT(first && oneAfterLast >= first);
+	const PtrSize len = oneAfterLast - first;
+	reserve(m_length + len);
+	memcpy(m_data + m_length, first, len);
+	m_length += len;
+	m_data[m_length] = '\0';
+	return *this;
+}
+
+StringInlineBase& StringInlineBase::sprintf(const Char* fmt, ...)
+{
+	ANKI_ASSERT(fmt);
+	va_list args;
+
+	// Try to write it to the current storage first
+	va_start(args, fmt);
+	I len = std::vsnprintf(m_data, m_capacity, fmt, args);
+	va_end(args);
+
+	if(len < 0)
+	{
+		ANKI_UTIL_LOGF("vsnprintf() failed");
+	}
+	else if(PtrSize(len) >= m_capacity)
+	{
+		m_length = 0;
+		reserve(PtrSize(len));
+
+		va_start(args, fmt);
+		len = std::vsnprintf(m_data, m_capacity, fmt, args);
+		va_end(args);
+		ANKI_ASSERT(PtrSize(len) < m_capacity);
+	}
+
+	m_length = PtrSize(len);
+	return *this;
+}
+
+void StringInlineBase::destroy()
+{
+	if(!isInline())
+	{
+		m_alloc.getMemoryPool().free(m_data);
+		m_data = m_inlineData;
+		m_capacity = m_inlineCapacity;
+	}
+
+	m_length = 0;
+	m_data[0] = '\0';
+}
+
+void StringInlineBase::move(StringInlineBase& b)
+{
+	ANKI_ASSERT(this != &b && isInline() && m_length == 0);
+	m_alloc = b.m_alloc;
+
+	if(b.isInline())
+	{
+		create(b.toCString());
+	}
+	else
+	{
+		m_data = b.m_data;
+		m_length = b.m_length;
+		m_capacity = b.m_capacity;
+
+		b.m_data = b.m_inlineData;
+		b.m_capacity = b.m_inlineCapacity;
+	}
+
+	b.m_length = 0;
+	b.m_data[0] = '\0';
+}
+
 } // end namespace anki
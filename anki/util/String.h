@@ -828,6 +828,290 @@ private:
 	}
 };
 
+/// The part of StringInline that doesn't depend on the size of the inline storage.
+class StringInlineBase
+{
+public:
+	using Char = char;
+	using Iterator = Char*;
+	using ConstIterator = const Char*;
+	using Allocator = GenericMemoryPoolAllocator<Char>;
+
+	StringInlineBase(const StringInlineBase&) = delete; // Non-copyable
+
+	StringInlineBase& operator=(const StringInlineBase&) = delete; // Non-copyable
+
+	Char& operator[](PtrSize pos)
+	{
+		ANKI_ASSERT(pos < m_length);
+		return m_data[pos];
+	}
+
+	const Char& operator[](PtrSize pos) const
+	{
+		ANKI_ASSERT(pos < m_length);
+		return m_data[pos];
+	}
+
+	Bool operator==(CString b) const
+	{
+		return toCString() == b;
+	}
+
+	Bool operator==(const Char* b) const
+	{
+		return toCString() == CString(b);
+	}
+
+	Bool operator!=(CString b) const
+	{
+		return !(*this == b);
+	}
+
+	Bool operator!=(const Char* b) const
+	{
+		return !(*this == b);
+	}
+
+	operator CString() const
+	{
+		return toCString();
+	}
+
+	CString toCString() const
+	{
+		return CString(m_data);
+	}
+
+	const Char* cstr() const
+	{
+		return m_data;
+	}
+
+	Iterator getBegin()
+	{
+		return m_data;
+	}
+
+	ConstIterator getBegin() const
+	{
+		return m_data;
+	}
+
+	Iterator getEnd()
+	{
+		return m_data + m_length;
+	}
+
+	ConstIterator getEnd() const
+	{
+		return m_data + m_length;
+	}
+
+	Iterator begin()
+	{
+		return getBegin();
+	}
+
+	ConstIterator begin() const
+	{
+		return getBegin();
+	}
+
+	Iterator end()
+	{
+		return getEnd();
+	}
+
+	ConstIterator end() const
+	{
+		return getEnd();
+	}
+
+	/// Return the string's length. It doesn't count the terminating character.
+	PtrSize getLength() const
+	{
+		return m_length;
+	}
+
+	Bool isEmpty() const
+	{
+		return m_length == 0;
+	}
+
+	/// Return true if the string still fits in the inline storage.
+	Bool isInline() const
+	{
+		return m_data == m_inlineData;
+	}
+
+	/// Convert to a number.
+	template<typename TNumber>
+	ANKI_USE_RESULT Error toNumber(TNumber& out) const
+	{
+		return toCString().toNumber(out);
+	}
+
+	U64 computeHash() const
+	{
+		ANKI_ASSERT(!isEmpty());
+		return anki::computeHash(m_data, m_length);
+	}
+
+	/// Initialize using a const string.
+	void create(CString cstr)
+	{
+		m_length = 0;
+		append(cstr);
+	}
+
+	/// Initialize using a range. Copies the range of [first, last)
+	void create(ConstIterator first, ConstIterator last)
+	{
+		m_length = 0;
+		append(first, last);
+	}
+
+	/// Append a const string to this one.
+	StringInlineBase& append(CString cstr)
+	{
+		return (cstr.isEmpty()) ? *this : append(cstr.getBegin(), cstr.getEnd());
+	}
+
+	/// Append using a range. Copies the range of [first, oneAfterLast)
+	StringInlineBase& append(ConstIterator first, ConstIterator oneAfterLast);
+
+	/// Create formated string.
+	/// @note The arguments shouldn't point to this string.
+	StringInlineBase& sprintf(const Char* fmt, ...);
+
+	/// Free the allocated memory, if any, and make the string empty.
+	void destroy();
+
+	GenericMemoryPoolAllocator<Char> getAllocator() const
+	{
+		return m_alloc;
+	}
+
+protected:
+	Allocator m_alloc;
+	Char* m_data; ///< Points to m_inlineData or to allocated memory.
+	Char* m_inlineData;
+	PtrSize m_length = 0;
+	PtrSize m_capacity; ///< Max length plus the terminating character.
+	PtrSize m_inlineCapacity;
+
+	StringInlineBase(Allocator alloc, Char* inlineData, PtrSize inlineCapacity)
+		: m_alloc(alloc)
+		, m_data(inlineData)
+		, m_inlineData(inlineData)
+		, m_capacity(inlineCapacity)
+		, m_inlineCapacity(inlineCapacity)
+	{
+		ANKI_ASSERT(inlineData && inlineCapacity > 0);
+		m_inlineData[0] = '\0';
+	}
+
+	~StringInlineBase()
+	{
+		destroy();
+	}
+
+	/// Make room for a string of some length. It keeps the old characters.
+	void reserve(PtrSize length);
+
+	/// Steal the memory of another string or copy its inline characters.
+	void move(StringInlineBase& b);
+};
+
+/// A string with inline storage for N characters, including the terminating character. It only touches the
+/// allocator when the string outgrows that storage. Use it for short lived strings like filenames and tokens.
+template<U32 N>
+class StringInline : public StringInlineBase
+{
+public:
+	using Base = StringInlineBase;
+
+	StringInline(Allocator alloc)
+		: Base(alloc, &m_inlineStorage[0], N)
+	{
+	}
+
+	/// Create with allocator and data.
+	StringInline(Allocator alloc, CString cstr)
+		: StringInline(alloc)
+	{
+		create(cstr);
+	}
+
+	/// Copy.
+	StringInline(const StringInline& b)
+		: StringInline(b.m_alloc)
+	{
+		create(b.toCString());
+	}
+
+	/// Move.
+	StringInline(StringInline&& b)
+		: StringInline(b.m_alloc)
+	{
+		move(b);
+	}
+
+	/// Copy.
+	StringInline& operator=(const StringInline& b)
+	{
+		if(this != &b)
+		{
+			create(b.toCString());
+		}
+		return *this;
+	}
+
+	/// Copy from string.
+	StringInline& operator=(CString b)
+	{
+		create(b);
+		return *this;
+	}
+
+	/// Move.
+	StringInline& operator=(StringInline&& b)
+	{
+		if(this != &b)
+		{
+			destroy();
+			move(b);
+		}
+		return *this;
+	}
+
+	/// @copydoc StringInlineBase::append
+	StringInline& append(CString cstr)
+	{
+		Base::append(cstr);
+		return *this;
+	}
+
+	/// @copydoc StringInlineBase::append
+	StringInline& append(ConstIterator first, ConstIterator oneAfterLast)
+	{
+		Base::append(first, oneAfterLast);
+		return *this;
+	}
+
+	/// Create formated string.
+	template<typename... TArgs>
+	StringInline& sprintf(const Char* fmt, TArgs... args)
+	{
+		Base::sprintf(fmt, args...);
+		return *this;
+	}
+
+private:
+	Array<Char, N> m_inlineStorage;
+};
+
 #define ANKI_STRING_COMPARE_OPERATOR(TypeA, TypeB, op) \
 	inline Bool operator op(TypeA a, TypeB b) \
 	{ \
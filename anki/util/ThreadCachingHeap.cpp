@@ -0,0 +1,456 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/ThreadCachingHeap.h>
+#include <anki/util/Functions.h>
+#include <anki/util/Thread.h>
+#include <anki/util/Logger.h>
+#include <cstring>
+
+namespace anki
+{
+
+/// The block sizes of the size classes. They include the BlockHeader.
+static constexpr Array<U32, ThreadCachingHeap::SIZE_CLASS_COUNT> SIZE_CLASS_BLOCK_SIZES = {
+	{32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096}};
+
+static constexpr U32 LARGE_SIZE_CLASS = ThreadCachingHeap::SIZE_CLASS_COUNT;
+
+/// The depot carves that many batches every time it runs out of blocks.
+static constexpr U32 BATCHES_PER_SPAN = 4;
+
+/// Sits right before the memory returned to the user.
+class ThreadCachingHeap::BlockHeader
+{
+public:
+	void* m_largeBase; ///< The memory the allocation callback returned. Only for large allocations.
+	U32 m_sizeClass;
+	U32 m_padding;
+};
+
+/// A free block. It overlays the memory of the block.
+class ThreadCachingHeap::Block
+{
+public:
+	Block* m_next;
+	Block* m_nextBatch; ///< Only valid for the first block of a batch in the depot.
+	U32 m_batchSize; ///< Only valid for the first block of a batch in the depot.
+};
+
+/// A chunk of memory that was carved into blocks. It sits at the start of the chunk.
+class ThreadCachingHeap::Span
+{
+public:
+	Span* m_next;
+	PtrSize m_size;
+};
+
+class ThreadCachingHeap::ThreadCache
+{
+public:
+	class FreeList
+	{
+	public:
+		Block* m_head;
+		U32 m_count;
+	};
+
+	Array<FreeList, SIZE_CLASS_COUNT> m_freeLists;
+
+	/// Written only by the owner thread. Atomic so getStatistics() can read them.
+	Array<Atomic<U64>, SIZE_CLASS_COUNT> m_allocationCounts;
+	Array<Atomic<U64>, SIZE_CLASS_COUNT> m_freeCounts;
+
+	I64 m_pendingLiveBytes; ///< Not flushed to the heap yet.
+
+	void init()
+	{
+		for(U32 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+		{
+			m_freeLists[sizeClass].m_head = nullptr;
+			m_freeLists[sizeClass].m_count = 0;
+			m_allocationCounts[sizeClass].setNonAtomically(0);
+			m_freeCounts[sizeClass].setNonAtomically(0);
+		}
+
+		m_pendingLiveBytes = 0;
+	}
+};
+
+class ThreadCachingHeap::Depot
+{
+public:
+	SpinLock m_lock;
+	Block* m_batches = nullptr;
+	Span* m_spans = nullptr;
+};
+
+ThreadCachingHeap::ThreadCachingHeap(AllocAlignedCallback allocCb, void* allocCbUserData)
+	: m_allocCb(allocCb)
+	, m_allocCbUserData(allocCbUserData)
+{
+	ANKI_ASSERT(allocCb);
+	static_assert(sizeof(BlockHeader) == ANKI_SAFE_ALIGNMENT, "Keep the user memory aligned");
+	static_assert(sizeof(Block) <= 32, "Should fit the smallest size class");
+	static_assert(sizeof(Span) == ANKI_SAFE_ALIGNMENT, "Keep the blocks aligned");
+
+	for(Atomic<ThreadCache*>& cache : m_threadCaches)
+	{
+		cache.setNonAtomically(nullptr);
+	}
+
+	for(Atomic<U64>& count : m_uncachedFreeCounts)
+	{
+		count.setNonAtomically(0);
+	}
+
+	m_depots = static_cast<Depot*>(m_allocCb(m_allocCbUserData, nullptr, sizeof(Depot) * SIZE_CLASS_COUNT,
+											 alignof(Depot)));
+	if(ANKI_UNLIKELY(m_depots == nullptr))
+	{
+		ANKI_UTIL_LOGF("Out of memory");
+	}
+
+	for(U32 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+	{
+		::new(&m_depots[sizeClass]) Depot();
+	}
+}
+
+ThreadCachingHeap::~ThreadCachingHeap()
+{
+	for(Atomic<ThreadCache*>& cache : m_threadCaches)
+	{
+		if(cache.getNonAtomically())
+		{
+			cache.getNonAtomically()->~ThreadCache();
+			m_allocCb(m_allocCbUserData, cache.getNonAtomically(), 0, 0);
+		}
+	}
+
+	for(U32 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+	{
+		Span* span = m_depots[sizeClass].m_spans;
+		while(span)
+		{
+			Span* next = span->m_next;
+			m_allocCb(m_allocCbUserData, span, 0, 0);
+			span = next;
+		}
+
+		m_depots[sizeClass].~Depot();
+	}
+
+	m_allocCb(m_allocCbUserData, m_depots, 0, 0);
+}
+
+PtrSize ThreadCachingHeap::getSizeClassBlockSize(U32 sizeClass)
+{
+	return SIZE_CLASS_BLOCK_SIZES[sizeClass];
+}
+
+U32 ThreadCachingHeap::computeSizeClass(PtrSize size)
+{
+	const PtrSize blockSize = size + sizeof(BlockHeader);
+	for(U32 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+	{
+		if(blockSize <= SIZE_CLASS_BLOCK_SIZES[sizeClass])
+		{
+			return sizeClass;
+		}
+	}
+
+	return LARGE_SIZE_CLASS;
+}
+
+U32 ThreadCachingHeap::computeBatchSize(U32 sizeClass)
+{
+	// Move around 16K at a time
+	return min(max(U32(16_KB) / SIZE_CLASS_BLOCK_SIZES[sizeClass], 4u), 64u);
+}
+
+ThreadCachingHeap::ThreadCache* ThreadCachingHeap::getThreadCache()
+{
+	const U32 slot = detail::getThreadSlot();
+	if(ANKI_UNLIKELY(slot == MAX_U32))
+	{
+		return nullptr;
+	}
+
+	// Only the thread that owns the slot touches the cache so there is no race
+	ThreadCache* cache = m_threadCaches[slot].load(AtomicMemoryOrder::ACQUIRE);
+	if(ANKI_UNLIKELY(cache == nullptr))
+	{
+		cache = static_cast<ThreadCache*>(
+			m_allocCb(m_allocCbUserData, nullptr, sizeof(ThreadCache), alignof(ThreadCache)));
+		if(ANKI_UNLIKELY(cache == nullptr))
+		{
+			return nullptr;
+		}
+
+		::new(cache) ThreadCache();
+		cache->init();
+		m_threadCaches[slot].store(cache, AtomicMemoryOrder::RELEASE);
+	}
+
+	return cache;
+}
+
+void* ThreadCachingHeap::allocate(PtrSize size, PtrSize alignment)
+{
+	ANKI_ASSERT(size > 0);
+	const U32 sizeClass = computeSizeClass(size);
+	ThreadCache* cache;
+	if(ANKI_UNLIKELY(sizeClass == LARGE_SIZE_CLASS || alignment > ANKI_SAFE_ALIGNMENT
+					 || (cache = getThreadCache()) == nullptr))
+	{
+		return allocateLarge(size, alignment);
+	}
+
+	ThreadCache::FreeList& list = cache->m_freeLists[sizeClass];
+	if(ANKI_UNLIKELY(list.m_head == nullptr) && !refill(*cache, sizeClass))
+	{
+		ANKI_UTIL_LOGE("Out of memory");
+		return nullptr;
+	}
+
+	Block* block = list.m_head;
+	list.m_head = block->m_next;
+	--list.m_count;
+
+	Atomic<U64>& count = cache->m_allocationCounts[sizeClass];
+	count.store(count.getNonAtomically() + 1);
+	cache->m_pendingLiveBytes += SIZE_CLASS_BLOCK_SIZES[sizeClass];
+
+	BlockHeader* header = reinterpret_cast<BlockHeader*>(block);
+	header->m_largeBase = nullptr;
+	header->m_sizeClass = sizeClass;
+	return header + 1;
+}
+
+void ThreadCachingHeap::free(void* ptr)
+{
+	if(ANKI_UNLIKELY(ptr == nullptr))
+	{
+		return;
+	}
+
+	BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+	const U32 sizeClass = header->m_sizeClass;
+	if(sizeClass == LARGE_SIZE_CLASS)
+	{
+		freeLarge(ptr);
+		return;
+	}
+
+	ANKI_ASSERT(sizeClass < SIZE_CLASS_COUNT);
+	ThreadCache* cache = getThreadCache();
+	Block* block = reinterpret_cast<Block*>(header);
+	if(ANKI_UNLIKELY(cache == nullptr))
+	{
+		// Threads without a cache give the blocks straight to the depot
+		giveBatchToDepot(sizeClass, block, 1);
+		m_uncachedFreeCounts[sizeClass].fetchAdd(1);
+		m_liveBytes.fetchSub(I64(SIZE_CLASS_BLOCK_SIZES[sizeClass]));
+		return;
+	}
+
+	ThreadCache::FreeList& list = cache->m_freeLists[sizeClass];
+	block->m_next = list.m_head;
+	list.m_head = block;
+	++list.m_count;
+
+	Atomic<U64>& count = cache->m_freeCounts[sizeClass];
+	count.store(count.getNonAtomically() + 1);
+	cache->m_pendingLiveBytes -= SIZE_CLASS_BLOCK_SIZES[sizeClass];
+
+	// Keep at most 2 batches around and give the rest to the depot
+	const U32 batchSize = computeBatchSize(sizeClass);
+	if(ANKI_UNLIKELY(list.m_count >= batchSize * 2))
+	{
+		Block* batch = list.m_head;
+		Block* last = batch;
+		for(U32 i = 1; i < batchSize; ++i)
+		{
+			last = last->m_next;
+		}
+
+		list.m_head = last->m_next;
+		list.m_count -= batchSize;
+		last->m_next = nullptr;
+
+		giveBatchToDepot(sizeClass, batch, batchSize);
+		flushLiveBytes(*cache);
+	}
+}
+
+void* ThreadCachingHeap::allocateLarge(PtrSize size, PtrSize alignment)
+{
+	// Layout: [size] ... [BlockHeader][user memory]
+	alignment = max<PtrSize>(alignment, ANKI_SAFE_ALIGNMENT);
+	const PtrSize offset = getAlignedRoundUp(alignment, sizeof(PtrSize) + sizeof(BlockHeader));
+	const PtrSize totalSize = offset + size;
+
+	U8* base = static_cast<U8*>(m_allocCb(m_allocCbUserData, nullptr, totalSize, alignment));
+	if(ANKI_UNLIKELY(base == nullptr))
+	{
+		ANKI_UTIL_LOGE("Out of memory");
+		return nullptr;
+	}
+
+	*reinterpret_cast<PtrSize*>(base) = totalSize;
+
+	U8* out = base + offset;
+	BlockHeader* header = reinterpret_cast<BlockHeader*>(out) - 1;
+	header->m_largeBase = base;
+	header->m_sizeClass = LARGE_SIZE_CLASS;
+
+	m_largeAllocationCount.fetchAdd(1);
+	m_largeLiveBytes.fetchAdd(totalSize);
+	const I64 live = m_liveBytes.fetchAdd(I64(totalSize)) + I64(totalSize);
+	m_peakLiveBytes.max(PtrSize(max<I64>(live, 0)));
+
+	return out;
+}
+
+void ThreadCachingHeap::freeLarge(void* ptr)
+{
+	BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+	void* base = header->m_largeBase;
+	const PtrSize totalSize = *static_cast<PtrSize*>(base);
+
+	m_largeFreeCount.fetchAdd(1);
+	m_largeLiveBytes.fetchSub(totalSize);
+	m_liveBytes.fetchSub(I64(totalSize));
+
+	m_allocCb(m_allocCbUserData, base, 0, 0);
+}
+
+Bool ThreadCachingHeap::refill(ThreadCache& cache, U32 sizeClass)
+{
+	flushLiveBytes(cache);
+
+	Depot& depot = m_depots[sizeClass];
+	ThreadCache::FreeList& list = cache.m_freeLists[sizeClass];
+	ANKI_ASSERT(list.m_head == nullptr);
+
+	// Try to get a batch from the depot
+	{
+		LockGuard<SpinLock> lock(depot.m_lock);
+		if(depot.m_batches)
+		{
+			Block* batch = depot.m_batches;
+			depot.m_batches = batch->m_nextBatch;
+			list.m_head = batch;
+			list.m_count = batch->m_batchSize;
+			return true;
+		}
+	}
+
+	// The depot is empty, carve a new span
+	const U32 blockSize = SIZE_CLASS_BLOCK_SIZES[sizeClass];
+	const U32 batchSize = computeBatchSize(sizeClass);
+	const PtrSize spanSize = sizeof(Span) + PtrSize(blockSize) * batchSize * BATCHES_PER_SPAN;
+	Span* span = static_cast<Span*>(m_allocCb(m_allocCbUserData, nullptr, spanSize, ANKI_SAFE_ALIGNMENT));
+	if(ANKI_UNLIKELY(span == nullptr))
+	{
+		return false;
+	}
+
+	span->m_size = spanSize;
+	m_reservedBytes.fetchAdd(spanSize);
+
+	U8* mem = reinterpret_cast<U8*>(span + 1);
+	Array<Block*, BATCHES_PER_SPAN> batches;
+	for(U32 b = 0; b < BATCHES_PER_SPAN; ++b)
+	{
+		batches[b] = reinterpret_cast<Block*>(mem);
+		for(U32 i = 0; i < batchSize; ++i)
+		{
+			Block* block = reinterpret_cast<Block*>(mem);
+			mem += blockSize;
+			block->m_next = (i + 1 < batchSize) ? reinterpret_cast<Block*>(mem) : nullptr;
+		}
+
+		batches[b]->m_batchSize = batchSize;
+	}
+
+	list.m_head = batches[0];
+	list.m_count = batchSize;
+
+	LockGuard<SpinLock> lock(depot.m_lock);
+	span->m_next = depot.m_spans;
+	depot.m_spans = span;
+
+	for(U32 b = 1; b < BATCHES_PER_SPAN; ++b)
+	{
+		batches[b]->m_nextBatch = depot.m_batches;
+		depot.m_batches = batches[b];
+	}
+
+	return true;
+}
+
+void ThreadCachingHeap::giveBatchToDepot(U32 sizeClass, Block* batch, U32 blockCount)
+{
+	batch->m_batchSize = blockCount;
+
+	Depot& depot = m_depots[sizeClass];
+	LockGuard<SpinLock> lock(depot.m_lock);
+	batch->m_nextBatch = depot.m_batches;
+	depot.m_batches = batch;
+}
+
+void ThreadCachingHeap::flushLiveBytes(ThreadCache& cache)
+{
+	if(cache.m_pendingLiveBytes == 0)
+	{
+		return;
+	}
+
+	const I64 live = m_liveBytes.fetchAdd(cache.m_pendingLiveBytes) + cache.m_pendingLiveBytes;
+	cache.m_pendingLiveBytes = 0;
+	m_peakLiveBytes.max(PtrSize(max<I64>(live, 0)));
+}
+
+void ThreadCachingHeap::getStatistics(ThreadCachingHeapStatistics& stats) const
+{
+	stats = {};
+
+	PtrSize smallLiveBytes = 0;
+	for(const Atomic<ThreadCache*>& cachePtr : m_threadCaches)
+	{
+		const ThreadCache* cache = cachePtr.load(AtomicMemoryOrder::ACQUIRE);
+		if(cache == nullptr)
+		{
+			continue;
+		}
+
+		for(U32 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+		{
+			const U64 allocationCount = cache->m_allocationCounts[sizeClass].load();
+			const U64 freeCount = cache->m_freeCounts[sizeClass].load();
+			stats.m_allocationCounts[sizeClass] += allocationCount;
+			stats.m_freeCounts[sizeClass] += freeCount;
+			smallLiveBytes += PtrSize(allocationCount * SIZE_CLASS_BLOCK_SIZES[sizeClass]);
+			smallLiveBytes -= PtrSize(freeCount * SIZE_CLASS_BLOCK_SIZES[sizeClass]);
+		}
+	}
+
+	for(U32 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass)
+	{
+		const U64 freeCount = m_uncachedFreeCounts[sizeClass].load();
+		stats.m_freeCounts[sizeClass] += freeCount;
+		smallLiveBytes -= PtrSize(freeCount * SIZE_CLASS_BLOCK_SIZES[sizeClass]);
+	}
+
+	stats.m_allocationCounts[LARGE_SIZE_CLASS] = m_largeAllocationCount.load();
+	stats.m_freeCounts[LARGE_SIZE_CLASS] = m_largeFreeCount.load();
+	stats.m_liveBytes = smallLiveBytes + m_largeLiveBytes.load();
+	stats.m_peakLiveBytes = max(m_peakLiveBytes.load(), stats.m_liveBytes);
+	stats.m_reservedBytes = m_reservedBytes.load();
+}
+
+} // end namespace anki
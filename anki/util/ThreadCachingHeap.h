@@ -0,0 +1,109 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/Memory.h>
+
+namespace anki
+{
+
+/// @addtogroup util_memory
+/// @{
+
+/// Statistics of a ThreadCachingHeap.
+class ThreadCachingHeapStatistics
+{
+public:
+	static constexpr U32 SIZE_CLASS_COUNT = 15;
+
+	/// The bytes of the blocks that are in use. Small allocations count the whole block of their size class.
+	PtrSize m_liveBytes = 0;
+
+	/// The max of m_liveBytes. It's sampled when the thread caches talk to the depot so it's accurate to a few batches.
+	PtrSize m_peakLiveBytes = 0;
+
+	/// The memory taken from the allocation callback to back the size classes.
+	PtrSize m_reservedBytes = 0;
+
+	/// Allocations per size class. The last element counts the allocations that bypass the size classes.
+	Array<U64, SIZE_CLASS_COUNT + 1> m_allocationCounts = {};
+
+	/// Frees per size class. The last element counts the allocations that bypass the size classes.
+	Array<U64, SIZE_CLASS_COUNT + 1> m_freeCounts = {};
+};
+
+/// A general purpose heap that serves small allocations from size classes. Every thread keeps a free list per size
+/// class and allocates and frees without locking. Blocks move between the thread caches and a global depot in batches.
+/// Large allocations and allocations with big alignment go straight to the allocation callback. The memory of the size
+/// classes is given back to the allocation callback when the heap is destroyed.
+class ThreadCachingHeap : public NonCopyable
+{
+public:
+	static constexpr U32 SIZE_CLASS_COUNT = ThreadCachingHeapStatistics::SIZE_CLASS_COUNT;
+
+	/// The max number of threads that have a cache. The rest go straight to the allocation callback.
+	static constexpr U32 MAX_CACHED_THREADS = detail::MAX_THREAD_SLOTS;
+
+	ThreadCachingHeap(AllocAlignedCallback allocCb, void* allocCbUserData);
+
+	~ThreadCachingHeap();
+
+	/// Allocate memory. It's thread safe.
+	void* allocate(PtrSize size, PtrSize alignment);
+
+	/// Free memory. It's thread safe and the memory can be freed by any thread.
+	void free(void* ptr);
+
+	/// Gather the statistics of all threads.
+	void getStatistics(ThreadCachingHeapStatistics& stats) const;
+
+	/// The size of the blocks of a size class. It includes a small header.
+	static PtrSize getSizeClassBlockSize(U32 sizeClass);
+
+private:
+	class Block;
+	class BlockHeader;
+	class Span;
+	class ThreadCache;
+	class Depot;
+
+	AllocAlignedCallback m_allocCb;
+	void* m_allocCbUserData;
+
+	Array<Atomic<ThreadCache*>, MAX_CACHED_THREADS> m_threadCaches;
+	Depot* m_depots = nullptr; ///< One per size class.
+
+	Atomic<I64> m_liveBytes = {0}; ///< The live bytes the thread caches flushed plus the large ones. For the peak.
+	Atomic<PtrSize> m_largeLiveBytes = {0};
+	Atomic<PtrSize> m_peakLiveBytes = {0};
+	Atomic<PtrSize> m_reservedBytes = {0};
+	Atomic<U64> m_largeAllocationCount = {0};
+	Atomic<U64> m_largeFreeCount = {0};
+	Array<Atomic<U64>, SIZE_CLASS_COUNT> m_uncachedFreeCounts; ///< Frees of threads that don't have a cache.
+
+	/// Get the cache of the calling thread. Returns nullptr if the thread can't have one.
+	ThreadCache* getThreadCache();
+
+	void* allocateLarge(PtrSize size, PtrSize alignment);
+
+	void freeLarge(void* ptr);
+
+	/// Refill the free list of a thread cache. Returns false on OOM.
+	Bool refill(ThreadCache& cache, U32 sizeClass);
+
+	/// Give a batch of blocks back to the depot.
+	void giveBatchToDepot(U32 sizeClass, Block* batch, U32 blockCount);
+
+	/// Flush the live bytes of a thread cache to the heap and update the peak.
+	void flushLiveBytes(ThreadCache& cache);
+
+	static U32 computeSizeClass(PtrSize size);
+
+	static U32 computeBatchSize(U32 sizeClass);
+};
+/// @}
+
+} // end namespace anki
@@ -5,19 +5,56 @@
 
 #include <anki/util/Tracer.h>
 #include <anki/util/HighRezTimer.h>
-#include <anki/util/HashMap.h>
-#include <anki/util/List.h>
+#include <anki/util/Functions.h>
 
 namespace anki
 {
 
-class Tracer::Chunk : public IntrusiveListEnabled<Chunk>
+/// A single producer single consumer ring. The owner thread writes and the flush reads.
+template<typename T, U32 CAPACITY>
+class Tracer::Ring
 {
 public:
-	Array<TracerEvent, EVENTS_PER_CHUNK> m_events;
-	U32 m_eventCount = 0;
-	Array<TracerCounter, COUNTERS_PER_CHUNK> m_counters;
-	U32 m_counterCount = 0;
+	static_assert(isPowerOfTwo(CAPACITY), "Should be power of two");
+
+	Array<T, CAPACITY> m_records;
+	Atomic<U32> m_writePos = {0}; ///< Only the owner thread writes that.
+	Atomic<U32> m_readPos = {0}; ///< Only the flush writes that.
+
+	/// Get a record to write to. Returns nullptr if the ring is full.
+	T* beginWrite()
+	{
+		const U32 writePos = m_writePos.load(AtomicMemoryOrder::RELAXED);
+		if(writePos - m_readPos.load(AtomicMemoryOrder::ACQUIRE) >= CAPACITY)
+		{
+			return nullptr;
+		}
+
+		return &m_records[writePos & (CAPACITY - 1)];
+	}
+
+	/// Publish the record returned by beginWrite().
+	void endWrite()
+	{
+		m_writePos.store(m_writePos.load(AtomicMemoryOrder::RELAXED) + 1, AtomicMemoryOrder::RELEASE);
+	}
+
+	/// Pass the published records to a functor. The functor will be called at most twice.
+	template<typename TFunc>
+	void consume(TFunc func)
+	{
+		const U32 writePos = m_writePos.load(AtomicMemoryOrder::ACQUIRE);
+		U32 readPos = m_readPos.load(AtomicMemoryOrder::RELAXED);
+		while(readPos != writePos)
+		{
+			const U32 first = readPos & (CAPACITY - 1);
+			const U32 count = min(writePos - readPos, CAPACITY - first);
+			func(ConstWeakArray<T>(&m_records[first], count));
+			readPos += count;
+		}
+
+		m_readPos.store(readPos, AtomicMemoryOrder::RELEASE);
+	}
 };
 
 /// Thread local storage.
@@ -25,58 +62,53 @@ class alignas(ANKI_CACHE_LINE_SIZE) Tracer::ThreadLocal
 {
 public:
 	ThreadId m_tid = 0;
+	ThreadLocal* m_next = nullptr;
 
-	Chunk* m_currentChunk = nullptr;
-	IntrusiveList<Chunk> m_allChunks;
-	SpinLock m_currentChunkLock;
+	Ring<TracerEvent, EVENTS_PER_THREAD> m_events;
+	Ring<TracerCounter, COUNTERS_PER_THREAD> m_counters;
 };
 
 thread_local Tracer::ThreadLocal* Tracer::m_threadLocal = nullptr;
+thread_local U64 Tracer::m_threadLocalTracerUuid = 0;
+Atomic<U64> Tracer::m_nextUuid = {1};
+
+Tracer::Tracer(GenericMemoryPoolAllocator<U8> alloc)
+	: m_alloc(alloc)
+	, m_uuid(m_nextUuid.fetchAdd(1))
+{
+}
 
 Tracer::~Tracer()
 {
-	LockGuard<Mutex> lock(m_allThreadLocalMtx);
-	for(ThreadLocal* tlocal : m_allThreadLocal)
+	ThreadLocal* tlocal = m_threadLocalHead.load(AtomicMemoryOrder::ACQUIRE);
+	while(tlocal)
 	{
+		ThreadLocal* next = tlocal->m_next;
 		m_alloc.deleteInstance(tlocal);
+		tlocal = next;
 	}
-	m_allThreadLocal.destroy(m_alloc);
 }
 
 Tracer::ThreadLocal& Tracer::getThreadLocal()
 {
-	ThreadLocal* out = m_threadLocal;
-	if(ANKI_UNLIKELY(out == nullptr))
+	// The thread local might belong to another Tracer if they got re-created so check the unique ID. A thread that
+	// alternates between Tracers will allocate a new ThreadLocal every time
+	if(ANKI_LIKELY(m_threadLocalTracerUuid == m_uuid))
 	{
-		out = m_alloc.newInstance<ThreadLocal>();
-		out->m_tid = Thread::getCurrentThreadId();
-		m_threadLocal = out;
-
-		// Store it
-		LockGuard<Mutex> lock(m_allThreadLocalMtx);
-		m_allThreadLocal.emplaceBack(m_alloc, out);
+		return *m_threadLocal;
 	}
 
-	return *out;
-}
-
-Tracer::Chunk& Tracer::getOrCreateChunk(ThreadLocal& tlocal)
-{
-	Chunk* out;
+	ThreadLocal* out = m_alloc.newInstance<ThreadLocal>();
+	out->m_tid = Thread::getCurrentThreadId();
+	m_threadLocal = out;
+	m_threadLocalTracerUuid = m_uuid;
 
-	if(tlocal.m_currentChunk && tlocal.m_currentChunk->m_eventCount < EVENTS_PER_CHUNK
-	   && tlocal.m_currentChunk->m_counterCount < COUNTERS_PER_CHUNK)
-	{
-		// There is a chunk and it has enough space
-		out = tlocal.m_currentChunk;
-	}
-	else
+	// Store it
+	ThreadLocal* head = m_threadLocalHead.load(AtomicMemoryOrder::RELAXED);
+	do
 	{
-		// Create a new
-		out = m_alloc.newInstance<Chunk>();
-		tlocal.m_currentChunk = out;
-		tlocal.m_allChunks.pushBack(out);
-	}
+		out->m_next = head;
+	} while(!m_threadLocalHead.compareExchange(head, out, AtomicMemoryOrder::RELEASE, AtomicMemoryOrder::RELAXED));
 
 	return *out;
 }
@@ -104,28 +136,14 @@ void Tracer::endEvent(const char* eventName, TracerEventHandle event)
 		return;
 	}
 
-	// Get the time before the lock and everything
+	// Get the time before everything else
 	const Second duration = HighRezTimer::getCurrentTime() - event.m_start;
 	if(duration == 0.0)
 	{
 		return;
 	}
 
-	ThreadLocal& tlocal = getThreadLocal();
-
-	// Write the event
-	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
-	Chunk& chunk = getOrCreateChunk(tlocal);
-
-	TracerEvent& writeEvent = chunk.m_events[chunk.m_eventCount++];
-	writeEvent.m_name = eventName;
-	writeEvent.m_start = event.m_start;
-	writeEvent.m_duration = duration;
-
-	// Write counter as well. In ns
-	TracerCounter& writeCounter = chunk.m_counters[chunk.m_counterCount++];
-	writeCounter.m_name = eventName;
-	writeCounter.m_value = U64(writeEvent.m_duration * 1000000000.0);
+	writeEvent(eventName, event.m_start, duration);
 }
 
 void Tracer::addCustomEvent(const char* eventName, Second start, Second duration)
@@ -136,21 +154,37 @@ void Tracer::addCustomEvent(const char* eventName, Second start, Second duration
 		return;
 	}
 
+	writeEvent(eventName, start, duration);
+}
+
+void Tracer::writeEvent(const char* eventName, Second start, Second duration)
+{
 	ThreadLocal& tlocal = getThreadLocal();
 
 	// Write the event
-	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
-	Chunk& chunk = getOrCreateChunk(tlocal);
+	TracerEvent* outEvent = tlocal.m_events.beginWrite();
+	if(ANKI_UNLIKELY(outEvent == nullptr))
+	{
+		m_droppedRecordCount.fetchAdd(1);
+		return;
+	}
 
-	TracerEvent& writeEvent = chunk.m_events[chunk.m_eventCount++];
-	writeEvent.m_name = eventName;
-	writeEvent.m_start = start;
-	writeEvent.m_duration = duration;
+	outEvent->m_name = eventName;
+	outEvent->m_start = start;
+	outEvent->m_duration = duration;
+	tlocal.m_events.endWrite();
 
 	// Write counter as well. In ns
-	TracerCounter& writeCounter = chunk.m_counters[chunk.m_counterCount++];
-	writeCounter.m_name = eventName;
-	writeCounter.m_value = U64(duration * 1000000000.0);
+	TracerCounter* outCounter = tlocal.m_counters.beginWrite();
+	if(ANKI_UNLIKELY(outCounter == nullptr))
+	{
+		m_droppedRecordCount.fetchAdd(1);
+		return;
+	}
+
+	outCounter->m_name = eventName;
+	outCounter->m_value = U64(duration * 1000000000.0);
+	tlocal.m_counters.endWrite();
 }
 
 void Tracer::incrementCounter(const char* counterName, U64 value)
@@ -162,34 +196,37 @@ void Tracer::incrementCounter(const char* counterName, U64 value)
 
 	ThreadLocal& tlocal = getThreadLocal();
 
-	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
-	Chunk& chunk = getOrCreateChunk(tlocal);
+	TracerCounter* writeTo = tlocal.m_counters.beginWrite();
+	if(ANKI_UNLIKELY(writeTo == nullptr))
+	{
+		m_droppedRecordCount.fetchAdd(1);
+		return;
+	}
 
-	TracerCounter& writeTo = chunk.m_counters[chunk.m_counterCount++];
-	writeTo.m_name = counterName;
-	writeTo.m_value = value;
+	writeTo->m_name = counterName;
+	writeTo->m_value = value;
+	tlocal.m_counters.endWrite();
 }
 
 void Tracer::flush(TracerFlushCallback callback, void* callbackUserData)
 {
 	ANKI_ASSERT(callback);
 
-	LockGuard<Mutex> lock(m_allThreadLocalMtx);
-	for(ThreadLocal* tlocal : m_allThreadLocal)
-	{
-		LockGuard<SpinLock> lock2(tlocal->m_currentChunkLock);
-
-		while(!tlocal->m_allChunks.isEmpty())
-		{
-			Chunk* chunk = tlocal->m_allChunks.popFront();
+	// This lock only serializes the flushes, the writers never touch it
+	LockGuard<Mutex> lock(m_flushMtx);
 
-			callback(callbackUserData, tlocal->m_tid, WeakArray<TracerEvent>(&chunk->m_events[0], chunk->m_eventCount),
-					 WeakArray<TracerCounter>(&chunk->m_counters[0], chunk->m_counterCount));
+	ThreadLocal* tlocal = m_threadLocalHead.load(AtomicMemoryOrder::ACQUIRE);
+	while(tlocal)
+	{
+		tlocal->m_events.consume([&](ConstWeakArray<TracerEvent> events) {
+			callback(callbackUserData, tlocal->m_tid, events, ConstWeakArray<TracerCounter>());
+		});
 
-			m_alloc.deleteInstance(chunk);
-		}
+		tlocal->m_counters.consume([&](ConstWeakArray<TracerCounter> counters) {
+			callback(callbackUserData, tlocal->m_tid, ConstWeakArray<TracerEvent>(), counters);
+		});
 
-		tlocal->m_currentChunk = nullptr;
+		tlocal = tlocal->m_next;
 	}
 }
 
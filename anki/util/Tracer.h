@@ -58,14 +58,13 @@ public:
 using TracerFlushCallback = void (*)(void* userData, ThreadId tid, ConstWeakArray<TracerEvent> events,
 									 ConstWeakArray<TracerCounter> counters);
 
-/// Tracer.
+/// Tracer. Every thread records its events and counters to its own rings. The owner thread is the only writer of the
+/// rings and it publishes the records with atomic stores so recording never takes a lock. The flush() consumes what
+/// has been published so far. If a ring is full the records are dropped and counted.
 class Tracer : public NonCopyable
 {
 public:
-	Tracer(GenericMemoryPoolAllocator<U8> alloc)
-		: m_alloc(alloc)
-	{
-	}
+	Tracer(GenericMemoryPoolAllocator<U8> alloc);
 
 	~Tracer();
 
@@ -89,6 +88,12 @@ public:
 	/// @note It's thread-safe.
 	void flush(TracerFlushCallback callback, void* callbackUserData);
 
+	/// Get the number of events and counters that got dropped because the rings were full.
+	U64 getDroppedRecordCount() const
+	{
+		return m_droppedRecordCount.load();
+	}
+
 	Bool getEnabled() const
 	{
 		return m_enabled;
@@ -100,17 +105,27 @@ public:
 	}
 
 private:
-	static constexpr U32 EVENTS_PER_CHUNK = 256;
-	static constexpr U32 COUNTERS_PER_CHUNK = 512;
+	static constexpr U32 EVENTS_PER_THREAD = 8 * 1024;
+	static constexpr U32 COUNTERS_PER_THREAD = 16 * 1024;
 
+	template<typename T, U32 CAPACITY>
+	class Ring;
 	class ThreadLocal;
-	class Chunk;
 
 	GenericMemoryPoolAllocator<U8> m_alloc;
 
+	/// The thread local of the last Tracer that got used by this thread.
 	static thread_local ThreadLocal* m_threadLocal;
-	DynamicArray<ThreadLocal*> m_allThreadLocal; ///< The Tracer should know about all the ThreadLocal.
-	Mutex m_allThreadLocalMtx;
+	static thread_local U64 m_threadLocalTracerUuid;
+	static Atomic<U64> m_nextUuid;
+	U64 m_uuid;
+
+	/// A lock-free list of all the ThreadLocal. The Tracer should know about all of them.
+	Atomic<ThreadLocal*> m_threadLocalHead = {nullptr};
+
+	Mutex m_flushMtx; ///< There can be only one consumer of the rings.
+
+	Atomic<U64> m_droppedRecordCount = {0};
 
 	Bool m_enabled = false;
 
@@ -118,8 +133,7 @@ private:
 	/// @note Thread-safe.
 	ThreadLocal& getThreadLocal();
 
-	/// Get or create a new chunk.
-	Chunk& getOrCreateChunk(ThreadLocal& tlocal);
+	void writeEvent(const char* eventName, Second start, Second duration);
 };
 
 /// The global tracer.
@@ -0,0 +1,290 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/TracerStatistics.h>
+#include <anki/util/Logger.h>
+#include <algorithm>
+#if ANKI_COMPILER_MSVC
+#	include <intrin.h>
+#endif
+
+namespace anki
+{
+
+class TracerStatistics::Value
+{
+public:
+	static constexpr U64 NO_SAMPLE = MAX_U64;
+
+	String m_name;
+	Bool m_isEvent = false;
+
+	Bool m_inCurrentFrame = false;
+	U64 m_currentFrameSum = 0;
+
+	DynamicArray<U64> m_window; ///< A ring with the sums of the last frames. NO_SAMPLE if a frame didn't have any.
+	U32 m_sampleCount = 0;
+	U64 m_windowSum = 0;
+	Array<U16, BUCKET_COUNT> m_histogram;
+};
+
+TracerStatistics::TracerStatistics(GenericMemoryPoolAllocator<U8> alloc, U32 windowFrameCount)
+	: m_alloc(alloc)
+	, m_windowFrameCount(windowFrameCount)
+{
+	ANKI_ASSERT(windowFrameCount > 0 && windowFrameCount <= MAX_U16 && "The histogram uses U16 counts");
+}
+
+TracerStatistics::~TracerStatistics()
+{
+	for(Value* value : m_values)
+	{
+		value->m_name.destroy(m_alloc);
+		value->m_window.destroy(m_alloc);
+		m_alloc.deleteInstance(value);
+	}
+
+	m_values.destroy(m_alloc);
+	m_valueIndices.destroy(m_alloc);
+}
+
+U32 TracerStatistics::computeBucket(U64 value)
+{
+	if(value < SUB_BUCKET_COUNT)
+	{
+		return U32(value);
+	}
+
+#if ANKI_COMPILER_MSVC
+	unsigned long msb;
+	_BitScanReverse64(&msb, value);
+#else
+	const U32 msb = 63 - U32(__builtin_clzll(value));
+#endif
+
+	// The top SUB_BUCKET_COUNT_LOG2 bits after the most significant bit pick the sub-bucket
+	const U32 shift = U32(msb) - SUB_BUCKET_COUNT_LOG2;
+	const U32 subBucket = U32(value >> shift) - SUB_BUCKET_COUNT;
+	return (shift + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+U64 TracerStatistics::computeBucketValue(U32 bucket)
+{
+	ANKI_ASSERT(bucket < BUCKET_COUNT);
+	if(bucket < SUB_BUCKET_COUNT)
+	{
+		return bucket;
+	}
+
+	// Return the middle of the bucket
+	const U32 shift = bucket / SUB_BUCKET_COUNT - 1;
+	const U64 subBucket = bucket % SUB_BUCKET_COUNT;
+	const U64 lowerBound = (SUB_BUCKET_COUNT + subBucket) << shift;
+	return lowerBound + ((U64(1) << shift) >> 1);
+}
+
+TracerStatistics::Value& TracerStatistics::getOrCreateValue(CString name)
+{
+	const U64 hash = name.computeHash();
+	auto it = m_valueIndices.find(hash);
+	if(it != m_valueIndices.getEnd())
+	{
+		return *m_values[*it];
+	}
+
+	Value* value = m_alloc.newInstance<Value>();
+	value->m_name.create(m_alloc, name);
+	value->m_window.create(m_alloc, m_windowFrameCount, Value::NO_SAMPLE);
+	memset(&value->m_histogram[0], 0, sizeof(value->m_histogram));
+
+	m_valueIndices.emplace(m_alloc, hash, m_values.getSize());
+	m_values.emplaceBack(m_alloc, value);
+	return *value;
+}
+
+void TracerStatistics::addEvents(ConstWeakArray<TracerEvent> events)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	for(const TracerEvent& event : events)
+	{
+		getOrCreateValue(event.m_name).m_isEvent = true;
+	}
+}
+
+void TracerStatistics::addCounters(ConstWeakArray<TracerCounter> counters)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	for(const TracerCounter& counter : counters)
+	{
+		Value& value = getOrCreateValue(counter.m_name);
+		value.m_inCurrentFrame = true;
+		value.m_currentFrameSum += counter.m_value;
+	}
+}
+
+void TracerStatistics::endFrame()
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	const U32 slot = U32(m_frameCount % m_windowFrameCount);
+	for(Value* value : m_values)
+	{
+		// Evict the oldest frame
+		const U64 oldSample = value->m_window[slot];
+		if(oldSample != Value::NO_SAMPLE)
+		{
+			--value->m_histogram[computeBucket(oldSample)];
+			--value->m_sampleCount;
+			value->m_windowSum -= oldSample;
+		}
+
+		// Add the new one
+		if(value->m_inCurrentFrame)
+		{
+			const U64 newSample = min(value->m_currentFrameSum, Value::NO_SAMPLE - 1);
+			value->m_window[slot] = newSample;
+			++value->m_histogram[computeBucket(newSample)];
+			++value->m_sampleCount;
+			value->m_windowSum += newSample;
+		}
+		else
+		{
+			value->m_window[slot] = Value::NO_SAMPLE;
+		}
+
+		value->m_inCurrentFrame = false;
+		value->m_currentFrameSum = 0;
+	}
+
+	++m_frameCount;
+}
+
+U64 TracerStatistics::getFrameCount() const
+{
+	LockGuard<Mutex> lock(m_mtx);
+	return m_frameCount;
+}
+
+void TracerStatistics::computeEntry(const Value& value, TracerStatisticsEntry& entry) const
+{
+	entry.m_name = value.m_name.toCString();
+	entry.m_isEvent = value.m_isEvent;
+	entry.m_sampleCount = value.m_sampleCount;
+
+	if(value.m_sampleCount == 0)
+	{
+		entry.m_p50 = entry.m_p95 = entry.m_p99 = entry.m_max = 0;
+		entry.m_average = 0.0;
+		return;
+	}
+
+	entry.m_average = F64(value.m_windowSum) / F64(value.m_sampleCount);
+
+	// The max is exact
+	entry.m_max = 0;
+	for(U64 sample : value.m_window)
+	{
+		if(sample != Value::NO_SAMPLE)
+		{
+			entry.m_max = max(entry.m_max, sample);
+		}
+	}
+
+	// Walk the histogram for the percentiles
+	const Array<U32, 3> ranks = {(value.m_sampleCount * 50 + 99) / 100, (value.m_sampleCount * 95 + 99) / 100,
+								 (value.m_sampleCount * 99 + 99) / 100};
+	Array<U64*, 3> outputs = {&entry.m_p50, &entry.m_p95, &entry.m_p99};
+	U32 percentile = 0;
+	U32 count = 0;
+	for(U32 bucket = 0; bucket < BUCKET_COUNT && percentile < ranks.getSize(); ++bucket)
+	{
+		count += value.m_histogram[bucket];
+		while(percentile < ranks.getSize() && count >= ranks[percentile])
+		{
+			// Don't go over the max since the buckets are approximate
+			*outputs[percentile] = min(computeBucketValue(bucket), entry.m_max);
+			++percentile;
+		}
+	}
+}
+
+Bool TracerStatistics::getEntry(CString name, TracerStatisticsEntry& entry) const
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	auto it = m_valueIndices.find(name.computeHash());
+	if(it == m_valueIndices.getEnd())
+	{
+		return false;
+	}
+
+	computeEntry(*m_values[*it], entry);
+	return true;
+}
+
+void TracerStatistics::getAllEntries(DynamicArrayAuto<TracerStatisticsEntry>& entries) const
+{
+	{
+		LockGuard<Mutex> lock(m_mtx);
+
+		entries.create(m_values.getSize());
+		for(U32 i = 0; i < m_values.getSize(); ++i)
+		{
+			computeEntry(*m_values[i], entries[i]);
+		}
+	}
+
+	std::sort(entries.getBegin(), entries.getEnd(),
+			  [](const TracerStatisticsEntry& a, const TracerStatisticsEntry& b) { return a.m_name < b.m_name; });
+}
+
+void TracerStatistics::log() const
+{
+	DynamicArrayAuto<TracerStatisticsEntry> entries(m_alloc);
+	getAllEntries(entries);
+
+	ANKI_UTIL_LOGI("Trace statistics of the last %u frames:", U32(min<U64>(getFrameCount(), m_windowFrameCount)));
+	for(const TracerStatisticsEntry& entry : entries)
+	{
+		if(entry.m_isEvent)
+		{
+			ANKI_UTIL_LOGI("    %s: p50 %.3fms, p95 %.3fms, p99 %.3fms, max %.3fms, avg %.3fms (%u frames)",
+						   entry.m_name.cstr(), F64(entry.m_p50) / 1000000.0, F64(entry.m_p95) / 1000000.0,
+						   F64(entry.m_p99) / 1000000.0, F64(entry.m_max) / 1000000.0, entry.m_average / 1000000.0,
+						   entry.m_sampleCount);
+		}
+		else
+		{
+			ANKI_UTIL_LOGI("    %s: p50 %lu, p95 %lu, p99 %lu, max %lu, avg %.1f (%u frames)", entry.m_name.cstr(),
+						   entry.m_p50, entry.m_p95, entry.m_p99, entry.m_max, entry.m_average, entry.m_sampleCount);
+		}
+	}
+}
+
+Error TracerStatistics::writeCsv(File& file, Bool writeHeader) const
+{
+	DynamicArrayAuto<TracerStatisticsEntry> entries(m_alloc);
+	getAllEntries(entries);
+
+	const U64 frameCount = getFrameCount();
+
+	if(writeHeader)
+	{
+		ANKI_CHECK(file.writeText("Frame,Name,IsTime,Samples,P50,P95,P99,Max,Average\n"));
+	}
+
+	for(const TracerStatisticsEntry& entry : entries)
+	{
+		ANKI_CHECK(file.writeText("%lu,%s,%u,%u,%lu,%lu,%lu,%lu,%f\n", frameCount, entry.m_name.cstr(),
+								  U32(entry.m_isEvent), entry.m_sampleCount, entry.m_p50, entry.m_p95, entry.m_p99,
+								  entry.m_max, entry.m_average));
+	}
+
+	return Error::NONE;
+}
+
+} // end namespace anki
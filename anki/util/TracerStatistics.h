@@ -0,0 +1,97 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/Tracer.h>
+#include <anki/util/FlatHashMap.h>
+#include <anki/util/File.h>
+
+namespace anki
+{
+
+/// @addtogroup util_other
+/// @{
+
+/// The statistics of an event or a counter over the last frames.
+/// @memberof TracerStatistics
+class TracerStatisticsEntry
+{
+public:
+	CString m_name;
+	Bool m_isEvent = false; ///< If true the values are the nanoseconds spent on the event.
+	U32 m_sampleCount = 0; ///< The number of frames (in the window) that had that event or counter.
+	U64 m_p50 = 0;
+	U64 m_p95 = 0;
+	U64 m_p99 = 0;
+	U64 m_max = 0;
+	F64 m_average = 0.0;
+};
+
+/// Keeps rolling statistics of the events and counters of the Tracer. Every event or counter has a window with the
+/// per-frame sums of the last frames and a histogram of that window. The histogram has logarithmic buckets with 8
+/// linear sub-buckets so the percentiles are within 12.5% of the real values. Feed it with what Tracer::flush() gives.
+/// @note It's thread-safe.
+class TracerStatistics : public NonCopyable
+{
+public:
+	/// @param windowFrameCount The number of the last frames to keep statistics for.
+	TracerStatistics(GenericMemoryPoolAllocator<U8> alloc, U32 windowFrameCount = 600);
+
+	~TracerStatistics();
+
+	/// Add events to the current frame. The Tracer writes a counter with the duration of every event so the values
+	/// come from the counters. The events are only needed to know which counters are times.
+	void addEvents(ConstWeakArray<TracerEvent> events);
+
+	/// Add counters to the current frame.
+	void addCounters(ConstWeakArray<TracerCounter> counters);
+
+	/// Close the current frame and push its values to the windows.
+	void endFrame();
+
+	/// Get the number of frames ended so far.
+	U64 getFrameCount() const;
+
+	/// Get the statistics of a single event or counter. Returns false if it's not known.
+	Bool getEntry(CString name, TracerStatisticsEntry& entry) const;
+
+	/// Get the statistics of everything sorted by name.
+	void getAllEntries(DynamicArrayAuto<TracerStatisticsEntry>& entries) const;
+
+	/// Log the statistics of everything.
+	void log() const;
+
+	/// Write a row per event or counter to a CSV file.
+	/// @param writeHeader Write the column names first.
+	ANKI_USE_RESULT Error writeCsv(File& file, Bool writeHeader) const;
+
+private:
+	/// Every power of two is split to that many buckets.
+	static constexpr U32 SUB_BUCKET_COUNT_LOG2 = 3;
+	static constexpr U32 SUB_BUCKET_COUNT = 1u << SUB_BUCKET_COUNT_LOG2;
+	static constexpr U32 BUCKET_COUNT = (64 - SUB_BUCKET_COUNT_LOG2 + 1) * SUB_BUCKET_COUNT;
+
+	class Value;
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	U32 m_windowFrameCount;
+	U64 m_frameCount = 0;
+
+	FlatHashMap<U64, U32> m_valueIndices; ///< Hash of the name to an index in m_values.
+	DynamicArray<Value*> m_values;
+
+	mutable Mutex m_mtx;
+
+	Value& getOrCreateValue(CString name);
+
+	void computeEntry(const Value& value, TracerStatisticsEntry& entry) const;
+
+	static U32 computeBucket(U64 value);
+	static U64 computeBucketValue(U32 bucket);
+};
+/// @}
+
+} // end namespace anki
@@ -67,6 +67,17 @@ public:
 		}
 	}
 
+	template<U32 N>
+	explicit WeakArray(DynamicArrayInline<T, N, TSize>& arr)
+		: WeakArray()
+	{
+		if(arr.getSize())
+		{
+			m_data = &arr[0];
+			m_size = arr.getSize();
+		}
+	}
+
 	/// Copy.
 	WeakArray(const WeakArray& b)
 		: WeakArray(b.m_data, b.m_size)
@@ -292,6 +303,18 @@ public:
 		}
 	}
 
+	/// Construct from DynamicArrayInline.
+	template<U32 N>
+	ConstWeakArray(const DynamicArrayInline<T, N, TSize>& arr)
+		: ConstWeakArray()
+	{
+		if(arr.getSize())
+		{
+			m_data = &arr[0];
+			m_size = arr.getSize();
+		}
+	}
+
 	/// Copy.
 	ConstWeakArray(const ConstWeakArray& b)
 		: ConstWeakArray(b.m_data, b.m_size)
@@ -6,14 +6,415 @@
 #include <anki/util/Xml.h>
 #include <anki/util/File.h>
 #include <anki/util/Logger.h>
+#include <cstring>
 
 namespace anki
 {
 
+static Bool isXmlWhitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static char* skipXmlWhitespace(char* p)
+{
+	while(isXmlWhitespace(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+static Bool isXmlNameChar(char c)
+{
+	return c != '\0' && !isXmlWhitespace(c) && c != '/' && c != '>' && c != '=' && c != '<';
+}
+
+/// Write a code point as UTF-8. It takes at most 4 bytes.
+static char* writeUtf8(U32 codePoint, char* out)
+{
+	if(codePoint < 0x80)
+	{
+		*out++ = char(codePoint);
+	}
+	else if(codePoint < 0x800)
+	{
+		*out++ = char(0xC0 | (codePoint >> 6));
+		*out++ = char(0x80 | (codePoint & 0x3F));
+	}
+	else if(codePoint < 0x10000)
+	{
+		*out++ = char(0xE0 | (codePoint >> 12));
+		*out++ = char(0x80 | ((codePoint >> 6) & 0x3F));
+		*out++ = char(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		*out++ = char(0xF0 | (codePoint >> 18));
+		*out++ = char(0x80 | ((codePoint >> 12) & 0x3F));
+		*out++ = char(0x80 | ((codePoint >> 6) & 0x3F));
+		*out++ = char(0x80 | (codePoint & 0x3F));
+	}
+
+	return out;
+}
+
+void XmlPullParser::decodeInSitu(char* begin, char* end)
+{
+	class Entity
+	{
+	public:
+		const char* m_str;
+		U32 m_length;
+		char m_value;
+	};
+
+	static const Array<Entity, 5> entities = {
+		{{"&lt;", 4, '<'}, {"&gt;", 4, '>'}, {"&amp;", 5, '&'}, {"&quot;", 6, '"'}, {"&apos;", 6, '\''}}};
+
+	char* in = begin;
+	char* out = begin;
+	while(in < end)
+	{
+		if(*in == '\r')
+		{
+			// Normalize the line endings
+			*out++ = '\n';
+			in += (in + 1 < end && in[1] == '\n') ? 2 : 1;
+		}
+		else if(*in == '&' && in + 1 < end && in[1] == '#')
+		{
+			// Character reference. The UTF-8 is never longer than the reference
+			const Bool hex = in + 2 < end && in[2] == 'x';
+			char* numEnd = in + ((hex) ? 3 : 2);
+			U32 codePoint = 0;
+			while(numEnd < end && *numEnd != ';' && codePoint <= 0x10FFFF)
+			{
+				const char c = *numEnd;
+				U32 digit;
+				if(c >= '0' && c <= '9')
+				{
+					digit = U32(c - '0');
+				}
+				else if(hex && c >= 'a' && c <= 'f')
+				{
+					digit = U32(c - 'a' + 10);
+				}
+				else if(hex && c >= 'A' && c <= 'F')
+				{
+					digit = U32(c - 'A' + 10);
+				}
+				else
+				{
+					break;
+				}
+
+				codePoint = codePoint * ((hex) ? 16 : 10) + digit;
+				++numEnd;
+			}
+
+			if(numEnd < end && *numEnd == ';' && codePoint > 0 && codePoint <= 0x10FFFF)
+			{
+				out = writeUtf8(codePoint, out);
+				in = numEnd + 1;
+			}
+			else
+			{
+				// Not a valid reference, keep it as is
+				*out++ = *in++;
+			}
+		}
+		else if(*in == '&')
+		{
+			Bool found = false;
+			for(const Entity& entity : entities)
+			{
+				if(in + entity.m_length <= end && memcmp(in, entity.m_str, entity.m_length) == 0)
+				{
+					*out++ = entity.m_value;
+					in += entity.m_length;
+					found = true;
+					break;
+				}
+			}
+
+			if(!found)
+			{
+				*out++ = *in++;
+			}
+		}
+		else
+		{
+			*out++ = *in++;
+		}
+	}
+
+	*out = '\0';
+}
+
+Error XmlPullParser::error(const char* what) const
+{
+	U32 line = 1;
+	for(const char* p = m_begin; p < m_pos; ++p)
+	{
+		line += *p == '\n';
+	}
+
+	ANKI_UTIL_LOGE("XML parsing failed at line %u: %s", line, what);
+	return Error::USER_DATA;
+}
+
+Error XmlPullParser::skipUntil(const char* str)
+{
+	char* found = strstr(m_pos, str);
+	if(found == nullptr)
+	{
+		return error("Unexpected end of document");
+	}
+
+	m_pos = found + strlen(str);
+	return Error::NONE;
+}
+
+Error XmlPullParser::parseName(char*& name, char& charAfterName)
+{
+	name = m_pos;
+	while(isXmlNameChar(*m_pos))
+	{
+		++m_pos;
+	}
+
+	if(m_pos == name)
+	{
+		return error("Expecting a name");
+	}
+
+	// Null-terminate it but remember what was there
+	charAfterName = *m_pos;
+	if(charAfterName == '\0')
+	{
+		return error("Unexpected end of document");
+	}
+
+	*m_pos++ = '\0';
+	return Error::NONE;
+}
+
+Error XmlPullParser::parseEndTag()
+{
+	char* name;
+	char c;
+	ANKI_CHECK(parseName(name, c));
+
+	if(isXmlWhitespace(c))
+	{
+		m_pos = skipXmlWhitespace(m_pos);
+		c = *m_pos++;
+	}
+
+	if(c != '>')
+	{
+		return error("Expecting '>'");
+	}
+
+	if(m_depth == 0 || strcmp(m_openElements[m_depth - 1], name) != 0)
+	{
+		return error("Mismatched end tag");
+	}
+
+	--m_depth;
+	m_name = name;
+	return Error::NONE;
+}
+
+Error XmlPullParser::parseStartTag()
+{
+	char* name;
+	char c;
+	ANKI_CHECK(parseName(name, c));
+	m_name = name;
+	m_attributeCount = 0;
+
+	// Attributes
+	while(isXmlWhitespace(c))
+	{
+		m_pos = skipXmlWhitespace(m_pos);
+		if(*m_pos == '/' || *m_pos == '>')
+		{
+			c = *m_pos++;
+			break;
+		}
+
+		char* attribName;
+		ANKI_CHECK(parseName(attribName, c));
+
+		if(isXmlWhitespace(c))
+		{
+			m_pos = skipXmlWhitespace(m_pos);
+			c = *m_pos++;
+		}
+
+		if(c != '=')
+		{
+			return error("Expecting '='");
+		}
+
+		m_pos = skipXmlWhitespace(m_pos);
+		const char quote = *m_pos;
+		if(quote != '"' && quote != '\'')
+		{
+			return error("Expecting a quote");
+		}
+
+		char* value = ++m_pos;
+		char* valueEnd = strchr(value, quote);
+		if(valueEnd == nullptr)
+		{
+			return error("Unexpected end of document");
+		}
+
+		if(m_attributeCount == MAX_ATTRIBUTES)
+		{
+			return error("Too many attributes");
+		}
+
+		m_pos = valueEnd + 1;
+		c = *m_pos++;
+		decodeInSitu(value, valueEnd);
+
+		m_attributes[m_attributeCount].m_name = attribName;
+		m_attributes[m_attributeCount].m_value = value;
+		++m_attributeCount;
+	}
+
+	if(c == '/')
+	{
+		if(*m_pos++ != '>')
+		{
+			return error("Expecting '>'");
+		}
+
+		m_endElementPending = true;
+	}
+	else if(c != '>')
+	{
+		return error("Expecting '>'");
+	}
+
+	if(m_depth == MAX_DEPTH)
+	{
+		return error("Too many nested elements");
+	}
+
+	m_openElements[m_depth++] = name;
+	return Error::NONE;
+}
+
+Error XmlPullParser::next(XmlPullParserEvent& event)
+{
+	if(m_endElementPending)
+	{
+		m_endElementPending = false;
+		--m_depth;
+		event = XmlPullParserEvent::END_ELEMENT;
+		return Error::NONE;
+	}
+
+	while(true)
+	{
+		if(!m_tagPending && *m_pos == '\0')
+		{
+			if(m_depth > 0)
+			{
+				return error("Unexpected end of document");
+			}
+
+			event = XmlPullParserEvent::END_OF_DOCUMENT;
+			return Error::NONE;
+		}
+
+		if(!m_tagPending && *m_pos != '<')
+		{
+			// Text
+			char* begin = m_pos;
+			char* end = begin;
+			Bool whitespaceOnly = true;
+			while(*end != '<' && *end != '\0')
+			{
+				whitespaceOnly = whitespaceOnly && isXmlWhitespace(*end);
+				++end;
+			}
+
+			m_pos = end;
+			if(whitespaceOnly)
+			{
+				continue;
+			}
+
+			if(m_depth == 0)
+			{
+				return error("Text outside of an element");
+			}
+
+			// The decoding will overwrite the '<'
+			m_tagPending = *end == '<';
+			decodeInSitu(begin, end);
+			m_text = begin;
+			event = XmlPullParserEvent::TEXT;
+			return Error::NONE;
+		}
+
+		// A tag
+		m_tagPending = false;
+		++m_pos;
+
+		if(strncmp(m_pos, "!--", 3) == 0)
+		{
+			ANKI_CHECK(skipUntil("-->"));
+		}
+		else if(strncmp(m_pos, "![CDATA[", 8) == 0)
+		{
+			if(m_depth == 0)
+			{
+				return error("CDATA outside of an element");
+			}
+
+			char* begin = m_pos + 8;
+			ANKI_CHECK(skipUntil("]]>"));
+			*(m_pos - 3) = '\0';
+			m_text = begin;
+			event = XmlPullParserEvent::TEXT;
+			return Error::NONE;
+		}
+		else if(*m_pos == '?')
+		{
+			ANKI_CHECK(skipUntil("?>"));
+		}
+		else if(*m_pos == '!')
+		{
+			// DOCTYPE and similar. Skip them
+			ANKI_CHECK(skipUntil(">"));
+		}
+		else if(*m_pos == '/')
+		{
+			++m_pos;
+			ANKI_CHECK(parseEndTag());
+			event = XmlPullParserEvent::END_ELEMENT;
+			return Error::NONE;
+		}
+		else
+		{
+			ANKI_CHECK(parseStartTag());
+			event = XmlPullParserEvent::START_ELEMENT;
+			return Error::NONE;
+		}
+	}
+}
+
 Error XmlElement::check() const
 {
 	Error err = Error::NONE;
-	if(m_el == nullptr)
+	if(m_doc == nullptr)
 	{
 		ANKI_UTIL_LOGE("Empty element");
 		err = Error::USER_DATA;
@@ -22,10 +423,16 @@ Error XmlElement::check() const
 	return err;
 }
 
+CString XmlElement::getName() const
+{
+	ANKI_ASSERT(m_doc);
+	return m_doc->m_nodes[m_node].m_name;
+}
+
 Error XmlElement::getText(CString& out) const
 {
 	ANKI_CHECK(check());
-	out = (m_el->GetText()) ? CString(m_el->GetText()) : CString();
+	out = m_doc->m_nodes[m_node].m_text;
 	return Error::NONE;
 }
 
@@ -34,7 +441,8 @@ Error XmlElement::getChildElementOptional(CString name, XmlElement& out) const
 	const Error err = check();
 	if(!err)
 	{
-		out = XmlElement(m_el->FirstChildElement(&name[0]), m_alloc);
+		const U32 child = m_doc->findChildElement(m_node, name);
+		out = (child != MAX_U32) ? XmlElement(m_doc, child) : XmlElement();
 	}
 	else
 	{
@@ -73,7 +481,13 @@ Error XmlElement::getNextSiblingElement(CString name, XmlElement& out) const
 	const Error err = check();
 	if(!err)
 	{
-		out = XmlElement(m_el->NextSiblingElement(&name[0]), m_alloc);
+		U32 sibling = m_doc->m_nodes[m_node].m_nextSibling;
+		while(sibling != MAX_U32 && name != m_doc->m_nodes[sibling].m_name)
+		{
+			sibling = m_doc->m_nodes[sibling].m_nextSibling;
+		}
+
+		out = (sibling != MAX_U32) ? XmlElement(m_doc, sibling) : XmlElement();
 	}
 	else
 	{
@@ -86,16 +500,15 @@ Error XmlElement::getNextSiblingElement(CString name, XmlElement& out) const
 Error XmlElement::getSiblingElementsCount(U32& out) const
 {
 	ANKI_CHECK(check());
-	const tinyxml2::XMLElement* el = m_el;
 
 	out = 0;
-	do
+	const CString name = getName();
+	U32 sibling = m_doc->m_nodes[m_node].m_nextSibling;
+	while(sibling != MAX_U32)
 	{
-		el = el->NextSiblingElement(m_el->Name());
-		++out;
-	} while(el);
-
-	out -= 1;
+		out += name == m_doc->m_nodes[sibling].m_name;
+		sibling = m_doc->m_nodes[sibling].m_nextSibling;
+	}
 
 	return Error::NONE;
 }
@@ -104,65 +517,179 @@ Error XmlElement::getAttributeTextOptional(CString name, CString& out, Bool& att
 {
 	ANKI_CHECK(check());
 
-	const tinyxml2::XMLAttribute* attrib = m_el->FindAttribute(&name[0]);
-	if(!attrib)
-	{
-		attribPresent = false;
-		return Error::NONE;
-	}
-
-	attribPresent = true;
-
-	const char* value = attrib->Value();
-	if(value)
-	{
-		out = value;
-	}
-	else
+	const XmlDocument::Node& node = m_doc->m_nodes[m_node];
+	for(U32 i = node.m_firstAttribute; i < node.m_firstAttribute + node.m_attributeCount; ++i)
 	{
-		out = CString();
+		if(name == m_doc->m_attributes[i].m_name)
+		{
+			attribPresent = true;
+			out = m_doc->m_attributes[i].m_value;
+			return Error::NONE;
+		}
 	}
 
+	attribPresent = false;
 	return Error::NONE;
 }
 
 CString XmlDocument::XML_HEADER = R"(<?xml version="1.0" encoding="UTF-8" ?>)";
 
+XmlDocument::~XmlDocument()
+{
+	destroy();
+}
+
+void XmlDocument::destroy()
+{
+	m_text.destroy(m_alloc);
+	m_nodes.destroy(m_alloc);
+	m_attributes.destroy(m_alloc);
+}
+
 Error XmlDocument::loadFile(CString filename, GenericMemoryPoolAllocator<U8> alloc)
 {
+	destroy();
+	m_alloc = alloc;
+
+	// Read it directly to the buffer that will be parsed
 	File file;
 	ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+	const PtrSize size = file.getSize();
+	m_text.create(m_alloc, U32(size + 1));
+	if(size > 0)
+	{
+		ANKI_CHECK(file.read(&m_text[0], size));
+	}
+	m_text[U32(size)] = '\0';
 
-	StringAuto text(alloc);
-	ANKI_CHECK(file.readAllText(text));
-
-	ANKI_CHECK(parse(text.toCString(), alloc));
-
-	return Error::NONE;
+	return parseInternal();
 }
 
 Error XmlDocument::parse(CString xmlText, GenericMemoryPoolAllocator<U8> alloc)
 {
+	destroy();
 	m_alloc = alloc;
 
-	if(m_doc.Parse(&xmlText[0]))
+	const U32 length = xmlText.getLength();
+	m_text.create(m_alloc, length + 1);
+	if(length > 0)
 	{
-		ANKI_UTIL_LOGE("Cannot parse file. Reason: %s",
-					   ((m_doc.GetErrorStr1() == nullptr) ? "unknown" : m_doc.GetErrorStr1()));
+		memcpy(&m_text[0], xmlText.cstr(), length);
+	}
+	m_text[length] = '\0';
 
-		return Error::USER_DATA;
+	return parseInternal();
+}
+
+Error XmlDocument::parseInternal()
+{
+	// Reserve using the upper bounds of the elements and the attributes
+	U32 maxNodeCount = 1;
+	U32 maxAttributeCount = 0;
+	for(char c : m_text)
+	{
+		maxNodeCount += c == '<';
+		maxAttributeCount += c == '=';
+	}
+
+	m_nodes.resizeStorage(m_alloc, maxNodeCount);
+
+	// The document node
+	Node& doc = *m_nodes.emplaceBack(m_alloc);
+	doc = {nullptr, nullptr, 0, 0, MAX_U32, MAX_U32, MAX_U32, MAX_U32};
+
+	XmlPullParser parser(&m_text[0]);
+	U32 current = 0;
+	while(true)
+	{
+		XmlPullParserEvent event;
+		if(parser.next(event))
+		{
+			ANKI_UTIL_LOGE("Cannot parse XML");
+			return Error::USER_DATA;
+		}
+
+		if(event == XmlPullParserEvent::START_ELEMENT)
+		{
+			const U32 idx = m_nodes.getSize();
+			Node& node = *m_nodes.emplaceBack(m_alloc);
+			node.m_name = parser.getName().cstr();
+			node.m_text = nullptr;
+			node.m_firstAttribute = m_attributes.getSize();
+			node.m_attributeCount = parser.getAttributeCount();
+			node.m_parent = current;
+			node.m_firstChild = MAX_U32;
+			node.m_lastChild = MAX_U32;
+			node.m_nextSibling = MAX_U32;
+
+			if(parser.getAttributeCount() > 0 && m_attributes.getSize() == 0)
+			{
+				// Reserve lazily because the array can't be destroyed if it has capacity but no elements
+				m_attributes.resizeStorage(m_alloc, maxAttributeCount);
+			}
+
+			for(U32 i = 0; i < parser.getAttributeCount(); ++i)
+			{
+				Attribute& attrib = *m_attributes.emplaceBack(m_alloc);
+				attrib.m_name = parser.getAttributeName(i).cstr();
+				attrib.m_value = parser.getAttributeValue(i).cstr();
+			}
+
+			// Link it to the parent
+			Node& parent = m_nodes[current];
+			if(parent.m_lastChild == MAX_U32)
+			{
+				parent.m_firstChild = idx;
+			}
+			else
+			{
+				m_nodes[parent.m_lastChild].m_nextSibling = idx;
+			}
+			parent.m_lastChild = idx;
+
+			current = idx;
+		}
+		else if(event == XmlPullParserEvent::END_ELEMENT)
+		{
+			current = m_nodes[current].m_parent;
+		}
+		else if(event == XmlPullParserEvent::TEXT)
+		{
+			// Keep only the text that comes before the children
+			Node& node = m_nodes[current];
+			if(node.m_text == nullptr && node.m_firstChild == MAX_U32)
+			{
+				node.m_text = parser.getText().cstr();
+			}
+		}
+		else
+		{
+			break;
+		}
 	}
 
 	return Error::NONE;
 }
 
-ANKI_USE_RESULT Error XmlDocument::getChildElementOptional(CString name, XmlElement& out) const
+U32 XmlDocument::findChildElement(U32 parent, CString name) const
+{
+	U32 child = m_nodes[parent].m_firstChild;
+	while(child != MAX_U32 && name != m_nodes[child].m_name)
+	{
+		child = m_nodes[child].m_nextSibling;
+	}
+
+	return child;
+}
+
+Error XmlDocument::getChildElementOptional(CString name, XmlElement& out) const
 {
-	out = XmlElement(m_doc.FirstChildElement(&name[0]), m_alloc);
+	const U32 child = (m_nodes.getSize() > 0) ? findChildElement(0, name) : MAX_U32;
+	out = (child != MAX_U32) ? XmlElement(this, child) : XmlElement();
 	return Error::NONE;
 }
 
-ANKI_USE_RESULT Error XmlDocument::getChildElement(CString name, XmlElement& out) const
+Error XmlDocument::getChildElement(CString name, XmlElement& out) const
 {
 	ANKI_CHECK(getChildElementOptional(name, out));
 
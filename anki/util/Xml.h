@@ -7,47 +7,126 @@
 
 #include <anki/util/DynamicArray.h>
 #include <anki/util/String.h>
-#include <tinyxml2.h>
-#if !ANKI_TINYXML2
-#	error "Wrong tinyxml2 included"
-#endif
+#include <anki/util/WeakArray.h>
 
 namespace anki
 {
 
+// Forward
+class XmlDocument;
+
 /// @addtogroup util_file
 /// @{
 
-/// XML element.
-class XmlElement
+/// @memberof XmlPullParser
+enum class XmlPullParserEvent : U8
 {
-	friend class XmlDocument;
+	START_ELEMENT,
+	END_ELEMENT,
+	TEXT,
+	END_OF_DOCUMENT
+};
 
+/// A streaming XML parser that works in-situ. It null-terminates the names, the values and the text inside the buffer
+/// it parses and it decodes the entities in place so it doesn't allocate or copy anything. The comments, the
+/// processing instructions and the whitespace between the elements are skipped. A self-closing element gives a
+/// START_ELEMENT and an END_ELEMENT.
+class XmlPullParser
+{
 public:
-	XmlElement()
-		: m_el(nullptr)
+	static constexpr U32 MAX_ATTRIBUTES = 32;
+	static constexpr U32 MAX_DEPTH = 64;
+
+	/// @param text A null-terminated text that the parser will modify. The strings the parser returns point to it.
+	XmlPullParser(char* text)
+		: m_begin(text)
+		, m_pos(text)
+	{
+		ANKI_ASSERT(text);
+	}
+
+	/// Move to the next event.
+	ANKI_USE_RESULT Error next(XmlPullParserEvent& event);
+
+	/// The name of the element. Valid for START_ELEMENT and END_ELEMENT.
+	CString getName() const
 	{
+		return m_name;
 	}
 
-	XmlElement(const XmlElement& b)
-		: m_el(b.m_el)
-		, m_alloc(b.m_alloc)
+	/// Valid for TEXT.
+	CString getText() const
 	{
+		return m_text;
 	}
 
+	/// Valid for START_ELEMENT.
+	U32 getAttributeCount() const
+	{
+		return m_attributeCount;
+	}
+
+	CString getAttributeName(U32 idx) const
+	{
+		ANKI_ASSERT(idx < m_attributeCount);
+		return m_attributes[idx].m_name;
+	}
+
+	CString getAttributeValue(U32 idx) const
+	{
+		ANKI_ASSERT(idx < m_attributeCount);
+		return m_attributes[idx].m_value;
+	}
+
+private:
+	class Attribute
+	{
+	public:
+		const char* m_name;
+		const char* m_value;
+	};
+
+	char* m_begin;
+	char* m_pos;
+	Bool m_tagPending = false; ///< A TEXT overwrote the '<' of the tag that follows it.
+	Bool m_endElementPending = false; ///< The START_ELEMENT was self-closing.
+
+	const char* m_name = nullptr;
+	const char* m_text = nullptr;
+	Array<Attribute, MAX_ATTRIBUTES> m_attributes;
+	U32 m_attributeCount = 0;
+
+	Array<const char*, MAX_DEPTH> m_openElements; ///< To check the end tags.
+	U32 m_depth = 0;
+
+	ANKI_USE_RESULT Error parseStartTag();
+	ANKI_USE_RESULT Error parseEndTag();
+	ANKI_USE_RESULT Error parseName(char*& name, char& charAfterName);
+	ANKI_USE_RESULT Error skipUntil(const char* str);
+	ANKI_USE_RESULT Error error(const char* what) const;
+
+	/// Decode the entities and the line endings of [begin, end) in place and null-terminate the result.
+	static void decodeInSitu(char* begin, char* end);
+};
+
+/// XML element.
+class XmlElement
+{
+	friend class XmlDocument;
+
+public:
+	XmlElement() = default;
+
+	XmlElement(const XmlElement& b) = default;
+
 	/// If element has something return true
 	explicit operator Bool() const
 	{
-		return m_el != nullptr;
+		return m_doc != nullptr;
 	}
 
 	/// Copy
-	XmlElement& operator=(const XmlElement& b)
-	{
-		m_el = b.m_el;
-		m_alloc = b.m_alloc;
-		return *this;
-	}
+	XmlElement& operator=(const XmlElement& b) = default;
 
 	/// Return the text inside a tag. May return empty string.
 	ANKI_USE_RESULT Error getText(CString& out) const;
@@ -160,17 +239,23 @@ public:
 	/// @}
 
 private:
-	const tinyxml2::XMLElement* m_el;
-	GenericMemoryPoolAllocator<U8> m_alloc;
+	const XmlDocument* m_doc = nullptr;
+	U32 m_node = 0;
 
-	XmlElement(const tinyxml2::XMLElement* el, GenericMemoryPoolAllocator<U8> alloc)
-		: m_el(el)
-		, m_alloc(alloc)
+	XmlElement(const XmlDocument* doc, U32 node)
+		: m_doc(doc)
+		, m_node(node)
 	{
 	}
 
 	ANKI_USE_RESULT Error check() const;
 
+	CString getName() const;
+
+	/// Call a functor for every whitespace separated token of a text.
+	template<typename TFunc>
+	ANKI_USE_RESULT Error forEachNumberToken(CString txt, TFunc func) const;
+
 	template<typename T>
 	ANKI_USE_RESULT Error parseNumbers(CString txt, DynamicArrayAuto<T>& out) const;
 
@@ -191,12 +276,19 @@ private:
 	}
 };
 
-/// XML document.
-class XmlDocument
+/// XML document. It's parsed in-situ with the XmlPullParser to a flat array of nodes so it takes a few allocations no
+/// matter the number of elements.
+class XmlDocument : public NonCopyable
 {
+	friend class XmlElement;
+
 public:
 	static CString XML_HEADER;
 
+	XmlDocument() = default;
+
+	~XmlDocument();
+
 	/// Parse from a file.
 	ANKI_USE_RESULT Error loadFile(CString filename, GenericMemoryPoolAllocator<U8> alloc);
 
@@ -208,8 +300,36 @@ public:
 	ANKI_USE_RESULT Error getChildElementOptional(CString name, XmlElement& out) const;
 
 private:
-	tinyxml2::XMLDocument m_doc;
+	class Node
+	{
+	public:
+		const char* m_name;
+		const char* m_text; ///< The first text before any child element. Null if there is none.
+		U32 m_firstAttribute;
+		U32 m_attributeCount;
+		U32 m_parent;
+		U32 m_firstChild;
+		U32 m_lastChild;
+		U32 m_nextSibling;
+	};
+
+	class Attribute
+	{
+	public:
+		const char* m_name;
+		const char* m_value;
+	};
+
 	GenericMemoryPoolAllocator<U8> m_alloc;
+	DynamicArray<char> m_text; ///< The parsed text. Everything points to it.
+	DynamicArray<Node> m_nodes; ///< The 1st is the document itself.
+	DynamicArray<Attribute> m_attributes;
+
+	void destroy();
+
+	ANKI_USE_RESULT Error parseInternal();
+
+	U32 findChildElement(U32 parent, CString name) const;
 };
 /// @}
 
@@ -4,7 +4,6 @@
 // http://www.anki3d.org/LICENSE
 
 #include <anki/util/Xml.h>
-#include <anki/util/StringList.h>
 
 namespace anki
 {
@@ -14,14 +13,15 @@ Error XmlElement::getNumber(T& out) const
 {
 	ANKI_CHECK(check());
 
-	const char* txt = m_el->GetText();
-	if(txt != nullptr)
+	CString txt;
+	ANKI_CHECK(getText(txt));
+	if(txt)
 	{
-		ANKI_CHECK(CString(txt).toNumber(out));
+		ANKI_CHECK(txt.toNumber(out));
 	}
 	else
 	{
-		ANKI_UTIL_LOGE("Failed to return number. Element: %s", m_el->Value());
+		ANKI_UTIL_LOGE("Failed to return number. Element: %s", getName().cstr());
 		return Error::USER_DATA;
 	}
 
@@ -88,18 +88,58 @@ Error XmlElement::getAttributeNumbersOptional(CString name, TArray& out, Bool& a
 template<typename T>
 Error XmlElement::getAttributeNumberOptional(CString name, T& out, Bool& attribPresent) const
 {
-	DynamicArrayAuto<T> arr(m_alloc);
-	ANKI_CHECK(getAttributeNumbersOptional(name, arr, attribPresent));
+	CString txtVal;
+	ANKI_CHECK(getAttributeTextOptional(name, txtVal, attribPresent));
 
 	if(attribPresent)
 	{
-		if(arr.getSize() != 1)
+		WeakArray<T> arr(&out, 1);
+		if(txtVal.isEmpty() || parseNumbers(txtVal, arr))
 		{
 			ANKI_UTIL_LOGE("Expecting one element for attrib: %s", &name[0]);
 			return Error::USER_DATA;
 		}
+	}
 
-		out = arr[0];
+	return Error::NONE;
+}
+
+template<typename TFunc>
+Error XmlElement::forEachNumberToken(CString txt, TFunc func) const
+{
+	ANKI_ASSERT(txt);
+
+	// Copy every token to a small buffer to null-terminate it. That way nothing gets allocated
+	Array<char, 64> token;
+	const char* it = txt.cstr();
+	while(true)
+	{
+		while(*it == ' ' || *it == '\t' || *it == '\n' || *it == '\r')
+		{
+			++it;
+		}
+
+		if(*it == '\0')
+		{
+			break;
+		}
+
+		const char* tokenBegin = it;
+		while(*it != '\0' && *it != ' ' && *it != '\t' && *it != '\n' && *it != '\r')
+		{
+			++it;
+		}
+
+		const PtrSize length = PtrSize(it - tokenBegin);
+		if(length >= token.getSize())
+		{
+			ANKI_UTIL_LOGE("Number too long in element: %s", getName().cstr());
+			return Error::USER_DATA;
+		}
+
+		memcpy(&token[0], tokenBegin, length);
+		token[length] = '\0';
+		ANKI_CHECK(func(CString(&token[0])));
 	}
 
 	return Error::NONE;
@@ -109,27 +149,22 @@ template<typename T>
 Error XmlElement::parseNumbers(CString txt, DynamicArrayAuto<T>& out) const
 {
 	ANKI_ASSERT(txt);
-	ANKI_ASSERT(m_el);
+	ANKI_ASSERT(m_doc);
 
-	StringListAuto list(m_alloc);
-	list.splitString(txt, ' ');
+	U32 count = 0;
+	ANKI_CHECK(forEachNumberToken(txt, [&](CString) -> Error {
+		++count;
+		return Error::NONE;
+	}));
 
 	out.destroy();
-	out.create(U32(list.getSize()));
+	out.create(count);
 
-	Error err = Error::NONE;
-	auto it = list.getBegin();
-	auto end = list.getEnd();
 	U32 i = 0;
-	while(it != end && !err)
-	{
-		err = it->toNumber(out[i++]);
-		++it;
-	}
-
+	const Error err = forEachNumberToken(txt, [&](CString token) -> Error { return token.toNumber(out[i++]); });
 	if(err)
 	{
-		ANKI_UTIL_LOGE("Failed to covert to numbers the element: %s", m_el->Value());
+		ANKI_UTIL_LOGE("Failed to covert to numbers the element: %s", getName().cstr());
 	}
 
 	return err;
@@ -139,34 +174,32 @@ template<typename TArray>
 Error XmlElement::parseNumbers(CString txt, TArray& out) const
 {
 	ANKI_ASSERT(!txt.isEmpty());
-	ANKI_ASSERT(m_el);
+	ANKI_ASSERT(m_doc);
 
-	StringListAuto list(m_alloc);
-	list.splitString(txt, ' ');
-	const PtrSize listSize = list.getSize();
+	U32 count = 0;
+	const Error err = forEachNumberToken(txt, [&](CString token) -> Error {
+		if(count >= out.getSize())
+		{
+			++count;
+			return Error::NONE;
+		}
 
-	if(listSize != out.getSize())
-	{
-		ANKI_UTIL_LOGE("Wrong number of elements for element: %s", m_el->Value());
-		return Error::USER_DATA;
-	}
+		return token.toNumber(out[count++]);
+	});
 
-	Error err = Error::NONE;
-	auto it = list.getBegin();
-	auto end = list.getEnd();
-	U32 i = 0;
-	while(it != end && !err)
+	if(err)
 	{
-		err = it->toNumber(out[i++]);
-		++it;
+		ANKI_UTIL_LOGE("Failed to covert to numbers the element: %s", getName().cstr());
+		return err;
 	}
 
-	if(err)
+	if(count != out.getSize())
 	{
-		ANKI_UTIL_LOGE("Failed to covert to numbers the element: %s", m_el->Value());
+		ANKI_UTIL_LOGE("Wrong number of elements for element: %s", getName().cstr());
+		return Error::USER_DATA;
 	}
 
-	return err;
+	return Error::NONE;
 }
 
 } // end namespace anki
@@ -0,0 +1,79 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/gr/utils/AliasingAllocator.h>
+#include <tests/framework/Framework.h>
+
+using namespace anki;
+
+ANKI_TEST(Gr, AliasingAllocator)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Simple case
+	{
+		AliasingAllocator aalloc(alloc);
+
+		const U32 a = aalloc.newResource(100, 1, 0, 1);
+		const U32 b = aalloc.newResource(100, 1, 1, 2); // Overlaps with a
+		const U32 c = aalloc.newResource(100, 1, 2, 3); // Overlaps with b, not with a
+		const U32 d = aalloc.newResource(100, 2, 3, 4); // Not compatible with a
+		const U32 e = aalloc.newResource(50, 1, 4, 4); // Smaller, can re-use any slot but d's
+
+		aalloc.pack();
+
+		ANKI_TEST_EXPECT_NEQ(aalloc.getResourceSlot(a), aalloc.getResourceSlot(b));
+		ANKI_TEST_EXPECT_EQ(aalloc.getResourceSlot(a), aalloc.getResourceSlot(c));
+		ANKI_TEST_EXPECT_NEQ(aalloc.getResourceSlot(a), aalloc.getResourceSlot(d));
+		ANKI_TEST_EXPECT_NEQ(aalloc.getResourceSlot(e), aalloc.getResourceSlot(d));
+		ANKI_TEST_EXPECT_EQ(aalloc.getSlots().getSize(), 3);
+		ANKI_TEST_EXPECT_EQ(aalloc.getUnpackedSize(), 450);
+		ANKI_TEST_EXPECT_EQ(aalloc.getPackedSize(), 300);
+	}
+
+	// Random resources. Validate that resources that share a slot never overlap in time
+	{
+		const U32 RESOURCE_COUNT = 256;
+		const U32 MAX_TIME = 64;
+
+		AliasingAllocator aalloc(alloc);
+
+		Array<U32, RESOURCE_COUNT> firstUses;
+		Array<U32, RESOURCE_COUNT> lastUses;
+		Array<U64, RESOURCE_COUNT> keys;
+		Array<PtrSize, RESOURCE_COUNT> sizes;
+		for(U32 i = 0; i < RESOURCE_COUNT; ++i)
+		{
+			firstUses[i] = getRandomRange(0u, MAX_TIME - 1);
+			lastUses[i] = min(firstUses[i] + getRandomRange(0u, 8u), MAX_TIME - 1);
+			keys[i] = getRandomRange(0u, 3u);
+			sizes[i] = getRandomRange(1u, 1024u);
+
+			aalloc.newResource(sizes[i], keys[i], firstUses[i], lastUses[i]);
+		}
+
+		aalloc.pack();
+
+		for(U32 i = 0; i < RESOURCE_COUNT; ++i)
+		{
+			const U32 slotIdx = aalloc.getResourceSlot(i);
+			const AliasingAllocatorSlot& slot = aalloc.getSlots()[slotIdx];
+			ANKI_TEST_EXPECT_EQ(slot.m_compatibilityKey, keys[i]);
+			ANKI_TEST_EXPECT_GEQ(slot.m_size, sizes[i]);
+
+			for(U32 j = i + 1; j < RESOURCE_COUNT; ++j)
+			{
+				if(aalloc.getResourceSlot(j) == slotIdx)
+				{
+					const Bool overlapping = firstUses[i] <= lastUses[j] && firstUses[j] <= lastUses[i];
+					ANKI_TEST_EXPECT_EQ(overlapping, false);
+				}
+			}
+		}
+
+		ANKI_TEST_EXPECT_LEQ(aalloc.getPackedSize(), aalloc.getUnpackedSize());
+		ANKI_TEST_LOGI("Unpacked size %lu packed size %lu", aalloc.getUnpackedSize(), aalloc.getPackedSize());
+	}
+}
@@ -1696,6 +1696,469 @@ ANKI_TEST(Gr, RenderGraph)
 	COMMON_END()
 }
 
+/// Measure the CPU time of RenderGraph::compileNewGraph with and without the compiled graph cache.
+ANKI_TEST(Gr, RenderGraphCompileBench)
+{
+	COMMON_BEGIN()
+
+	const U32 PASS_COUNT = 60;
+	const U32 RT_COUNT = 24;
+	const U32 MIP_COUNT = 4;
+	const U32 ITERATIONS = 200;
+
+	RenderGraphPtr rgraph = gr->newRenderGraph();
+
+	BufferInitInfo buffInit("RenderGraphBench");
+	buffInit.m_size = 256;
+	buffInit.m_usage = BufferUsageBit::ALL_STORAGE;
+	BufferPtr buff = gr->newBuffer(buffInit);
+
+	Array<RenderTargetDescription, RT_COUNT> rtDescrs;
+	for(U32 i = 0; i < RT_COUNT; ++i)
+	{
+		rtDescrs[i].setName("RenderGraphBench");
+		rtDescrs[i].m_width = rtDescrs[i].m_height = 16 << (i % 3);
+		rtDescrs[i].m_format = Format::R8G8B8A8_UNORM;
+		rtDescrs[i].m_mipmapCount = MIP_COUNT;
+		rtDescrs[i].bake();
+	}
+
+	for(U32 mode = 0; mode < 2; ++mode)
+	{
+		const Bool cached = mode == 1;
+		rgraph->setCompiledGraphCacheEnabled(cached);
+
+		Second compileTime = 0.0;
+		for(U32 it = 0; it < ITERATIONS; ++it)
+		{
+			StackAllocator<U8> alloc(allocAligned, nullptr, 2_MB);
+			RenderGraphDescription descr(alloc);
+
+			Array<RenderTargetHandle, RT_COUNT> rts;
+			for(U32 i = 0; i < RT_COUNT; ++i)
+			{
+				rts[i] = descr.newRenderTarget(rtDescrs[i]);
+			}
+			const BufferHandle buffHandle = descr.importBuffer(buff, BufferUsageBit::NONE);
+
+			for(U32 passIdx = 0; passIdx < PASS_COUNT; ++passIdx)
+			{
+				ComputeRenderPassDescription& pass = descr.newComputeRenderPass("Bench");
+				pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+
+				// Write a mip of one RT and read the whole of some previous ones
+				const TextureSubresourceInfo subresource(TextureSurfaceInfo((passIdx / RT_COUNT) % MIP_COUNT, 0, 0, 0));
+				pass.newDependency({rts[passIdx % RT_COUNT], TextureUsageBit::IMAGE_COMPUTE_WRITE, subresource});
+
+				if(passIdx > 0)
+				{
+					pass.newDependency({rts[(passIdx - 1) % RT_COUNT], TextureUsageBit::SAMPLED_COMPUTE});
+				}
+
+				if(passIdx > 7)
+				{
+					pass.newDependency({rts[(passIdx - 7) % RT_COUNT], TextureUsageBit::SAMPLED_COMPUTE});
+				}
+
+				pass.newDependency({buffHandle, (passIdx % 5 == 0) ? BufferUsageBit::STORAGE_COMPUTE_WRITE
+																	: BufferUsageBit::STORAGE_COMPUTE_READ});
+			}
+
+			HighRezTimer timer;
+			timer.start();
+			rgraph->compileNewGraph(descr, alloc);
+			timer.stop();
+			compileTime += timer.getElapsedTime();
+
+			rgraph->run();
+			rgraph->flush();
+			rgraph->reset();
+		}
+
+		gr->finish();
+
+		ANKI_TEST_LOGI("%u passes, cache %s: %f ms per compile", PASS_COUNT, (cached) ? "enabled" : "disabled",
+					   compileTime / Second(ITERATIONS) * 1000.0);
+	}
+
+	RenderGraphStatistics stats;
+	rgraph->getStatistics(stats);
+	ANKI_TEST_LOGI("Barriers: %u texture, %u buffer (%u before the optimizations)", stats.m_textureBarrierCount,
+				   stats.m_bufferBarrierCount, stats.m_unoptimizedBarrierCount);
+	ANKI_TEST_EXPECT_LEQ(stats.m_textureBarrierCount + stats.m_bufferBarrierCount, stats.m_unoptimizedBarrierCount);
+
+	COMMON_END()
+}
+
+/// A GrManager without a device. It's enough for a RenderGraph that only compiles.
+class CompileOnlyGrManager : public GrManager
+{
+public:
+	CompileOnlyGrManager()
+	{
+		m_alloc = GrAllocator<U8>(allocAligned, nullptr);
+	}
+};
+
+static RenderTargetDescription newCompileOnlyRTDescr(U32 size, U32 mipCount, U32 layerCount = 1)
+{
+	RenderTargetDescription texInf("CompileOnly");
+	texInf.m_width = texInf.m_height = size;
+	texInf.m_mipmapCount = mipCount;
+	texInf.m_layerCount = layerCount;
+	texInf.m_type = (layerCount > 1) ? TextureType::_2D_ARRAY : TextureType::_2D;
+	texInf.m_format = Format::R8G8B8A8_UNORM;
+	texInf.bake();
+	return texInf;
+}
+
+static void expectSameCompilation(const RenderGraph& a, const RenderGraph& b, StackAllocator<U8>& alloc)
+{
+	ANKI_TEST_EXPECT_EQ(a.getBatchCount(), b.getBatchCount());
+
+	DynamicArrayAuto<RenderGraphTextureBarrierInfo> barriersa(alloc);
+	DynamicArrayAuto<RenderGraphTextureBarrierInfo> barriersb(alloc);
+	for(U32 batchIdx = 0; batchIdx < a.getBatchCount(); ++batchIdx)
+	{
+		ANKI_TEST_EXPECT_EQ(a.getBatchQueue(batchIdx), b.getBatchQueue(batchIdx));
+
+		ConstWeakArray<U32> passesa = a.getBatchPassIndices(batchIdx);
+		ConstWeakArray<U32> passesb = b.getBatchPassIndices(batchIdx);
+		ANKI_TEST_EXPECT_EQ(passesa.getSize(), passesb.getSize());
+		for(U32 i = 0; i < passesa.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(passesa[i], passesb[i]);
+		}
+
+		a.getBatchTextureBarriers(batchIdx, barriersa);
+		b.getBatchTextureBarriers(batchIdx, barriersb);
+		ANKI_TEST_EXPECT_EQ(barriersa.getSize(), barriersb.getSize());
+		for(U32 i = 0; i < barriersa.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(barriersa[i].m_renderTarget, barriersb[i].m_renderTarget);
+			ANKI_TEST_EXPECT_EQ(barriersa[i].m_usageBefore, barriersb[i].m_usageBefore);
+			ANKI_TEST_EXPECT_EQ(barriersa[i].m_usageAfter, barriersb[i].m_usageAfter);
+			ANKI_TEST_EXPECT_EQ(barriersa[i].m_subresource, barriersb[i].m_subresource);
+		}
+	}
+
+	RenderGraphStatistics statsa, statsb;
+	a.getStatistics(statsa);
+	b.getStatistics(statsb);
+	ANKI_TEST_EXPECT_EQ(statsa.m_textureBarrierCount, statsb.m_textureBarrierCount);
+	ANKI_TEST_EXPECT_EQ(statsa.m_unoptimizedBarrierCount, statsb.m_unoptimizedBarrierCount);
+	ANKI_TEST_EXPECT_EQ(statsa.m_transientMemoryAfterAliasing, statsb.m_transientMemoryAfterAliasing);
+}
+
+/// Compile the same descriptions with and without the compiled graph cache and expect the same batches and barriers.
+/// It doesn't need a GPU.
+ANKI_TEST(Gr, RenderGraphCompileCache)
+{
+	CompileOnlyGrManager gr;
+
+	RenderGraphPtr uncached = gr.newRenderGraph();
+	uncached->setCompileOnly(true);
+	uncached->setCompiledGraphCacheEnabled(false);
+
+	RenderGraphPtr cached = gr.newRenderGraph();
+	cached->setCompileOnly(true);
+	cached->setCompiledGraphCacheEnabled(true);
+
+	const U32 RT_COUNT = 12;
+	const U32 MIP_COUNT = 4;
+	Array<RenderTargetDescription, RT_COUNT> rtDescrs;
+	for(U32 i = 0; i < RT_COUNT; ++i)
+	{
+		rtDescrs[i] = newCompileOnlyRTDescr(16 << (i % 3), MIP_COUNT, (i % 4 == 0) ? 2 : 1);
+	}
+
+	// Alternate between 2 structures to have more than one graph in the cache. The frames after the first 2 hit it
+	for(U32 frame = 0; frame < 6; ++frame)
+	{
+		const U32 passCount = (frame % 2) ? 24 : 40;
+
+		StackAllocator<U8> alloc(allocAligned, nullptr, 2_MB);
+		RenderGraphDescription descr(alloc);
+
+		Array<RenderTargetHandle, RT_COUNT> rts;
+		for(U32 i = 0; i < RT_COUNT; ++i)
+		{
+			rts[i] = descr.newRenderTarget(rtDescrs[i]);
+		}
+
+		for(U32 passIdx = 0; passIdx < passCount; ++passIdx)
+		{
+			// Mix graphics passes, compute passes and async compute passes
+			const Bool graphics = passIdx % 4 == 3;
+			RenderPassDescriptionBase* pass;
+			if(graphics)
+			{
+				pass = &descr.newGraphicsRenderPass("CompileCache");
+			}
+			else
+			{
+				ComputeRenderPassDescription& computePass = descr.newComputeRenderPass("CompileCache");
+				computePass.setQueueHint((passIdx % 3 == 0) ? GpuQueueType::ASYNC_COMPUTE : GpuQueueType::GENERAL);
+				pass = &computePass;
+			}
+
+			pass->setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+
+			// Write a mip of one RT and read the whole of some previous ones
+			const TextureUsageBit write =
+				(graphics) ? TextureUsageBit::IMAGE_FRAGMENT_WRITE : TextureUsageBit::IMAGE_COMPUTE_WRITE;
+			const TextureUsageBit read =
+				(graphics) ? TextureUsageBit::SAMPLED_FRAGMENT : TextureUsageBit::SAMPLED_COMPUTE;
+			const TextureSubresourceInfo subresource(TextureSurfaceInfo((passIdx / RT_COUNT) % MIP_COUNT, 0, 0, 0));
+			pass->newDependency({rts[passIdx % RT_COUNT], write, subresource});
+
+			if(passIdx > 0)
+			{
+				pass->newDependency({rts[(passIdx - 1) % RT_COUNT], read});
+			}
+
+			if(passIdx > 5)
+			{
+				pass->newDependency({rts[(passIdx - 5) % RT_COUNT], read});
+			}
+		}
+
+		uncached->compileNewGraph(descr, alloc);
+		cached->compileNewGraph(descr, alloc);
+
+		expectSameCompilation(*uncached, *cached, alloc);
+
+		uncached->reset();
+		cached->reset();
+	}
+}
+
+static void expectTextureBarrier(const RenderGraphTextureBarrierInfo& barrier, RenderTargetHandle rt,
+								 TextureUsageBit usageBefore, TextureUsageBit usageAfter, U32 firstMip, U32 mipCount,
+								 U32 firstLayer = 0, U32 layerCount = 1)
+{
+	TextureSubresourceInfo subresource;
+	subresource.m_firstMipmap = firstMip;
+	subresource.m_mipmapCount = mipCount;
+	subresource.m_firstLayer = firstLayer;
+	subresource.m_layerCount = layerCount;
+
+	ANKI_TEST_EXPECT_EQ(barrier.m_renderTarget, rt);
+	ANKI_TEST_EXPECT_EQ(barrier.m_usageBefore, usageBefore);
+	ANKI_TEST_EXPECT_EQ(barrier.m_usageAfter, usageAfter);
+	ANKI_TEST_EXPECT_EQ(barrier.m_subresource, subresource);
+}
+
+/// The barriers of the surfaces of a render target that are set in the same batch become one barrier for the range.
+ANKI_TEST(Gr, RenderGraphBarrierMerging)
+{
+	CompileOnlyGrManager gr;
+	RenderGraphPtr rgraph = gr.newRenderGraph();
+	rgraph->setCompileOnly(true);
+
+	StackAllocator<U8> alloc(allocAligned, nullptr, 1_MB);
+	RenderGraphDescription descr(alloc);
+
+	// The RTs have different sizes so that they don't alias
+	const RenderTargetHandle rt = descr.newRenderTarget(newCompileOnlyRTDescr(16, 4));
+	const RenderTargetHandle arrayRt = descr.newRenderTarget(newCompileOnlyRTDescr(32, 2, 3));
+
+	// Write all the surfaces
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("Write");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({rt, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+		pass.newDependency({arrayRt, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+	}
+
+	// Read some mips and some layers
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("Read");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+
+		TextureSubresourceInfo subresource;
+		subresource.m_firstMipmap = 1;
+		subresource.m_mipmapCount = 2;
+		pass.newDependency({rt, TextureUsageBit::SAMPLED_COMPUTE, subresource});
+
+		subresource = TextureSubresourceInfo();
+		subresource.m_mipmapCount = 2;
+		subresource.m_firstLayer = 1;
+		subresource.m_layerCount = 2;
+		pass.newDependency({arrayRt, TextureUsageBit::SAMPLED_COMPUTE, subresource});
+	}
+
+	rgraph->compileNewGraph(descr, alloc);
+
+	ANKI_TEST_EXPECT_EQ(rgraph->getBatchCount(), 2);
+
+	DynamicArrayAuto<RenderGraphTextureBarrierInfo> barriers(alloc);
+	rgraph->getBatchTextureBarriers(0, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 2);
+	expectTextureBarrier(barriers[0], rt, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 4);
+	expectTextureBarrier(barriers[1], arrayRt, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 2, 0,
+						 3);
+
+	rgraph->getBatchTextureBarriers(1, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 2);
+	expectTextureBarrier(barriers[0], rt, TextureUsageBit::IMAGE_COMPUTE_WRITE, TextureUsageBit::SAMPLED_COMPUTE, 1,
+						 2);
+	expectTextureBarrier(barriers[1], arrayRt, TextureUsageBit::IMAGE_COMPUTE_WRITE, TextureUsageBit::SAMPLED_COMPUTE,
+						 0, 2, 1, 2);
+
+	RenderGraphStatistics stats;
+	rgraph->getStatistics(stats);
+	ANKI_TEST_EXPECT_EQ(stats.m_textureBarrierCount, 4);
+	ANKI_TEST_EXPECT_EQ(stats.m_unoptimizedBarrierCount, 4 + 6 + 2 + 4);
+
+	rgraph->reset();
+}
+
+/// A read after a read of the same layout doesn't get a barrier. The previous barrier covers the new stages instead.
+ANKI_TEST(Gr, RenderGraphBarrierReadToRead)
+{
+	CompileOnlyGrManager gr;
+	RenderGraphPtr rgraph = gr.newRenderGraph();
+	rgraph->setCompileOnly(true);
+
+	StackAllocator<U8> alloc(allocAligned, nullptr, 1_MB);
+	RenderGraphDescription descr(alloc);
+
+	const RenderTargetHandle a = descr.newRenderTarget(newCompileOnlyRTDescr(16, 1));
+	const RenderTargetHandle b = descr.newRenderTarget(newCompileOnlyRTDescr(32, 1));
+	const RenderTargetHandle c = descr.newRenderTarget(newCompileOnlyRTDescr(64, 1));
+
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("WriteA");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({a, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+	}
+
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("ReadAWriteB");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({a, TextureUsageBit::SAMPLED_COMPUTE});
+		pass.newDependency({b, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+	}
+
+	// Reads A in another stage. Extends the previous barrier of A
+	{
+		GraphicsRenderPassDescription& pass = descr.newGraphicsRenderPass("ReadABWriteC");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({a, TextureUsageBit::SAMPLED_FRAGMENT});
+		pass.newDependency({b, TextureUsageBit::SAMPLED_FRAGMENT});
+		pass.newDependency({c, TextureUsageBit::IMAGE_FRAGMENT_WRITE});
+	}
+
+	// Reads A in a stage that the previous barrier covers. No barrier for A
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("ReadAC");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({a, TextureUsageBit::SAMPLED_COMPUTE});
+		pass.newDependency({c, TextureUsageBit::SAMPLED_COMPUTE});
+	}
+
+	rgraph->compileNewGraph(descr, alloc);
+
+	ANKI_TEST_EXPECT_EQ(rgraph->getBatchCount(), 4);
+
+	// The first writes of B and C are hoisted to the 1st batch
+	DynamicArrayAuto<RenderGraphTextureBarrierInfo> barriers(alloc);
+	rgraph->getBatchTextureBarriers(0, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 3);
+	expectTextureBarrier(barriers[0], a, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 1);
+	expectTextureBarrier(barriers[1], b, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 1);
+	expectTextureBarrier(barriers[2], c, TextureUsageBit::NONE, TextureUsageBit::IMAGE_FRAGMENT_WRITE, 0, 1);
+
+	rgraph->getBatchTextureBarriers(1, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 1);
+	expectTextureBarrier(barriers[0], a, TextureUsageBit::IMAGE_COMPUTE_WRITE,
+						 TextureUsageBit::SAMPLED_COMPUTE | TextureUsageBit::SAMPLED_FRAGMENT, 0, 1);
+
+	rgraph->getBatchTextureBarriers(2, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 1);
+	expectTextureBarrier(barriers[0], b, TextureUsageBit::IMAGE_COMPUTE_WRITE, TextureUsageBit::SAMPLED_FRAGMENT, 0,
+						 1);
+
+	rgraph->getBatchTextureBarriers(3, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 1);
+	expectTextureBarrier(barriers[0], c, TextureUsageBit::IMAGE_FRAGMENT_WRITE, TextureUsageBit::SAMPLED_COMPUTE, 0,
+						 1);
+
+	RenderGraphStatistics stats;
+	rgraph->getStatistics(stats);
+	ANKI_TEST_EXPECT_EQ(stats.m_textureBarrierCount, 6);
+	ANKI_TEST_EXPECT_EQ(stats.m_unoptimizedBarrierCount, 8);
+
+	rgraph->reset();
+}
+
+/// The barriers move to the earliest batch of the same queue after the last use of the surface. They don't move to
+/// another queue.
+ANKI_TEST(Gr, RenderGraphBarrierHoisting)
+{
+	CompileOnlyGrManager gr;
+	RenderGraphPtr rgraph = gr.newRenderGraph();
+	rgraph->setCompileOnly(true);
+
+	StackAllocator<U8> alloc(allocAligned, nullptr, 1_MB);
+	RenderGraphDescription descr(alloc);
+
+	const RenderTargetHandle a = descr.newRenderTarget(newCompileOnlyRTDescr(16, 1));
+	const RenderTargetHandle b = descr.newRenderTarget(newCompileOnlyRTDescr(32, 1));
+	const RenderTargetHandle c = descr.newRenderTarget(newCompileOnlyRTDescr(64, 1));
+
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("WriteA");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({a, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+	}
+
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("ReadAWriteB");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.setQueueHint(GpuQueueType::ASYNC_COMPUTE);
+		pass.newDependency({a, TextureUsageBit::SAMPLED_COMPUTE});
+		pass.newDependency({b, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+	}
+
+	{
+		ComputeRenderPassDescription& pass = descr.newComputeRenderPass("ReadBWriteC");
+		pass.setWork([](RenderPassWorkContext&) {}, nullptr, 0);
+		pass.newDependency({b, TextureUsageBit::SAMPLED_COMPUTE});
+		pass.newDependency({c, TextureUsageBit::IMAGE_COMPUTE_WRITE});
+	}
+
+	rgraph->compileNewGraph(descr, alloc);
+
+	ANKI_TEST_EXPECT_EQ(rgraph->getBatchCount(), 3);
+	ANKI_TEST_EXPECT_EQ(rgraph->getBatchQueue(0), GpuQueueType::GENERAL);
+	ANKI_TEST_EXPECT_EQ(rgraph->getBatchQueue(1), GpuQueueType::ASYNC_COMPUTE);
+	ANKI_TEST_EXPECT_EQ(rgraph->getBatchQueue(2), GpuQueueType::GENERAL);
+
+	// C is first used in the 3rd batch but its barrier is hoisted to the 1st batch of the same queue
+	DynamicArrayAuto<RenderGraphTextureBarrierInfo> barriers(alloc);
+	rgraph->getBatchTextureBarriers(0, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 2);
+	expectTextureBarrier(barriers[0], a, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 1);
+	expectTextureBarrier(barriers[1], c, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 1);
+
+	// B is first used in the async compute queue. It can't move to the batch of the other queue
+	rgraph->getBatchTextureBarriers(1, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 2);
+	expectTextureBarrier(barriers[0], a, TextureUsageBit::IMAGE_COMPUTE_WRITE, TextureUsageBit::SAMPLED_COMPUTE, 0,
+						 1);
+	expectTextureBarrier(barriers[1], b, TextureUsageBit::NONE, TextureUsageBit::IMAGE_COMPUTE_WRITE, 0, 1);
+
+	// The last use of B is in the other queue. The barrier stays in the batch that needs it
+	rgraph->getBatchTextureBarriers(2, barriers);
+	ANKI_TEST_EXPECT_EQ(barriers.getSize(), 1);
+	expectTextureBarrier(barriers[0], b, TextureUsageBit::IMAGE_COMPUTE_WRITE, TextureUsageBit::SAMPLED_COMPUTE, 0,
+						 1);
+
+	rgraph->reset();
+}
+
 /// Test workarounds for some unsupported formats
 ANKI_TEST(Gr, VkWorkarounds)
 {
@@ -0,0 +1,222 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/gr/utils/QueueScheduler.h>
+#include <anki/gr/utils/AliasingAllocator.h>
+#include <tests/framework/Framework.h>
+
+using namespace anki;
+
+ANKI_TEST(Gr, QueueScheduler)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Something that looks like a frame
+	{
+		QueueScheduler scheduler(alloc);
+
+		const U32 gbuffer = scheduler.newPass(GpuQueueType::GENERAL, {});
+		const U32 depthDownscale = scheduler.newPass(GpuQueueType::ASYNC_COMPUTE, Array<U32, 1>{gbuffer});
+		const U32 ssao = scheduler.newPass(GpuQueueType::ASYNC_COMPUTE, Array<U32, 1>{depthDownscale});
+		const U32 shadows = scheduler.newPass(GpuQueueType::GENERAL, {});
+		const U32 lightShading = scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 3>{gbuffer, ssao, shadows});
+		const U32 volumetric = scheduler.newPass(GpuQueueType::ASYNC_COMPUTE, Array<U32, 1>{depthDownscale});
+		const U32 finalComposite = scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 2>{lightShading, volumetric});
+
+		scheduler.schedule();
+
+		ConstWeakArray<QueueSchedulerBatch> batches = scheduler.getBatches();
+		ANKI_TEST_EXPECT_EQ(batches.getSize(), 5);
+
+		// GBuffer and shadows together
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(gbuffer), 0);
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(shadows), 0);
+		ANKI_TEST_EXPECT_EQ(batches[0].m_queue, GpuQueueType::GENERAL);
+		ANKI_TEST_EXPECT_EQ(batches[0].m_signal, true);
+
+		// Depth downscale waits for the gbuffer
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(depthDownscale), 1);
+		ANKI_TEST_EXPECT_EQ(batches[1].m_queue, GpuQueueType::ASYNC_COMPUTE);
+		ANKI_TEST_EXPECT_EQ(batches[1].m_waitBatches[GpuQueueType::GENERAL], 0);
+
+		// SSAO and volumetric run together on the compute queue without waiting again
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(ssao), 2);
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(volumetric), 2);
+		ANKI_TEST_EXPECT_EQ(batches[2].m_queue, GpuQueueType::ASYNC_COMPUTE);
+		ANKI_TEST_EXPECT_EQ(batches[2].m_waitBatches[GpuQueueType::GENERAL], MAX_U32);
+		ANKI_TEST_EXPECT_EQ(batches[2].m_signal, true);
+
+		// Light shading waits for the compute queue
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(lightShading), 3);
+		ANKI_TEST_EXPECT_EQ(batches[3].m_waitBatches[GpuQueueType::ASYNC_COMPUTE], 2);
+
+		// The final composite is covered by the wait of the light shading
+		ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(finalComposite), 4);
+		ANKI_TEST_EXPECT_EQ(batches[4].m_waitBatches[GpuQueueType::ASYNC_COMPUTE], MAX_U32);
+
+		ANKI_TEST_EXPECT_EQ(scheduler.getSyncPointCount(), 2);
+	}
+
+	// Only the general queue. No sync points
+	{
+		QueueScheduler scheduler(alloc);
+
+		const U32 a = scheduler.newPass(GpuQueueType::GENERAL, {});
+		const U32 b = scheduler.newPass(GpuQueueType::GENERAL, {});
+		const U32 c = scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 2>{a, b});
+		scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 1>{c});
+		scheduler.schedule();
+
+		ANKI_TEST_EXPECT_EQ(scheduler.getBatches().getSize(), 3);
+		ANKI_TEST_EXPECT_EQ(scheduler.getBatches()[0].m_passCount, 2);
+		ANKI_TEST_EXPECT_EQ(scheduler.getSyncPointCount(), 0);
+	}
+
+	// Random graphs. Validate that every dependency is satisfied by the queue order or by a wait
+	{
+		const U32 PASS_COUNT = 128;
+		QueueScheduler scheduler(alloc);
+
+		Array2d<U32, PASS_COUNT, 4> deps;
+		Array<U32, PASS_COUNT> depCounts;
+		for(U32 passIdx = 0; passIdx < PASS_COUNT; ++passIdx)
+		{
+			depCounts[passIdx] = (passIdx > 0) ? getRandomRange(0u, min(passIdx, 4u)) : 0;
+			for(U32 i = 0; i < depCounts[passIdx]; ++i)
+			{
+				deps[passIdx][i] = getRandomRange(0u, passIdx - 1);
+			}
+
+			const GpuQueueType queue = (getRandom() % 3 == 0) ? GpuQueueType::ASYNC_COMPUTE : GpuQueueType::GENERAL;
+			scheduler.newPass(queue, ConstWeakArray<U32>(&deps[passIdx][0], depCounts[passIdx]));
+		}
+
+		scheduler.schedule();
+		ConstWeakArray<QueueSchedulerBatch> batches = scheduler.getBatches();
+
+		U32 passCount = 0;
+		for(U32 batchIdx = 0; batchIdx < batches.getSize(); ++batchIdx)
+		{
+			const QueueSchedulerBatch& batch = batches[batchIdx];
+			passCount += batch.m_passCount;
+
+			if(batchIdx > 0)
+			{
+				ANKI_TEST_EXPECT_LEQ(batches[batchIdx - 1].m_step, batch.m_step);
+			}
+
+			for(U32 i = batch.m_firstPass; i < batch.m_firstPass + batch.m_passCount; ++i)
+			{
+				const U32 passIdx = scheduler.getBatchPassIndices()[i];
+				ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(passIdx), batchIdx);
+
+				for(U32 d = 0; d < depCounts[passIdx]; ++d)
+				{
+					const U32 depPassIdx = deps[passIdx][d];
+					const U32 depBatchIdx = scheduler.getPassBatch(depPassIdx);
+					ANKI_TEST_EXPECT_LT(batches[depBatchIdx].m_step, batch.m_step);
+
+					const GpuQueueType depQueue = batches[depBatchIdx].m_queue;
+					if(depQueue == batch.m_queue)
+					{
+						continue;
+					}
+
+					// Some batch of this queue up to this one should have waited for the dep batch or a later one
+					Bool covered = false;
+					for(U32 b = 0; b <= batchIdx && !covered; ++b)
+					{
+						const U32 waitBatchIdx = batches[b].m_waitBatches[depQueue];
+						covered = batches[b].m_queue == batch.m_queue && waitBatchIdx != MAX_U32
+								  && waitBatchIdx >= depBatchIdx;
+					}
+
+					ANKI_TEST_EXPECT_EQ(covered, true);
+				}
+			}
+		}
+
+		ANKI_TEST_EXPECT_EQ(passCount, PASS_COUNT);
+	}
+}
+
+ANKI_TEST(Gr, QueueBatchTimeline)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Two async compute passes that run next to the general queue
+	QueueScheduler scheduler(alloc);
+	const U32 gbuffer = scheduler.newPass(GpuQueueType::GENERAL, {});
+	const U32 lightShading = scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 1>{gbuffer});
+	const U32 ssao = scheduler.newPass(GpuQueueType::ASYNC_COMPUTE, Array<U32, 1>{gbuffer});
+	const U32 ssaoBlur = scheduler.newPass(GpuQueueType::ASYNC_COMPUTE, Array<U32, 1>{ssao});
+	const U32 forward = scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 1>{lightShading});
+	const U32 finalComposite = scheduler.newPass(GpuQueueType::GENERAL, Array<U32, 2>{forward, ssaoBlur});
+	scheduler.schedule();
+
+	ConstWeakArray<QueueSchedulerBatch> batches = scheduler.getBatches();
+	ANKI_TEST_EXPECT_EQ(batches.getSize(), 6);
+	ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(gbuffer), 0);
+	ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(lightShading), 1);
+	ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(ssao), 2);
+	ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(forward), 3);
+	ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(ssaoBlur), 4);
+	ANKI_TEST_EXPECT_EQ(scheduler.getPassBatch(finalComposite), 5);
+
+	QueueBatchTimeline timeline(alloc);
+	for(const QueueSchedulerBatch& batch : batches)
+	{
+		timeline.newBatch(batch.m_queue, batch.m_waitBatches);
+	}
+
+	// The order of the queue and the waits
+	ANKI_TEST_EXPECT_EQ(timeline.runsAfter(4, 2), true);
+	ANKI_TEST_EXPECT_EQ(timeline.runsAfter(2, 0), true);
+	ANKI_TEST_EXPECT_EQ(timeline.runsAfter(5, 2), true);
+	ANKI_TEST_EXPECT_EQ(timeline.runsAfter(3, 2), false);
+	ANKI_TEST_EXPECT_EQ(timeline.runsAfter(4, 3), false);
+	ANKI_TEST_EXPECT_EQ(timeline.runsAfter(2, 1), false);
+
+	// Something used only by the SSAO is done before the SSAO blur and the final composite but it overlaps with the
+	// forward pass although the forward has a larger batch index
+	Array<U32, U32(GpuQueueType::COUNT)> lastBatches = {MAX_U32, 2};
+	ANKI_TEST_EXPECT_EQ(timeline.findLastOverlappingBatch(lastBatches), 4);
+
+	// Used by the light shading and the SSAO blur
+	lastBatches = {1, 4};
+	ANKI_TEST_EXPECT_EQ(timeline.findLastOverlappingBatch(lastBatches), 4);
+
+	// Used only by the general queue. Nothing of the compute queue runs after so it overlaps with all of it
+	lastBatches = {3, MAX_U32};
+	ANKI_TEST_EXPECT_EQ(timeline.findLastOverlappingBatch(lastBatches), 4);
+
+	// Used by the final composite
+	lastBatches = {5, MAX_U32};
+	ANKI_TEST_EXPECT_EQ(timeline.findLastOverlappingBatch(lastBatches), 5);
+
+	// Without the timeline the SSAO and the forward render targets would share memory
+	{
+		AliasingAllocator aliasing(alloc);
+		const U32 ssaoRt = aliasing.newResource(1024, 1, 2, timeline.findLastOverlappingBatch({MAX_U32, 2}));
+		const U32 forwardRt = aliasing.newResource(1024, 1, 3, timeline.findLastOverlappingBatch({3, MAX_U32}));
+		const U32 compositeRt = aliasing.newResource(1024, 1, 5, timeline.findLastOverlappingBatch({5, MAX_U32}));
+		aliasing.pack();
+
+		ANKI_TEST_EXPECT_NEQ(aliasing.getResourceSlot(ssaoRt), aliasing.getResourceSlot(forwardRt));
+		ANKI_TEST_EXPECT_EQ(aliasing.getResourceSlot(ssaoRt), aliasing.getResourceSlot(compositeRt));
+	}
+
+	// A single queue gives the last use
+	{
+		QueueBatchTimeline singleQueue(alloc);
+		for(U32 i = 0; i < 4; ++i)
+		{
+			singleQueue.newBatch(GpuQueueType::GENERAL, {MAX_U32, MAX_U32});
+		}
+
+		ANKI_TEST_EXPECT_EQ(singleQueue.findLastOverlappingBatch({1, MAX_U32}), 1);
+		ANKI_TEST_EXPECT_EQ(singleQueue.findLastOverlappingBatch({3, MAX_U32}), 3);
+	}
+}
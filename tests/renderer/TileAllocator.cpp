@@ -71,4 +71,341 @@ ANKI_TEST(Renderer, TileAllocator)
 	}
 }
 
+static Bool viewportsOverlap(const Array<U32, 4>& a, const Array<U32, 4>& b)
+{
+	return a[0] < b[0] + b[2] && b[0] < a[0] + a[2] && a[1] < b[1] + b[3] && b[1] < a[1] + a[3];
+}
+
+ANKI_TEST(Renderer, TileAllocatorFragmentation)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	TileAllocator talloc;
+	talloc.init(alloc, 8, 8, 3, true);
+
+	Array<U32, 4> viewport;
+	TileAllocatorResult res;
+	const U32 dcCount = 666;
+
+	// Fill the atlas with small tiles
+	for(U32 i = 0; i < 64; ++i)
+	{
+		res = talloc.allocate(1, 1, 100 + i, 0, dcCount, 0, viewport);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+
+	// Keep using all of them except one small tile in every big tile. Those become the least recently used tiles
+	for(U32 i = 0; i < 64; ++i)
+	{
+		if((i % 16) == 0)
+		{
+			continue;
+		}
+
+		res = talloc.allocate(2, 1, 100 + i, 0, dcCount, 0, viewport);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::CACHED);
+	}
+
+	// New small lights should be packed into a single big tile and not kick the least recently used tiles that are
+	// scattered around the atlas
+	Array<U32, 4> firstViewport = {};
+	for(U32 i = 0; i < 4; ++i)
+	{
+		res = talloc.allocate(3, 3, 200 + i, 0, dcCount, 0, viewport);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+
+		if(i == 0)
+		{
+			firstViewport = viewport;
+		}
+		else
+		{
+			ANKI_TEST_EXPECT_EQ(viewport[0] / 4, firstViewport[0] / 4);
+			ANKI_TEST_EXPECT_EQ(viewport[1] / 4, firstViewport[1] / 4);
+		}
+	}
+
+	// And the rest of the big tiles are available for big lights
+	for(U32 i = 0; i < 3; ++i)
+	{
+		res = talloc.allocate(3, 3, 300 + i, 0, dcCount, 2, viewport);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+}
+
+ANKI_TEST(Renderer, TileAllocatorChurn)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	TileAllocator talloc;
+	talloc.init(alloc, 16, 16, 3, true);
+
+	const U32 LIGHT_COUNT = 128;
+	const U32 FRAME_COUNT = 256;
+	const U32 dcCount = 10;
+
+	class Light
+	{
+	public:
+		Timestamp m_timestamp = 1;
+		U32 m_lod = 0;
+		Array<U32, 4> m_viewport = {};
+		Bool m_hasTile = false;
+	};
+
+	Array<Light, LIGHT_COUNT> lights;
+	for(Light& light : lights)
+	{
+		light.m_lod = getRandomRange(0u, 2u);
+	}
+
+	Array<Array<U32, 4>, LIGHT_COUNT> frameViewports;
+	U32 downgradeCount = 0;
+	for(Timestamp frame = 1; frame <= FRAME_COUNT; ++frame)
+	{
+		U32 frameViewportCount = 0;
+
+		for(U32 lightIdx = 0; lightIdx < LIGHT_COUNT; ++lightIdx)
+		{
+			Light& light = lights[lightIdx];
+
+			// Only some lights are visible every frame and some of them move
+			if(getRandom() % 3 == 0)
+			{
+				continue;
+			}
+
+			if(getRandom() % 8 == 0)
+			{
+				light.m_timestamp = frame;
+			}
+
+			Array<U32, 4> viewport;
+			U32 tileLod;
+			const TileAllocatorResult res =
+				talloc.allocate(frame, light.m_timestamp, lightIdx + 1, 0, dcCount, light.m_lod, 0, viewport, tileLod);
+
+			if(res == TileAllocatorResult::ALLOCATION_FAILED)
+			{
+				light.m_hasTile = false;
+				continue;
+			}
+
+			ANKI_TEST_EXPECT_LEQ(tileLod, light.m_lod);
+			ANKI_TEST_EXPECT_EQ(viewport[2], 1u << tileLod);
+
+			// A cached tile should point to the same place
+			if(res == TileAllocatorResult::CACHED)
+			{
+				ANKI_TEST_EXPECT_EQ(light.m_hasTile, true);
+				for(U32 i = 0; i < 4; ++i)
+				{
+					ANKI_TEST_EXPECT_EQ(viewport[i], light.m_viewport[i]);
+				}
+			}
+
+			// Tiles of the same frame should never overlap
+			for(U32 i = 0; i < frameViewportCount; ++i)
+			{
+				ANKI_TEST_EXPECT_EQ(viewportsOverlap(viewport, frameViewports[i]), false);
+			}
+			frameViewports[frameViewportCount++] = viewport;
+
+			light.m_viewport = viewport;
+			light.m_hasTile = true;
+		}
+
+		downgradeCount += talloc.getDowngradeCount();
+	}
+
+	// 128 lights don't fit in the atlas, some should have been downgraded
+	ANKI_TEST_EXPECT_GT(downgradeCount, 0u);
+}
+
+ANKI_TEST(Renderer, TileAllocatorRefreshBudget)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	TileAllocator talloc;
+	talloc.init(alloc, 8, 8, 3, true);
+	talloc.setRefreshBudget(2);
+
+	Array<U32, 4> viewport;
+	U32 tileLod;
+	TileAllocatorResult res;
+	const U32 dcCount = 666;
+
+	// The first render is never deferred
+	for(U32 i = 0; i < 5; ++i)
+	{
+		res = talloc.allocate(1, 1, 100 + i, 0, dcCount, 1, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getRefreshCount(), 5);
+
+	// All lights moved, only 2 are refreshed
+	for(U32 i = 0; i < 5; ++i)
+	{
+		res = talloc.allocate(2, 2, 100 + i, 0, dcCount, 1, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, (i < 2) ? TileAllocatorResult::ALLOCATION_SUCCEEDED : TileAllocatorResult::CACHED);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getRefreshCount(), 2);
+	ANKI_TEST_EXPECT_EQ(talloc.getDeferredRefreshCount(), 3);
+
+	// The stale lights are more important than the fresh ones of the same size and lights without tiles come first
+	const F32 freshPriority = talloc.computeRefreshPriority(3, 100, 0, 1.0f);
+	const F32 stalePriority = talloc.computeRefreshPriority(3, 104, 0, 1.0f);
+	ANKI_TEST_EXPECT_GT(stalePriority, freshPriority);
+	ANKI_TEST_EXPECT_GT(talloc.computeRefreshPriority(3, 666, 0, 0.1f), stalePriority);
+
+	// The deferred ones are refreshed in the next frame as long as there is budget. The staleness of the rest grows
+	for(U32 i = 0; i < 5; ++i)
+	{
+		res = talloc.allocate(3, 2, 100 + i, 0, dcCount, 1, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, (i == 2 || i == 3) ? TileAllocatorResult::ALLOCATION_SUCCEEDED
+													: TileAllocatorResult::CACHED);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getDeferredRefreshCount(), 1);
+	ANKI_TEST_EXPECT_GT(talloc.computeRefreshPriority(4, 104, 0, 1.0f), stalePriority);
+
+	// The non budgeted allocations are never deferred
+	talloc.setRefreshBudget(1);
+	res = talloc.allocate(4, 4, 100, 0, dcCount, 1, viewport);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	res = talloc.allocate(4, 4, 101, 0, dcCount, 1, viewport);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+
+	// No budget, refresh the rest
+	talloc.setRefreshBudget(0);
+	for(U32 i = 2; i < 5; ++i)
+	{
+		res = talloc.allocate(4, 2, 100 + i, 0, dcCount, 1, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, (i < 4) ? TileAllocatorResult::CACHED : TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getDeferredRefreshCount(), 0);
+	ANKI_TEST_EXPECT_EQ(talloc.computeRefreshPriority(5, 104, 0, 1.0f), freshPriority);
+}
+
+ANKI_TEST(Renderer, TileAllocatorRelease)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	TileAllocator talloc;
+	talloc.init(alloc, 8, 8, 3, true);
+	talloc.setRefreshBudget(4);
+
+	Array<U32, 4> viewport;
+	U32 tileLod;
+	TileAllocatorResult res;
+	const U32 dcCount = 666;
+
+	// A light takes all the big tiles
+	for(U32 face = 0; face < 4; ++face)
+	{
+		res = talloc.allocate(1, 1, 100, face, dcCount, 2, 2, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getRefreshCount(), 4);
+
+	// Its other faces don't fit so it gives back the tiles and the refreshes
+	res = talloc.allocate(1, 1, 100, 4, dcCount, 2, 2, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_FAILED);
+	for(U32 face = 0; face < 4; ++face)
+	{
+		talloc.release(100, face);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getRefreshCount(), 0);
+
+	// Other lights can use the space and the budget in the same timestamp
+	for(U32 i = 0; i < 4; ++i)
+	{
+		res = talloc.allocate(1, 1, 200 + i, 0, dcCount, 2, 2, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+	ANKI_TEST_EXPECT_EQ(talloc.getRefreshCount(), 4);
+
+	// The released faces are not cached any more
+	res = talloc.allocate(2, 1, 100, 0, dcCount, 2, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	ANKI_TEST_EXPECT_EQ(tileLod, 2);
+
+	// Release a small tile, its big tile is still in use by the siblings
+	for(U32 face = 0; face < 4; ++face)
+	{
+		res = talloc.allocate(3, 1, 300, face, dcCount, 0, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	}
+	talloc.release(300, 3);
+	res = talloc.allocate(3, 1, 400, 0, dcCount, 2, 2, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	res = talloc.allocate(3, 1, 401, 0, dcCount, 2, 2, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	res = talloc.allocate(3, 1, 402, 0, dcCount, 2, 2, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	res = talloc.allocate(3, 1, 403, 0, dcCount, 2, 2, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_FAILED);
+}
+
+ANKI_TEST(Renderer, TileAllocatorDowngrade)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	TileAllocator talloc;
+	talloc.init(alloc, 8, 8, 3, true);
+
+	Array<U32, 4> viewport;
+	U32 tileLod;
+	TileAllocatorResult res;
+	const U32 dcCount = 666;
+
+	// 3 big and 1 medium
+	for(U32 i = 0; i < 3; ++i)
+	{
+		res = talloc.allocate(1, 1, 100 + i, 0, dcCount, 2, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+		ANKI_TEST_EXPECT_EQ(tileLod, 2);
+	}
+	res = talloc.allocate(1, 1, 200, 0, dcCount, 1, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+
+	// No more big tiles, get a medium one
+	res = talloc.allocate(1, 1, 300, 0, dcCount, 2, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	ANKI_TEST_EXPECT_EQ(tileLod, 1);
+	ANKI_TEST_EXPECT_EQ(viewport[2], 2);
+	ANKI_TEST_EXPECT_EQ(talloc.getDowngradeCount(), 1);
+
+	// Can't go lower than the min LOD
+	res = talloc.allocate(1, 1, 301, 0, dcCount, 2, 2, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_FAILED);
+
+	// Everything is still used, keep the smaller tile
+	for(U32 i = 0; i < 3; ++i)
+	{
+		res = talloc.allocate(2, 1, 100 + i, 0, dcCount, 2, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::CACHED);
+	}
+	res = talloc.allocate(2, 1, 200, 0, dcCount, 1, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::CACHED);
+	res = talloc.allocate(2, 1, 300, 0, dcCount, 2, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::CACHED);
+	ANKI_TEST_EXPECT_EQ(tileLod, 1);
+
+	// The medium light is gone, upgrade
+	for(U32 i = 0; i < 3; ++i)
+	{
+		res = talloc.allocate(3, 1, 100 + i, 0, dcCount, 2, 0, viewport, tileLod);
+		ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::CACHED);
+	}
+	res = talloc.allocate(3, 1, 300, 0, dcCount, 2, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::ALLOCATION_SUCCEEDED);
+	ANKI_TEST_EXPECT_EQ(tileLod, 2);
+	ANKI_TEST_EXPECT_EQ(viewport[2], 4);
+
+	// And stays there
+	res = talloc.allocate(4, 1, 300, 0, dcCount, 2, 0, viewport, tileLod);
+	ANKI_TEST_EXPECT_EQ(res, TileAllocatorResult::CACHED);
+	ANKI_TEST_EXPECT_EQ(tileLod, 2);
+}
+
 } // end namespace anki
\ No newline at end of file
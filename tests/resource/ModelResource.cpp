@@ -0,0 +1,63 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/resource/ModelResource.h>
+#include <anki/resource/MeshResource.h>
+#include <anki/resource/ResourceManager.h>
+#include <anki/core/ConfigSet.h>
+
+namespace anki
+{
+
+ANKI_TEST(Resource, ModelPatchLodFallback)
+{
+	ConfigSet config = DefaultConfigSet::get();
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	ResourceManagerInitInfo rinit;
+	rinit.m_gr = nullptr;
+	rinit.m_config = &config;
+	rinit.m_cacheDir = "/tmp/";
+	rinit.m_allocCallback = allocAligned;
+	rinit.m_allocCallbackData = nullptr;
+	ResourceManager* resources = alloc.newInstance<ResourceManager>();
+	ANKI_TEST_EXPECT_NO_ERR(resources->init(rinit));
+
+	{
+		// 3 LODs and only the coarsest is resident like a streamed patch that was just loaded
+		Array<MeshResourcePtr, 3> meshes;
+		meshes[2].reset(resources->getAllocator().newInstance<MeshResource>(resources));
+
+		ModelPatch patch;
+		patch.setMeshes(meshes);
+		ANKI_TEST_EXPECT_EQ(patch.getMeshLodCount(), 3);
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(0).get(), meshes[2].get());
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(1).get(), meshes[2].get());
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(2).get(), meshes[2].get());
+
+		// A LOD past the last one gets the coarsest
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(MAX_LOD_COUNT).get(), meshes[2].get());
+
+		// LOD 1 is streamed in. LOD 0 falls back to it
+		meshes[1].reset(resources->getAllocator().newInstance<MeshResource>(resources));
+		patch.setMeshes(meshes);
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(0).get(), meshes[1].get());
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(1).get(), meshes[1].get());
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(2).get(), meshes[2].get());
+
+		// Everything is resident
+		meshes[0].reset(resources->getAllocator().newInstance<MeshResource>(resources));
+		patch.setMeshes(meshes);
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(0).get(), meshes[0].get());
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(1).get(), meshes[1].get());
+		ANKI_TEST_EXPECT_EQ(patch.getMesh(2).get(), meshes[2].get());
+	}
+
+	alloc.deleteInstance(resources);
+}
+
+} // end namespace anki
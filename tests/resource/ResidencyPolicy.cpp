@@ -0,0 +1,237 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/resource/ResidencyPolicy.h>
+#include <anki/resource/TextureStreamer.h>
+
+namespace anki
+{
+
+ANKI_TEST(Resource, ResidencyPolicy)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// 4 levels and the last 2 are the tail
+	const Array<PtrSize, 4> levelSizes = {{64, 16, 4, 1}};
+
+	// Loads that fit and loads that don't
+	{
+		ResidencyPolicy policy(alloc, 100, 8);
+		const U32 a = policy.registerResource(levelSizes, 2);
+		const U32 b = policy.registerResource(levelSizes, 2);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 10);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentFirstLevel(a), 2);
+
+		// Nothing is used
+		DynamicArrayAuto<ResidencyRequest> requests(alloc);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 0);
+
+		// A misses more levels so it goes first. Then B doesn't fit and nothing can be evicted
+		policy.requestLevel(b, 1);
+		policy.requestLevel(a, 3);
+		policy.requestLevel(a, 0);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 1);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, a);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 0);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 90);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 10);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentFirstLevel(a), 2);
+
+		policy.completeRequest(a, true);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentFirstLevel(a), 0);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 90);
+		ANKI_TEST_EXPECT_EQ(policy.getPendingRequestCount(), 0);
+
+		// A is not used any more so it's evicted to make room for B
+		requests.destroy();
+		policy.requestLevel(b, 1);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, a);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 2);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_handle, b);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_firstLevel, 1);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 26);
+
+		// A failed load leaves the old levels resident
+		policy.completeRequest(a, true);
+		policy.completeRequest(b, false);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentFirstLevel(a), 2);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentFirstLevel(b), 2);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 10);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 10);
+
+		policy.unregisterResource(a);
+		policy.unregisterResource(b);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 0);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 0);
+	}
+
+	// Least recently used first
+	{
+		ResidencyPolicy policy(alloc, 180, 8);
+		const U32 a = policy.registerResource(levelSizes, 2);
+		const U32 b = policy.registerResource(levelSizes, 2);
+		const U32 c = policy.registerResource(levelSizes, 2);
+
+		DynamicArrayAuto<ResidencyRequest> requests(alloc);
+		policy.requestLevel(a, 0);
+		policy.requestLevel(b, 0);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		policy.completeRequest(a, true);
+		policy.completeRequest(b, true);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 175);
+
+		// B is used after A
+		requests.destroy();
+		policy.requestLevel(b, 0);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 0);
+
+		// C wants level 1 so A is evicted
+		policy.requestLevel(c, 1);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, a);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 2);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_handle, c);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_firstLevel, 1);
+		policy.completeRequest(a, true);
+		policy.completeRequest(c, true);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 111);
+
+		// B needs less now and its levels make room for C
+		requests.destroy();
+		policy.setBudget(120);
+		policy.requestLevel(b, 1);
+		policy.requestLevel(c, 0);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, b);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 1);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_handle, c);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_firstLevel, 0);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 111);
+		policy.completeRequest(b, true);
+		policy.completeRequest(c, true);
+
+		// The budget shrinks and the unused resources drop to the tail
+		requests.destroy();
+		policy.setBudget(50);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, b);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 2);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_handle, c);
+		ANKI_TEST_EXPECT_EQ(requests[1].m_firstLevel, 2);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 15);
+		policy.completeRequest(b, true);
+		policy.completeRequest(c, true);
+
+		policy.unregisterResource(a);
+		policy.unregisterResource(b);
+		policy.unregisterResource(c);
+	}
+
+	// A smaller level when the biggest doesn't fit
+	{
+		ResidencyPolicy policy(alloc, 30, 8);
+		const U32 a = policy.registerResource(levelSizes, 2);
+		const U32 b = policy.registerResource(levelSizes, 2);
+
+		DynamicArrayAuto<ResidencyRequest> requests(alloc);
+		policy.requestLevel(a, 0);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 1);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 1);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 26);
+		policy.completeRequest(a, true);
+
+		policy.unregisterResource(a);
+		policy.unregisterResource(b);
+	}
+
+	// An eviction is completed in the same frame like the MeshStreamer does and the resident size drops right away
+	{
+		ResidencyPolicy policy(alloc, 100, 8);
+		const U32 a = policy.registerResource(levelSizes, 2);
+		const U32 b = policy.registerResource(levelSizes, 2);
+
+		DynamicArrayAuto<ResidencyRequest> requests(alloc);
+		policy.requestLevel(a, 0);
+		policy.update(requests);
+		policy.completeRequest(a, true);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 90);
+
+		requests.destroy();
+		policy.requestLevel(b, 1);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, a);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_firstLevel, 2);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 26);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 90);
+
+		// The load of B is still pending but the memory of A is free
+		policy.completeRequest(a, true);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentFirstLevel(a), 2);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 10);
+		ANKI_TEST_EXPECT_EQ(policy.getPendingRequestCount(), 1);
+		ANKI_TEST_EXPECT_EQ(policy.isRequestPending(b), true);
+
+		policy.completeRequest(b, true);
+		ANKI_TEST_EXPECT_EQ(policy.getResidentSize(), 26);
+		ANKI_TEST_EXPECT_EQ(policy.getCommittedSize(), 26);
+
+		policy.unregisterResource(a);
+		policy.unregisterResource(b);
+	}
+
+	// The number of pending requests is limited
+	{
+		ResidencyPolicy policy(alloc, 1000, 2);
+		Array<U32, 3> handles;
+		for(U32& handle : handles)
+		{
+			handle = policy.registerResource(levelSizes, 2);
+			policy.requestLevel(handle, 0);
+		}
+
+		DynamicArrayAuto<ResidencyRequest> requests(alloc);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(policy.isRequestPending(handles[2]), false);
+
+		policy.completeRequest(requests[0].m_handle, true);
+		policy.completeRequest(requests[1].m_handle, true);
+		requests.destroy();
+		policy.requestLevel(handles[2], 0);
+		policy.update(requests);
+		ANKI_TEST_EXPECT_EQ(requests.getSize(), 1);
+		ANKI_TEST_EXPECT_EQ(requests[0].m_handle, handles[2]);
+		policy.completeRequest(handles[2], true);
+
+		for(U32 handle : handles)
+		{
+			policy.unregisterResource(handle);
+		}
+	}
+
+	// The mip from the screen size
+	{
+		// 1024 texels over a surface of 1 UV unit per world unit that covers 1024 pixels
+		ANKI_TEST_EXPECT_EQ(TextureStreamer::computeMip(1024, 1.0f, 1024.0f), 0);
+		ANKI_TEST_EXPECT_EQ(TextureStreamer::computeMip(1024, 1.0f, 256.0f), 2);
+		ANKI_TEST_EXPECT_EQ(TextureStreamer::computeMip(1024, 1.0f, 4096.0f), 0);
+		ANKI_TEST_EXPECT_EQ(TextureStreamer::computeMip(1024, 4.0f, 1024.0f), 2);
+		ANKI_TEST_EXPECT_EQ(TextureStreamer::computeMip(1024, 1.0f, 300.0f), 1);
+	}
+}
+
+} // end namespace anki
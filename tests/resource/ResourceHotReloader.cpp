@@ -0,0 +1,83 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/resource/ResourceHotReloader.h>
+
+namespace anki
+{
+
+static Bool contains(const StringListAuto& list, CString fname)
+{
+	for(const String& s : list)
+	{
+		if(s == fname)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ANKI_TEST(Resource, ResourceDependencyGraph)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	ResourceDependencyGraph graph(alloc);
+
+	// A model with a mesh and a material, the material with a program and a texture. The texture is shared
+	graph.addDependency("model.ankimdl", "mesh.ankimesh");
+	graph.addDependency("model.ankimdl", "material.ankimtl");
+	graph.addDependency("material.ankimtl", "program.ankiprog");
+	graph.addDependency("material.ankimtl", "texture.ankitex");
+	graph.addDependency("material2.ankimtl", "texture.ankitex");
+	graph.addDependency("material.ankimtl", "texture.ankitex"); // Duplicate
+	graph.addDependency("model.ankimdl", "model.ankimdl"); // Self
+
+	// A leaf changes
+	{
+		StringListAuto changed(alloc);
+		changed.pushBack("program.ankiprog");
+		StringListAuto dependents(alloc);
+		graph.getDependents(changed, dependents);
+
+		ANKI_TEST_EXPECT_EQ(dependents.getSize(), 3);
+		ANKI_TEST_EXPECT_EQ(dependents.getFront(), "program.ankiprog");
+		ANKI_TEST_EXPECT_EQ(contains(dependents, "material.ankimtl"), true);
+		ANKI_TEST_EXPECT_EQ(contains(dependents, "model.ankimdl"), true);
+
+		// The resources that load a file come after it
+		ANKI_TEST_EXPECT_EQ(dependents.getBack(), "model.ankimdl");
+	}
+
+	// A shared file and a file that changes twice
+	{
+		StringListAuto changed(alloc);
+		changed.pushBack("texture.ankitex");
+		changed.pushBack("mesh.ankimesh");
+		changed.pushBack("texture.ankitex");
+		StringListAuto dependents(alloc);
+		graph.getDependents(changed, dependents);
+
+		ANKI_TEST_EXPECT_EQ(dependents.getSize(), 5);
+		ANKI_TEST_EXPECT_EQ(contains(dependents, "material.ankimtl"), true);
+		ANKI_TEST_EXPECT_EQ(contains(dependents, "material2.ankimtl"), true);
+		ANKI_TEST_EXPECT_EQ(contains(dependents, "model.ankimdl"), true);
+		ANKI_TEST_EXPECT_EQ(contains(dependents, "program.ankiprog"), false);
+	}
+
+	// A file that nothing depends on
+	{
+		StringListAuto changed(alloc);
+		changed.pushBack("unknown.txt");
+		StringListAuto dependents(alloc);
+		graph.getDependents(changed, dependents);
+
+		ANKI_TEST_EXPECT_EQ(dependents.getSize(), 1);
+		ANKI_TEST_EXPECT_EQ(dependents.getFront(), "unknown.txt");
+	}
+}
+
+} // end namespace anki
@@ -5,7 +5,10 @@
 
 #include <tests/framework/Framework.h>
 #include <anki/shader_compiler/ShaderProgramCompiler.h>
+#include <anki/shader_compiler/ShaderProgramSpirvCache.h>
+#include <anki/util/Filesystem.h>
 #include <anki/util/ThreadHive.h>
+#include <anki/util/HighRezTimer.h>
 
 ANKI_TEST(ShaderCompiler, ShaderProgramCompilerSimple)
 {
@@ -139,8 +142,8 @@ void main()
 	ShaderProgramBinaryWrapper binary(alloc);
 	BindlessLimits bindlessLimits;
 	GpuDeviceCapabilities gpuCapabilities;
-	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, &taskManager, alloc, gpuCapabilities,
-												 bindlessLimits, binary));
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, &taskManager, nullptr, nullptr,
+												 alloc, gpuCapabilities, bindlessLimits, binary));
 
 #if 1
 	StringAuto dis(alloc);
@@ -336,8 +339,8 @@ void main()
 	ShaderProgramBinaryWrapper binary(alloc);
 	BindlessLimits bindlessLimits;
 	GpuDeviceCapabilities gpuCapabilities;
-	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, &taskManager, alloc, gpuCapabilities,
-												 bindlessLimits, binary));
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, &taskManager, nullptr, nullptr,
+												 alloc, gpuCapabilities, bindlessLimits, binary));
 
 #if 1
 	StringAuto dis(alloc);
@@ -345,3 +348,611 @@ void main()
 	ANKI_LOGI("Binary disassembly:\n%s\n", dis.cstr());
 #endif
 }
+
+ANKI_TEST(ShaderCompiler, ShaderProgramCompilerSpirvCache)
+{
+	// Only the fragment shader depends on the mutator
+	const CString sourceCode = R"(
+#pragma anki mutator BRIGHT 0 1
+
+#pragma anki start vert
+out gl_PerVertex
+{
+	Vec4 gl_Position;
+};
+
+void main()
+{
+	gl_Position = Vec4(gl_VertexID);
+}
+#pragma anki end
+
+#pragma anki start frag
+layout(location = 0) out Vec3 out_color;
+
+void main()
+{
+	out_color = Vec3((BRIGHT == 1) ? 1.0 : 0.5) * %s;
+}
+#pragma anki end
+	)";
+
+	class Fsystem : public ShaderProgramFilesystemInterface
+	{
+	public:
+		Error readAllText(CString filename, StringAuto& txt) final
+		{
+			File file;
+			ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+			ANKI_CHECK(file.readAllText(txt));
+			return Error::NONE;
+		}
+	} fsystem;
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	const CString cacheDir = "spirv_cache";
+	if(directoryExists(cacheDir))
+	{
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(cacheDir, alloc));
+	}
+
+	// Write the program, compile it and return the hits and misses of the cache
+	auto compile = [&](CString scale, ShaderProgramBinaryWrapper& binary, U32& hits, U32& misses) -> Error {
+		{
+			File file;
+			ANKI_CHECK(file.open("test.glslp", FileOpenFlag::WRITE));
+			ANKI_CHECK(file.writeText(sourceCode.cstr(), scale.cstr()));
+		}
+
+		ShaderProgramSpirvFileCache cache(alloc);
+		ANKI_CHECK(cache.init(cacheDir));
+
+		BindlessLimits bindlessLimits;
+		GpuDeviceCapabilities gpuCapabilities;
+		ANKI_CHECK(compileShaderProgram("test.glslp", fsystem, nullptr, nullptr, &cache, nullptr, alloc,
+										gpuCapabilities, bindlessLimits, binary));
+
+		hits = cache.getHitCount();
+		misses = cache.getMissCount();
+		return Error::NONE;
+	};
+
+	U32 hits, misses;
+
+	// Cold cache. The 2 variants share the vertex shader
+	ShaderProgramBinaryWrapper binaryA(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compile("1.0", binaryA, hits, misses));
+	ANKI_TEST_EXPECT_EQ(hits, 1u);
+	ANKI_TEST_EXPECT_EQ(misses, 3u);
+
+	// Warm cache, nothing gets compiled and the result is the same
+	ShaderProgramBinaryWrapper binaryB(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compile("1.0", binaryB, hits, misses));
+	ANKI_TEST_EXPECT_EQ(hits, 4u);
+	ANKI_TEST_EXPECT_EQ(misses, 0u);
+
+	const ShaderProgramBinary& a = binaryA.getBinary();
+	const ShaderProgramBinary& b = binaryB.getBinary();
+	ANKI_TEST_EXPECT_EQ(a.m_codeBlocks.getSize(), b.m_codeBlocks.getSize());
+	for(U32 i = 0; i < a.m_codeBlocks.getSize(); ++i)
+	{
+		ANKI_TEST_EXPECT_EQ(a.m_codeBlocks[i].m_binary.getSize(), b.m_codeBlocks[i].m_binary.getSize());
+		ANKI_TEST_EXPECT_EQ(memcmp(&a.m_codeBlocks[i].m_binary[0], &b.m_codeBlocks[i].m_binary[0],
+								   a.m_codeBlocks[i].m_binary.getSize()),
+							0);
+	}
+
+	// Edit the fragment shader. Only that gets invalidated
+	ShaderProgramBinaryWrapper binaryC(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compile("2.0", binaryC, hits, misses));
+	ANKI_TEST_EXPECT_EQ(hits, 2u);
+	ANKI_TEST_EXPECT_EQ(misses, 2u);
+
+	// Corrupt a file of the cache. It's a miss and it gets compiled again
+	auto corruptFile = [](const CString& fname, void* userData, Bool isDir) -> Error {
+		if(!isDir)
+		{
+			HeapAllocator<U8>& alloc = *static_cast<HeapAllocator<U8>*>(userData);
+			StringAuto fullFname(alloc);
+			fullFname.sprintf("spirv_cache/%s", fname.cstr());
+
+			File file;
+			ANKI_CHECK(file.open(fullFname, FileOpenFlag::WRITE));
+			ANKI_CHECK(file.writeText("garbage"));
+		}
+		return Error::NONE;
+	};
+	ANKI_TEST_EXPECT_NO_ERR(walkDirectoryTree(cacheDir, &alloc, corruptFile));
+
+	ShaderProgramBinaryWrapper binaryD(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compile("2.0", binaryD, hits, misses));
+	ANKI_TEST_EXPECT_EQ(hits, 1u);
+	ANKI_TEST_EXPECT_EQ(misses, 3u);
+
+	// A cache that can't store doesn't fail the compilation
+	class ReadOnlyCache : public ShaderProgramSpirvCacheInterface
+	{
+	public:
+		U32 m_storeCount = 0;
+
+		Error load(U64 key, DynamicArrayAuto<U8>& spirv, Bool& found) final
+		{
+			found = false;
+			return Error::NONE;
+		}
+
+		Error store(U64 key, ConstWeakArray<U8> spirv) final
+		{
+			++m_storeCount;
+			return Error::FILE_ACCESS;
+		}
+	} readOnlyCache;
+
+	BindlessLimits bindlessLimits;
+	GpuDeviceCapabilities gpuCapabilities;
+	ShaderProgramBinaryWrapper binaryE(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, nullptr, &readOnlyCache, nullptr,
+												 alloc, gpuCapabilities, bindlessLimits, binaryE));
+	ANKI_TEST_EXPECT_EQ(readOnlyCache.m_storeCount, 4u);
+	ANKI_TEST_EXPECT_EQ(binaryE.getBinary().m_codeBlocks.getSize(), binaryD.getBinary().m_codeBlocks.getSize());
+}
+
+ANKI_TEST(ShaderCompiler, ShaderProgramCompilerSkipVariants)
+{
+	const CString sourceCode = R"(
+#pragma anki mutator A 0 1 2
+#pragma anki mutator B 0 1
+
+#pragma anki start comp
+layout(local_size_x = 1) in;
+
+layout(set = 0, binding = 0) buffer b_ss
+{
+	Vec4 u_out;
+};
+
+void main()
+{
+	u_out = Vec4(F32(A), F32(B), 0.0, 0.0);
+}
+#pragma anki end
+	)";
+
+	// Write the file
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("test.glslp", FileOpenFlag::WRITE));
+		ANKI_TEST_EXPECT_NO_ERR(file.writeText(sourceCode));
+	}
+
+	class Fsystem : public ShaderProgramFilesystemInterface
+	{
+	public:
+		Error readAllText(CString filename, StringAuto& txt) final
+		{
+			File file;
+			ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+			ANKI_CHECK(file.readAllText(txt));
+			return Error::NONE;
+		}
+	} fsystem;
+
+	// Keep the variants with A=2
+	class Filter : public ShaderProgramPostParseInterface
+	{
+	public:
+		Bool m_skipAll = false;
+
+		Bool skipCompilation(U64 hash) final
+		{
+			return false;
+		}
+
+		Bool skipVariant(ConstWeakArray<MutatorValue> mutation) final
+		{
+			return m_skipAll || mutation[0] != 2;
+		}
+	} filter;
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	BindlessLimits bindlessLimits;
+	GpuDeviceCapabilities gpuCapabilities;
+
+	ShaderProgramBinaryWrapper binary(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, &filter, nullptr, nullptr, nullptr, alloc,
+												 gpuCapabilities, bindlessLimits, binary));
+
+	// All the mutations are there, only 2 point to variants
+	ANKI_TEST_EXPECT_EQ(binary.getBinary().m_mutations.getSize(), 6u);
+	ANKI_TEST_EXPECT_EQ(binary.getBinary().m_variants.getSize(), 2u);
+	U32 compiledMutationCount = 0;
+	for(const ShaderProgramBinaryMutation& mutation : binary.getBinary().m_mutations)
+	{
+		if(mutation.m_variantIndex != MAX_U32)
+		{
+			ANKI_TEST_EXPECT_EQ(mutation.m_values[0], 2);
+			++compiledMutationCount;
+		}
+	}
+	ANKI_TEST_EXPECT_EQ(compiledMutationCount, 2u);
+
+	// Skip everything, the first mutation is compiled anyway
+	filter.m_skipAll = true;
+	ShaderProgramBinaryWrapper binary2(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, &filter, nullptr, nullptr, nullptr, alloc,
+												 gpuCapabilities, bindlessLimits, binary2));
+	ANKI_TEST_EXPECT_EQ(binary2.getBinary().m_variants.getSize(), 1u);
+	for(const ShaderProgramBinaryMutation& mutation : binary2.getBinary().m_mutations)
+	{
+		const Bool first = mutation.m_values[0] == 0 && mutation.m_values[1] == 0;
+		ANKI_TEST_EXPECT_EQ(mutation.m_variantIndex, (first) ? 0u : MAX_U32);
+	}
+}
+
+ANKI_TEST(ShaderCompiler, ShaderProgramCompilerBenchmark4096Variants)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// 12 mutators make 4096 variants. Only the first 6 change the code so most of the SPIR-V is deduplicated
+	constexpr U32 MUTATOR_COUNT = 12;
+	constexpr U32 CODE_MUTATOR_COUNT = 6;
+	{
+		StringListAuto lines(alloc);
+		for(U32 i = 0; i < MUTATOR_COUNT; ++i)
+		{
+			lines.pushBackSprintf("#pragma anki mutator M%u 0 1", i);
+		}
+
+		lines.pushBack("#pragma anki start comp");
+		lines.pushBack("layout(local_size_x = 1) in;");
+		lines.pushBack("layout(set = 0, binding = 0) buffer b_ss { F32 u_out; };");
+		lines.pushBack("void main() {");
+		lines.pushBack("F32 v = 0.0;");
+		for(U32 i = 0; i < CODE_MUTATOR_COUNT; ++i)
+		{
+			lines.pushBackSprintf("v += F32(M%u) * %u.0;", i, i + 1);
+		}
+		lines.pushBack("u_out = v;");
+		lines.pushBack("}");
+		lines.pushBack("#pragma anki end");
+
+		StringAuto src(alloc);
+		lines.join("\n", src);
+
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("test.glslp", FileOpenFlag::WRITE));
+		ANKI_TEST_EXPECT_NO_ERR(file.writeText("%s\n", src.cstr()));
+	}
+
+	class Fsystem : public ShaderProgramFilesystemInterface
+	{
+	public:
+		Error readAllText(CString filename, StringAuto& txt) final
+		{
+			File file;
+			ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+			ANKI_CHECK(file.readAllText(txt));
+			return Error::NONE;
+		}
+	} fsystem;
+
+	ThreadHive hive(getCpuCoresCount(), alloc);
+
+	class TaskManager : public ShaderProgramAsyncTaskInterface
+	{
+	public:
+		ThreadHive* m_hive = nullptr;
+		HeapAllocator<U8> m_alloc;
+
+		void enqueueTask(void (*callback)(void* userData), void* userData) final
+		{
+			class Ctx
+			{
+			public:
+				void (*m_callback)(void* userData);
+				void* m_userData;
+				HeapAllocator<U8> m_alloc;
+			};
+
+			Ctx* ctx = m_alloc.newInstance<Ctx>();
+			ctx->m_callback = callback;
+			ctx->m_userData = userData;
+			ctx->m_alloc = m_alloc;
+
+			m_hive->submitTask(
+				[](void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore) {
+					Ctx* ctx = static_cast<Ctx*>(userData);
+					ctx->m_callback(ctx->m_userData);
+					HeapAllocator<U8> alloc = ctx->m_alloc;
+					alloc.deleteInstance(ctx);
+				},
+				ctx);
+		}
+
+		Error joinTasks() final
+		{
+			m_hive->waitAllTasks();
+			return Error::NONE;
+		}
+	} taskManager;
+	taskManager.m_hive = &hive;
+	taskManager.m_alloc = alloc;
+
+	// Compile
+	HighRezTimer timer;
+	timer.start();
+	ShaderProgramBinaryWrapper binary(alloc);
+	BindlessLimits bindlessLimits;
+	GpuDeviceCapabilities gpuCapabilities;
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, &taskManager, nullptr, nullptr,
+												 alloc, gpuCapabilities, bindlessLimits, binary));
+	timer.stop();
+	const Second compileTime = timer.getElapsedTime();
+
+	const ShaderProgramBinary& bin = binary.getBinary();
+	ANKI_TEST_EXPECT_EQ(bin.m_mutations.getSize(), 1u << MUTATOR_COUNT);
+	ANKI_TEST_EXPECT_EQ(bin.m_variants.getSize(), 1u << MUTATOR_COUNT);
+	ANKI_TEST_EXPECT_EQ(bin.m_codeBlocks.getSize(), 1u << CODE_MUTATOR_COUNT);
+
+	// Find all the mutations the way the ShaderProgramResource does
+	class Compare
+	{
+	public:
+		Bool operator()(const ShaderProgramBinaryMutation& a, U64 b) const
+		{
+			return a.m_hash < b;
+		}
+
+		Bool operator()(U64 a, const ShaderProgramBinaryMutation& b) const
+		{
+			return a < b.m_hash;
+		}
+	};
+
+	DynamicArrayAuto<MutatorValue> mutation(alloc, MUTATOR_COUNT);
+	timer.start();
+	U32 foundCount = 0;
+	for(U32 i = 0; i < bin.m_mutations.getSize(); ++i)
+	{
+		for(U32 m = 0; m < MUTATOR_COUNT; ++m)
+		{
+			mutation[m] = (i >> m) & 1;
+		}
+
+		const U64 hash = computeHash(mutation.getBegin(), mutation.getSizeInBytes());
+		const ShaderProgramBinaryMutation* it =
+			binarySearch(bin.m_mutations.getBegin(), bin.m_mutations.getEnd(), hash, Compare());
+		foundCount += it != bin.m_mutations.getEnd();
+	}
+	timer.stop();
+	const Second lookupTime = timer.getElapsedTime();
+	ANKI_TEST_EXPECT_EQ(foundCount, bin.m_mutations.getSize());
+
+	ANKI_TEST_LOGI("4096 variants bench: compile %fs, find all mutations %fms", compileTime, lookupTime * 1000.0);
+}
+
+ANKI_TEST(ShaderCompiler, ShaderProgramCompilerPostCompile)
+{
+	const CString sourceCode = R"(
+#pragma anki mutator A 0 1
+
+#pragma anki start comp
+layout(local_size_x = 1) in;
+
+layout(set = 0, binding = 0) buffer b_ss
+{
+	Vec4 u_out;
+};
+
+void main()
+{
+	const Vec4 someLongVariableName = Vec4(F32(A), 1.0, 2.0, 3.0);
+	u_out = someLongVariableName;
+}
+#pragma anki end
+	)";
+
+	// Write the file
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("test.glslp", FileOpenFlag::WRITE));
+		ANKI_TEST_EXPECT_NO_ERR(file.writeText(sourceCode));
+	}
+
+	class Fsystem : public ShaderProgramFilesystemInterface
+	{
+	public:
+		Error readAllText(CString filename, StringAuto& txt) final
+		{
+			File file;
+			ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+			ANKI_CHECK(file.readAllText(txt));
+			return Error::NONE;
+		}
+	} fsystem;
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	BindlessLimits bindlessLimits;
+	GpuDeviceCapabilities gpuCapabilities;
+
+	ShaderProgramBinaryWrapper stripped(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, nullptr, nullptr, nullptr, alloc,
+												 gpuCapabilities, bindlessLimits, stripped));
+	ShaderProgramBinaryWrapper compressed(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("test.glslp", fsystem, nullptr, nullptr, nullptr, nullptr, alloc,
+												 gpuCapabilities, bindlessLimits, compressed));
+
+	PtrSize originalSize = 0;
+	for(const ShaderProgramBinaryCodeBlock& block : stripped.getBinary().m_codeBlocks)
+	{
+		originalSize += block.m_binary.getSize();
+	}
+
+	ANKI_TEST_EXPECT_NO_ERR(stripped.postCompile(ShaderProgramPostCompileFlag::STRIP_DEBUG_INFO));
+	ANKI_TEST_EXPECT_NO_ERR(compressed.postCompile(ShaderProgramPostCompileFlag::STRIP_DEBUG_INFO
+												   | ShaderProgramPostCompileFlag::COMPRESS_CODE_BLOCKS));
+
+	// Store and load the compressed one to be sure the blocks survive the serialization
+	ANKI_TEST_EXPECT_NO_ERR(compressed.serializeToFile("test.ankiprogbin"));
+	ANKI_TEST_EXPECT_NO_ERR(compressed.deserializeFromFile("test.ankiprogbin"));
+
+	const ShaderProgramBinary& a = stripped.getBinary();
+	const ShaderProgramBinary& b = compressed.getBinary();
+	ANKI_TEST_EXPECT_EQ(a.m_codeBlocks.getSize(), b.m_codeBlocks.getSize());
+
+	PtrSize strippedSize = 0;
+	PtrSize compressedSize = 0;
+	for(U32 i = 0; i < a.m_codeBlocks.getSize(); ++i)
+	{
+		ANKI_TEST_EXPECT_EQ(a.m_codeBlocks[i].m_uncompressedSize, 0u);
+		ANKI_TEST_EXPECT_EQ(a.m_codeBlocks[i].m_hash, b.m_codeBlocks[i].m_hash);
+		strippedSize += a.m_codeBlocks[i].m_binary.getSize();
+		compressedSize += b.m_codeBlocks[i].m_binary.getSize();
+
+		// No OpName should be left
+		const U32* words = reinterpret_cast<const U32*>(a.m_codeBlocks[i].m_binary.getBegin());
+		const U32 wordCount = a.m_codeBlocks[i].m_binary.getSize() / sizeof(U32);
+		for(U32 w = 5; w < wordCount; w += words[w] >> 16u)
+		{
+			ANKI_TEST_EXPECT_NEQ(words[w] & 0xFFFFu, 5u);
+		}
+
+		// Decompressing gives back the stripped SPIR-V
+		DynamicArrayAuto<U8> storage(alloc);
+		ConstWeakArray<U8> spirv;
+		ANKI_TEST_EXPECT_NO_ERR(getCodeBlockSpirv(b.m_codeBlocks[i], storage, spirv));
+		ANKI_TEST_EXPECT_EQ(spirv.getSize(), a.m_codeBlocks[i].m_binary.getSize());
+		ANKI_TEST_EXPECT_EQ(memcmp(spirv.getBegin(), a.m_codeBlocks[i].m_binary.getBegin(), spirv.getSize()), 0);
+	}
+
+	ANKI_TEST_EXPECT_LT(strippedSize, originalSize);
+	ANKI_TEST_EXPECT_LT(compressedSize, strippedSize);
+	ANKI_TEST_LOGI("SPIR-V size: original %zu, stripped %zu, compressed %zu", originalSize, strippedSize,
+				   compressedSize);
+}
+
+ANKI_TEST(ShaderCompiler, ShaderProgramCompilerRecompileLatency)
+{
+	// The include is used only by the fragment shader
+	const CString programSource = R"(
+#pragma anki mutator QUALITY 0 1 2 3
+
+#pragma anki start vert
+out gl_PerVertex
+{
+	Vec4 gl_Position;
+};
+
+void main()
+{
+	gl_Position = Vec4(gl_VertexID);
+}
+#pragma anki end
+
+#pragma anki start frag
+#include "latency.glsl"
+
+layout(location = 0) out Vec3 out_color;
+
+void main()
+{
+	out_color = shade(Vec3(F32(QUALITY)));
+}
+#pragma anki end
+	)";
+
+	const CString includeSource = R"(
+const F32 SCALE = %s;
+
+Vec3 shade(Vec3 c)
+{
+	Vec3 o = c;
+	for(U32 i = 0u; i < 8u; ++i)
+	{
+		o = sin(o * SCALE) + cos(o.yzx) * 0.5;
+	}
+	return o;
+}
+	)";
+
+	class Fsystem : public ShaderProgramFilesystemInterface
+	{
+	public:
+		Error readAllText(CString filename, StringAuto& txt) final
+		{
+			File file;
+			ANKI_CHECK(file.open(filename, FileOpenFlag::READ));
+			ANKI_CHECK(file.readAllText(txt));
+			return Error::NONE;
+		}
+	} fsystem;
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	auto writeFile = [](CString fname, CString fmt, CString arg) -> Error {
+		File file;
+		ANKI_CHECK(file.open(fname, FileOpenFlag::WRITE));
+		ANKI_CHECK(file.writeText(fmt.cstr(), arg.cstr()));
+		return Error::NONE;
+	};
+
+	const CString cacheDir = "spirv_cache_latency";
+	if(directoryExists(cacheDir))
+	{
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(cacheDir, alloc));
+	}
+
+	ANKI_TEST_EXPECT_NO_ERR(writeFile("latency.glslp", programSource, ""));
+	ANKI_TEST_EXPECT_NO_ERR(writeFile("latency.glsl", includeSource, "1.0"));
+
+	// The caches that a long-lived compiler keeps around
+	ShaderProgramIncludeCache includeCache(alloc);
+
+	auto compile = [&](Bool useCaches, Second& time, U32& hits, U32& misses) -> Error {
+		ShaderProgramSpirvFileCache spirvCache(alloc);
+		ANKI_CHECK(spirvCache.init(cacheDir));
+
+		BindlessLimits bindlessLimits;
+		GpuDeviceCapabilities gpuCapabilities;
+		ShaderProgramBinaryWrapper binary(alloc);
+
+		HighRezTimer timer;
+		timer.start();
+		ANKI_CHECK(compileShaderProgram("latency.glslp", fsystem, nullptr, nullptr,
+										(useCaches) ? &spirvCache : nullptr, (useCaches) ? &includeCache : nullptr,
+										alloc, gpuCapabilities, bindlessLimits, binary));
+		timer.stop();
+
+		time = timer.getElapsedTime();
+		hits = spirvCache.getHitCount();
+		misses = spirvCache.getMissCount();
+		return Error::NONE;
+	};
+
+	Second coldTime, warmTime, time;
+	U32 hits, misses;
+
+	// What a one-shot compiler pays for every change
+	ANKI_TEST_EXPECT_NO_ERR(compile(false, coldTime, hits, misses));
+
+	// Warm the caches
+	ANKI_TEST_EXPECT_NO_ERR(compile(true, time, hits, misses));
+	ANKI_TEST_EXPECT_EQ(hits, 3u);
+	ANKI_TEST_EXPECT_EQ(misses, 5u);
+
+	// Edit one line of the include. Only the program that includes it and only its fragment shaders are affected
+	ANKI_TEST_EXPECT_NO_ERR(writeFile("latency.glsl", includeSource, "2.0"));
+
+	StringListAuto programs(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(includeCache.refresh(fsystem, programs));
+	ANKI_TEST_EXPECT_EQ(programs.getSize(), 1u);
+	ANKI_TEST_EXPECT_EQ(programs.getFront(), "latency.glslp");
+
+	ANKI_TEST_EXPECT_NO_ERR(compile(true, warmTime, hits, misses));
+	ANKI_TEST_EXPECT_EQ(hits, 4u);
+	ANKI_TEST_EXPECT_EQ(misses, 4u);
+
+	ANKI_TEST_LOGI("Recompile after a one-line include edit: cold %fms, warm caches %fms", coldTime * 1000.0,
+				   warmTime * 1000.0);
+}
@@ -5,6 +5,51 @@
 
 #include <tests/framework/Framework.h>
 #include <anki/shader_compiler/ShaderProgramParser.h>
+#include <anki/util/HighRezTimer.h>
+
+namespace anki
+{
+
+/// Keeps the files in memory so the tests can edit them.
+class ShaderProgramParserTestFilesystem : public ShaderProgramFilesystemInterface
+{
+public:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	HashMapAuto<U64, StringAuto> m_files;
+	U32 m_readCount = 0;
+
+	ShaderProgramParserTestFilesystem(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+		, m_files(alloc)
+	{
+	}
+
+	void setFile(CString fname, CString text)
+	{
+		auto it = m_files.find(fname.computeHash());
+		if(it == m_files.getEnd())
+		{
+			it = m_files.emplace(fname.computeHash(), m_alloc);
+		}
+
+		*it = text;
+	}
+
+	Error readAllText(CString filename, StringAuto& txt) final
+	{
+		auto it = m_files.find(filename.computeHash());
+		if(it == m_files.getEnd())
+		{
+			return Error::FUNCTION_FAILED;
+		}
+
+		++m_readCount;
+		txt = *it;
+		return Error::NONE;
+	}
+};
+
+} // end namespace anki
 
 ANKI_TEST(ShaderCompiler, ShaderCompilerParser)
 {
@@ -63,3 +108,168 @@ ANKI_TEST(ShaderCompiler, ShaderCompilerParser)
 
 	// printf("%s\n", variant.getSource(ShaderType::VERTEX).cstr());
 }
+
+ANKI_TEST(ShaderCompiler, ShaderCompilerParserIncludeCache)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	BindlessLimits bindlessLimits;
+	GpuDeviceCapabilities gpuCapabilities;
+
+	ShaderProgramParserTestFilesystem fsystem(alloc);
+	fsystem.setFile("Common.glsl", "#pragma once\nconst F32 PI = 3.14;\n");
+	fsystem.setFile("Light.glsl", "#pragma once\n#include \"Common.glsl\"\nconst F32 LIGHT = PI;\n");
+	fsystem.setFile("Prog0.ankiprog", R"(
+#include "Common.glsl"
+#pragma anki mutator M0 0 1
+#pragma anki start comp
+layout(local_size_x = 1) in;
+void main() {}
+#pragma anki end
+)");
+	fsystem.setFile("Prog1.ankiprog", R"(
+#include "Light.glsl"
+#include "Common.glsl"
+#pragma anki start comp
+layout(local_size_x = 1) in;
+void main() {}
+#pragma anki end
+)");
+
+	// The cached and the uncached parsers should see the same source
+	ShaderProgramIncludeCache cache(alloc);
+	for(CString fname : {CString("Prog0.ankiprog"), CString("Prog1.ankiprog")})
+	{
+		ShaderProgramParser parser(fname, &fsystem, alloc, gpuCapabilities, bindlessLimits);
+		ANKI_TEST_EXPECT_NO_ERR(parser.parse());
+
+		ShaderProgramParser cachedParser(fname, &fsystem, alloc, gpuCapabilities, bindlessLimits, &cache);
+		ANKI_TEST_EXPECT_NO_ERR(cachedParser.parse());
+
+		ANKI_TEST_EXPECT_EQ(parser.getHash(), cachedParser.getHash());
+		ANKI_TEST_EXPECT_EQ(parser.getMutators().getSize(), cachedParser.getMutators().getSize());
+	}
+
+	// Common.glsl is read once, the second #include of Prog1 hits the cache as well
+	ANKI_TEST_EXPECT_EQ(cache.getMissCount(), 4u);
+	ANKI_TEST_EXPECT_EQ(cache.getHitCount(), 2u);
+
+	// Both programs depend on Common.glsl, only one on Light.glsl
+	{
+		StringListAuto programs(alloc);
+		cache.getDependentPrograms("Common.glsl", programs);
+		ANKI_TEST_EXPECT_EQ(programs.getSize(), 2u);
+
+		StringListAuto programs2(alloc);
+		cache.getDependentPrograms("Light.glsl", programs2);
+		ANKI_TEST_EXPECT_EQ(programs2.getSize(), 1u);
+		ANKI_TEST_EXPECT_EQ(programs2.getFront(), "Prog1.ankiprog");
+
+		StringListAuto fnames(alloc);
+		cache.getFilenames(fnames);
+		ANKI_TEST_EXPECT_EQ(fnames.getSize(), 4u);
+	}
+
+	// Nothing changed
+	{
+		StringListAuto programs(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(cache.refresh(fsystem, programs));
+		ANKI_TEST_EXPECT_EQ(programs.getSize(), 0u);
+	}
+
+	// Edit a header
+	fsystem.setFile("Light.glsl", "#pragma once\n#include \"Common.glsl\"\nconst F32 LIGHT = PI * 2.0;\n");
+	{
+		StringListAuto programs(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(cache.refresh(fsystem, programs));
+		ANKI_TEST_EXPECT_EQ(programs.getSize(), 1u);
+		ANKI_TEST_EXPECT_EQ(programs.getFront(), "Prog1.ankiprog");
+	}
+
+	// The edited header is read again
+	const U32 missCount = cache.getMissCount();
+	ShaderProgramParser parser("Prog1.ankiprog", &fsystem, alloc, gpuCapabilities, bindlessLimits, &cache);
+	ANKI_TEST_EXPECT_NO_ERR(parser.parse());
+	ANKI_TEST_EXPECT_EQ(cache.getMissCount(), missCount + 1);
+}
+
+ANKI_TEST(ShaderCompiler, ShaderCompilerParserBenchmark)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	BindlessLimits bindlessLimits;
+	GpuDeviceCapabilities gpuCapabilities;
+
+	// A few big headers that all programs include, like the real shaders do
+	constexpr U32 HEADER_COUNT = 8;
+	constexpr U32 HEADER_LINE_COUNT = 500;
+	constexpr U32 PROGRAM_COUNT = 64;
+
+	ShaderProgramParserTestFilesystem fsystem(alloc);
+	U32 lineCount = 0;
+	for(U32 h = 0; h < HEADER_COUNT; ++h)
+	{
+		StringListAuto lines(alloc);
+		lines.pushBack("#pragma once");
+		for(U32 l = 0; l < HEADER_LINE_COUNT; ++l)
+		{
+			lines.pushBackSprintf("F32 header%uFunc%u(F32 x) { return x * %u.0; } // Some comment", h, l, l);
+		}
+
+		StringAuto txt(alloc);
+		lines.join("\n", txt);
+		StringAuto fname(alloc);
+		fname.sprintf("Header%u.glsl", h);
+		fsystem.setFile(fname, txt);
+		lineCount += U32(lines.getSize());
+	}
+
+	for(U32 p = 0; p < PROGRAM_COUNT; ++p)
+	{
+		StringListAuto lines(alloc);
+		for(U32 h = 0; h < HEADER_COUNT; ++h)
+		{
+			lines.pushBackSprintf("#include \"Header%u.glsl\"", h);
+		}
+
+		lines.pushBack("#pragma anki mutator M0 0 1");
+		lines.pushBack("#pragma anki start comp");
+		lines.pushBack("layout(local_size_x = 1) in;");
+		lines.pushBackSprintf("void main() { F32 x = F32(M0) + %u.0; }", p);
+		lines.pushBack("#pragma anki end");
+
+		StringAuto txt(alloc);
+		lines.join("\n", txt);
+		StringAuto fname(alloc);
+		fname.sprintf("Prog%u.ankiprog", p);
+		fsystem.setFile(fname, txt);
+	}
+
+	// Parse all programs without and with the cache
+	ShaderProgramIncludeCache cache(alloc);
+	Array<Second, 2> times;
+	Array<U64, 2> hashSums = {};
+	for(U32 useCache = 0; useCache < 2; ++useCache)
+	{
+		HighRezTimer timer;
+		timer.start();
+		for(U32 p = 0; p < PROGRAM_COUNT; ++p)
+		{
+			StringAuto fname(alloc);
+			fname.sprintf("Prog%u.ankiprog", p);
+
+			ShaderProgramParser parser(fname, &fsystem, alloc, gpuCapabilities, bindlessLimits,
+									   (useCache) ? &cache : nullptr);
+			ANKI_TEST_EXPECT_NO_ERR(parser.parse());
+			hashSums[useCache] += parser.getHash();
+		}
+		timer.stop();
+		times[useCache] = timer.getElapsedTime();
+	}
+
+	ANKI_TEST_EXPECT_EQ(hashSums[0], hashSums[1]);
+	ANKI_TEST_EXPECT_EQ(cache.getMissCount(), HEADER_COUNT + PROGRAM_COUNT);
+
+	const F64 totalLines = F64(lineCount) * PROGRAM_COUNT;
+	ANKI_TEST_LOGI("Parser bench: %u programs, no cache %fms (%.1f Mlines/s), cache %fms (%.1f Mlines/s)",
+				   PROGRAM_COUNT, times[0] * 1000.0, totalLines / times[0] / 1000000.0, times[1] * 1000.0,
+				   totalLines / times[1] / 1000000.0);
+}
@@ -5,6 +5,7 @@
 
 #include <tests/framework/Framework.h>
 #include <anki/util/DynamicArray.h>
+#include <anki/util/WeakArray.h>
 #include <vector>
 #include <ctime>
 
@@ -70,6 +71,18 @@ public:
 	}
 };
 
+static U32 g_inlineAllocationCount = 0;
+
+static void* countingAllocAligned(void* userData, void* ptr, PtrSize size, PtrSize alignment)
+{
+	if(ptr == nullptr)
+	{
+		++g_inlineAllocationCount;
+	}
+
+	return allocAligned(userData, ptr, size, alignment);
+}
+
 } // end namespace anki
 
 ANKI_TEST(Util, DynamicArray)
@@ -255,3 +268,76 @@ ANKI_TEST(Util, DynamicArrayEmplaceAt)
 							destructorCount);
 	}
 }
+
+ANKI_TEST(Util, DynamicArrayInline)
+{
+	HeapAllocator<U8> alloc(countingAllocAligned, nullptr);
+	g_inlineAllocationCount = 0;
+
+	// Fits in the inline storage
+	{
+		constructor0Count = constructor1Count = constructor2Count = constructor3Count = destructorCount = 0;
+
+		DynamicArrayInline<DynamicArrayFoo, 4> arr(alloc);
+		for(int i = 0; i < 4; ++i)
+		{
+			arr.emplaceBack(i);
+		}
+
+		ANKI_TEST_EXPECT_EQ(arr.getSize(), 4);
+		ANKI_TEST_EXPECT_EQ(arr.isInline(), true);
+		ANKI_TEST_EXPECT_EQ(g_inlineAllocationCount, 0);
+
+		WeakArray<DynamicArrayFoo> weak(arr);
+		ANKI_TEST_EXPECT_EQ(weak.getSize(), 4);
+		ANKI_TEST_EXPECT_EQ(weak[3].m_x, 3);
+
+		arr.popBack();
+		ANKI_TEST_EXPECT_EQ(arr.getBack().m_x, 2);
+
+		// Move an inline array
+		DynamicArrayInline<DynamicArrayFoo, 4> arr2(std::move(arr));
+		ANKI_TEST_EXPECT_EQ(arr.getSize(), 0);
+		ANKI_TEST_EXPECT_EQ(arr2.getSize(), 3);
+		ANKI_TEST_EXPECT_EQ(arr2[2].m_x, 2);
+		ANKI_TEST_EXPECT_EQ(g_inlineAllocationCount, 0);
+	}
+	ANKI_TEST_EXPECT_EQ(constructor0Count + constructor1Count + constructor2Count + constructor3Count, destructorCount);
+
+	// Spill to the allocator
+	{
+		constructor0Count = constructor1Count = constructor2Count = constructor3Count = destructorCount = 0;
+
+		DynamicArrayInline<DynamicArrayFoo, 4> arr(alloc);
+		std::vector<DynamicArrayFoo> vec;
+		for(int i = 0; i < 100; ++i)
+		{
+			arr.emplaceBack(i);
+			vec.emplace_back(i);
+		}
+
+		ANKI_TEST_EXPECT_EQ(arr.isInline(), false);
+		ANKI_TEST_EXPECT_GT(g_inlineAllocationCount, 0);
+
+		// Move steals the memory
+		const U32 allocationCount = g_inlineAllocationCount;
+		DynamicArrayInline<DynamicArrayFoo, 4> arr2(alloc);
+		arr2 = std::move(arr);
+		ANKI_TEST_EXPECT_EQ(g_inlineAllocationCount, allocationCount);
+
+		ConstWeakArray<DynamicArrayFoo> weak(arr2);
+		ANKI_TEST_EXPECT_EQ(weak.getSize(), vec.size());
+		for(U32 i = 0; i < weak.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(weak[i].m_x, vec[i].m_x);
+		}
+
+		arr2.resize(2);
+		ANKI_TEST_EXPECT_EQ(arr2.getSize(), 2);
+		arr2.destroy();
+		ANKI_TEST_EXPECT_EQ(arr2.isInline(), true);
+
+		vec.resize(0);
+	}
+	ANKI_TEST_EXPECT_EQ(constructor0Count + constructor1Count + constructor2Count + constructor3Count, destructorCount);
+}
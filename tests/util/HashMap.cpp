@@ -6,6 +6,7 @@
 #include "tests/framework/Framework.h"
 #include "tests/util/Foo.h"
 #include "anki/util/HashMap.h"
+#include "anki/util/FlatHashMap.h"
 #include "anki/util/DynamicArray.h"
 #include "anki/util/HighRezTimer.h"
 #include <unordered_map>
@@ -254,3 +255,288 @@ ANKI_TEST(Util, HashMap)
 		akMap.destroy(alloc);
 	}
 }
+
+ANKI_TEST(Util, FlatHashMap)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	int vals[] = {20, 15, 5, 1, 10, 0, 18, 6, 7, 11, 13, 3};
+	const U32 valsSize = sizeof(vals) / sizeof(vals[0]);
+
+	// Add, iterate and find
+	{
+		FlatHashMap<int, int, Hasher> map;
+
+		for(U32 i = 0; i < valsSize; ++i)
+		{
+			map.emplace(alloc, vals[i], vals[i] * 10);
+		}
+		ANKI_TEST_EXPECT_EQ(map.getSize(), valsSize);
+
+		U32 count = 0;
+		for(auto it = map.getBegin(); it != map.getEnd(); ++it)
+		{
+			ANKI_TEST_EXPECT_EQ(*it, it.getKey() * 10);
+			++count;
+		}
+		ANKI_TEST_EXPECT_EQ(count, valsSize);
+
+		for(U32 i = 0; i < valsSize; ++i)
+		{
+			auto it = map.find(vals[i]);
+			ANKI_TEST_EXPECT_NEQ(it, map.getEnd());
+			ANKI_TEST_EXPECT_EQ(*it, vals[i] * 10);
+		}
+		ANKI_TEST_EXPECT_EQ(map.find(1000), map.getEnd());
+
+		map.destroy(alloc);
+	}
+
+	// Fuzzy test against the STL with many collisions and erases
+	{
+		FlatHashMapAuto<int, int, Hasher> akMap(alloc);
+		std::unordered_map<int, int> stdMap;
+
+		for(U32 i = 0; i < 100000; ++i)
+		{
+			const int key = rand() % 4096;
+			auto akIt = akMap.find(key);
+			auto stdIt = stdMap.find(key);
+			ANKI_TEST_EXPECT_EQ(akIt == akMap.getEnd(), stdIt == stdMap.end());
+
+			if(stdIt == stdMap.end())
+			{
+				akMap.emplace(key, key + 1);
+				stdMap[key] = key + 1;
+			}
+			else
+			{
+				ANKI_TEST_EXPECT_EQ(*akIt, stdIt->second);
+				akMap.erase(akIt);
+				stdMap.erase(stdIt);
+			}
+		}
+
+		ANKI_TEST_EXPECT_EQ(akMap.getSize(), stdMap.size());
+		for(auto it : stdMap)
+		{
+			auto akIt = akMap.find(it.first);
+			ANKI_TEST_EXPECT_NEQ(akIt, akMap.getEnd());
+			ANKI_TEST_EXPECT_EQ(*akIt, it.second);
+		}
+
+		// Erases don't leave tombstones behind so the capacity doesn't grow
+		const U32 capacity = akMap.getCapacity();
+		for(U32 i = 0; i < 100000; ++i)
+		{
+			const int key = 10000 + (rand() % 64);
+			auto it = akMap.find(key);
+			if(it == akMap.getEnd())
+			{
+				akMap.emplace(key, 0);
+			}
+			else
+			{
+				akMap.erase(it);
+			}
+		}
+		ANKI_TEST_EXPECT_LEQ(akMap.getCapacity(), capacity * 2);
+	}
+
+	// Fixed variant in a frame arena
+	{
+		StackAllocator<U8> stackAlloc(allocAligned, nullptr, 16 * 1024);
+		const U32 maxCount = 100;
+		void* mem = stackAlloc.allocate(FlatHashMapFixed<int, Foo, Hasher>::computeMemorySize(maxCount), 16u);
+
+		{
+			FlatHashMapFixed<int, Foo, Hasher> map(mem, maxCount);
+			for(int i = 0; i < int(maxCount); ++i)
+			{
+				ANKI_TEST_EXPECT_NEQ(map.emplace(i, i), map.getEnd());
+			}
+
+			for(int i = 0; i < int(maxCount); i += 2)
+			{
+				map.erase(map.find(i));
+			}
+
+			ANKI_TEST_EXPECT_EQ(map.getSize(), maxCount / 2);
+			for(int i = 0; i < int(maxCount); ++i)
+			{
+				auto it = map.find(i);
+				ANKI_TEST_EXPECT_EQ(it == map.getEnd(), (i % 2) == 0);
+				if(it != map.getEnd())
+				{
+					ANKI_TEST_EXPECT_EQ(it->x, i);
+				}
+			}
+		}
+
+		ANKI_TEST_EXPECT_EQ(Foo::constructorCallCount, Foo::destructorCallCount);
+		Foo::reset();
+	}
+}
+
+ANKI_TEST(Util, FlatHashMapBenchmark)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	HighRezTimer timer;
+
+	using OldMap = HashMap<int, int, Hasher>;
+	using FlatMap = FlatHashMap<int, int, Hasher>;
+	using StlMap =
+		std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, HeapAllocator<std::pair<const int, int>>>;
+
+	OldMap oldMap;
+	FlatMap flatMap;
+	StlMap stdMap(10, std::hash<int>(), std::equal_to<int>(), alloc);
+
+	// Create unique keys
+	const U32 COUNT = 1024 * 1024;
+	DynamicArrayAuto<int> vals(alloc);
+	vals.create(COUNT);
+	{
+		std::unordered_map<int, int> tmpMap;
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			int v;
+			do
+			{
+				v = rand();
+			} while(tmpMap.find(v) != tmpMap.end());
+			tmpMap[v] = 1;
+
+			vals[i] = v;
+		}
+	}
+
+	// Insertion
+	{
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			oldMap.emplace(alloc, vals[i], vals[i]);
+		}
+		timer.stop();
+		const Second oldTime = timer.getElapsedTime();
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			flatMap.emplace(alloc, vals[i], vals[i]);
+		}
+		timer.stop();
+		const Second flatTime = timer.getElapsedTime();
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			stdMap[vals[i]] = vals[i];
+		}
+		timer.stop();
+		const Second stlTime = timer.getElapsedTime();
+
+		ANKI_TEST_LOGI("Inserting bench: STL %f HashMap %f FlatHashMap %f", stlTime, oldTime, flatTime);
+	}
+
+	// Search hits and misses
+	std::random_shuffle(vals.begin(), vals.end());
+	{
+		I64 count = 0; // To avoid compiler opts
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			auto it = oldMap.find(vals[i]);
+			count += *it;
+			count += oldMap.find(-vals[i] - 1) != oldMap.getEnd();
+		}
+		timer.stop();
+		const Second oldTime = timer.getElapsedTime();
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			auto it = flatMap.find(vals[i]);
+			count += *it;
+			count += flatMap.find(-vals[i] - 1) != flatMap.getEnd();
+		}
+		timer.stop();
+		const Second flatTime = timer.getElapsedTime();
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			count += stdMap.find(vals[i])->second;
+			count += stdMap.find(-vals[i] - 1) != stdMap.end();
+		}
+		timer.stop();
+		const Second stlTime = timer.getElapsedTime();
+
+		ANKI_TEST_LOGI("Find bench: STL %f HashMap %f FlatHashMap %f (%ld)", stlTime, oldTime, flatTime, count);
+	}
+
+	// Iteration
+	{
+		I64 count = 0;
+
+		timer.start();
+		for(int v : oldMap)
+		{
+			count += v;
+		}
+		timer.stop();
+		const Second oldTime = timer.getElapsedTime();
+
+		timer.start();
+		for(int v : flatMap)
+		{
+			count += v;
+		}
+		timer.stop();
+		const Second flatTime = timer.getElapsedTime();
+
+		timer.start();
+		for(auto& it : stdMap)
+		{
+			count += it.second;
+		}
+		timer.stop();
+		const Second stlTime = timer.getElapsedTime();
+
+		ANKI_TEST_LOGI("Iterate bench: STL %f HashMap %f FlatHashMap %f (%ld)", stlTime, oldTime, flatTime, count);
+	}
+
+	// Delete in random order
+	std::random_shuffle(vals.begin(), vals.end());
+	{
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			oldMap.erase(alloc, oldMap.find(vals[i]));
+		}
+		timer.stop();
+		const Second oldTime = timer.getElapsedTime();
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			flatMap.erase(alloc, flatMap.find(vals[i]));
+		}
+		timer.stop();
+		const Second flatTime = timer.getElapsedTime();
+
+		timer.start();
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			stdMap.erase(stdMap.find(vals[i]));
+		}
+		timer.stop();
+		const Second stlTime = timer.getElapsedTime();
+
+		ANKI_TEST_LOGI("Deleting bench: STL %f HashMap %f FlatHashMap %f", stlTime, oldTime, flatTime);
+	}
+
+	oldMap.destroy(alloc);
+	flatMap.destroy(alloc);
+}
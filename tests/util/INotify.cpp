@@ -32,8 +32,71 @@ ANKI_TEST(Util, INotify)
 
 			ANKI_TEST_EXPECT_NO_ERR(in.pollEvents(modified));
 			ANKI_TEST_EXPECT_EQ(modified, true);
+
+			// Get the names of the files as well
+			ANKI_TEST_EXPECT_NO_ERR(
+				file.open(StringAuto(alloc).sprintf("%s/file2.txt", dir.cstr()).toCString(), FileOpenFlag::WRITE));
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("Hello"));
+			file.close();
+
+			StringListAuto filenames(alloc);
+			ANKI_TEST_EXPECT_NO_ERR(in.pollEvents(modified, &filenames));
+			ANKI_TEST_EXPECT_EQ(modified, true);
+			ANKI_TEST_EXPECT_GT(filenames.getSize(), 0u);
+			for(const String& fname : filenames)
+			{
+				ANKI_TEST_EXPECT_EQ(fname, "file2.txt");
+			}
+
+			ANKI_TEST_EXPECT_NO_ERR(in.pollEvents(modified, &filenames));
+			ANKI_TEST_EXPECT_EQ(modified, false);
 		}
 
 		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dir, alloc));
 	}
+
+	// Monitor many dirs with one instance
+	{
+		Array<CString, 2> dirs = {"in_test_dir0", "in_test_dir1"};
+
+		for(CString dir : dirs)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(createDirectory(dir));
+		}
+
+		{
+			INotify in;
+			ANKI_TEST_EXPECT_NO_ERR(in.init(alloc));
+
+			Array<U32, 2> pathIndices;
+			ANKI_TEST_EXPECT_NO_ERR(in.addPath(dirs[0], pathIndices[0]));
+			ANKI_TEST_EXPECT_NO_ERR(in.addPath(dirs[1], pathIndices[1]));
+			ANKI_TEST_EXPECT_NEQ(pathIndices[0], pathIndices[1]);
+
+			File file;
+			ANKI_TEST_EXPECT_NO_ERR(
+				file.open(StringAuto(alloc).sprintf("%s/file.txt", dirs[1].cstr()).toCString(), FileOpenFlag::WRITE));
+			file.close();
+
+			Bool modified;
+			StringListAuto filenames(alloc);
+			DynamicArrayAuto<U32> filenamePaths(alloc);
+			ANKI_TEST_EXPECT_NO_ERR(in.pollEvents(modified, &filenames, &filenamePaths));
+			ANKI_TEST_EXPECT_EQ(modified, true);
+			ANKI_TEST_EXPECT_GT(filenames.getSize(), 0u);
+			ANKI_TEST_EXPECT_EQ(filenamePaths.getSize(), filenames.getSize());
+			for(U32 pathIdx : filenamePaths)
+			{
+				ANKI_TEST_EXPECT_EQ(pathIdx, pathIndices[1]);
+			}
+
+			ANKI_TEST_EXPECT_NO_ERR(in.pollEvents(modified));
+			ANKI_TEST_EXPECT_EQ(modified, false);
+		}
+
+		for(CString dir : dirs)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dir, alloc));
+		}
+	}
 }
@@ -0,0 +1,155 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/Logger.h>
+#include <anki/util/ThreadHive.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/System.h>
+
+namespace anki
+{
+
+class LoggerTestContext
+{
+public:
+	Logger* m_logger = nullptr;
+	U32 m_messagesPerTask = 0;
+	Atomic<U64> m_totalLatencyNs = {0};
+	Atomic<U64> m_maxLatencyNs = {0};
+	Atomic<U32> m_handledCount = {0};
+	Second m_handlerDelay = 0.0;
+};
+
+static void slowHandler(void* userData, const LoggerMessageInfo& info)
+{
+	LoggerTestContext& ctx = *static_cast<LoggerTestContext*>(userData);
+	if(ctx.m_handlerDelay > 0.0)
+	{
+		// Simulate a slow console or file
+		HighRezTimer::sleep(ctx.m_handlerDelay);
+	}
+	ctx.m_handledCount.fetchAdd(1);
+}
+
+static void logTask(void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* sem)
+{
+	LoggerTestContext& ctx = *static_cast<LoggerTestContext*>(userData);
+
+	for(U32 i = 0; i < ctx.m_messagesPerTask; ++i)
+	{
+		HighRezTimer timer;
+		timer.start();
+		ctx.m_logger->writeFormated(ANKI_FILE, __LINE__, ANKI_FUNC, "TEST", LoggerMessageType::NORMAL,
+									Thread::getCurrentThreadId(), "Message %u from thread %u", i, threadId);
+		timer.stop();
+
+		const U64 ns = U64(timer.getElapsedTime() * 1000000000.0);
+		ctx.m_totalLatencyNs.fetchAdd(ns);
+		ctx.m_maxLatencyNs.max(ns);
+	}
+}
+
+static void runLoggerTasks(Logger& logger, LoggerTestContext& ctx, ThreadHive& hive, U32 taskCount)
+{
+	ctx.m_logger = &logger;
+	ctx.m_totalLatencyNs.setNonAtomically(0);
+	ctx.m_maxLatencyNs.setNonAtomically(0);
+	ctx.m_handledCount.setNonAtomically(0);
+
+	for(U32 i = 0; i < taskCount; ++i)
+	{
+		hive.submitTask(logTask, &ctx);
+	}
+	hive.waitAllTasks();
+	logger.flush();
+}
+
+ANKI_TEST(Util, LoggerAsync)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 threadCount = getCpuCoresCount();
+	ThreadHive hive(threadCount, alloc);
+	const U32 taskCount = threadCount * 4;
+
+	LoggerTestContext ctx;
+	ctx.m_messagesPerTask = 32;
+	ctx.m_handlerDelay = 20.0e-6;
+	const U32 messageCount = taskCount * ctx.m_messagesPerTask;
+
+	// Synchronous
+	Second syncAvgLatency;
+	Second syncMaxLatency;
+	{
+		Logger logger;
+		logger.addMessageHandler(&ctx, slowHandler);
+
+		runLoggerTasks(logger, ctx, hive, taskCount);
+		ANKI_TEST_EXPECT_EQ(ctx.m_handledCount.load(), messageCount);
+
+		syncAvgLatency = Second(ctx.m_totalLatencyNs.load()) / Second(messageCount) / 1000000000.0;
+		syncMaxLatency = Second(ctx.m_maxLatencyNs.load()) / 1000000000.0;
+	}
+
+	// Asynchronous, nothing should be dropped
+	{
+		Logger logger;
+		logger.addMessageHandler(&ctx, slowHandler);
+		logger.enableAsync(1024, LoggerOverflowPolicy::BLOCK);
+		ANKI_TEST_EXPECT_EQ(logger.isAsync(), true);
+
+		runLoggerTasks(logger, ctx, hive, taskCount);
+		ANKI_TEST_EXPECT_EQ(ctx.m_handledCount.load(), messageCount);
+
+		LoggerAsyncStatistics stats;
+		logger.getAsyncStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_writtenCount, messageCount);
+		ANKI_TEST_EXPECT_EQ(stats.m_droppedCount, 0);
+
+		const Second asyncAvgLatency = Second(ctx.m_totalLatencyNs.load()) / Second(messageCount) / 1000000000.0;
+		const Second asyncMaxLatency = Second(ctx.m_maxLatencyNs.load()) / 1000000000.0;
+
+		ANKI_TEST_LOGI("Producer latency: sync avg %fus max %fus | async avg %fus max %fus (%lu blocked)",
+					   syncAvgLatency * 1000000.0, syncMaxLatency * 1000000.0, asyncAvgLatency * 1000000.0,
+					   asyncMaxLatency * 1000000.0, stats.m_blockedCount);
+
+		logger.disableAsync();
+		ANKI_TEST_EXPECT_EQ(logger.isAsync(), false);
+	}
+
+	// A small ring that drops messages
+	{
+		Logger logger;
+		logger.addMessageHandler(&ctx, slowHandler);
+		logger.enableAsync(16, LoggerOverflowPolicy::DROP);
+		ctx.m_handlerDelay = 1.0e-3;
+		ctx.m_handledCount.setNonAtomically(0);
+
+		const U32 count = 200;
+		for(U32 i = 0; i < count; ++i)
+		{
+			logger.writeFormated(ANKI_FILE, __LINE__, ANKI_FUNC, "TEST", LoggerMessageType::NORMAL,
+								 Thread::getCurrentThreadId(), "Message %u", i);
+		}
+
+		// Errors are never dropped
+		for(U32 i = 0; i < 32; ++i)
+		{
+			logger.writeFormated(ANKI_FILE, __LINE__, ANKI_FUNC, "TEST", LoggerMessageType::ERROR,
+								 Thread::getCurrentThreadId(), "Error %u", i);
+		}
+
+		logger.flush();
+
+		LoggerAsyncStatistics stats;
+		logger.getAsyncStatistics(stats);
+		ANKI_TEST_EXPECT_GT(stats.m_droppedCount, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_writtenCount + stats.m_droppedCount, count + 32);
+		ANKI_TEST_EXPECT_EQ(ctx.m_handledCount.load(), stats.m_writtenCount);
+		ANKI_TEST_EXPECT_GEQ(stats.m_writtenCount, 32);
+	}
+}
+
+} // end namespace anki
@@ -6,7 +6,12 @@
 #include "tests/framework/Framework.h"
 #include "tests/util/Foo.h"
 #include "anki/util/Memory.h"
+#include "anki/util/ThreadCachingHeap.h"
+#include "anki/util/MemoryTag.h"
+#include "anki/util/HighRezTimer.h"
+#include "anki/util/System.h"
 #include "anki/util/ThreadPool.h"
+#include "anki/util/Thread.h"
 #include <type_traits>
 #include <cstring>
 
@@ -35,6 +40,240 @@ ANKI_TEST(Util, HeapMemoryPool)
 	}
 }
 
+ANKI_TEST(Util, ThreadCachingHeapMemoryPool)
+{
+	// Different sizes and alignments
+	{
+		HeapMemoryPool pool;
+		pool.init(allocAligned, nullptr, true);
+		ANKI_TEST_EXPECT_EQ(pool.isThreadCaching(), true);
+
+		Array<void*, 64> ptrs;
+		for(U32 i = 0; i < ptrs.getSize(); ++i)
+		{
+			const PtrSize size = PtrSize(i) * 97 + 1;
+			const PtrSize alignment = (i % 8 == 7) ? 64 : ANKI_SAFE_ALIGNMENT;
+			ptrs[i] = pool.allocate(size, alignment);
+			ANKI_TEST_EXPECT_NEQ(ptrs[i], nullptr);
+			ANKI_TEST_EXPECT_EQ(isAligned(alignment, ptrs[i]), true);
+			memset(ptrs[i], int(i), size);
+		}
+
+		for(U32 i = 0; i < ptrs.getSize(); ++i)
+		{
+			const PtrSize size = PtrSize(i) * 97 + 1;
+			const U8* mem = static_cast<const U8*>(ptrs[i]);
+			ANKI_TEST_EXPECT_EQ(mem[0], U8(i));
+			ANKI_TEST_EXPECT_EQ(mem[size - 1], U8(i));
+		}
+
+		ThreadCachingHeapStatistics stats;
+		pool.getStatistics(stats);
+		U64 allocationCount = 0;
+		for(U64 count : stats.m_allocationCounts)
+		{
+			allocationCount += count;
+		}
+		ANKI_TEST_EXPECT_EQ(allocationCount, ptrs.getSize());
+		ANKI_TEST_EXPECT_GT(stats.m_liveBytes, 0);
+		ANKI_TEST_EXPECT_GT(stats.m_allocationCounts[ThreadCachingHeapStatistics::SIZE_CLASS_COUNT], 0);
+
+		for(void* ptr : ptrs)
+		{
+			pool.free(ptr);
+		}
+
+		pool.getStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+		ANKI_TEST_EXPECT_GEQ(stats.m_peakLiveBytes, 64 * 97);
+		for(U32 i = 0; i < stats.m_allocationCounts.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(stats.m_allocationCounts[i], stats.m_freeCounts[i]);
+		}
+	}
+
+	// Blocks are reused
+	{
+		HeapMemoryPool pool;
+		pool.init(allocAligned, nullptr, true);
+
+		for(U32 i = 0; i < 10000; ++i)
+		{
+			void* ptr = pool.allocate(100, 16);
+			pool.free(ptr);
+		}
+
+		ThreadCachingHeapStatistics stats;
+		pool.getStatistics(stats);
+		ANKI_TEST_EXPECT_LEQ(stats.m_reservedBytes, 64_KB);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+	}
+
+	// Allocate in one thread and free in others
+	{
+		HeapMemoryPool pool;
+		pool.init(allocAligned, nullptr, true);
+
+		const U32 THREAD_COUNT = 8;
+		const U32 ALLOCATION_COUNT = 1024;
+		ThreadPool threadPool(THREAD_COUNT);
+
+		Array<void*, THREAD_COUNT * ALLOCATION_COUNT> ptrs;
+		for(U32 i = 0; i < ptrs.getSize(); ++i)
+		{
+			ptrs[i] = pool.allocate((i % 200) + 1, 8);
+			memset(ptrs[i], 0xAB, (i % 200) + 1);
+		}
+
+		class FreeTask : public ThreadPoolTask
+		{
+		public:
+			HeapMemoryPool* m_pool = nullptr;
+			WeakArray<void*> m_ptrs;
+
+			Error operator()(U32 taskId, PtrSize threadsCount)
+			{
+				for(void* ptr : m_ptrs)
+				{
+					m_pool->free(ptr);
+				}
+
+				// And allocate a bit to use the freed blocks
+				for(U32 i = 0; i < 100; ++i)
+				{
+					m_pool->free(m_pool->allocate(i + 1, 8));
+				}
+
+				return Error::NONE;
+			}
+		};
+
+		Array<FreeTask, THREAD_COUNT> tasks;
+		for(U32 i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_pool = &pool;
+			tasks[i].m_ptrs = WeakArray<void*>(&ptrs[i * ALLOCATION_COUNT], ALLOCATION_COUNT);
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+
+		ThreadCachingHeapStatistics stats;
+		pool.getStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+	}
+}
+
+/// Asks for the thread slot when the thread exits.
+class ThreadSlotExitChecker
+{
+public:
+	U32* m_slotAtExit = nullptr;
+
+	~ThreadSlotExitChecker()
+	{
+		if(m_slotAtExit)
+		{
+			*m_slotAtExit = detail::getThreadSlot();
+		}
+	}
+};
+
+static thread_local ThreadSlotExitChecker g_threadSlotExitChecker;
+
+ANKI_TEST(Util, ThreadSlot)
+{
+	class Context
+	{
+	public:
+		U32 m_slot = MAX_U32;
+		U32 m_slotAtExit = 0;
+	} ctx;
+
+	Thread thread("ThreadSlot");
+	thread.start(&ctx, [](ThreadCallbackInfo& info) -> Error {
+		Context& ctx = *static_cast<Context*>(info.m_userData);
+
+		// Construct the checker first so it's destroyed after the slot is released
+		g_threadSlotExitChecker.m_slotAtExit = &ctx.m_slotAtExit;
+		ctx.m_slot = detail::getThreadSlot();
+		return Error::NONE;
+	});
+	ANKI_TEST_EXPECT_NO_ERR(thread.join());
+
+	ANKI_TEST_EXPECT_NEQ(ctx.m_slot, MAX_U32);
+	ANKI_TEST_EXPECT_EQ(ctx.m_slotAtExit, MAX_U32);
+}
+
+ANKI_TEST(Util, HeapMemoryPoolBenchmark)
+{
+	const U32 THREAD_COUNT = min<U32>(getCpuCoresCount(), ThreadPool::MAX_THREADS);
+	const U32 ITERATION_COUNT = 100000;
+	const U32 LIVE_COUNT = 256;
+
+	class AllocFreeTask : public ThreadPoolTask
+	{
+	public:
+		HeapMemoryPool* m_pool = nullptr;
+		Array<void*, LIVE_COUNT> m_ptrs;
+
+		Error operator()(U32 taskId, PtrSize threadsCount)
+		{
+			for(void*& ptr : m_ptrs)
+			{
+				ptr = nullptr;
+			}
+
+			for(U32 i = 0; i < ITERATION_COUNT; ++i)
+			{
+				const U32 idx = getRandom() % LIVE_COUNT;
+				m_pool->free(m_ptrs[idx]);
+				m_ptrs[idx] = m_pool->allocate(getRandomRange(8u, 1024u), 16);
+			}
+
+			for(void* ptr : m_ptrs)
+			{
+				m_pool->free(ptr);
+			}
+
+			return Error::NONE;
+		}
+	};
+
+	ThreadPool threadPool(THREAD_COUNT);
+	Array<AllocFreeTask, ThreadPool::MAX_THREADS> tasks;
+
+	Array<F64, 2> times;
+	for(U32 threadCaching = 0; threadCaching < 2; ++threadCaching)
+	{
+		HeapMemoryPool pool;
+		pool.init(allocAligned, nullptr, threadCaching == 1);
+
+		HighRezTimer timer;
+		timer.start();
+		for(U32 i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_pool = &pool;
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+		timer.stop();
+		times[threadCaching] = timer.getElapsedTime();
+
+		if(threadCaching)
+		{
+			ThreadCachingHeapStatistics stats;
+			pool.getStatistics(stats);
+			ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+			ANKI_TEST_LOGI("Thread caching heap: peak %luKB, reserved %luKB", stats.m_peakLiveBytes / 1024,
+						   stats.m_reservedBytes / 1024);
+		}
+	}
+
+	ANKI_TEST_LOGI("Alloc/free bench (%u threads): heap %f thread caching %f | %f%%", THREAD_COUNT, times[0], times[1],
+				   times[0] / times[1] * 100.0);
+}
+
 ANKI_TEST(Util, StackMemoryPool)
 {
 	// Create/destroy test
@@ -170,6 +409,132 @@ ANKI_TEST(Util, StackMemoryPool)
 	}
 }
 
+ANKI_TEST(Util, StackMemoryPoolThreadArenas)
+{
+	const U32 THREAD_COUNT = 8;
+	const U32 ALLOCATION_COUNT = 512;
+	ThreadPool threadPool(THREAD_COUNT);
+
+	class AllocateTask : public ThreadPoolTask
+	{
+	public:
+		StackMemoryPool* m_pool = nullptr;
+		Array<U8*, ALLOCATION_COUNT> m_allocations;
+
+		Error operator()(U32 taskId, PtrSize threadsCount)
+		{
+			for(U32 i = 0; i < ALLOCATION_COUNT; ++i)
+			{
+				// Some big ones that go to the shared stack
+				const PtrSize size = (i % 64 == 0) ? 5000 : (i % 100) + 1;
+				m_allocations[i] = static_cast<U8*>(m_pool->allocate(size, 16));
+				memset(m_allocations[i], U8(taskId), size);
+			}
+
+			return Error::NONE;
+		}
+	};
+
+	StackMemoryPool pool;
+	pool.init(allocAligned, nullptr, 64_KB, 2.0f, 0, false);
+	pool.setThreadArenaSize(8_KB);
+
+	Array<AllocateTask, THREAD_COUNT> tasks;
+	for(U32 frame = 0; frame < 3; ++frame)
+	{
+		for(U32 i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_pool = &pool;
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+
+		// Check that no allocations overlap
+		for(U32 i = 0; i < THREAD_COUNT; ++i)
+		{
+			for(U32 j = 0; j < ALLOCATION_COUNT; ++j)
+			{
+				ANKI_TEST_EXPECT_EQ(isAligned(16, tasks[i].m_allocations[j]), true);
+				ANKI_TEST_EXPECT_EQ(tasks[i].m_allocations[j][0], U8(i));
+			}
+		}
+
+		// Free does nothing and there are no warnings on reset
+		pool.free(tasks[0].m_allocations[0]);
+		ANKI_TEST_EXPECT_EQ(pool.getAllocationsCount(), 0);
+
+		pool.reset();
+		ANKI_TEST_EXPECT_GT(pool.getThreadArenaWastedBytes(), 0);
+		ANKI_TEST_EXPECT_LT(pool.getThreadArenaWastedBytes(), pool.getMemoryCapacity());
+	}
+}
+
+ANKI_TEST(Util, StackMemoryPoolBenchmark)
+{
+	const U32 THREAD_COUNT = min<U32>(getCpuCoresCount(), ThreadPool::MAX_THREADS);
+	const U32 ALLOCATION_COUNT = 100000;
+
+	class AllocateTask : public ThreadPoolTask
+	{
+	public:
+		StackMemoryPool* m_pool = nullptr;
+
+		Error operator()(U32 taskId, PtrSize threadsCount)
+		{
+			for(U32 i = 0; i < ALLOCATION_COUNT; ++i)
+			{
+				void* ptr = m_pool->allocate((i % 128) + 8, 16);
+				static_cast<U8*>(ptr)[0] = U8(i);
+			}
+
+			return Error::NONE;
+		}
+	};
+
+	ThreadPool threadPool(THREAD_COUNT);
+	Array<AllocateTask, ThreadPool::MAX_THREADS> tasks;
+
+	Array<F64, 2> times;
+	for(U32 threadArenas = 0; threadArenas < 2; ++threadArenas)
+	{
+		StackMemoryPool pool;
+		pool.init(allocAligned, nullptr, 1_MB);
+		if(threadArenas)
+		{
+			pool.setThreadArenaSize(16_KB);
+		}
+
+		// Warm up the chunks and then measure the 2nd frame
+		F64 time = 0.0;
+		for(U32 frame = 0; frame < 2; ++frame)
+		{
+			HighRezTimer timer;
+			timer.start();
+			for(U32 i = 0; i < THREAD_COUNT; ++i)
+			{
+				tasks[i].m_pool = &pool;
+				threadPool.assignNewTask(i, &tasks[i]);
+			}
+			ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+			timer.stop();
+			time = timer.getElapsedTime();
+
+			pool.reset();
+		}
+
+		times[threadArenas] = time;
+
+		if(threadArenas)
+		{
+			ANKI_TEST_LOGI("Thread arenas wasted %luB per frame", pool.getThreadArenaWastedBytes());
+		}
+	}
+
+	ANKI_TEST_LOGI("Stack alloc bench (%u threads): shared %f thread arenas %f | %f%%", THREAD_COUNT, times[0],
+				   times[1], times[0] / times[1] * 100.0);
+}
+
 ANKI_TEST(Util, ChainMemoryPool)
 {
 	// Basic test
@@ -218,3 +583,68 @@ ANKI_TEST(Util, ChainMemoryPool)
 		ANKI_TEST_EXPECT_EQ(pool.getChunksCount(), 0);
 	}
 }
+
+ANKI_TEST(Util, MemoryTag)
+{
+	MemoryTag parent;
+	parent.init("PARENT", allocAligned, nullptr);
+	MemoryTag child;
+	child.init("CHILD", allocAligned, nullptr, &parent);
+	child.setCallstackSamplingRate(1);
+	child.setBudget(1_KB);
+
+	// Heap pool
+	{
+		HeapMemoryPool pool;
+		pool.init(MemoryTag::allocCallback, &child);
+		ANKI_TEST_EXPECT_EQ(pool.getMemoryTag(), &child);
+
+		void* a = pool.allocate(100, 8);
+		void* b = pool.allocate(1000, 64);
+		ANKI_TEST_EXPECT_EQ(isAligned(64, b), true);
+		memset(a, 0, 100);
+		memset(b, 0, 1000);
+
+		// The pool might add some bytes of its own
+		MemoryTagStatistics stats;
+		child.getStatistics(stats);
+		const PtrSize liveBytes = stats.m_liveBytes;
+		ANKI_TEST_EXPECT_GEQ(liveBytes, 1100);
+		ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, 2);
+		parent.getStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, liveBytes);
+		ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, 2);
+
+		child.endFrame();
+		child.logSampledCallstacks(2);
+
+		pool.free(a);
+		pool.free(b);
+
+		child.getStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_peakLiveBytes, liveBytes);
+		ANKI_TEST_EXPECT_EQ(stats.m_freeCount, 2);
+		parent.getStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_freeCount, 2);
+	}
+
+	// Stack pools report their chunks
+	{
+		StackMemoryPool pool;
+		pool.init(MemoryTag::allocCallback, &parent, 1_KB);
+		pool.allocate(10, 1);
+
+		MemoryTagStatistics stats;
+		parent.getStatistics(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 1_KB);
+	}
+
+	// Untagged pool
+	{
+		HeapMemoryPool pool;
+		pool.init(allocAligned, nullptr);
+		ANKI_TEST_EXPECT_EQ(pool.getMemoryTag(), nullptr);
+	}
+}
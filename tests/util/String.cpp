@@ -232,4 +232,66 @@ ANKI_TEST(Util, String)
 	}
 }
 
+ANKI_TEST(Util, StringInline)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Fits in the inline storage
+	{
+		StringInline<16> a(alloc, "abc");
+		ANKI_TEST_EXPECT_EQ(a, "abc");
+		ANKI_TEST_EXPECT_EQ(a.getLength(), 3);
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+
+		a.append("def");
+		ANKI_TEST_EXPECT_EQ(a, "abcdef");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+
+		a.sprintf("%s_%d", "Idx", 42);
+		ANKI_TEST_EXPECT_EQ(a, "Idx_42");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+
+		CString c = a;
+		ANKI_TEST_EXPECT_EQ(c, "Idx_42");
+
+		U32 n;
+		StringInline<16> b(alloc, "1234");
+		ANKI_TEST_EXPECT_NO_ERR(b.toNumber(n));
+		ANKI_TEST_EXPECT_EQ(n, 1234);
+	}
+
+	// Spill to the allocator
+	{
+		StringInline<8> a(alloc, "abcdefg");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+
+		a.append("hij");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), false);
+		ANKI_TEST_EXPECT_EQ(a, "abcdefghij");
+
+		a.sprintf("%s%s%s", "0123456789", "0123456789", "0123456789");
+		ANKI_TEST_EXPECT_EQ(a.getLength(), 30);
+		ANKI_TEST_EXPECT_EQ(a, "012345678901234567890123456789");
+
+		StringInline<8> b(alloc);
+		b.sprintf("%s", "a long string that doesn't fit");
+		ANKI_TEST_EXPECT_EQ(b, "a long string that doesn't fit");
+
+		// Move steals the memory
+		StringInline<8> c(std::move(a));
+		ANKI_TEST_EXPECT_EQ(c.isInline(), false);
+		ANKI_TEST_EXPECT_EQ(c, "012345678901234567890123456789");
+		ANKI_TEST_EXPECT_EQ(a.isEmpty(), true);
+
+		// Copy
+		StringInline<8> d(c);
+		ANKI_TEST_EXPECT_EQ(d, c.toCString());
+
+		d.destroy();
+		ANKI_TEST_EXPECT_EQ(d.isInline(), true);
+		ANKI_TEST_EXPECT_EQ(d.isEmpty(), true);
+		ANKI_TEST_EXPECT_EQ(d, "");
+	}
+}
+
 } // end namespace anki
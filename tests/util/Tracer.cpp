@@ -5,52 +5,262 @@
 
 #include <tests/framework/Framework.h>
 #include <anki/util/Tracer.h>
+#include <anki/util/TracerStatistics.h>
 #include <anki/core/CoreTracer.h>
 #include <anki/util/HighRezTimer.h>
+#include <anki/util/ThreadHive.h>
+#include <anki/util/System.h>
 
 #if ANKI_ENABLE_TRACE
 ANKI_TEST(Util, Tracer)
 {
 	HeapAllocator<U8> alloc(allocAligned, nullptr);
-	CoreTracer tracer;
-	ANKI_TEST_EXPECT_NO_ERR(tracer.init(alloc, "./"));
-	TracerSingleton::get().setEnabled(true);
+	StringAuto traceFilename(alloc);
+	{
+		CoreTracer tracer;
+		ANKI_TEST_EXPECT_NO_ERR(tracer.init(alloc, "./"));
+		TracerSingleton::get().setEnabled(true);
+		traceFilename.create(tracer.getTraceFilename());
+
+		// 1st frame
+		tracer.flushFrame(0);
+
+		// 2nd frame
+		// 2 events
+		{
+			ANKI_TRACE_SCOPED_EVENT(EVENT);
+			HighRezTimer::sleep(0.5);
+		}
+
+		{
+			ANKI_TRACE_SCOPED_EVENT(EVENT);
+			HighRezTimer::sleep(0.25);
+		}
+
+		tracer.flushFrame(1);
+
+		// 4rd frame
+		// 2 different events & non zero counter
+		{
+			ANKI_TRACE_SCOPED_EVENT(EVENT);
+			HighRezTimer::sleep(0.5);
+		}
+
+		{
+			ANKI_TRACE_SCOPED_EVENT(EVENT2);
+			HighRezTimer::sleep(0.25);
+		}
+
+		ANKI_TRACE_INC_COUNTER(COUNTER, 100);
+
+		tracer.flushFrame(3);
+
+		// 5th frame
+		ANKI_TRACE_INC_COUNTER(COUNTER, 150);
+		tracer.flushFrame(4);
+	}
+
+	// Convert the binary trace
+	CoreTraceConverter converter(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(converter.convert(traceFilename, "./trace.json", "./counters.csv"));
+
+	StringAuto json(alloc);
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./trace.json", FileOpenFlag::READ));
+	ANKI_TEST_EXPECT_NO_ERR(file.readAllText(json));
+	ANKI_TEST_EXPECT_NEQ(json.find("\"name\": \"EVENT2\""), CString::NPOS);
+}
+
+namespace anki
+{
+
+class TracerTestContext
+{
+public:
+	Tracer* m_tracer = nullptr;
+	U32 m_eventsPerTask = 0;
+	Atomic<U32> m_runningTasks = {0};
+	Atomic<U64> m_flushedEventCount = {0};
+};
+
+static void traceTask(void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* sem)
+{
+	TracerTestContext& ctx = *static_cast<TracerTestContext*>(userData);
+	for(U32 i = 0; i < ctx.m_eventsPerTask; ++i)
+	{
+		TracerEventHandle handle = ctx.m_tracer->beginEvent();
+		ctx.m_tracer->endEvent("TASK", handle);
+	}
+
+	ctx.m_runningTasks.fetchSub(1);
+}
+
+static void countEvents(void* userData, ThreadId tid, ConstWeakArray<TracerEvent> events,
+						ConstWeakArray<TracerCounter> counters)
+{
+	TracerTestContext& ctx = *static_cast<TracerTestContext*>(userData);
+	ctx.m_flushedEventCount.fetchAdd(events.getSize());
+}
+
+} // end namespace anki
 
-	// 1st frame
-	tracer.flushFrame(0);
+ANKI_TEST(Util, TracerOverhead)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	Tracer tracer(alloc);
+	TracerTestContext ctx;
+	ctx.m_tracer = &tracer;
 
-	// 2nd frame
-	// 2 events
+	// Measure the cost of a scoped event on a single thread
+	const U32 eventCount = 1000000;
+	const U32 eventsPerFlush = 4 * 1024;
+	for(Bool enabled : {false, true})
 	{
-		ANKI_TRACE_SCOPED_EVENT(EVENT);
-		HighRezTimer::sleep(0.5);
+		tracer.setEnabled(enabled);
+		ctx.m_flushedEventCount.setNonAtomically(0);
+
+		Second elapsed = 0.0;
+		for(U32 i = 0; i < eventCount; i += eventsPerFlush)
+		{
+			HighRezTimer timer;
+			timer.start();
+			for(U32 j = 0; j < eventsPerFlush; ++j)
+			{
+				TracerEventHandle handle = tracer.beginEvent();
+				tracer.endEvent("EVENT", handle);
+			}
+			timer.stop();
+			elapsed += timer.getElapsedTime();
+
+			tracer.flush(countEvents, &ctx);
+		}
+
+		const U32 totalEvents = (eventCount + eventsPerFlush - 1) / eventsPerFlush * eventsPerFlush;
+		ANKI_TEST_LOGI("Scoped event with the tracer %s: %fns", (enabled) ? "enabled" : "disabled",
+					   elapsed / Second(totalEvents) * 1000000000.0);
+
+		ANKI_TEST_EXPECT_EQ(tracer.getDroppedRecordCount(), 0);
+		if(enabled)
+		{
+			// Some events might have taken 0 time and got skipped
+			ANKI_TEST_EXPECT_LEQ(ctx.m_flushedEventCount.load(), totalEvents);
+			ANKI_TEST_EXPECT_GT(ctx.m_flushedEventCount.load(), 0);
+		}
+		else
+		{
+			ANKI_TEST_EXPECT_EQ(ctx.m_flushedEventCount.load(), 0);
+		}
 	}
 
+	// Flush while many threads write
 	{
-		ANKI_TRACE_SCOPED_EVENT(EVENT);
-		HighRezTimer::sleep(0.25);
+		tracer.setEnabled(true);
+		ctx.m_flushedEventCount.setNonAtomically(0);
+
+		const U32 threadCount = getCpuCoresCount();
+		ThreadHive hive(threadCount, alloc);
+		const U32 taskCount = threadCount * 4;
+		ctx.m_eventsPerTask = 10000;
+		ctx.m_runningTasks.setNonAtomically(taskCount);
+
+		for(U32 i = 0; i < taskCount; ++i)
+		{
+			hive.submitTask(traceTask, &ctx);
+		}
+
+		while(ctx.m_runningTasks.load() > 0)
+		{
+			tracer.flush(countEvents, &ctx);
+		}
+
+		hive.waitAllTasks();
+		tracer.flush(countEvents, &ctx);
+
+		// Every event either got flushed or dropped and the counters use the same rings
+		ANKI_TEST_EXPECT_LEQ(ctx.m_flushedEventCount.load(), taskCount * ctx.m_eventsPerTask);
+		ANKI_TEST_LOGI("Multithreaded: %lu events flushed, %lu records dropped", ctx.m_flushedEventCount.load(),
+					   tracer.getDroppedRecordCount());
 	}
+}
+#endif
 
-	tracer.flushFrame(1);
+ANKI_TEST(Util, TracerStatistics)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 window = 100;
+	TracerStatistics stats(alloc, window);
 
-	// 4rd frame
-	// 2 different events & non zero counter
+	// Feed a frame time of 1..200ms, one event per frame. Also a counter every other frame
+	for(U32 frame = 1; frame <= 200; ++frame)
 	{
-		ANKI_TRACE_SCOPED_EVENT(EVENT);
-		HighRezTimer::sleep(0.5);
+		TracerEvent event;
+		event.m_name = "FRAME";
+		event.m_start = 0.0;
+		event.m_duration = Second(frame) / 1000.0;
+		stats.addEvents(ConstWeakArray<TracerEvent>(&event, 1));
+
+		// The event has a counter with the same name like the Tracer does. Split it in 2 to test the merging
+		Array<TracerCounter, 3> counters;
+		counters[0].m_name = "FRAME";
+		counters[0].m_value = U64(frame) * 1000000 / 2;
+		counters[1].m_name = "FRAME";
+		counters[1].m_value = U64(frame) * 1000000 - counters[0].m_value;
+		counters[2].m_name = "COUNTER";
+		counters[2].m_value = 10;
+		stats.addCounters(ConstWeakArray<TracerCounter>(&counters[0], (frame % 2) ? 2 : 3));
+
+		stats.endFrame();
 	}
 
+	ANKI_TEST_EXPECT_EQ(stats.getFrameCount(), 200);
+
+	// The window has the frames 101..200ms
+	TracerStatisticsEntry entry;
+	ANKI_TEST_EXPECT_EQ(stats.getEntry("FRAME", entry), true);
+	ANKI_TEST_EXPECT_EQ(entry.m_isEvent, true);
+	ANKI_TEST_EXPECT_EQ(entry.m_sampleCount, window);
+	ANKI_TEST_EXPECT_EQ(entry.m_max, 200 * 1000000);
+	ANKI_TEST_EXPECT_NEAR(entry.m_average, 150.5 * 1000000.0, 1.0);
+
+	// The percentiles are approximate
+	const F64 tolerance = 0.07;
+	ANKI_TEST_EXPECT_NEAR(F64(entry.m_p50), 150.0e6, 150.0e6 * tolerance);
+	ANKI_TEST_EXPECT_NEAR(F64(entry.m_p95), 195.0e6, 195.0e6 * tolerance);
+	ANKI_TEST_EXPECT_NEAR(F64(entry.m_p99), 199.0e6, 199.0e6 * tolerance);
+	ANKI_TEST_EXPECT_LEQ(entry.m_p50, entry.m_p95);
+	ANKI_TEST_EXPECT_LEQ(entry.m_p95, entry.m_p99);
+	ANKI_TEST_EXPECT_LEQ(entry.m_p99, entry.m_max);
+
+	ANKI_TEST_EXPECT_EQ(stats.getEntry("COUNTER", entry), true);
+	ANKI_TEST_EXPECT_EQ(entry.m_isEvent, false);
+	ANKI_TEST_EXPECT_EQ(entry.m_sampleCount, window / 2);
+	ANKI_TEST_EXPECT_EQ(entry.m_p50, 10);
+	ANKI_TEST_EXPECT_EQ(entry.m_p99, 10);
+
+	ANKI_TEST_EXPECT_EQ(stats.getEntry("NOTHING", entry), false);
+
+	// Small values are exact
+	for(U32 frame = 0; frame < window; ++frame)
 	{
-		ANKI_TRACE_SCOPED_EVENT(EVENT2);
-		HighRezTimer::sleep(0.25);
+		TracerCounter counter;
+		counter.m_name = "SMALL";
+		counter.m_value = frame % 4;
+		stats.addCounters(ConstWeakArray<TracerCounter>(&counter, 1));
+		stats.endFrame();
 	}
 
-	ANKI_TRACE_INC_COUNTER(COUNTER, 100);
+	ANKI_TEST_EXPECT_EQ(stats.getEntry("SMALL", entry), true);
+	ANKI_TEST_EXPECT_EQ(entry.m_p50, 1);
+	ANKI_TEST_EXPECT_EQ(entry.m_p95, 3);
+	ANKI_TEST_EXPECT_EQ(entry.m_max, 3);
+
+	// All the frames of the window passed without a COUNTER
+	ANKI_TEST_EXPECT_EQ(stats.getEntry("COUNTER", entry), true);
+	ANKI_TEST_EXPECT_EQ(entry.m_sampleCount, 0);
 
-	tracer.flushFrame(3);
+	stats.log();
 
-	// 5th frame
-	ANKI_TRACE_INC_COUNTER(COUNTER, 150);
-	tracer.flushFrame(4);
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./trace_statistics.csv", FileOpenFlag::WRITE));
+	ANKI_TEST_EXPECT_NO_ERR(stats.writeCsv(file, true));
 }
-#endif
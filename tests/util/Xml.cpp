@@ -0,0 +1,256 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/Xml.h>
+#include <anki/util/HighRezTimer.h>
+
+namespace anki
+{
+
+static const char* MATERIAL_XML = R"(<?xml version="1.0" encoding="UTF-8" ?>
+<!-- This file is auto generated by ImporterMaterial.cpp -->
+<material shaderProgram="anki/shaders/GBufferGeneric.ankiprog">
+	<mutation>
+		<mutator name="DIFFUSE_TEX" value="0"/>
+		<mutator name="SPECULAR_TEX" value="0"/>
+		<mutator name="ROUGHNESS_TEX" value="0"/>
+		<mutator name="METAL_TEX" value="0"/>
+		<mutator name="NORMAL_TEX" value="0"/>
+		<mutator name="PARALLAX" value="0"/>
+		<mutator name="EMISSIVE_TEX" value="0"/>
+	</mutation>
+
+	<inputs>
+		<input shaderVar="m_diffColor" value="0.097887 0.273263 0.800000"/>
+		<input shaderVar="m_specColor" value="0.040000 0.040000 0.040000"/>
+		<input shaderVar="m_roughness" value="0.000000"/>
+		<input shaderVar="m_metallic" value="0.609091"/>
+		<input shaderVar="m_emission" value="0.000000 0.000000 0.000000"/>
+		<input shaderVar="m_subsurface" value="0.000000"/>
+	</inputs>
+</material>
+
+<rtMaterial>
+	<rayType type="shadows" shaderProgram="anki/shaders/RtShadowsHit.ankiprog">
+		<mutation>
+			<mutator name="ALPHA_TEXTURE" value="0"/>
+		</mutation>
+	</rayType>
+</rtMaterial>
+)";
+
+ANKI_TEST(Util, Xml)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Material-like
+	{
+		XmlDocument doc;
+		ANKI_TEST_EXPECT_NO_ERR(doc.parse(MATERIAL_XML, alloc));
+
+		XmlElement materialEl;
+		ANKI_TEST_EXPECT_NO_ERR(doc.getChildElement("material", materialEl));
+		CString txt;
+		ANKI_TEST_EXPECT_NO_ERR(materialEl.getAttributeText("shaderProgram", txt));
+		ANKI_TEST_EXPECT_EQ(txt, "anki/shaders/GBufferGeneric.ankiprog");
+
+		// Siblings
+		XmlElement mutatorEl;
+		ANKI_TEST_EXPECT_NO_ERR(materialEl.getChildElement("mutation", mutatorEl));
+		ANKI_TEST_EXPECT_NO_ERR(mutatorEl.getChildElement("mutator", mutatorEl));
+		U32 count;
+		ANKI_TEST_EXPECT_NO_ERR(mutatorEl.getSiblingElementsCount(count));
+		ANKI_TEST_EXPECT_EQ(count, 6);
+
+		U32 iterations = 0;
+		do
+		{
+			U32 value;
+			ANKI_TEST_EXPECT_NO_ERR(mutatorEl.getAttributeNumber("value", value));
+			ANKI_TEST_EXPECT_EQ(value, 0);
+			++iterations;
+			ANKI_TEST_EXPECT_NO_ERR(mutatorEl.getNextSiblingElement("mutator", mutatorEl));
+		} while(mutatorEl);
+		ANKI_TEST_EXPECT_EQ(iterations, 7);
+
+		// Numbers
+		XmlElement inputEl;
+		ANKI_TEST_EXPECT_NO_ERR(materialEl.getChildElement("inputs", inputEl));
+		ANKI_TEST_EXPECT_NO_ERR(inputEl.getChildElement("input", inputEl));
+		Array<F32, 3> color;
+		ANKI_TEST_EXPECT_NO_ERR(inputEl.getAttributeNumbers("value", color));
+		ANKI_TEST_EXPECT_NEAR(color[1], 0.273263f, 1.0e-6f);
+		DynamicArrayAuto<F32> colorDyn(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(inputEl.getAttributeNumbers("value", colorDyn));
+		ANKI_TEST_EXPECT_EQ(colorDyn.getSize(), 3);
+		ANKI_TEST_EXPECT_NEAR(colorDyn[2], 0.8f, 1.0e-6f);
+
+		Array<F32, 2> wrongSize;
+		ANKI_TEST_EXPECT_ERR(inputEl.getAttributeNumbers("value", wrongSize), Error::USER_DATA);
+		F32 single;
+		ANKI_TEST_EXPECT_ERR(inputEl.getAttributeNumber("value", single), Error::USER_DATA);
+
+		Bool found;
+		ANKI_TEST_EXPECT_NO_ERR(inputEl.getAttributeTextOptional("nothing", txt, found));
+		ANKI_TEST_EXPECT_EQ(found, false);
+
+		// 2nd root
+		XmlElement rtEl;
+		ANKI_TEST_EXPECT_NO_ERR(doc.getChildElement("rtMaterial", rtEl));
+		ANKI_TEST_EXPECT_NO_ERR(rtEl.getChildElement("rayType", rtEl));
+		ANKI_TEST_EXPECT_NO_ERR(rtEl.getAttributeText("type", txt));
+		ANKI_TEST_EXPECT_EQ(txt, "shadows");
+
+		XmlElement noEl;
+		ANKI_TEST_EXPECT_NO_ERR(doc.getChildElementOptional("nothing", noEl));
+		ANKI_TEST_EXPECT_EQ(!!noEl, false);
+	}
+
+	// Text, entities and CDATA
+	{
+		XmlDocument doc;
+		ANKI_TEST_EXPECT_NO_ERR(doc.parse(R"(<a attr='1 &lt; 2 &amp;&amp; &quot;x&quot;' b = "&#65;&#x42;">
+	<b>  10 20
+30 </b>
+	<c><![CDATA[<not> & a tag]]></c>
+	<d>x &gt; y<e/>z</d>
+	<f/>
+	<g>123</g>
+</a>)",
+										  alloc));
+
+		XmlElement aEl;
+		ANKI_TEST_EXPECT_NO_ERR(doc.getChildElement("a", aEl));
+		CString txt;
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getAttributeText("attr", txt));
+		ANKI_TEST_EXPECT_EQ(txt, "1 < 2 && \"x\"");
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getAttributeText("b", txt));
+		ANKI_TEST_EXPECT_EQ(txt, "AB");
+
+		// Whitespace between elements is not text
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getText(txt));
+		ANKI_TEST_EXPECT_EQ(!!txt, false);
+
+		XmlElement el;
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getChildElement("b", el));
+		Array<U32, 3> numbers;
+		ANKI_TEST_EXPECT_NO_ERR(el.getNumbers(numbers));
+		ANKI_TEST_EXPECT_EQ(numbers[0], 10);
+		ANKI_TEST_EXPECT_EQ(numbers[2], 30);
+
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getChildElement("c", el));
+		ANKI_TEST_EXPECT_NO_ERR(el.getText(txt));
+		ANKI_TEST_EXPECT_EQ(txt, "<not> & a tag");
+
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getChildElement("d", el));
+		ANKI_TEST_EXPECT_NO_ERR(el.getText(txt));
+		ANKI_TEST_EXPECT_EQ(txt, "x > y");
+		ANKI_TEST_EXPECT_NO_ERR(el.getChildElement("e", el));
+
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getChildElement("f", el));
+		ANKI_TEST_EXPECT_NO_ERR(el.getText(txt));
+		ANKI_TEST_EXPECT_EQ(!!txt, false);
+
+		ANKI_TEST_EXPECT_NO_ERR(aEl.getChildElement("g", el));
+		U32 number;
+		ANKI_TEST_EXPECT_NO_ERR(el.getNumber(number));
+		ANKI_TEST_EXPECT_EQ(number, 123);
+	}
+
+	// Errors
+	{
+		const Array<const char*, 6> badXmls = {"<a>", "<a></b>", "<a b=1/>", "text", "<a b=\"1/>", "<a><!-- </a>"};
+		for(const char* xml : badXmls)
+		{
+			XmlDocument doc;
+			ANKI_TEST_EXPECT_ERR(doc.parse(xml, alloc), Error::USER_DATA);
+		}
+	}
+
+	// The pull parser
+	{
+		Array<char, 64> txt;
+		strcpy(&txt[0], "<a x=\"1\"><b/>text</a>");
+		XmlPullParser parser(&txt[0]);
+
+		XmlPullParserEvent event;
+		ANKI_TEST_EXPECT_NO_ERR(parser.next(event));
+		ANKI_TEST_EXPECT_EQ(event, XmlPullParserEvent::START_ELEMENT);
+		ANKI_TEST_EXPECT_EQ(parser.getName(), "a");
+		ANKI_TEST_EXPECT_EQ(parser.getAttributeCount(), 1);
+		ANKI_TEST_EXPECT_EQ(parser.getAttributeName(0), "x");
+		ANKI_TEST_EXPECT_EQ(parser.getAttributeValue(0), "1");
+
+		ANKI_TEST_EXPECT_NO_ERR(parser.next(event));
+		ANKI_TEST_EXPECT_EQ(event, XmlPullParserEvent::START_ELEMENT);
+		ANKI_TEST_EXPECT_EQ(parser.getName(), "b");
+		ANKI_TEST_EXPECT_NO_ERR(parser.next(event));
+		ANKI_TEST_EXPECT_EQ(event, XmlPullParserEvent::END_ELEMENT);
+
+		ANKI_TEST_EXPECT_NO_ERR(parser.next(event));
+		ANKI_TEST_EXPECT_EQ(event, XmlPullParserEvent::TEXT);
+		ANKI_TEST_EXPECT_EQ(parser.getText(), "text");
+
+		ANKI_TEST_EXPECT_NO_ERR(parser.next(event));
+		ANKI_TEST_EXPECT_EQ(event, XmlPullParserEvent::END_ELEMENT);
+		ANKI_TEST_EXPECT_EQ(parser.getName(), "a");
+
+		ANKI_TEST_EXPECT_NO_ERR(parser.next(event));
+		ANKI_TEST_EXPECT_EQ(event, XmlPullParserEvent::END_OF_DOCUMENT);
+	}
+}
+
+static void* countingAllocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment)
+{
+	if(ptr == nullptr)
+	{
+		++*static_cast<U32*>(userData);
+	}
+
+	return allocAligned(nullptr, ptr, size, alignment);
+}
+
+ANKI_TEST(Util, XmlBenchmark)
+{
+	U32 allocationCount = 0;
+	HeapAllocator<U8> alloc(countingAllocCallback, &allocationCount);
+
+	// Parse a material and walk it like the MaterialResource does
+	const U32 iterationCount = 20000;
+	const PtrSize xmlSize = strlen(MATERIAL_XML);
+	HighRezTimer timer;
+	timer.start();
+	F32 sum = 0.0f;
+	for(U32 i = 0; i < iterationCount; ++i)
+	{
+		XmlDocument doc;
+		ANKI_TEST_EXPECT_NO_ERR(doc.parse(MATERIAL_XML, alloc));
+
+		XmlElement el;
+		ANKI_TEST_EXPECT_NO_ERR(doc.getChildElement("material", el));
+		ANKI_TEST_EXPECT_NO_ERR(el.getChildElement("inputs", el));
+		ANKI_TEST_EXPECT_NO_ERR(el.getChildElement("input", el));
+		do
+		{
+			DynamicArrayAuto<F32> values(alloc);
+			ANKI_TEST_EXPECT_NO_ERR(el.getAttributeNumbers("value", values));
+			for(F32 v : values)
+			{
+				sum += v;
+			}
+
+			ANKI_TEST_EXPECT_NO_ERR(el.getNextSiblingElement("input", el));
+		} while(el);
+	}
+	timer.stop();
+
+	const Second elapsed = timer.getElapsedTime();
+	ANKI_TEST_LOGI("Parsed %u materials in %fms: %fMB/s, %f allocations per material (sum %f)", iterationCount,
+				   elapsed * 1000.0, F64(xmlSize * iterationCount) / elapsed / (1024.0 * 1024.0),
+				   F32(allocationCount) / F32(iterationCount), sum);
+}
+
+} // end namespace anki
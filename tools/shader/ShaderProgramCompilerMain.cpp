@@ -4,14 +4,36 @@
 // http://www.anki3d.org/LICENSE
 
 #include <anki/shader_compiler/ShaderProgramCompiler.h>
+#include <anki/shader_compiler/ShaderProgramSpirvCache.h>
 #include <anki/Util.h>
+#include <cstdarg>
+#if ANKI_POSIX
+#	include <poll.h>
+#	include <unistd.h>
+#endif
 using namespace anki;
 
 static const char* USAGE = R"(Usage: %s shader_program_file [options]
+       %s -d [options]
 Options:
 -o <name of output>    : The name of the output binary
 -j <thread count>      : Number of threads. Defaults to system's max
 -I <include path>      : The path of the #include files
+-s                     : Strip the debug info from the SPIR-V
+-z                     : Compress the SPIR-V
+-c <directory>         : Cache the SPIR-V of the shader stages in a directory
+-d                     : Run as a daemon
+-w <directory>         : A directory to watch in daemon mode. Not recursive, can be repeated. Defaults to the include
+                         path. The directories of the files that the programs include are watched as well
+
+The daemon reads one command per line from stdin and writes one reply per line to stdout. The replies start with '>'
+to tell them apart from the log:
+compile <program> [<output>] : Compile a program if it changed. Replies "> ok|uptodate|failed <program> <ms>"
+quit                         : Exit. Replies "> bye"
+When a watched file changes the daemon compiles the programs that include it, if it has compiled them before. For each
+one it replies "> rebuilt|failed <program> <ms>" without a command. The compile command checks all the files that
+the program includes so it doesn't depend on the watcher. If watching fails it replies "> error watcher" and
+exits.
 )";
 
 class CmdLineArgs
@@ -21,7 +43,11 @@ public:
 	StringAuto m_inputFname = {m_alloc};
 	StringAuto m_outFname = {m_alloc};
 	StringAuto m_includePath = {m_alloc};
+	StringAuto m_spirvCacheDir = {m_alloc};
+	StringListAuto m_watchDirs = {m_alloc};
 	U32 m_threadCount = getCpuCoresCount();
+	ShaderProgramPostCompileFlag m_postCompileFlags = ShaderProgramPostCompileFlag::NONE;
+	Bool m_daemon = false;
 };
 
 static Error parseCommandLineArgs(int argc, char** argv, CmdLineArgs& info)
@@ -32,9 +58,15 @@ static Error parseCommandLineArgs(int argc, char** argv, CmdLineArgs& info)
 		return Error::USER_DATA;
 	}
 
-	info.m_inputFname.create(argv[1]);
+	// The input is missing in daemon mode
+	I i = 1;
+	if(argv[1][0] != '-')
+	{
+		info.m_inputFname.create(argv[1]);
+		++i;
+	}
 
-	for(I i = 2; i < argc; i++)
+	for(; i < argc; i++)
 	{
 		if(strcmp(argv[i], "-o") == 0)
 		{
@@ -89,122 +121,591 @@ static Error parseCommandLineArgs(int argc, char** argv, CmdLineArgs& info)
 				return Error::USER_DATA;
 			}
 		}
+		else if(strcmp(argv[i], "-s") == 0)
+		{
+			info.m_postCompileFlags |= ShaderProgramPostCompileFlag::STRIP_DEBUG_INFO;
+		}
+		else if(strcmp(argv[i], "-z") == 0)
+		{
+			info.m_postCompileFlags |= ShaderProgramPostCompileFlag::COMPRESS_CODE_BLOCKS;
+		}
+		else if(strcmp(argv[i], "-c") == 0)
+		{
+			++i;
+
+			if(i < argc && std::strlen(argv[i]) > 0)
+			{
+				info.m_spirvCacheDir.sprintf("%s", argv[i]);
+			}
+			else
+			{
+				return Error::USER_DATA;
+			}
+		}
+		else if(strcmp(argv[i], "-d") == 0)
+		{
+			info.m_daemon = true;
+		}
+		else if(strcmp(argv[i], "-w") == 0)
+		{
+			++i;
+
+			if(i < argc && std::strlen(argv[i]) > 0)
+			{
+				info.m_watchDirs.pushBack(argv[i]);
+			}
+			else
+			{
+				return Error::USER_DATA;
+			}
+		}
 		else
 		{
 			return Error::USER_DATA;
 		}
 	}
 
+	// Either compile a single program or run as a daemon
+	if(info.m_daemon != info.m_inputFname.isEmpty())
+	{
+		return Error::USER_DATA;
+	}
+
 	return Error::NONE;
 }
 
-static Error work(const CmdLineArgs& info)
+/// The binary goes to the working directory and it's named after the program.
+static void getDefaultOutputFilename(CString inputFname, StringAuto& outFname)
 {
-	HeapAllocator<U8> alloc{allocAligned, nullptr};
+	getFilepathFilename(inputFname, outFname);
+	if(outFname.isEmpty())
+	{
+		outFname.create(inputFname);
+	}
 
-	// Load interface
-	class FSystem : public ShaderProgramFilesystemInterface
+	outFname.append("bin");
+}
+
+/// Reads the programs from where they are and the rest of the files from the include path.
+class FileSystem : public ShaderProgramFilesystemInterface
+{
+public:
+	CString m_includePath;
+
+	FileSystem(HeapAllocator<U8> alloc)
+		: m_programs(alloc)
+	{
+	}
+
+	void addProgram(CString fname)
+	{
+		const U64 hash = fname.computeHash();
+		if(m_programs.find(hash) == m_programs.getEnd())
+		{
+			m_programs.emplace(hash, hash);
+		}
+	}
+
+	Error readAllText(CString filename, StringAuto& txt) final
+	{
+		const Error err = readAllTextInternal(filename, txt);
+		if(err)
+		{
+			ANKI_LOGE("Failed to read file: %s", filename.cstr());
+		}
+
+		return err;
+	}
+
+	/// Get the path of a file that the parser asks for.
+	void getFilepath(CString filename, StringAuto& path) const
+	{
+		// Don't append the include path to the programs
+		if(m_programs.find(filename.computeHash()) != m_programs.getEnd())
+		{
+			path.sprintf("%s", filename.cstr());
+		}
+		else
+		{
+			path.sprintf("%s/%s", m_includePath.cstr(), filename.cstr());
+		}
+	}
+
+private:
+	HashMapAuto<U64, U64> m_programs; ///< Used as a set, the value is the hash of the filename.
+
+	Error readAllTextInternal(CString filename, StringAuto& txt)
+	{
+		StringAuto fname(txt.getAllocator());
+		getFilepath(filename, fname);
+
+		File file;
+		ANKI_CHECK(file.open(fname, FileOpenFlag::READ));
+		ANKI_CHECK(file.readAllText(txt));
+		return Error::NONE;
+	}
+};
+
+/// Threading interface
+class TaskManager : public ShaderProgramAsyncTaskInterface
+{
+public:
+	ThreadHive* m_hive = nullptr;
+	HeapAllocator<U8> m_alloc;
+
+	void enqueueTask(void (*callback)(void* userData), void* userData)
+	{
+		struct Ctx
+		{
+			void (*m_callback)(void* userData);
+			void* m_userData;
+			HeapAllocator<U8> m_alloc;
+		};
+		Ctx* ctx = m_alloc.newInstance<Ctx>();
+		ctx->m_callback = callback;
+		ctx->m_userData = userData;
+		ctx->m_alloc = m_alloc;
+
+		m_hive->submitTask(
+			[](void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore) {
+				Ctx* ctx = static_cast<Ctx*>(userData);
+				ctx->m_callback(ctx->m_userData);
+				auto alloc = ctx->m_alloc;
+				alloc.deleteInstance(ctx);
+			},
+			ctx);
+	}
+
+	Error joinTasks()
+	{
+		m_hive->waitAllTasks();
+		return Error::NONE;
+	}
+};
+
+/// Holds everything that a compilation needs.
+class CompileContext
+{
+public:
+	const CmdLineArgs* m_info = nullptr;
+	HeapAllocator<U8> m_alloc;
+	FileSystem* m_fsystem = nullptr;
+	TaskManager* m_taskManager = nullptr;
+	ShaderProgramSpirvCacheInterface* m_spirvCache = nullptr;
+	ShaderProgramIncludeCache* m_includeCache = nullptr;
+
+	// Some dummy caps
+	GpuDeviceCapabilities m_caps;
+	BindlessLimits m_limits;
+
+	CompileContext()
+	{
+		m_caps.m_gpuVendor = GpuVendor::AMD;
+		m_caps.m_minorApiVersion = 1;
+		m_caps.m_majorApiVersion = 1;
+
+		m_limits.m_bindlessImageCount = 16;
+		m_limits.m_bindlessTextureCount = 16;
+	}
+
+	Error compile(CString inputFname, CString outFname)
+	{
+		ShaderProgramBinaryWrapper binary(m_alloc);
+		ANKI_CHECK(compileShaderProgram(inputFname, *m_fsystem, nullptr, m_taskManager, m_spirvCache, m_includeCache,
+										m_alloc, m_caps, m_limits, binary));
+		ANKI_CHECK(binary.postCompile(m_info->m_postCompileFlags));
+		ANKI_CHECK(binary.serializeToFile(outFname));
+		return Error::NONE;
+	}
+};
+
+/// A long-lived compiler. glslang stays initialized and the parsed files and the SPIR-V stay in the caches so an edit
+/// costs only the stages that it changed.
+class Daemon
+{
+public:
+	Daemon(CompileContext& ctx)
+		: m_ctx(ctx)
+		, m_includeCache(ctx.m_alloc)
+	{
+		m_ctx.m_includeCache = &m_includeCache;
+	}
+
+	~Daemon()
+	{
+		for(Program* program : m_programs)
+		{
+			program->m_fname.destroy(m_ctx.m_alloc);
+			program->m_outFname.destroy(m_ctx.m_alloc);
+			m_ctx.m_alloc.deleteInstance(program);
+		}
+		m_programs.destroy(m_ctx.m_alloc);
+
+		m_watchedDirs.destroy(m_ctx.m_alloc);
+		m_ctx.m_includeCache = nullptr;
+	}
+
+	Error run();
+
+private:
+	class Program
 	{
 	public:
-		CString m_includePath;
-		U32 m_fileReadCount = 0;
+		String m_fname;
+		String m_outFname;
+		Bool m_failed = false;
+		Bool m_dirty = false;
+	};
+
+	CompileContext& m_ctx;
+	ShaderProgramIncludeCache m_includeCache;
+	HashMap<U64, Program*> m_programs; ///< The programs that were compiled. The key is the hash of the filename.
+	INotify m_watch;
+	HashMap<U64, U64> m_watchedDirs; ///< Used as a set, the value is the hash of the directory.
+
+	Mutex m_mtx; ///< Serializes the commands and the watcher.
+	Thread m_watcher = {"ShaderWatcher"};
+	Atomic<U32> m_quit = {0};
+
+	ANKI_CHECK_FORMAT(0, 1)
+	static void reply(const char* fmt, ...)
+	{
+		Array<char, 512> buff;
+		va_list args;
+		va_start(args, fmt);
+		vsnprintf(&buff[0], sizeof(buff), fmt, args);
+		va_end(args);
+
+		// One call per line so the line is not broken by the log
+		printf("> %s\n", &buff[0]);
+		fflush(stdout);
+	}
+
+	void compile(Program& program, CString reason)
+	{
+		HighRezTimer timer;
+		timer.start();
+		program.m_failed = !!m_ctx.compile(program.m_fname, program.m_outFname);
+		timer.stop();
+
+		program.m_dirty = false;
+		reply("%s %s %.2f", (program.m_failed) ? "failed" : reason.cstr(), program.m_fname.cstr(),
+			  timer.getElapsedTime() * 1000.0);
+	}
+
+	/// Compile the programs that depend on the files that changed. The caller should hold m_mtx.
+	/// @param force Check the files even if the watcher didn't see a change.
+	Error pollChanges(Bool force);
+
+	Error watchDirectory(CString dir);
+
+	/// Watch the directories of the files that the programs include. INotify is not recursive so the headers in the
+	/// subdirectories of the include path need their own watches. The caller should hold m_mtx.
+	Error watchIncludedDirectories();
+
+	Error processCommand(CString line, Bool& quit);
+
+	/// Wait for a command in stdin.
+	/// @return False if the daemon should quit.
+	Bool waitForCommand() const;
+
+	static Error watcherThread(ThreadCallbackInfo& info);
+};
+
+Error Daemon::pollChanges(Bool force)
+{
+	Bool modified;
+	ANKI_CHECK(m_watch.pollEvents(modified));
+
+	if(!modified && !force)
+	{
+		return Error::NONE;
+	}
+
+	StringListAuto changedPrograms(m_ctx.m_alloc);
+	ANKI_CHECK(m_includeCache.refresh(*m_ctx.m_fsystem, changedPrograms));
+
+	for(const String& fname : changedPrograms)
+	{
+		auto it = m_programs.find(fname.toCString().computeHash());
+		if(it != m_programs.getEnd())
+		{
+			(*it)->m_dirty = true;
+		}
+	}
 
-		Error readAllTextInternal(CString filename, StringAuto& txt)
+	// The includes of a program that failed to parse are not known. Try it again
+	for(Program* program : m_programs)
+	{
+		if(program->m_dirty || program->m_failed)
 		{
-			StringAuto fname(txt.getAllocator());
+			compile(*program, "rebuilt");
+		}
+	}
 
-			// The first file is the input file. Don't append the include path to it
-			if(m_fileReadCount == 0)
-			{
-				fname.sprintf("%s", filename.cstr());
-			}
-			else
-			{
-				fname.sprintf("%s/%s", m_includePath.cstr(), filename.cstr());
-			}
-			++m_fileReadCount;
+	// The programs might include new files
+	ANKI_CHECK(watchIncludedDirectories());
+
+	return Error::NONE;
+}
+
+Error Daemon::watchDirectory(CString dir)
+{
+	const U64 hash = dir.computeHash();
+	if(m_watchedDirs.find(hash) == m_watchedDirs.getEnd())
+	{
+		U32 pathIdx;
+		ANKI_CHECK(m_watch.addPath(dir, pathIdx));
+		m_watchedDirs.emplace(m_ctx.m_alloc, hash, hash);
+	}
+
+	return Error::NONE;
+}
+
+Error Daemon::watchIncludedDirectories()
+{
+	StringListAuto fnames(m_ctx.m_alloc);
+	m_includeCache.getFilenames(fnames);
 
-			File file;
-			ANKI_CHECK(file.open(fname, FileOpenFlag::READ));
-			ANKI_CHECK(file.readAllText(txt));
-			return Error::NONE;
+	for(const String& fname : fnames)
+	{
+		StringAuto path(m_ctx.m_alloc);
+		m_ctx.m_fsystem->getFilepath(fname, path);
+
+		StringAuto dir(m_ctx.m_alloc);
+		const char* slash = std::strrchr(path.cstr(), '/');
+		if(slash == nullptr)
+		{
+			dir.create(".");
+		}
+		else if(slash == path.cstr())
+		{
+			dir.create("/");
+		}
+		else
+		{
+			dir.create(path.cstr(), slash);
 		}
 
-		Error readAllText(CString filename, StringAuto& txt) final
+		ANKI_CHECK(watchDirectory(dir));
+	}
+
+	return Error::NONE;
+}
+
+Error Daemon::processCommand(CString line, Bool& quit)
+{
+	StringListAuto tokens(m_ctx.m_alloc);
+	tokens.splitString(line, ' ');
+
+	if(tokens.getSize() == 0)
+	{
+		return Error::NONE;
+	}
+
+	auto it = tokens.getBegin();
+	if(*it == "quit" && tokens.getSize() == 1)
+	{
+		quit = true;
+		reply("bye");
+	}
+	else if(*it == "compile" && (tokens.getSize() == 2 || tokens.getSize() == 3))
+	{
+		const CString fname = *(++it);
+
+		StringAuto outFname(m_ctx.m_alloc);
+		if(tokens.getSize() == 3)
 		{
-			const Error err = readAllTextInternal(filename, txt);
-			if(err)
+			outFname.create(*(++it));
+		}
+		else
+		{
+			getDefaultOutputFilename(fname, outFname);
+		}
+
+		LockGuard<Mutex> lock(m_mtx);
+
+		// The build system might have just edited a file and the watcher might not see every directory. Check all the
+		// files
+		ANKI_CHECK(pollChanges(true));
+
+		Program* program;
+		auto programIt = m_programs.find(fname.computeHash());
+		if(programIt != m_programs.getEnd())
+		{
+			program = *programIt;
+			if(program->m_outFname != outFname)
 			{
-				ANKI_LOGE("Failed to read file: %s", filename.cstr());
+				program->m_outFname.destroy(m_ctx.m_alloc);
+				program->m_outFname.create(m_ctx.m_alloc, outFname);
+				program->m_dirty = true;
 			}
+		}
+		else
+		{
+			program = m_ctx.m_alloc.newInstance<Program>();
+			program->m_fname.create(m_ctx.m_alloc, fname);
+			program->m_outFname.create(m_ctx.m_alloc, outFname);
+			program->m_dirty = true;
+			m_programs.emplace(m_ctx.m_alloc, fname.computeHash(), program);
+
+			m_ctx.m_fsystem->addProgram(fname);
+		}
 
+		if(program->m_dirty || program->m_failed || !fileExists(program->m_outFname))
+		{
+			compile(*program, "ok");
+			ANKI_CHECK(watchIncludedDirectories());
+		}
+		else
+		{
+			reply("uptodate %s 0.00", program->m_fname.cstr());
+		}
+	}
+	else
+	{
+		ANKI_LOGE("Unknown command: %s", line.cstr());
+		reply("unknown");
+	}
+
+	return Error::NONE;
+}
+
+Error Daemon::watcherThread(ThreadCallbackInfo& info)
+{
+	Daemon& self = *static_cast<Daemon*>(info.m_userData);
+
+	while(self.m_quit.load() == 0)
+	{
+		HighRezTimer::sleep(0.1);
+
+		LockGuard<Mutex> lock(self.m_mtx);
+		const Error err = self.pollChanges(false);
+		if(err)
+		{
+			// The daemon can't see the changes any more. Tell the client and stop the command loop
+			reply("error watcher");
+			self.m_quit.store(1);
 			return err;
 		}
-	} fsystem;
-	fsystem.m_includePath = info.m_includePath;
+	}
 
-	// Threading interface
-	class TaskManager : public ShaderProgramAsyncTaskInterface
+	return Error::NONE;
+}
+
+Bool Daemon::waitForCommand() const
+{
+#if ANKI_POSIX
+	// Poll to notice that the watcher failed while there are no commands
+	while(m_quit.load() == 0)
 	{
-	public:
-		ThreadHive* m_hive = nullptr;
-		HeapAllocator<U8> m_alloc;
+		pollfd fd = {};
+		fd.fd = STDIN_FILENO;
+		fd.events = POLLIN;
+		if(poll(&fd, 1, 100) != 0)
+		{
+			// A command, the end of the input or an error. Let the read handle it
+			return true;
+		}
+	}
+
+	return false;
+#else
+	// Can't poll stdin, the daemon notices a failed watcher in the next command
+	return m_quit.load() == 0;
+#endif
+}
+
+Error Daemon::run()
+{
+	const CmdLineArgs& info = *m_ctx.m_info;
+
+	// Watch the include path if nothing else is given
+	ANKI_CHECK(m_watch.init(m_ctx.m_alloc));
+	if(info.m_watchDirs.isEmpty())
+	{
+		ANKI_CHECK(watchDirectory(info.m_includePath));
+	}
+	else
+	{
+		for(const String& dir : info.m_watchDirs)
+		{
+			ANKI_CHECK(watchDirectory(dir));
+		}
+	}
 
-		void enqueueTask(void (*callback)(void* userData), void* userData)
+#if ANKI_POSIX
+	// The poll of stdin can't see the lines that are in the buffer of the C library
+	setvbuf(stdin, nullptr, _IONBF, 0);
+#endif
+
+	m_watcher.start(this, watcherThread);
+	reply("ready");
+
+	Error err = Error::NONE;
+	Array<char, 1024> line;
+	Bool quit = false;
+	while(!err && !quit && waitForCommand() && fgets(&line[0], sizeof(line), stdin) && m_quit.load() == 0)
+	{
+		// Drop the new line
+		const PtrSize len = std::strlen(&line[0]);
+		if(len && line[len - 1] == '\n')
 		{
-			struct Ctx
-			{
-				void (*m_callback)(void* userData);
-				void* m_userData;
-				HeapAllocator<U8> m_alloc;
-			};
-			Ctx* ctx = m_alloc.newInstance<Ctx>();
-			ctx->m_callback = callback;
-			ctx->m_userData = userData;
-			ctx->m_alloc = m_alloc;
-
-			m_hive->submitTask(
-				[](void* userData, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore) {
-					Ctx* ctx = static_cast<Ctx*>(userData);
-					ctx->m_callback(ctx->m_userData);
-					auto alloc = ctx->m_alloc;
-					alloc.deleteInstance(ctx);
-				},
-				ctx);
-		}
-
-		Error joinTasks()
-		{
-			m_hive->waitAllTasks();
-			return Error::NONE;
-		}
-	} taskManager;
+			line[len - 1] = '\0';
+		}
+
+		err = processCommand(&line[0], quit);
+	}
+
+	m_quit.store(1);
+	const Error watcherErr = m_watcher.join();
+	return (err) ? err : watcherErr;
+}
+
+static Error work(const CmdLineArgs& info)
+{
+	HeapAllocator<U8> alloc{allocAligned, nullptr};
+
+	// Load interface
+	FileSystem fsystem(alloc);
+	fsystem.m_includePath = info.m_includePath;
+
+	// Threading interface
+	TaskManager taskManager;
 	taskManager.m_hive =
 		(info.m_threadCount) ? alloc.newInstance<ThreadHive>(info.m_threadCount, alloc, true) : nullptr;
 	taskManager.m_alloc = alloc;
 
-	// Some dummy caps
-	GpuDeviceCapabilities caps;
-	caps.m_gpuVendor = GpuVendor::AMD;
-	caps.m_minorApiVersion = 1;
-	caps.m_majorApiVersion = 1;
-
-	BindlessLimits limits;
-	limits.m_bindlessImageCount = 16;
-	limits.m_bindlessTextureCount = 16;
+	// SPIR-V cache
+	ShaderProgramSpirvFileCache spirvCache(alloc);
+	if(!info.m_spirvCacheDir.isEmpty())
+	{
+		ANKI_CHECK(spirvCache.init(info.m_spirvCacheDir));
+	}
 
-	// Compile
-	ShaderProgramBinaryWrapper binary(alloc);
-	ANKI_CHECK(compileShaderProgram(info.m_inputFname, fsystem, nullptr, (info.m_threadCount) ? &taskManager : nullptr,
-									alloc, caps, limits, binary));
+	CompileContext ctx;
+	ctx.m_info = &info;
+	ctx.m_alloc = alloc;
+	ctx.m_fsystem = &fsystem;
+	ctx.m_taskManager = (info.m_threadCount) ? &taskManager : nullptr;
+	ctx.m_spirvCache = (!info.m_spirvCacheDir.isEmpty()) ? &spirvCache : nullptr;
 
-	// Store the binary
-	ANKI_CHECK(binary.serializeToFile(info.m_outFname));
+	Error err = Error::NONE;
+	if(info.m_daemon)
+	{
+		Daemon daemon(ctx);
+		err = daemon.run();
+	}
+	else
+	{
+		fsystem.addProgram(info.m_inputFname);
+		err = ctx.compile(info.m_inputFname, info.m_outFname);
+	}
 
 	// Cleanup
 	alloc.deleteInstance(taskManager.m_hive);
 
-	return Error::NONE;
+	return err;
 }
 
 int main(int argc, char** argv)
@@ -212,14 +713,13 @@ int main(int argc, char** argv)
 	CmdLineArgs info;
 	if(parseCommandLineArgs(argc, argv, info))
 	{
-		ANKI_LOGE(USAGE, argv[0]);
+		ANKI_LOGE(USAGE, argv[0], argv[0]);
 		return 1;
 	}
 
-	if(info.m_outFname.isEmpty())
+	if(info.m_outFname.isEmpty() && !info.m_daemon)
 	{
-		getFilepathFilename(info.m_inputFname, info.m_outFname);
-		info.m_outFname.append("bin");
+		getDefaultOutputFilename(info.m_inputFname, info.m_outFname);
 	}
 
 	if(info.m_includePath.isEmpty())
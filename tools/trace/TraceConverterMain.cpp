@@ -0,0 +1,32 @@
+// Copyright (C) 2009-2021, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/core/CoreTracer.h>
+
+using namespace anki;
+
+static const char* USAGE = R"(Convert a binary trace to a Chrome trace JSON and a CSV with the counters
+Usage: %s in_file out_json_file out_csv_file
+)";
+
+int main(int argc, char** argv)
+{
+	if(argc != 4)
+	{
+		ANKI_LOGE(USAGE, argv[0]);
+		return 1;
+	}
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	CoreTraceConverter converter(alloc);
+	const Error err = converter.convert(argv[1], argv[2], argv[3]);
+	if(err)
+	{
+		ANKI_LOGE("Can't convert due to an error. Bye");
+		return 1;
+	}
+
+	return 0;
+}